@@ -0,0 +1,677 @@
+#include "arrow_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Schema.fbs / Message.fbs
+#define ARROW_METADATA_V5 4
+#define ARROW_TYPE_INT 2
+#define ARROW_TYPE_UTF8 5
+#define ARROW_TYPE_BOOL 6
+#define ARROW_TYPE_TIMESTAMP 10
+#define ARROW_TIME_UNIT_MICROSECOND 2
+#define ARROW_HEADER_SCHEMA 1
+#define ARROW_HEADER_DICTIONARY_BATCH 2
+#define ARROW_HEADER_RECORD_BATCH 3
+
+#define ARROW_CONTINUATION 0xffffffffu
+#define ARROW_DICTIONARY_SLOTS 1024
+#define ARROW_DICTIONARY_DATA 16384
+
+static const uint8_t arrow_zeros[ARROW_FILE_ALIGNMENT] = {0};
+
+/**
+ * @brief Bytes per value in the values buffer, 0 for the bitmaps
+ *
+ * @param type
+ * @return size_t
+ */
+static size_t
+arrow_value_size(arrow_type_t type)
+{
+    switch (type){
+        case ARROW_UINT8:
+            return 1;
+        case ARROW_UINT16:
+            return 2;
+        case ARROW_UINT32:
+        case ARROW_STRING_DICTIONARY:
+            return 4;
+        case ARROW_UINT64:
+        case ARROW_TIMESTAMP_US:
+            return 8;
+        case ARROW_BOOL:
+        default:
+            return 0;
+    }
+}
+
+static size_t
+arrow_bitmap_size(uint32_t rows)
+{
+    return (rows + 7) / 8;
+}
+
+static size_t
+arrow_padding(size_t length)
+{
+    return (0 - length) & (ARROW_FILE_ALIGNMENT - 1);
+}
+
+static void*
+arrow_alloc(size_t size)
+{
+    void *data = calloc(1, size > 0 ? size : 1);
+    if (data == NULL){
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    return data;
+}
+
+static void*
+arrow_realloc(void *data, size_t size)
+{
+    data = realloc(data, size);
+    if (data == NULL){
+        perror("realloc");
+        exit(EXIT_FAILURE);
+    }
+    return data;
+}
+
+static void
+arrow_write(arrow_file_t *file, const void *data, size_t length)
+{
+    output_sink_write(&file->out, data, length);
+    file->offset += length;
+}
+
+static void
+arrow_write_padding(arrow_file_t *file)
+{
+    arrow_write(file, arrow_zeros, arrow_padding(file->offset));
+}
+
+static void
+arrow_write_uint32(arrow_file_t *file, uint32_t value)
+{
+    arrow_write(file, &value, sizeof(value));
+}
+
+static void
+arrow_dictionary_init(arrow_dictionary_t *dictionary)
+{
+    dictionary->offsets_capacity = ARROW_DICTIONARY_SLOTS;
+    dictionary->offsets = arrow_alloc(dictionary->offsets_capacity * sizeof(int32_t));
+    dictionary->count = 0;
+    dictionary->data_capacity = ARROW_DICTIONARY_DATA;
+    dictionary->data = arrow_alloc(dictionary->data_capacity);
+    dictionary->data_length = 0;
+    dictionary->slot_count = ARROW_DICTIONARY_SLOTS;
+    dictionary->slots = arrow_alloc(dictionary->slot_count * sizeof(uint32_t));
+    dictionary->written = 0;
+}
+
+static void
+arrow_dictionary_destroy(arrow_dictionary_t *dictionary)
+{
+    free(dictionary->offsets);
+    free(dictionary->data);
+    free(dictionary->slots);
+}
+
+static uint32_t
+arrow_string_hash(const char *string, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++){
+        hash ^= (uint8_t)string[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// twice as many slots, every entry hashed again
+static void
+arrow_dictionary_rehash(arrow_dictionary_t *dictionary)
+{
+    free(dictionary->slots);
+    dictionary->slot_count *= 2;
+    dictionary->slots = arrow_alloc(dictionary->slot_count * sizeof(uint32_t));
+    uint32_t mask = dictionary->slot_count - 1;
+    for (uint32_t index = 0; index < dictionary->count; index++){
+        const char *string = dictionary->data + dictionary->offsets[index];
+        size_t length = dictionary->offsets[index + 1] - dictionary->offsets[index];
+        uint32_t slot = arrow_string_hash(string, length) & mask;
+        while (dictionary->slots[slot] != 0){
+            slot = (slot + 1) & mask;
+        }
+        dictionary->slots[slot] = index + 1;
+    }
+}
+
+/**
+ * @brief Index of the string in the dictionary, added if it's new
+ *
+ * @param dictionary
+ * @param string
+ * @param length
+ * @return int32_t
+ */
+static int32_t
+arrow_dictionary_index(arrow_dictionary_t *dictionary, const char *string, size_t length)
+{
+    uint32_t mask = dictionary->slot_count - 1;
+    uint32_t slot = arrow_string_hash(string, length) & mask;
+    while (dictionary->slots[slot] != 0){
+        uint32_t index = dictionary->slots[slot] - 1;
+        size_t entry_length = dictionary->offsets[index + 1] - dictionary->offsets[index];
+        if (entry_length == length && memcmp(dictionary->data + dictionary->offsets[index], string, length) == 0){
+            return index;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    // the offsets are int32 in the file
+    if (dictionary->data_length + length > INT32_MAX){
+        fprintf(stderr, "arrow: dictionary larger than 2 GiB\n");
+        exit(EXIT_FAILURE);
+    }
+    if (dictionary->count + 2 > dictionary->offsets_capacity){
+        dictionary->offsets_capacity *= 2;
+        dictionary->offsets = arrow_realloc(dictionary->offsets, dictionary->offsets_capacity * sizeof(int32_t));
+    }
+    if (dictionary->data_length + length > dictionary->data_capacity){
+        while (dictionary->data_length + length > dictionary->data_capacity){
+            dictionary->data_capacity *= 2;
+        }
+        dictionary->data = arrow_realloc(dictionary->data, dictionary->data_capacity);
+    }
+
+    uint32_t index = dictionary->count;
+    memcpy(dictionary->data + dictionary->data_length, string, length);
+    dictionary->data_length += length;
+    dictionary->count++;
+    dictionary->offsets[dictionary->count] = dictionary->data_length;
+    dictionary->slots[slot] = index + 1;
+
+    // at most half full
+    if (dictionary->count * 2 > dictionary->slot_count){
+        arrow_dictionary_rehash(dictionary);
+    }
+    return index;
+}
+
+static fb_offset_t
+arrow_int_type(fb_builder_t *fb, int bit_width, bool is_signed)
+{
+    fb_start_table(fb);
+    fb_add_int32(fb, 0, bit_width);
+    fb_add_bool(fb, 1, is_signed);
+    return fb_end_table(fb);
+}
+
+/**
+ * @brief The Field table of a column
+ *
+ * @param fb
+ * @param column
+ * @param id dictionary id
+ * @return fb_offset_t
+ */
+static fb_offset_t
+arrow_field(fb_builder_t *fb, const arrow_column_t *column, int64_t id)
+{
+    fb_offset_t name = fb_create_string(fb, column->field.name);
+    fb_offset_t children = fb_create_offset_vector(fb, NULL, 0);
+    fb_offset_t type;
+    fb_offset_t dictionary = 0;
+    uint8_t type_type;
+
+    switch (column->field.type){
+        case ARROW_BOOL:
+            fb_start_table(fb);
+            type = fb_end_table(fb);
+            type_type = ARROW_TYPE_BOOL;
+            break;
+        case ARROW_TIMESTAMP_US: {
+            fb_offset_t timezone = fb_create_string(fb, "UTC");
+            fb_start_table(fb);
+            fb_add_int16(fb, 0, ARROW_TIME_UNIT_MICROSECOND);
+            fb_add_offset(fb, 1, timezone);
+            type = fb_end_table(fb);
+            type_type = ARROW_TYPE_TIMESTAMP;
+            break;
+        }
+        case ARROW_STRING_DICTIONARY: {
+            fb_offset_t index_type = arrow_int_type(fb, 32, true);
+            fb_start_table(fb);
+            fb_add_int64(fb, 0, id);
+            fb_add_offset(fb, 1, index_type);
+            fb_add_bool(fb, 2, false);
+            dictionary = fb_end_table(fb);
+            // the type is the one of the values
+            fb_start_table(fb);
+            type = fb_end_table(fb);
+            type_type = ARROW_TYPE_UTF8;
+            break;
+        }
+        default:
+            type = arrow_int_type(fb, arrow_value_size(column->field.type) * 8, false);
+            type_type = ARROW_TYPE_INT;
+            break;
+    }
+
+    fb_start_table(fb);
+    fb_add_offset(fb, 0, name);
+    fb_add_bool(fb, 1, true);
+    fb_add_uint8(fb, 2, type_type);
+    fb_add_offset(fb, 3, type);
+    if (dictionary != 0){
+        fb_add_offset(fb, 4, dictionary);
+    }
+    fb_add_offset(fb, 5, children);
+    return fb_end_table(fb);
+}
+
+static fb_offset_t
+arrow_schema(arrow_file_t *file)
+{
+    fb_builder_t *fb = &file->builder;
+    fb_offset_t fields[file->column_count];
+    for (int i = 0; i < file->column_count; i++){
+        fields[i] = arrow_field(fb, &file->columns[i], i);
+    }
+    fb_offset_t vector = fb_create_offset_vector(fb, fields, file->column_count);
+    fb_start_table(fb);
+    fb_add_int16(fb, 0, 0); // little-endian
+    fb_add_offset(fb, 1, vector);
+    return fb_end_table(fb);
+}
+
+static fb_offset_t
+arrow_record_batch(fb_builder_t *fb, int64_t length, const arrow_field_node_t *nodes, size_t node_count,
+    const arrow_buffer_t *buffers, size_t buffer_count)
+{
+    fb_offset_t node_vector = fb_create_struct_vector(fb, nodes, node_count, sizeof(arrow_field_node_t), 8);
+    fb_offset_t buffer_vector = fb_create_struct_vector(fb, buffers, buffer_count, sizeof(arrow_buffer_t), 8);
+    fb_start_table(fb);
+    fb_add_int64(fb, 0, length);
+    fb_add_offset(fb, 1, node_vector);
+    fb_add_offset(fb, 2, buffer_vector);
+    return fb_end_table(fb);
+}
+
+/**
+ * @brief Wrap header in a Message and write it, the body follows
+ *
+ * @param file
+ * @param header_type
+ * @param header
+ * @param body_length
+ * @return int32_t size of the metadata, marker and length included
+ */
+static int32_t
+arrow_write_message(arrow_file_t *file, uint8_t header_type, fb_offset_t header, int64_t body_length)
+{
+    fb_builder_t *fb = &file->builder;
+    fb_start_table(fb);
+    fb_add_int16(fb, 0, ARROW_METADATA_V5);
+    fb_add_uint8(fb, 1, header_type);
+    fb_add_offset(fb, 2, header);
+    fb_add_int64(fb, 3, body_length);
+    fb_finish(fb, fb_end_table(fb));
+
+    // the body starts on an 8 bytes boundary
+    size_t padded = fb->size + arrow_padding(fb->size);
+    arrow_write_uint32(file, ARROW_CONTINUATION);
+    arrow_write_uint32(file, padded);
+    arrow_write(file, fb_data(fb), fb->size);
+    arrow_write_padding(file);
+    fb_reset(fb);
+    return padded + 2 * sizeof(uint32_t);
+}
+
+static void
+arrow_add_block(arrow_block_t **blocks, size_t *count, size_t *capacity, int64_t offset, int32_t metadata_length, int64_t body_length)
+{
+    if (*count == *capacity){
+        *capacity = *capacity > 0 ? *capacity * 2 : 64;
+        *blocks = arrow_realloc(*blocks, *capacity * sizeof(arrow_block_t));
+    }
+    arrow_block_t block = {offset, metadata_length, 0, body_length};
+    (*blocks)[(*count)++] = block;
+}
+
+/**
+ * @brief Write the entries added to the column's dictionary since the
+ * last time, the first batch of a dictionary is not a delta
+ *
+ * @param file
+ * @param column
+ */
+static void
+arrow_write_dictionary(arrow_file_t *file, int column)
+{
+    arrow_dictionary_t *dictionary = &file->columns[column].dictionary;
+    uint32_t first = dictionary->written;
+    uint32_t count = dictionary->count - first;
+    int32_t base = dictionary->offsets[first];
+    size_t offsets_length = (count + 1) * sizeof(int32_t);
+    size_t data_length = dictionary->offsets[dictionary->count] - base;
+
+    arrow_field_node_t node = {count, 0};
+    arrow_buffer_t buffers[3] = {
+        {0, 0},                                                 // validity, no nulls
+        {0, offsets_length},
+        {offsets_length + arrow_padding(offsets_length), data_length}
+    };
+    int64_t body_length = buffers[2].offset + data_length + arrow_padding(data_length);
+
+    fb_builder_t *fb = &file->builder;
+    fb_offset_t data = arrow_record_batch(fb, count, &node, 1, buffers, 3);
+    fb_start_table(fb);
+    fb_add_int64(fb, 0, column);
+    fb_add_offset(fb, 1, data);
+    fb_add_bool(fb, 2, first > 0);
+    fb_offset_t batch = fb_end_table(fb);
+
+    int64_t offset = file->offset;
+    int32_t metadata_length = arrow_write_message(file, ARROW_HEADER_DICTIONARY_BATCH, batch, body_length);
+
+    // offsets of the delta start at 0
+    int32_t *out = (int32_t*)output_sink_reserve(&file->out, offsets_length);
+    for (uint32_t i = 0; i <= count; i++){
+        out[i] = dictionary->offsets[first + i] - base;
+    }
+    file->out.length += offsets_length;
+    file->offset += offsets_length;
+    arrow_write_padding(file);
+    arrow_write(file, dictionary->data + base, data_length);
+    arrow_write_padding(file);
+
+    arrow_add_block(&file->dictionary_blocks, &file->dictionary_block_count, &file->dictionary_block_capacity,
+        offset, metadata_length, body_length);
+    dictionary->written = dictionary->count;
+}
+
+// empty the columns for the next batch
+static void
+arrow_clear_batch(arrow_file_t *file)
+{
+    for (int i = 0; i < file->column_count; i++){
+        arrow_column_t *column = &file->columns[i];
+        memset(column->validity, 0, arrow_bitmap_size(file->batch_rows));
+        if (column->field.type == ARROW_BOOL){
+            memset(column->values, 0, arrow_bitmap_size(file->batch_rows));
+        }
+        column->valid_count = 0;
+    }
+    file->rows = 0;
+}
+
+/**
+ * @brief Write the rows of the current batch, preceded by the new
+ * dictionary entries, and start an empty batch
+ *
+ * @param file
+ */
+void
+arrow_file_flush_batch(arrow_file_t *file)
+{
+    if (file->rows == 0){
+        return;
+    }
+    uint32_t rows = file->rows;
+
+    for (int i = 0; i < file->column_count; i++){
+        arrow_column_t *column = &file->columns[i];
+        if (column->field.type != ARROW_STRING_DICTIONARY){
+            continue;
+        }
+        // every dictionary is known before the first batch, even empty
+        if (column->dictionary.count > column->dictionary.written || file->batch_block_count == 0){
+            arrow_write_dictionary(file, i);
+        }
+    }
+
+    size_t buffer_count = 0;
+    int64_t body_length = 0;
+    for (int i = 0; i < file->column_count; i++){
+        arrow_column_t *column = &file->columns[i];
+        int64_t null_count = rows - column->valid_count;
+        file->nodes[i].length = rows;
+        file->nodes[i].null_count = null_count;
+
+        // no bitmap when everything is there
+        size_t validity_length = null_count > 0 ? arrow_bitmap_size(rows) : 0;
+        file->buffers[buffer_count].offset = body_length;
+        file->buffers[buffer_count].length = validity_length;
+        file->buffer_data[buffer_count++] = column->validity;
+        body_length += validity_length + arrow_padding(validity_length);
+
+        size_t values_length = column->field.type == ARROW_BOOL
+            ? arrow_bitmap_size(rows)
+            : rows * arrow_value_size(column->field.type);
+        file->buffers[buffer_count].offset = body_length;
+        file->buffers[buffer_count].length = values_length;
+        file->buffer_data[buffer_count++] = column->values;
+        body_length += values_length + arrow_padding(values_length);
+    }
+
+    fb_offset_t batch = arrow_record_batch(&file->builder, rows, file->nodes, file->column_count, file->buffers, buffer_count);
+    int64_t offset = file->offset;
+    int32_t metadata_length = arrow_write_message(file, ARROW_HEADER_RECORD_BATCH, batch, body_length);
+    for (size_t i = 0; i < buffer_count; i++){
+        arrow_write(file, file->buffer_data[i], file->buffers[i].length);
+        arrow_write_padding(file);
+    }
+    arrow_add_block(&file->batch_blocks, &file->batch_block_count, &file->batch_block_capacity,
+        offset, metadata_length, body_length);
+
+    arrow_clear_batch(file);
+}
+
+/**
+ * @brief Create path and write the header and the schema
+ *
+ * Returns NULL and fills errbuf if the file can't be created.
+ *
+ * @param path
+ * @param fields the columns, their names must outlive the file
+ * @param field_count
+ * @param batch_rows rows per record batch, ARROW_FILE_BATCH_ROWS if 0
+ * @param errbuf
+ * @return arrow_file_t*
+ */
+arrow_file_t*
+arrow_file_create(const char *path, const arrow_field_t *fields, int field_count, uint32_t batch_rows, char *errbuf)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1){
+        snprintf(errbuf, ARROW_FILE_ERRBUF_SIZE, "%s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    arrow_file_t *file = (arrow_file_t*)arrow_alloc(sizeof(arrow_file_t));
+    output_sink_init(&file->out, fd, OUTPUT_SINK_CAPACITY);
+    fb_init(&file->builder, 4096);
+    file->batch_rows = batch_rows > 0 ? batch_rows : ARROW_FILE_BATCH_ROWS;
+    file->column_count = field_count;
+    file->columns = arrow_alloc(field_count * sizeof(arrow_column_t));
+    file->nodes = arrow_alloc(field_count * sizeof(arrow_field_node_t));
+    file->buffers = arrow_alloc(2 * field_count * sizeof(arrow_buffer_t));
+    file->buffer_data = arrow_alloc(2 * field_count * sizeof(void*));
+
+    for (int i = 0; i < field_count; i++){
+        arrow_column_t *column = &file->columns[i];
+        column->field = fields[i];
+        column->validity = arrow_alloc(arrow_bitmap_size(file->batch_rows));
+        if (fields[i].type == ARROW_BOOL){
+            column->values = arrow_alloc(arrow_bitmap_size(file->batch_rows));
+        } else {
+            column->values = arrow_alloc(file->batch_rows * arrow_value_size(fields[i].type));
+        }
+        if (fields[i].type == ARROW_STRING_DICTIONARY){
+            arrow_dictionary_init(&column->dictionary);
+        }
+    }
+
+    arrow_write(file, ARROW_FILE_MAGIC, strlen(ARROW_FILE_MAGIC));
+    arrow_write_padding(file);
+    arrow_write_message(file, ARROW_HEADER_SCHEMA, arrow_schema(file), 0);
+    return file;
+}
+
+/**
+ * @brief Write what is left, the footer, and close the file
+ *
+ * @param file
+ * @return int 0, -1 if the file couldn't be written
+ */
+int
+arrow_file_close(arrow_file_t *file)
+{
+    arrow_file_flush_batch(file);
+
+    // end of stream
+    arrow_write_uint32(file, ARROW_CONTINUATION);
+    arrow_write_uint32(file, 0);
+
+    fb_builder_t *fb = &file->builder;
+    fb_offset_t schema = arrow_schema(file);
+    fb_offset_t dictionaries = fb_create_struct_vector(fb, file->dictionary_blocks, file->dictionary_block_count, sizeof(arrow_block_t), 8);
+    fb_offset_t batches = fb_create_struct_vector(fb, file->batch_blocks, file->batch_block_count, sizeof(arrow_block_t), 8);
+    fb_start_table(fb);
+    fb_add_int16(fb, 0, ARROW_METADATA_V5);
+    fb_add_offset(fb, 1, schema);
+    fb_add_offset(fb, 2, dictionaries);
+    fb_add_offset(fb, 3, batches);
+    fb_finish(fb, fb_end_table(fb));
+    arrow_write(file, fb_data(fb), fb->size);
+    arrow_write_uint32(file, fb->size);
+    arrow_write(file, ARROW_FILE_MAGIC, strlen(ARROW_FILE_MAGIC));
+
+    int status = output_sink_flush(&file->out);
+    if (close(file->out.fd) == -1){
+        perror("close");
+        status = -1;
+    }
+    file->out.fd = OUTPUT_SINK_NO_FD;
+    output_sink_destroy(&file->out);
+
+    for (int i = 0; i < file->column_count; i++){
+        arrow_column_t *column = &file->columns[i];
+        free(column->validity);
+        free(column->values);
+        if (column->field.type == ARROW_STRING_DICTIONARY){
+            arrow_dictionary_destroy(&column->dictionary);
+        }
+    }
+    fb_destroy(fb);
+    free(file->columns);
+    free(file->nodes);
+    free(file->buffers);
+    free(file->buffer_data);
+    free(file->dictionary_blocks);
+    free(file->batch_blocks);
+    free(file);
+    return status;
+}
+
+// the field is there in the current row
+static void
+arrow_set_valid(arrow_column_t *column, uint32_t row)
+{
+    uint8_t bit = 1 << (row & 7);
+    if ((column->validity[row >> 3] & bit) == 0){
+        column->validity[row >> 3] |= bit;
+        column->valid_count++;
+    }
+}
+
+/**
+ * @brief Set an integer (or timestamp) field of the current row
+ *
+ * @param file
+ * @param column
+ * @param value
+ */
+void
+arrow_file_set_uint(arrow_file_t *file, int column, uint64_t value)
+{
+    arrow_column_t *c = &file->columns[column];
+    uint32_t row = file->rows;
+    switch (c->field.type){
+        case ARROW_UINT8:
+            c->values[row] = value;
+            break;
+        case ARROW_UINT16: {
+            uint16_t v = value;
+            memcpy(c->values + row * sizeof(v), &v, sizeof(v));
+            break;
+        }
+        case ARROW_UINT32: {
+            uint32_t v = value;
+            memcpy(c->values + row * sizeof(v), &v, sizeof(v));
+            break;
+        }
+        case ARROW_UINT64:
+        case ARROW_TIMESTAMP_US:
+            memcpy(c->values + row * sizeof(value), &value, sizeof(value));
+            break;
+        case ARROW_BOOL:
+            arrow_file_set_bool(file, column, value != 0);
+            return;
+        default:
+            return;
+    }
+    arrow_set_valid(c, row);
+}
+
+void
+arrow_file_set_bool(arrow_file_t *file, int column, bool value)
+{
+    arrow_column_t *c = &file->columns[column];
+    uint32_t row = file->rows;
+    uint8_t bit = 1 << (row & 7);
+    if (value){
+        c->values[row >> 3] |= bit;
+    } else {
+        c->values[row >> 3] &= ~bit;
+    }
+    arrow_set_valid(c, row);
+}
+
+/**
+ * @brief Set a string field of the current row, through the
+ * column's dictionary
+ *
+ * @param file
+ * @param column
+ * @param string
+ * @param length
+ */
+void
+arrow_file_set_string(arrow_file_t *file, int column, const char *string, size_t length)
+{
+    arrow_column_t *c = &file->columns[column];
+    int32_t index = arrow_dictionary_index(&c->dictionary, string, length);
+    memcpy(c->values + file->rows * sizeof(index), &index, sizeof(index));
+    arrow_set_valid(c, file->rows);
+}
+
+// next row, the batch is written when full
+void
+arrow_file_end_row(arrow_file_t *file)
+{
+    file->rows++;
+    if (file->rows == file->batch_rows){
+        arrow_file_flush_batch(file);
+    }
+}
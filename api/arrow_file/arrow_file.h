@@ -0,0 +1,134 @@
+#ifndef ARROW_FILE_H
+#define ARROW_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "output_sink.h"
+#include "flatbuffer.h"
+
+/*
+Columnar export in the Arrow IPC file format (what pyarrow, polars, DuckDB
+read as .arrow / .feather v2).
+
+Rows are filled one field at a time into fixed size column batches; when a
+batch holds batch_rows rows it is written out as one record batch and the
+columns start over, so memory stays bounded by the batch size. Fields that
+are not set in a row are null.
+
+Strings are dictionary encoded: the columns hold int32 indices, the strings
+themselves are written once, in dictionary batches (deltas) that come right
+before the record batch that first uses them.
+
+    "ARROW1\0\0"
+    schema message
+    [dictionary deltas] record batch   (once per batch)
+    end of stream marker
+    footer, footer size, "ARROW1"
+
+Every message is the 0xffffffff continuation marker, the size of the
+flatbuffer metadata, the metadata and the body (the column buffers, each
+padded to 8 bytes).
+*/
+
+#define ARROW_FILE_BATCH_ROWS 65536
+#define ARROW_FILE_ERRBUF_SIZE 256
+#define ARROW_FILE_MAGIC "ARROW1"
+#define ARROW_FILE_ALIGNMENT 8
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum arrow_type {
+    ARROW_UINT8,
+    ARROW_UINT16,
+    ARROW_UINT32,
+    ARROW_UINT64,
+    ARROW_BOOL,
+    ARROW_TIMESTAMP_US,      // int64 microseconds since the epoch, UTC
+    ARROW_STRING_DICTIONARY  // utf8, int32 indices into a dictionary
+} arrow_type_t;
+
+typedef struct arrow_field {
+    const char *name;
+    arrow_type_t type;
+} arrow_field_t;
+
+// append only, so indices stay valid from one batch to the next
+typedef struct arrow_dictionary {
+    int32_t *offsets;        // count + 1 of them
+    uint32_t count;
+    uint32_t offsets_capacity;
+    char *data;
+    size_t data_length;
+    size_t data_capacity;
+
+    uint32_t *slots;         // hash table of index + 1, 0 is empty
+    uint32_t slot_count;     // power of two
+    uint32_t written;        // entries already in the file
+} arrow_dictionary_t;
+
+typedef struct arrow_column {
+    arrow_field_t field;
+    uint8_t *validity;       // one bit per row
+    uint8_t *values;
+    uint32_t valid_count;    // in the current batch
+    arrow_dictionary_t dictionary;
+} arrow_column_t;
+
+// the Buffer and FieldNode structs of the metadata
+typedef struct arrow_buffer {
+    int64_t offset;          // in the message body
+    int64_t length;
+} arrow_buffer_t;
+
+typedef struct arrow_field_node {
+    int64_t length;
+    int64_t null_count;
+} arrow_field_node_t;
+
+// where a message is in the file, for the footer
+typedef struct arrow_block {
+    int64_t offset;
+    int32_t metadata_length;
+    int32_t padding;
+    int64_t body_length;
+} arrow_block_t;
+
+typedef struct arrow_file {
+    output_sink_t out;
+    uint64_t offset;         // of the next byte written
+
+    arrow_column_t *columns;
+    int column_count;
+    uint32_t batch_rows;
+    uint32_t rows;           // in the current batch
+
+    arrow_block_t *dictionary_blocks;
+    size_t dictionary_block_count;
+    size_t dictionary_block_capacity;
+    arrow_block_t *batch_blocks;
+    size_t batch_block_count;
+    size_t batch_block_capacity;
+
+    fb_builder_t builder;    // metadata of the message being written
+    arrow_field_node_t *nodes;
+    arrow_buffer_t *buffers;
+    const void **buffer_data;
+} arrow_file_t;
+
+arrow_file_t* arrow_file_create(const char *path, const arrow_field_t *fields, int field_count, uint32_t batch_rows, char *errbuf);
+int arrow_file_close(arrow_file_t *file);
+
+void arrow_file_set_uint(arrow_file_t *file, int column, uint64_t value);
+void arrow_file_set_bool(arrow_file_t *file, int column, bool value);
+void arrow_file_set_string(arrow_file_t *file, int column, const char *string, size_t length);
+void arrow_file_end_row(arrow_file_t *file);
+void arrow_file_flush_batch(arrow_file_t *file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
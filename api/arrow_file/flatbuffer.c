@@ -0,0 +1,271 @@
+#include "flatbuffer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// scalars are copied as they are in memory
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "the flatbuffer builder only runs on little-endian hosts"
+#endif
+
+/**
+ * @brief Set up an empty builder
+ *
+ * @param fb
+ * @param capacity initial size, grows as needed
+ */
+void
+fb_init(fb_builder_t *fb, size_t capacity)
+{
+    fb->capacity = capacity > 0 ? capacity : 1024;
+    fb->data = malloc(fb->capacity);
+    if (fb->data == NULL){
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    fb_reset(fb);
+}
+
+void
+fb_destroy(fb_builder_t *fb)
+{
+    free(fb->data);
+    fb->data = NULL;
+    fb->capacity = 0;
+    fb->size = 0;
+}
+
+// start a new buffer, keeping the memory
+void
+fb_reset(fb_builder_t *fb)
+{
+    fb->size = 0;
+    fb->min_align = 1;
+    fb->table_start = 0;
+    fb->field_count = 0;
+}
+
+/**
+ * @brief Make room for length more bytes in front of what is written,
+ * the content moves to the end of the larger buffer
+ *
+ * @param fb
+ * @param length
+ */
+static void
+fb_grow(fb_builder_t *fb, size_t length)
+{
+    if (fb->size + length <= fb->capacity){
+        return;
+    }
+    size_t capacity = fb->capacity * 2;
+    while (capacity < fb->size + length){
+        capacity *= 2;
+    }
+    uint8_t *data = malloc(capacity);
+    if (data == NULL){
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(data + capacity - fb->size, fb->data + fb->capacity - fb->size, fb->size);
+    free(fb->data);
+    fb->data = data;
+    fb->capacity = capacity;
+}
+
+static void
+fb_push(fb_builder_t *fb, const void *bytes, size_t length)
+{
+    fb_grow(fb, length);
+    fb->size += length;
+    memcpy(fb->data + fb->capacity - fb->size, bytes, length);
+}
+
+/**
+ * @brief Pad so that, once additional bytes are written, the buffer
+ * is aligned on align (a power of two)
+ *
+ * @param fb
+ * @param align
+ * @param additional
+ */
+static void
+fb_prep(fb_builder_t *fb, size_t align, size_t additional)
+{
+    if (align > fb->min_align){
+        fb->min_align = align;
+    }
+    size_t padding = (0 - (fb->size + additional)) & (align - 1);
+    fb_grow(fb, padding);
+    fb->size += padding;
+    memset(fb->data + fb->capacity - fb->size, 0, padding);
+}
+
+static void
+fb_push_uint32(fb_builder_t *fb, uint32_t value)
+{
+    fb_prep(fb, sizeof(value), 0);
+    fb_push(fb, &value, sizeof(value));
+}
+
+static void
+fb_push_uint16(fb_builder_t *fb, uint16_t value)
+{
+    fb_prep(fb, sizeof(value), 0);
+    fb_push(fb, &value, sizeof(value));
+}
+
+// a reference to target, written where the builder stands
+static void
+fb_push_offset(fb_builder_t *fb, fb_offset_t target)
+{
+    fb_prep(fb, sizeof(uint32_t), 0);
+    fb_push_uint32(fb, fb->size + sizeof(uint32_t) - target);
+}
+
+fb_offset_t
+fb_create_string(fb_builder_t *fb, const char *string)
+{
+    size_t length = strlen(string);
+    fb_prep(fb, sizeof(uint32_t), length + 1);
+    fb_push(fb, string, length + 1);
+    fb_push_uint32(fb, length);
+    return fb->size;
+}
+
+/**
+ * @brief A vector of structs, data holds them in order, already laid out
+ * as in the schema (little-endian, padded)
+ *
+ * @param fb
+ * @param data
+ * @param count
+ * @param element_size
+ * @param align of the struct
+ * @return fb_offset_t
+ */
+fb_offset_t
+fb_create_struct_vector(fb_builder_t *fb, const void *data, size_t count, size_t element_size, size_t align)
+{
+    size_t length = count * element_size;
+    fb_prep(fb, sizeof(uint32_t), length);
+    fb_prep(fb, align, length);
+    fb_push(fb, data, length);
+    fb_push_uint32(fb, count);
+    return fb->size;
+}
+
+fb_offset_t
+fb_create_offset_vector(fb_builder_t *fb, const fb_offset_t *offsets, size_t count)
+{
+    fb_prep(fb, sizeof(uint32_t), count * sizeof(uint32_t));
+    for (size_t i = count; i > 0; i--){
+        fb_push_offset(fb, offsets[i - 1]);
+    }
+    fb_push_uint32(fb, count);
+    return fb->size;
+}
+
+void
+fb_start_table(fb_builder_t *fb)
+{
+    memset(fb->fields, 0, sizeof(fb->fields));
+    fb->field_count = 0;
+    fb->table_start = fb->size;
+}
+
+static void
+fb_add_scalar(fb_builder_t *fb, int id, const void *value, size_t size)
+{
+    if (id >= FB_MAX_FIELDS){
+        fprintf(stderr, "flatbuffer: field %d out of range\n", id);
+        exit(EXIT_FAILURE);
+    }
+    fb_prep(fb, size, 0);
+    fb_push(fb, value, size);
+    fb->fields[id] = fb->size;
+    if (id >= fb->field_count){
+        fb->field_count = id + 1;
+    }
+}
+
+void
+fb_add_bool(fb_builder_t *fb, int id, bool value)
+{
+    uint8_t byte = value ? 1 : 0;
+    fb_add_scalar(fb, id, &byte, sizeof(byte));
+}
+
+void
+fb_add_uint8(fb_builder_t *fb, int id, uint8_t value)
+{
+    fb_add_scalar(fb, id, &value, sizeof(value));
+}
+
+void
+fb_add_int16(fb_builder_t *fb, int id, int16_t value)
+{
+    fb_add_scalar(fb, id, &value, sizeof(value));
+}
+
+void
+fb_add_int32(fb_builder_t *fb, int id, int32_t value)
+{
+    fb_add_scalar(fb, id, &value, sizeof(value));
+}
+
+void
+fb_add_int64(fb_builder_t *fb, int id, int64_t value)
+{
+    fb_add_scalar(fb, id, &value, sizeof(value));
+}
+
+void
+fb_add_offset(fb_builder_t *fb, int id, fb_offset_t offset)
+{
+    uint32_t relative;
+    fb_prep(fb, sizeof(relative), 0);
+    relative = fb->size + sizeof(relative) - offset;
+    fb_add_scalar(fb, id, &relative, sizeof(relative));
+}
+
+/**
+ * @brief Close the table: its vtable is written right in front of it
+ *
+ * @param fb
+ * @return fb_offset_t the table
+ */
+fb_offset_t
+fb_end_table(fb_builder_t *fb)
+{
+    // soffset to the vtable, patched below
+    fb_push_uint32(fb, 0);
+    fb_offset_t table = fb->size;
+
+    for (int i = fb->field_count; i > 0; i--){
+        fb_offset_t field = fb->fields[i - 1];
+        fb_push_uint16(fb, field != 0 ? table - field : 0);
+    }
+    fb_push_uint16(fb, table - fb->table_start);
+    fb_push_uint16(fb, (fb->field_count + 2) * sizeof(uint16_t));
+    fb_offset_t vtable = fb->size;
+
+    int32_t soffset = vtable - table;
+    memcpy(fb->data + fb->capacity - table, &soffset, sizeof(soffset));
+    return table;
+}
+
+// write the root offset, the buffer is complete
+void
+fb_finish(fb_builder_t *fb, fb_offset_t root)
+{
+    fb_prep(fb, fb->min_align, sizeof(uint32_t));
+    fb_push_offset(fb, root);
+}
+
+const uint8_t*
+fb_data(const fb_builder_t *fb)
+{
+    return fb->data + fb->capacity - fb->size;
+}
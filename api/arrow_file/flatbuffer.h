@@ -0,0 +1,62 @@
+#ifndef FLATBUFFER_H
+#define FLATBUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Just enough of a FlatBuffers builder to write the Arrow IPC metadata.
+
+Like the reference builder, the buffer is filled from the end towards the
+front: children are written before the tables pointing at them, and every
+object is known by its distance from the end of the buffer (fb_offset_t).
+Only one table can be under construction at a time.
+
+    fb_offset_t name = fb_create_string(&fb, "ts");
+    fb_start_table(&fb);
+    fb_add_offset(&fb, 0, name);
+    fb_add_bool(&fb, 1, true);
+    fb_offset_t field = fb_end_table(&fb);
+    fb_finish(&fb, root);
+
+Fields are always written, defaults included.
+*/
+
+#define FB_MAX_FIELDS 16
+
+typedef uint32_t fb_offset_t;
+
+typedef struct fb_builder {
+    uint8_t *data;
+    size_t capacity;
+    size_t size;        // bytes used, at the end of data
+    size_t min_align;
+
+    // table under construction
+    size_t table_start;
+    fb_offset_t fields[FB_MAX_FIELDS]; // 0 when absent
+    int field_count;
+} fb_builder_t;
+
+void fb_init(fb_builder_t *fb, size_t capacity);
+void fb_destroy(fb_builder_t *fb);
+void fb_reset(fb_builder_t *fb);
+
+fb_offset_t fb_create_string(fb_builder_t *fb, const char *string);
+fb_offset_t fb_create_struct_vector(fb_builder_t *fb, const void *data, size_t count, size_t element_size, size_t align);
+fb_offset_t fb_create_offset_vector(fb_builder_t *fb, const fb_offset_t *offsets, size_t count);
+
+void fb_start_table(fb_builder_t *fb);
+void fb_add_bool(fb_builder_t *fb, int id, bool value);
+void fb_add_uint8(fb_builder_t *fb, int id, uint8_t value);
+void fb_add_int16(fb_builder_t *fb, int id, int16_t value);
+void fb_add_int32(fb_builder_t *fb, int id, int32_t value);
+void fb_add_int64(fb_builder_t *fb, int id, int64_t value);
+void fb_add_offset(fb_builder_t *fb, int id, fb_offset_t offset);
+fb_offset_t fb_end_table(fb_builder_t *fb);
+
+void fb_finish(fb_builder_t *fb, fb_offset_t root);
+const uint8_t* fb_data(const fb_builder_t *fb);
+
+#endif
@@ -0,0 +1,144 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arrow_file.h"
+
+const arrow_field_t test_fields[] = {
+    {"ts", ARROW_TIMESTAMP_US},
+    {"port", ARROW_UINT16},
+    {"syn", ARROW_BOOL},
+    {"host", ARROW_STRING_DICTIONARY}
+};
+#define TEST_FIELD_COUNT 4
+
+uint8_t*
+read_file(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    assert(f != NULL);
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = malloc(*size);
+    assert(fread(data, 1, *size, f) == *size);
+    fclose(f);
+    return data;
+}
+
+uint32_t
+read_uint32(const uint8_t *data)
+{
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+void
+add_row(arrow_file_t *file, uint64_t ts, int port, int syn, const char *host)
+{
+    arrow_file_set_uint(file, 0, ts);
+    if (port >= 0){
+        arrow_file_set_uint(file, 1, port);
+    }
+    if (syn >= 0){
+        arrow_file_set_bool(file, 2, syn);
+    }
+    if (host != NULL){
+        arrow_file_set_string(file, 3, host, strlen(host));
+    }
+    arrow_file_end_row(file);
+}
+
+void
+test_columns()
+{
+    const char *path = "test_arrow_file_columns.arrow";
+    char errbuf[ARROW_FILE_ERRBUF_SIZE];
+    arrow_file_t *file = arrow_file_create(path, test_fields, TEST_FIELD_COUNT, 16, errbuf);
+    assert(file != NULL);
+
+    add_row(file, 1, 53, 1, "a");
+    add_row(file, 2, -1, 0, "b");
+    add_row(file, 3, 80, -1, "a");
+    add_row(file, 4, 443, 1, NULL);
+    assert(file->rows == 4);
+
+    // repeated strings share their index
+    int32_t *host = (int32_t*)file->columns[3].values;
+    assert(host[0] == 0 && host[1] == 1 && host[2] == 0);
+    assert(file->columns[3].dictionary.count == 2);
+    assert(file->columns[3].valid_count == 3);
+
+    uint16_t *port = (uint16_t*)file->columns[1].values;
+    assert(port[0] == 53 && port[2] == 80 && port[3] == 443);
+    assert(file->columns[1].valid_count == 3);
+    assert(file->columns[1].validity[0] == 0x0d);
+
+    // syn: true, false, null, true
+    assert(file->columns[2].validity[0] == 0x0b);
+    assert(file->columns[2].values[0] == 0x09);
+
+    assert(arrow_file_close(file) == 0);
+    remove(path);
+}
+
+void
+test_batches()
+{
+    const char *path = "test_arrow_file_batches.arrow";
+    char errbuf[ARROW_FILE_ERRBUF_SIZE];
+    arrow_file_t *file = arrow_file_create(path, test_fields, TEST_FIELD_COUNT, 2, errbuf);
+    assert(file != NULL);
+
+    add_row(file, 1, 1, 1, "a");
+    add_row(file, 2, 2, 1, "a");
+    // full batch written, its dictionary first
+    assert(file->rows == 0);
+    assert(file->batch_block_count == 1);
+    assert(file->dictionary_block_count == 1);
+
+    add_row(file, 3, 3, 0, "a");
+    add_row(file, 4, 4, 0, "a");
+    // nothing new in the dictionary, no delta
+    assert(file->batch_block_count == 2);
+    assert(file->dictionary_block_count == 1);
+
+    add_row(file, 5, 5, 0, "b");
+    assert(arrow_file_close(file) == 0);
+
+    size_t size;
+    uint8_t *data = read_file(path, &size);
+    assert(memcmp(data, "ARROW1\0\0", 8) == 0);
+    assert(memcmp(data + size - 6, "ARROW1", 6) == 0);
+    // first message: the schema
+    assert(read_uint32(data + 8) == 0xffffffff);
+    assert(read_uint32(data + 12) % ARROW_FILE_ALIGNMENT == 0);
+
+    // footer, with the end of stream marker in front of it
+    uint32_t footer_length = read_uint32(data + size - 10);
+    size_t footer = size - 10 - footer_length;
+    assert(footer % ARROW_FILE_ALIGNMENT == 0);
+    assert(read_uint32(data + footer - 8) == 0xffffffff);
+    assert(read_uint32(data + footer - 4) == 0);
+    free(data);
+    remove(path);
+}
+
+void
+test_create_fails()
+{
+    char errbuf[ARROW_FILE_ERRBUF_SIZE] = {0};
+    arrow_file_t *file = arrow_file_create("does/not/exist.arrow", test_fields, TEST_FIELD_COUNT, 0, errbuf);
+    assert(file == NULL);
+    assert(strstr(errbuf, "does/not/exist.arrow") != NULL);
+}
+
+int
+main()
+{
+    test_columns();
+    test_batches();
+    test_create_fails();
+    return 0;
+}
@@ -0,0 +1,403 @@
+#include "packet_ring.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+
+#define VLAN_TAG_LENGTH 4
+
+static struct tpacket_block_desc*
+block_at(const packet_ring_t *ring, uint32_t index)
+{
+    return (struct tpacket_block_desc*)(ring->data + (size_t)index * ring->block_size);
+}
+
+/**
+ * @brief Fill errbuf with the failed call and errno, close the socket
+ *
+ * @param fd
+ * @param device
+ * @param call
+ * @param errbuf
+ * @return packet_ring_t* always NULL
+ */
+static packet_ring_t*
+open_failed(int fd, const char *device, const char *call, char *errbuf)
+{
+    snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: %s: %s", device, call, strerror(errno));
+    if (fd != -1){
+        close(fd);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Create the socket and its TPACKET_V3 ring on a device.
+ * Returns NULL and fills errbuf if the device can't be read natively,
+ * in which case the caller should fall back to pcap_open_live()
+ *
+ * @param device
+ * @param block_size PACKET_RING_BLOCK_SIZE if 0
+ * @param block_count PACKET_RING_BLOCK_COUNT if 0
+ * @param errbuf
+ * @return packet_ring_t*
+ */
+packet_ring_t*
+packet_ring_open(const char *device, uint32_t block_size, uint32_t block_count, char *errbuf)
+{
+    block_size = block_size > 0 ? block_size : PACKET_RING_BLOCK_SIZE;
+    block_count = block_count > 0 ? block_count : PACKET_RING_BLOCK_COUNT;
+    if (block_size % getpagesize() != 0 || block_size % PACKET_RING_FRAME_SIZE != 0){
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "block size %u isn't a multiple of the page size (%d) and of %d",
+            block_size, getpagesize(), PACKET_RING_FRAME_SIZE);
+        return NULL;
+    }
+
+    int ifindex = if_nametoindex(device);
+    if (ifindex == 0){
+        return open_failed(-1, device, "if_nametoindex", errbuf);
+    }
+
+    // protocol 0: nothing is queued until the bind
+    int fd = socket(AF_PACKET, SOCK_RAW, 0);
+    if (fd == -1){
+        return open_failed(fd, device, "socket", errbuf);
+    }
+
+    struct ifreq ifr = {0};
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", device);
+    if (ioctl(fd, SIOCGIFHWADDR, &ifr) == -1){
+        return open_failed(fd, device, "SIOCGIFHWADDR", errbuf);
+    }
+    if (ifr.ifr_hwaddr.sa_family != ARPHRD_ETHER && ifr.ifr_hwaddr.sa_family != ARPHRD_LOOPBACK){
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: unsupported link type %d", device, ifr.ifr_hwaddr.sa_family);
+        close(fd);
+        return NULL;
+    }
+
+    int version = TPACKET_V3;
+    if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) == -1){
+        return open_failed(fd, device, "PACKET_VERSION", errbuf);
+    }
+    // room in front of every frame to put the VLAN tag back
+    int reserve = VLAN_TAG_LENGTH;
+    if (setsockopt(fd, SOL_PACKET, PACKET_RESERVE, &reserve, sizeof(reserve)) == -1){
+        return open_failed(fd, device, "PACKET_RESERVE", errbuf);
+    }
+
+    struct tpacket_req3 request = {0};
+    request.tp_block_size = block_size;
+    request.tp_block_nr = block_count;
+    request.tp_frame_size = PACKET_RING_FRAME_SIZE;
+    request.tp_frame_nr = (block_size / PACKET_RING_FRAME_SIZE) * block_count;
+    request.tp_retire_blk_tov = PACKET_RING_TIMEOUT_MS;
+    if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &request, sizeof(request)) == -1){
+        return open_failed(fd, device, "PACKET_RX_RING", errbuf);
+    }
+
+    size_t size = (size_t)block_size * block_count;
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED){
+        return open_failed(fd, device, "mmap", errbuf);
+    }
+
+    // like pcap_open_live(..., promisc = 1, ...), undone by the kernel on close
+    struct packet_mreq membership = {0};
+    membership.mr_ifindex = ifindex;
+    membership.mr_type = PACKET_MR_PROMISC;
+    if (setsockopt(fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &membership, sizeof(membership)) == -1){
+        munmap(data, size);
+        return open_failed(fd, device, "PACKET_ADD_MEMBERSHIP", errbuf);
+    }
+
+    packet_ring_t *ring = (packet_ring_t*)calloc(1, sizeof(packet_ring_t));
+    if (ring == NULL){
+        fprintf(stderr, "Failed to allocate memory for packet_ring\n");
+        exit(EXIT_FAILURE);
+    }
+    ring->fd = fd;
+    ring->ifindex = ifindex;
+    ring->data = (uint8_t*)data;
+    ring->size = size;
+    ring->block_size = block_size;
+    ring->block_count = block_count;
+    return ring;
+}
+
+// start receiving, every protocol of the interface
+static int
+packet_ring_bind(packet_ring_t *ring)
+{
+    struct sockaddr_ll address = {0};
+    address.sll_family = AF_PACKET;
+    address.sll_protocol = htons(ETH_P_ALL);
+    address.sll_ifindex = ring->ifindex;
+    if (bind(ring->fd, (struct sockaddr*)&address, sizeof(address)) == -1){
+        perror("bind");
+        return -1;
+    }
+    ring->bound = true;
+    return 0;
+}
+
+/**
+ * @brief Wait for the kernel to hand the next block over
+ *
+ * @param ring
+ * @param block
+ * @param timeout_ms -1 to wait for ever
+ * @return int 1 if a block is ready, 0 on timeout or signal, -1 on error
+ */
+int
+packet_ring_next_block(packet_ring_t *ring, packet_ring_block_t *block, int timeout_ms)
+{
+    if (!ring->bound && packet_ring_bind(ring) == -1){
+        return -1;
+    }
+
+    struct tpacket_block_desc *desc = block_at(ring, ring->current_block);
+    while ((__atomic_load_n(&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0){
+        struct pollfd pfd = {ring->fd, POLLIN | POLLERR, 0};
+        int ready = poll(&pfd, 1, timeout_ms);
+        if (ready == -1){
+            if (errno == EINTR){
+                return 0;
+            }
+            perror("poll");
+            return -1;
+        }
+        if (ready == 0){
+            return 0;
+        }
+        if (pfd.revents & POLLERR){
+            // the interface went down or away
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(ring->fd, SOL_SOCKET, SO_ERROR, &error, &length);
+            fprintf(stderr, "Capture error: %s.\n", strerror(error));
+            return -1;
+        }
+    }
+
+    block->start = (uint8_t*)desc;
+    block->packet_count = desc->hdr.bh1.num_pkts;
+    block->packets_left = block->packet_count;
+    block->next_packet = (uint8_t*)desc + desc->hdr.bh1.offset_to_first_pkt;
+    ring->blocks_read++;
+    return 1;
+}
+
+/**
+ * @brief Get the next packet of a block, the packet points into the ring
+ * and stays valid until the block is released
+ *
+ * @param ring
+ * @param block
+ * @param header
+ * @param packet
+ * @return true, false when the block has been walked
+ */
+bool
+packet_ring_block_next(packet_ring_t *ring, packet_ring_block_t *block, struct pcap_pkthdr **header, const u_char **packet)
+{
+    if (block->packets_left == 0){
+        return false;
+    }
+    struct tpacket3_hdr *frame = (struct tpacket3_hdr*)block->next_packet;
+    uint8_t *data = (uint8_t*)frame + frame->tp_mac;
+
+    ring->header.ts.tv_sec = frame->tp_sec;
+    ring->header.ts.tv_usec = frame->tp_nsec / 1000;
+    ring->header.caplen = frame->tp_snaplen;
+    ring->header.len = frame->tp_len;
+
+    if ((frame->tp_status & TP_STATUS_VLAN_VALID) && frame->tp_snaplen >= 2 * ETH_ALEN){
+        // put the tag back between the addresses and the type,
+        // in the room reserved by PACKET_RESERVE
+        uint16_t tpid = (frame->tp_status & TP_STATUS_VLAN_TPID_VALID) ? frame->hv1.tp_vlan_tpid : ETH_P_8021Q;
+        uint16_t tci = frame->hv1.tp_vlan_tci;
+        data -= VLAN_TAG_LENGTH;
+        memmove(data, data + VLAN_TAG_LENGTH, 2 * ETH_ALEN);
+        data[12] = tpid >> 8;
+        data[13] = tpid & 0xff;
+        data[14] = tci >> 8;
+        data[15] = tci & 0xff;
+        ring->header.caplen += VLAN_TAG_LENGTH;
+        ring->header.len += VLAN_TAG_LENGTH;
+    }
+
+    block->next_packet = (uint8_t*)frame + frame->tp_next_offset;
+    block->packets_left--;
+    ring->packets_read++;
+    *header = &ring->header;
+    *packet = data;
+    return true;
+}
+
+/**
+ * @brief Give the block back to the kernel, its packets can't be used anymore
+ *
+ * @param ring
+ * @param block
+ */
+void
+packet_ring_release_block(packet_ring_t *ring, packet_ring_block_t *block)
+{
+    struct tpacket_block_desc *desc = (struct tpacket_block_desc*)block->start;
+    __atomic_store_n(&desc->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+    block->start = NULL;
+    ring->current_block = (ring->current_block + 1) % ring->block_count;
+}
+
+/**
+ * @brief Same contract as pcap_loop(): call the callback for every packet,
+ * a block at a time, count <= 0 means until stopped
+ *
+ * @param ring
+ * @param count
+ * @param callback
+ * @param user
+ * @return int 0 when count packets were read, -1 on error, -2 if stopped by packet_ring_breakloop()
+ */
+int
+packet_ring_loop(packet_ring_t *ring, int count, pcap_handler callback, u_char *user)
+{
+    struct pcap_pkthdr *header;
+    const u_char *packet;
+    int processed = 0;
+
+    while (count <= 0 || processed < count){
+        if (ring->break_loop){
+            ring->break_loop = false;
+            return -2;
+        }
+
+        if (!ring->holding){
+            int status = packet_ring_next_block(ring, &ring->pending, PACKET_RING_TIMEOUT_MS);
+            if (status == -1){
+                return -1;
+            }
+            if (status == 0){
+                continue;
+            }
+            ring->holding = true;
+        }
+
+        if (!packet_ring_block_next(ring, &ring->pending, &header, &packet)){
+            packet_ring_release_block(ring, &ring->pending);
+            ring->holding = false;
+            continue;
+        }
+
+        callback(user, header, packet);
+        processed++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Run a compiled BPF filter in the kernel, in front of the ring.
+ * The kernel keeps its own copy, the program is freed
+ *
+ * @param ring
+ * @param filter
+ * @param errbuf
+ * @return int 0, -1 if the kernel refused it
+ */
+int
+packet_ring_setfilter(packet_ring_t *ring, struct bpf_program *filter, char *errbuf)
+{
+    struct sock_fprog program;
+    program.len = filter->bf_len;
+    program.filter = (struct sock_filter*)filter->bf_insns;
+    int status = setsockopt(ring->fd, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program));
+    if (status == -1){
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "SO_ATTACH_FILTER: %s", strerror(errno));
+    }
+    pcap_freecode(filter);
+    return status;
+}
+
+/**
+ * @brief Share the device's packets with the other rings of group,
+ * by flow. Binds the socket, set the filter first
+ *
+ * @param ring
+ * @param group any id, the same for every ring of the group
+ * @param errbuf
+ * @return int 0, -1 if the kernel refused
+ */
+int
+packet_ring_join_fanout(packet_ring_t *ring, uint16_t group, char *errbuf)
+{
+    if (!ring->bound && packet_ring_bind(ring) == -1){
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "bind: %s", strerror(errno));
+        return -1;
+    }
+    // the hash is symmetric; fragments are reassembled first so they follow their flow
+    int fanout = group | ((PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG) << 16);
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) == -1){
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "PACKET_FANOUT: %s", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief The kernel counters since the ring was opened
+ *
+ * @param ring
+ * @param stats
+ * @return int 0, -1 if they can't be read
+ */
+int
+packet_ring_stats(packet_ring_t *ring, packet_ring_stats_t *stats)
+{
+    struct tpacket_stats_v3 kernel_stats;
+    socklen_t length = sizeof(kernel_stats);
+    if (getsockopt(ring->fd, SOL_PACKET, PACKET_STATISTICS, &kernel_stats, &length) == -1){
+        return -1;
+    }
+    // reset by every read
+    ring->stats.received += kernel_stats.tp_packets;
+    ring->stats.dropped += kernel_stats.tp_drops;
+    ring->stats.freezes += kernel_stats.tp_freeze_q_cnt;
+    *stats = ring->stats;
+    return 0;
+}
+
+/**
+ * @brief Stop packet_ring_loop() after the current packet (signal safe)
+ *
+ * @param ring
+ */
+void
+packet_ring_breakloop(packet_ring_t *ring)
+{
+    ring->break_loop = true;
+}
+
+/**
+ * @brief Unmap the ring, close the socket and free the reader
+ *
+ * @param ring
+ */
+void
+packet_ring_close(packet_ring_t *ring)
+{
+    if (ring == NULL){
+        return;
+    }
+    munmap(ring->data, ring->size);
+    close(ring->fd);
+    free(ring);
+}
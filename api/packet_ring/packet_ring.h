@@ -0,0 +1,104 @@
+#ifndef PACKET_RING_H
+#define PACKET_RING_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pcap.h>
+
+/*
+Live capture straight out of a TPACKET_V3 ring shared with the kernel.
+
+The AF_PACKET socket and its receive ring are set up once, mapped in our
+address space, and the kernel writes the packets into it: no recvfrom() and
+no copy per packet. A V3 ring is made of blocks holding several packets each,
+the kernel hands a block over (TP_STATUS_USER) when it is full or after
+PACKET_RING_TIMEOUT_MS, and we give it back (TP_STATUS_KERNEL) once every
+packet in it has been parsed:
+
+    +---------------------------+---------------------------+----
+    | block 0                   | block 1                   | ...
+    | desc | pkt | pkt | pkt .. | desc | pkt | pkt ..       |
+    +---------------------------+---------------------------+----
+       ^ us                        ^ kernel
+
+Only Ethernet and loopback devices are read natively, anything else is
+reported as unsupported so the caller can fall back to pcap_open_live().
+
+The socket is bound to the interface on the first read, after
+packet_ring_setfilter(), so the kernel never queues a packet the filter
+would have dropped. The kernel strips VLAN tags, they are put back in front
+of the type like libpcap does.
+
+The kernel counters (PACKET_STATISTICS) are reset every time they are read,
+packet_ring_stats() accumulates them.
+
+Several rings on the same device can join a PACKET_FANOUT group: the kernel
+then spreads the packets between them on a symmetric hash of the flow, both
+directions of a connection always land in the same ring.
+*/
+
+#define PACKET_RING_BLOCK_SIZE (1 << 22) // 4 MB, a multiple of the page size
+#define PACKET_RING_BLOCK_COUNT 64
+#define PACKET_RING_FRAME_SIZE 2048 // only a hint for V3, sizes the ring
+#define PACKET_RING_TIMEOUT_MS 100 // a block is handed over at least that often
+#define PACKET_RING_SNAPLEN 65535
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct packet_ring_stats {
+    uint64_t received;  // by the socket, dropped ones included
+    uint64_t dropped;   // the ring was full
+    uint64_t freezes;   // times the kernel found no free block
+} packet_ring_stats_t;
+
+// the packets of one block, walked with packet_ring_block_next()
+typedef struct packet_ring_block {
+    uint8_t *start;
+    uint32_t packet_count;
+    uint32_t packets_left;
+    uint8_t *next_packet;
+} packet_ring_block_t;
+
+typedef struct packet_ring {
+    int fd;
+    int ifindex;
+    bool bound;
+    uint8_t *data;            // start of the mapping
+    size_t size;              // size of the mapping
+    uint32_t block_size;
+    uint32_t block_count;
+    uint32_t current_block;   // next block to look at
+
+    struct pcap_pkthdr header; // header of the last returned packet
+    uint64_t packets_read;
+    uint64_t blocks_read;
+
+    // packet_ring_loop(): the block being walked, kept across calls
+    packet_ring_block_t pending;
+    bool holding;
+
+    packet_ring_stats_t stats;
+    volatile bool break_loop;
+} packet_ring_t;
+
+packet_ring_t* packet_ring_open(const char *device, uint32_t block_size, uint32_t block_count, char *errbuf);
+int packet_ring_next_block(packet_ring_t *ring, packet_ring_block_t *block, int timeout_ms);
+bool packet_ring_block_next(packet_ring_t *ring, packet_ring_block_t *block, struct pcap_pkthdr **header, const u_char **packet);
+void packet_ring_release_block(packet_ring_t *ring, packet_ring_block_t *block);
+int packet_ring_loop(packet_ring_t *ring, int count, pcap_handler callback, u_char *user);
+int packet_ring_setfilter(packet_ring_t *ring, struct bpf_program *filter, char *errbuf);
+int packet_ring_join_fanout(packet_ring_t *ring, uint16_t group, char *errbuf);
+int packet_ring_stats(packet_ring_t *ring, packet_ring_stats_t *stats);
+void packet_ring_breakloop(packet_ring_t *ring);
+void packet_ring_close(packet_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,280 @@
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "packet_ring.h"
+
+/*
+Captures on the loopback the datagrams it sends itself. Needs CAP_NET_RAW,
+reported as skipped (77) without it.
+*/
+
+#define TEST_SKIPPED 77
+#define TEST_PORT 47001
+#define TEST_OTHER_PORT 47002
+#define TEST_PAYLOAD "pcapna packet_ring"
+#define TEST_FRAME_LENGTH (14 + 20 + 8 + sizeof(TEST_PAYLOAD))
+
+int receiver = -1;
+
+void
+send_datagrams(uint16_t port, int count)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    assert(fd != -1);
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int i = 0; i < count; i++){
+        assert(sendto(fd, TEST_PAYLOAD, sizeof(TEST_PAYLOAD), 0, (struct sockaddr*)&address, sizeof(address)) != -1);
+    }
+    close(fd);
+}
+
+// a udp datagram to port, with the test payload
+bool
+is_test_datagram(const struct pcap_pkthdr *header, const u_char *packet, uint16_t port)
+{
+    if (header->caplen != TEST_FRAME_LENGTH || packet[12] != 0x08 || packet[13] != 0x00 || packet[23] != IPPROTO_UDP){
+        return false;
+    }
+    return ((packet[36] << 8) | packet[37]) == port
+        && memcmp(packet + 42, TEST_PAYLOAD, sizeof(TEST_PAYLOAD)) == 0;
+}
+
+/**
+ * @brief Walk the blocks until nothing comes for a while
+ *
+ * @param ring
+ * @param port
+ * @param other count of the datagrams to another port
+ * @return int count of the test datagrams to port
+ */
+int
+read_datagrams(packet_ring_t *ring, uint16_t port, int *other)
+{
+    int count = 0;
+    packet_ring_block_t block;
+    while (packet_ring_next_block(ring, &block, 500) == 1){
+        struct pcap_pkthdr *header;
+        const u_char *packet;
+        while (packet_ring_block_next(ring, &block, &header, &packet)){
+            assert(header->caplen <= header->len);
+            assert(header->ts.tv_sec > 0);
+            if (is_test_datagram(header, packet, port)){
+                count++;
+            } else if (other != NULL && is_test_datagram(header, packet, TEST_OTHER_PORT)){
+                (*other)++;
+            }
+        }
+        packet_ring_release_block(ring, &block);
+    }
+    return count;
+}
+
+void
+test_capture()
+{
+    char errbuf[PCAP_ERRBUF_SIZE];
+    packet_ring_t *ring = packet_ring_open("lo", 1 << 16, 4, errbuf);
+    assert(ring != NULL);
+    // binds the socket, nothing to read yet
+    packet_ring_block_t block;
+    assert(packet_ring_next_block(ring, &block, 0) == 0);
+
+    send_datagrams(TEST_PORT, 10);
+    // the loopback shows each one on the way out and on the way in
+    int count = read_datagrams(ring, TEST_PORT, NULL);
+    assert(count >= 10);
+    assert(ring->blocks_read >= 1);
+    assert(ring->packets_read >= 10);
+
+    packet_ring_stats_t stats;
+    assert(packet_ring_stats(ring, &stats) == 0);
+    assert(stats.received >= (uint64_t)count);
+    assert(stats.dropped == 0);
+    packet_ring_close(ring);
+}
+
+void
+test_filter()
+{
+    char errbuf[PCAP_ERRBUF_SIZE];
+    packet_ring_t *ring = packet_ring_open("lo", 1 << 16, 4, errbuf);
+    assert(ring != NULL);
+
+    // ip and udp dst port TEST_PORT
+    struct bpf_insn instructions[] = {
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x0800, 0, 5),
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 23),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 3),
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 36),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, TEST_PORT, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, PACKET_RING_SNAPLEN),
+        BPF_STMT(BPF_RET | BPF_K, 0),
+    };
+    struct bpf_program program;
+    program.bf_len = sizeof(instructions) / sizeof(instructions[0]);
+    program.bf_insns = malloc(sizeof(instructions));
+    memcpy(program.bf_insns, instructions, sizeof(instructions));
+    assert(packet_ring_setfilter(ring, &program, errbuf) == 0);
+
+    packet_ring_block_t block;
+    assert(packet_ring_next_block(ring, &block, 0) == 0);
+    send_datagrams(TEST_OTHER_PORT, 5);
+    send_datagrams(TEST_PORT, 5);
+    int other = 0;
+    assert(read_datagrams(ring, TEST_PORT, &other) >= 5);
+    assert(other == 0);
+    packet_ring_close(ring);
+}
+
+void
+test_drops()
+{
+    char errbuf[PCAP_ERRBUF_SIZE];
+    // two small blocks, nobody reading them
+    packet_ring_t *ring = packet_ring_open("lo", getpagesize(), 2, errbuf);
+    assert(ring != NULL);
+    packet_ring_block_t block;
+    assert(packet_ring_next_block(ring, &block, 0) == 0);
+
+    send_datagrams(TEST_PORT, 500);
+    packet_ring_stats_t stats;
+    assert(packet_ring_stats(ring, &stats) == 0);
+    assert(stats.dropped > 0);
+    assert(stats.received > stats.dropped);
+    // accumulated, the kernel resets them
+    packet_ring_stats_t again;
+    assert(packet_ring_stats(ring, &again) == 0);
+    assert(again.dropped >= stats.dropped);
+    packet_ring_close(ring);
+}
+
+/**
+ * @brief Walk the blocks like read_datagrams(), counting the test datagrams
+ * by source port
+ *
+ * @param ring
+ * @param ports source ports seen, ports[i] counted in counts[i]
+ * @param counts
+ * @param port_count in/out
+ * @return int count of the test datagrams
+ */
+int
+read_datagrams_by_source(packet_ring_t *ring, uint16_t *ports, int *counts, int *port_count)
+{
+    int count = 0;
+    packet_ring_block_t block;
+    while (packet_ring_next_block(ring, &block, 500) == 1){
+        struct pcap_pkthdr *header;
+        const u_char *packet;
+        while (packet_ring_block_next(ring, &block, &header, &packet)){
+            if (!is_test_datagram(header, packet, TEST_PORT)){
+                continue;
+            }
+            count++;
+            uint16_t source = (packet[34] << 8) | packet[35];
+            int i = 0;
+            while (i < *port_count && ports[i] != source){
+                i++;
+            }
+            if (i == *port_count){
+                ports[(*port_count)++] = source;
+            }
+            counts[i]++;
+        }
+        packet_ring_release_block(ring, &block);
+    }
+    return count;
+}
+
+void
+test_fanout()
+{
+    char errbuf[PCAP_ERRBUF_SIZE];
+    packet_ring_t *rings[2];
+    uint16_t group = (getpid() & 0xffff) ^ 0x5a5a;
+    for (int i = 0; i < 2; i++){
+        rings[i] = packet_ring_open("lo", 1 << 16, 8, errbuf);
+        assert(rings[i] != NULL);
+        assert(packet_ring_join_fanout(rings[i], group, errbuf) == 0);
+    }
+
+    // a new socket per call, so a new source port and a new flow
+    int flows = 16;
+    for (int i = 0; i < flows; i++){
+        send_datagrams(TEST_PORT, 4);
+    }
+
+    uint16_t ports[2][32];
+    int counts[2][32] = {{0}};
+    int port_counts[2] = {0, 0};
+    int total = 0;
+    for (int i = 0; i < 2; i++){
+        total += read_datagrams_by_source(rings[i], ports[i], counts[i], &port_counts[i]);
+    }
+    // every datagram seen out and in, once in the group
+    assert(total == flows * 4 * 2);
+    assert(port_counts[0] + port_counts[1] == flows);
+    // a flow never split between the rings
+    for (int i = 0; i < port_counts[0]; i++){
+        assert(counts[0][i] == 8);
+        for (int j = 0; j < port_counts[1]; j++){
+            assert(ports[0][i] != ports[1][j]);
+        }
+    }
+
+    packet_ring_stats_t stats[2];
+    for (int i = 0; i < 2; i++){
+        assert(packet_ring_stats(rings[i], &stats[i]) == 0);
+        assert(stats[i].dropped == 0);
+        packet_ring_close(rings[i]);
+    }
+    assert(stats[0].received + stats[1].received >= (uint64_t)total);
+}
+
+void
+test_open_fails()
+{
+    char errbuf[PCAP_ERRBUF_SIZE] = {0};
+    assert(packet_ring_open("does-not-exist0", 0, 0, errbuf) == NULL);
+    assert(strstr(errbuf, "does-not-exist0") != NULL);
+    assert(packet_ring_open("lo", 1000, 4, errbuf) == NULL);
+    assert(strstr(errbuf, "block size") != NULL);
+}
+
+int
+main()
+{
+    char errbuf[PCAP_ERRBUF_SIZE];
+    packet_ring_t *ring = packet_ring_open("lo", 1 << 16, 4, errbuf);
+    if (ring == NULL && strstr(errbuf, "socket") != NULL){
+        printf("Can't open a packet socket (%s), skipped.\n", errbuf);
+        return TEST_SKIPPED;
+    }
+    assert(ring != NULL);
+    packet_ring_close(ring);
+
+    // so the datagrams have somewhere to go, no ICMP port unreachable
+    receiver = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(TEST_PORT);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(receiver, (struct sockaddr*)&address, sizeof(address)) == 0);
+
+    test_capture();
+    test_filter();
+    test_drops();
+    test_fanout();
+    test_open_fails();
+    close(receiver);
+    return 0;
+}
@@ -0,0 +1,552 @@
+#include "pcap_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static uint16_t
+read_u16(const pcap_file_t *file, const uint8_t *p)
+{
+    uint16_t value;
+    memcpy(&value, p, sizeof(value));
+    return file->swapped ? __builtin_bswap16(value) : value;
+}
+
+static uint32_t
+read_u32(const pcap_file_t *file, const uint8_t *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return file->swapped ? __builtin_bswap32(value) : value;
+}
+
+/**
+ * @brief Fill a timeval from a pcapng timestamp expressed in
+ * ts_units ticks per second, decimal or binary
+ *
+ * @param ts
+ * @param ts_units
+ * @param tv
+ */
+static void
+pcapng_ts_to_timeval(uint64_t ts, uint64_t ts_units, struct timeval *tv)
+{
+    uint64_t fraction = ts % ts_units;
+    tv->tv_sec = ts / ts_units;
+    // ts_units needn't divide or be a multiple of a million (2^k), scale
+    // in 128 bits so the result stays exact and below a second
+    tv->tv_usec = (uint64_t)((unsigned __int128)fraction * 1000000 / ts_units);
+}
+
+/**
+ * @brief Get the timestamp resolution of an interface out of the
+ * options of its Interface Description Block (default is microseconds)
+ *
+ * @param file
+ * @param options
+ * @param length
+ * @return uint64_t
+ */
+static uint64_t
+pcapng_get_ts_units(const pcap_file_t *file, const uint8_t *options, size_t length)
+{
+    size_t i = 0;
+    while (i + 4 <= length){
+        uint16_t code = read_u16(file, options + i);
+        uint16_t option_length = read_u16(file, options + i + 2);
+        if (code == PCAPNG_OPT_ENDOFOPT || i + 4 + option_length > length){
+            break;
+        }
+        if (code == PCAPNG_OPT_IF_TSRESOL && option_length >= 1){
+            // MSB 0: negative power of 10, MSB 1: negative power of 2
+            uint8_t tsresol = options[i + 4];
+            uint64_t units = 1;
+            if (tsresol & 0x80){
+                tsresol &= 0x7f;
+                if (tsresol > 63){
+                    return 1000000;
+                }
+                units = (uint64_t)1 << tsresol;
+            } else {
+                if (tsresol > 19){
+                    return 1000000;
+                }
+                for (uint8_t k = 0; k < tsresol; k++){
+                    units *= 10;
+                }
+            }
+            return units;
+        }
+        // options are padded to 32 bits
+        i += 4 + ((option_length + 3) & ~3u);
+    }
+    return 1000000;
+}
+
+/**
+ * @brief Read the header of a classic pcap file
+ *
+ * @param file
+ * @param errbuf
+ * @return int 0 if supported, -1 otherwise
+ */
+static int
+open_classic(pcap_file_t *file, uint32_t magic, char *errbuf)
+{
+    file->format = PCAP_FILE_CLASSIC;
+    file->swapped = (magic == PCAP_FILE_MAGIC_USEC_SWAPPED || magic == PCAP_FILE_MAGIC_NSEC_SWAPPED);
+    file->nsec = (magic == PCAP_FILE_MAGIC_NSEC || magic == PCAP_FILE_MAGIC_NSEC_SWAPPED);
+
+    if (file->size < PCAP_FILE_HEADER_SIZE){
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "truncated pcap file header");
+        return -1;
+    }
+
+    file->snaplen = read_u32(file, file->data + 16);
+    // the upper bits of the link type field carry FCS information
+    file->link_type = read_u32(file, file->data + 20) & 0x0FFFFFFF;
+    file->offset = PCAP_FILE_HEADER_SIZE;
+    return 0;
+}
+
+/**
+ * @brief Parse a Section Header Block at the current offset, sets the byte
+ * order for the section and forgets the interfaces of the previous one
+ *
+ * @param file
+ * @return int64_t the block length, -1 if malformed
+ */
+static int64_t
+pcapng_read_shb(pcap_file_t *file)
+{
+    if (file->offset + 28 > file->size){
+        return -1;
+    }
+    uint32_t byte_order_magic;
+    memcpy(&byte_order_magic, file->data + file->offset + 8, sizeof(byte_order_magic));
+    if (byte_order_magic == PCAPNG_BYTE_ORDER_MAGIC){
+        file->swapped = false;
+    } else if (byte_order_magic == PCAPNG_BYTE_ORDER_MAGIC_SWAPPED){
+        file->swapped = true;
+    } else {
+        return -1;
+    }
+    file->interface_count = 0;
+    return read_u32(file, file->data + file->offset + 4);
+}
+
+/**
+ * @brief Parse an Interface Description Block of the current section
+ *
+ * @param file
+ * @param body
+ * @param body_length
+ */
+static void
+pcapng_read_idb(pcap_file_t *file, const uint8_t *body, size_t body_length)
+{
+    if (body_length < 8 || file->interface_count >= PCAPNG_MAX_INTERFACES){
+        return;
+    }
+    pcap_file_interface_t *interface = &file->interfaces[file->interface_count++];
+    interface->link_type = read_u16(file, body);
+    interface->snaplen = read_u32(file, body + 4);
+    interface->ts_units = pcapng_get_ts_units(file, body + 8, body_length - 8);
+}
+
+/**
+ * @brief Read the leading blocks of a pcapng file up to the first
+ * packet, to learn the link type of the capture
+ *
+ * @param file
+ * @param errbuf
+ * @return int 0 if supported, -1 otherwise
+ */
+static int
+open_pcapng(pcap_file_t *file, char *errbuf)
+{
+    file->format = PCAP_FILE_PCAPNG;
+
+    int64_t shb_length = pcapng_read_shb(file);
+    if (shb_length < 28 || file->offset + shb_length > file->size){
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "malformed pcapng section header");
+        return -1;
+    }
+
+    // walk the interface descriptions preceding the first packet
+    size_t offset = shb_length;
+    while (offset + 12 <= file->size){
+        uint32_t type = read_u32(file, file->data + offset);
+        uint32_t length = read_u32(file, file->data + offset + 4);
+        if (length < 12 || offset + length > file->size){
+            break;
+        }
+        if (type == PCAPNG_EPB || type == PCAPNG_SPB){
+            break;
+        }
+        if (type == PCAPNG_IDB){
+            pcapng_read_idb(file, file->data + offset + 8, length - 12);
+        }
+        offset += length;
+    }
+
+    if (file->interface_count == 0){
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "pcapng file without interface description");
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < file->interface_count; i++){
+        if (file->interfaces[i].link_type != PCAP_FILE_LINKTYPE_ETHERNET){
+            snprintf(errbuf, PCAP_ERRBUF_SIZE, "unsupported pcapng link type %d", file->interfaces[i].link_type);
+            return -1;
+        }
+    }
+
+    file->link_type = file->interfaces[0].link_type;
+    file->snaplen = file->interfaces[0].snaplen;
+    // start over from the section header, the interfaces are read again in order
+    file->interface_count = 0;
+    file->offset = 0;
+    return 0;
+}
+
+/**
+ * @brief Map an offline capture (pcap or pcapng) in memory.
+ * Returns NULL and fills errbuf if the file can't be read natively,
+ * in which case the caller should fall back to pcap_open_offline()
+ *
+ * @param filename
+ * @param errbuf
+ * @return pcap_file_t*
+ */
+pcap_file_t*
+pcap_file_open(const char *filename, char *errbuf)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1){
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: %s", filename, strerror(errno));
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size < 4){
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: not a regular capture file", filename);
+        close(fd);
+        return NULL;
+    }
+
+    // read only: the parsers never write to a packet, the pages are the
+    // page cache's own and every thread can read them at the same time
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED){
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: mmap: %s", filename, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    // read front to back once: aggressive readahead, drop pages behind us
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+    #ifdef MADV_HUGEPAGE
+    // best effort, only honored by kernels with THP for file mappings
+    madvise(data, st.st_size, MADV_HUGEPAGE);
+    #endif
+
+    pcap_file_t *file = (pcap_file_t*)calloc(1, sizeof(pcap_file_t));
+    if (file == NULL){
+        fprintf(stderr, "Failed to allocate memory for pcap_file\n");
+        exit(EXIT_FAILURE);
+    }
+    file->fd = fd;
+    file->data = (const uint8_t*)data;
+    file->size = st.st_size;
+
+    uint32_t magic;
+    memcpy(&magic, file->data, sizeof(magic));
+
+    int status;
+    switch (magic){
+        case PCAP_FILE_MAGIC_USEC:
+        case PCAP_FILE_MAGIC_NSEC:
+        case PCAP_FILE_MAGIC_USEC_SWAPPED:
+        case PCAP_FILE_MAGIC_NSEC_SWAPPED:
+            status = open_classic(file, magic, errbuf);
+            break;
+        case PCAPNG_SHB:
+            status = open_pcapng(file, errbuf);
+            break;
+        default:
+            snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: unknown file format", filename);
+            status = -1;
+            break;
+    }
+
+    if (status == 0 && file->link_type != PCAP_FILE_LINKTYPE_ETHERNET){
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "unsupported link type %d", file->link_type);
+        status = -1;
+    }
+
+    if (status == -1){
+        pcap_file_close(file);
+        return NULL;
+    }
+
+    return file;
+}
+
+/**
+ * @brief Read the next classic pcap record
+ *
+ * @param file
+ * @param packet
+ * @return int 1 if a packet was read, 0 at the end of the file, -1 if truncated
+ */
+static int
+next_classic(pcap_file_t *file, const u_char **packet)
+{
+    if (file->offset == file->size){
+        return 0;
+    }
+    if (file->offset + PCAP_FILE_RECORD_HEADER_SIZE > file->size){
+        return -1;
+    }
+
+    const uint8_t *record = file->data + file->offset;
+    uint32_t caplen = read_u32(file, record + 8);
+    if (caplen > file->size - file->offset - PCAP_FILE_RECORD_HEADER_SIZE){
+        return -1;
+    }
+
+    file->header.ts.tv_sec = read_u32(file, record);
+    file->header.ts.tv_usec = read_u32(file, record + 4);
+    if (file->nsec){
+        file->header.ts.tv_usec /= 1000;
+    }
+    file->header.caplen = caplen;
+    file->header.len = read_u32(file, record + 12);
+
+    *packet = record + PCAP_FILE_RECORD_HEADER_SIZE;
+    file->offset += PCAP_FILE_RECORD_HEADER_SIZE + caplen;
+    return 1;
+}
+
+/**
+ * @brief Walk the pcapng blocks up to the next packet block
+ *
+ * @param file
+ * @param packet
+ * @return int 1 if a packet was read, 0 at the end of the file, -1 if malformed
+ */
+static int
+next_pcapng(pcap_file_t *file, const u_char **packet)
+{
+    while (file->offset < file->size){
+        if (file->offset + 12 > file->size){
+            return -1;
+        }
+
+        const uint8_t *block = file->data + file->offset;
+        uint32_t type;
+        memcpy(&type, block, sizeof(type));
+
+        // the section header decides the byte order of everything after it
+        if (type == PCAPNG_SHB){
+            int64_t length = pcapng_read_shb(file);
+            if (length < 28 || file->offset + length > file->size){
+                return -1;
+            }
+            file->offset += length;
+            continue;
+        }
+
+        type = read_u32(file, block);
+        uint32_t length = read_u32(file, block + 4);
+        if (length < 12 || length > file->size - file->offset){
+            return -1;
+        }
+        const uint8_t *body = block + 8;
+        size_t body_length = length - 12;
+        file->offset += length;
+
+        switch (type){
+            case PCAPNG_IDB:
+                pcapng_read_idb(file, body, body_length);
+                break;
+            case PCAPNG_EPB: {
+                if (body_length < 20){
+                    return -1;
+                }
+                uint32_t interface_id = read_u32(file, body);
+                uint32_t caplen = read_u32(file, body + 12);
+                if (caplen > body_length - 20){
+                    return -1;
+                }
+                if (interface_id >= file->interface_count || file->interfaces[interface_id].link_type != PCAP_FILE_LINKTYPE_ETHERNET){
+                    file->packets_skipped++;
+                    break;
+                }
+                uint64_t ts = ((uint64_t)read_u32(file, body + 4) << 32) | read_u32(file, body + 8);
+                pcapng_ts_to_timeval(ts, file->interfaces[interface_id].ts_units, &file->header.ts);
+                file->header.caplen = caplen;
+                file->header.len = read_u32(file, body + 16);
+                *packet = body + 20;
+                return 1;
+            }
+            case PCAPNG_SPB: {
+                if (body_length < 4){
+                    return -1;
+                }
+                if (file->interface_count == 0 || file->interfaces[0].link_type != PCAP_FILE_LINKTYPE_ETHERNET){
+                    file->packets_skipped++;
+                    break;
+                }
+                // no timestamp and no captured length in a simple packet block
+                uint32_t len = read_u32(file, body);
+                uint32_t caplen = len;
+                if (file->interfaces[0].snaplen != 0 && caplen > file->interfaces[0].snaplen){
+                    caplen = file->interfaces[0].snaplen;
+                }
+                if (caplen > body_length - 4){
+                    caplen = body_length - 4;
+                }
+                file->header.ts.tv_sec = 0;
+                file->header.ts.tv_usec = 0;
+                file->header.caplen = caplen;
+                file->header.len = len;
+                *packet = body + 4;
+                return 1;
+            }
+            default:
+                // statistics, name resolution, custom blocks...
+                break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Get the next packet of the file, the packet points into the mapping
+ * and stays valid until pcap_file_close()
+ *
+ * @param file
+ * @param header
+ * @param packet
+ * @return int 1 if a packet was read, 0 at the end of the file, -1 if the file is truncated/malformed
+ */
+int
+pcap_file_next(pcap_file_t *file, struct pcap_pkthdr **header, const u_char **packet)
+{
+    int status;
+    if (file->format == PCAP_FILE_CLASSIC){
+        status = next_classic(file, packet);
+    } else {
+        status = next_pcapng(file, packet);
+    }
+    if (status == 1){
+        file->packets_read++;
+        *header = &file->header;
+    }
+    return status;
+}
+
+/**
+ * @brief Same contract as pcap_loop(): call the callback for every packet
+ * (that passes the filter, if any), count <= 0 means until the end of the file
+ *
+ * @param file
+ * @param count
+ * @param callback
+ * @param user
+ * @return int 0 when done, -1 on error, -2 if stopped by pcap_file_breakloop()
+ */
+int
+pcap_file_loop(pcap_file_t *file, int count, pcap_handler callback, u_char *user)
+{
+    struct pcap_pkthdr *header;
+    const u_char *packet;
+    int processed = 0;
+
+    while (count <= 0 || processed < count){
+        if (file->break_loop){
+            file->break_loop = false;
+            return -2;
+        }
+
+        int status = pcap_file_next(file, &header, &packet);
+        if (status == 0){
+            return 0;
+        }
+        if (status == -1){
+            fprintf(stderr, "Truncated or malformed capture file at offset %zu.\n", file->offset);
+            return -1;
+        }
+
+        if (file->has_filter && pcap_offline_filter(&file->filter, header, packet) == 0){
+            continue;
+        }
+
+        callback(user, header, packet);
+        processed++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Install a compiled BPF filter, the file takes ownership of
+ * the program and frees it on close
+ *
+ * @param file
+ * @param filter
+ */
+void
+pcap_file_setfilter(pcap_file_t *file, struct bpf_program *filter)
+{
+    if (file->has_filter){
+        pcap_freecode(&file->filter);
+    }
+    file->filter = *filter;
+    file->has_filter = true;
+}
+
+/**
+ * @brief Stop pcap_file_loop() after the current packet (signal safe)
+ *
+ * @param file
+ */
+void
+pcap_file_breakloop(pcap_file_t *file)
+{
+    file->break_loop = true;
+}
+
+int
+pcap_file_datalink(pcap_file_t *file)
+{
+    return file->link_type;
+}
+
+int
+pcap_file_snapshot(pcap_file_t *file)
+{
+    return file->snaplen;
+}
+
+/**
+ * @brief Unmap the file and free the reader
+ *
+ * @param file
+ */
+void
+pcap_file_close(pcap_file_t *file)
+{
+    if (file == NULL){
+        return;
+    }
+    if (file->has_filter){
+        pcap_freecode(&file->filter);
+    }
+    munmap((void*)file->data, file->size);
+    close(file->fd);
+    free(file);
+}
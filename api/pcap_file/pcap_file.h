@@ -0,0 +1,130 @@
+#ifndef PCAP_FILE_H
+#define PCAP_FILE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pcap.h>
+
+/*
+Memory-mapped reader for offline captures.
+
+The whole file is mapped once and every packet handed to the callback points
+directly into the mapping, so replaying a capture costs no read() and no copy
+per record. Both formats written by tcpdump/wireshark are understood:
+
+Classic pcap: https://datatracker.ietf.org/doc/html/draft-ietf-opsawg-pcap#section-4
+
+     0                   1                   2                   3
+     0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    |                          Magic Number                         |
+    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    |          Major Version        |         Minor Version         |
+    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    |                           Reserved1                           |
+    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    |                           Reserved2                           |
+    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    |                            SnapLen                            |
+    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    |                            LinkType                           |
+    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+
+pcapng: https://datatracker.ietf.org/doc/html/draft-ietf-opsawg-pcapng#section-3.1
+
+     0                   1                   2                   3
+     0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+    +---------------------------------------------------------------+
+    |                          Block Type                           |
+    +---------------------------------------------------------------+
+    |                      Block Total Length                       |
+    +---------------------------------------------------------------+
+    /                          Block Body                           /
+    +---------------------------------------------------------------+
+    |                      Block Total Length                       |
+    +---------------------------------------------------------------+
+
+Only Ethernet (DLT_EN10MB) captures are read natively, anything else is
+reported as unsupported so the caller can fall back to pcap_open_offline().
+*/
+
+// classic pcap magic numbers (as read in host byte order)
+#define PCAP_FILE_MAGIC_USEC 0xa1b2c3d4
+#define PCAP_FILE_MAGIC_NSEC 0xa1b23c4d
+#define PCAP_FILE_MAGIC_USEC_SWAPPED 0xd4c3b2a1
+#define PCAP_FILE_MAGIC_NSEC_SWAPPED 0x4d3cb2a1
+#define PCAP_FILE_HEADER_SIZE 24
+#define PCAP_FILE_RECORD_HEADER_SIZE 16
+
+// pcapng block types
+#define PCAPNG_SHB 0x0a0d0d0a // Section Header Block
+#define PCAPNG_IDB 0x00000001 // Interface Description Block
+#define PCAPNG_SPB 0x00000003 // Simple Packet Block
+#define PCAPNG_EPB 0x00000006 // Enhanced Packet Block
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1a2b3c4d
+#define PCAPNG_BYTE_ORDER_MAGIC_SWAPPED 0x4d3c2b1a
+#define PCAPNG_OPT_ENDOFOPT 0
+#define PCAPNG_OPT_IF_TSRESOL 9
+#define PCAPNG_MAX_INTERFACES 64
+
+#define PCAP_FILE_LINKTYPE_ETHERNET 1 // DLT_EN10MB
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    PCAP_FILE_CLASSIC,
+    PCAP_FILE_PCAPNG
+} pcap_file_format_t;
+
+typedef struct pcap_file_interface {
+    uint16_t link_type;
+    uint32_t snaplen;
+    uint64_t ts_units; // timestamp ticks per second (if_tsresol)
+} pcap_file_interface_t;
+
+typedef struct pcap_file {
+    int fd;
+    const uint8_t *data;     // start of the mapping
+    size_t size;             // size of the mapping
+    size_t offset;           // offset of the next record/block
+
+    pcap_file_format_t format;
+    bool swapped;            // file written with the other byte order
+    bool nsec;               // classic pcap with nanosecond timestamps
+
+    uint16_t link_type;
+    uint32_t snaplen;
+
+    // pcapng: interfaces of the current section
+    pcap_file_interface_t interfaces[PCAPNG_MAX_INTERFACES];
+    uint32_t interface_count;
+
+    struct pcap_pkthdr header; // header of the last returned packet
+    uint64_t packets_read;
+    uint64_t packets_skipped;  // pcapng packets on non Ethernet interfaces
+
+    bool has_filter;
+    struct bpf_program filter;
+
+    volatile bool break_loop;
+} pcap_file_t;
+
+pcap_file_t* pcap_file_open(const char *filename, char *errbuf);
+int pcap_file_next(pcap_file_t *file, struct pcap_pkthdr **header, const u_char **packet);
+int pcap_file_loop(pcap_file_t *file, int count, pcap_handler callback, u_char *user);
+void pcap_file_setfilter(pcap_file_t *file, struct bpf_program *filter);
+void pcap_file_breakloop(pcap_file_t *file);
+int pcap_file_datalink(pcap_file_t *file);
+int pcap_file_snapshot(pcap_file_t *file);
+void pcap_file_close(pcap_file_t *file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
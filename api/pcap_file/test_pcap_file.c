@@ -0,0 +1,333 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "pcap_file.h"
+
+// directory of the bundled captures, given by ctest
+const char *captures_dir = ".";
+
+void
+build_path(char *path, size_t size, const char *name)
+{
+    snprintf(path, size, "%s/%s", captures_dir, name);
+}
+
+int
+count_packets(const char *name)
+{
+    char path[512];
+    char errbuf[PCAP_ERRBUF_SIZE];
+    build_path(path, sizeof(path), name);
+
+    pcap_file_t *file = pcap_file_open(path, errbuf);
+    assert(file != NULL && "Failed to open capture");
+
+    struct pcap_pkthdr *header;
+    const u_char *packet;
+    int count = 0;
+    int status;
+    while ((status = pcap_file_next(file, &header, &packet)) == 1){
+        assert(header->caplen <= header->len);
+        count++;
+    }
+    assert(status == 0 && "Capture should end cleanly");
+    pcap_file_close(file);
+    return count;
+}
+
+void
+test_classic_pcap()
+{
+    char path[512];
+    char errbuf[PCAP_ERRBUF_SIZE];
+    build_path(path, sizeof(path), "icmp.pcap");
+
+    pcap_file_t *file = pcap_file_open(path, errbuf);
+    assert(file != NULL);
+    assert(file->format == PCAP_FILE_CLASSIC);
+    assert(pcap_file_datalink(file) == PCAP_FILE_LINKTYPE_ETHERNET);
+    assert(pcap_file_snapshot(file) == 0xffff);
+
+    struct pcap_pkthdr *header;
+    const u_char *packet;
+    assert(pcap_file_next(file, &header, &packet) == 1);
+    assert(header->ts.tv_sec == 1309144887);
+    assert(header->ts.tv_usec == 24263);
+    assert(header->caplen == 74);
+    assert(header->len == 74);
+    // the packet points right after the record header in the mapping
+    assert(packet == file->data + PCAP_FILE_HEADER_SIZE + PCAP_FILE_RECORD_HEADER_SIZE);
+    // ethertype IPv4
+    assert(packet[12] == 0x08 && packet[13] == 0x00);
+    pcap_file_close(file);
+
+    assert(count_packets("icmp.pcap") == 12);
+    assert(count_packets("dhcp.pcap") == 4);
+    assert(count_packets("ICMPv4_Destination_unreachable.pcap") == 15);
+}
+
+void
+test_pcapng()
+{
+    char path[512];
+    char errbuf[PCAP_ERRBUF_SIZE];
+    build_path(path, sizeof(path), "dns.pcap");
+
+    pcap_file_t *file = pcap_file_open(path, errbuf);
+    assert(file != NULL);
+    assert(file->format == PCAP_FILE_PCAPNG);
+    assert(pcap_file_datalink(file) == PCAP_FILE_LINKTYPE_ETHERNET);
+
+    struct pcap_pkthdr *header;
+    const u_char *packet;
+    assert(pcap_file_next(file, &header, &packet) == 1);
+    assert(header->ts.tv_sec == 1347402958);
+    assert(header->ts.tv_usec == 977971);
+    assert(header->caplen == 94);
+    assert(header->len == 94);
+    pcap_file_close(file);
+
+    assert(count_packets("dns.pcap") == 183);
+    assert(count_packets("dns-2.pcap") == 7);
+}
+
+void
+write_file(const char *path, const uint8_t *data, size_t size)
+{
+    FILE *f = fopen(path, "wb");
+    assert(f != NULL);
+    assert(fwrite(data, 1, size, f) == size);
+    fclose(f);
+}
+
+void
+test_swapped_nsec_pcap()
+{
+    // big-endian file with nanosecond timestamps and a single 14 bytes packet
+    uint8_t data[] = {
+        0xa1, 0xb2, 0x3c, 0x4d, 0x00, 0x02, 0x00, 0x04,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x0a, 0x00, 0x0f, 0x42, 0x40, // ts: 10 s, 1000000 ns
+        0x00, 0x00, 0x00, 0x0e, 0x00, 0x00, 0x00, 0x3c, // caplen 14, len 60
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x11,
+        0x22, 0x33, 0x44, 0x55, 0x08, 0x06
+    };
+    const char *path = "test_pcap_file_swapped.pcap";
+    write_file(path, data, sizeof(data));
+
+    char errbuf[PCAP_ERRBUF_SIZE];
+    pcap_file_t *file = pcap_file_open(path, errbuf);
+    assert(file != NULL);
+    assert(file->swapped && file->nsec);
+    assert(pcap_file_snapshot(file) == 128);
+
+    struct pcap_pkthdr *header;
+    const u_char *packet;
+    assert(pcap_file_next(file, &header, &packet) == 1);
+    assert(header->ts.tv_sec == 10);
+    assert(header->ts.tv_usec == 1000);
+    assert(header->caplen == 14);
+    assert(header->len == 60);
+    assert(packet[12] == 0x08 && packet[13] == 0x06);
+    assert(pcap_file_next(file, &header, &packet) == 0);
+    pcap_file_close(file);
+    remove(path);
+}
+
+void
+test_truncated_pcap()
+{
+    // the record claims 14 bytes, only 4 are there
+    uint8_t data[] = {
+        0xd4, 0xc3, 0xb2, 0xa1, 0x02, 0x00, 0x04, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0xff, 0xff, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x0e, 0x00, 0x00, 0x00, 0x0e, 0x00, 0x00, 0x00,
+        0xff, 0xff, 0xff, 0xff
+    };
+    const char *path = "test_pcap_file_truncated.pcap";
+    write_file(path, data, sizeof(data));
+
+    char errbuf[PCAP_ERRBUF_SIZE];
+    pcap_file_t *file = pcap_file_open(path, errbuf);
+    assert(file != NULL);
+
+    struct pcap_pkthdr *header;
+    const u_char *packet;
+    assert(pcap_file_next(file, &header, &packet) == -1);
+    pcap_file_close(file);
+    remove(path);
+}
+
+void
+test_unsupported_link_type()
+{
+    // LINKTYPE_RAW (101): must be left to libpcap
+    uint8_t data[] = {
+        0xd4, 0xc3, 0xb2, 0xa1, 0x02, 0x00, 0x04, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0xff, 0xff, 0x00, 0x00, 0x65, 0x00, 0x00, 0x00
+    };
+    const char *path = "test_pcap_file_raw.pcap";
+    write_file(path, data, sizeof(data));
+
+    char errbuf[PCAP_ERRBUF_SIZE] = {0};
+    pcap_file_t *file = pcap_file_open(path, errbuf);
+    assert(file == NULL);
+    assert(strstr(errbuf, "unsupported link type") != NULL);
+    remove(path);
+
+    file = pcap_file_open("does_not_exist.pcap", errbuf);
+    assert(file == NULL);
+}
+
+/**
+ * @brief Write a little-endian pcapng file: a section header, an Ethernet
+ * interface with the given if_tsresol and one 14 bytes packet
+ * stamped ts ticks
+ *
+ * @param path
+ * @param tsresol
+ * @param ts
+ */
+void
+write_pcapng(const char *path, uint8_t tsresol, uint64_t ts)
+{
+    uint8_t data[] = {
+        // section header block
+        0x0a, 0x0d, 0x0d, 0x0a, 0x1c, 0x00, 0x00, 0x00,
+        0x4d, 0x3c, 0x2b, 0x1a, 0x01, 0x00, 0x00, 0x00,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0x1c, 0x00, 0x00, 0x00,
+        // interface description block, if_tsresol then opt_endofopt
+        0x01, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00,
+        0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+        0x09, 0x00, 0x01, 0x00, tsresol, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00,
+        // enhanced packet block, the timestamp is filled below
+        0x06, 0x00, 0x00, 0x00, 0x30, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x0e, 0x00, 0x00, 0x00,
+        0x0e, 0x00, 0x00, 0x00,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x11,
+        0x22, 0x33, 0x44, 0x55, 0x08, 0x06, 0x00, 0x00,
+        0x30, 0x00, 0x00, 0x00
+    };
+    // timestamp high then low, each little-endian
+    size_t epb = 28 + 32;
+    for (int i = 0; i < 4; i++){
+        data[epb + 12 + i] = (uint8_t)(ts >> (32 + 8 * i));
+        data[epb + 16 + i] = (uint8_t)(ts >> (8 * i));
+    }
+    write_file(path, data, sizeof(data));
+}
+
+/**
+ * @brief Read the timestamp of the only packet of a pcapng file
+ *
+ * @param path
+ * @param tv
+ */
+void
+read_pcapng_ts(const char *path, struct timeval *tv)
+{
+    char errbuf[PCAP_ERRBUF_SIZE];
+    pcap_file_t *file = pcap_file_open(path, errbuf);
+    assert(file != NULL);
+    assert(file->format == PCAP_FILE_PCAPNG);
+
+    struct pcap_pkthdr *header;
+    const u_char *packet;
+    assert(pcap_file_next(file, &header, &packet) == 1);
+    assert(header->caplen == 14);
+    assert(packet[12] == 0x08 && packet[13] == 0x06);
+    *tv = header->ts;
+    assert(pcap_file_next(file, &header, &packet) == 0);
+    pcap_file_close(file);
+}
+
+void
+test_pcapng_tsresol()
+{
+    const char *path = "test_pcap_file_tsresol.pcapng";
+    struct timeval tv;
+
+    // nanoseconds: 10 s and 123456789 ns
+    write_pcapng(path, 9, 10 * 1000000000ull + 123456789);
+    read_pcapng_ts(path, &tv);
+    assert(tv.tv_sec == 10 && tv.tv_usec == 123456);
+
+    // 2^-20 s: the last tick of a second is still below a million us
+    write_pcapng(path, 0x94, 7 * (1ull << 20) + (1ull << 20) - 1);
+    read_pcapng_ts(path, &tv);
+    assert(tv.tv_sec == 7 && tv.tv_usec == 999999);
+
+    // 2^-10 s: 512 ticks is half a second, not 512 * 976 us
+    write_pcapng(path, 0x8a, 3 * 1024 + 512);
+    read_pcapng_ts(path, &tv);
+    assert(tv.tv_sec == 3 && tv.tv_usec == 500000);
+
+    // 2^-10 s: 1023 ticks is 999023.4 us
+    write_pcapng(path, 0x8a, 1023);
+    read_pcapng_ts(path, &tv);
+    assert(tv.tv_sec == 0 && tv.tv_usec == 999023);
+    remove(path);
+}
+
+int looped = 0;
+
+void
+count_handler(u_char *user, const struct pcap_pkthdr *header, const u_char *packet)
+{
+    (void)header;
+    (void)packet;
+    pcap_file_t *file = (pcap_file_t*)user;
+    looped++;
+    if (looped == 5){
+        pcap_file_breakloop(file);
+    }
+}
+
+void
+test_loop()
+{
+    char path[512];
+    char errbuf[PCAP_ERRBUF_SIZE];
+    build_path(path, sizeof(path), "dns.pcap");
+
+    pcap_file_t *file = pcap_file_open(path, errbuf);
+    assert(file != NULL);
+
+    // limited count
+    looped = 0;
+    assert(pcap_file_loop(file, 3, count_handler, (u_char*)file) == 0);
+    assert(looped == 3);
+
+    // stopped from the callback
+    assert(pcap_file_loop(file, 0, count_handler, (u_char*)file) == -2);
+    assert(looped == 5);
+
+    // the rest of the file
+    looped = 100;
+    assert(pcap_file_loop(file, 0, count_handler, (u_char*)file) == 0);
+    assert(looped == 100 + 183 - 5);
+    pcap_file_close(file);
+}
+
+int
+main(int argc, char **argv)
+{
+    if (argc > 1){
+        captures_dir = argv[1];
+    }
+    test_classic_pcap();
+    test_pcapng();
+    test_swapped_nsec_pcap();
+    test_pcapng_tsresol();
+    test_truncated_pcap();
+    test_unsupported_link_type();
+    test_loop();
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "pcap_file.h"
+#include "cli_parser.h"
+#include "cli_ndjson.h"
+
+/*
+Throughput of --format ndjson against the text renderers.
+
+usage: bench_ndjson <capture> [passes]
+
+The capture is decoded passes times (10000 by default) by each renderer,
+into a memory sink emptied after every pass: only decoding and encoding
+are measured, not the terminal.
+*/
+
+typedef struct {
+    int verbosity;
+    uint64_t packets;
+    uint64_t bytes;      // of output
+} bench_run_t;
+
+double
+now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void
+bench_handler(u_char *user, const struct pcap_pkthdr *header, const u_char *packet)
+{
+    bench_run_t *run = (bench_run_t*)user;
+    parse_cli_nth(header, packet, run->verbosity, run->packets);
+    run->packets++;
+}
+
+void
+bench(const char *name, const char *path, int format, int verbosity, int passes)
+{
+    char errbuf[PCAP_ERRBUF_SIZE];
+    output_sink_t sink;
+    output_sink_init(&sink, OUTPUT_SINK_NO_FD, OUTPUT_SINK_CAPACITY);
+    cli_sink = &sink;
+
+    cli_format = format;
+    bench_run_t run = {verbosity, 0, 0};
+    double start = now_seconds();
+    for (int i = 0; i < passes; i++){
+        pcap_file_t *file = pcap_file_open(path, errbuf);
+        if (file == NULL){
+            fprintf(stderr, "pcap_file_open: %s\n", errbuf);
+            exit(EXIT_FAILURE);
+        }
+        pcap_file_loop(file, 0, bench_handler, (u_char*)&run);
+        pcap_file_close(file);
+        run.bytes += sink.length;
+        output_sink_reset(&sink);
+    }
+    double elapsed = now_seconds() - start;
+
+    printf("%-10s %10llu packets %8.3f s %10.3f Mpps %10.1f MB/s of output\n",
+        name,
+        (unsigned long long)run.packets,
+        elapsed,
+        run.packets / elapsed / 1e6,
+        run.bytes / elapsed / 1e6);
+
+    cli_sink = NULL;
+    output_sink_destroy(&sink);
+}
+
+int
+main(int argc, char **argv)
+{
+    if (argc < 2){
+        fprintf(stderr, "usage: %s <capture> [passes]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    int passes = (argc > 2) ? atoi(argv[2]) : 10000;
+
+    bench("text -v1", argv[1], FORMAT_TEXT, VB_MINIMAL, passes);
+    bench("text -v2", argv[1], FORMAT_TEXT, VB_MIDDLE, passes);
+    bench("text -v3", argv[1], FORMAT_TEXT, VB_MAXIMAL, passes);
+    bench("ndjson", argv[1], FORMAT_NDJSON, VB_MINIMAL, passes);
+    return 0;
+}
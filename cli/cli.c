@@ -1,30 +1,57 @@
 #include "cli.h"
 
 pcap_t *capture;
+pcap_file_t *capture_file;
+packet_ring_t *capture_ring;
+fanout_capture_t *capture_fanout;
 
 int 
 main(int argc, char** argv)
 {
-    char interface[CMD_ARG_SIZE] = {0};
-    char filename[CMD_ARG_SIZE] = {0};
-    char filter[CMD_ARG_SIZE] = {0};
-    int verbosity = 1;
+    cli_options_t options;
 
     if (argc == 1){
         display_welcome_message();
         return 0;
     }
     // get the arguments
-    get_arguments(argc, argv, interface, filename, filter, &verbosity);
+    get_arguments(argc, argv, &options);
+    if (options.format != -1){
+        // before anything is printed, ndjson moves the messages to stderr
+        cli_set_format(options.format);
+    }
 
     // prepare for departure
-    check_all(interface, filename, filter, verbosity);
+    check_all(&options);
+
+    if (strcmp(options.export_path, "") != 0){
+        cli_columns_open(options.export_path);
+        cli_set_format(FORMAT_COLUMNS);
+    }
+    if (options.flows){
+        cli_flows_open();
+    }
+    if (options.dns){
+        cli_dns_open();
+    }
+    if (options.top > 0){
+        cli_top_open(options.top, options.top_memory, options.top_interval);
+    }
+    if (options.distinct > 0){
+        cli_distinct_open(options.distinct);
+    }
+    if (strcmp(options.stats_path, "") != 0){
+        cli_stats_open(options.stats_path, options.stats_bucket, options.stats_interval);
+    }
+    if (options.profile){
+        cli_profile_open();
+    }
 
     // start the capture
-    if (strcmp(interface, "") != 0){
-        start_capture(interface, filter, verbosity, true);
+    if (strcmp(options.interface, "") != 0){
+        start_capture(options.interface, options.filter, options.verbosity, options.jobs, options.ring_block_size * 1024, options.ring_blocks, true);
     } else {
-        start_capture(filename, filter, verbosity, false);
+        start_capture(options.filename, options.filter, options.verbosity, options.jobs, 0, 0, false);
     }
 
     return 0;
@@ -36,6 +63,15 @@ signal_handler(int sig)
     if (capture != NULL){
         pcap_breakloop(capture);
     }
+    if (capture_file != NULL){
+        pcap_file_breakloop(capture_file);
+    }
+    if (capture_ring != NULL){
+        packet_ring_breakloop(capture_ring);
+    }
+    if (capture_fanout != NULL){
+        fanout_capture_breakloop(capture_fanout);
+    }
 }
 
 void
@@ -43,11 +79,21 @@ packet_handler(u_char *args, const struct pcap_pkthdr *header, const u_char *pac
 {
     handler_args_t *handler_args = (handler_args_t*)args;
     int verbosity = handler_args->verbosity;
-    parse_cli(header, (uint8_t*)packet, verbosity);
+    // since the end of the last packet, the capture's own time
+    STAGE_BEGIN(handler_start);
+    STAGE_GAP(handler_start, STAGE_CAPTURE);
+    if (cli_flows != NULL){
+        STAGE_BEGIN(start);
+        cli_flows_update(header, packet);
+        STAGE_END(start, STAGE_FLOWS);
+    }
+    parse_cli(header, packet, verbosity);
+    STAGE_END(handler_start, STAGE_HANDLER);
+    STAGE_MARK();
 }
 
 void
-start_capture(char* source, char* filter, int verbosity, bool is_live)
+start_capture(char* source, char* filter, int verbosity, int jobs, int ring_block_size, int ring_blocks, bool is_live)
 {   
     char errbuf[PCAP_ERRBUF_SIZE];
     handler_args_t handler_args = {verbosity};
@@ -61,31 +107,94 @@ start_capture(char* source, char* filter, int verbosity, bool is_live)
             fprintf(stderr, "Interface '%s' not found.\n", source);
             exit(EXIT_FAILURE);
         }
-        // prepare the capture
-        capture = pcap_open_live(dev->name, BUFSIZ, 1, 1000, errbuf);
+        if (jobs > 1){
+            // one ring per thread, the kernel shares the packets out
+            capture_fanout = fanout_capture_open(dev->name, jobs, ring_block_size, ring_blocks, errbuf);
+            if (capture_fanout == NULL){
+                fprintf(stderr, "Can't capture on %d threads: %s.\n", jobs, errbuf);
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            // read the kernel's ring directly,
+            // libpcap only for the devices we don't support
+            capture_ring = packet_ring_open(dev->name, ring_block_size, ring_blocks, errbuf);
+        }
+        if (capture_ring == NULL && capture_fanout == NULL){
+            printf("Capturing on '%s' through libpcap: %s.\n", source, errbuf);
+            capture = pcap_open_live(dev->name, PACKET_RING_SNAPLEN, 1, PACKET_RING_TIMEOUT_MS, errbuf);
+        }
         free_interfaces(alldevsp);
     } else {
-        capture = pcap_open_offline(source, errbuf);
+        // map the file and parse straight out of it,
+        // libpcap only reads what we don't support
+        capture_file = pcap_file_open(source, errbuf);
+        if (capture_file == NULL){
+            printf("Reading '%s' through libpcap: %s.\n", source, errbuf);
+            capture = pcap_open_offline(source, errbuf);
+        }
     }
 
-    if (capture == NULL){
+    if (capture == NULL && capture_file == NULL && capture_ring == NULL && capture_fanout == NULL){
         fprintf(stderr, "Can't capture: %s.\n", errbuf);
         exit(EXIT_FAILURE);
     }
 
     // compile the filter if exists
-    set_filter_if_exists(capture, filter);
+    if (capture_file != NULL){
+        set_file_filter_if_exists(capture_file, filter);
+    } else if (capture_ring != NULL){
+        set_ring_filter_if_exists(capture_ring, filter);
+    } else if (capture_fanout != NULL){
+        set_fanout_filter_if_exists(capture_fanout, filter);
+    } else {
+        set_filter_if_exists(capture, filter);
+    }
 
     // set up ^C, to cleanup before exiting
     signal(SIGINT, signal_handler);
 
     // start the capture
-    pcap_loop(capture, 0, packet_handler, (uint8_t*)&handler_args);
+    if (capture_fanout != NULL){
+        fanout_capture_loop(capture_fanout, verbosity);
+    } else if (jobs > 1){
+        start_parallel_capture(capture_file, capture, verbosity, jobs);
+    } else if (capture_file != NULL){
+        pcap_file_loop(capture_file, 0, packet_handler, (uint8_t*)&handler_args);
+    } else if (capture_ring != NULL){
+        packet_ring_loop(capture_ring, 0, packet_handler, (uint8_t*)&handler_args);
+    } else {
+        pcap_loop(capture, 0, packet_handler, (uint8_t*)&handler_args);
+    }
+    // the renderers' output before anything else
+    cli_flush();
+    // the counts of this thread, the workers added theirs when they ended
+    cli_dns_release();
+    cli_top_release();
+    cli_distinct_release();
+    cli_stats_release();
+    cli_profile_release();
+    cli_flows_summary();
+    cli_dns_summary();
+    cli_top_summary();
+    cli_distinct_summary();
+    cli_stats_summary();
+    cli_profile_summary();
 
     printf("\nCapture stopped.\n");
+    if (is_live){
+        print_capture_stats();
+    }
     printf("Cleaning up...\n");
     // land the plane
-    pcap_close(capture);
+    if (capture_file != NULL){
+        pcap_file_close(capture_file);
+    } else if (capture_ring != NULL){
+        packet_ring_close(capture_ring);
+    } else if (capture_fanout != NULL){
+        fanout_capture_close(capture_fanout);
+    } else {
+        pcap_close(capture);
+    }
     cleanup();
     printf("-----------------------------------\n");
     printf("DONE.\n");
@@ -126,8 +235,139 @@ set_filter_if_exists(pcap_t *capture, char* filter)
     }
 }
 
+/**
+ * @brief Set the filter on a memory-mapped file if it exists / was set by the user,
+ * the filter is compiled against a dead handle with the file's link type
+ * 
+ * @param file 
+ * @param filter 
+ */
+void
+set_file_filter_if_exists(pcap_file_t *file, char* filter)
+{
+    struct bpf_program fp;
+    if (strcmp(filter, "") != 0) {
+        int snaplen = pcap_file_snapshot(file) > 0 ? pcap_file_snapshot(file) : 65535;
+        pcap_t *handle = pcap_open_dead(pcap_file_datalink(file), snaplen);
+        if (pcap_compile(handle, &fp, filter, 0, PCAP_NETMASK_UNKNOWN) == -1) {
+            fprintf(stderr, "Can't parse filter '%s': %s\n", filter, pcap_geterr(handle));
+            printf("-----------------------------------\n");
+            pcap_close(handle);
+            pcap_file_close(file);
+            exit(EXIT_FAILURE);
+        }
+        pcap_close(handle);
+        // the file owns the program from now on
+        pcap_file_setfilter(file, &fp);
+    } else {
+        printf("No filter applied, capturing all packets.\n");
+        printf("-----------------------------------\n");
+    }
+}
+
+/**
+ * @brief Set the filter on the ring if it exists / was set by the user,
+ * the kernel runs it before the packets reach the ring
+ * 
+ * @param ring 
+ * @param filter 
+ */
+void
+set_ring_filter_if_exists(packet_ring_t *ring, char* filter)
+{
+    struct bpf_program fp;
+    char errbuf[PCAP_ERRBUF_SIZE];
+    if (strcmp(filter, "") != 0) {
+        pcap_t *handle = pcap_open_dead(DLT_EN10MB, PACKET_RING_SNAPLEN);
+        if (pcap_compile(handle, &fp, filter, 0, PCAP_NETMASK_UNKNOWN) == -1) {
+            fprintf(stderr, "Can't parse filter '%s': %s\n", filter, pcap_geterr(handle));
+            printf("-----------------------------------\n");
+            pcap_close(handle);
+            packet_ring_close(ring);
+            exit(EXIT_FAILURE);
+        }
+        pcap_close(handle);
+        if (packet_ring_setfilter(ring, &fp, errbuf) == -1) {
+            fprintf(stderr, "Can't install filter '%s': %s\n", filter, errbuf);
+            printf("-----------------------------------\n");
+            packet_ring_close(ring);
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        printf("No filter applied, capturing all packets.\n");
+        printf("-----------------------------------\n");
+    }
+}
+
+/**
+ * @brief Set the filter on every ring of the fanout group if it exists /
+ * was set by the user
+ * 
+ * @param fanout 
+ * @param filter 
+ */
+void
+set_fanout_filter_if_exists(fanout_capture_t *fanout, char* filter)
+{
+    char errbuf[PCAP_ERRBUF_SIZE];
+    if (strcmp(filter, "") != 0) {
+        if (fanout_capture_setfilter(fanout, filter, errbuf) == -1) {
+            fprintf(stderr, "Can't install filter '%s': %s\n", filter, errbuf);
+            printf("-----------------------------------\n");
+            fanout_capture_close(fanout);
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        printf("No filter applied, capturing all packets.\n");
+        printf("-----------------------------------\n");
+    }
+}
+
+/**
+ * @brief What the kernel received and dropped during a live capture,
+ * dropped packets never reached us
+ */
+void
+print_capture_stats()
+{
+    if (capture_ring != NULL){
+        packet_ring_stats_t stats;
+        if (packet_ring_stats(capture_ring, &stats) == 0){
+            printf("%llu packets received, %llu dropped by the kernel (ring full %llu times).\n",
+                (unsigned long long)stats.received, (unsigned long long)stats.dropped,
+                (unsigned long long)stats.freezes);
+        }
+    } else if (capture_fanout != NULL){
+        packet_ring_stats_t total;
+        packet_ring_stats_t *per_worker = calloc(capture_fanout->worker_count, sizeof(packet_ring_stats_t));
+        fanout_capture_stats(capture_fanout, &total, per_worker);
+        printf("%llu packets received, %llu dropped by the kernel (ring full %llu times).\n",
+            (unsigned long long)total.received, (unsigned long long)total.dropped,
+            (unsigned long long)total.freezes);
+        for (int i = 0; i < capture_fanout->worker_count; i++){
+            printf("  thread %d (core %d): %llu received, %llu dropped.\n", i, capture_fanout->workers[i].cpu,
+                (unsigned long long)per_worker[i].received, (unsigned long long)per_worker[i].dropped);
+        }
+        free(per_worker);
+    } else if (capture != NULL){
+        struct pcap_stat stats;
+        if (pcap_stats(capture, &stats) == 0){
+            printf("%u packets received, %u dropped by the kernel, %u by the interface.\n",
+                stats.ps_recv, stats.ps_drop, stats.ps_ifdrop);
+        }
+    }
+}
+
 void
 cleanup()
 {
+    // the last batch and the footer of --export-columns
+    cli_columns_close();
+    cli_flows_close();
+    cli_dns_close();
+    cli_top_close();
+    cli_distinct_close();
+    cli_stats_close();
+    cli_profile_close();
     return;
 }
\ No newline at end of file
@@ -5,14 +5,29 @@
 #include <stdbool.h>
 #include "cli_helper.h"
 #include "cli_parser.h"
+#include "pcap_file.h"
+#include "packet_ring.h"
+#include "cli_fanout.h"
+#include "cli_parallel.h"
+#include "cli_columns.h"
+#include "cli_flows.h"
+#include "cli_dns.h"
+#include "cli_top.h"
+#include "cli_distinct.h"
+#include "cli_stats.h"
+#include "cli_profile.h"
 
 typedef struct {
     int verbosity;
 } handler_args_t;
 
-void start_capture(char* source, char* filter, int verbosity, bool is_live);
+void start_capture(char* source, char* filter, int verbosity, int jobs, int ring_block_size, int ring_blocks, bool is_live);
 
 void set_filter_if_exists(pcap_t *capture, char* filter);
+void set_file_filter_if_exists(pcap_file_t *file, char* filter);
+void set_ring_filter_if_exists(packet_ring_t *ring, char* filter);
+void set_fanout_filter_if_exists(fanout_capture_t *fanout, char* filter);
+void print_capture_stats();
 void signal_handler(int sig);
 void packet_handler(u_char *args, const struct pcap_pkthdr *header, const u_char *packet);
 void cleanup();
@@ -0,0 +1,182 @@
+#include "cli_columns.h"
+
+// the file being exported to, NULL when printing
+arrow_file_t *cli_columns = NULL;
+
+static const arrow_field_t column_fields[COLUMN_COUNT] = {
+    [COLUMN_TS] = {"ts", ARROW_TIMESTAMP_US},
+    [COLUMN_CAPLEN] = {"caplen", ARROW_UINT32},
+    [COLUMN_LEN] = {"len", ARROW_UINT32},
+    [COLUMN_ETH_SRC] = {"eth_src", ARROW_STRING_DICTIONARY},
+    [COLUMN_ETH_DST] = {"eth_dst", ARROW_STRING_DICTIONARY},
+    [COLUMN_ETH_TYPE] = {"eth_type", ARROW_UINT16},
+    [COLUMN_VLAN_ID] = {"vlan_id", ARROW_UINT16},
+    [COLUMN_IP_VERSION] = {"ip_version", ARROW_UINT8},
+    [COLUMN_IP_SRC] = {"ip_src", ARROW_STRING_DICTIONARY},
+    [COLUMN_IP_DST] = {"ip_dst", ARROW_STRING_DICTIONARY},
+    [COLUMN_IP_PROTOCOL] = {"ip_protocol", ARROW_UINT8},
+    [COLUMN_IP_TTL] = {"ip_ttl", ARROW_UINT8},
+    [COLUMN_IP_LENGTH] = {"ip_length", ARROW_UINT16},
+    [COLUMN_IP_DSCP] = {"ip_dscp", ARROW_UINT8},
+    [COLUMN_IP_ECN] = {"ip_ecn", ARROW_UINT8},
+    [COLUMN_IPV4_ID] = {"ipv4_id", ARROW_UINT16},
+    [COLUMN_IPV4_DONT_FRAGMENT] = {"ipv4_dont_fragment", ARROW_BOOL},
+    [COLUMN_IPV4_MORE_FRAGMENTS] = {"ipv4_more_fragments", ARROW_BOOL},
+    [COLUMN_IPV4_FRAGMENT_OFFSET] = {"ipv4_fragment_offset", ARROW_UINT16},
+    [COLUMN_IPV4_CHECKSUM_CORRECT] = {"ipv4_checksum_correct", ARROW_BOOL},
+    [COLUMN_IPV6_FLOW_LABEL] = {"ipv6_flow_label", ARROW_UINT32},
+    [COLUMN_SRC_PORT] = {"src_port", ARROW_UINT16},
+    [COLUMN_DST_PORT] = {"dst_port", ARROW_UINT16},
+    [COLUMN_TCP_SEQ] = {"tcp_seq", ARROW_UINT32},
+    [COLUMN_TCP_ACK] = {"tcp_ack", ARROW_UINT32},
+    [COLUMN_TCP_FLAGS] = {"tcp_flags", ARROW_UINT8},
+    [COLUMN_TCP_WINDOW] = {"tcp_window", ARROW_UINT16},
+    [COLUMN_TCP_CHECKSUM_CORRECT] = {"tcp_checksum_correct", ARROW_BOOL},
+    [COLUMN_UDP_LENGTH] = {"udp_length", ARROW_UINT16},
+    [COLUMN_UDP_CHECKSUM_CORRECT] = {"udp_checksum_correct", ARROW_BOOL},
+    [COLUMN_DNS_ID] = {"dns_id", ARROW_UINT16},
+    [COLUMN_DNS_QR] = {"dns_qr", ARROW_BOOL},
+    [COLUMN_DNS_OPCODE] = {"dns_opcode", ARROW_UINT8},
+    [COLUMN_DNS_RCODE] = {"dns_rcode", ARROW_UINT8},
+    [COLUMN_DNS_QDCOUNT] = {"dns_qdcount", ARROW_UINT16},
+    [COLUMN_DNS_ANCOUNT] = {"dns_ancount", ARROW_UINT16},
+    [COLUMN_DNS_QNAME] = {"dns_qname", ARROW_STRING_DICTIONARY},
+    [COLUMN_DNS_QTYPE] = {"dns_qtype", ARROW_UINT16},
+    [COLUMN_DNS_QCLASS] = {"dns_qclass", ARROW_UINT16},
+};
+
+/**
+ * @brief Create the export file, the packets go there from now on
+ *
+ * @param path
+ */
+void
+cli_columns_open(const char *path)
+{
+    char errbuf[ARROW_FILE_ERRBUF_SIZE];
+    cli_columns = arrow_file_create(path, column_fields, COLUMN_COUNT, ARROW_FILE_BATCH_ROWS, errbuf);
+    if (cli_columns == NULL){
+        fprintf(stderr, "Can't create '%s': %s.\n", path, errbuf);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// write the last batch and the footer
+void
+cli_columns_close()
+{
+    if (cli_columns == NULL){
+        return;
+    }
+    if (arrow_file_close(cli_columns) == -1){
+        fprintf(stderr, "Can't write the exported columns.\n");
+    }
+    cli_columns = NULL;
+}
+
+static void
+set_uint(column_t column, uint64_t value)
+{
+    arrow_file_set_uint(cli_columns, column, value);
+}
+
+static void
+set_bool(column_t column, bool value)
+{
+    arrow_file_set_bool(cli_columns, column, value);
+}
+
+// utf8 columns: the addresses, and the DNS names get_dns_name() escapes
+// to ASCII, whatever bytes their labels hold
+static void
+set_string(column_t column, const char *string)
+{
+    arrow_file_set_string(cli_columns, column, string, strlen(string));
+}
+
+/**
+ * @brief Write the dissection as one row of the export file
+ *
+ * @param pcap_header
+ * @param dissection
+ */
+void
+parse_columns(const struct pcap_pkthdr *pcap_header, const dissection_t *dissection)
+{
+    set_uint(COLUMN_TS, (uint64_t)pcap_header->ts.tv_sec * 1000000 + pcap_header->ts.tv_usec);
+    set_uint(COLUMN_CAPLEN, pcap_header->caplen);
+    set_uint(COLUMN_LEN, pcap_header->len);
+
+    if (dissection_has(dissection, LAYER_ETHERNET)){
+        const my_ethernet_header_t *ethernet_header = &dissection->ethernet;
+        set_string(COLUMN_ETH_SRC, ethernet_header->src_mac);
+        set_string(COLUMN_ETH_DST, ethernet_header->dst_mac);
+        set_uint(COLUMN_ETH_TYPE, ethernet_header->type);
+        if (ethernet_header->vlan_tagged){
+            set_uint(COLUMN_VLAN_ID, ethernet_header->vlan_id);
+        }
+    }
+
+    if (dissection_has(dissection, LAYER_IPV4)){
+        const my_ipv4_header_t *ipv4_header = &dissection->ipv4;
+        set_uint(COLUMN_IP_VERSION, ipv4_header->version);
+        set_string(COLUMN_IP_SRC, ipv4_header->source_ipv4);
+        set_string(COLUMN_IP_DST, ipv4_header->destination_ipv4);
+        set_uint(COLUMN_IP_PROTOCOL, ipv4_header->protocol);
+        set_uint(COLUMN_IP_TTL, ipv4_header->time_to_live);
+        set_uint(COLUMN_IP_LENGTH, ipv4_header->total_length);
+        set_uint(COLUMN_IP_DSCP, ipv4_header->dscp_value);
+        set_uint(COLUMN_IP_ECN, ipv4_header->ecn_value);
+        set_uint(COLUMN_IPV4_ID, ipv4_header->identification);
+        set_bool(COLUMN_IPV4_DONT_FRAGMENT, ipv4_header->flags.dont_fragment);
+        set_bool(COLUMN_IPV4_MORE_FRAGMENTS, ipv4_header->flags.more_fragments);
+        set_uint(COLUMN_IPV4_FRAGMENT_OFFSET, ipv4_header->fragment_offset);
+        set_bool(COLUMN_IPV4_CHECKSUM_CORRECT, ipv4_header->checksum_correct);
+    } else if (dissection_has(dissection, LAYER_IPV6)){
+        const my_ipv6_header_t *ipv6_header = &dissection->ipv6;
+        set_uint(COLUMN_IP_VERSION, ipv6_header->version);
+        set_string(COLUMN_IP_SRC, ipv6_header->source_address);
+        set_string(COLUMN_IP_DST, ipv6_header->destination_address);
+        set_uint(COLUMN_IP_PROTOCOL, ipv6_header->next_header);
+        set_uint(COLUMN_IP_TTL, ipv6_header->hop_limit);
+        set_uint(COLUMN_IP_LENGTH, ipv6_header->payload_length);
+        set_uint(COLUMN_IP_DSCP, ipv6_header->dscp_value);
+        set_uint(COLUMN_IP_ECN, ipv6_header->ecn_value);
+        set_uint(COLUMN_IPV6_FLOW_LABEL, ipv6_header->flow_label);
+    }
+
+    if (dissection_has(dissection, LAYER_TCP)){
+        const my_tcp_header_t *tcp_header = &dissection->tcp;
+        set_uint(COLUMN_SRC_PORT, tcp_header->source_port);
+        set_uint(COLUMN_DST_PORT, tcp_header->destination_port);
+        set_uint(COLUMN_TCP_SEQ, tcp_header->sequence_number);
+        set_uint(COLUMN_TCP_ACK, tcp_header->acknowledgment_number);
+        set_uint(COLUMN_TCP_FLAGS, tcp_header->flags);
+        set_uint(COLUMN_TCP_WINDOW, tcp_header->window);
+        set_bool(COLUMN_TCP_CHECKSUM_CORRECT, tcp_header->checksum_correct);
+    } else if (dissection_has(dissection, LAYER_UDP)){
+        const my_udp_header_t *udp_header = &dissection->udp;
+        set_uint(COLUMN_SRC_PORT, udp_header->source_port);
+        set_uint(COLUMN_DST_PORT, udp_header->destination_port);
+        set_uint(COLUMN_UDP_LENGTH, udp_header->length);
+        set_bool(COLUMN_UDP_CHECKSUM_CORRECT, udp_header->checksum_correct);
+    }
+
+    if (dissection_has(dissection, LAYER_DNS)){
+        const my_dns_header_t *dns_header = &dissection->dns;
+        set_uint(COLUMN_DNS_ID, dns_header->transaction_id);
+        set_bool(COLUMN_DNS_QR, dns_header->qr);
+        set_uint(COLUMN_DNS_OPCODE, dns_header->opcode);
+        set_uint(COLUMN_DNS_RCODE, dns_header->rcode);
+        set_uint(COLUMN_DNS_QDCOUNT, dns_header->qdcount);
+        set_uint(COLUMN_DNS_ANCOUNT, dns_header->ancount);
+        if (dns_header->question_section.count > 0){
+            question_section_t *question = dns_questions_items(&dns_header->question_section);
+            set_string(COLUMN_DNS_QNAME, question->qname);
+            set_uint(COLUMN_DNS_QTYPE, question->qtype);
+            set_uint(COLUMN_DNS_QCLASS, question->qclass);
+        }
+    }
+
+    arrow_file_end_row(cli_columns);
+}
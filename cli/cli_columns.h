@@ -0,0 +1,68 @@
+#ifndef CLI_COLUMNS_H
+#define CLI_COLUMNS_H
+
+#include <pcap.h>
+#include <stdint.h>
+#include "arrow_file.h"
+#include "cli_parser.h"
+
+/*
+--export-columns <file>: the decoded headers go to an Arrow IPC file, one
+row per packet, instead of the terminal.
+
+Layers a packet doesn't have are null; IPv4 and IPv6 share the ip_* columns,
+TCP and UDP the ports. Of the DNS questions only the first one is kept, next
+to the counts, of the messages of a TCP segment only the first one.
+Addresses and names are dictionary encoded.
+*/
+
+typedef enum column {
+    COLUMN_TS,
+    COLUMN_CAPLEN,
+    COLUMN_LEN,
+    COLUMN_ETH_SRC,
+    COLUMN_ETH_DST,
+    COLUMN_ETH_TYPE,
+    COLUMN_VLAN_ID,
+    COLUMN_IP_VERSION,
+    COLUMN_IP_SRC,
+    COLUMN_IP_DST,
+    COLUMN_IP_PROTOCOL,
+    COLUMN_IP_TTL,
+    COLUMN_IP_LENGTH,
+    COLUMN_IP_DSCP,
+    COLUMN_IP_ECN,
+    COLUMN_IPV4_ID,
+    COLUMN_IPV4_DONT_FRAGMENT,
+    COLUMN_IPV4_MORE_FRAGMENTS,
+    COLUMN_IPV4_FRAGMENT_OFFSET,
+    COLUMN_IPV4_CHECKSUM_CORRECT,
+    COLUMN_IPV6_FLOW_LABEL,
+    COLUMN_SRC_PORT,
+    COLUMN_DST_PORT,
+    COLUMN_TCP_SEQ,
+    COLUMN_TCP_ACK,
+    COLUMN_TCP_FLAGS,
+    COLUMN_TCP_WINDOW,
+    COLUMN_TCP_CHECKSUM_CORRECT,
+    COLUMN_UDP_LENGTH,
+    COLUMN_UDP_CHECKSUM_CORRECT,
+    COLUMN_DNS_ID,
+    COLUMN_DNS_QR,
+    COLUMN_DNS_OPCODE,
+    COLUMN_DNS_RCODE,
+    COLUMN_DNS_QDCOUNT,
+    COLUMN_DNS_ANCOUNT,
+    COLUMN_DNS_QNAME,
+    COLUMN_DNS_QTYPE,
+    COLUMN_DNS_QCLASS,
+    COLUMN_COUNT
+} column_t;
+
+extern arrow_file_t *cli_columns;
+
+void cli_columns_open(const char *path);
+void cli_columns_close();
+void parse_columns(const struct pcap_pkthdr *pcap_header, const dissection_t *dissection);
+
+#endif
@@ -0,0 +1,134 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+#include "cli_distinct.h"
+
+// the intervals the threads merged, NULL without --distinct
+cardinality_series_t *cli_distinct = NULL;
+static pthread_mutex_t cli_distinct_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// the calling thread's interval, merged into cli_distinct once its packets are past it
+static _Thread_local cardinality_interval_t cli_distinct_local;
+static _Thread_local bool cli_distinct_ready = false;
+
+static const char *distinct_kind_names[CARDINALITY_KINDS] = {
+    "sources", "destinations", "flows", "DNS names",
+};
+
+/**
+ * @brief Count the distinct keys from now on
+ *
+ * @param interval seconds of capture a row counts
+ */
+void
+cli_distinct_open(int interval)
+{
+    cli_distinct = cardinality_series_create((uint64_t)interval * 1000000, 0);
+}
+
+void
+cli_distinct_close()
+{
+    cli_distinct_release();
+    if (cli_distinct == NULL){
+        return;
+    }
+    cardinality_series_destroy(cli_distinct);
+    cli_distinct = NULL;
+}
+
+// the calling thread's interval into the series, under the lock
+static void
+merge_local()
+{
+    pthread_mutex_lock(&cli_distinct_lock);
+    if (cli_distinct != NULL){
+        cardinality_series_merge(cli_distinct, &cli_distinct_local);
+    }
+    pthread_mutex_unlock(&cli_distinct_lock);
+}
+
+/**
+ * @brief Count a decoded packet in the calling thread's interval, merge
+ * it when the packet starts the next one. A packet a little older than
+ * the interval (out of order) counts in it
+ *
+ * @param header
+ * @param dissection of the packet, its timestamp set
+ */
+void
+cli_distinct_update(const struct pcap_pkthdr *header, const dissection_t *dissection)
+{
+    (void)header;
+    uint64_t start = cardinality_interval_start(dissection->timestamp, cli_distinct->length);
+    if (!cli_distinct_ready){
+        cardinality_interval_init(&cli_distinct_local, cli_distinct->precision);
+        cardinality_interval_reset(&cli_distinct_local, start);
+        cli_distinct_ready = true;
+    } else if (start > cli_distinct_local.start){
+        merge_local();
+        cardinality_interval_reset(&cli_distinct_local, start);
+    }
+    cardinality_add(&cli_distinct_local, dissection);
+}
+
+/**
+ * @brief Merge the calling thread's last interval and free it, before
+ * the thread ends
+ *
+ */
+void
+cli_distinct_release()
+{
+    if (!cli_distinct_ready){
+        return;
+    }
+    merge_local();
+    cardinality_interval_destroy(&cli_distinct_local);
+    cli_distinct_ready = false;
+}
+
+static void
+print_row(const char *label, const cardinality_row_t *row)
+{
+    printf("%-20s %12llu %12.0f %12.0f %12.0f %12.0f %12.0f\n", label, (unsigned long long)row->packets,
+        row->estimates[CARDINALITY_SOURCES], row->estimates[CARDINALITY_DESTINATIONS], row->hosts,
+        row->estimates[CARDINALITY_FLOWS], row->estimates[CARDINALITY_QNAMES]);
+}
+
+/**
+ * @brief Print the distinct counts of every interval, then of the whole
+ * capture, once every thread released its interval
+ */
+void
+cli_distinct_summary()
+{
+    if (cli_distinct == NULL){
+        return;
+    }
+    cardinality_series_finish(cli_distinct);
+    printf("-----------------------------------\n");
+    printf("Distinct keys per %llu s (estimates, %u KB of sketches per thread):\n",
+        (unsigned long long)(cli_distinct->length / 1000000),
+        (unsigned)(CARDINALITY_KINDS * cli_distinct->hosts.size / 1024));
+    printf("%-20s %12s %12s %12s %12s %12s %12s\n", "interval (UTC)", "packets", distinct_kind_names[CARDINALITY_SOURCES],
+        distinct_kind_names[CARDINALITY_DESTINATIONS], "hosts", distinct_kind_names[CARDINALITY_FLOWS],
+        distinct_kind_names[CARDINALITY_QNAMES]);
+    for (uint32_t i = 0; i < cli_distinct->row_count; i++){
+        const cardinality_row_t *row = &cli_distinct->rows[i];
+        time_t seconds = (time_t)(row->start / 1000000);
+        struct tm utc;
+        char label[32];
+        gmtime_r(&seconds, &utc);
+        strftime(label, sizeof(label), "%Y-%m-%d %H:%M:%S", &utc);
+        print_row(label, row);
+    }
+    cardinality_row_t total;
+    cardinality_series_total(cli_distinct, &total);
+    print_row("whole capture", &total);
+    if (cli_distinct->late > 0){
+        printf("%llu intervals of threads far behind, counted in the whole capture only.\n",
+            (unsigned long long)cli_distinct->late);
+    }
+}
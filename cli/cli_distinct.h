@@ -0,0 +1,31 @@
+#ifndef CLI_DISTINCT_H
+#define CLI_DISTINCT_H
+
+#include <pcap.h>
+#include <stdint.h>
+#include "dissector.h"
+#include "cardinality.h"
+
+/*
+--distinct S: how many distinct sources, destinations, hosts, flows and
+DNS names asked, per S seconds of capture time and in the whole capture,
+from the HyperLogLog sketches of cardinality.h: 2^HYPERLOGLOG_PRECISION
+bytes a kind, about 0.8% off, however many there are. Each decoding
+thread counts the packets it decodes into its own interval and merges it
+into the series when its packets move to the next one, or when it ends;
+the table is printed when the capture stops.
+*/
+
+// the layers the counts read, decoded whatever the output
+#define CLI_DISTINCT_LAYERS (LAYER_BIT(LAYER_IPV4) | LAYER_BIT(LAYER_IPV6) | LAYER_BIT(LAYER_TCP) | LAYER_BIT(LAYER_UDP) \
+                             | LAYER_BIT(LAYER_DNS) | LAYER_DNS_SECTIONS)
+
+extern cardinality_series_t *cli_distinct;
+
+void cli_distinct_open(int interval);
+void cli_distinct_close();
+void cli_distinct_update(const struct pcap_pkthdr *header, const dissection_t *dissection);
+void cli_distinct_release();
+void cli_distinct_summary();
+
+#endif
@@ -0,0 +1,150 @@
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include "cli_dns.h"
+#include "addr_format.h"
+
+// the DNS transactions of the threads that ended, NULL without --dns
+dns_tracker_t *cli_dns = NULL;
+// the queries still waiting in their trackers when they ended
+static uint64_t cli_dns_pending = 0;
+static pthread_mutex_t cli_dns_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// the calling thread's tracker, merged into cli_dns when it ends
+static _Thread_local dns_tracker_t *cli_dns_local = NULL;
+
+// the names of RFC 6895, the unassigned ones are printed as numbers
+static const char *rcode_names[DNS_RCODES] = {
+    "NOERROR", "FORMERR", "SERVFAIL", "NXDOMAIN", "NOTIMP", "REFUSED",
+    "YXDOMAIN", "YXRRSET", "NXRRSET", "NOTAUTH", "NOTZONE",
+};
+
+void
+cli_dns_open()
+{
+    cli_dns = dns_tracker_create(DNS_TRACKER_CAPACITY, DNS_TRACKER_TIMEOUT);
+}
+
+void
+cli_dns_close()
+{
+    cli_dns_release();
+    if (cli_dns == NULL){
+        return;
+    }
+    dns_tracker_destroy(cli_dns);
+    cli_dns = NULL;
+}
+
+/**
+ * @brief Pair a decoded packet in the calling thread's tracker
+ *
+ * @param dissection of the packet, CLI_DNS_LAYERS at least, its timestamp set
+ */
+void
+cli_dns_update(const dissection_t *dissection)
+{
+    if (cli_dns_local == NULL){
+        cli_dns_local = dns_tracker_create(DNS_TRACKER_CAPACITY, DNS_TRACKER_TIMEOUT);
+    }
+    dns_tracker_update(cli_dns_local, dissection);
+}
+
+/**
+ * @brief Add the calling thread's counts and response times to the
+ * summary and free its tracker, before the thread ends
+ *
+ */
+void
+cli_dns_release()
+{
+    if (cli_dns_local == NULL){
+        return;
+    }
+    pthread_mutex_lock(&cli_dns_lock);
+    if (cli_dns != NULL){
+        dns_tracker_merge(cli_dns, cli_dns_local);
+        cli_dns_pending += cli_dns_local->count;
+    }
+    pthread_mutex_unlock(&cli_dns_lock);
+    dns_tracker_destroy(cli_dns_local);
+    cli_dns_local = NULL;
+}
+
+// one line of response times, in milliseconds
+static void
+print_latency(const char *name, const histogram_t *latency)
+{
+    printf("%-40s %10llu %10.3f %10.3f %10.3f %10.3f\n", name, (unsigned long long)latency->count,
+        histogram_percentile(latency, 50) / 1e3, histogram_percentile(latency, 99) / 1e3,
+        histogram_percentile(latency, 99.9) / 1e3, latency->max / 1e3);
+}
+
+/**
+ * @brief Print the DNS counters, the response times of all the answers,
+ * per rcode and of the servers asked the most
+ */
+void
+cli_dns_summary()
+{
+    if (cli_dns == NULL){
+        return;
+    }
+    dns_tracker_t *tracker = cli_dns;
+    printf("-----------------------------------\n");
+    printf("DNS: %llu queries, %llu answered, %llu timed out, %llu evicted, %llu pending, %llu sent again, %llu responses to no query.\n",
+        (unsigned long long)tracker->queries, (unsigned long long)tracker->answered,
+        (unsigned long long)tracker->timeouts, (unsigned long long)tracker->evicted, (unsigned long long)cli_dns_pending,
+        (unsigned long long)tracker->retransmitted, (unsigned long long)tracker->unmatched);
+    if (tracker->answered == 0){
+        return;
+    }
+
+    printf("%-40s %10s %10s %10s %10s %10s\n", "response time (ms)", "answers", "p50", "p99", "p99.9", "max");
+    print_latency("all", &tracker->latency);
+    for (uint32_t rcode = 0; rcode < DNS_RCODES; rcode++){
+        if (tracker->rcode_latency[rcode].count == 0){
+            continue;
+        }
+        char name[16];
+        if (rcode_names[rcode] == NULL){
+            snprintf(name, sizeof(name), "rcode %u", rcode);
+        }
+        print_latency(rcode_names[rcode] != NULL ? rcode_names[rcode] : name, &tracker->rcode_latency[rcode]);
+    }
+
+    // the servers asked the most, kept sorted while walking the table
+    const dns_server_t *top[CLI_DNS_TOP];
+    int top_count = 0;
+    for (uint32_t index = 0; index <= DNS_TRACKER_SERVERS; index++){
+        const dns_server_t *server = &tracker->servers[index];
+        if (server->queries == 0 || (top_count == CLI_DNS_TOP && server->queries <= top[top_count - 1]->queries)){
+            continue;
+        }
+        int i = (top_count < CLI_DNS_TOP) ? top_count++ : top_count - 1;
+        while (i > 0 && top[i - 1]->queries < server->queries){
+            top[i] = top[i - 1];
+            i--;
+        }
+        top[i] = server;
+    }
+
+    printf("Top %d servers by queries:\n", top_count);
+    printf("%-40s %10s %10s %10s %10s %10s %10s\n", "server", "queries", "timeouts", "answers", "p50", "p99", "p99.9");
+    for (int i = 0; i < top_count; i++){
+        const dns_server_t *server = top[i];
+        char address[IPV6_ADDRESS_STRLEN];
+        if (server->version == 4){
+            format_ipv4_address(server->address, address);
+        } else if (server->version == 6){
+            format_ipv6_address(server->address, address);
+        } else {
+            strcpy(address, "other");
+        }
+        printf("%-40s %10llu %10llu %10llu %10.3f %10.3f %10.3f\n", address, (unsigned long long)server->queries,
+            (unsigned long long)server->timeouts, (unsigned long long)server->latency.count,
+            histogram_percentile(&server->latency, 50) / 1e3, histogram_percentile(&server->latency, 99) / 1e3,
+            histogram_percentile(&server->latency, 99.9) / 1e3);
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef CLI_DNS_H
+#define CLI_DNS_H
+
+#include <pcap.h>
+#include <stdint.h>
+#include "dissector.h"
+#include "dns_tracker.h"
+
+/*
+--dns: the DNS queries over UDP are paired with their responses, the
+response times (p50, p99, p99.9) of all of them, per rcode and per server
+are printed when the capture stops. Each decoding thread pairs the packets
+it decodes, from their dissection, in its own tracker: with -j both ways
+of a flow go to the same thread. Its counts are added to the summary when
+it ends.
+*/
+
+#define CLI_DNS_TOP 20
+
+// the layers the tracker reads, decoded whatever the output
+#define CLI_DNS_LAYERS (LAYER_KEYS | LAYER_BIT(LAYER_DNS))
+
+extern dns_tracker_t *cli_dns;
+
+void cli_dns_open();
+void cli_dns_close();
+void cli_dns_update(const dissection_t *dissection);
+void cli_dns_release();
+void cli_dns_summary();
+
+#endif
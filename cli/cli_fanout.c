@@ -0,0 +1,239 @@
+#define _GNU_SOURCE // pthread_setaffinity_np
+#include "cli_fanout.h"
+#include "cli_parser.h"
+#include "cli_dns.h"
+#include "cli_top.h"
+#include "cli_distinct.h"
+#include "cli_stats.h"
+#include "cli_profile.h"
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+// the workers take turns writing to the data fd
+static pthread_mutex_t fanout_output_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// packet numbers, reserved a block at a time
+static _Atomic uint64_t fanout_packet_number = 0;
+
+/**
+ * @brief Open worker_count rings on the device, one per worker
+ *
+ * @param device
+ * @param worker_count
+ * @param block_size of every ring, PACKET_RING_BLOCK_SIZE if 0
+ * @param block_count of every ring, PACKET_RING_BLOCK_COUNT if 0
+ * @param errbuf
+ * @return fanout_capture_t* NULL if a ring can't be created
+ */
+fanout_capture_t*
+fanout_capture_open(const char *device, int worker_count, uint32_t block_size, uint32_t block_count, char *errbuf)
+{
+    fanout_capture_t *fanout = calloc(1, sizeof(fanout_capture_t));
+    fanout_worker_t *workers = calloc(worker_count, sizeof(fanout_worker_t));
+    if (fanout == NULL || workers == NULL){
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    fanout->workers = workers;
+
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 0; i < worker_count; i++){
+        workers[i].ring = packet_ring_open(device, block_size, block_count, errbuf);
+        if (workers[i].ring == NULL){
+            fanout_capture_close(fanout);
+            return NULL;
+        }
+        workers[i].cpu = i % (cpu_count > 0 ? cpu_count : 1);
+        fanout->worker_count++;
+    }
+    return fanout;
+}
+
+/**
+ * @brief Compile the filter for every ring, the kernel runs it in front of each
+ *
+ * @param fanout
+ * @param filter
+ * @param errbuf
+ * @return int 0, -1 if it can't be compiled or installed
+ */
+int
+fanout_capture_setfilter(fanout_capture_t *fanout, const char *filter, char *errbuf)
+{
+    pcap_t *handle = pcap_open_dead(DLT_EN10MB, PACKET_RING_SNAPLEN);
+    for (int i = 0; i < fanout->worker_count; i++){
+        struct bpf_program fp;
+        if (pcap_compile(handle, &fp, filter, 0, PCAP_NETMASK_UNKNOWN) == -1){
+            snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s", pcap_geterr(handle));
+            pcap_close(handle);
+            return -1;
+        }
+        if (packet_ring_setfilter(fanout->workers[i].ring, &fp, errbuf) == -1){
+            pcap_close(handle);
+            return -1;
+        }
+    }
+    pcap_close(handle);
+    return 0;
+}
+
+/**
+ * @brief Write the worker's text, whole packets only
+ *
+ * @param worker
+ */
+static void
+fanout_write(fanout_worker_t *worker)
+{
+    if (worker->sink.length == 0){
+        return;
+    }
+    pthread_mutex_lock(&fanout_output_lock);
+    worker->sink.fd = cli_data_fd();
+    output_sink_flush(&worker->sink);
+    worker->sink.fd = OUTPUT_SINK_NO_FD;
+    pthread_mutex_unlock(&fanout_output_lock);
+}
+
+/**
+ * @brief Decode one ring, a block at a time, on the worker's core
+ *
+ * @param args
+ * @return void*
+ */
+static void*
+fanout_worker(void *args)
+{
+    fanout_worker_t *worker = (fanout_worker_t*)args;
+    packet_ring_t *ring = worker->ring;
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(worker->cpu, &cpus);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0){
+        fprintf(stderr, "Can't pin a capture thread to core %d, it will float.\n", worker->cpu);
+    }
+
+    // kept in memory, written out when the block is done
+    output_sink_init(&worker->sink, OUTPUT_SINK_NO_FD, FANOUT_FLUSH_SIZE);
+    cli_sink = &worker->sink;
+
+    packet_ring_block_t block;
+    struct pcap_pkthdr *header;
+    const u_char *packet;
+    while (!ring->break_loop){
+        int status = packet_ring_next_block(ring, &block, PACKET_RING_TIMEOUT_MS);
+        if (status == -1){
+            break;
+        }
+        if (status == 0){
+            continue;
+        }
+        uint64_t packet_number = atomic_fetch_add_explicit(&fanout_packet_number, block.packet_count, memory_order_relaxed);
+        while (packet_ring_block_next(ring, &block, &header, &packet)){
+            parse_cli_nth(header, packet, worker->verbosity, packet_number++);
+            if (worker->sink.length >= FANOUT_FLUSH_SIZE){
+                fanout_write(worker);
+            }
+        }
+        packet_ring_release_block(ring, &block);
+        fanout_write(worker);
+    }
+
+    cli_sink = NULL;
+    output_sink_destroy(&worker->sink);
+    cli_arena_release();
+    cli_reassembly_release();
+    cli_tcp_reassembly_release();
+    cli_dns_release();
+    cli_top_release();
+    cli_distinct_release();
+    cli_stats_release();
+    cli_profile_release();
+    return NULL;
+}
+
+/**
+ * @brief Join the rings into one fanout group and decode them until
+ * fanout_capture_breakloop()
+ *
+ * @param fanout
+ * @param verbosity
+ */
+void
+fanout_capture_loop(fanout_capture_t *fanout, int verbosity)
+{
+    char errbuf[PCAP_ERRBUF_SIZE];
+    // one group per process, the id only has to be unique on the host
+    uint16_t group = getpid() & 0xffff;
+    for (int i = 0; i < fanout->worker_count; i++){
+        if (packet_ring_join_fanout(fanout->workers[i].ring, group, errbuf) == -1){
+            fprintf(stderr, "Can't join the fanout group: %s.\n", errbuf);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // the workers bypass stdio
+    fflush(stdout);
+    for (int i = 0; i < fanout->worker_count; i++){
+        fanout->workers[i].verbosity = verbosity;
+        if (pthread_create(&fanout->workers[i].thread, NULL, fanout_worker, &fanout->workers[i]) != 0){
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < fanout->worker_count; i++){
+        pthread_join(fanout->workers[i].thread, NULL);
+    }
+}
+
+/**
+ * @brief Stop every worker after its current block (signal safe)
+ *
+ * @param fanout
+ */
+void
+fanout_capture_breakloop(fanout_capture_t *fanout)
+{
+    for (int i = 0; i < fanout->worker_count; i++){
+        packet_ring_breakloop(fanout->workers[i].ring);
+    }
+}
+
+/**
+ * @brief The kernel counters of every ring, and their sum
+ *
+ * @param fanout
+ * @param total
+ * @param per_worker worker_count of them, or NULL
+ */
+void
+fanout_capture_stats(fanout_capture_t *fanout, packet_ring_stats_t *total, packet_ring_stats_t *per_worker)
+{
+    memset(total, 0, sizeof(packet_ring_stats_t));
+    for (int i = 0; i < fanout->worker_count; i++){
+        packet_ring_stats_t stats = {0};
+        packet_ring_stats(fanout->workers[i].ring, &stats);
+        total->received += stats.received;
+        total->dropped += stats.dropped;
+        total->freezes += stats.freezes;
+        if (per_worker != NULL){
+            per_worker[i] = stats;
+        }
+    }
+}
+
+void
+fanout_capture_close(fanout_capture_t *fanout)
+{
+    if (fanout == NULL){
+        return;
+    }
+    for (int i = 0; i < fanout->worker_count; i++){
+        packet_ring_close(fanout->workers[i].ring);
+    }
+    free(fanout->workers);
+    free(fanout);
+}
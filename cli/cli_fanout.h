@@ -0,0 +1,54 @@
+#ifndef CLI_FANOUT_H
+#define CLI_FANOUT_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pcap.h>
+#include "packet_ring.h"
+#include "output_sink.h"
+
+/*
+Live capture on several threads (-i with -j N).
+
+            +--> ring 0 --> worker 0 (core 0) --+
+device -----+--> ring 1 --> worker 1 (core 1) --+--> stdout
+  (fanout)  +--> ring N --> worker N (core N) --+
+
+N packet rings on the device join one PACKET_FANOUT group, the kernel
+spreads the packets between them on a symmetric hash of the flow. Every
+ring is read and decoded by its own thread, pinned to a core, with nothing
+shared: there is no global order in a live capture. Workers render in
+their own sink and write whole packets, one large write at a time.
+
+To try it without a mirror port, a veth pair and a local generator:
+
+    ip link add veth0 type veth peer name veth1
+    ip link set veth0 up && ip link set veth1 up
+    pcapna -i veth1 -j 4 &
+    tcpreplay -i veth0 --topspeed capture.pcap
+*/
+
+#define FANOUT_FLUSH_SIZE (1 << 20) // a worker writes its text past that
+
+typedef struct fanout_worker {
+    packet_ring_t *ring;
+    int cpu;
+    int verbosity;
+    output_sink_t sink;
+    pthread_t thread;
+} fanout_worker_t;
+
+typedef struct fanout_capture {
+    fanout_worker_t *workers;
+    int worker_count;
+} fanout_capture_t;
+
+fanout_capture_t* fanout_capture_open(const char *device, int worker_count, uint32_t block_size, uint32_t block_count, char *errbuf);
+int fanout_capture_setfilter(fanout_capture_t *fanout, const char *filter, char *errbuf);
+void fanout_capture_loop(fanout_capture_t *fanout, int verbosity);
+void fanout_capture_breakloop(fanout_capture_t *fanout);
+void fanout_capture_stats(fanout_capture_t *fanout, packet_ring_stats_t *total, packet_ring_stats_t *per_worker);
+void fanout_capture_close(fanout_capture_t *fanout);
+
+#endif
@@ -0,0 +1,150 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include "cli_flows.h"
+#include "addr_format.h"
+
+// the flows of the capture, NULL without --flows
+flow_table_t *cli_flows = NULL;
+
+void
+cli_flows_open()
+{
+    cli_flows = flow_table_create(FLOW_TABLE_CAPACITY, FLOW_IDLE_TIMEOUT);
+}
+
+void
+cli_flows_close()
+{
+    if (cli_flows == NULL){
+        return;
+    }
+    flow_table_destroy(cli_flows);
+    cli_flows = NULL;
+}
+
+void
+cli_flows_update(const struct pcap_pkthdr *header, const uint8_t *packet)
+{
+    uint64_t timestamp = (uint64_t)header->ts.tv_sec * 1000000 + header->ts.tv_usec;
+    flow_table_update(cli_flows, packet, header->caplen, header->len, timestamp);
+}
+
+/**
+ * @brief Write "address:port" of one end of the flow, IPv6 in brackets
+ *
+ * @param key
+ * @param a endpoint a or b
+ * @param buffer
+ * @param size
+ */
+static void
+write_endpoint(const flow_key_t *key, bool a, char *buffer, size_t size)
+{
+    char address[IPV6_ADDRESS_STRLEN];
+    const uint8_t *raw = a ? key->address_a : key->address_b;
+    uint16_t port = a ? key->port_a : key->port_b;
+    if (key->version == 4){
+        format_ipv4_address(raw, address);
+        snprintf(buffer, size, "%s:%u", address, port);
+    } else {
+        format_ipv6_address(raw, address);
+        snprintf(buffer, size, "[%s]:%u", address, port);
+    }
+}
+
+static const char*
+get_protocol_name(uint8_t protocol, char *buffer, size_t size)
+{
+    switch (protocol){
+        case IPPROTO_TCP:
+            return "TCP";
+        case IPPROTO_UDP:
+            return "UDP";
+        case IPPROTO_ICMP:
+            return "ICMP";
+        case IPPROTO_ICMPV6:
+            return "ICMPv6";
+        default:
+            snprintf(buffer, size, "%u", protocol);
+            return buffer;
+    }
+}
+
+// one letter per flag seen, FIN first, '-' if none
+static void
+write_tcp_flags(uint8_t flags, char *buffer)
+{
+    const char letters[] = "FSRPAUEC";
+    int length = 0;
+    for (int i = 0; i < 8; i++){
+        if (flags & (1 << i)){
+            buffer[length++] = letters[i];
+        }
+    }
+    if (length == 0){
+        buffer[length++] = '-';
+    }
+    buffer[length] = '\0';
+}
+
+static uint64_t
+flow_bytes(const flow_t *flow)
+{
+    return flow->bytes[0] + flow->bytes[1];
+}
+
+/**
+ * @brief Print the flow counters and the biggest flows still in the table
+ */
+void
+cli_flows_summary()
+{
+    if (cli_flows == NULL){
+        return;
+    }
+    flow_table_t *table = cli_flows;
+    printf("-----------------------------------\n");
+    printf("Flows: %llu seen, %u active, %llu expired, %llu evicted, %llu packets not IP.\n",
+        (unsigned long long)table->created, table->count, (unsigned long long)table->expired,
+        (unsigned long long)table->evicted, (unsigned long long)table->untracked);
+    if (table->count == 0){
+        return;
+    }
+
+    // the biggest ones, kept sorted while walking the table
+    const flow_t *top[CLI_FLOWS_TOP];
+    int top_count = 0;
+    for (uint32_t index = table->lru_head; index != FLOW_NONE; index = table->flows[index].lru_next){
+        const flow_t *flow = &table->flows[index];
+        if (top_count == CLI_FLOWS_TOP && flow_bytes(flow) <= flow_bytes(top[top_count - 1])){
+            continue;
+        }
+        int i = (top_count < CLI_FLOWS_TOP) ? top_count++ : top_count - 1;
+        while (i > 0 && flow_bytes(top[i - 1]) < flow_bytes(flow)){
+            top[i] = top[i - 1];
+            i--;
+        }
+        top[i] = flow;
+    }
+
+    printf("Top %d active flows by bytes:\n", top_count);
+    printf("%-6s %-47s %-47s %10s %12s %8s %10s\n",
+        "proto", "initiator", "responder", "packets", "bytes", "flags", "seconds");
+    for (int i = 0; i < top_count; i++){
+        const flow_t *flow = top[i];
+        char initiator[INET6_ADDRSTRLEN + 16];
+        char responder[INET6_ADDRSTRLEN + 16];
+        char protocol[4];
+        char flags[9];
+        write_endpoint(&flow->key, flow->initiator_is_a, initiator, sizeof(initiator));
+        write_endpoint(&flow->key, !flow->initiator_is_a, responder, sizeof(responder));
+        write_tcp_flags(flow->tcp_flags, flags);
+        printf("%-6s %-47s %-47s %4llu/%-5llu %12llu %8s %10.3f\n",
+            get_protocol_name(flow->key.protocol, protocol, sizeof(protocol)), initiator, responder,
+            (unsigned long long)flow->packets[0], (unsigned long long)flow->packets[1],
+            (unsigned long long)flow_bytes(flow), flow->key.protocol == IPPROTO_TCP ? flags : "",
+            (flow->last_seen - flow->first_seen) / 1e6);
+    }
+}
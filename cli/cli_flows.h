@@ -0,0 +1,23 @@
+#ifndef CLI_FLOWS_H
+#define CLI_FLOWS_H
+
+#include <pcap.h>
+#include <stdint.h>
+#include "flow_table.h"
+
+/*
+--flows: every packet also goes through the flow table, a summary of the
+conversations is printed when the capture stops. With -j the reader thread
+updates the table, before handing the packet to a worker.
+*/
+
+#define CLI_FLOWS_TOP 20
+
+extern flow_table_t *cli_flows;
+
+void cli_flows_open();
+void cli_flows_close();
+void cli_flows_update(const struct pcap_pkthdr *header, const uint8_t *packet);
+void cli_flows_summary();
+
+#endif
@@ -17,6 +17,22 @@ display_help()
     printf("  -f <filter>    : BPF filter (optional)\n");
     printf("  -o <file>      : input file for offline capture\n");
     printf("  -v <1..3>      : verbose level (1=concise ; 2=summary ; 3=full)\n");
+    printf("  -j <jobs>      : decode on <jobs> threads (default 1), live: one socket per thread\n");
+    printf("                   offline, fragmented IPv4 TCP isn't reassembled into its stream\n");
+    printf("  --format <fmt> : text (default) or ndjson, one JSON object per packet\n");
+    printf("  --export-columns <file> : write the decoded headers to an Arrow IPC file instead\n");
+    printf("  --flows        : track the connections, print a summary at the end\n");
+    printf("  --dns          : pair the DNS queries with their responses, print the response times at the end\n");
+    printf("  --top <N>      : the N heaviest addresses, ports and DNS names, printed at the end\n");
+    printf("  --top-memory <KB>      : memory of the --top sketches per thread (default %u)\n", TOP_TALKERS_MEMORY / 1024);
+    printf("  --top-interval <s>     : print --top every <s> seconds of capture too, single thread\n");
+    printf("  --distinct <s>         : estimate the distinct hosts, flows and DNS names per <s> seconds of capture\n");
+    printf("  --stats <file>         : packets and bytes per protocol over time, CSV or NDJSON (.ndjson, .json)\n");
+    printf("  --stats-bucket <ms>    : capture time a row of --stats counts (default %d)\n", CLI_STATS_BUCKET);
+    printf("  --stats-interval <s>   : write the --stats rows every <s> seconds of capture (default %d)\n", CLI_STATS_INTERVAL);
+    printf("  --profile              : time every stage of the packets, print where the time went at the end\n");
+    printf("  --ring-block-size <KB> : live capture ring, size of a block (default %d)\n", PACKET_RING_BLOCK_SIZE / 1024);
+    printf("  --ring-blocks <count>  : live capture ring, number of blocks (default %d)\n", PACKET_RING_BLOCK_COUNT);
     printf("  --help: display this help message\n");
     printf("  --list-interfaces: list all available interfaces\n");
     printf("  --version: display the version of pcapna CLI\n");
@@ -49,28 +65,61 @@ display_interfaces()
     free_interfaces(alldevsp_head);
 }
 
+/**
+ * @brief Copy the argument of an option into its CMD_ARG_SIZE buffer,
+ * exit if it doesn't fit
+ * 
+ * @param destination 
+ * @param argument 
+ * @param option its name, for the message
+ */
+static void
+copy_argument(char *destination, const char *argument, const char *option)
+{
+    if (snprintf(destination, CMD_ARG_SIZE, "%s", argument) >= CMD_ARG_SIZE){
+        fprintf(stderr, "The argument of %s is too long, %d characters at most.\n", option, CMD_ARG_SIZE - 1);
+        exit(EXIT_FAILURE);
+    }
+}
+
 /**
  * @brief Get the arguments from the command line
  * 
  * @param argc 
  * @param argv 
- * @param interface 
- * @param filename 
- * @param filter 
- * @param verbosity 
+ * @param options filled in, from the defaults
  */
 void 
-get_arguments(int argc, char** argv, char *interface, char *filename, char *filter, int *verbosity){
+get_arguments(int argc, char** argv, cli_options_t *options){
     int opt;
     int option_index = 0;
-    struct option long_options[4] = {
+    struct option long_options[18] = {
         {"help", no_argument, 0, 0},
         {"version", no_argument, 0, 0},
         {"list-interfaces", no_argument, 0, 0},
+        {"format", required_argument, 0, 0},
+        {"export-columns", required_argument, 0, 0},
+        {"flows", no_argument, 0, 0},
+        {"dns", no_argument, 0, 0},
+        {"top", required_argument, 0, 0},
+        {"top-memory", required_argument, 0, 0},
+        {"top-interval", required_argument, 0, 0},
+        {"distinct", required_argument, 0, 0},
+        {"stats", required_argument, 0, 0},
+        {"stats-bucket", required_argument, 0, 0},
+        {"stats-interval", required_argument, 0, 0},
+        {"profile", no_argument, 0, 0},
+        {"ring-block-size", required_argument, 0, 0},
+        {"ring-blocks", required_argument, 0, 0},
         {0, 0, 0, 0}
     };
 
-    while ((opt = getopt_long(argc, argv, "i:o:f:v:", long_options, &option_index)) != -1) {
+    memset(options, 0, sizeof(*options));
+    options->verbosity = 1;
+    options->jobs = 1;
+    options->format = FORMAT_TEXT;
+
+    while ((opt = getopt_long(argc, argv, "i:o:f:v:j:", long_options, &option_index)) != -1) {
         switch (opt) {
             case 0:
                 if (strcmp("help", long_options[option_index].name) == 0) {
@@ -83,28 +132,77 @@ get_arguments(int argc, char** argv, char *interface, char *filename, char *filt
                     printf("Listing interfaces...\n");
                     display_interfaces();
                     exit(EXIT_SUCCESS);
+                } else if (strcmp("format", long_options[option_index].name) == 0) {
+                    options->format = get_format(optarg);
+                } else if (strcmp("export-columns", long_options[option_index].name) == 0) {
+                    copy_argument(options->export_path, optarg, "--export-columns");
+                } else if (strcmp("flows", long_options[option_index].name) == 0) {
+                    options->flows = true;
+                } else if (strcmp("dns", long_options[option_index].name) == 0) {
+                    options->dns = true;
+                } else if (strcmp("top", long_options[option_index].name) == 0) {
+                    options->top = atoi(optarg);
+                } else if (strcmp("top-memory", long_options[option_index].name) == 0) {
+                    options->top_memory = atoi(optarg);
+                } else if (strcmp("top-interval", long_options[option_index].name) == 0) {
+                    options->top_interval = atoi(optarg);
+                } else if (strcmp("distinct", long_options[option_index].name) == 0) {
+                    options->distinct = atoi(optarg);
+                } else if (strcmp("stats", long_options[option_index].name) == 0) {
+                    copy_argument(options->stats_path, optarg, "--stats");
+                } else if (strcmp("stats-bucket", long_options[option_index].name) == 0) {
+                    options->stats_bucket = atoi(optarg);
+                } else if (strcmp("stats-interval", long_options[option_index].name) == 0) {
+                    options->stats_interval = atoi(optarg);
+                } else if (strcmp("profile", long_options[option_index].name) == 0) {
+                    options->profile = true;
+                } else if (strcmp("ring-block-size", long_options[option_index].name) == 0) {
+                    options->ring_block_size = atoi(optarg);
+                } else if (strcmp("ring-blocks", long_options[option_index].name) == 0) {
+                    options->ring_blocks = atoi(optarg);
                 }
                 break;
             case 'i':
-                strcpy(interface, optarg);
+                copy_argument(options->interface, optarg, "-i");
                 break;
             case 'o':
-                strcpy(filename, optarg);
+                copy_argument(options->filename, optarg, "-o");
                 break;
             case 'f':
-                strcpy(filter, optarg);
+                copy_argument(options->filter, optarg, "-f");
                 break;
             case 'v':
-                *verbosity = atoi(optarg);
+                options->verbosity = atoi(optarg);
+                break;
+            case 'j':
+                options->jobs = atoi(optarg);
                 break;
             default:
-                fprintf(stderr, "Usage: %s [--help] [--version] [--list-interfaces] [-i interface] [-o filename] [-f filter] [-v verbosity]\n", argv[0]);
+                fprintf(stderr, "Usage: %s [--help] [--version] [--list-interfaces] [-i interface] [-o filename] [-f filter] [-v verbosity] [-j jobs] [--format text|ndjson] [--export-columns file] [--flows] [--dns] [--top N] [--top-memory KB] [--top-interval s] [--distinct s] [--stats file] [--stats-bucket ms] [--stats-interval s] [--profile] [--ring-block-size KB] [--ring-blocks count]\n", argv[0]);
                 fprintf(stderr, "Try '%s --help' for more information.\n", argv[0]);
                 exit(EXIT_FAILURE);
         }
     }
 }
 
+/**
+ * @brief The output format called name
+ * 
+ * @param name 
+ * @return int FORMAT_TEXT, FORMAT_NDJSON or -1 if unknown
+ */
+int
+get_format(const char *name)
+{
+    if (strcmp(name, "text") == 0){
+        return FORMAT_TEXT;
+    }
+    if (strcmp(name, "ndjson") == 0){
+        return FORMAT_NDJSON;
+    }
+    return -1;
+}
+
 /**
  * @brief Checks to see if the given interface exists
  * 
@@ -112,7 +210,7 @@ get_arguments(int argc, char** argv, char *interface, char *filename, char *filt
  * @return int 
  */
 int 
-check_interface(char* interface)
+check_interface(const char* interface)
 {   
     printf("Checking interface... '%s'.\n", interface);
     pcap_if_t *alldevsp;
@@ -141,7 +239,7 @@ check_interface(char* interface)
  * @return int 
  */
 int
-check_file(char* filename)
+check_file(const char* filename)
 {
     printf("Checking file... '%s'\n", filename);
     int fd = open(filename, O_RDONLY);
@@ -161,7 +259,7 @@ check_file(char* filename)
  * @return int 
  */
 int
-check_filter(char* filter)
+check_filter(const char* filter)
 {
     printf("Checking filter... '%s'.\n", filter);
 
@@ -185,58 +283,198 @@ check_filter(char* filter)
 /**
  * @brief Check that we're good to go!
  * 
- * @param interface 
- * @param filename 
- * @param filter 
- * @param verbosity 
+ * @param options 
  */
 void
-check_all(char* interface, char* filename, char* filter, int verbosity)
+check_all(const cli_options_t *options)
 {
     printf("-----------------------------------\n");
 
-    if ((strcmp(interface, "") != 0) && (strcmp(filename, "") != 0)){
+    if ((strcmp(options->interface, "") != 0) && (strcmp(options->filename, "") != 0)){
         fprintf(stderr, "Can't choose an interface and a file at the same time.\n");
         fprintf(stderr, "-----------------------------------\n");
         exit(EXIT_FAILURE);
     }
 
-    if (strcmp(interface, "") != 0){
-        printf("Chosen interface: '%s'.\n", interface);
-        if (check_interface(interface) == -1){
-            fprintf(stderr, "Interface '%s' not found.\n", interface);
+    if (strcmp(options->interface, "") != 0){
+        printf("Chosen interface: '%s'.\n", options->interface);
+        if (check_interface(options->interface) == -1){
+            fprintf(stderr, "Interface '%s' not found.\n", options->interface);
             printf("-----------------------------------\n");
             exit(EXIT_FAILURE);
         }
         printf("-----------------------------------\n");
     }
 
-    if (strcmp(filename, "") != 0){
-        printf("Chosen file: '%s'.\n", filename);
-        if (check_file(filename) == -1){
-            fprintf(stderr, "File '%s' not found.\n", filename);
+    if (strcmp(options->filename, "") != 0){
+        printf("Chosen file: '%s'.\n", options->filename);
+        if (check_file(options->filename) == -1){
+            fprintf(stderr, "File '%s' not found.\n", options->filename);
             printf("-----------------------------------\n");
             exit(EXIT_FAILURE);
         }
         printf("-----------------------------------\n");
     }
 
-    if (strcmp(filter, "") != 0){
-        printf("Chosen filter: '%s'.\n", filter);
-        if (check_filter(filter) == -1){
-            fprintf(stderr, "Invalid filter: '%s'.\n", filter);
+    if (strcmp(options->filter, "") != 0){
+        printf("Chosen filter: '%s'.\n", options->filter);
+        if (check_filter(options->filter) == -1){
+            fprintf(stderr, "Invalid filter: '%s'.\n", options->filter);
             printf("-----------------------------------\n");
             exit(EXIT_FAILURE);
         }
         printf("-----------------------------------\n");
     }
 
-    if (verbosity < 1 || verbosity > 3){
-        fprintf(stderr, "Invalid verbosity level: %d.\n", verbosity);
+    if (options->verbosity < 1 || options->verbosity > 3){
+        fprintf(stderr, "Invalid verbosity level: %d.\n", options->verbosity);
         printf("-----------------------------------\n");
         exit(EXIT_FAILURE);
     }
 
-    printf("Verbosity level: %d.\n", verbosity);
+    printf("Verbosity level: %d.\n", options->verbosity);
     printf("-----------------------------------\n");
+
+    if (options->format == -1){
+        fprintf(stderr, "Invalid format, expected 'text' or 'ndjson'.\n");
+        printf("-----------------------------------\n");
+        exit(EXIT_FAILURE);
+    }
+    if (options->format == FORMAT_NDJSON){
+        printf("Output format: ndjson.\n");
+        printf("-----------------------------------\n");
+    }
+
+    if (strcmp(options->export_path, "") != 0){
+        if (options->format == FORMAT_NDJSON){
+            fprintf(stderr, "Can't print ndjson and export columns at the same time.\n");
+            printf("-----------------------------------\n");
+            exit(EXIT_FAILURE);
+        }
+        if (options->jobs > 1){
+            fprintf(stderr, "Columns are exported by a single thread, -j can't be used.\n");
+            printf("-----------------------------------\n");
+            exit(EXIT_FAILURE);
+        }
+        printf("Exporting columns to '%s'.\n", options->export_path);
+        printf("-----------------------------------\n");
+    }
+
+    if (options->jobs < 1 || options->jobs > MAX_JOBS){
+        fprintf(stderr, "Invalid number of jobs: %d (1..%d).\n", options->jobs, MAX_JOBS);
+        printf("-----------------------------------\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options->jobs > 1){
+        if (options->top_interval > 0){
+            fprintf(stderr, "Periodic reports count a single thread, --top-interval can't be used with -j.\n");
+            printf("-----------------------------------\n");
+            exit(EXIT_FAILURE);
+        }
+        if (strcmp(options->interface, "") != 0){
+            if (options->flows){
+                fprintf(stderr, "Flows are tracked by a single thread, --flows can't be used with -j on an interface.\n");
+                printf("-----------------------------------\n");
+                exit(EXIT_FAILURE);
+            }
+            printf("Capture threads: %d, one socket each.\n", options->jobs);
+        } else {
+            printf("Decoding threads: %d.\n", options->jobs);
+        }
+        printf("-----------------------------------\n");
+    }
+
+    if (options->ring_block_size != 0 || options->ring_blocks != 0){
+        if (strcmp(options->interface, "") == 0){
+            fprintf(stderr, "The capture ring is only used live, --ring-block-size and --ring-blocks need -i.\n");
+            printf("-----------------------------------\n");
+            exit(EXIT_FAILURE);
+        }
+        // the page size and the rest are checked when the ring is created
+        if (options->ring_block_size < 0 || options->ring_blocks < 0){
+            fprintf(stderr, "Invalid capture ring: %d blocks of %d KB.\n", options->ring_blocks, options->ring_block_size);
+            printf("-----------------------------------\n");
+            exit(EXIT_FAILURE);
+        }
+        printf("Capture ring: %d blocks of %d KB.\n",
+            options->ring_blocks > 0 ? options->ring_blocks : PACKET_RING_BLOCK_COUNT,
+            options->ring_block_size > 0 ? options->ring_block_size : PACKET_RING_BLOCK_SIZE / 1024);
+        printf("-----------------------------------\n");
+    }
+
+    if (options->flows){
+        printf("Tracking flows, up to %d at a time.\n", FLOW_TABLE_CAPACITY);
+        printf("-----------------------------------\n");
+    }
+
+    if (options->dns){
+        printf("Tracking DNS queries, up to %d pending per thread, %llu s timeout.\n", DNS_TRACKER_CAPACITY,
+            (unsigned long long)(DNS_TRACKER_TIMEOUT / 1000000));
+        printf("-----------------------------------\n");
+    }
+
+    if (options->top < 0 || options->top_memory < 0 || options->top_interval < 0){
+        fprintf(stderr, "Invalid --top: %d of each kind, %d KB, every %d s.\n", options->top, options->top_memory, options->top_interval);
+        printf("-----------------------------------\n");
+        exit(EXIT_FAILURE);
+    }
+    if (options->top == 0 && (options->top_memory != 0 || options->top_interval != 0)){
+        fprintf(stderr, "--top-memory and --top-interval need --top.\n");
+        printf("-----------------------------------\n");
+        exit(EXIT_FAILURE);
+    }
+    if (options->top > 0){
+        printf("Counting the top %d talkers, %d KB of sketches per thread.\n", options->top,
+            options->top_memory > 0 ? options->top_memory : (int)(TOP_TALKERS_MEMORY / 1024));
+        if (options->top_interval > 0){
+            printf("Printed every %d s of capture.\n", options->top_interval);
+        }
+        printf("-----------------------------------\n");
+    }
+
+    if (options->distinct < 0){
+        fprintf(stderr, "Invalid --distinct interval: %d s.\n", options->distinct);
+        printf("-----------------------------------\n");
+        exit(EXIT_FAILURE);
+    }
+    if (options->distinct > 0){
+        printf("Estimating the distinct hosts, flows and DNS names per %d s, %u KB of sketches per thread.\n", options->distinct,
+            (unsigned)(CARDINALITY_KINDS << HYPERLOGLOG_PRECISION) / 1024);
+        printf("-----------------------------------\n");
+    }
+
+    if (options->stats_bucket < 0 || options->stats_interval < 0){
+        fprintf(stderr, "Invalid --stats: buckets of %d ms, every %d s.\n", options->stats_bucket, options->stats_interval);
+        printf("-----------------------------------\n");
+        exit(EXIT_FAILURE);
+    }
+    if (strcmp(options->stats_path, "") == 0 && (options->stats_bucket != 0 || options->stats_interval != 0)){
+        fprintf(stderr, "--stats-bucket and --stats-interval need --stats.\n");
+        printf("-----------------------------------\n");
+        exit(EXIT_FAILURE);
+    }
+    if (strcmp(options->stats_path, "") != 0){
+        long long bucket = options->stats_bucket > 0 ? options->stats_bucket : CLI_STATS_BUCKET;
+        long long interval = options->stats_interval > 0 ? options->stats_interval : CLI_STATS_INTERVAL;
+        if (interval * 1000 < bucket || interval * 1000 / bucket > CLI_STATS_MAX_BUCKETS){
+            fprintf(stderr, "--stats-interval must be 1 to %d buckets of --stats-bucket.\n", CLI_STATS_MAX_BUCKETS);
+            printf("-----------------------------------\n");
+            exit(EXIT_FAILURE);
+        }
+        printf("Traffic statistics to '%s', buckets of %lld ms, written every %lld s of capture.\n", options->stats_path,
+            bucket, interval);
+        printf("-----------------------------------\n");
+    }
+
+    if (options->profile){
+#ifdef STAGE_TIMER_ENABLED
+        printf("Timing the stages of every packet.\n");
+        printf("-----------------------------------\n");
+#else
+        fprintf(stderr, "--profile needs a build with the stage timers (cmake -DPCAPNA_PROFILE=ON).\n");
+        printf("-----------------------------------\n");
+        exit(EXIT_FAILURE);
+#endif
+    }
 }
\ No newline at end of file
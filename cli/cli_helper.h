@@ -1,12 +1,20 @@
 #ifndef CLI_HELPER_H
 #define CLI_HELPER_H
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <getopt.h>
 #include "interface.h"
+#include "cli_parser.h"
+#include "flow_table.h"
+#include "dns_tracker.h"
+#include "top_talkers.h"
+#include "cardinality.h"
+#include "cli_stats.h"
+#include "packet_ring.h"
 #include <time.h>
 
 #include <pcap.h>
@@ -14,15 +22,40 @@
 #include <fcntl.h>
 
 #define CMD_ARG_SIZE 100
+#define MAX_JOBS 64
+
+// the command line, see display_help()
+typedef struct cli_options {
+    char interface[CMD_ARG_SIZE];   // -i, empty without it
+    char filename[CMD_ARG_SIZE];    // -o, empty without it
+    char filter[CMD_ARG_SIZE];      // -f, empty without it
+    int verbosity;
+    int jobs;
+    int format;                     // FORMAT_TEXT, FORMAT_NDJSON or -1 if unknown
+    char export_path[CMD_ARG_SIZE]; // --export-columns, empty without it
+    bool flows;
+    bool dns;
+    int top;                        // how many of each kind --top prints, 0 without it
+    int top_memory;                 // in KB, 0 for the default
+    int top_interval;               // in seconds, 0 to print at the end only
+    int distinct;                   // seconds of capture per row of --distinct, 0 without it
+    char stats_path[CMD_ARG_SIZE];  // --stats, empty without it
+    int stats_bucket;               // in milliseconds, 0 for the default
+    int stats_interval;             // in seconds, 0 for the default
+    bool profile;                   // time the stages of the handler
+    int ring_block_size;            // in KB, 0 for the default
+    int ring_blocks;                // 0 for the default
+} cli_options_t;
 
 void display_welcome_message();
 void display_help();
 void display_interfaces();
 
-void get_arguments(int argc, char** argv, char *interface, char *filename, char *filter, int *verbosity);
-int check_interface(char* interface);
-int check_file(char* filename);
-int check_filter(char* filter);
-void check_all(char* interface, char* filename, char* filter, int verbosity);
+void get_arguments(int argc, char** argv, cli_options_t *options);
+int get_format(const char *name);
+int check_interface(const char* interface);
+int check_file(const char* filename);
+int check_filter(const char* filter);
+void check_all(const cli_options_t *options);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,356 @@
+#include "cli_ndjson.h"
+
+/**
+ * @brief Print the packet as one line of JSON, one object per layer
+ * of the dissection in the order of the packet
+ *
+ * @param pcap_header
+ * @param dissection
+ * @param packet_number
+ */
+void
+parse_ndjson(const struct pcap_pkthdr *pcap_header, const dissection_t *dissection, uint64_t packet_number)
+{
+    json_writer_t json;
+    json_init(&json, cli_output());
+
+    json_begin_object(&json);
+    json_field_uint(&json, "n", packet_number);
+    json_key(&json, "ts");
+    json_time(&json, pcap_header->ts.tv_sec, pcap_header->ts.tv_usec);
+    json_field_uint(&json, "caplen", pcap_header->caplen);
+    json_field_uint(&json, "len", pcap_header->len);
+
+    for (uint8_t i = 0; i < dissection->depth; i++){
+        switch (dissection->stack[i]){
+            case LAYER_ETHERNET:
+                json_key(&json, "ethernet");
+                json_ethernet_header(&json, &dissection->ethernet);
+                break;
+            case LAYER_ARP:
+                json_key(&json, "arp");
+                json_arp_header(&json, &dissection->arp);
+                break;
+            case LAYER_IPV4:
+                json_key(&json, "ipv4");
+                json_ipv4_header(&json, &dissection->ipv4);
+                break;
+            case LAYER_IPV6:
+                json_key(&json, "ipv6");
+                json_ipv6_header(&json, &dissection->ipv6);
+                break;
+            case LAYER_ICMP:
+                json_key(&json, "icmp");
+                json_icmp(&json, &dissection->icmp);
+                break;
+            case LAYER_ICMPV6:
+                json_key(&json, "icmpv6");
+                json_icmpv6(&json, &dissection->icmpv6);
+                break;
+            case LAYER_TCP:
+                json_key(&json, "tcp");
+                json_tcp_header(&json, &dissection->tcp);
+                break;
+            case LAYER_UDP:
+                json_key(&json, "udp");
+                json_udp_header(&json, &dissection->udp);
+                break;
+            case LAYER_DNS:
+                json_key(&json, "dns");
+                json_dns_header(&json, &dissection->dns);
+                break;
+            case LAYER_DHCP:
+                json_key(&json, "dhcp");
+                json_dhcp_bootp_header(&json, &dissection->dhcp);
+                break;
+            default:
+                break;
+        }
+    }
+    // the other messages one TCP segment made whole, after the first one
+    if (dissection_has(dissection, LAYER_DNS) && dissection->dns_more_count > 0){
+        json_key(&json, "dns_more");
+        json_begin_array(&json);
+        for (uint32_t i = 0; i < dissection->dns_more_count; i++){
+            json_dns_header(&json, &dissection->dns_more[i]);
+        }
+        json_end_array(&json);
+    }
+
+    json_end_object(&json);
+    output_sink_putc(json.sink, '\n');
+}
+
+void
+json_ethernet_header(json_writer_t *json, const my_ethernet_header_t *header)
+{
+    json_begin_object(json);
+    json_field_string(json, "src_mac", header->src_mac);
+    json_field_string(json, "dst_mac", header->dst_mac);
+    json_field_uint(json, "type", header->type);
+    json_field_string(json, "type_desc", header->type_desc);
+    json_field_bool(json, "vlan_tagged", header->vlan_tagged);
+    if (header->vlan_tagged){
+        json_field_uint(json, "vlan_id", header->vlan_id);
+        json_field_uint(json, "pcp", header->pcp);
+        json_field_uint(json, "dei", header->dei);
+        json_field_uint(json, "type_vlan", header->type_vlan);
+        json_field_string(json, "type_desc_vlan", header->type_desc_vlan);
+    }
+    json_end_object(json);
+}
+
+void
+json_arp_header(json_writer_t *json, const my_arp_header_t *header)
+{
+    json_begin_object(json);
+    json_field_uint(json, "hardware_type", header->hardware_type);
+    json_field_string(json, "hardware_type_desc", header->hardware_type_desc);
+    json_field_uint(json, "protocol_type", header->protocol_type);
+    json_field_string(json, "protocol_type_desc", header->protocol_type_desc);
+    json_field_uint(json, "hardware_address_length", header->hardware_address_length);
+    json_field_uint(json, "protocol_length", header->protocol_length);
+    json_field_uint(json, "operation", header->operation);
+    json_field_string(json, "operation_desc", header->operation_desc);
+    json_field_string(json, "sender_hardware_address", header->sender_hardware_address);
+    json_field_string(json, "sender_protocol_address", header->sender_protocol_address);
+    json_field_string(json, "target_hardware_address", header->target_hardware_address);
+    json_field_string(json, "target_protocol_address", header->target_protocol_address);
+    json_end_object(json);
+}
+
+void
+json_ipv4_header(json_writer_t *json, const my_ipv4_header_t *header)
+{
+    json_begin_object(json);
+    json_field_uint(json, "version", header->version);
+    json_field_uint(json, "header_length", header->header_length);
+    json_field_uint(json, "dscp_value", header->dscp_value);
+    json_field_string(json, "dscp_desc", header->dscp_desc);
+    json_field_uint(json, "ecn_value", header->ecn_value);
+    json_field_string(json, "ecn_desc", header->ecn_desc);
+    json_field_uint(json, "total_length", header->total_length);
+    json_field_uint(json, "identification", header->identification);
+    json_key(json, "flags");
+    json_begin_object(json);
+    json_field_bool(json, "reserved", header->flags.reserved);
+    json_field_bool(json, "dont_fragment", header->flags.dont_fragment);
+    json_field_bool(json, "more_fragments", header->flags.more_fragments);
+    json_end_object(json);
+    json_field_string(json, "flags_desc", header->flags_desc);
+    json_field_uint(json, "fragment_offset", header->fragment_offset);
+    json_field_uint(json, "time_to_live", header->time_to_live);
+    json_field_uint(json, "protocol", header->protocol);
+    json_field_string(json, "protocol_name", header->protocol_name);
+    json_field_uint(json, "checksum", header->checksum);
+    json_field_bool(json, "checksum_correct", header->checksum_correct);
+    json_key(json, "source_ipv4");
+    json_ipv4(json, header->raw_source_address);
+    json_key(json, "destination_ipv4");
+    json_ipv4(json, header->raw_destination_address);
+    json_end_object(json);
+}
+
+void
+json_ipv6_header(json_writer_t *json, const my_ipv6_header_t *header)
+{
+    json_begin_object(json);
+    json_field_uint(json, "version", header->version);
+    json_field_uint(json, "traffic_class", header->traffic_class);
+    json_field_uint(json, "flow_label", header->flow_label);
+    json_field_uint(json, "dscp_value", header->dscp_value);
+    json_field_string(json, "dscp_desc", header->dscp_desc);
+    json_field_uint(json, "ecn_value", header->ecn_value);
+    json_field_string(json, "ecn_desc", header->ecn_desc);
+    json_field_uint(json, "payload_length", header->payload_length);
+    json_field_uint(json, "next_header", header->next_header);
+    json_field_string(json, "next_header_name", header->next_header_name);
+    json_field_uint(json, "hop_limit", header->hop_limit);
+    json_field_string(json, "source_address", header->source_address);
+    json_field_string(json, "destination_address", header->destination_address);
+    json_end_object(json);
+}
+
+void
+json_icmp(json_writer_t *json, const my_icmp_t *header)
+{
+    json_begin_object(json);
+    json_field_uint(json, "type", header->type);
+    json_field_string(json, "icmp_type_desc", header->icmp_type_desc);
+    json_field_uint(json, "code", header->code);
+    json_field_string(json, "icmp_code_desc", header->icmp_code_desc);
+    json_field_uint(json, "checksum", header->checksum);
+    json_field_uint(json, "calculated_checksum", header->calculated_checksum);
+    json_field_bool(json, "checksum_valid", header->checksum_valid);
+    json_field_uint(json, "identifier", header->identifier);
+    json_field_uint(json, "sequence_number", header->sequence_number);
+    // errors quote the header of the datagram that caused them
+    if (!is_ipv4_header_empty(&header->og_ip_header)){
+        json_key(json, "og_ip_header");
+        json_ipv4_header(json, &header->og_ip_header);
+    }
+    json_end_object(json);
+}
+
+void
+json_icmpv6(json_writer_t *json, const my_icmpv6_t *header)
+{
+    json_begin_object(json);
+    json_field_uint(json, "type", header->type);
+    json_field_string(json, "icmpv6_type_desc", header->icmpv6_type_desc);
+    json_field_uint(json, "code", header->code);
+    json_field_string(json, "icmpv6_code_desc", header->icmpv6_code_desc);
+    json_field_uint(json, "checksum", header->checksum);
+    json_field_uint(json, "calculated_checksum", header->calculated_checksum);
+    json_field_bool(json, "checksum_valid", header->checksum_valid);
+    json_field_uint(json, "identifier", header->identifier);
+    json_field_uint(json, "sequence_number", header->sequence_number);
+    if (header->type == ND_NEIGHBOR_SOLICIT && header->payload != NULL){
+        json_field_string(json, "target_address", (const char*)header->payload);
+    }
+    if (!is_ipv6_header_empty(&header->og_ipv6_header)){
+        json_key(json, "og_ipv6_header");
+        json_ipv6_header(json, &header->og_ipv6_header);
+    }
+    json_end_object(json);
+}
+
+void
+json_tcp_header(json_writer_t *json, const my_tcp_header_t *header)
+{
+    json_begin_object(json);
+    json_field_uint(json, "source_port", header->source_port);
+    json_field_uint(json, "destination_port", header->destination_port);
+    json_field_uint(json, "sequence_number", header->sequence_number);
+    json_field_uint(json, "acknowledgment_number", header->acknowledgment_number);
+    json_field_uint(json, "data_offset", header->data_offset);
+    json_field_uint(json, "flags", header->flags);
+    json_field_string(json, "tcp_flags_desc", header->tcp_flags_desc);
+    json_field_uint(json, "window", header->window);
+    json_field_uint(json, "checksum", header->checksum);
+    json_field_uint(json, "calculated_checksum", header->calculated_checksum);
+    json_field_bool(json, "checksum_correct", header->checksum_correct);
+    json_field_uint(json, "urgent_pointer", header->urgent_pointer);
+    json_field_string(json, "tcp_options_desc", header->tcp_options_desc);
+    json_end_object(json);
+}
+
+void
+json_udp_header(json_writer_t *json, const my_udp_header_t *header)
+{
+    json_begin_object(json);
+    json_field_uint(json, "source_port", header->source_port);
+    json_field_uint(json, "destination_port", header->destination_port);
+    json_field_uint(json, "length", header->length);
+    json_field_uint(json, "checksum", header->checksum);
+    json_field_uint(json, "calculated_checksum", header->calculated_checksum);
+    json_field_bool(json, "checksum_correct", header->checksum_correct);
+    json_end_object(json);
+}
+
+/**
+ * @brief One of the answer, authority or additional sections, as an array
+ *
+ * @param json
+ * @param key
+ * @param section
+ */
+void
+json_dns_records(json_writer_t *json, const char *key, const dns_records_t *section)
+{
+    json_key(json, key);
+    json_begin_array(json);
+    for (uint32_t i = 0; i < section->count; i++){
+        resource_record_t *record = &dns_records_items(section)[i];
+        json_begin_object(json);
+        json_field_string(json, "name", record->name);
+        json_field_uint(json, "type", record->type);
+        json_field_string(json, "type_desc", record->type_desc);
+        json_field_uint(json, "data_class", record->data_class);
+        json_field_string(json, "class_desc", record->class_desc);
+        json_field_uint(json, "ttl", record->ttl);
+        json_field_uint(json, "rdlength", record->rdlength);
+        json_field_string(json, "rdata_desc", record->rdata_desc);
+        json_end_object(json);
+    }
+    json_end_array(json);
+}
+
+void
+json_dns_header(json_writer_t *json, const my_dns_header_t *header)
+{
+    json_begin_object(json);
+    json_field_uint(json, "transaction_id", header->transaction_id);
+    json_field_uint(json, "qr", header->qr);
+    json_field_string(json, "qr_desc", header->qr_desc);
+    json_field_uint(json, "opcode", header->opcode);
+    json_field_string(json, "opcode_desc", header->opcode_desc);
+    json_field_bool(json, "aa", header->aa);
+    json_field_bool(json, "tc", header->tc);
+    json_field_bool(json, "rd", header->rd);
+    json_field_bool(json, "ra", header->ra);
+    json_field_uint(json, "z", header->z);
+    json_field_uint(json, "rcode", header->rcode);
+    json_field_string(json, "rcode_desc", header->rcode_desc);
+    json_field_uint(json, "qdcount", header->qdcount);
+    json_field_uint(json, "ancount", header->ancount);
+    json_field_uint(json, "nscount", header->nscount);
+    json_field_uint(json, "arcount", header->arcount);
+
+    json_key(json, "questions");
+    json_begin_array(json);
+    for (uint32_t i = 0; i < header->question_section.count; i++){
+        question_section_t *question = &dns_questions_items(&header->question_section)[i];
+        json_begin_object(json);
+        json_field_string(json, "qname", question->qname);
+        json_field_uint(json, "qtype", question->qtype);
+        json_field_string(json, "qtype_desc", question->qtype_desc);
+        json_field_uint(json, "qclass", question->qclass);
+        json_field_string(json, "qclass_desc", question->qclass_desc);
+        json_end_object(json);
+    }
+    json_end_array(json);
+    json_dns_records(json, "answers", &header->answer_section);
+    json_dns_records(json, "authorities", &header->authority_section);
+    json_dns_records(json, "additionals", &header->additional_section);
+    json_end_object(json);
+}
+
+void
+json_dhcp_bootp_header(json_writer_t *json, const my_dhcp_bootp_header_t *header)
+{
+    json_begin_object(json);
+    json_field_uint(json, "bp_op", header->bp_op);
+    json_field_string(json, "bp_op_desc", header->bp_op_desc);
+    json_field_uint(json, "bp_htype", header->bp_htype);
+    json_field_string(json, "bp_htype_desc", header->bp_htype_desc);
+    json_field_uint(json, "bp_hlen", header->bp_hlen);
+    json_field_uint(json, "bp_xid", header->bp_xid);
+    json_field_uint(json, "bp_secs", header->bp_secs);
+    json_field_bool(json, "broadcast", header->dhcp_flags_bp_unused & 0x8000);
+    json_field_string(json, "client_ip_address", header->client_ip_address);
+    json_field_string(json, "your_ip_address", header->your_ip_address);
+    json_field_string(json, "server_ip_address", header->server_ip_address);
+    json_field_string(json, "gateway_ip_address", header->gateway_ip_address);
+    json_field_string(json, "client_hardware_address", header->client_hardware_address);
+    json_field_string(json, "server_host_name", header->server_host_name);
+    json_field_string(json, "boot_file_name", header->boot_file_name);
+    json_field_uint(json, "magic_cookie", header->magic_cookie);
+
+    json_key(json, "dhcp_options");
+    json_begin_array(json);
+    for (uint32_t i = 0; i < header->dhcp_options.count; i++){
+        my_dhcp_option_t *option = &dhcp_options_items(&header->dhcp_options)[i];
+        json_begin_object(json);
+        json_field_uint(json, "option_code", option->option_code);
+        json_field_string(json, "option_code_desc", option->option_code_desc);
+        json_field_uint(json, "option_length", option->option_length);
+        if (option->option_code == DHCP_MESSAGE_TYPE){
+            json_field_uint(json, "option_value", option->option_value);
+        }
+        json_field_string(json, "option_value_desc", option->option_value_desc);
+        json_end_object(json);
+    }
+    json_end_array(json);
+    json_end_object(json);
+}
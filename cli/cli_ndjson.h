@@ -0,0 +1,40 @@
+#ifndef CLI_NDJSON_H
+#define CLI_NDJSON_H
+
+#include <pcap.h>
+#include <stdint.h>
+#include "json_writer.h"
+#include "cli_parser.h"
+
+/*
+--format ndjson: one JSON object per packet, one packet per line.
+
+Every header the text renderers show becomes an object named after the
+layer, its keys are the fields of the my_*_header_t struct, numbers stay
+numbers and flags stay booleans:
+
+{"n":0,"ts":1347402958.977971,"caplen":94,"len":94,
+ "ethernet":{"src_mac":"..","dst_mac":"..","type":2048,..},
+ "ipv4":{..},"udp":{..},"dns":{..,"questions":[{..}],"answers":[..]}}
+
+A TCP segment completing several DNS messages has the first one in "dns",
+the others in a "dns_more" array of the same objects.
+
+The objects are encoded by json_writer into the thread's sink, like the text,
+so the parallel decoder (-j) works the same in both formats.
+*/
+
+void parse_ndjson(const struct pcap_pkthdr *pcap_header, const dissection_t *dissection, uint64_t packet_number);
+
+void json_ethernet_header(json_writer_t *json, const my_ethernet_header_t *header);
+void json_arp_header(json_writer_t *json, const my_arp_header_t *header);
+void json_ipv4_header(json_writer_t *json, const my_ipv4_header_t *header);
+void json_ipv6_header(json_writer_t *json, const my_ipv6_header_t *header);
+void json_icmp(json_writer_t *json, const my_icmp_t *header);
+void json_icmpv6(json_writer_t *json, const my_icmpv6_t *header);
+void json_tcp_header(json_writer_t *json, const my_tcp_header_t *header);
+void json_udp_header(json_writer_t *json, const my_udp_header_t *header);
+void json_dns_header(json_writer_t *json, const my_dns_header_t *header);
+void json_dhcp_bootp_header(json_writer_t *json, const my_dhcp_bootp_header_t *header);
+
+#endif
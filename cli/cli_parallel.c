@@ -0,0 +1,361 @@
+#include "cli_parallel.h"
+#include "cli_parser.h"
+#include "cli_flows.h"
+#include "cli_dns.h"
+#include "cli_top.h"
+#include "cli_distinct.h"
+#include "cli_stats.h"
+#include "cli_profile.h"
+
+#include <sched.h>
+#include <unistd.h>
+
+#define ETHERTYPE_IPV4_RAW 0x0800
+#define ETHERTYPE_IPV6_RAW 0x86dd
+#define ETHERTYPE_VLAN_RAW 0x8100
+#define ETHERTYPE_QINQ_RAW 0x88a8
+
+/**
+ * @brief FNV-1a over a few bytes, continuing from hash
+ *
+ * @param hash
+ * @param data
+ * @param length
+ * @return uint32_t
+ */
+uint32_t
+fnv1a(uint32_t hash, const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++){
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Hash of one endpoint (address + port)
+ *
+ * @param address
+ * @param length
+ * @param port
+ * @return uint32_t
+ */
+uint32_t
+endpoint_hash(const uint8_t *address, size_t length, const uint8_t *port)
+{
+    uint32_t hash = fnv1a(2166136261u, address, length);
+    if (port != NULL){
+        hash = fnv1a(hash, port, 2);
+    }
+    return hash;
+}
+
+/**
+ * @brief Symmetric hash of the packet's 5-tuple, A->B and B->A give the same value.
+ * Only the raw headers are looked at, nothing is decoded. Packets that aren't
+ * IP hash to 0, so they all go to the first worker.
+ *
+ * @param packet
+ * @param caplen
+ * @return uint32_t
+ */
+uint32_t
+flow_hash(const uint8_t *packet, uint32_t caplen)
+{
+    uint32_t offset = 12;
+    if (caplen < offset + 2){
+        return 0;
+    }
+    uint16_t ethertype = (packet[offset] << 8) | packet[offset + 1];
+    // skip the 802.1Q / 802.1ad tags
+    while ((ethertype == ETHERTYPE_VLAN_RAW || ethertype == ETHERTYPE_QINQ_RAW) && caplen >= offset + 6){
+        offset += 4;
+        ethertype = (packet[offset] << 8) | packet[offset + 1];
+    }
+    offset += 2;
+
+    const uint8_t *source, *destination;
+    size_t address_length;
+    uint8_t protocol;
+    uint32_t transport;
+    bool has_ports = true;
+
+    if (ethertype == ETHERTYPE_IPV4_RAW){
+        if (caplen < offset + 20){
+            return 0;
+        }
+        const uint8_t *ip = packet + offset;
+        protocol = ip[9];
+        source = ip + 12;
+        destination = ip + 16;
+        address_length = 4;
+        transport = offset + (ip[0] & 0x0f) * 4;
+        // fragments: only the first one has the ports, keep them all together,
+        // apart from the rest of the flow (not reassembled, see cli_parallel.h)
+        if (((ip[6] & 0x3f) | ip[7]) != 0){
+            has_ports = false;
+        }
+    } else if (ethertype == ETHERTYPE_IPV6_RAW){
+        if (caplen < offset + 40){
+            return 0;
+        }
+        const uint8_t *ip = packet + offset;
+        protocol = ip[6];
+        source = ip + 8;
+        destination = ip + 24;
+        address_length = 16;
+        transport = offset + 40;
+    } else {
+        return 0;
+    }
+
+    if (protocol != IPPROTO_TCP && protocol != IPPROTO_UDP){
+        has_ports = false;
+    }
+    if (has_ports && caplen < transport + 4){
+        has_ports = false;
+    }
+
+    uint32_t a = endpoint_hash(source, address_length, has_ports ? packet + transport : NULL);
+    uint32_t b = endpoint_hash(destination, address_length, has_ports ? packet + transport + 2 : NULL);
+    uint32_t hash = (a + b) ^ (a * b) ^ protocol;
+    // final avalanche (murmur3 fmix32)
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/**
+ * @brief Wait a little for another thread to make progress
+ *
+ */
+void
+parallel_pause()
+{
+    sched_yield();
+}
+
+/**
+ * @brief Called by the reader for every packet of the capture
+ *
+ * @param user
+ * @param header
+ * @param packet
+ */
+void
+parallel_dispatch(u_char *user, const struct pcap_pkthdr *header, const u_char *packet)
+{
+    parallel_capture_t *capture = (parallel_capture_t*)user;
+    uint64_t packet_number = capture->dispatched;
+
+    // don't get more than a window ahead of the writer
+    while (packet_number - atomic_load_explicit(&capture->emitted, memory_order_acquire) >= PARALLEL_WINDOW){
+        parallel_pause();
+    }
+
+    // the flow table has a single owner, the reader
+    if (cli_flows != NULL){
+        STAGE_BEGIN(start);
+        cli_flows_update(header, packet);
+        STAGE_END(start, STAGE_FLOWS);
+    }
+
+    uint32_t hash = flow_hash(packet, header->caplen);
+    parallel_queue_t *queue = &capture->workers[hash % capture->worker_count].queue;
+    uint64_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    while (tail - atomic_load_explicit(&queue->head, memory_order_acquire) >= PARALLEL_WINDOW){
+        parallel_pause();
+    }
+
+    parallel_job_t *job = &queue->jobs[tail % PARALLEL_WINDOW];
+    job->packet_number = packet_number;
+    job->header = *header;
+    if (capture->copy_packets){
+        if (job->capacity < header->caplen){
+            free(job->copy);
+            job->copy = malloc(header->caplen);
+            if (job->copy == NULL){
+                perror("malloc");
+                exit(EXIT_FAILURE);
+            }
+            job->capacity = header->caplen;
+        }
+        memcpy(job->copy, packet, header->caplen);
+        job->packet = job->copy;
+    } else {
+        // the mapping lives until the end of the capture, read only
+        job->packet = packet;
+    }
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    capture->dispatched++;
+}
+
+/**
+ * @brief Decode the packets of one queue, in the worker's own buffer,
+ * and park the text in the reorder window
+ *
+ * @param args
+ * @return void*
+ */
+void*
+parallel_worker(void *args)
+{
+    parallel_worker_t *worker = (parallel_worker_t*)args;
+    parallel_capture_t *capture = worker->capture;
+    parallel_queue_t *queue = &worker->queue;
+
+    // the text of one packet at a time, kept in memory
+    output_sink_t sink;
+    output_sink_init(&sink, OUTPUT_SINK_NO_FD, PARALLEL_PACKET_TEXT);
+    cli_sink = &sink;
+
+    while (true){
+        uint64_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        if (head == atomic_load_explicit(&queue->tail, memory_order_acquire)){
+            if (atomic_load_explicit(&capture->done, memory_order_acquire)
+                && head == atomic_load_explicit(&queue->tail, memory_order_acquire)){
+                break;
+            }
+            parallel_pause();
+            continue;
+        }
+
+        parallel_job_t *job = &queue->jobs[head % PARALLEL_WINDOW];
+        uint64_t packet_number = job->packet_number;
+        parse_cli_nth(&job->header, job->packet, capture->verbosity, packet_number);
+
+        // the reader never reuses a slot the writer hasn't printed yet
+        parallel_slot_t *slot = &capture->slots[packet_number % PARALLEL_WINDOW];
+        if (slot->capacity < sink.length){
+            free(slot->output);
+            slot->output = malloc(sink.length);
+            if (slot->output == NULL){
+                perror("malloc");
+                exit(EXIT_FAILURE);
+            }
+            slot->capacity = sink.length;
+        }
+        memcpy(slot->output, sink.data, sink.length);
+        slot->length = sink.length;
+        atomic_store_explicit(&slot->ready, true, memory_order_release);
+
+        // hand the job back to the reader, then start the buffer over
+        atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+        output_sink_reset(&sink);
+    }
+
+    cli_sink = NULL;
+    output_sink_destroy(&sink);
+    cli_arena_release();
+    cli_reassembly_release();
+    cli_tcp_reassembly_release();
+    cli_dns_release();
+    cli_top_release();
+    cli_distinct_release();
+    cli_stats_release();
+    cli_profile_release();
+    return NULL;
+}
+
+/**
+ * @brief Print the reorder window in capture order, in large writes
+ *
+ * @param args
+ * @return void*
+ */
+void*
+parallel_writer(void *args)
+{
+    parallel_capture_t *capture = (parallel_capture_t*)args;
+    output_sink_t sink;
+    output_sink_init(&sink, cli_data_fd(), OUTPUT_SINK_CAPACITY);
+
+    while (true){
+        uint64_t emitted = atomic_load_explicit(&capture->emitted, memory_order_relaxed);
+        parallel_slot_t *slot = &capture->slots[emitted % PARALLEL_WINDOW];
+        if (!atomic_load_explicit(&slot->ready, memory_order_acquire)){
+            // dispatched is final once done is set
+            if (atomic_load_explicit(&capture->done, memory_order_acquire)
+                && emitted == capture->dispatched){
+                break;
+            }
+            parallel_pause();
+            continue;
+        }
+        output_sink_write(&sink, slot->output, slot->length);
+        atomic_store_explicit(&slot->ready, false, memory_order_relaxed);
+        atomic_store_explicit(&capture->emitted, emitted + 1, memory_order_release);
+    }
+    output_sink_destroy(&sink);
+    return NULL;
+}
+
+/**
+ * @brief Read the capture and decode it on worker_count threads,
+ * the output is printed in capture order
+ *
+ * @param file the memory-mapped capture, or NULL
+ * @param capture the libpcap handle when file is NULL
+ * @param verbosity
+ * @param worker_count
+ */
+void
+start_parallel_capture(pcap_file_t *file, pcap_t *capture, int verbosity, int worker_count)
+{
+    parallel_capture_t parallel = {0};
+    parallel.verbosity = verbosity;
+    parallel.worker_count = worker_count;
+    parallel.copy_packets = (file == NULL);
+    atomic_init(&parallel.emitted, 0);
+    atomic_init(&parallel.done, false);
+
+    parallel.workers = calloc(worker_count, sizeof(parallel_worker_t));
+    parallel.slots = calloc(PARALLEL_WINDOW, sizeof(parallel_slot_t));
+    if (parallel.workers == NULL || parallel.slots == NULL){
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+
+    // the writer bypasses stdio
+    fflush(stdout);
+    if (pthread_create(&parallel.writer, NULL, parallel_writer, &parallel) != 0){
+        perror("pthread_create");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < worker_count; i++){
+        parallel.workers[i].capture = &parallel;
+        if (pthread_create(&parallel.workers[i].thread, NULL, parallel_worker, &parallel.workers[i]) != 0){
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (file != NULL){
+        pcap_file_loop(file, 0, parallel_dispatch, (u_char*)&parallel);
+    } else {
+        pcap_loop(capture, 0, parallel_dispatch, (u_char*)&parallel);
+    }
+
+    atomic_store_explicit(&parallel.done, true, memory_order_release);
+    for (int i = 0; i < worker_count; i++){
+        pthread_join(parallel.workers[i].thread, NULL);
+    }
+    pthread_join(parallel.writer, NULL);
+
+    for (int i = 0; i < worker_count; i++){
+        if (parallel.copy_packets){
+            for (int j = 0; j < PARALLEL_WINDOW; j++){
+                free(parallel.workers[i].queue.jobs[j].copy);
+            }
+        }
+    }
+    for (int i = 0; i < PARALLEL_WINDOW; i++){
+        free(parallel.slots[i].output);
+    }
+    free(parallel.workers);
+    free(parallel.slots);
+}
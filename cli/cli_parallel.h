@@ -0,0 +1,86 @@
+#ifndef CLI_PARALLEL_H
+#define CLI_PARALLEL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pcap.h>
+#include "pcap_file.h"
+#include "output_sink.h"
+
+/*
+Multi-threaded decoding of offline captures (-j N).
+
+           +--> queue 0 --> worker 0 --+
+reader ----+--> queue 1 --> worker 1 --+--> reorder window --> writer --> stdout
+           +--> queue N --> worker N --+
+
+The reader walks the capture, numbers every packet and hands it to a worker
+chosen by a symmetric hash of its 5-tuple, so both directions of a flow are
+always decoded by the same thread. Workers render into their own sink and
+park the text in the reorder window; the writer prints the window strictly in
+capture order, the output is the same as with a single thread.
+
+IPv4 fragments are not reassembled before the hash: all but the first lack
+the ports, so the fragments of a datagram are kept together by their address
+pair only, usually on another thread than the rest of their flow. A TCP
+segment split in fragments is then missing from its stream's reassembly. Live
+(-j on an interface) the kernel defragments before it shares the packets out.
+
+At most PARALLEL_WINDOW packets are in flight, the reader waits for the
+writer when it gets that far ahead.
+*/
+
+#define PARALLEL_MAX_WORKERS 64
+#define PARALLEL_WINDOW 4096 // power of two
+#define PARALLEL_PACKET_TEXT 4096 // initial size of a worker's sink
+
+typedef struct parallel_job {
+    uint64_t packet_number;
+    struct pcap_pkthdr header;
+    const uint8_t *packet;   // the copy, or in the mapped file
+    uint8_t *copy;           // owned copy (libpcap path)
+    size_t capacity;         // size of copy
+} parallel_job_t;
+
+// single producer (reader), single consumer (worker)
+typedef struct parallel_queue {
+    parallel_job_t jobs[PARALLEL_WINDOW];
+    _Atomic uint64_t head;   // next job to take
+    _Atomic uint64_t tail;   // next free job
+} parallel_queue_t;
+
+typedef struct parallel_slot {
+    _Atomic bool ready;
+    char *output;
+    size_t length;
+    size_t capacity;
+} parallel_slot_t;
+
+typedef struct parallel_capture parallel_capture_t;
+
+typedef struct parallel_worker {
+    parallel_capture_t *capture;
+    parallel_queue_t queue;
+    pthread_t thread;
+} parallel_worker_t;
+
+struct parallel_capture {
+    int verbosity;
+    int worker_count;
+    bool copy_packets;       // packets don't outlive the callback (libpcap)
+
+    parallel_worker_t *workers;
+    parallel_slot_t *slots;  // reorder window
+    pthread_t writer;
+
+    uint64_t dispatched;     // reader only
+    _Atomic uint64_t emitted;
+    _Atomic bool done;
+};
+
+void start_parallel_capture(pcap_file_t *file, pcap_t *capture, int verbosity, int worker_count);
+uint32_t flow_hash(const uint8_t *packet, uint32_t caplen);
+
+#endif
@@ -1,298 +1,495 @@
 #include "cli_parser.h"
+#include "cli_ndjson.h"
+#include "cli_columns.h"
+#include "cli_top.h"
+#include "cli_distinct.h"
+#include "cli_stats.h"
+#include "cli_dns.h"
+#include "stage_timer.h"
 
+// where the renderers write, stdout unless a worker thread redirects it
+_Thread_local output_sink_t *cli_sink = NULL;
+
+// set once, before the capture starts
+int cli_format = FORMAT_TEXT;
+static int cli_data_fd_value = STDOUT_FILENO;
+
+// sink on stdout, used by the thread running the capture
+static output_sink_t cli_stdout_sink;
+static bool cli_stdout_sink_ready = false;
+
+// what the parsers allocate while decoding a packet, reset for every packet
+static _Thread_local arena_t cli_decode_arena;
+static _Thread_local bool cli_decode_arena_ready = false;
+
+// the layers of the packet being rendered, their strings are in the arena
+static _Thread_local dissection_t cli_dissection;
+
+// the IPv4 fragments waiting for the rest of their datagram
+static _Thread_local ipv4_reassembly_t *cli_ipv4_reassembly = NULL;
+static _Thread_local tcp_reassembly_t *cli_tcp_streams = NULL;
+
+/**
+ * @brief Choose how packets are printed. With ndjson, stdout only gets the
+ * packets: it is kept for them and the messages printed with printf()
+ * go to stderr instead.
+ * 
+ * @param format FORMAT_TEXT or FORMAT_NDJSON
+ */
+void
+cli_set_format(int format)
+{
+    cli_format = format;
+    if (format == FORMAT_NDJSON && cli_data_fd_value == STDOUT_FILENO){
+        fflush(stdout);
+        cli_data_fd_value = dup(STDOUT_FILENO);
+        if (cli_data_fd_value == -1 || dup2(STDERR_FILENO, STDOUT_FILENO) == -1){
+            perror("dup");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/**
+ * @brief Where the packets are written
+ * 
+ * @return int 
+ */
+int
+cli_data_fd()
+{
+    return cli_data_fd_value;
+}
+
+/**
+ * @brief The calling thread's sink, the stdout sink if it has none
+ * 
+ * @return output_sink_t* 
+ */
+output_sink_t*
+cli_output()
+{
+    if (cli_sink != NULL){
+        return cli_sink;
+    }
+    if (!cli_stdout_sink_ready){
+        // whatever stdio still holds goes first
+        fflush(stdout);
+        output_sink_init(&cli_stdout_sink, cli_data_fd(), OUTPUT_SINK_CAPACITY);
+        cli_stdout_sink_ready = true;
+        atexit(cli_flush);
+    }
+    return &cli_stdout_sink;
+}
+
+/**
+ * @brief Write out what the stdout sink holds, before printing
+ * anything else through stdio
+ * 
+ */
+void
+cli_flush()
+{
+    if (cli_stdout_sink_ready){
+        output_sink_flush(&cli_stdout_sink);
+    }
+}
+
+/**
+ * @brief The calling thread's arena, for the parsers
+ * 
+ * @return arena_t* 
+ */
+arena_t*
+cli_arena()
+{
+    if (!cli_decode_arena_ready){
+        arena_init(&cli_decode_arena, ARENA_CAPACITY);
+        cli_decode_arena_ready = true;
+    }
+    return &cli_decode_arena;
+}
+
+/**
+ * @brief Free the calling thread's arena, before the thread ends
+ * 
+ */
 void
-parse_cli(const struct pcap_pkthdr *pcap_header, uint8_t *packet, int verbosity){
-    static int count_packets = 0;
-    printf("------------------------------------------------------------------\n");
+cli_arena_release()
+{
+    if (cli_decode_arena_ready){
+        arena_destroy(&cli_decode_arena);
+        cli_decode_arena_ready = false;
+    }
+}
+
+/**
+ * @brief The calling thread's IPv4 reassembly, the fragments of a datagram
+ * all go to the same thread
+ * 
+ * @return ipv4_reassembly_t* 
+ */
+ipv4_reassembly_t*
+cli_reassembly()
+{
+    if (cli_ipv4_reassembly == NULL){
+        cli_ipv4_reassembly = ipv4_reassembly_create(0, 0, 0, IPV4_OVERLAP_FIRST);
+    }
+    return cli_ipv4_reassembly;
+}
+
+/**
+ * @brief Free the calling thread's IPv4 reassembly and the fragments it
+ * holds, before the thread ends
+ * 
+ */
+void
+cli_reassembly_release()
+{
+    if (cli_ipv4_reassembly != NULL){
+        ipv4_reassembly_destroy(cli_ipv4_reassembly);
+        cli_ipv4_reassembly = NULL;
+    }
+}
+
+/**
+ * @brief The calling thread's TCP reassembly, the segments of a connection
+ * both ways all go to the same thread
+ * 
+ * @return tcp_reassembly_t* 
+ */
+tcp_reassembly_t*
+cli_tcp_reassembly()
+{
+    if (cli_tcp_streams == NULL){
+        cli_tcp_streams = tcp_reassembly_create(0, 0, 0);
+    }
+    return cli_tcp_streams;
+}
+
+/**
+ * @brief Free the calling thread's TCP reassembly and the bytes its
+ * streams hold, before the thread ends
+ * 
+ */
+void
+cli_tcp_reassembly_release()
+{
+    if (cli_tcp_streams != NULL){
+        tcp_reassembly_destroy(cli_tcp_streams);
+        cli_tcp_streams = NULL;
+    }
+}
+
+/**
+ * @brief printf() for the renderers, goes to the calling
+ * thread's sink
+ * 
+ * @param format 
+ * @param ... 
+ */
+void
+cli_printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    output_sink_vprintf(cli_output(), format, args);
+    va_end(args);
+}
+
+void
+cli_puts(const char *string)
+{
+    output_sink_puts(cli_output(), string);
+}
+
+void
+cli_uint(uint64_t value)
+{
+    output_sink_uint(cli_output(), value);
+}
+
+// a string and the space after it, most of the concise line
+void
+cli_word(const char *string)
+{
+    output_sink_t *sink = cli_output();
+    output_sink_puts(sink, string);
+    output_sink_putc(sink, ' ');
+}
+
+void
+parse_cli(const struct pcap_pkthdr *pcap_header, const uint8_t *packet, int verbosity){
+    static uint64_t count_packets = 0;
+    parse_cli_nth(pcap_header, packet, verbosity, count_packets);
+    count_packets++;
+}
+
+// the text of a packet, at its verbosity
+static void
+render_text(const struct pcap_pkthdr *pcap_header, int verbosity, uint64_t packet_number)
+{
+    cli_puts("------------------------------------------------------------------\n");
     if (verbosity == VB_MAXIMAL){
-        printf("Packet %d\n", count_packets);
+        cli_puts("Packet ");
+        cli_uint(packet_number);
+        cli_puts("\n");
     }
     print_timestamp(pcap_header, verbosity);
     switch(verbosity){
         case VB_MINIMAL:
-            parse_min(packet);
+            render_min(&cli_dissection);
             break;
         case VB_MIDDLE:
-            parse_mid(packet);
+            render_mid(&cli_dissection);
             break;
         case VB_MAXIMAL:
-            parse_max(packet);
+            render_max(&cli_dissection);
             break;
         default:
             break;
     }
-    count_packets++;
-    printf("\n");
+    cli_puts("\n");
 }
 
+/**
+ * @brief Same as parse_cli() with the packet number given by the caller,
+ * for callers decoding packets out of capture order
+ * 
+ * @param pcap_header 
+ * @param packet 
+ * @param verbosity 
+ * @param packet_number 
+ */
 void
-parse_min(uint8_t *packet)
+parse_cli_nth(const struct pcap_pkthdr *pcap_header, const uint8_t *packet, int verbosity, uint64_t packet_number){
+    STAGE_BEGIN(parse_start);
+    // the previous packet's decoding is gone
+    arena_reset(cli_arena());
+    // decoded once, the renderer only chooses the layers
+    bool verbose = (cli_format == FORMAT_TEXT && verbosity == VB_MAXIMAL);
+    cli_dissection.reassembly = cli_reassembly();
+    cli_dissection.tcp_reassembly = cli_tcp_reassembly();
+    cli_dissection.timestamp = (uint64_t)pcap_header->ts.tv_sec * 1000000 + pcap_header->ts.tv_usec;
+    uint32_t wanted = cli_layers(verbosity);
+    if (cli_dns != NULL){
+        wanted |= CLI_DNS_LAYERS;
+    }
+    if (cli_top != NULL){
+        wanted |= CLI_TOP_LAYERS;
+    }
+    if (cli_distinct != NULL){
+        wanted |= CLI_DISTINCT_LAYERS;
+    }
+    if (cli_stats != NULL){
+        wanted |= CLI_STATS_LAYERS;
+    }
+    dissect(packet, pcap_header->caplen, wanted, cli_arena(), verbose, &cli_dissection);
+    if (cli_dns != NULL){
+        STAGE_BEGIN(start);
+        cli_dns_update(&cli_dissection);
+        STAGE_END(start, STAGE_DNS_TRACKER);
+    }
+    if (cli_top != NULL){
+        STAGE_BEGIN(start);
+        cli_top_update(pcap_header, &cli_dissection);
+        STAGE_END(start, STAGE_TOP);
+    }
+    if (cli_distinct != NULL){
+        STAGE_BEGIN(start);
+        cli_distinct_update(pcap_header, &cli_dissection);
+        STAGE_END(start, STAGE_DISTINCT);
+    }
+    if (cli_stats != NULL){
+        STAGE_BEGIN(start);
+        cli_stats_update(pcap_header, &cli_dissection);
+        STAGE_END(start, STAGE_STATS);
+    }
+    STAGE_BEGIN(render_start);
+    if (cli_format == FORMAT_NDJSON){
+        parse_ndjson(pcap_header, &cli_dissection, packet_number);
+    } else if (cli_format == FORMAT_COLUMNS){
+        parse_columns(pcap_header, &cli_dissection);
+    } else {
+        render_text(pcap_header, verbosity, packet_number);
+    }
+    STAGE_END(render_start, STAGE_RENDER);
+    STAGE_END(parse_start, STAGE_PARSE);
+}
+
+/**
+ * @brief The layers the output format and the verbosity read
+ * 
+ * @param verbosity 
+ * @return uint32_t LAYER_BIT()s and details for dissect(), 0 if nothing is printed
+ */
+uint32_t
+cli_layers(int verbosity)
+{
+    if (cli_format == FORMAT_NDJSON){
+        return LAYERS_NDJSON;
+    }
+    if (cli_format == FORMAT_COLUMNS){
+        return LAYERS_COLUMNS;
+    }
+    switch(verbosity){
+        case VB_MINIMAL:
+            return LAYERS_TEXT_MINIMAL;
+        case VB_MIDDLE:
+            return LAYERS_TEXT_MIDDLE;
+        case VB_MAXIMAL:
+            return LAYERS_TEXT_MAXIMAL;
+        default:
+            return 0;
+    }
+}
+
+void
+render_min(const dissection_t *dissection)
 {   
-    my_ethernet_header_t ethernet_header = parse_ethernet(packet, false);
-    diplay_ethernet_header(ethernet_header, VB_MINIMAL);
-    packet = packet + sizeof(struct ether_header);
-
-    my_ipv4_header_t ipv4_header = {0};
-    my_ipv6_header_t ipv6_header = {0};
-
-    if (ethernet_header.type == ETHERTYPE_IP){
-        ipv4_header = parse_ipv4(packet, false);
-        display_ipv4_header(ipv4_header, VB_MINIMAL);
-        packet = packet + ipv4_header.header_length * 4;
-    } else if (ethernet_header.type == ETHERTYPE_ARP){
-        my_arp_header_t arp_header = parse_arp(packet, false);
-        display_arp_header(arp_header, VB_MINIMAL);
-    } else if (ethernet_header.type == ETHERTYPE_IPV6){
-        ipv6_header = parse_ipv6(packet, false);
-        display_ipv6_header(ipv6_header, VB_MINIMAL);
-        packet = packet + IPV6_HEADER_SIZE;
+    if (dissection_has(dissection, LAYER_ETHERNET)){
+        diplay_ethernet_header(dissection->ethernet, VB_MINIMAL);
+    }
+
+    if (dissection_has(dissection, LAYER_IPV4)){
+        display_ipv4_header(dissection->ipv4, VB_MINIMAL);
+    } else if (dissection_has(dissection, LAYER_ARP)){
+        display_arp_header(dissection->arp, VB_MINIMAL);
+    } else if (dissection_has(dissection, LAYER_IPV6)){
+        display_ipv6_header(dissection->ipv6, VB_MINIMAL);
     } else {
-        printf("\n");
+        cli_puts("\n");
     }
 
-    my_tcp_header_t tcp_header = {0};
-    my_udp_header_t udp_header = {0};
+    if (dissection_has(dissection, LAYER_IPV4)){
+        cli_word(dissection->ipv4.protocol_name);
+    } else if (dissection_has(dissection, LAYER_IPV6)){
+        cli_word(dissection->ipv6.next_header_name);
+    }
 
-    if (!is_ipv4_header_empty(&ipv4_header)){
-        printf("%s ", ipv4_header.protocol_name);
-        switch (ipv4_header.protocol){
-            case IPPROTO_TCP: {
-                tcp_header = parse_tcp_header(packet, ipv4_header.raw_source_address, ipv4_header.raw_destination_address, ipv4_header.protocol, false);
-                printf("%d > %d ", tcp_header.source_port, tcp_header.destination_port);
-                packet += tcp_header.data_offset * 4;
-                break;
-            }
-            case IPPROTO_UDP: {
-                udp_header = parse_udp(packet, ipv4_header.raw_source_address, ipv4_header.raw_destination_address, ipv4_header.protocol, false);
-                printf("%d > %d ", udp_header.source_port, udp_header.destination_port);
-                packet += sizeof(struct udphdr);
-                break;
-            }
-            case IPPROTO_ICMP: {
-                my_icmp_t icmp_header = parse_icmp(packet, ipv4_header.total_length - ipv4_header.header_length, false);
-                printf("%s ", icmp_header.icmp_type_desc);
-                printf("%s ", icmp_header.icmp_code_desc);
-                break;
-            }
-            default:
-                break;
-        }
-    } else
-    if(!is_ipv6_header_empty(&ipv6_header)){
-        printf("%s ", ipv6_header.next_header_name);
-        switch(ipv6_header.next_header){
-            case IPPROTO_TCP: {
-                tcp_header = parse_tcp_header(packet, ipv6_header.raw_source_address, ipv6_header.raw_destination_address, ipv6_header.next_header, false);
-                printf("%d > %d ", tcp_header.source_port, tcp_header.destination_port);
-                packet += tcp_header.data_offset * 4;
-                break;
-            }
-            case IPPROTO_UDP: {
-                udp_header = parse_udp(packet, ipv6_header.raw_source_address, ipv6_header.raw_destination_address, ipv6_header.next_header, false);
-                printf("%d > %d ", udp_header.source_port, udp_header.destination_port);
-                packet += sizeof(struct udphdr);
-                break;
-            }
-            case IPPROTO_ICMPV6: {
-                my_icmpv6_t icmpv6_header = parse_icmpv6(packet, ipv6_header.payload_length, ipv6_header.raw_source_address, ipv6_header.raw_destination_address, false);
-                printf("%s ", icmpv6_header.icmpv6_type_desc);
-                if (icmpv6_header.type == ND_NEIGHBOR_SOLICIT){
-                    printf("%s ", icmpv6_header.payload);
-                }
-                free_parse_icmpv6(&icmpv6_header);
-                break;
-            }
-            default:
-                break;
+    if (dissection_has(dissection, LAYER_TCP)){
+        const my_tcp_header_t *tcp_header = &dissection->tcp;
+        cli_uint(tcp_header->source_port);
+        cli_puts(" > ");
+        cli_uint(tcp_header->destination_port);
+        cli_puts(" ");
+        cli_word(tcp_header->tcp_flags_desc);
+    } else if (dissection_has(dissection, LAYER_UDP)){
+        const my_udp_header_t *udp_header = &dissection->udp;
+        cli_uint(udp_header->source_port);
+        cli_puts(" > ");
+        cli_uint(udp_header->destination_port);
+        cli_puts(" ");
+    } else if (dissection_has(dissection, LAYER_ICMP)){
+        cli_word(dissection->icmp.icmp_type_desc);
+        cli_word(dissection->icmp.icmp_code_desc);
+    } else if (dissection_has(dissection, LAYER_ICMPV6)){
+        const my_icmpv6_t *icmpv6_header = &dissection->icmpv6;
+        cli_word(icmpv6_header->icmpv6_type_desc);
+        if (icmpv6_header->type == ND_NEIGHBOR_SOLICIT){
+            cli_word(icmpv6_header->payload);
         }
     }
-    if (!is_tcp_header_empty(&tcp_header)){
-        printf("%s ", tcp_header.tcp_flags_desc);
-        switch(tcp_header.destination_port){
-            case PORT_DNS: {
-                my_dns_header_t dns_header = parse_dns(packet, false);
-                display_dns_header(dns_header, VB_MINIMAL);
-                free_dns_header(&dns_header);
-                break;
-            }
-            default:
-                break;
-        }
-    } else
-    if (!is_udp_header_empty(&udp_header)){
-        switch(udp_header.destination_port){
-            case PORT_BOOTPC:
-            case PORT_BOOTPS: {
-                printf("BOOTP/DHCP ");
-                my_dhcp_bootp_header_t dhcp_header = parse_bootp(packet, false);
-                printf("%s ", dhcp_header.bp_op_desc);
-                (dhcp_header.bp_op == BOOTREQUEST) ? printf("from %s ", dhcp_header.client_ip_address) : printf("to %s ", dhcp_header.your_ip_address);
-                free_dhcp_bootp_header(&dhcp_header);
-                break;
-            }
-            case PORT_DNS: {
-                my_dns_header_t dns_header = parse_dns(packet, false);
-                display_dns_header(dns_header, VB_MINIMAL);
-                free_dns_header(&dns_header);
-                break;
-            }
-            default:
-                break;
-        }
 
+    if (dissection_has(dissection, LAYER_DNS)){
+        display_dns_header(dissection->dns, VB_MINIMAL);
+        for (uint32_t i = 0; i < dissection->dns_more_count; i++){
+            display_dns_header(dissection->dns_more[i], VB_MINIMAL);
+        }
+    } else if (dissection_has(dissection, LAYER_DHCP)){
+        const my_dhcp_bootp_header_t *dhcp_header = &dissection->dhcp;
+        cli_puts("BOOTP/DHCP ");
+        cli_word(dhcp_header->bp_op_desc);
+        (dhcp_header->bp_op == BOOTREQUEST) ? cli_printf("from %s ", dhcp_header->client_ip_address) : cli_printf("to %s ", dhcp_header->your_ip_address);
     }
+}
 
-
+// a DNS message on one line, one packet over TCP can hold several
+static void
+render_dns_mid(const my_dns_header_t *dns_header, bool udp)
+{
+    if (udp){
+        cli_puts("DNS ");
+    }
+    cli_printf("xid: %d | ", dns_header->transaction_id);
+    cli_printf("op: %s | ", dns_header->opcode_desc);
+    cli_printf("questions count: %d | ", dns_header->qdcount);
+    cli_printf("answers count: %d | ", dns_header->ancount);
+    cli_printf("authority count: %d | ", dns_header->nscount);
+    cli_printf("additional count: %d \n", dns_header->arcount);
 }
 
 void
-parse_mid(uint8_t *packet)
+render_mid(const dissection_t *dissection)
 {   
-    my_ethernet_header_t ethernet_header = parse_ethernet(packet, false);
-    diplay_ethernet_header(ethernet_header, VB_MIDDLE);
-
-    my_ipv4_header_t ipv4_header = {0};
-    my_ipv6_header_t ipv6_header = {0};
-
-    packet = packet + sizeof(struct ether_header);
-    if (ethernet_header.type == ETHERTYPE_IP){
-        ipv4_header = parse_ipv4(packet, false);
-        display_ipv4_header(ipv4_header, VB_MIDDLE);
-        packet = packet + ipv4_header.header_length * 4;
-    } else if (ethernet_header.type == ETHERTYPE_ARP){
-        my_arp_header_t arp_header = parse_arp(packet, false);
-        display_arp_header(arp_header, VB_MIDDLE);
-    } else if (ethernet_header.type == ETHERTYPE_IPV6){
-        ipv6_header = parse_ipv6(packet, false);
-        display_ipv6_header(ipv6_header, VB_MIDDLE);
-        packet = packet + IPV6_HEADER_SIZE;
+    if (dissection_has(dissection, LAYER_ETHERNET)){
+        diplay_ethernet_header(dissection->ethernet, VB_MIDDLE);
+    }
+
+    if (dissection_has(dissection, LAYER_IPV4)){
+        display_ipv4_header(dissection->ipv4, VB_MIDDLE);
+        cli_word(dissection->ipv4.protocol_name);
+    } else if (dissection_has(dissection, LAYER_ARP)){
+        display_arp_header(dissection->arp, VB_MIDDLE);
+    } else if (dissection_has(dissection, LAYER_IPV6)){
+        display_ipv6_header(dissection->ipv6, VB_MIDDLE);
+        cli_word(dissection->ipv6.next_header_name);
     } else {
-        printf("\n");
-    }
-
-    my_tcp_header_t tcp_header = {0};
-    my_udp_header_t udp_header = {0};
-
-    if (!is_ipv4_header_empty(&ipv4_header)){
-        printf("%s ", ipv4_header.protocol_name);
-        switch (ipv4_header.protocol){
-            case IPPROTO_TCP: {
-                tcp_header = parse_tcp_header(packet, ipv4_header.raw_source_address, ipv4_header.raw_destination_address, ipv4_header.protocol, false);
-                printf("%d > %d | ", tcp_header.source_port, tcp_header.destination_port);
-                printf("%s | ", tcp_header.tcp_flags_desc);
-                printf("Window: %d | ", tcp_header.window);
-                printf("Checksum: %x ", tcp_header.checksum);
-                (tcp_header.checksum_correct) ? printf("(correct) \n") : printf("(incorrect) calculated: %x\n", tcp_header.calculated_checksum);
-                packet += tcp_header.data_offset * 4;
-                break;
-            }
-            case IPPROTO_UDP: {
-                udp_header = parse_udp(packet, ipv4_header.raw_source_address, ipv4_header.raw_destination_address, ipv4_header.protocol, false);
-                printf("%d > %d ", udp_header.source_port, udp_header.destination_port);
-                printf("Length: %d | ", udp_header.length);
-                printf("Checksum: %x  ", udp_header.checksum);
-                (udp_header.checksum_correct) ? printf("(correct) \n") : printf("(incorrect) calculated: %x\n", udp_header.calculated_checksum);
-                packet += sizeof(struct udphdr);
-                break;
-            }
-            case IPPROTO_ICMP: {
-                my_icmp_t icmp_header = parse_icmp(packet, ipv4_header.total_length - ipv4_header.header_length, false);
-                printf("Type: %s |", icmp_header.icmp_type_desc);
-                printf("Code: %s |", icmp_header.icmp_code_desc);
-                printf("Identifier: %d | ", icmp_header.identifier);
-                printf("Checksum: %x ", icmp_header.checksum);
-                (icmp_header.checksum_valid) ? printf("(correct) \n") : printf("(incorrect) calculated: %x\n", icmp_header.calculated_checksum);
-                break;
-            }
-            default:
-                break;
-        }
-    } else
-    if(!is_ipv6_header_empty(&ipv6_header)){
-        printf("%s ", ipv6_header.next_header_name);
-        switch(ipv6_header.next_header){
-            case IPPROTO_TCP: {
-                tcp_header = parse_tcp_header(packet, ipv6_header.raw_source_address, ipv6_header.raw_destination_address, ipv6_header.next_header, false);
-                printf("%s | ", tcp_header.tcp_flags_desc);
-                printf("Window: %d | ", tcp_header.window);
-                printf("Checksum: %x ", tcp_header.checksum);
-                (tcp_header.checksum_correct) ? printf("(correct) \n") : printf("(incorrect) calculated: %x\n", tcp_header.calculated_checksum);
-                packet += tcp_header.data_offset * 4;
-                break;
-            }
-            case IPPROTO_UDP: {
-                udp_header = parse_udp(packet, ipv6_header.raw_source_address, ipv6_header.raw_destination_address, ipv6_header.next_header, false);
-                printf("%d > %d ", udp_header.source_port, udp_header.destination_port);
-                printf("Length: %d | ", udp_header.length);
-                printf("Checksum: %x  ", udp_header.checksum);
-                (udp_header.checksum_correct) ? printf("(correct) \n") : printf("(incorrect) calculated: %x\n", udp_header.calculated_checksum);
-                packet += sizeof(struct udphdr);
-                break;
-            }
-            case IPPROTO_ICMPV6: {
-                my_icmpv6_t icmpv6_header = parse_icmpv6(packet, ipv6_header.payload_length, ipv6_header.raw_source_address, ipv6_header.raw_destination_address, false);
-                printf("Type: %s | ", icmpv6_header.icmpv6_type_desc);
-                printf("Code: %s | ", icmpv6_header.icmpv6_code_desc);
-                printf("Identifier: %d | ", icmpv6_header.identifier);
-                if (icmpv6_header.type == ND_NEIGHBOR_SOLICIT){
-                    printf("Target address: %s | ", icmpv6_header.payload);
-                }
-                printf("Checksum: %x ", icmpv6_header.checksum);
-                (icmpv6_header.checksum_valid) ? printf("(correct) \n") : printf("(incorrect) calculated: %x\n", icmpv6_header.calculated_checksum);
-                free_parse_icmpv6(&icmpv6_header);
-                break;
-            }
-            default:
-                break;
-        }
+        cli_puts("\n");
     }
-    if (!is_tcp_header_empty(&tcp_header)){
-        switch(tcp_header.destination_port){
-            case PORT_DNS: {
-                my_dns_header_t dns_header = parse_dns(packet, false);
-                printf("xid: %d | ", dns_header.transaction_id);
-                printf("op: %s | ", dns_header.opcode_desc);
-                printf("questions count: %d | ", dns_header.qdcount);
-                printf("answers count: %d | ", dns_header.ancount);
-                printf("authority count: %d | ", dns_header.nscount);
-                printf("additional count: %d \n", dns_header.arcount);
-                free_dns_header(&dns_header);
-                break;
-            }
-            default:
-                break;
+
+    if (dissection_has(dissection, LAYER_TCP)){
+        const my_tcp_header_t *tcp_header = &dissection->tcp;
+        // the ports are only on the IPv4 line
+        if (dissection_has(dissection, LAYER_IPV4)){
+            cli_printf("%d > %d | ", tcp_header->source_port, tcp_header->destination_port);
         }
-    } else
-    if (!is_udp_header_empty(&udp_header)){
-        switch(udp_header.destination_port){
-            case PORT_BOOTPC:
-            case PORT_BOOTPS: {
-                printf("BOOTP/DHCP ");
-                my_dhcp_bootp_header_t dhcp_header = parse_bootp(packet, false);
-                printf("%s | ", dhcp_header.bp_op_desc);
-                (dhcp_header.bp_op == BOOTREQUEST) ? printf("from %s | ", dhcp_header.client_ip_address) : printf("to %s | ", dhcp_header.your_ip_address);
-                printf("xid: %d | ", dhcp_header.bp_xid);
-                printf("Client HADDR: %s | ", dhcp_header.client_hardware_address);
-                printf("Server host name: %s \n", dhcp_header.server_host_name);
-                free_dhcp_bootp_header(&dhcp_header);
-                break;
-            }
-            case PORT_DNS: {
-                printf("DNS ");
-                my_dns_header_t dns_header = parse_dns(packet, false);
-                printf("xid: %d | ", dns_header.transaction_id);
-                printf("op: %s | ", dns_header.opcode_desc);
-                printf("questions count: %d | ", dns_header.qdcount);
-                printf("answers count: %d | ", dns_header.ancount);
-                printf("authority count: %d | ", dns_header.nscount);
-                printf("additional count: %d \n", dns_header.arcount);
-                free_dns_header(&dns_header);
-                break;
-            }
-            default:
-                break;
+        cli_printf("%s | ", tcp_header->tcp_flags_desc);
+        cli_printf("Window: %d | ", tcp_header->window);
+        cli_printf("Checksum: %x ", tcp_header->checksum);
+        (tcp_header->checksum_correct) ? cli_puts("(correct) \n") : cli_printf("(incorrect) calculated: %x\n", tcp_header->calculated_checksum);
+    } else if (dissection_has(dissection, LAYER_UDP)){
+        const my_udp_header_t *udp_header = &dissection->udp;
+        cli_uint(udp_header->source_port);
+        cli_puts(" > ");
+        cli_uint(udp_header->destination_port);
+        cli_puts(" ");
+        cli_printf("Length: %d | ", udp_header->length);
+        cli_printf("Checksum: %x  ", udp_header->checksum);
+        (udp_header->checksum_correct) ? cli_puts("(correct) \n") : cli_printf("(incorrect) calculated: %x\n", udp_header->calculated_checksum);
+    } else if (dissection_has(dissection, LAYER_ICMP)){
+        const my_icmp_t *icmp_header = &dissection->icmp;
+        cli_printf("Type: %s |", icmp_header->icmp_type_desc);
+        cli_printf("Code: %s |", icmp_header->icmp_code_desc);
+        cli_printf("Identifier: %d | ", icmp_header->identifier);
+        cli_printf("Checksum: %x ", icmp_header->checksum);
+        (icmp_header->checksum_valid) ? cli_puts("(correct) \n") : cli_printf("(incorrect) calculated: %x\n", icmp_header->calculated_checksum);
+    } else if (dissection_has(dissection, LAYER_ICMPV6)){
+        const my_icmpv6_t *icmpv6_header = &dissection->icmpv6;
+        cli_printf("Type: %s | ", icmpv6_header->icmpv6_type_desc);
+        cli_printf("Code: %s | ", icmpv6_header->icmpv6_code_desc);
+        cli_printf("Identifier: %d | ", icmpv6_header->identifier);
+        if (icmpv6_header->type == ND_NEIGHBOR_SOLICIT){
+            cli_printf("Target address: %s | ", icmpv6_header->payload);
         }
+        cli_printf("Checksum: %x ", icmpv6_header->checksum);
+        (icmpv6_header->checksum_valid) ? cli_puts("(correct) \n") : cli_printf("(incorrect) calculated: %x\n", icmpv6_header->calculated_checksum);
+    }
 
+    if (dissection_has(dissection, LAYER_DNS)){
+        bool udp = dissection_has(dissection, LAYER_UDP);
+        render_dns_mid(&dissection->dns, udp);
+        for (uint32_t i = 0; i < dissection->dns_more_count; i++){
+            render_dns_mid(&dissection->dns_more[i], udp);
+        }
+    } else if (dissection_has(dissection, LAYER_DHCP)){
+        const my_dhcp_bootp_header_t *dhcp_header = &dissection->dhcp;
+        cli_puts("BOOTP/DHCP ");
+        cli_printf("%s | ", dhcp_header->bp_op_desc);
+        (dhcp_header->bp_op == BOOTREQUEST) ? cli_printf("from %s | ", dhcp_header->client_ip_address) : cli_printf("to %s | ", dhcp_header->your_ip_address);
+        cli_printf("xid: %d | ", dhcp_header->bp_xid);
+        cli_printf("Client HADDR: %s | ", dhcp_header->client_hardware_address);
+        cli_printf("Server host name: %s \n", dhcp_header->server_host_name);
     }
 }
 
@@ -309,26 +506,28 @@ diplay_ethernet_header(my_ethernet_header_t ethernet_header, int verbosity)
 {
     switch(verbosity){
         case VB_MINIMAL: {
-            printf("%s > %s ", ethernet_header.src_mac, ethernet_header.dst_mac);
-            printf("%s ", ethernet_header.type_desc);
+            cli_word(ethernet_header.src_mac);
+            cli_puts("> ");
+            cli_word(ethernet_header.dst_mac);
+            cli_word(ethernet_header.type_desc);
             break;
         }
         case VB_MIDDLE: {
-            printf("Ethernet: src: %s > dst: %s %s\n", ethernet_header.src_mac, ethernet_header.dst_mac, ethernet_header.type_desc);
+            cli_printf("Ethernet: src: %s > dst: %s %s\n", ethernet_header.src_mac, ethernet_header.dst_mac, ethernet_header.type_desc);
             break;
         }
         case VB_MAXIMAL: {
-            printf("Ethernet ---------------------------------------------------------\n");
-            printf("|   Source MAC: %s\n", ethernet_header.src_mac);
-            printf("|   Destination MAC: %s\n", ethernet_header.dst_mac);
-            printf("|   Type: %s (%d)\n", ethernet_header.type_desc, ethernet_header.type);
-            printf("|   is vlan_tagged: %s\n", (ethernet_header.vlan_tagged) ? "yes" : "no");
+            cli_puts("Ethernet ---------------------------------------------------------\n");
+            cli_printf("|   Source MAC: %s\n", ethernet_header.src_mac);
+            cli_printf("|   Destination MAC: %s\n", ethernet_header.dst_mac);
+            cli_printf("|   Type: %s (%d)\n", ethernet_header.type_desc, ethernet_header.type);
+            cli_printf("|   is vlan_tagged: %s\n", (ethernet_header.vlan_tagged) ? "yes" : "no");
             if (ethernet_header.vlan_tagged){
-                printf("|       VLAN ID: %d\n", ethernet_header.vlan_id);
-                printf("|       PCP: %d\n", ethernet_header.pcp);
-                printf("|       DEI: %d\n", ethernet_header.dei);
-                printf("|       Type VLAN: %d\n", ethernet_header.type_vlan);
-                printf("|       Type VLAN Description: %s\n", ethernet_header.type_desc_vlan);
+                cli_printf("|       VLAN ID: %d\n", ethernet_header.vlan_id);
+                cli_printf("|       PCP: %d\n", ethernet_header.pcp);
+                cli_printf("|       DEI: %d\n", ethernet_header.dei);
+                cli_printf("|       Type VLAN: %d\n", ethernet_header.type_vlan);
+                cli_printf("|       Type VLAN Description: %s\n", ethernet_header.type_desc_vlan);
             }
             break;
         }
@@ -340,35 +539,38 @@ display_ipv4_header(my_ipv4_header_t ipv4_header, int verbosity)
 {
     switch(verbosity){
         case VB_MINIMAL:{
-            printf(" %s > %s ", ipv4_header.source_ipv4, ipv4_header.destination_ipv4);
+            cli_puts(" ");
+            cli_word(ipv4_header.source_ipv4);
+            cli_puts("> ");
+            cli_word(ipv4_header.destination_ipv4);
             break;
         }
         case VB_MIDDLE:{
-            printf("IPv4: %s > %s | ", ipv4_header.source_ipv4, ipv4_header.destination_ipv4);
-            printf("Checksum: %x ", ipv4_header.checksum);
-            (ipv4_header.checksum_correct) ? printf("(correct) | ") : printf("(incorrect) | ");
-            printf("TTL: %d | ", ipv4_header.time_to_live);
-            printf("ID: %d\n", ipv4_header.identification);
+            cli_printf("IPv4: %s > %s | ", ipv4_header.source_ipv4, ipv4_header.destination_ipv4);
+            cli_printf("Checksum: %x ", ipv4_header.checksum);
+            (ipv4_header.checksum_correct) ? cli_puts("(correct) | ") : cli_puts("(incorrect) | ");
+            cli_printf("TTL: %d | ", ipv4_header.time_to_live);
+            cli_printf("ID: %d\n", ipv4_header.identification);
             break;
         }
         case VB_MAXIMAL:{
-            printf("|\n|   IPv4 ---------------------------------------------------------\n");
-            printf("|   |   Source IP: %s\n", ipv4_header.source_ipv4);
-            printf("|   |   Destination IP: %s\n", ipv4_header.destination_ipv4);
-            printf("|   |   Version: %d\n", ipv4_header.version);
-            printf("|   |   Header Length: %d\n", ipv4_header.header_length);
-            printf("|   |   DSCP: %s (%d)\n", ipv4_header.dscp_desc, ipv4_header.dscp_value);
-            printf("|   |   ECN: %s (%d)\n", ipv4_header.ecn_desc, ipv4_header.ecn_value);
-            printf("|   |   Total Length: %d\n", ipv4_header.total_length);
-            printf("|   |   Identification: %d\n", ipv4_header.identification);
-            printf("|   |   Flags: %s \n", ipv4_header.flags_desc);
-            printf("|   |   Fragment Offset: %d\n", ipv4_header.fragment_offset);
-            printf("|   |   TTL: %d\n", ipv4_header.time_to_live);
-            printf("|   |   Protocol: %d (%s)\n", ipv4_header.protocol, ipv4_header.protocol_name);
-            printf("|   |   Checksum: 0x%x\n", ipv4_header.checksum);
-            printf("|   |   is Checksum correct: %s\n", (ipv4_header.checksum_correct) ? "yes" : "no");
-            printf("|   |   Source IP (raw): %d.%d.%d.%d\n", ipv4_header.raw_source_address[0], ipv4_header.raw_source_address[1], ipv4_header.raw_source_address[2], ipv4_header.raw_source_address[3]);
-            printf("|   |   Destination IP (raw): %d.%d.%d.%d\n", ipv4_header.raw_destination_address[0], ipv4_header.raw_destination_address[1], ipv4_header.raw_destination_address[2], ipv4_header.raw_destination_address[3]);
+            cli_puts("|\n|   IPv4 ---------------------------------------------------------\n");
+            cli_printf("|   |   Source IP: %s\n", ipv4_header.source_ipv4);
+            cli_printf("|   |   Destination IP: %s\n", ipv4_header.destination_ipv4);
+            cli_printf("|   |   Version: %d\n", ipv4_header.version);
+            cli_printf("|   |   Header Length: %d\n", ipv4_header.header_length);
+            cli_printf("|   |   DSCP: %s (%d)\n", ipv4_header.dscp_desc, ipv4_header.dscp_value);
+            cli_printf("|   |   ECN: %s (%d)\n", ipv4_header.ecn_desc, ipv4_header.ecn_value);
+            cli_printf("|   |   Total Length: %d\n", ipv4_header.total_length);
+            cli_printf("|   |   Identification: %d\n", ipv4_header.identification);
+            cli_printf("|   |   Flags: %s \n", ipv4_header.flags_desc);
+            cli_printf("|   |   Fragment Offset: %d\n", ipv4_header.fragment_offset);
+            cli_printf("|   |   TTL: %d\n", ipv4_header.time_to_live);
+            cli_printf("|   |   Protocol: %d (%s)\n", ipv4_header.protocol, ipv4_header.protocol_name);
+            cli_printf("|   |   Checksum: 0x%x\n", ipv4_header.checksum);
+            cli_printf("|   |   is Checksum correct: %s\n", (ipv4_header.checksum_correct) ? "yes" : "no");
+            cli_printf("|   |   Source IP (raw): %d.%d.%d.%d\n", ipv4_header.raw_source_address[0], ipv4_header.raw_source_address[1], ipv4_header.raw_source_address[2], ipv4_header.raw_source_address[3]);
+            cli_printf("|   |   Destination IP (raw): %d.%d.%d.%d\n", ipv4_header.raw_destination_address[0], ipv4_header.raw_destination_address[1], ipv4_header.raw_destination_address[2], ipv4_header.raw_destination_address[3]);
             break;
         }
     }
@@ -380,37 +582,37 @@ display_arp_header(my_arp_header_t arp_header, int verbosity)
 {
     switch(verbosity){
         case VB_MINIMAL:{
-            printf("%s ", arp_header.operation_desc);
+            cli_word(arp_header.operation_desc);
             if (arp_header.operation == ARPOP_REQUEST){
-                printf("Who has %s ? Tell %s ", arp_header.target_protocol_address, arp_header.sender_protocol_address);
+                cli_printf("Who has %s ? Tell %s ", arp_header.target_protocol_address, arp_header.sender_protocol_address);
             } else if (arp_header.operation == ARPOP_REPLY){
-                printf("%s is at %s ", arp_header.sender_protocol_address, arp_header.sender_hardware_address);
+                cli_printf("%s is at %s ", arp_header.sender_protocol_address, arp_header.sender_hardware_address);
             }
             break;
         }
         case VB_MIDDLE:{
-            printf("ARP: %s | ", arp_header.operation_desc);
+            cli_printf("ARP: %s | ", arp_header.operation_desc);
             if (arp_header.operation == ARPOP_REQUEST){
-                printf("Who has %s ? Tell %s \n", arp_header.target_protocol_address, arp_header.sender_protocol_address);
+                cli_printf("Who has %s ? Tell %s \n", arp_header.target_protocol_address, arp_header.sender_protocol_address);
             } else if (arp_header.operation == ARPOP_REPLY){
-                printf("%s is at %s \n", arp_header.sender_protocol_address, arp_header.sender_hardware_address);
+                cli_printf("%s is at %s \n", arp_header.sender_protocol_address, arp_header.sender_hardware_address);
             }
         }
         case VB_MAXIMAL:{
-            printf("|\n|   ARP ----------------------------------------------------------\n");
-            printf("|   |   Operation: %s (%d)\n", arp_header.operation_desc, arp_header.operation);
-            printf("|   |   Hardware Type: %s (%d)\n", arp_header.hardware_type_desc, arp_header.hardware_type);
-            printf("|   |   Protocol Type: %s (%d)\n", arp_header.protocol_type_desc, arp_header.protocol_type);
-            printf("|   |   Hardware Address Length: %d\n", arp_header.hardware_address_length);
-            printf("|   |   Protocol Length: %d\n", arp_header.protocol_length);
-            printf("|   |   Sender Hardware Address: %s\n", arp_header.sender_hardware_address);
-            printf("|   |   Sender Protocol Address: %s\n", arp_header.sender_protocol_address);
-            printf("|   |   Target Hardware Address: %s\n", arp_header.target_hardware_address);
-            printf("|   |   Target Protocol Address: %s\n", arp_header.target_protocol_address);
+            cli_puts("|\n|   ARP ----------------------------------------------------------\n");
+            cli_printf("|   |   Operation: %s (%d)\n", arp_header.operation_desc, arp_header.operation);
+            cli_printf("|   |   Hardware Type: %s (%d)\n", arp_header.hardware_type_desc, arp_header.hardware_type);
+            cli_printf("|   |   Protocol Type: %s (%d)\n", arp_header.protocol_type_desc, arp_header.protocol_type);
+            cli_printf("|   |   Hardware Address Length: %d\n", arp_header.hardware_address_length);
+            cli_printf("|   |   Protocol Length: %d\n", arp_header.protocol_length);
+            cli_printf("|   |   Sender Hardware Address: %s\n", arp_header.sender_hardware_address);
+            cli_printf("|   |   Sender Protocol Address: %s\n", arp_header.sender_protocol_address);
+            cli_printf("|   |   Target Hardware Address: %s\n", arp_header.target_hardware_address);
+            cli_printf("|   |   Target Protocol Address: %s\n", arp_header.target_protocol_address);
             if (arp_header.operation == ARPOP_REQUEST){
-                printf("|   |   Who has %s ? Tell %s \n", arp_header.target_protocol_address, arp_header.sender_protocol_address);
+                cli_printf("|   |   Who has %s ? Tell %s \n", arp_header.target_protocol_address, arp_header.sender_protocol_address);
             } else if (arp_header.operation == ARPOP_REPLY){
-                printf("|   |   %s is at %s \n", arp_header.sender_protocol_address, arp_header.sender_hardware_address);
+                cli_printf("|   |   %s is at %s \n", arp_header.sender_protocol_address, arp_header.sender_hardware_address);
             }
         }
     }
@@ -422,36 +624,39 @@ display_ipv6_header(my_ipv6_header_t ipv6_header, int verbosity)
 {
     switch(verbosity){
         case VB_MINIMAL:{
-            printf(" %s > %s ", ipv6_header.source_address, ipv6_header.destination_address);
+            cli_puts(" ");
+            cli_word(ipv6_header.source_address);
+            cli_puts("> ");
+            cli_word(ipv6_header.destination_address);
             break;
         }
         case VB_MIDDLE:{
-            printf("IPv6: %s > %s | ", ipv6_header.source_address, ipv6_header.destination_address);
-            printf("Hop Limit: %d | ", ipv6_header.hop_limit);
-            printf("Flow Label: %d | ", ipv6_header.flow_label);
-            printf("Payload Length: %d\n", ipv6_header.payload_length);
+            cli_printf("IPv6: %s > %s | ", ipv6_header.source_address, ipv6_header.destination_address);
+            cli_printf("Hop Limit: %d | ", ipv6_header.hop_limit);
+            cli_printf("Flow Label: %d | ", ipv6_header.flow_label);
+            cli_printf("Payload Length: %d\n", ipv6_header.payload_length);
             break;
         }
         case VB_MAXIMAL:{
-            printf("|\n|   IPv6 ---------------------------------------------------------\n");
-            printf("|   |   Source IP: %s\n", ipv6_header.source_address);
-            printf("|   |   Destination IP: %s\n", ipv6_header.destination_address);
-            printf("|   |   Version: %d\n", ipv6_header.version);
-            printf("|   |   Traffic Class: %d\n", ipv6_header.traffic_class);
-            printf("|   |   Flow Label: %d\n", ipv6_header.flow_label);
-            printf("|   |   Payload Length: %d\n", ipv6_header.payload_length);
-            printf("|   |   Next Header: %d (%s)\n", ipv6_header.next_header, ipv6_header.next_header_name);
-            printf("|   |   Hop Limit: %d\n", ipv6_header.hop_limit);
-            printf("|   |   Source IP (raw): ");
+            cli_puts("|\n|   IPv6 ---------------------------------------------------------\n");
+            cli_printf("|   |   Source IP: %s\n", ipv6_header.source_address);
+            cli_printf("|   |   Destination IP: %s\n", ipv6_header.destination_address);
+            cli_printf("|   |   Version: %d\n", ipv6_header.version);
+            cli_printf("|   |   Traffic Class: %d\n", ipv6_header.traffic_class);
+            cli_printf("|   |   Flow Label: %d\n", ipv6_header.flow_label);
+            cli_printf("|   |   Payload Length: %d\n", ipv6_header.payload_length);
+            cli_printf("|   |   Next Header: %d (%s)\n", ipv6_header.next_header, ipv6_header.next_header_name);
+            cli_printf("|   |   Hop Limit: %d\n", ipv6_header.hop_limit);
+            cli_puts("|   |   Source IP (raw): ");
             for (int i = 0; i < IPV6_INT8_ADDR_SIZE; i++){
-                printf(" %02x", ipv6_header.raw_source_address[i]);
+                cli_printf(" %02x", ipv6_header.raw_source_address[i]);
             }
-            printf("\n");
-            printf("|   |   Destination IP (raw): ");
+            cli_puts("\n");
+            cli_puts("|   |   Destination IP (raw): ");
             for (int i = 0; i < IPV6_INT8_ADDR_SIZE; i++){
-                printf(" %02x", ipv6_header.raw_destination_address[i]);
+                cli_printf(" %02x", ipv6_header.raw_destination_address[i]);
             }
-            printf("\n");
+            cli_puts("\n");
             break;
         }
     }
@@ -463,359 +668,200 @@ display_dns_header(my_dns_header_t dns_header, int verbosity)
 {
     switch(verbosity){
         case VB_MINIMAL:{
-            printf("%d ", dns_header.transaction_id);
-            printf("%s ", dns_header.opcode_desc);
-            printf("qd: %d ", dns_header.qdcount);
+            cli_uint(dns_header.transaction_id);
+            cli_puts(" ");
+            cli_word(dns_header.opcode_desc);
+            cli_puts("qd: ");
+            cli_uint(dns_header.qdcount);
+            cli_puts(" ");
             break;
         }
     }
 }
 
+// a DNS message of the tree, one packet over TCP can hold several
+static void
+render_dns_max(const my_dns_header_t *dns_header)
+{
+    cli_puts("|   |   |  DNS ---------------------------------------------------------\n");
+    cli_printf("|   |   |   |   Transaction-ID: %d (0x%x)\n", dns_header->transaction_id, dns_header->transaction_id);
+    cli_printf("|   |   |   |   Opcode: %s (%d)\n", dns_header->opcode_desc, dns_header->opcode);
+    if (dns_header->aa) cli_printf("|   |   |   |   %s: %s\n", dns_header->aa_desc, (dns_header->aa) ? "yes" : "no");
+    if (dns_header->tc) cli_printf("|   |   |   |   %s: %s\n", dns_header->tc_desc, (dns_header->tc) ? "yes" : "no");
+    if (dns_header->rd) cli_printf("|   |   |   |   %s: %s\n", dns_header->rd_desc, (dns_header->rd) ? "yes" : "no");
+    if (dns_header->ra) cli_printf("|   |   |   |   %s: %s\n", dns_header->ra_desc, (dns_header->ra) ? "yes" : "no");
+    cli_printf("|   |   |   |   Error code: %s: %d\n", dns_header->rcode_desc, dns_header->rcode);
+    cli_printf("|   |   |   |   Questions count: %d \n", dns_header->qdcount);
+    cli_printf("|   |   |   |   Answers count: %d \n", dns_header->ancount);
+    cli_printf("|   |   |   |   Authority count: %d \n", dns_header->nscount);
+    cli_printf("|   |   |   |   Additional count: %d \n", dns_header->arcount);
+
+    for (uint32_t question_count = 0; question_count < dns_header->question_section.count; question_count++){
+        question_section_t *question = &dns_questions_items(&dns_header->question_section)[question_count];
+        cli_printf("|   |   |   |   Question (%u): \n", question_count);
+        cli_printf("|   |   |   |   |   Name: %s\n", question->qname);
+        cli_printf("|   |   |   |   |   Type: %s (%d)\n", question->qtype_desc, question->qtype);
+        cli_printf("|   |   |   |   |   Class: %s (%d)\n", question->qclass_desc, question->qclass);
+    }
+
+    for (uint32_t answer_count = 0; answer_count < dns_header->answer_section.count; answer_count++){
+        resource_record_t *answer = &dns_records_items(&dns_header->answer_section)[answer_count];
+        cli_printf("|   |   |   |   Answer (%u): \n", answer_count);
+        cli_printf("|   |   |   |   |   Name: %s\n", answer->name);
+        cli_printf("|   |   |   |   |   Type: %s (%d)\n", answer->type_desc, answer->type);
+        cli_printf("|   |   |   |   |   Class: %s (%d)\n", answer->class_desc, answer->class);
+        cli_printf("|   |   |   |   |   TTL: %d\n", answer->ttl);
+        cli_printf("|   |   |   |   |   Data length: %d\n", answer->rdlength);
+        cli_printf("|   |   |   |   |   Data: %s\n", answer->rdata_desc);
+    }
+
+    for (uint32_t authority_count = 0; authority_count < dns_header->authority_section.count; authority_count++){
+        resource_record_t *authority = &dns_records_items(&dns_header->authority_section)[authority_count];
+        cli_printf("|   |   |   |   Authority (%u): \n", authority_count);
+        cli_printf("|   |   |   |   |   Name: %s\n", authority->name);
+        cli_printf("|   |   |   |   |   Type: %s (%d)\n", authority->type_desc, authority->type);
+        cli_printf("|   |   |   |   |   Class: %s (%d)\n", authority->class_desc, authority->class);
+        cli_printf("|   |   |   |   |   TTL: %d\n", authority->ttl);
+        cli_printf("|   |   |   |   |   Data length: %d\n", authority->rdlength);
+        cli_printf("|   |   |   |   |   Data: %s\n", authority->rdata_desc);
+    }
+
+    for (uint32_t additional_count = 0; additional_count < dns_header->additional_section.count; additional_count++){
+        resource_record_t *additional = &dns_records_items(&dns_header->additional_section)[additional_count];
+        cli_printf("|   |   |   |   Additional (%u): \n", additional_count);
+        cli_printf("|   |   |   |   |   Name: %s\n", additional->name);
+        cli_printf("|   |   |   |   |   Type: %s (%d)\n", additional->type_desc, additional->type);
+        cli_printf("|   |   |   |   |   Class: %s (%d)\n", additional->class_desc, additional->class);
+        cli_printf("|   |   |   |   |   TTL: %d\n", additional->ttl);
+        cli_printf("|   |   |   |   |   Data length: %d\n", additional->rdlength);
+        cli_printf("|   |   |   |   |   Data: %s\n", additional->rdata_desc);
+    }
+}
+
 void
-parse_max(uint8_t *packet)
+render_max(const dissection_t *dissection)
 {
-    my_ethernet_header_t ethernet_header = parse_ethernet(packet, true);
-    diplay_ethernet_header(ethernet_header, VB_MAXIMAL);
-
-    my_ipv4_header_t ipv4_header = {0};
-    my_ipv6_header_t ipv6_header = {0};
-
-    packet = packet + sizeof(struct ether_header);
-    if (ethernet_header.type == ETHERTYPE_IP){
-        ipv4_header = parse_ipv4(packet, true);
-        display_ipv4_header(ipv4_header, VB_MAXIMAL);
-        packet = packet + ipv4_header.header_length * 4;
-    } else if (ethernet_header.type == ETHERTYPE_ARP){
-        my_arp_header_t arp_header = parse_arp(packet, true);
-        display_arp_header(arp_header, VB_MAXIMAL);
-    } else if (ethernet_header.type == ETHERTYPE_IPV6){
-        ipv6_header = parse_ipv6(packet, true);
-        display_ipv6_header(ipv6_header, VB_MAXIMAL);
-        packet = packet + IPV6_HEADER_SIZE;
+    if (dissection_has(dissection, LAYER_ETHERNET)){
+        diplay_ethernet_header(dissection->ethernet, VB_MAXIMAL);
+    }
+
+    if (dissection_has(dissection, LAYER_IPV4)){
+        display_ipv4_header(dissection->ipv4, VB_MAXIMAL);
+    } else if (dissection_has(dissection, LAYER_ARP)){
+        display_arp_header(dissection->arp, VB_MAXIMAL);
+    } else if (dissection_has(dissection, LAYER_IPV6)){
+        display_ipv6_header(dissection->ipv6, VB_MAXIMAL);
     } else {
-        printf("\n");
-    }
-
-    my_tcp_header_t tcp_header = {0};
-    my_udp_header_t udp_header = {0};
-    printf("|   |\n");
-    if (!is_ipv4_header_empty(&ipv4_header)){
-        switch (ipv4_header.protocol){
-            case IPPROTO_TCP: {
-                printf("|   |   %s ----------------------\n", ipv4_header.protocol_name);
-                tcp_header = parse_tcp_header(packet, ipv4_header.raw_source_address, ipv4_header.raw_destination_address, ipv4_header.protocol, true);
-                printf("|   |   |   Source Port: %d (0x%x)\n", tcp_header.source_port, tcp_header.source_port);
-                printf("|   |   |   Destination Port: %d (0x%x)\n", tcp_header.destination_port, tcp_header.destination_port);
-                printf("|   |   |   Sequence Number: %u\n", tcp_header.sequence_number);
-                printf("|   |   |   Acknowledgment Number: %u\n", tcp_header.acknowledgment_number);
-                printf("|   |   |   Data Offset: %d\n", tcp_header.data_offset);
-                printf("|   |   |   Flags: %s (%d)\n", tcp_header.tcp_flags_desc, tcp_header.flags);
-                printf("|   |   |   Window: %d\n", tcp_header.window);
-                printf("|   |   |   Checksum: 0x%x %s\n", tcp_header.checksum, (tcp_header.checksum_correct) ? "(correct)" : "(incorrect)");
-                printf("|   |   |   Urgent Pointer: %d\n", tcp_header.urgent_pointer);
-                printf("|   |   |   Options: %s\n", tcp_header.tcp_options_desc);
-                packet += tcp_header.data_offset * 4;
-                break;
-            }
-            case IPPROTO_UDP: {
-                printf("|   |   %s ----------------------------\n", ipv4_header.protocol_name);
-                udp_header = parse_udp(packet, ipv4_header.raw_source_address, ipv4_header.raw_destination_address, ipv4_header.protocol, true);
-                printf("|   |   |   Source Port: %d (0x%x)\n", udp_header.source_port, udp_header.source_port);
-                printf("|   |   |   Destination Port: %d (0x%x)\n", udp_header.destination_port, udp_header.destination_port);
-                printf("|   |   |   Length: %d\n", udp_header.length);
-                printf("|   |   |   Checksum: 0x%x %s\n", udp_header.checksum, (udp_header.checksum_correct) ? "(correct)" : "(incorrect)");
-                packet += sizeof(struct udphdr);
-                break;
-            }
-            case IPPROTO_ICMP: {
-                printf("|   |   %s  ------------------\n", ipv4_header.protocol_name);
-                int packet_length = ipv4_header.total_length - ipv4_header.header_length;
-                my_icmp_t icmp_header = parse_icmp(packet, packet_length, true);
-                printf("|   |   |   Type: %s (%d)\n", icmp_header.icmp_type_desc, icmp_header.type);
-                printf("|   |   |   Code: %s (%d)\n", icmp_header.icmp_code_desc, icmp_header.code);
-                printf("|   |   |   Checksum: 0x%x %s\n", icmp_header.checksum, (icmp_header.checksum_valid) ? "(correct)" : "(incorrect)");
-                if (icmp_header.type == ICMP_ECHO || icmp_header.type == ICMP_ECHOREPLY){
-                    printf("|   |   |   Identifier: %d\n", icmp_header.identifier);
-                    printf("|   |   |   Sequence Number: %d\n", icmp_header.sequence_number);
-                    printf("|   |   |   Data: %s\n", (char*)&icmp_header.payload[33]);
-                }
-                if (icmp_header.type == ICMP_UNREACH){
-                    printf("|   |   |   Original IP Header: \n");
-                    printf("|   |   |   |   Version: %d\n", icmp_header.og_ip_header.version);
-                    printf("|   |   |   |   Header Length: %d\n", icmp_header.og_ip_header.header_length);
-                    printf("|   |   |   |   DSCP: %s (%d)\n", icmp_header.og_ip_header.dscp_desc, icmp_header.og_ip_header.dscp_value);
-                    printf("|   |   |   |   ECN: %s (%d)\n", icmp_header.og_ip_header.ecn_desc, icmp_header.og_ip_header.ecn_value);
-                    printf("|   |   |   |   Total Length: %d\n", icmp_header.og_ip_header.total_length);
-                    printf("|   |   |   |   Identification: %d\n", icmp_header.og_ip_header.identification);
-                    printf("|   |   |   |   Flags: %s \n", icmp_header.og_ip_header.flags_desc);
-                    printf("|   |   |   |   Fragment Offset: %d\n", icmp_header.og_ip_header.fragment_offset);
-                    printf("|   |   |   |   TTL: %d\n", icmp_header.og_ip_header.time_to_live);
-                    printf("|   |   |   |   Protocol: %d (%s)\n", icmp_header.og_ip_header.protocol, icmp_header.og_ip_header.protocol_name);
-                    printf("|   |   |   |   Checksum: 0x%x %s\n", icmp_header.og_ip_header.checksum, (icmp_header.og_ip_header.checksum_correct) ? "(correct)" : "(incorrect)");
-                    printf("|   |   |   |   Source IP: %s\n", icmp_header.og_ip_header.source_ipv4);
-                    printf("|   |   |   |   Destination IP: %s\n", icmp_header.og_ip_header.destination_ipv4);
-                }
-                break;
-            }
-            default:
-                break;
+        cli_puts("\n");
+    }
+
+    cli_puts("|   |\n");
+    if (dissection_has(dissection, LAYER_TCP)){
+        const my_tcp_header_t *tcp_header = &dissection->tcp;
+        cli_printf("|   |   %s ----------------------\n", dissection_has(dissection, LAYER_IPV4) ? dissection->ipv4.protocol_name : dissection->ipv6.next_header_name);
+        cli_printf("|   |   |   Source Port: %d (0x%x)\n", tcp_header->source_port, tcp_header->source_port);
+        cli_printf("|   |   |   Destination Port: %d (0x%x)\n", tcp_header->destination_port, tcp_header->destination_port);
+        cli_printf("|   |   |   Sequence Number: %u\n", tcp_header->sequence_number);
+        cli_printf("|   |   |   Acknowledgment Number: %u\n", tcp_header->acknowledgment_number);
+        cli_printf("|   |   |   Data Offset: %d\n", tcp_header->data_offset);
+        cli_printf("|   |   |   Flags: %s (%d)\n", tcp_header->tcp_flags_desc, tcp_header->flags);
+        cli_printf("|   |   |   Window: %d\n", tcp_header->window);
+        cli_printf("|   |   |   Checksum: 0x%x %s\n", tcp_header->checksum, (tcp_header->checksum_correct) ? "(correct)" : "(incorrect)");
+        cli_printf("|   |   |   Urgent Pointer: %d\n", tcp_header->urgent_pointer);
+        cli_printf("|   |   |   Options: %s\n", tcp_header->tcp_options_desc);
+    } else if (dissection_has(dissection, LAYER_UDP)){
+        const my_udp_header_t *udp_header = &dissection->udp;
+        cli_printf("|   |   %s ----------------------------\n", dissection_has(dissection, LAYER_IPV4) ? dissection->ipv4.protocol_name : dissection->ipv6.next_header_name);
+        cli_printf("|   |   |   Source Port: %d (0x%x)\n", udp_header->source_port, udp_header->source_port);
+        cli_printf("|   |   |   Destination Port: %d (0x%x)\n", udp_header->destination_port, udp_header->destination_port);
+        cli_printf("|   |   |   Length: %d\n", udp_header->length);
+        cli_printf("|   |   |   Checksum: 0x%x %s\n", udp_header->checksum, (udp_header->checksum_correct) ? "(correct)" : "(incorrect)");
+    } else if (dissection_has(dissection, LAYER_ICMP)){
+        const my_icmp_t *icmp_header = &dissection->icmp;
+        cli_printf("|   |   %s  ------------------\n", dissection->ipv4.protocol_name);
+        cli_printf("|   |   |   Type: %s (%d)\n", icmp_header->icmp_type_desc, icmp_header->type);
+        cli_printf("|   |   |   Code: %s (%d)\n", icmp_header->icmp_code_desc, icmp_header->code);
+        cli_printf("|   |   |   Checksum: 0x%x %s\n", icmp_header->checksum, (icmp_header->checksum_valid) ? "(correct)" : "(incorrect)");
+        if (icmp_header->type == ICMP_ECHO || icmp_header->type == ICMP_ECHOREPLY){
+            cli_printf("|   |   |   Identifier: %d\n", icmp_header->identifier);
+            cli_printf("|   |   |   Sequence Number: %d\n", icmp_header->sequence_number);
+            cli_printf("|   |   |   Data: %s\n", (char*)&icmp_header->payload[33]);
         }
-    } else
-    if(!is_ipv6_header_empty(&ipv6_header)){
-        switch(ipv6_header.next_header){
-            case IPPROTO_TCP: {
-                printf("|   |   %s ----------------------\n", ipv6_header.next_header_name);
-                tcp_header = parse_tcp_header(packet, ipv6_header.raw_source_address, ipv6_header.raw_destination_address, ipv6_header.next_header, true);
-                printf("|   |   |   Source Port: %d (0x%x)\n", tcp_header.source_port, tcp_header.source_port);
-                printf("|   |   |   Destination Port: %d (0x%x)\n", tcp_header.destination_port, tcp_header.destination_port);
-                printf("|   |   |   Sequence Number: %u\n", tcp_header.sequence_number);
-                printf("|   |   |   Acknowledgment Number: %u\n", tcp_header.acknowledgment_number);
-                printf("|   |   |   Data Offset: %d\n", tcp_header.data_offset);
-                printf("|   |   |   Flags: %s (%d)\n", tcp_header.tcp_flags_desc, tcp_header.flags);
-                printf("|   |   |   Window: %d\n", tcp_header.window);
-                printf("|   |   |   Checksum: 0x%x %s\n", tcp_header.checksum, (tcp_header.checksum_correct) ? "(correct)" : "(incorrect)");
-                printf("|   |   |   Urgent Pointer: %d\n", tcp_header.urgent_pointer);
-                printf("|   |   |   Options: %s\n", tcp_header.tcp_options_desc);
-                packet += tcp_header.data_offset * 4;
-                break;
-            }
-            case IPPROTO_UDP: {
-                printf("|   |   %s ----------------------------\n", ipv6_header.next_header_name);
-                udp_header = parse_udp(packet, ipv6_header.raw_source_address, ipv6_header.raw_destination_address, ipv6_header.next_header, true);
-                printf("|   |   |   Source Port: %d (0x%x)\n", udp_header.source_port, udp_header.source_port);
-                printf("|   |   |   Destination Port: %d (0x%x)\n", udp_header.destination_port, udp_header.destination_port);
-                printf("|   |   |   Length: %d\n", udp_header.length);
-                printf("|   |   |   Checksum: 0x%x %s\n", udp_header.checksum, (udp_header.checksum_correct) ? "(correct)" : "(incorrect)");
-                packet += sizeof(struct udphdr);
-                break;
-            }
-            case IPPROTO_ICMPV6: {
-                printf("|   |   %s ----------------\n", ipv6_header.next_header_name);
-                my_icmpv6_t icmpv6_header = parse_icmpv6(packet, ipv6_header.payload_length, ipv6_header.raw_source_address, ipv6_header.raw_destination_address, true);
-                printf("|   |   |   Type: %s (%d)\n", icmpv6_header.icmpv6_type_desc, icmpv6_header.type);
-                printf("|   |   |   Code: %s (%d)\n", icmpv6_header.icmpv6_code_desc, icmpv6_header.code);
-                printf("|   |   |   Checksum: 0x%x %s\n", icmpv6_header.checksum, (icmpv6_header.checksum_valid) ? "(correct)" : "(incorrect)");
-                if (icmpv6_header.type == ICMP_ECHO || icmpv6_header.type == ICMP_ECHOREPLY){
-                    printf("|   |   |   Identifier: %d\n", icmpv6_header.identifier);
-                    printf("|   |   |   Sequence Number: %d\n", icmpv6_header.sequence_number);
-                    printf("|   |   |   Data: %s\n", (char*)&icmpv6_header.payload[33]);
-                }
-                if (icmpv6_header.type == ICMP_UNREACH){
-                    printf("|   |   |   Original IP Header: \n");
-                    printf("|   |   |   |   Version: %d\n", icmpv6_header.og_ipv6_header.version);
-                    printf("|   |   |   |   Traffic Class: %d\n", icmpv6_header.og_ipv6_header.traffic_class);
-                    printf("|   |   |   |   Flow Label: %d\n", icmpv6_header.og_ipv6_header.flow_label);
-                    printf("|   |   |   |   Payload Length: %d\n", icmpv6_header.og_ipv6_header.payload_length);
-                    printf("|   |   |   |   Next Header: %d (%s)\n", icmpv6_header.og_ipv6_header.next_header, icmpv6_header.og_ipv6_header.next_header_name);
-                    printf("|   |   |   |   Hop Limit: %d\n", icmpv6_header.og_ipv6_header.hop_limit);
-                    printf("|   |   |   |   Source IP: %s\n", icmpv6_header.og_ipv6_header.source_address);
-                    printf("|   |   |   |   Destination IP: %s\n", icmpv6_header.og_ipv6_header.destination_address);
-                }
-                if (icmpv6_header.type == ND_NEIGHBOR_SOLICIT){
-                    printf("|   |   |   Target address: %s\n", icmpv6_header.payload);
-                }
-                free_parse_icmpv6(&icmpv6_header);
-                break;
-            }
-            default:
-                break;
+        if (icmp_header->type == ICMP_UNREACH){
+            cli_puts("|   |   |   Original IP Header: \n");
+            cli_printf("|   |   |   |   Version: %d\n", icmp_header->og_ip_header.version);
+            cli_printf("|   |   |   |   Header Length: %d\n", icmp_header->og_ip_header.header_length);
+            cli_printf("|   |   |   |   DSCP: %s (%d)\n", icmp_header->og_ip_header.dscp_desc, icmp_header->og_ip_header.dscp_value);
+            cli_printf("|   |   |   |   ECN: %s (%d)\n", icmp_header->og_ip_header.ecn_desc, icmp_header->og_ip_header.ecn_value);
+            cli_printf("|   |   |   |   Total Length: %d\n", icmp_header->og_ip_header.total_length);
+            cli_printf("|   |   |   |   Identification: %d\n", icmp_header->og_ip_header.identification);
+            cli_printf("|   |   |   |   Flags: %s \n", icmp_header->og_ip_header.flags_desc);
+            cli_printf("|   |   |   |   Fragment Offset: %d\n", icmp_header->og_ip_header.fragment_offset);
+            cli_printf("|   |   |   |   TTL: %d\n", icmp_header->og_ip_header.time_to_live);
+            cli_printf("|   |   |   |   Protocol: %d (%s)\n", icmp_header->og_ip_header.protocol, icmp_header->og_ip_header.protocol_name);
+            cli_printf("|   |   |   |   Checksum: 0x%x %s\n", icmp_header->og_ip_header.checksum, (icmp_header->og_ip_header.checksum_correct) ? "(correct)" : "(incorrect)");
+            cli_printf("|   |   |   |   Source IP: %s\n", icmp_header->og_ip_header.source_ipv4);
+            cli_printf("|   |   |   |   Destination IP: %s\n", icmp_header->og_ip_header.destination_ipv4);
+        }
+    } else if (dissection_has(dissection, LAYER_ICMPV6)){
+        const my_icmpv6_t *icmpv6_header = &dissection->icmpv6;
+        cli_printf("|   |   %s ----------------\n", dissection->ipv6.next_header_name);
+        cli_printf("|   |   |   Type: %s (%d)\n", icmpv6_header->icmpv6_type_desc, icmpv6_header->type);
+        cli_printf("|   |   |   Code: %s (%d)\n", icmpv6_header->icmpv6_code_desc, icmpv6_header->code);
+        cli_printf("|   |   |   Checksum: 0x%x %s\n", icmpv6_header->checksum, (icmpv6_header->checksum_valid) ? "(correct)" : "(incorrect)");
+        if (icmpv6_header->type == ICMP_ECHO || icmpv6_header->type == ICMP_ECHOREPLY){
+            cli_printf("|   |   |   Identifier: %d\n", icmpv6_header->identifier);
+            cli_printf("|   |   |   Sequence Number: %d\n", icmpv6_header->sequence_number);
+            cli_printf("|   |   |   Data: %s\n", (char*)&icmpv6_header->payload[33]);
+        }
+        if (icmpv6_header->type == ICMP_UNREACH){
+            cli_puts("|   |   |   Original IP Header: \n");
+            cli_printf("|   |   |   |   Version: %d\n", icmpv6_header->og_ipv6_header.version);
+            cli_printf("|   |   |   |   Traffic Class: %d\n", icmpv6_header->og_ipv6_header.traffic_class);
+            cli_printf("|   |   |   |   Flow Label: %d\n", icmpv6_header->og_ipv6_header.flow_label);
+            cli_printf("|   |   |   |   Payload Length: %d\n", icmpv6_header->og_ipv6_header.payload_length);
+            cli_printf("|   |   |   |   Next Header: %d (%s)\n", icmpv6_header->og_ipv6_header.next_header, icmpv6_header->og_ipv6_header.next_header_name);
+            cli_printf("|   |   |   |   Hop Limit: %d\n", icmpv6_header->og_ipv6_header.hop_limit);
+            cli_printf("|   |   |   |   Source IP: %s\n", icmpv6_header->og_ipv6_header.source_address);
+            cli_printf("|   |   |   |   Destination IP: %s\n", icmpv6_header->og_ipv6_header.destination_address);
+        }
+        if (icmpv6_header->type == ND_NEIGHBOR_SOLICIT){
+            cli_printf("|   |   |   Target address: %s\n", icmpv6_header->payload);
         }
     }
-    printf("|   |   |\n");
-    if (!is_tcp_header_empty(&tcp_header)){
-        switch(tcp_header.destination_port){
-            case PORT_DNS: {
-                my_dns_header_t dns_header = parse_dns(packet, true);
-                printf("|   |   |  DNS ---------------------------------------------------------\n");
-                printf("|   |   |   |   Transaction-ID: %d (0x%x)\n", dns_header.transaction_id, dns_header.transaction_id);
-                printf("|   |   |   |   Opcode: %s (%d)\n", dns_header.opcode_desc, dns_header.opcode);
-                if (dns_header.aa) printf("|   |   |   |   %s: %s\n", dns_header.aa_desc, (dns_header.aa) ? "yes" : "no");
-                if (dns_header.tc) printf("|   |   |   |   %s: %s\n", dns_header.tc_desc, (dns_header.tc) ? "yes" : "no");
-                if (dns_header.rd) printf("|   |   |   |   %s: %s\n", dns_header.rd_desc, (dns_header.rd) ? "yes" : "no");
-                if (dns_header.ra) printf("|   |   |   |   %s: %s\n", dns_header.ra_desc, (dns_header.ra) ? "yes" : "no");
-                printf("|   |   |   |   Error code: %s: %d\n", dns_header.rcode_desc, dns_header.rcode);
-                printf("|   |   |   |   Questions count: %d \n", dns_header.qdcount);
-                printf("|   |   |   |   Answers count: %d \n", dns_header.ancount);
-                printf("|   |   |   |   Authority count: %d \n", dns_header.nscount);
-                printf("|   |   |   |   Additional count: %d \n", dns_header.arcount);
-
-                node_t *tmp = dns_header.question_section;
-                int question_count = 0;
-                while (tmp != NULL){
-                    question_section_t *question = (question_section_t*)tmp->data;
-                    printf("|   |   |   |   Question (%d): \n", question_count);
-                    printf("|   |   |   |   |   Name: %s\n", question->qname);
-                    printf("|   |   |   |   |   Type: %s (%d)\n", question->qtype_desc, question->qtype);
-                    printf("|   |   |   |   |   Class: %s (%d)\n", question->qclass_desc, question->qclass);
-                    question_count++;
-                    tmp = tmp->next;
-                }
-
-                tmp = dns_header.answer_section;
-                int answer_count = 0;
-                while (tmp != NULL){
-                    resource_record_t *answer = (resource_record_t*)tmp->data;
-                    printf("|   |   |   |   Answer (%d): \n", answer_count);
-                    printf("|   |   |   |   |   Name: %s\n", answer->name);
-                    printf("|   |   |   |   |   Type: %s (%d)\n", answer->type_desc, answer->type);
-                    printf("|   |   |   |   |   Class: %s (%d)\n", answer->class_desc, answer->class);
-                    printf("|   |   |   |   |   TTL: %d\n", answer->ttl);
-                    printf("|   |   |   |   |   Data length: %d\n", answer->rdlength);
-                    printf("|   |   |   |   |   Data: %s\n", answer->rdata_desc);
-                    answer_count++;
-                    tmp = tmp->next;
-                }
-
-                tmp = dns_header.authority_section;
-                int authority_count = 0;
-                while (tmp != NULL){
-                    resource_record_t *authority = (resource_record_t*)tmp->data;
-                    printf("|   |   |   |   Authority (%d): \n", authority_count);
-                    printf("|   |   |   |   |   Name: %s\n", authority->name);
-                    printf("|   |   |   |   |   Type: %s (%d)\n", authority->type_desc, authority->type);
-                    printf("|   |   |   |   |   Class: %s (%d)\n", authority->class_desc, authority->class);
-                    printf("|   |   |   |   |   TTL: %d\n", authority->ttl);
-                    printf("|   |   |   |   |   Data length: %d\n", authority->rdlength);
-                    printf("|   |   |   |   |   Data: %s\n", authority->rdata_desc);
-                    authority_count++;
-                    tmp = tmp->next;
-                }
-
-                tmp = dns_header.additional_section;
-                int additional_count = 0;
-                while (tmp != NULL){
-                    resource_record_t *additional = (resource_record_t*)tmp->data;
-                    printf("|   |   |   |   Additional (%d): \n", additional_count);
-                    printf("|   |   |   |   |   Name: %s\n", additional->name);
-                    printf("|   |   |   |   |   Type: %s (%d)\n", additional->type_desc, additional->type);
-                    printf("|   |   |   |   |   Class: %s (%d)\n", additional->class_desc, additional->class);
-                    printf("|   |   |   |   |   TTL: %d\n", additional->ttl);
-                    printf("|   |   |   |   |   Data length: %d\n", additional->rdlength);
-                    printf("|   |   |   |   |   Data: %s\n", additional->rdata_desc);
-                    additional_count++;
-                    tmp = tmp->next;
-                }
-                free_dns_header(&dns_header);
-                break;
-            }
-            default:
-                break;
+
+    cli_puts("|   |   |\n");
+    if (dissection_has(dissection, LAYER_DNS)){
+        render_dns_max(&dissection->dns);
+        for (uint32_t i = 0; i < dissection->dns_more_count; i++){
+            render_dns_max(&dissection->dns_more[i]);
         }
-    } else
-    if (!is_udp_header_empty(&udp_header)){
-        switch(udp_header.destination_port){
-            case PORT_BOOTPC:
-            case PORT_BOOTPS: {
-                printf("|   |   |  BOOTP/DHCP --------------------------------------------------\n");
-                my_dhcp_bootp_header_t dhcp_header = parse_bootp(packet, true);
-                printf("|   |   |   |   Option: %s (%d) \n", dhcp_header.bp_op_desc, dhcp_header.bp_op);
-                printf("|   |   |   |   Hardware type: %s (%d) \n", dhcp_header.bp_htype_desc, dhcp_header.bp_htype);
-                printf("|   |   |   |   Hardware address length: %d \n", dhcp_header.bp_hlen);
-                printf("|   |   |   |   Transaction-ID: %d \n", dhcp_header.bp_xid);
-                printf("|   |   |   |   Seconds elapsed: %d \n", dhcp_header.bp_secs);
-                (dhcp_header.dhcp_flags_bp_unused & 0x8000) ? printf("|   |   |   |   Broadcast flag: set \n") : printf("|   |   |   |   Broadcast flag: not set \n");
-                
-                (dhcp_header.bp_op == BOOTREQUEST) ? printf("|   |   |   |   Client IP address: %s \n", dhcp_header.client_ip_address) : printf("|   |   |   |   Your IP address: %s \n", dhcp_header.your_ip_address);
-                (dhcp_header.bp_op == BOOTREPLY) ? printf("|   |   |   |   Server IP address: %s \n", dhcp_header.server_ip_address) : printf("|   |   |   |   Gateway IP address: %s \n", dhcp_header.gateway_ip_address);
-                printf("|   |   |   |   Client hardware address: %s \n", dhcp_header.client_hardware_address);
-                printf("|   |   |   |   Server host name: %s \n", dhcp_header.server_host_name);
-                printf("|   |   |   |   Boot file name: %s \n", dhcp_header.boot_file_name);
-
-                node_t *tmp = dhcp_header.dhcp_options;
-                while (tmp != NULL){
-                    my_dhcp_option_t *option = (my_dhcp_option_t*)tmp->data;
-                    printf("|   |   |   |   Option: %d (%s) \n", option->option_code, option->option_code_desc);
-                    printf("|   |   |   |   |   Length: %d \n", option->option_length);
-                    if (option->option_code == DHCP_MESSAGE_TYPE){
-                        printf("|   |   |   |   |   Message type: %s (%d) \n", option->option_value_desc, option->option_value);
-                    } else {
-                        printf("|   |   |   |   |   Description: %s \n", option->option_value_desc);
-                    }
-                    tmp = tmp->next;
-                }
-
-                free_dhcp_bootp_header(&dhcp_header);
-                break;
-            }
-            case PORT_DNS: {
-                my_dns_header_t dns_header = parse_dns(packet, true);
-                printf("|   |   |  DNS ---------------------------------------------------------\n");
-                printf("|   |   |   |   Transaction-ID: %d (0x%x)\n", dns_header.transaction_id, dns_header.transaction_id);
-                printf("|   |   |   |   Opcode: %s (%d)\n", dns_header.opcode_desc, dns_header.opcode);
-                if (dns_header.aa) printf("|   |   |   |   %s: %s\n", dns_header.aa_desc, (dns_header.aa) ? "yes" : "no");
-                if (dns_header.tc) printf("|   |   |   |   %s: %s\n", dns_header.tc_desc, (dns_header.tc) ? "yes" : "no");
-                if (dns_header.rd) printf("|   |   |   |   %s: %s\n", dns_header.rd_desc, (dns_header.rd) ? "yes" : "no");
-                if (dns_header.ra) printf("|   |   |   |   %s: %s\n", dns_header.ra_desc, (dns_header.ra) ? "yes" : "no");
-                printf("|   |   |   |   Error code: %s: %d\n", dns_header.rcode_desc, dns_header.rcode);
-                printf("|   |   |   |   Questions count: %d \n", dns_header.qdcount);
-                printf("|   |   |   |   Answers count: %d \n", dns_header.ancount);
-                printf("|   |   |   |   Authority count: %d \n", dns_header.nscount);
-                printf("|   |   |   |   Additional count: %d \n", dns_header.arcount);
-
-                node_t *tmp = dns_header.question_section;
-                int question_count = 0;
-                while (tmp != NULL){
-                    question_section_t *question = (question_section_t*)tmp->data;
-                    printf("|   |   |   |   Question (%d): \n", question_count);
-                    printf("|   |   |   |   |   Name: %s\n", question->qname);
-                    printf("|   |   |   |   |   Type: %s (%d)\n", question->qtype_desc, question->qtype);
-                    printf("|   |   |   |   |   Class: %s (%d)\n", question->qclass_desc, question->qclass);
-                    question_count++;
-                    tmp = tmp->next;
-                }
-
-                tmp = dns_header.answer_section;
-                int answer_count = 0;
-                while (tmp != NULL){
-                    resource_record_t *answer = (resource_record_t*)tmp->data;
-                    printf("|   |   |   |   Answer (%d): \n", answer_count);
-                    printf("|   |   |   |   |   Name: %s\n", answer->name);
-                    printf("|   |   |   |   |   Type: %s (%d)\n", answer->type_desc, answer->type);
-                    printf("|   |   |   |   |   Class: %s (%d)\n", answer->class_desc, answer->class);
-                    printf("|   |   |   |   |   TTL: %d\n", answer->ttl);
-                    printf("|   |   |   |   |   Data length: %d\n", answer->rdlength);
-                    printf("|   |   |   |   |   Data: %s\n", answer->rdata_desc);
-                    answer_count++;
-                    tmp = tmp->next;
-                }
-
-                tmp = dns_header.authority_section;
-                int authority_count = 0;
-                while (tmp != NULL){
-                    resource_record_t *authority = (resource_record_t*)tmp->data;
-                    printf("|   |   |   |   Authority (%d): \n", authority_count);
-                    printf("|   |   |   |   |   Name: %s\n", authority->name);
-                    printf("|   |   |   |   |   Type: %s (%d)\n", authority->type_desc, authority->type);
-                    printf("|   |   |   |   |   Class: %s (%d)\n", authority->class_desc, authority->class);
-                    printf("|   |   |   |   |   TTL: %d\n", authority->ttl);
-                    printf("|   |   |   |   |   Data length: %d\n", authority->rdlength);
-                    printf("|   |   |   |   |   Data: %s\n", authority->rdata_desc);
-                    authority_count++;
-                    tmp = tmp->next;
-                }
-
-                tmp = dns_header.additional_section;
-                int additional_count = 0;
-                while (tmp != NULL){
-                    resource_record_t *additional = (resource_record_t*)tmp->data;
-                    printf("|   |   |   |   Additional (%d): \n", additional_count);
-                    printf("|   |   |   |   |   Name: %s\n", additional->name);
-                    printf("|   |   |   |   |   Type: %s (%d)\n", additional->type_desc, additional->type);
-                    printf("|   |   |   |   |   Class: %s (%d)\n", additional->class_desc, additional->class);
-                    printf("|   |   |   |   |   TTL: %d\n", additional->ttl);
-                    printf("|   |   |   |   |   Data length: %d\n", additional->rdlength);
-                    printf("|   |   |   |   |   Data: %s\n", additional->rdata_desc);
-                    additional_count++;
-                    tmp = tmp->next;
-                }
-
-                free_dns_header(&dns_header);
-                break;
+    } else if (dissection_has(dissection, LAYER_DHCP)){
+        const my_dhcp_bootp_header_t *dhcp_header = &dissection->dhcp;
+        cli_puts("|   |   |  BOOTP/DHCP --------------------------------------------------\n");
+        cli_printf("|   |   |   |   Option: %s (%d) \n", dhcp_header->bp_op_desc, dhcp_header->bp_op);
+        cli_printf("|   |   |   |   Hardware type: %s (%d) \n", dhcp_header->bp_htype_desc, dhcp_header->bp_htype);
+        cli_printf("|   |   |   |   Hardware address length: %d \n", dhcp_header->bp_hlen);
+        cli_printf("|   |   |   |   Transaction-ID: %d \n", dhcp_header->bp_xid);
+        cli_printf("|   |   |   |   Seconds elapsed: %d \n", dhcp_header->bp_secs);
+        (dhcp_header->dhcp_flags_bp_unused & 0x8000) ? cli_puts("|   |   |   |   Broadcast flag: set \n") : cli_puts("|   |   |   |   Broadcast flag: not set \n");
+        
+        (dhcp_header->bp_op == BOOTREQUEST) ? cli_printf("|   |   |   |   Client IP address: %s \n", dhcp_header->client_ip_address) : cli_printf("|   |   |   |   Your IP address: %s \n", dhcp_header->your_ip_address);
+        (dhcp_header->bp_op == BOOTREPLY) ? cli_printf("|   |   |   |   Server IP address: %s \n", dhcp_header->server_ip_address) : cli_printf("|   |   |   |   Gateway IP address: %s \n", dhcp_header->gateway_ip_address);
+        cli_printf("|   |   |   |   Client hardware address: %s \n", dhcp_header->client_hardware_address);
+        cli_printf("|   |   |   |   Server host name: %s \n", dhcp_header->server_host_name);
+        cli_printf("|   |   |   |   Boot file name: %s \n", dhcp_header->boot_file_name);
+
+        for (uint32_t i = 0; i < dhcp_header->dhcp_options.count; i++){
+            my_dhcp_option_t *option = &dhcp_options_items(&dhcp_header->dhcp_options)[i];
+            cli_printf("|   |   |   |   Option: %d (%s) \n", option->option_code, option->option_code_desc);
+            cli_printf("|   |   |   |   |   Length: %d \n", option->option_length);
+            if (option->option_code == DHCP_MESSAGE_TYPE){
+                cli_printf("|   |   |   |   |   Message type: %s (%d) \n", option->option_value_desc, option->option_value);
+            } else {
+                cli_printf("|   |   |   |   |   Description: %s \n", option->option_value_desc);
             }
-            default:
-                break;
         }
-
     }
 }
 
@@ -828,25 +874,28 @@ parse_max(uint8_t *packet)
 void
 print_timestamp(const struct pcap_pkthdr *pcap_header, int verbosity)
 {   
-    char buffer[64];
-    struct tm *localtm;
-    time_t local_tv_sec;
-
-    local_tv_sec = pcap_header->ts.tv_sec;
-    localtm = localtime(&local_tv_sec);
+    // packets come many per second, localtime_r() only runs when the second changes
+    static _Thread_local time_t cached_second = -1;
+    static _Thread_local char cached_clock[16];
+
+    if (pcap_header->ts.tv_sec != cached_second){
+        struct tm localtm;
+        time_t local_tv_sec = pcap_header->ts.tv_sec;
+        // reentrant, workers print timestamps concurrently
+        localtime_r(&local_tv_sec, &localtm);
+        strftime(cached_clock, sizeof(cached_clock), "%H:%M:%S", &localtm);
+        cached_second = pcap_header->ts.tv_sec;
+    }
 
     switch(verbosity){
         case VB_MINIMAL:
-            strftime(buffer, sizeof(buffer), "%H:%M:%S", localtm);
-            printf("%s ", buffer);
+            cli_word(cached_clock);
             break;
         case VB_MIDDLE:
-            strftime(buffer, sizeof(buffer), "%H:%M:%S", localtm);
-            printf("Timestamp: %s\n", buffer);
-            break;
         case VB_MAXIMAL:
-            strftime(buffer, sizeof(buffer), "%H:%M:%S", localtm);
-            printf("Timestamp: %s\n", buffer);
+            cli_puts("Timestamp: ");
+            cli_puts(cached_clock);
+            cli_puts("\n");
             break;
         default:
             break;
@@ -15,6 +15,13 @@
 #include "dhcp_bootp.h"
 #include "dns.h"
 #include <time.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "output_sink.h"
+#include "arena.h"
+#include "packet_cursor.h"
+#include "dissector.h"
 
 #include <string.h>
 
@@ -24,10 +31,43 @@
 #define VB_MIDDLE 2
 #define VB_MAXIMAL 3
 
-void parse_cli(const struct pcap_pkthdr *pcap_header, uint8_t *packet, int verbosity);
-void parse_min(uint8_t *packet);
-void parse_mid(uint8_t *packet);
-void parse_max(uint8_t *packet);
+// output formats (--format)
+#define FORMAT_TEXT 0
+#define FORMAT_NDJSON 1
+#define FORMAT_COLUMNS 2 // --export-columns
+
+// the layers each renderer reads, the dissector decodes nothing else
+#define LAYERS_TEXT_MINIMAL (LAYERS_ALL & ~(LAYER_DNS_SECTIONS | LAYER_CHECKSUMS))
+#define LAYERS_TEXT_MIDDLE (LAYERS_ALL & ~LAYER_DNS_SECTIONS)
+#define LAYERS_TEXT_MAXIMAL LAYERS_ALL
+#define LAYERS_NDJSON LAYERS_ALL
+#define LAYERS_COLUMNS (LAYER_BIT(LAYER_ETHERNET) | LAYER_BIT(LAYER_IPV4) | LAYER_BIT(LAYER_IPV6) | LAYER_BIT(LAYER_TCP) \
+                        | LAYER_BIT(LAYER_UDP) | LAYER_BIT(LAYER_DNS) | LAYER_DNS_SECTIONS | LAYER_CHECKSUMS)
+
+extern _Thread_local output_sink_t *cli_sink;
+extern int cli_format;
+void cli_set_format(int format);
+int cli_data_fd();
+output_sink_t* cli_output();
+arena_t* cli_arena();
+void cli_arena_release();
+ipv4_reassembly_t* cli_reassembly();
+void cli_reassembly_release();
+tcp_reassembly_t* cli_tcp_reassembly();
+void cli_tcp_reassembly_release();
+void cli_flush();
+void cli_printf(const char *format, ...);
+void cli_puts(const char *string);
+void cli_uint(uint64_t value);
+void cli_word(const char *string);
+
+// the packet is only read, it can be in a read only mapping or shared by several threads
+void parse_cli(const struct pcap_pkthdr *pcap_header, const uint8_t *packet, int verbosity);
+void parse_cli_nth(const struct pcap_pkthdr *pcap_header, const uint8_t *packet, int verbosity, uint64_t packet_number);
+uint32_t cli_layers(int verbosity);
+void render_min(const dissection_t *dissection);
+void render_mid(const dissection_t *dissection);
+void render_max(const dissection_t *dissection);
 
 // helpers
 void print_timestamp(const struct pcap_pkthdr *pcap_header, int verbosity);
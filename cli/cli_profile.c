@@ -0,0 +1,82 @@
+#include <pthread.h>
+#include <stdio.h>
+#include "cli_profile.h"
+
+stage_profile_t *cli_profile = NULL;
+static pthread_mutex_t cli_profile_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Time the stages of every packet from now on, in every thread
+ *
+ */
+void
+cli_profile_open()
+{
+    cli_profile = stage_profile_create();
+    stage_timer_enable();
+}
+
+void
+cli_profile_close()
+{
+    if (cli_profile == NULL){
+        return;
+    }
+    stage_profile_destroy(cli_profile);
+    cli_profile = NULL;
+}
+
+/**
+ * @brief Merge the calling thread's histograms and free them, before the
+ * thread ends
+ *
+ */
+void
+cli_profile_release()
+{
+    stage_profile_t *local = stage_timer_take();
+    if (local == NULL){
+        return;
+    }
+    pthread_mutex_lock(&cli_profile_lock);
+    if (cli_profile != NULL){
+        stage_profile_merge(cli_profile, local);
+    }
+    pthread_mutex_unlock(&cli_profile_lock);
+    stage_profile_destroy(local);
+}
+
+/**
+ * @brief Print the time of every stage timed, once every thread released
+ * its histograms: the inner stages indented under the ones they are in,
+ * their share of the handler (of the decoding with -j)
+ *
+ */
+void
+cli_profile_summary()
+{
+    if (cli_profile == NULL){
+        return;
+    }
+    double tick_ns = stage_timer_tick_ns();
+    stage_t whole = cli_profile->stages[STAGE_HANDLER].count > 0 ? STAGE_HANDLER : STAGE_PARSE;
+    double whole_ticks = (double)cli_profile->stages[whole].sum;
+    printf("-----------------------------------\n");
+    printf("Time per stage (%.3f ns per tick, %% of the %s):\n", tick_ns, stage_names[whole]);
+    printf("%-18s %12s %12s %7s %10s %10s %10s %10s\n", "stage", "calls", "total ms", "%", "mean ns",
+        "p50 ns", "p99 ns", "max ns");
+    for (uint32_t i = 0; i < STAGE_KINDS; i++){
+        const histogram_t *stage = &cli_profile->stages[i];
+        if (stage->count == 0){
+            continue;
+        }
+        char label[32];
+        snprintf(label, sizeof(label), "%*s%s", 2 * stage_depths[i], "", stage_names[i]);
+        printf("%-18s %12llu %12.3f %7.1f %10.0f %10.0f %10.0f %10.0f\n", label, (unsigned long long)stage->count,
+            stage->sum * tick_ns / 1e6, whole_ticks > 0 ? 100.0 * stage->sum / whole_ticks : 0.0,
+            histogram_mean(stage) * tick_ns, histogram_percentile(stage, 50) * tick_ns,
+            histogram_percentile(stage, 99) * tick_ns, stage->max * tick_ns);
+    }
+    printf("Each timer adds about %.0f ns to its stage and the ones around it.\n",
+        stage_timer_overhead() * tick_ns);
+}
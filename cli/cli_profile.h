@@ -0,0 +1,22 @@
+#ifndef CLI_PROFILE_H
+#define CLI_PROFILE_H
+
+#include "stage_timer.h"
+
+/*
+--profile: where the time of the packets goes, stage by stage, from the
+timers of stage_timer.h around the handler, the parsers, the renderers
+and the output. Each thread records into its own histograms and merges
+them when it ends; the breakdown is printed when the capture stops, in
+nanoseconds from the cycle counter.
+*/
+
+// the profiles the threads merged, NULL without --profile
+extern stage_profile_t *cli_profile;
+
+void cli_profile_open();
+void cli_profile_close();
+void cli_profile_release();
+void cli_profile_summary();
+
+#endif
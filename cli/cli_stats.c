@@ -0,0 +1,228 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "cli_stats.h"
+#include "json_writer.h"
+
+// the buckets the threads merged, NULL without --stats
+traffic_stats_t *cli_stats = NULL;
+static char cli_stats_path[256];
+static int cli_stats_fd = -1;
+static output_sink_t cli_stats_sink;
+static bool cli_stats_ndjson = false;
+static uint64_t cli_stats_interval = 0;     // microseconds
+static uint64_t cli_stats_rows = 0;
+static pthread_mutex_t cli_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// the calling thread's ring, its buckets merged into cli_stats
+static _Thread_local traffic_stats_t *cli_stats_local = NULL;
+static _Thread_local uint64_t cli_stats_next_export = 0;
+
+// the column of a counter: packets, ipv4_packets, ...
+static const char*
+counter_key(uint32_t counter, const char *unit, char *buffer, size_t size)
+{
+    if (traffic_counter_names[counter] == NULL){
+        return unit;
+    }
+    snprintf(buffer, size, "%s_%s", traffic_counter_names[counter], unit);
+    return buffer;
+}
+
+static void
+write_csv_header(output_sink_t *sink)
+{
+    char key[64];
+    output_sink_puts(sink, "start");
+    for (uint32_t i = 0; i < TRAFFIC_COUNTERS; i++){
+        output_sink_putc(sink, ',');
+        output_sink_puts(sink, counter_key(i, "packets", key, sizeof(key)));
+        output_sink_putc(sink, ',');
+        output_sink_puts(sink, counter_key(i, "bytes", key, sizeof(key)));
+    }
+    output_sink_putc(sink, '\n');
+}
+
+// seconds.microseconds, the start of the bucket
+static void
+write_csv_row(output_sink_t *sink, const traffic_bucket_t *bucket)
+{
+    output_sink_printf(sink, "%llu.%06u", (unsigned long long)(bucket->start / 1000000),
+        (unsigned)(bucket->start % 1000000));
+    for (uint32_t i = 0; i < TRAFFIC_COUNTERS; i++){
+        output_sink_putc(sink, ',');
+        output_sink_uint(sink, bucket->packets[i]);
+        output_sink_putc(sink, ',');
+        output_sink_uint(sink, bucket->bytes[i]);
+    }
+    output_sink_putc(sink, '\n');
+}
+
+static void
+write_ndjson_row(output_sink_t *sink, const traffic_bucket_t *bucket)
+{
+    char key[64];
+    json_writer_t json;
+    json_init(&json, sink);
+    json_begin_object(&json);
+    json_key(&json, "start");
+    json_time(&json, bucket->start / 1000000, bucket->start % 1000000);
+    for (uint32_t i = 0; i < TRAFFIC_COUNTERS; i++){
+        json_field_uint(&json, counter_key(i, "packets", key, sizeof(key)), bucket->packets[i]);
+        json_field_uint(&json, counter_key(i, "bytes", key, sizeof(key)), bucket->bytes[i]);
+    }
+    json_end_object(&json);
+    output_sink_putc(sink, '\n');
+}
+
+// a bucket of the shared ring, to the file (under the lock)
+static void
+write_bucket(void *context, const traffic_bucket_t *bucket)
+{
+    (void)context;
+    if (cli_stats_ndjson){
+        write_ndjson_row(&cli_stats_sink, bucket);
+    } else {
+        write_csv_row(&cli_stats_sink, bucket);
+    }
+    cli_stats_rows++;
+}
+
+// a bucket of a thread's ring, to the shared one
+static void
+merge_bucket(void *context, const traffic_bucket_t *bucket)
+{
+    (void)context;
+    pthread_mutex_lock(&cli_stats_lock);
+    if (cli_stats != NULL){
+        traffic_stats_merge(cli_stats, bucket);
+    }
+    pthread_mutex_unlock(&cli_stats_lock);
+}
+
+static bool
+has_suffix(const char *string, const char *suffix)
+{
+    size_t length = strlen(string);
+    size_t suffix_length = strlen(suffix);
+    return length >= suffix_length && strcmp(string + length - suffix_length, suffix) == 0;
+}
+
+/**
+ * @brief Create the file, count the packets from now on
+ *
+ * @param path CSV, or NDJSON if it ends with .ndjson or .json
+ * @param bucket_ms length of a bucket, CLI_STATS_BUCKET if 0
+ * @param interval seconds between the writes, CLI_STATS_INTERVAL if 0
+ */
+void
+cli_stats_open(const char *path, int bucket_ms, int interval)
+{
+    cli_stats_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (cli_stats_fd == -1){
+        fprintf(stderr, "Can't create '%s': %s.\n", path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    snprintf(cli_stats_path, sizeof(cli_stats_path), "%s", path);
+    cli_stats_ndjson = has_suffix(path, ".ndjson") || has_suffix(path, ".json");
+    output_sink_init(&cli_stats_sink, cli_stats_fd, 0);
+    if (!cli_stats_ndjson){
+        write_csv_header(&cli_stats_sink);
+    }
+
+    uint64_t length = (uint64_t)(bucket_ms > 0 ? bucket_ms : CLI_STATS_BUCKET) * 1000;
+    cli_stats_interval = (uint64_t)(interval > 0 ? interval : CLI_STATS_INTERVAL) * 1000000;
+    // the buckets of an interval behind the newest and of the one being written
+    uint64_t buckets = 2 * (cli_stats_interval / length) + TRAFFIC_CAPACITY;
+    cli_stats = traffic_stats_create(length, (uint32_t)buckets, write_bucket, NULL);
+}
+
+void
+cli_stats_close()
+{
+    cli_stats_release();
+    if (cli_stats == NULL){
+        return;
+    }
+    traffic_stats_destroy(cli_stats);
+    cli_stats = NULL;
+    output_sink_destroy(&cli_stats_sink);
+    close(cli_stats_fd);
+    cli_stats_fd = -1;
+}
+
+/**
+ * @brief Count a decoded packet in the calling thread's ring, merge its
+ * buckets and write the shared ones when the interval is over
+ *
+ * @param header
+ * @param dissection of the packet, its timestamp and keys set
+ */
+void
+cli_stats_update(const struct pcap_pkthdr *header, const dissection_t *dissection)
+{
+    uint64_t timestamp = dissection->timestamp;
+    if (cli_stats_local == NULL){
+        cli_stats_local = traffic_stats_create(cli_stats->length, 0, merge_bucket, NULL);
+        cli_stats_next_export = timestamp + cli_stats_interval;
+    }
+    traffic_stats_add(cli_stats_local, timestamp, header->len, dissection);
+    if (timestamp < cli_stats_next_export){
+        return;
+    }
+    // the buckets before this packet's, then the shared ones an interval behind
+    traffic_stats_emit(cli_stats_local, timestamp);
+    pthread_mutex_lock(&cli_stats_lock);
+    if (cli_stats->newest > cli_stats_interval){
+        traffic_stats_emit(cli_stats, cli_stats->newest - cli_stats_interval);
+    }
+    output_sink_flush(&cli_stats_sink);
+    pthread_mutex_unlock(&cli_stats_lock);
+    // the next one on the same grid, past a gap of the capture
+    cli_stats_next_export = timestamp - (timestamp - cli_stats_next_export) % cli_stats_interval + cli_stats_interval;
+}
+
+/**
+ * @brief Merge the calling thread's buckets and free its ring, before
+ * the thread ends
+ *
+ */
+void
+cli_stats_release()
+{
+    if (cli_stats_local == NULL){
+        return;
+    }
+    traffic_stats_finish(cli_stats_local);
+    pthread_mutex_lock(&cli_stats_lock);
+    if (cli_stats != NULL){
+        cli_stats->late += cli_stats_local->late;
+    }
+    pthread_mutex_unlock(&cli_stats_lock);
+    traffic_stats_destroy(cli_stats_local);
+    cli_stats_local = NULL;
+}
+
+/**
+ * @brief Write the buckets left, once every thread released its ring
+ */
+void
+cli_stats_summary()
+{
+    if (cli_stats == NULL){
+        return;
+    }
+    traffic_stats_finish(cli_stats);
+    output_sink_flush(&cli_stats_sink);
+    printf("-----------------------------------\n");
+    printf("Traffic statistics: %llu rows of %llu ms written to '%s'.\n", (unsigned long long)cli_stats_rows,
+        (unsigned long long)(cli_stats->length / 1000), cli_stats_path);
+    if (cli_stats->late > 0){
+        printf("%llu packets came after their row was written, not in it.\n", (unsigned long long)cli_stats->late);
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef CLI_STATS_H
+#define CLI_STATS_H
+
+#include <pcap.h>
+#include <stdint.h>
+#include "dissector.h"
+#include "traffic_stats.h"
+
+/*
+--stats <file>: packets and bytes per ethertype, IP protocol and port
+class, per --stats-bucket ms of capture time, from the buckets of
+traffic_stats.h; a row per bucket with packets, written every
+--stats-interval s of capture time, as CSV or, for a file named .ndjson
+or .json, one JSON object per line.
+
+Each decoding thread counts its packets in its own ring and merges the
+buckets it is done with into the shared one, under a lock, at every
+interval and when it ends. The shared ring writes its buckets one
+interval behind the newest, for the threads behind the others.
+*/
+
+#define CLI_STATS_BUCKET 1000       // milliseconds
+#define CLI_STATS_INTERVAL 10       // seconds
+#define CLI_STATS_MAX_BUCKETS 100000    // buckets an interval
+
+// the keys the counters read, whatever the output
+#define CLI_STATS_LAYERS LAYER_KEYS
+
+extern traffic_stats_t *cli_stats;
+
+void cli_stats_open(const char *path, int bucket_ms, int interval);
+void cli_stats_close();
+void cli_stats_update(const struct pcap_pkthdr *header, const dissection_t *dissection);
+void cli_stats_release();
+void cli_stats_summary();
+
+#endif
@@ -0,0 +1,179 @@
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cli_top.h"
+#include "cli_parser.h"
+#include "addr_format.h"
+
+// the counts of the threads that ended, NULL without --top
+top_talkers_t *cli_top = NULL;
+static uint32_t cli_top_count = 0;
+static size_t cli_top_memory = 0;
+static uint64_t cli_top_interval = 0;      // microseconds, 0 to report at the end only
+static pthread_mutex_t cli_top_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// the calling thread's counts, merged into cli_top when it ends
+static _Thread_local top_talkers_t *cli_top_local = NULL;
+static _Thread_local uint64_t cli_top_start = 0;
+static _Thread_local uint64_t cli_top_next_report = 0;
+
+static const char *top_kind_names[TOP_KINDS] = {
+    "source", "destination", "source port", "destination port", "DNS name asked",
+};
+
+/**
+ * @brief Count the heaviest talkers from now on
+ *
+ * @param count how many of each kind are printed
+ * @param memory_kb of sketches per thread, TOP_TALKERS_MEMORY when 0
+ * @param interval seconds between the reports, 0 for one at the end
+ */
+void
+cli_top_open(int count, int memory_kb, int interval)
+{
+    cli_top_count = count;
+    cli_top_memory = (size_t)memory_kb * 1024;
+    cli_top_interval = (uint64_t)interval * 1000000;
+    cli_top = top_talkers_create(cli_top_memory);
+}
+
+void
+cli_top_close()
+{
+    cli_top_release();
+    if (cli_top == NULL){
+        return;
+    }
+    top_talkers_destroy(cli_top);
+    cli_top = NULL;
+}
+
+// a key as text: an address, protocol/port or a name
+static void
+format_key(top_kind_t kind, const void *key, char *buffer, size_t size)
+{
+    if (kind == TOP_SOURCES || kind == TOP_DESTINATIONS){
+        const top_address_key_t *address = (const top_address_key_t*)key;
+        if (address->version == 4){
+            format_ipv4_address(address->address, buffer);
+        } else {
+            format_ipv6_address(address->address, buffer);
+        }
+    } else if (kind == TOP_SOURCE_PORTS || kind == TOP_DESTINATION_PORTS){
+        const top_port_key_t *port = (const top_port_key_t*)key;
+        snprintf(buffer, size, "%s/%u", port->protocol == IPPROTO_TCP ? "tcp" : "udp", port->port);
+    } else {
+        // zero-padded, the last byte always 0
+        const char *name = (const char*)key;
+        snprintf(buffer, size, "%s", name[0] != '\0' ? name : ".");
+    }
+}
+
+/**
+ * @brief Print the heaviest keys of each kind: their count, the part of
+ * it they're sure to have (count - error) and the sketch's estimate
+ *
+ * @param top
+ */
+static void
+print_top(const top_talkers_t *top)
+{
+    uint32_t *entries = (uint32_t*)malloc(cli_top_count * sizeof(uint32_t));
+    if (entries == NULL){
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t kind = 0; kind < TOP_KINDS; kind++){
+        const space_saving_t *summary = top->summaries[kind];
+        uint32_t found = space_saving_top(summary, cli_top_count, entries);
+        if (found == 0){
+            continue;
+        }
+        const char *unit = (kind == TOP_QNAMES) ? "queries" : "bytes";
+        printf("Top %u by %s (%s):\n", found, top_kind_names[kind], unit);
+        printf("%-40s %14s %8s %14s %14s\n", top_kind_names[kind], unit, "%", "at least", "estimate");
+        for (uint32_t i = 0; i < found; i++){
+            const space_saving_entry_t *counter = &summary->entries[entries[i]];
+            const void *key = space_saving_key(summary, entries[i]);
+            char text[TOP_QNAME_SIZE + 8];
+            format_key((top_kind_t)kind, key, text, sizeof(text));
+            printf("%-40s %14llu %8.2f %14llu %14llu\n", text, (unsigned long long)counter->count,
+                summary->total ? counter->count * 100.0 / summary->total : 0.0,
+                (unsigned long long)(counter->count - counter->error),
+                (unsigned long long)top_talkers_estimate(top, (top_kind_t)kind, key));
+        }
+    }
+    free(entries);
+}
+
+/**
+ * @brief Count a decoded packet in the calling thread's sketches, print
+ * them when the interval is over
+ *
+ * @param header
+ * @param dissection of the packet, its timestamp set
+ */
+void
+cli_top_update(const struct pcap_pkthdr *header, const dissection_t *dissection)
+{
+    if (cli_top_local == NULL){
+        cli_top_local = top_talkers_create(cli_top_memory);
+        cli_top_start = dissection->timestamp;
+        cli_top_next_report = dissection->timestamp + cli_top_interval;
+    }
+    top_talkers_add(cli_top_local, dissection, header->len);
+
+    uint64_t timestamp = dissection->timestamp;
+    if (cli_top_interval == 0 || timestamp < cli_top_next_report){
+        return;
+    }
+    // after the packets rendered so far
+    cli_flush();
+    printf("-----------------------------------\n");
+    printf("Top talkers after %llu s: %llu packets, %llu bytes.\n",
+        (unsigned long long)((timestamp - cli_top_start) / 1000000),
+        (unsigned long long)cli_top_local->packets, (unsigned long long)cli_top_local->bytes);
+    print_top(cli_top_local);
+    printf("-----------------------------------\n");
+    // the next one on the same grid, past a gap of the capture
+    cli_top_next_report = timestamp - (timestamp - cli_top_next_report) % cli_top_interval + cli_top_interval;
+}
+
+/**
+ * @brief Add the calling thread's counts to the report and free them,
+ * before the thread ends
+ *
+ */
+void
+cli_top_release()
+{
+    if (cli_top_local == NULL){
+        return;
+    }
+    pthread_mutex_lock(&cli_top_lock);
+    if (cli_top != NULL){
+        // created with the same memory, they always merge
+        top_talkers_merge(cli_top, cli_top_local);
+    }
+    pthread_mutex_unlock(&cli_top_lock);
+    top_talkers_destroy(cli_top_local);
+    cli_top_local = NULL;
+}
+
+/**
+ * @brief Print the heaviest talkers of the whole capture
+ */
+void
+cli_top_summary()
+{
+    if (cli_top == NULL){
+        return;
+    }
+    printf("-----------------------------------\n");
+    printf("Top talkers: %llu packets, %llu bytes, %zu KB of sketches per thread.\n",
+        (unsigned long long)cli_top->packets, (unsigned long long)cli_top->bytes,
+        (cli_top_memory ? cli_top_memory : TOP_TALKERS_MEMORY) / 1024);
+    print_top(cli_top);
+}
@@ -0,0 +1,32 @@
+#ifndef CLI_TOP_H
+#define CLI_TOP_H
+
+#include <pcap.h>
+#include <stdint.h>
+#include "dissector.h"
+#include "top_talkers.h"
+
+/*
+--top N: the N heaviest source and destination addresses and ports (bytes
+on the wire) and DNS names asked (queries), from the sketches of
+top_talkers.h: fixed memory, --top-memory KB per decoding thread, however
+many hosts the capture has. Each decoding thread counts the packets it
+decodes, from their dissection; its counts are added to the report when
+it ends. The report is printed when the capture stops, and with a single
+thread every --top-interval seconds of capture time, counted since the
+start.
+*/
+
+// the layers the counts read, decoded whatever the output
+#define CLI_TOP_LAYERS (LAYER_BIT(LAYER_IPV4) | LAYER_BIT(LAYER_IPV6) | LAYER_BIT(LAYER_TCP) | LAYER_BIT(LAYER_UDP) \
+                        | LAYER_BIT(LAYER_DNS) | LAYER_DNS_SECTIONS)
+
+extern top_talkers_t *cli_top;
+
+void cli_top_open(int count, int memory_kb, int interval);
+void cli_top_close();
+void cli_top_update(const struct pcap_pkthdr *header, const dissection_t *dissection);
+void cli_top_release();
+void cli_top_summary();
+
+#endif
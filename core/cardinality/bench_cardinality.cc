@@ -0,0 +1,92 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unordered_set>
+#include "cardinality.h"
+#include "dissector.h"
+
+/*
+Packets per second through cardinality_add, against an exact
+unordered_set of the sources, for a few numbers of distinct sources, and
+the time to merge an interval into the series (per thread per interval).
+
+usage: bench_cardinality [packets]
+*/
+
+double
+now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t state = 88172645463325252ull;
+
+uint64_t
+next_random()
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+int
+main(int argc, char **argv)
+{
+    uint32_t packets = (argc > 1) ? atol(argv[1]) : 4000000;
+    const uint32_t distinct_counts[] = {1000, 100000, 10000000};
+
+    uint32_t *sources = (uint32_t*)malloc((size_t)packets * sizeof(uint32_t));
+    printf("%-10s %12s %12s %12s %12s %10s %10s\n", "sources", "Mpackets/s", "ns/packet", "exact ns", "estimate", "error %",
+        "merge us");
+    for (uint32_t distinct : distinct_counts){
+        for (uint32_t i = 0; i < packets; i++){
+            sources[i] = next_random() % distinct * 2654435761u;
+        }
+
+        cardinality_interval_t interval;
+        cardinality_interval_init(&interval, 0);
+        dissection_t dissection = {};
+        dissection.layers = LAYER_BIT(LAYER_IPV4) | LAYER_BIT(LAYER_UDP);
+        dissection.ipv4.protocol = 17;
+        double start = now_seconds();
+        for (uint32_t i = 0; i < packets; i++){
+            memcpy(dissection.ipv4.raw_source_address, &sources[i], 4);
+            memcpy(dissection.ipv4.raw_destination_address, &sources[(i * 7) % packets], 4);
+            dissection.udp.source_port = 1024 + (sources[i] & 0x7fff);
+            dissection.udp.destination_port = (i % 3 == 0) ? 53 : 443;
+            cardinality_add(&interval, &dissection);
+        }
+        double elapsed = now_seconds() - start;
+
+        std::unordered_set<uint32_t> exact;
+        start = now_seconds();
+        for (uint32_t i = 0; i < packets; i++){
+            exact.insert(sources[i]);
+        }
+        double exact_elapsed = now_seconds() - start;
+
+        double estimate = hyperloglog_estimate(&interval.sketches[CARDINALITY_SOURCES]);
+        double error = (estimate - exact.size()) / exact.size() * 100;
+
+        // the same interval merged into the open ones, over and over
+        cardinality_series_t *series = cardinality_series_create(0, 0);
+        const uint32_t merges = 1000;
+        start = now_seconds();
+        for (uint32_t i = 0; i < merges; i++){
+            cardinality_series_merge(series, &interval);
+        }
+        double merge_elapsed = now_seconds() - start;
+
+        printf("%-10u %12.2f %12.1f %12.1f %12.0f %10.2f %10.1f\n", distinct, packets / elapsed / 1e6,
+            elapsed / packets * 1e9, exact_elapsed / packets * 1e9, estimate, error, merge_elapsed / merges * 1e6);
+        cardinality_series_destroy(series);
+        cardinality_interval_destroy(&interval);
+    }
+    free(sources);
+    return 0;
+}
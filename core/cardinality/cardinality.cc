@@ -0,0 +1,289 @@
+#include "cardinality.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dissector.h"
+#include "key_hash.h"
+
+/**
+ * @brief Allocate the sketches of an interval, unused
+ *
+ * @param interval
+ * @param precision of the sketches, HYPERLOGLOG_PRECISION if 0
+ */
+void
+cardinality_interval_init(cardinality_interval_t *interval, uint8_t precision)
+{
+    interval->start = 0;
+    interval->packets = 0;
+    for (uint32_t kind = 0; kind < CARDINALITY_KINDS; kind++){
+        hyperloglog_init(&interval->sketches[kind], precision);
+    }
+}
+
+void
+cardinality_interval_destroy(cardinality_interval_t *interval)
+{
+    for (uint32_t kind = 0; kind < CARDINALITY_KINDS; kind++){
+        hyperloglog_destroy(&interval->sketches[kind]);
+    }
+}
+
+/**
+ * @brief Empty an interval, to count another one
+ *
+ * @param interval
+ * @param start of the next one
+ */
+void
+cardinality_interval_reset(cardinality_interval_t *interval, uint64_t start)
+{
+    interval->start = start;
+    interval->packets = 0;
+    for (uint32_t kind = 0; kind < CARDINALITY_KINDS; kind++){
+        hyperloglog_reset(&interval->sketches[kind]);
+    }
+}
+
+static inline void
+cardinality_add_key(cardinality_interval_t *interval, cardinality_kind_t kind, const void *key, size_t size)
+{
+    hyperloglog_add(&interval->sketches[kind], key_hash(key, size));
+}
+
+// the names asked by a query, lowercase
+static void
+cardinality_add_qnames(cardinality_interval_t *interval, const my_dns_header_t *dns)
+{
+    if (dns->qr){
+        return;
+    }
+    const question_section_t *questions = dns_questions_items(&dns->question_section);
+    for (uint32_t i = 0; i < dns->question_section.count; i++){
+        char name[CARDINALITY_NAME_SIZE];
+        size_t length = 0;
+        for (const char *c = questions[i].qname; *c != '\0' && length < sizeof(name); c++){
+            name[length++] = (*c >= 'A' && *c <= 'Z') ? *c + ('a' - 'A') : *c;
+        }
+        cardinality_add_key(interval, CARDINALITY_QNAMES, name, length);
+    }
+}
+
+/**
+ * @brief Count the addresses, the flow and the names asked of a packet
+ *
+ * @param interval
+ * @param dissection of the packet
+ */
+void
+cardinality_add(cardinality_interval_t *interval, const struct dissection *dissection)
+{
+    interval->packets++;
+
+    cardinality_flow_key_t flow;
+    memset(&flow, 0, sizeof(flow));
+    uint8_t address_size;
+    if (dissection_has(dissection, LAYER_IPV4)){
+        flow.version = 4;
+        flow.protocol = dissection->ipv4.protocol;
+        address_size = 4;
+        memcpy(flow.addresses[0], dissection->ipv4.raw_source_address, 4);
+        memcpy(flow.addresses[1], dissection->ipv4.raw_destination_address, 4);
+    } else if (dissection_has(dissection, LAYER_IPV6)){
+        flow.version = 6;
+        flow.protocol = dissection->ipv6.next_header;
+        address_size = 16;
+        memcpy(flow.addresses[0], dissection->ipv6.raw_source_address, 16);
+        memcpy(flow.addresses[1], dissection->ipv6.raw_destination_address, 16);
+    } else {
+        return;
+    }
+    // an address is its version and its bytes, the start of the flow key
+    uint8_t address[17];
+    address[0] = flow.version;
+    memcpy(address + 1, flow.addresses[0], address_size);
+    cardinality_add_key(interval, CARDINALITY_SOURCES, address, address_size + 1);
+    memcpy(address + 1, flow.addresses[1], address_size);
+    cardinality_add_key(interval, CARDINALITY_DESTINATIONS, address, address_size + 1);
+
+    // the fragments after the first have no ports, their datagram counts once reassembled
+    if (!dissection->ipv4_fragment || dissection->ipv4_reassembled){
+        if (dissection_has(dissection, LAYER_TCP)){
+            flow.ports[0] = dissection->tcp.source_port;
+            flow.ports[1] = dissection->tcp.destination_port;
+        } else if (dissection_has(dissection, LAYER_UDP)){
+            flow.ports[0] = dissection->udp.source_port;
+            flow.ports[1] = dissection->udp.destination_port;
+        }
+        int order = memcmp(flow.addresses[0], flow.addresses[1], address_size);
+        if (order > 0 || (order == 0 && flow.ports[0] > flow.ports[1])){
+            uint8_t swap[16];
+            memcpy(swap, flow.addresses[0], address_size);
+            memcpy(flow.addresses[0], flow.addresses[1], address_size);
+            memcpy(flow.addresses[1], swap, address_size);
+            uint16_t port = flow.ports[0];
+            flow.ports[0] = flow.ports[1];
+            flow.ports[1] = port;
+        }
+        cardinality_add_key(interval, CARDINALITY_FLOWS, &flow, sizeof(flow));
+    }
+
+    if (!dissection_has(dissection, LAYER_DNS)){
+        return;
+    }
+    cardinality_add_qnames(interval, &dissection->dns);
+    for (uint32_t i = 0; i < dissection->dns_more_count; i++){
+        cardinality_add_qnames(interval, &dissection->dns_more[i]);
+    }
+}
+
+/**
+ * @brief Allocate the open intervals and the whole capture's sketches
+ *
+ * @param length of an interval in microseconds, CARDINALITY_INTERVAL if 0
+ * @param precision of the sketches, HYPERLOGLOG_PRECISION if 0
+ * @return cardinality_series_t*
+ */
+cardinality_series_t*
+cardinality_series_create(uint64_t length, uint8_t precision)
+{
+    cardinality_series_t *series = (cardinality_series_t*)calloc(1, sizeof(cardinality_series_t));
+    if (series == NULL){
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    series->length = length > 0 ? length : CARDINALITY_INTERVAL;
+    for (uint32_t i = 0; i < CARDINALITY_OPEN; i++){
+        cardinality_interval_init(&series->open[i], precision);
+    }
+    cardinality_interval_init(&series->total, precision);
+    hyperloglog_init(&series->hosts, precision);
+    series->precision = series->hosts.precision;
+    return series;
+}
+
+void
+cardinality_series_destroy(cardinality_series_t *series)
+{
+    for (uint32_t i = 0; i < CARDINALITY_OPEN; i++){
+        cardinality_interval_destroy(&series->open[i]);
+    }
+    cardinality_interval_destroy(&series->total);
+    hyperloglog_destroy(&series->hosts);
+    free(series->rows);
+    free(series);
+}
+
+// the estimates of an interval, the hosts the union of its addresses
+static void
+cardinality_row(cardinality_series_t *series, const cardinality_interval_t *interval, cardinality_row_t *row)
+{
+    row->start = interval->start;
+    row->packets = interval->packets;
+    for (uint32_t kind = 0; kind < CARDINALITY_KINDS; kind++){
+        row->estimates[kind] = hyperloglog_estimate(&interval->sketches[kind]);
+    }
+    memcpy(series->hosts.registers, interval->sketches[CARDINALITY_SOURCES].registers, series->hosts.size);
+    hyperloglog_merge(&series->hosts, &interval->sketches[CARDINALITY_DESTINATIONS]);
+    row->hosts = hyperloglog_estimate(&series->hosts);
+}
+
+// the estimates of an open interval become a row, its sketches go to the whole capture's
+static void
+cardinality_seal(cardinality_series_t *series, cardinality_interval_t *interval)
+{
+    if (series->row_count == series->row_capacity){
+        series->row_capacity = series->row_capacity ? series->row_capacity * 2 : 64;
+        series->rows = (cardinality_row_t*)realloc(series->rows, series->row_capacity * sizeof(cardinality_row_t));
+        if (series->rows == NULL){
+            perror("realloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+    cardinality_row(series, interval, &series->rows[series->row_count++]);
+    for (uint32_t kind = 0; kind < CARDINALITY_KINDS; kind++){
+        hyperloglog_merge(&series->total.sketches[kind], &interval->sketches[kind]);
+    }
+    series->total.packets += interval->packets;
+    cardinality_interval_reset(interval, 0);
+}
+
+// seal the open intervals starting before limit, the oldest first
+static void
+cardinality_seal_before(cardinality_series_t *series, uint64_t limit)
+{
+    for (;;){
+        cardinality_interval_t *oldest = NULL;
+        for (uint32_t i = 0; i < CARDINALITY_OPEN; i++){
+            cardinality_interval_t *interval = &series->open[i];
+            if (interval->packets != 0 && interval->start < limit && (oldest == NULL || interval->start < oldest->start)){
+                oldest = interval;
+            }
+        }
+        if (oldest == NULL){
+            return;
+        }
+        cardinality_seal(series, oldest);
+    }
+}
+
+/**
+ * @brief Add a thread's interval to the series, sealing the ones it
+ * leaves behind. The caller holds the lock shared with the other threads
+ *
+ * @param series
+ * @param interval of the same precision, its start a multiple of the length
+ */
+void
+cardinality_series_merge(cardinality_series_t *series, const cardinality_interval_t *interval)
+{
+    if (interval->packets == 0){
+        return;
+    }
+    uint64_t start = interval->start;
+    uint64_t window = CARDINALITY_OPEN * series->length;
+    cardinality_interval_t *target;
+    if (start + window <= series->newest){
+        // its place was sealed
+        target = &series->total;
+        series->late++;
+    } else {
+        if (start > series->newest){
+            series->newest = start;
+            if (start >= window){
+                cardinality_seal_before(series, start - window + series->length);
+            }
+        }
+        target = &series->open[start / series->length % CARDINALITY_OPEN];
+        target->start = start;
+    }
+    for (uint32_t kind = 0; kind < CARDINALITY_KINDS; kind++){
+        hyperloglog_merge(&target->sketches[kind], &interval->sketches[kind]);
+    }
+    target->packets += interval->packets;
+}
+
+/**
+ * @brief Seal the intervals still open, once every thread merged its last one
+ *
+ * @param series
+ */
+void
+cardinality_series_finish(cardinality_series_t *series)
+{
+    cardinality_seal_before(series, UINT64_MAX);
+}
+
+/**
+ * @brief The estimates of the whole capture, after cardinality_series_finish()
+ *
+ * @param series
+ * @param row its start 0
+ */
+void
+cardinality_series_total(cardinality_series_t *series, cardinality_row_t *row)
+{
+    cardinality_row(series, &series->total, row);
+}
@@ -0,0 +1,116 @@
+#ifndef CARDINALITY_H
+#define CARDINALITY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hyperloglog.h"
+
+/*
+How many distinct hosts, flows and DNS names a capture has, per interval
+of capture time, from one HyperLogLog sketch per kind of key: the same
+memory for a thousand hosts or a billion.
+
+    kind                        key
+    CARDINALITY_SOURCES         version, source address
+    CARDINALITY_DESTINATIONS    version, destination address
+    CARDINALITY_FLOWS           version, protocol, the two (address, port)
+                                ends smaller first: both ways one flow
+    CARDINALITY_QNAMES          the names queries ask for, lowercase
+
+the hosts, either address, are the union of the first two: their sketches
+merged when the interval is sealed, nothing more per packet.
+
+A thread counts the packets it decodes into its own interval; once its
+packets are past it, the interval is merged into the series, under the
+caller's lock, and the thread starts the next one:
+
+    thread 1   [ 12:03 ] --merge--\
+    thread 2   [ 12:03 ] --merge---> series  open: 12:00 12:01 12:02 12:03
+                                             rows: ... 11:58 11:59 (sealed)
+
+the series keeps the sketches of the last CARDINALITY_OPEN intervals, the
+threads may still be adding to them; an older one is sealed: its
+estimates become a row, its sketches are merged into the whole capture's
+and reused. An interval merged once its place was sealed (a thread far
+behind the others) counts in the whole capture only. The memory is
+(CARDINALITY_OPEN + 1 + threads) * CARDINALITY_KINDS + 1 sketches of
+2^precision bytes, and a row per interval.
+*/
+
+#define CARDINALITY_INTERVAL (60ull * 1000000)     // a minute, in microseconds
+#define CARDINALITY_OPEN 4
+#define CARDINALITY_NAME_SIZE 256
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct dissection;
+
+typedef enum cardinality_kind {
+    CARDINALITY_SOURCES,
+    CARDINALITY_DESTINATIONS,
+    CARDINALITY_FLOWS,
+    CARDINALITY_QNAMES,
+    CARDINALITY_KINDS
+} cardinality_kind_t;
+
+typedef struct cardinality_flow_key {
+    uint8_t version;
+    uint8_t protocol;
+    uint16_t ports[2];
+    uint8_t addresses[2][16];       // IPv4 in the first 4 bytes, the rest 0
+} cardinality_flow_key_t;
+
+typedef struct cardinality_interval {
+    uint64_t start;                 // microseconds, a multiple of the length
+    uint64_t packets;               // 0 while unused
+    hyperloglog_t sketches[CARDINALITY_KINDS];
+} cardinality_interval_t;
+
+// a sealed interval
+typedef struct cardinality_row {
+    uint64_t start;
+    uint64_t packets;
+    double estimates[CARDINALITY_KINDS];
+    double hosts;
+} cardinality_row_t;
+
+typedef struct cardinality_series {
+    uint64_t length;                // of an interval, microseconds
+    uint8_t precision;
+    uint64_t newest;                // the latest start merged
+    cardinality_interval_t open[CARDINALITY_OPEN];  // by start / length % CARDINALITY_OPEN
+    cardinality_row_t *rows;        // in order
+    uint32_t row_count;
+    uint32_t row_capacity;
+    cardinality_interval_t total;   // the sealed intervals and the late ones
+    hyperloglog_t hosts;            // scratch, the union of the addresses
+    uint64_t late;                  // intervals merged after their place was sealed
+} cardinality_series_t;
+
+void cardinality_interval_init(cardinality_interval_t *interval, uint8_t precision);
+void cardinality_interval_destroy(cardinality_interval_t *interval);
+void cardinality_interval_reset(cardinality_interval_t *interval, uint64_t start);
+void cardinality_add(cardinality_interval_t *interval, const struct dissection *dissection);
+
+cardinality_series_t* cardinality_series_create(uint64_t length, uint8_t precision);
+void cardinality_series_destroy(cardinality_series_t *series);
+void cardinality_series_merge(cardinality_series_t *series, const cardinality_interval_t *interval);
+void cardinality_series_finish(cardinality_series_t *series);
+void cardinality_series_total(cardinality_series_t *series, cardinality_row_t *row);
+
+// the start of the interval a timestamp falls in
+static inline uint64_t
+cardinality_interval_start(uint64_t timestamp, uint64_t length)
+{
+    return timestamp - timestamp % length;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,170 @@
+#include "cardinality.h"
+#include "dissector.h"
+#include "test_frames.h"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#define SECOND 1000000ull
+
+static bool
+about(double estimate, double count)
+{
+    return fabs(estimate - count) <= count * 0.05 + 0.5;
+}
+
+// count addresses 10.0.x.y from first to last, to the server 10.255.0.1
+static void
+add_hosts(cardinality_interval_t *interval, uint32_t first, uint32_t last)
+{
+    dissection_t dissection = {};
+    dissection.layers = LAYER_BIT(LAYER_IPV4) | LAYER_BIT(LAYER_TCP);
+    dissection.ipv4.protocol = 6;
+    uint8_t server[4] = {10, 255, 0, 1};
+    memcpy(dissection.ipv4.raw_destination_address, server, 4);
+    dissection.tcp.destination_port = 443;
+    for (uint32_t host = first; host < last; host++){
+        uint8_t client[4] = {10, 0, (uint8_t)(host >> 8), (uint8_t)host};
+        memcpy(dissection.ipv4.raw_source_address, client, 4);
+        dissection.tcp.source_port = 40000;
+        cardinality_add(interval, &dissection);
+    }
+}
+
+void
+test_packets()
+{
+    cardinality_interval_t interval;
+    cardinality_interval_init(&interval, 10);
+    arena_t arena;
+    arena_init(&arena, 0);
+    uint8_t packet[sizeof(dns_query)];
+
+    for (uint32_t i = 0; i < 3; i++){
+        memcpy(packet, dns_query, sizeof(packet));
+        if (i == 1){
+            // the same name, another case
+            packet[55] = 'A';
+        }
+        if (i == 2){
+            // the response: the same flow the other way, its question not counted
+            uint8_t swap[4];
+            memcpy(swap, packet + 26, 4);
+            memcpy(packet + 26, packet + 30, 4);
+            memcpy(packet + 30, swap, 4);
+            packet[34] = 0x00;
+            packet[35] = 0x35;
+            packet[36] = 0xc0;
+            packet[37] = 0x00;
+            packet[44] = 0x81;
+            packet[55] = 'c';
+        }
+        dissection_t dissection = {};
+        dissect(packet, sizeof(packet), LAYERS_ALL, &arena, false, &dissection);
+        cardinality_add(&interval, &dissection);
+        arena_reset(&arena);
+    }
+    assert(interval.packets == 3);
+    assert(about(hyperloglog_estimate(&interval.sketches[CARDINALITY_SOURCES]), 2));
+    assert(about(hyperloglog_estimate(&interval.sketches[CARDINALITY_DESTINATIONS]), 2));
+    assert(about(hyperloglog_estimate(&interval.sketches[CARDINALITY_FLOWS]), 1));
+    assert(about(hyperloglog_estimate(&interval.sketches[CARDINALITY_QNAMES]), 1));
+
+    cardinality_interval_reset(&interval, 60 * SECOND);
+    assert(interval.start == 60 * SECOND && interval.packets == 0);
+    assert(hyperloglog_estimate(&interval.sketches[CARDINALITY_SOURCES]) == 0);
+    arena_destroy(&arena);
+    cardinality_interval_destroy(&interval);
+}
+
+void
+test_series()
+{
+    const uint64_t length = 60 * SECOND;
+    cardinality_series_t *series = cardinality_series_create(length, 12);
+    assert(cardinality_interval_start(61 * SECOND, length) == length);
+    cardinality_interval_t first;
+    cardinality_interval_t second;
+    cardinality_interval_init(&first, 12);
+    cardinality_interval_init(&second, 12);
+
+    // two threads, intervals 0 to 5: 1000 clients each, half of them shared
+    for (uint64_t minute = 0; minute < 6; minute++){
+        cardinality_interval_reset(&first, minute * length);
+        cardinality_interval_reset(&second, minute * length);
+        add_hosts(&first, minute * 1000, minute * 1000 + 600);
+        add_hosts(&second, minute * 1000 + 400, minute * 1000 + 1000);
+        cardinality_series_merge(series, &first);
+        cardinality_series_merge(series, &second);
+    }
+    // the last 4 still open
+    assert(series->row_count == 2 && series->newest == 5 * length);
+    assert(series->rows[0].start == 0 && series->rows[1].start == length);
+    assert(series->rows[0].packets == 1200);
+    assert(about(series->rows[0].estimates[CARDINALITY_SOURCES], 1000));
+    assert(about(series->rows[0].estimates[CARDINALITY_DESTINATIONS], 1));
+    assert(about(series->rows[0].estimates[CARDINALITY_FLOWS], 1000));
+    assert(about(series->rows[0].hosts, 1001));
+
+    // a thread far behind: its interval was sealed
+    cardinality_interval_reset(&first, 0);
+    add_hosts(&first, 100000, 100500);
+    cardinality_series_merge(series, &first);
+    assert(series->late == 1 && series->row_count == 2);
+
+    // within the open ones, in place
+    cardinality_interval_reset(&first, 3 * length);
+    add_hosts(&first, 3000, 3100);
+    cardinality_series_merge(series, &first);
+    assert(series->late == 1);
+
+    cardinality_series_finish(series);
+    assert(series->row_count == 6);
+    for (uint32_t i = 0; i < 6; i++){
+        assert(series->rows[i].start == i * length);
+    }
+    assert(series->rows[3].packets == 1300);
+    assert(about(series->rows[3].estimates[CARDINALITY_SOURCES], 1000));
+
+    cardinality_row_t total;
+    cardinality_series_total(series, &total);
+    assert(total.packets == 6 * 1200 + 500 + 100);
+    assert(about(total.estimates[CARDINALITY_SOURCES], 6500));
+    assert(about(total.hosts, 6501));
+
+    cardinality_interval_destroy(&second);
+    cardinality_interval_destroy(&first);
+    cardinality_series_destroy(series);
+}
+
+void
+test_gaps()
+{
+    // intervals far apart seal everything before them, in order
+    const uint64_t length = 10 * SECOND;
+    cardinality_series_t *series = cardinality_series_create(length, 8);
+    cardinality_interval_t interval;
+    cardinality_interval_init(&interval, 8);
+    const uint64_t starts[] = {2, 3, 100, 101, 500};
+    for (uint64_t start : starts){
+        cardinality_interval_reset(&interval, start * length);
+        add_hosts(&interval, 0, 10);
+        cardinality_series_merge(series, &interval);
+    }
+    assert(series->row_count == 4);
+    cardinality_series_finish(series);
+    assert(series->row_count == 5 && series->late == 0);
+    for (uint32_t i = 0; i < 5; i++){
+        assert(series->rows[i].start == starts[i] * length);
+    }
+    cardinality_interval_destroy(&interval);
+    cardinality_series_destroy(series);
+}
+
+int main()
+{
+    test_packets();
+    test_series();
+    test_gaps();
+    return 0;
+}
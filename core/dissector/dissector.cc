@@ -0,0 +1,553 @@
+#include "dissector.h"
+
+#include <array>
+#include <iterator>
+
+#include "stage_timer.h"
+
+#define LAYER_KEY_NONE UINT32_MAX // a layer with nothing under it
+
+typedef struct dissect_state {
+    dissection_t *dissection;
+    uint32_t wanted;
+    arena_t *arena;
+    bool verbose;
+    bool reassemble;    // a reassembly, and layers wanted under IPv4
+    bool tcp_reassemble;    // a TCP reassembly, and layers wanted under TCP
+
+    // of the network layer, for the transport checksums
+    const uint8_t *source_address;
+    const uint8_t *destination_address;
+    uint8_t protocol;
+    uint8_t version;    // 4 or 6
+} dissect_state_t;
+
+/*
+A layer's function decodes the layer at the cursor into the dissection if
+full, otherwise only reads what it needs with the view parser. It checks
+that the layer fits, moves the cursor to the payload, gives the key of the next layer (LAYER_KEY_NONE for the last
+ones, which leave the cursor where they start) and returns false if the
+layer isn't there or doesn't fit.
+*/
+typedef bool (*layer_dissect_t)(dissect_state_t *state, packet_cursor_t *cursor, bool full, uint32_t *key);
+
+typedef struct layer_link {
+    uint32_t key;
+    layer_kind_t next;
+} layer_link_t;
+
+typedef struct layer_dissector {
+    layer_dissect_t dissect;
+    const layer_link_t *links;
+    size_t link_count;
+} layer_dissector_t;
+
+static bool
+dissect_ethernet(dissect_state_t *state, packet_cursor_t *cursor, bool full, uint32_t *key)
+{
+    uint16_t header_length;
+    if (full){
+        if (!packet_cursor_has(cursor, ETHER_HDR_LEN)){
+            return false;
+        }
+        my_ethernet_header_t *ethernet = &state->dissection->ethernet;
+        *ethernet = parse_ethernet(cursor->data, cursor->remaining, state->verbose);
+        // through the VLAN tag
+        *key = ethernet->vlan_tagged ? ethernet->type_vlan : ethernet->type;
+        header_length = ethernet->vlan_tagged ? ETHER_HDR_LEN + 4 : ETHER_HDR_LEN;
+    } else {
+        my_ethernet_view_t view;
+        if (!parse_ethernet_view(cursor->data, cursor->remaining, &view)){
+            return false;
+        }
+        *key = view.vlan_tagged ? view.type_vlan : view.type;
+        header_length = view.header_length;
+    }
+    state->dissection->ethertype = *key;
+    packet_cursor_skip(cursor, header_length);
+    return true;
+}
+
+static bool
+dissect_arp(dissect_state_t *state, packet_cursor_t *cursor, bool full, uint32_t *key)
+{
+    my_arp_view_t view;
+    if (!parse_arp_view(cursor->data, cursor->remaining, &view)){
+        return false;
+    }
+    if (full){
+        state->dissection->arp = parse_arp(cursor->data, cursor->remaining, state->verbose);
+    }
+    *key = LAYER_KEY_NONE;
+    return true;
+}
+
+/*
+A fragment goes to the reassembly with its header, the cursor at the
+start of the datagram: the layers under IPv4 are only read once it is
+whole, from the reassembled payload. Without a reassembly (or nothing
+wanted under IPv4), the first fragment is read as it is, the transport
+header is in it, and the others stop there.
+*/
+static bool
+dissect_ipv4_fragment(dissect_state_t *state, packet_cursor_t *cursor, uint16_t ip_off, uint32_t *key)
+{
+    dissection_t *dissection = state->dissection;
+    dissection->ipv4_fragment = true;
+    uint32_t header_length = (cursor->data[0] & 0x0f) * 4;
+    if (!state->reassemble){
+        if ((ip_off & IP_OFFMASK) != 0){
+            *key = LAYER_KEY_NONE;
+        }
+        packet_cursor_skip(cursor, header_length);
+        return true;
+    }
+
+    const uint8_t *payload;
+    uint32_t payload_length;
+    if (ipv4_reassembly_add(dissection->reassembly, cursor->data, cursor->remaining, dissection->timestamp,
+        &payload, &payload_length) != IPV4_REASSEMBLY_COMPLETE){
+        *key = LAYER_KEY_NONE;
+        packet_cursor_skip(cursor, header_length);
+        return true;
+    }
+    dissection->ipv4_reassembled = true;
+    *cursor = packet_cursor_init(payload, payload_length);
+    return true;
+}
+
+static bool
+dissect_ipv4(dissect_state_t *state, packet_cursor_t *cursor, bool full, uint32_t *key)
+{
+    uint32_t header_length;
+    uint16_t total_length;
+    uint16_t ip_off;
+    if (full){
+        my_ipv4_header_t *ipv4 = &state->dissection->ipv4;
+        *ipv4 = parse_ipv4(cursor->data, cursor->remaining, state->verbose);
+        // empty if it doesn't fit
+        header_length = ipv4->header_length * 4;
+        if (header_length < sizeof(struct ip) || header_length > cursor->remaining){
+            return false;
+        }
+        total_length = ipv4->total_length;
+        ip_off = (ipv4->flags.more_fragments ? IP_MF : 0) | ipv4->fragment_offset;
+        state->source_address = ipv4->raw_source_address;
+        state->destination_address = ipv4->raw_destination_address;
+        state->protocol = ipv4->protocol;
+    } else {
+        my_ipv4_view_t view;
+        if (!parse_ipv4_view(cursor->data, cursor->remaining, &view)){
+            return false;
+        }
+        header_length = view.header_length;
+        total_length = view.total_length;
+        ip_off = view.ip_off;
+        state->source_address = view.source_address;
+        state->destination_address = view.destination_address;
+        state->protocol = view.protocol;
+    }
+    *key = state->protocol;
+    state->version = 4;
+    state->dissection->ip_protocol = state->protocol;
+    // the frame can be padded after the datagram
+    packet_cursor_limit(cursor, total_length);
+    if (ipv4_is_fragment(ip_off)){
+        return dissect_ipv4_fragment(state, cursor, ip_off, key);
+    }
+    packet_cursor_skip(cursor, header_length);
+    return true;
+}
+
+static bool
+dissect_ipv6(dissect_state_t *state, packet_cursor_t *cursor, bool full, uint32_t *key)
+{
+    uint16_t payload_length;
+    if (full){
+        if (!packet_cursor_has(cursor, IPV6_HEADER_SIZE)){
+            return false;
+        }
+        my_ipv6_header_t *ipv6 = &state->dissection->ipv6;
+        *ipv6 = parse_ipv6(cursor->data, cursor->remaining, state->verbose);
+        payload_length = ipv6->payload_length;
+        state->source_address = ipv6->raw_source_address;
+        state->destination_address = ipv6->raw_destination_address;
+        state->protocol = ipv6->next_header;
+    } else {
+        my_ipv6_view_t view;
+        if (!parse_ipv6_view(cursor->data, cursor->remaining, &view)){
+            return false;
+        }
+        payload_length = view.payload_length;
+        state->source_address = view.source_address;
+        state->destination_address = view.destination_address;
+        state->protocol = view.next_header;
+    }
+    *key = state->protocol;
+    state->version = 6;
+    state->dissection->ip_protocol = state->protocol;
+    packet_cursor_skip(cursor, IPV6_HEADER_SIZE);
+    packet_cursor_limit(cursor, payload_length);
+    return true;
+}
+
+static bool
+dissect_icmp(dissect_state_t *state, packet_cursor_t *cursor, bool full, uint32_t *key)
+{
+    my_icmp_view_t view;
+    if (!parse_icmp_view(cursor->data, cursor->remaining, &view)){
+        return false;
+    }
+    if (full){
+        state->dissection->icmp = parse_icmp(cursor->data, cursor->remaining, state->arena, state->verbose);
+    }
+    *key = LAYER_KEY_NONE;
+    return true;
+}
+
+static bool
+dissect_icmpv6(dissect_state_t *state, packet_cursor_t *cursor, bool full, uint32_t *key)
+{
+    my_icmpv6_view_t view;
+    if (!parse_icmpv6_view(cursor->data, cursor->remaining, &view)){
+        return false;
+    }
+    if (full){
+        state->dissection->icmpv6 = parse_icmpv6(cursor->data, cursor->remaining, state->source_address, state->destination_address, state->arena, state->verbose);
+    }
+    *key = LAYER_KEY_NONE;
+    return true;
+}
+
+// without an address the transport parsers don't sum the payload
+static const uint8_t*
+pseudo_source(const dissect_state_t *state)
+{
+    return (state->wanted & LAYER_CHECKSUMS) ? state->source_address : NULL;
+}
+
+// a DNS message, with its sections if they are wanted
+static my_dns_header_t
+decode_dns(const dissect_state_t *state, const uint8_t *message, uint32_t length)
+{
+    return (state->wanted & LAYER_DNS_SECTIONS)
+        ? parse_dns(message, length, state->arena, state->verbose)
+        : parse_dns_header(message, length, state->verbose);
+}
+
+/*
+DNS over TCP, the cursor at the segment's payload: without a reassembly
+the segment holds one message, after its length. With one, the segment
+goes to it, then the messages are framed from what it delivers: all the
+whole ones are consumed, the first is decoded by dissect_dns() (in place
+in the packet, or copied to the arena when it is in the ring or across
+spans), the others here into dns_more, the rest of a message waits for
+the next segments.
+*/
+static bool
+dissect_tcp_dns(dissect_state_t *state, packet_cursor_t *cursor, const tcp_segment_t *segment, uint32_t *key)
+{
+    if (!state->tcp_reassemble){
+        if (*key != PORT_DNS || !packet_cursor_has(cursor, 2)){
+            return true;
+        }
+        uint16_t length = packet_cursor_u16(cursor);
+        packet_cursor_limit(cursor, length);
+        return true;
+    }
+
+    dissection_t *dissection = state->dissection;
+    tcp_delivery_t delivery;
+    tcp_reassembly_segment(dissection->tcp_reassembly, segment, &delivery);
+    uint32_t offset = 0;
+    uint32_t count = 0;
+    uint8_t prefix[2];
+    while (tcp_delivery_copy(&delivery, offset, 2, prefix) == 2){
+        uint32_t length = packet_load_u16(prefix);
+        if (delivery.length - offset - 2 < length){
+            break;
+        }
+        offset += 2 + length;
+        count++;
+    }
+    if (count == 0){
+        tcp_reassembly_consume(dissection->tcp_reassembly, &delivery, 0);
+        *key = LAYER_KEY_NONE;
+        return true;
+    }
+
+    tcp_delivery_copy(&delivery, 0, 2, prefix);
+    uint32_t first_length = packet_load_u16(prefix);
+    const uint8_t *message = tcp_delivery_bytes(&delivery, 2, first_length);
+    bool in_packet = message != NULL && delivery.packet != NULL && message >= delivery.packet
+        && message + first_length <= delivery.packet + delivery.packet_length;
+    if (!in_packet){
+        uint8_t *copy = (uint8_t*)arena_alloc(state->arena, first_length > 0 ? first_length : 1);
+        tcp_delivery_copy(&delivery, 2, first_length, copy);
+        message = copy;
+    }
+
+    // the others, before the ring they may lie in is consumed
+    if (count > 1 && (state->wanted & LAYER_BIT(LAYER_DNS))){
+        dissection->dns_more = (my_dns_header_t*)arena_alloc(state->arena, (count - 1) * sizeof(my_dns_header_t));
+        uint32_t next = 2 + first_length;
+        for (uint32_t i = 1; i < count; i++){
+            tcp_delivery_copy(&delivery, next, 2, prefix);
+            uint32_t length = packet_load_u16(prefix);
+            const uint8_t *other = tcp_delivery_bytes(&delivery, next + 2, length);
+            if (other == NULL){
+                uint8_t *copy = (uint8_t*)arena_alloc(state->arena, length > 0 ? length : 1);
+                tcp_delivery_copy(&delivery, next + 2, length, copy);
+                other = copy;
+            }
+            if (length >= DNS_HEADER_SIZE){
+                dissection->dns_more[dissection->dns_more_count++] = decode_dns(state, other, length);
+            }
+            next += 2 + length;
+        }
+    }
+    tcp_reassembly_consume(dissection->tcp_reassembly, &delivery, offset);
+    *cursor = packet_cursor_init(message, first_length);
+    *key = PORT_DNS;
+    return true;
+}
+
+static bool
+dissect_tcp(dissect_state_t *state, packet_cursor_t *cursor, bool full, uint32_t *key)
+{
+    uint32_t header_length;
+    tcp_segment_t segment;
+    if (full){
+        my_tcp_header_t *tcp = &state->dissection->tcp;
+        *tcp = parse_tcp_header(cursor->data, cursor->remaining, pseudo_source(state), state->destination_address, state->protocol, state->arena, state->verbose);
+        // empty if it doesn't fit
+        header_length = tcp->data_offset * 4;
+        if (header_length < sizeof(struct tcphdr) || header_length > cursor->remaining){
+            return false;
+        }
+        *key = tcp->destination_port;
+        segment.source_port = tcp->source_port;
+        segment.sequence_number = tcp->sequence_number;
+        segment.flags = tcp->flags;
+    } else {
+        my_tcp_view_t view;
+        if (!parse_tcp_view(cursor->data, cursor->remaining, &view)){
+            return false;
+        }
+        header_length = view.header_length;
+        *key = view.destination_port;
+        segment.source_port = view.source_port;
+        segment.sequence_number = view.sequence_number;
+        segment.flags = view.flags;
+    }
+    state->dissection->source_port = segment.source_port;
+    state->dissection->destination_port = *key;
+    packet_cursor_skip(cursor, header_length);
+
+    // DNS both ways, the responses come from its port
+    if ((state->wanted & LAYER_BIT(LAYER_DNS)) && (*key == PORT_DNS || segment.source_port == PORT_DNS)){
+        segment.version = state->version;
+        segment.source_address = state->source_address;
+        segment.destination_address = state->destination_address;
+        segment.destination_port = *key;
+        segment.payload = cursor->data;
+        segment.length = cursor->remaining;
+        segment.timestamp = state->dissection->timestamp;
+        return dissect_tcp_dns(state, cursor, &segment, key);
+    }
+    return true;
+}
+
+static bool
+dissect_udp(dissect_state_t *state, packet_cursor_t *cursor, bool full, uint32_t *key)
+{
+    if (!packet_cursor_has(cursor, sizeof(struct udphdr))){
+        return false;
+    }
+    uint16_t length;
+    if (full){
+        state->dissection->udp = parse_udp(cursor->data, cursor->remaining, pseudo_source(state), state->destination_address, state->protocol, state->verbose);
+        state->dissection->source_port = state->dissection->udp.source_port;
+        *key = state->dissection->udp.destination_port;
+        length = state->dissection->udp.length;
+    } else {
+        my_udp_view_t view;
+        parse_udp_view(cursor->data, cursor->remaining, &view);
+        state->dissection->source_port = view.source_port;
+        *key = view.destination_port;
+        length = view.length;
+    }
+    state->dissection->destination_port = *key;
+    packet_cursor_skip(cursor, sizeof(struct udphdr));
+    // the payload ends with the datagram, 0 is an IPv6 jumbogram's
+    if (length >= sizeof(struct udphdr)){
+        packet_cursor_limit(cursor, length - sizeof(struct udphdr));
+    }
+    // DNS both ways, the responses come from its port
+    if (state->dissection->source_port == PORT_DNS){
+        *key = PORT_DNS;
+    }
+    return true;
+}
+
+static bool
+dissect_dns(dissect_state_t *state, packet_cursor_t *cursor, bool full, uint32_t *key)
+{
+    if (!packet_cursor_has(cursor, DNS_HEADER_SIZE)){
+        return false;
+    }
+    if (full){
+        state->dissection->dns = decode_dns(state, cursor->data, cursor->remaining);
+    }
+    *key = LAYER_KEY_NONE;
+    return true;
+}
+
+static bool
+dissect_dhcp(dissect_state_t *state, packet_cursor_t *cursor, bool full, uint32_t *key)
+{
+    if (!packet_cursor_has(cursor, BOOTP_OPTIONS_OFFSET)){
+        return false;
+    }
+    if (full){
+        state->dissection->dhcp = parse_bootp(cursor->data, cursor->remaining, state->arena, state->verbose);
+    }
+    *key = LAYER_KEY_NONE;
+    return true;
+}
+
+constexpr layer_link_t ethernet_links[] = {
+    {ETHERTYPE_IP,   LAYER_IPV4},
+    {ETHERTYPE_IPV6, LAYER_IPV6},
+    {ETHERTYPE_ARP,  LAYER_ARP},
+};
+
+constexpr layer_link_t ipv4_links[] = {
+    {IPPROTO_TCP,  LAYER_TCP},
+    {IPPROTO_UDP,  LAYER_UDP},
+    {IPPROTO_ICMP, LAYER_ICMP},
+};
+
+constexpr layer_link_t ipv6_links[] = {
+    {IPPROTO_TCP,    LAYER_TCP},
+    {IPPROTO_UDP,    LAYER_UDP},
+    {IPPROTO_ICMPV6, LAYER_ICMPV6},
+};
+
+constexpr layer_link_t tcp_links[] = {
+    {PORT_DNS, LAYER_DNS},
+};
+
+constexpr layer_link_t udp_links[] = {
+    {PORT_DNS,    LAYER_DNS},
+    {PORT_BOOTPS, LAYER_DHCP},
+    {PORT_BOOTPC, LAYER_DHCP},
+};
+
+// indexed by layer_kind_t
+constexpr layer_dissector_t layer_dissectors[LAYER_KINDS] = {
+    {dissect_ethernet, ethernet_links, std::size(ethernet_links)},
+    {dissect_arp,      nullptr,        0},
+    {dissect_ipv4,     ipv4_links,     std::size(ipv4_links)},
+    {dissect_ipv6,     ipv6_links,     std::size(ipv6_links)},
+    {dissect_icmp,     nullptr,        0},
+    {dissect_icmpv6,   nullptr,        0},
+    {dissect_tcp,      tcp_links,      std::size(tcp_links)},
+    {dissect_udp,      udp_links,      std::size(udp_links)},
+    {dissect_dns,      nullptr,        0},
+    {dissect_dhcp,     nullptr,        0},
+};
+
+// the layers that can be found under each one, from the links
+constexpr std::array<uint32_t, LAYER_KINDS>
+make_layers_below()
+{
+    std::array<uint32_t, LAYER_KINDS> below{};
+    // a pass goes one link further down, there are fewer links than kinds
+    for (int pass = 0; pass < LAYER_KINDS; pass++){
+        for (int kind = 0; kind < LAYER_KINDS; kind++){
+            for (size_t i = 0; i < layer_dissectors[kind].link_count; i++){
+                layer_kind_t next = layer_dissectors[kind].links[i].next;
+                below[kind] |= LAYER_BIT(next) | below[next];
+            }
+        }
+    }
+    return below;
+}
+
+constexpr auto layers_below = make_layers_below();
+
+static_assert((layers_below[LAYER_ETHERNET] | LAYER_BIT(LAYER_ETHERNET)) == (LAYERS_ALL & ~(LAYER_DNS_SECTIONS | LAYER_CHECKSUMS | LAYER_KEYS)),
+    "every layer is reached from ethernet");
+
+static_assert(STAGE_DHCP - STAGE_ETHERNET == LAYER_DHCP - LAYER_ETHERNET, "a stage per layer, in the same order");
+
+/**
+ * @brief Decode the layers of a packet that are wanted, walk through
+ * the ones above them, stop under the deepest one.
+ * The packet is only read.
+ *
+ * @param packet
+ * @param caplen bytes captured, no layer is read past them
+ * @param wanted LAYER_BIT() of the layers to decode, LAYER_DNS_SECTIONS, LAYER_CHECKSUMS, LAYER_KEYS
+ * @param arena the strings and sections of the decoded layers
+ * @param verbose descriptions of the verbose renderers
+ * @param dissection reset, then filled
+ */
+void
+dissect(const uint8_t *packet, uint32_t caplen, uint32_t wanted, arena_t *arena, bool verbose, dissection_t *dissection)
+{
+    STAGE_SCOPE(STAGE_DISSECT);
+    bool reassemble = dissection->reassembly != NULL && (wanted & layers_below[LAYER_IPV4]) != 0;
+    bool tcp_reassemble = dissection->tcp_reassembly != NULL && (wanted & layers_below[LAYER_TCP]) != 0;
+    dissect_state_t state = {dissection, wanted, arena, verbose, reassemble, tcp_reassemble, NULL, NULL, 0, 0};
+    // the layers read, down to the transport for its keys
+    uint32_t reached = (wanted & LAYER_KEYS) ? wanted | LAYER_BIT(LAYER_TCP) | LAYER_BIT(LAYER_UDP) : wanted;
+    dissection->depth = 0;
+    dissection->layers = 0;
+    dissection->ethertype = 0;
+    dissection->ip_protocol = 0;
+    dissection->source_port = 0;
+    dissection->destination_port = 0;
+    dissection->ipv4_fragment = false;
+    dissection->ipv4_reassembled = false;
+    dissection->dns_more_count = 0;
+    dissection->ip_version = 0;
+    dissection->source_address = NULL;
+    dissection->destination_address = NULL;
+
+    packet_cursor_t cursor = packet_cursor_init(packet, caplen);
+    layer_kind_t kind = LAYER_ETHERNET;
+    for (;;){
+        // nothing wanted from here down
+        if ((reached & (LAYER_BIT(kind) | layers_below[kind])) == 0){
+            break;
+        }
+        const layer_dissector_t *layer = &layer_dissectors[kind];
+        bool full = (wanted & LAYER_BIT(kind)) != 0;
+        uint32_t key;
+        STAGE_BEGIN(start);
+        bool decoded = layer->dissect(&state, &cursor, full, &key);
+        STAGE_END(start, (stage_t)(STAGE_ETHERNET + (kind - LAYER_ETHERNET)));
+        if (!decoded){
+            break;
+        }
+        if (full){
+            dissection->stack[dissection->depth++] = kind;
+            dissection->layers |= LAYER_BIT(kind);
+        }
+
+        size_t i = 0;
+        while (i < layer->link_count && layer->links[i].key != key){
+            i++;
+        }
+        if (i == layer->link_count){
+            break;
+        }
+        kind = layer->links[i].next;
+    }
+    dissection->ip_version = state.version;
+    dissection->source_address = state.source_address;
+    dissection->destination_address = state.destination_address;
+    dissection->payload = cursor;
+}
@@ -0,0 +1,146 @@
+#ifndef DISSECTOR_H
+#define DISSECTOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "packet_cursor.h"
+#include "ethernet.h"
+#include "arp.h"
+#include "ipv4.h"
+#include "ipv6.h"
+#include "icmp.h"
+#include "icmpv6.h"
+#include "tcp.h"
+#include "udp.h"
+#include "dns.h"
+#include "dhcp_bootp.h"
+#include "ipv4_reassembly.h"
+#include "tcp_reassembly.h"
+
+/*
+One pass over a packet, from the link layer down, for every renderer and
+statistic: they say which layers they read, the dissector decodes those
+once and nothing else.
+
+The layers are linked by a field of the one above them:
+
+    ethernet --type-------> ipv4, ipv6, arp
+    ipv4 ------protocol---> tcp, udp, icmp
+    ipv6 ------next header> tcp, udp, icmpv6
+    tcp -------dst port---> dns
+    udp -------dst port---> dns, dhcp
+               src port---> dns, the responses
+
+A wanted layer is decoded by its full parser (descriptions, options) and
+pushed on the stack, the TCP and UDP checksums are only verified with
+LAYER_CHECKSUMS. A layer that isn't wanted but sits above a wanted one is
+only walked through with its view parser, to find where the next one
+starts. Below the deepest wanted layer nothing is read.
+
+    wanted = LAYER_BIT(LAYER_DNS)
+
+    ethernet   walked     view: type, header length
+    ipv4       walked     view: protocol, header length, total length
+    udp        walked     view: ports, length
+    dns        decoded    parse_dns_header(), the sections aren't wanted
+
+Whatever is wanted, the keys linking the layers read are kept: the
+ethertype, the IP addresses and protocol, the ports. LAYER_KEYS walks down to TCP or UDP
+for them when nothing is wanted that far, for the statistics that only
+need to know what a packet carries.
+
+IPv4 fragments go to the reassembly of the dissection when there is one:
+the layers under IPv4 are decoded from the whole datagram, with its last
+fragment, and not before. Its payload lasts until the next packet.
+
+DNS over TCP is a stream of messages, each one after its length on two
+bytes. With a TCP reassembly in the dissection, the segments to or from
+port 53 go to it and the messages are framed across them: the first one
+made whole by the packet is decoded, in place when it lies in one span of
+the delivery, from a copy in the arena otherwise. The others it makes
+whole (pipelined queries, the messages of a zone transfer) are decoded
+into dns_more, in the arena. Without one, a segment to port 53 is taken
+to hold a whole message.
+
+The strings and the sections of the decoded layers are in the arena, they
+last until its reset. A dissection_t is reused from one packet to the
+next: only the layers in the stack are valid.
+*/
+
+typedef enum layer_kind {
+    LAYER_ETHERNET,
+    LAYER_ARP,
+    LAYER_IPV4,
+    LAYER_IPV6,
+    LAYER_ICMP,
+    LAYER_ICMPV6,
+    LAYER_TCP,
+    LAYER_UDP,
+    LAYER_DNS,
+    LAYER_DHCP,
+    LAYER_KINDS
+} layer_kind_t;
+
+#define LAYER_BIT(kind) (1u << (kind))
+// details of the layers, past their headers
+#define LAYER_DNS_SECTIONS (1u << LAYER_KINDS)       // with LAYER_DNS, the questions and records too
+#define LAYER_CHECKSUMS (1u << (LAYER_KINDS + 1))    // the TCP and UDP checksums verified, over the payload
+#define LAYER_KEYS (1u << (LAYER_KINDS + 2))         // walked down to TCP or UDP, for their keys
+#define LAYERS_ALL ((1u << (LAYER_KINDS + 3)) - 1)
+
+typedef struct dissection {
+    layer_kind_t stack[LAYER_KINDS];    // the layers decoded, the outermost first
+    uint8_t depth;
+    uint32_t layers;                    // LAYER_BIT() of each layer in the stack
+
+    my_ethernet_header_t ethernet;
+    my_arp_header_t arp;
+    my_ipv4_header_t ipv4;
+    my_ipv6_header_t ipv6;
+    my_icmp_t icmp;
+    my_icmpv6_t icmpv6;
+    my_tcp_header_t tcp;
+    my_udp_header_t udp;
+    my_dns_header_t dns;
+    my_dhcp_bootp_header_t dhcp;
+
+    // with LAYER_DNS over TCP, the messages after the first one the
+    // segment made whole, in the arena
+    my_dns_header_t *dns_more;
+    uint32_t dns_more_count;
+
+    // the keys of the layers read, decoded or walked through, 0 for the
+    // ones not reached
+    uint16_t ethertype;                 // through the VLAN tag
+    uint8_t ip_version;                 // 4 or 6
+    const uint8_t *source_address;      // 4 or 16 bytes, in the packet or the IPv4 header
+    const uint8_t *destination_address;
+    uint8_t ip_protocol;                // IPv4 protocol or IPv6 next header
+    uint16_t source_port;               // TCP or UDP
+    uint16_t destination_port;
+
+    // after the last header walked through, the TCP or UDP payload
+    // when the application layer isn't known, its message when it is
+    // (DNS, DHCP); up to the IP and UDP lengths, the padding left out
+    packet_cursor_t payload;
+
+    // set by the caller, kept from one packet to the next: NULL to not
+    // reassemble, the timestamp of the packet in microseconds
+    ipv4_reassembly_t *reassembly;
+    uint64_t timestamp;
+    bool ipv4_fragment;                 // the packet is a fragment
+    bool ipv4_reassembled;              // its last one, the layers under IPv4 from the whole datagram
+    tcp_reassembly_t *tcp_reassembly;   // set by the caller, NULL to not reassemble
+} dissection_t;
+
+void dissect(const uint8_t *packet, uint32_t caplen, uint32_t wanted, arena_t *arena, bool verbose, dissection_t *dissection);
+
+static inline bool
+dissection_has(const dissection_t *dissection, layer_kind_t kind)
+{
+    return (dissection->layers & LAYER_BIT(kind)) != 0;
+}
+
+#endif
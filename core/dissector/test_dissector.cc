@@ -0,0 +1,325 @@
+#include "dissector.h"
+#include "test_frames.h"
+#include <cassert>
+#include <cstring>
+
+static const uint32_t udp_payload_offset = 14 + 20 + 8;
+
+void test_dissect_all()
+{
+    arena_t arena;
+    arena_init(&arena, 0);
+    dissection_t dissection = {};
+    dissect(dns_query, sizeof(dns_query), LAYERS_ALL, &arena, false, &dissection);
+
+    assert(dissection.depth == 4);
+    assert(dissection.stack[0] == LAYER_ETHERNET);
+    assert(dissection.stack[1] == LAYER_IPV4);
+    assert(dissection.stack[2] == LAYER_UDP);
+    assert(dissection.stack[3] == LAYER_DNS);
+    assert(dissection_has(&dissection, LAYER_UDP));
+    assert(!dissection_has(&dissection, LAYER_TCP));
+    assert(dissection.ethernet.type == ETHERTYPE_IP);
+    assert(strcmp(dissection.ipv4.source_ipv4, "10.0.0.1") == 0);
+    assert(dissection.udp.destination_port == PORT_DNS);
+    assert(dissection.udp.calculated_checksum != 0);
+    assert(dissection.dns.transaction_id == 0xbeef);
+    assert(dissection.dns.question_section.count == 1);
+    assert(strcmp(dns_questions_items(&dissection.dns.question_section)->qname, "a.b") == 0);
+    arena_destroy(&arena);
+}
+
+void test_dissect_dns_header_only()
+{
+    arena_t arena;
+    arena_init(&arena, 0);
+    dissection_t dissection = {};
+    dissect(dns_query, sizeof(dns_query), LAYERS_ALL & ~(LAYER_DNS_SECTIONS | LAYER_CHECKSUMS), &arena, false, &dissection);
+    assert(dissection.depth == 4);
+    // the payload isn't summed either
+    assert(dissection.udp.calculated_checksum == 0 && !dissection.udp.checksum_correct);
+    assert(dissection.dns.qdcount == 1);
+    assert(dissection.dns.question_section.count == 0);
+    // nothing of the sections was built
+    assert(arena.used == 0);
+    arena_destroy(&arena);
+}
+
+void test_dissect_walk_through()
+{
+    arena_t arena;
+    arena_init(&arena, 0);
+    dissection_t dissection = {};
+
+    // the layers above DNS are only walked through
+    dissect(dns_query, sizeof(dns_query), LAYER_BIT(LAYER_DNS), &arena, false, &dissection);
+    assert(dissection.depth == 1);
+    assert(dissection.stack[0] == LAYER_DNS);
+    assert(dissection.layers == LAYER_BIT(LAYER_DNS));
+    assert(dissection.dns.transaction_id == 0xbeef);
+
+    // nothing is read under the deepest layer wanted
+    dissect(dns_query, sizeof(dns_query), LAYER_BIT(LAYER_ETHERNET), &arena, false, &dissection);
+    assert(dissection.depth == 1);
+    assert(dissection.payload.data == dns_query + 14);
+
+    dissect(dns_query, sizeof(dns_query), LAYER_BIT(LAYER_UDP), &arena, false, &dissection);
+    assert(dissection.layers == LAYER_BIT(LAYER_UDP));
+    assert(dissection.payload.data == dns_query + udp_payload_offset);
+    assert(dissection.payload.remaining == sizeof(dns_query) - udp_payload_offset);
+
+    // a layer that isn't on the packet's path isn't there
+    dissect(dns_query, sizeof(dns_query), LAYER_BIT(LAYER_TCP) | LAYER_BIT(LAYER_IPV4), &arena, false, &dissection);
+    assert(dissection.layers == LAYER_BIT(LAYER_IPV4));
+    arena_destroy(&arena);
+}
+
+void test_dissect_keys()
+{
+    arena_t arena;
+    arena_init(&arena, 0);
+    dissection_t dissection = {};
+
+    // walked down to UDP, nothing decoded
+    dissect(dns_query, sizeof(dns_query), LAYER_KEYS, &arena, false, &dissection);
+    assert(dissection.depth == 0);
+    assert(dissection.ethertype == ETHERTYPE_IP && dissection.ip_protocol == IPPROTO_UDP);
+    assert(dissection.source_port == 49152 && dissection.destination_port == PORT_DNS);
+    assert(dissection.ip_version == 4 && dissection.source_address == dns_query + 26);
+    assert(dissection.destination_address[3] == 2);
+    assert(dissection.payload.data == dns_query + udp_payload_offset);
+
+    // the same decoded
+    dissect(dns_query, sizeof(dns_query), LAYERS_ALL, &arena, false, &dissection);
+    assert(dissection.ethertype == ETHERTYPE_IP && dissection.ip_protocol == IPPROTO_UDP);
+    assert(dissection.source_port == 49152 && dissection.destination_port == PORT_DNS);
+
+    // only the layers read, the others from the last packet are gone
+    dissect(dns_query, sizeof(dns_query), LAYER_BIT(LAYER_ETHERNET), &arena, false, &dissection);
+    assert(dissection.ethertype == ETHERTYPE_IP && dissection.ip_protocol == 0);
+    assert(dissection.source_port == 0 && dissection.destination_port == 0);
+    arena_destroy(&arena);
+}
+
+void test_dissect_snaplen()
+{
+    arena_t arena;
+    arena_init(&arena, 0);
+    dissection_t dissection = {};
+
+    // the capture stops in the UDP header
+    dissect(dns_query, 14 + 20 + 6, LAYERS_ALL, &arena, false, &dissection);
+    assert(dissection.layers == (LAYER_BIT(LAYER_ETHERNET) | LAYER_BIT(LAYER_IPV4)));
+
+    // and in the DNS header
+    dissect(dns_query, udp_payload_offset + 4, LAYERS_ALL, &arena, false, &dissection);
+    assert(dissection.depth == 3);
+    assert(!dissection_has(&dissection, LAYER_DNS));
+    arena_destroy(&arena);
+}
+
+// the query of dns_query in two fragments, 16 then 13 bytes of the UDP datagram
+uint32_t
+build_query_fragment(uint8_t *frame, bool first)
+{
+    uint32_t ip_offset = 14;
+    uint32_t size = first ? 16 : 13;
+    memcpy(frame, dns_query, ip_offset + 20);
+    uint16_t total_length = 20 + size;
+    frame[ip_offset + 2] = total_length >> 8;
+    frame[ip_offset + 3] = total_length & 0xff;
+    frame[ip_offset + 6] = first ? 0x20 : 0x00;   // more fragments
+    frame[ip_offset + 7] = first ? 0 : 16 / 8;
+    memcpy(frame + ip_offset + 20, dns_query + ip_offset + 20 + (first ? 0 : 16), size);
+    return ip_offset + 20 + size;
+}
+
+void test_dissect_fragments()
+{
+    arena_t arena;
+    arena_init(&arena, 0);
+    dissection_t dissection = {};
+    uint8_t first[sizeof(dns_query)];
+    uint8_t second[sizeof(dns_query)];
+    uint32_t first_length = build_query_fragment(first, true);
+    uint32_t second_length = build_query_fragment(second, false);
+
+    // no reassembly: the first one has the UDP header, the second one stops at IPv4
+    dissect(first, first_length, LAYERS_ALL, &arena, false, &dissection);
+    assert(dissection.ipv4_fragment && !dissection.ipv4_reassembled);
+    assert(dissection_has(&dissection, LAYER_UDP));
+    assert(!dissection_has(&dissection, LAYER_DNS));
+    dissect(second, second_length, LAYERS_ALL, &arena, false, &dissection);
+    assert(dissection.layers == (LAYER_BIT(LAYER_ETHERNET) | LAYER_BIT(LAYER_IPV4)));
+
+    // reassembled, the layers under IPv4 come with the last fragment, out of order here
+    dissection.reassembly = ipv4_reassembly_create(16, 0, 0, IPV4_OVERLAP_FIRST);
+    dissection.timestamp = 1000000;
+    dissect(second, second_length, LAYERS_ALL, &arena, false, &dissection);
+    assert(dissection.ipv4_fragment && !dissection.ipv4_reassembled);
+    assert(dissection.depth == 2);
+    dissect(first, first_length, LAYERS_ALL, &arena, false, &dissection);
+    assert(dissection.ipv4_reassembled);
+    assert(dissection.depth == 4);
+    assert(dissection.udp.destination_port == PORT_DNS);
+    assert(dissection.dns.transaction_id == 0xbeef);
+    assert(strcmp(dns_questions_items(&dissection.dns.question_section)->qname, "a.b") == 0);
+
+    // nothing wanted under IPv4, nothing held
+    dissect(second, second_length, LAYER_BIT(LAYER_IPV4), &arena, false, &dissection);
+    assert(dissection.ipv4_fragment);
+    assert(dissection.reassembly->count == 0);
+    ipv4_reassembly_destroy(dissection.reassembly);
+    arena_destroy(&arena);
+}
+
+// Ethernet, IPv4, TCP from port 53 (or to it), with seq and the payload
+uint32_t
+build_tcp_segment(uint8_t *frame, bool to_dns, uint32_t seq, const uint8_t *payload, uint32_t size)
+{
+    uint32_t ip_offset = 14;
+    uint32_t tcp_offset = ip_offset + 20;
+    memcpy(frame, dns_query, tcp_offset);
+    uint16_t total_length = 20 + 20 + size;
+    frame[ip_offset + 2] = total_length >> 8;
+    frame[ip_offset + 3] = total_length & 0xff;
+    frame[ip_offset + 9] = IPPROTO_TCP;
+    uint8_t *tcp = frame + tcp_offset;
+    memset(tcp, 0, 20);
+    uint16_t source_port = to_dns ? 40000 : PORT_DNS;
+    uint16_t destination_port = to_dns ? PORT_DNS : 40000;
+    tcp[0] = source_port >> 8;
+    tcp[1] = source_port & 0xff;
+    tcp[2] = destination_port >> 8;
+    tcp[3] = destination_port & 0xff;
+    tcp[4] = seq >> 24;
+    tcp[5] = (seq >> 16) & 0xff;
+    tcp[6] = (seq >> 8) & 0xff;
+    tcp[7] = seq & 0xff;
+    tcp[12] = 5 << 4;
+    tcp[13] = 0x10;     // ACK
+    memcpy(tcp + 20, payload, size);
+    return tcp_offset + 20 + size;
+}
+
+void test_dissect_dns_over_tcp()
+{
+    arena_t arena;
+    arena_init(&arena, 0);
+    dissection_t dissection = {};
+    // the message of dns_query after its length
+    uint32_t message_length = sizeof(dns_query) - udp_payload_offset;
+    uint8_t stream[2 + sizeof(dns_query)];
+    stream[0] = 0;
+    stream[1] = message_length;
+    memcpy(stream + 2, dns_query + udp_payload_offset, message_length);
+    uint8_t frame[64 + sizeof(dns_query)];
+
+    // without a reassembly, one segment to port 53 with the whole message
+    uint32_t length = build_tcp_segment(frame, true, 1001, stream, 2 + message_length);
+    dissect(frame, length, LAYERS_ALL, &arena, false, &dissection);
+    assert(dissection_has(&dissection, LAYER_DNS));
+    assert(dissection.dns.transaction_id == 0xbeef);
+    assert(strcmp(dns_questions_items(&dissection.dns.question_section)->qname, "a.b") == 0);
+
+    // from port 53 in two segments, the message is whole with the second
+    dissection.tcp_reassembly = tcp_reassembly_create(16, 0, 0);
+    dissection.timestamp = 1000000;
+    length = build_tcp_segment(frame, false, 5001, stream, 10);
+    dissect(frame, length, LAYERS_ALL, &arena, false, &dissection);
+    assert(dissection_has(&dissection, LAYER_TCP) && !dissection_has(&dissection, LAYER_DNS));
+    length = build_tcp_segment(frame, false, 5011, stream + 10, 2 + message_length - 10);
+    dissect(frame, length, LAYERS_ALL, &arena, false, &dissection);
+    assert(dissection_has(&dissection, LAYER_DNS));
+    assert(dissection.dns.transaction_id == 0xbeef);
+    assert(strcmp(dns_questions_items(&dissection.dns.question_section)->qname, "a.b") == 0);
+    assert(dissection.tcp_reassembly->bytes == 2 + message_length);
+
+    // a whole message in the segment, read in place
+    length = build_tcp_segment(frame, false, 5001 + 2 + message_length, stream, 2 + message_length);
+    dissect(frame, length, LAYER_BIT(LAYER_DNS), &arena, false, &dissection);
+    assert(dissection.layers == LAYER_BIT(LAYER_DNS));
+    assert(dissection.payload.data == frame + 14 + 20 + 20 + 2);
+    tcp_reassembly_destroy(dissection.tcp_reassembly);
+    arena_destroy(&arena);
+}
+
+void test_dissect_dns_over_tcp_pipelined()
+{
+    arena_t arena;
+    arena_init(&arena, 0);
+    dissection_t dissection = {};
+    dissection.tcp_reassembly = tcp_reassembly_create(16, 0, 0);
+    dissection.timestamp = 1000000;
+    // two queries in one segment, the second one with another id
+    uint32_t message_length = sizeof(dns_query) - udp_payload_offset;
+    uint8_t stream[2 * (2 + sizeof(dns_query))];
+    for (uint32_t i = 0; i < 2; i++){
+        uint8_t *message = stream + i * (2 + message_length);
+        message[0] = 0;
+        message[1] = message_length;
+        memcpy(message + 2, dns_query + udp_payload_offset, message_length);
+    }
+    stream[2 + message_length + 2] = 0xca;
+    stream[2 + message_length + 3] = 0xfe;
+    uint8_t frame[64 + sizeof(stream)];
+    uint32_t length = build_tcp_segment(frame, true, 1001, stream, 2 * (2 + message_length));
+    dissect(frame, length, LAYERS_ALL, &arena, false, &dissection);
+    assert(dissection_has(&dissection, LAYER_DNS));
+    assert(dissection.dns.transaction_id == 0xbeef);
+    assert(dissection.dns_more_count == 1);
+    assert(dissection.dns_more[0].transaction_id == 0xcafe);
+    assert(strcmp(dns_questions_items(&dissection.dns_more[0].question_section)->qname, "a.b") == 0);
+    assert(dissection.tcp_reassembly->bytes == 2 * (2 + message_length));
+
+    // the next packet has none of them
+    length = build_tcp_segment(frame, true, 1001 + 2 * (2 + message_length), stream, 2 + message_length);
+    dissect(frame, length, LAYERS_ALL, &arena, false, &dissection);
+    assert(dissection.dns.transaction_id == 0xbeef);
+    assert(dissection.dns_more_count == 0);
+    tcp_reassembly_destroy(dissection.tcp_reassembly);
+    arena_destroy(&arena);
+}
+
+void test_dissect_dns_response()
+{
+    arena_t arena;
+    arena_init(&arena, 0);
+    dissection_t dissection = {};
+
+    // the query answered: ports swapped, qr set, padded by the link
+    uint8_t response[sizeof(dns_query) + 8];
+    memcpy(response, dns_query, sizeof(dns_query));
+    memset(response + sizeof(dns_query), 0xff, 8);
+    memcpy(response + 34, dns_query + 36, 2);
+    memcpy(response + 36, dns_query + 34, 2);
+    response[udp_payload_offset + 2] |= 0x80;
+
+    dissect(response, sizeof(response), LAYER_KEYS | LAYER_BIT(LAYER_DNS), &arena, false, &dissection);
+    assert(dissection_has(&dissection, LAYER_DNS));
+    assert(dissection.source_port == PORT_DNS && dissection.destination_port == 49152);
+    assert(dissection.dns.transaction_id == 0xbeef);
+    assert(dissection.payload.data == response + udp_payload_offset);
+    assert(dissection.payload.remaining == sizeof(dns_query) - udp_payload_offset);
+
+    // bytes in the IPv4 datagram past the UDP length aren't the payload
+    response[17] += 4;
+    response[39] -= 4;
+    dissect(response, sizeof(response), LAYER_KEYS | LAYER_BIT(LAYER_DNS), &arena, false, &dissection);
+    assert(dissection.payload.remaining == sizeof(dns_query) - udp_payload_offset - 4);
+    arena_destroy(&arena);
+}
+
+int main()
+{
+    test_dissect_all();
+    test_dissect_dns_header_only();
+    test_dissect_walk_through();
+    test_dissect_keys();
+    test_dissect_dns_response();
+    test_dissect_snaplen();
+    test_dissect_fragments();
+    test_dissect_dns_over_tcp();
+    test_dissect_dns_over_tcp_pipelined();
+    return 0;
+}
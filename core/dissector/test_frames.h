@@ -0,0 +1,16 @@
+#ifndef TEST_FRAMES_H
+#define TEST_FRAMES_H
+
+#include <cstdint>
+
+// Ethernet, IPv4 10.0.0.1 -> 10.0.0.2, UDP 49152 -> 53, a DNS query for "a.b" A
+static const uint8_t dns_query[] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0x08, 0x00,
+    0x45, 0x00, 0x00, 0x31, 0x12, 0x34, 0x00, 0x00, 0x40, 0x11, 0x00, 0x00,
+    0x0a, 0x00, 0x00, 0x01, 0x0a, 0x00, 0x00, 0x02,
+    0xc0, 0x00, 0x00, 0x35, 0x00, 0x1d, 0x00, 0x00,
+    0xbe, 0xef, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x01, 'a', 0x01, 'b', 0x00, 0x00, 0x01, 0x00, 0x01,
+};
+
+#endif
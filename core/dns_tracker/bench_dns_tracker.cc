@@ -0,0 +1,155 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include "dns_tracker.h"
+#include "dissector.h"
+
+/*
+Queries per second through dns_tracker_add, each one answered after a
+number of others were sent (queries in flight), from 65536 clients to 64
+servers. One in 100 is never answered and times out, 5 seconds (500000
+queries) later. The frames path dissects the same messages out of
+ethernet frames (LAYER_KEYS and LAYER_DNS, as --dns) and gives the
+dissections to dns_tracker_update.
+
+usage: bench_dns_tracker [queries]
+*/
+
+#define FRAME_LENGTH (14 + 20 + 8 + 12 + 17 + 4)
+
+double
+now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct bench_query {
+    uint8_t client[4];
+    uint8_t server[4];
+    uint16_t port;
+    uint16_t id;
+    uint32_t qname_hash;
+} bench_query_t;
+
+void
+build_frame(uint8_t *frame, const bench_query_t *query, bool response)
+{
+    memset(frame, 0, FRAME_LENGTH);
+    frame[12] = 0x08;
+    uint8_t *ip = frame + 14;
+    ip[0] = 0x45;
+    ip[3] = FRAME_LENGTH - 14;
+    ip[9] = 17;
+    memcpy(ip + 12, response ? query->server : query->client, 4);
+    memcpy(ip + 16, response ? query->client : query->server, 4);
+    uint8_t *udp = ip + 20;
+    uint16_t source_port = response ? 53 : query->port;
+    uint16_t destination_port = response ? query->port : 53;
+    udp[0] = source_port >> 8;
+    udp[1] = source_port & 0xff;
+    udp[2] = destination_port >> 8;
+    udp[3] = destination_port & 0xff;
+    udp[5] = FRAME_LENGTH - 34;
+    uint8_t *dns = udp + 8;
+    dns[0] = query->id >> 8;
+    dns[1] = query->id & 0xff;
+    dns[2] = response ? 0x81 : 0x01;
+    dns[5] = 1;
+    memcpy(dns + 12, "\x03www\x07" "example\x03" "com", 17);
+    // a different name per query
+    memcpy(dns + 13, &query->qname_hash, 3);
+    dns[30] = 1;        // A, IN
+    dns[32] = 1;
+}
+
+int
+main(int argc, char **argv)
+{
+    uint32_t queries = (argc > 1) ? atol(argv[1]) : 4000000;
+    const uint32_t in_flight_counts[] = {100, 10000, 50000};
+
+    bench_query_t *trace = (bench_query_t*)malloc((size_t)queries * sizeof(bench_query_t));
+    uint64_t state = 88172645463325252ull;
+    for (uint32_t i = 0; i < queries; i++){
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        bench_query_t *query = &trace[i];
+        uint32_t client = i % 65536;
+        query->client[0] = 10;
+        query->client[1] = client >> 16;
+        query->client[2] = client >> 8;
+        query->client[3] = client;
+        query->server[0] = 192;
+        query->server[1] = 168;
+        query->server[2] = 0;
+        query->server[3] = state % 64;
+        query->port = 1024 + (state >> 8) % 60000;
+        query->id = state >> 32;
+        query->qname_hash = (uint32_t)(state >> 16);
+    }
+    uint8_t *frames = (uint8_t*)malloc((size_t)queries * 2 * FRAME_LENGTH);
+    for (uint32_t i = 0; i < queries; i++){
+        build_frame(frames + (size_t)i * 2 * FRAME_LENGTH, &trace[i], false);
+        build_frame(frames + ((size_t)i * 2 + 1) * FRAME_LENGTH, &trace[i], true);
+    }
+
+    arena_t arena;
+    arena_init(&arena, 0);
+    dissection_t dissection = {};
+
+    printf("%-8s %-10s %12s %12s %12s %10s %10s\n", "path", "in flight", "Mqueries/s", "ns/message", "answered",
+        "timeouts", "p99 us");
+    for (uint32_t frames_path = 0; frames_path < 2; frames_path++){
+        for (uint32_t in_flight : in_flight_counts){
+            dns_tracker_t *tracker = dns_tracker_create(in_flight * 2 + 10000, 0);
+            dns_message_t message;
+            memset(&message, 0, sizeof(message));
+            message.version = 4;
+
+            double start = now_seconds();
+            for (uint32_t i = 0; i < queries + in_flight; i++){
+                // 10 microseconds between queries, the answer in_flight queries later
+                uint64_t timestamp = (uint64_t)i * 10;
+                for (uint32_t response = 0; response < 2; response++){
+                    if ((response == 0 && i >= queries) || (response == 1 && (i < in_flight || (i - in_flight) % 100 == 99))){
+                        continue;
+                    }
+                    uint32_t number = response ? i - in_flight : i;
+                    if (frames_path){
+                        const uint8_t *frame = frames + ((size_t)number * 2 + response) * FRAME_LENGTH;
+                        arena_reset(&arena);
+                        dissection.timestamp = timestamp;
+                        dissect(frame, FRAME_LENGTH, LAYER_KEYS | LAYER_BIT(LAYER_DNS), &arena, false, &dissection);
+                        dns_tracker_update(tracker, &dissection);
+                        continue;
+                    }
+                    const bench_query_t *query = &trace[number];
+                    message.source = response ? query->server : query->client;
+                    message.destination = response ? query->client : query->server;
+                    message.source_port = response ? 53 : query->port;
+                    message.destination_port = response ? query->port : 53;
+                    message.id = query->id;
+                    message.response = response;
+                    message.qname_hash = query->qname_hash;
+                    message.timestamp = timestamp;
+                    dns_tracker_add(tracker, &message);
+                }
+            }
+            double elapsed = now_seconds() - start;
+
+            printf("%-8s %-10u %12.2f %12.1f %12llu %10llu %10llu\n", frames_path ? "frames" : "messages",
+                in_flight, tracker->queries / elapsed / 1e6, elapsed / (tracker->queries + tracker->responses) * 1e9,
+                (unsigned long long)tracker->answered, (unsigned long long)tracker->timeouts,
+                (unsigned long long)histogram_percentile(&tracker->latency, 99));
+            dns_tracker_destroy(tracker);
+        }
+    }
+    arena_destroy(&arena);
+    free(frames);
+    free(trace);
+    return 0;
+}
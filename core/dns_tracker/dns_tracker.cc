@@ -0,0 +1,418 @@
+#include "dns_tracker.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include "dissector.h"
+
+static_assert(sizeof(dns_query_key_t) == 48, "the key is hashed as 6 words");
+
+static uint32_t
+dns_key_hash(const dns_query_key_t *key)
+{
+    uint64_t words[sizeof(dns_query_key_t) / 8];
+    memcpy(words, key, sizeof(words));
+    uint64_t hash = 0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++){
+        hash = (hash ^ words[i]) * 0xff51afd7ed558ccdull;
+        hash ^= hash >> 32;
+    }
+    return (uint32_t)hash;
+}
+
+static uint32_t
+dns_address_hash(const uint8_t *address, uint8_t version)
+{
+    uint64_t words[2];
+    memcpy(words, address, sizeof(words));
+    uint64_t hash = (words[0] * 0x9e3779b97f4a7c15ull) ^ (words[1] + version);
+    hash *= 0xff51afd7ed558ccdull;
+    return (uint32_t)(hash >> 32);
+}
+
+/**
+ * @brief FNV-1a of the first question's name, lowercase, labels and
+ * lengths as they are on the wire, up to its final 0. A name cut by the
+ * capture is hashed as far as it goes, the same in the query and the
+ * response.
+ *
+ * @param dns
+ * @param length
+ * @return uint32_t
+ */
+static uint32_t
+dns_qname_hash(const uint8_t *dns, uint32_t length)
+{
+    uint32_t hash = 2166136261u;
+    uint32_t end = (length < DNS_HEADER_SIZE + DNS_NAME_MAX_SIZE) ? length : DNS_HEADER_SIZE + DNS_NAME_MAX_SIZE;
+    for (uint32_t offset = DNS_HEADER_SIZE; offset < end; offset++){
+        uint8_t byte = dns[offset];
+        // lengths are under 64, the letters fold to lowercase
+        if ((uint8_t)(byte - 'A') < 26){
+            byte += 'a' - 'A';
+        }
+        hash = (hash ^ byte) * 16777619u;
+        if (byte == 0){
+            break;
+        }
+    }
+    return hash;
+}
+
+/**
+ * @brief Allocate the pool of pending queries, their index and the server table
+ *
+ * @param capacity queries pending at once, DNS_TRACKER_CAPACITY if 0
+ * @param timeout microseconds a query waits for its response, DNS_TRACKER_TIMEOUT if 0
+ * @return dns_tracker_t*
+ */
+dns_tracker_t*
+dns_tracker_create(uint32_t capacity, uint64_t timeout)
+{
+    dns_tracker_t *tracker = (dns_tracker_t*)calloc(1, sizeof(dns_tracker_t));
+    if (tracker == NULL){
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    tracker->capacity = capacity > 0 ? capacity : DNS_TRACKER_CAPACITY;
+    tracker->timeout = timeout > 0 ? timeout : DNS_TRACKER_TIMEOUT;
+    uint32_t slots = 2;
+    while (slots < tracker->capacity * 2){
+        slots *= 2;
+    }
+    tracker->index_mask = slots - 1;
+    tracker->pending = (dns_pending_t*)calloc(tracker->capacity, sizeof(dns_pending_t));
+    tracker->index = (uint32_t*)malloc((size_t)slots * sizeof(uint32_t));
+    tracker->servers = (dns_server_t*)calloc(DNS_TRACKER_SERVERS + 1, sizeof(dns_server_t));
+    if (tracker->pending == NULL || tracker->index == NULL || tracker->servers == NULL){
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    memset(tracker->index, 0xff, (size_t)slots * sizeof(uint32_t));
+    memset(tracker->server_index, 0xff, sizeof(tracker->server_index));
+
+    for (uint32_t i = 0; i < tracker->capacity; i++){
+        tracker->pending[i].next = (i + 1 < tracker->capacity) ? i + 1 : DNS_NONE;
+    }
+    tracker->free_head = 0;
+    tracker->oldest = DNS_NONE;
+    tracker->newest = DNS_NONE;
+
+    for (uint32_t i = 0; i <= DNS_TRACKER_SERVERS; i++){
+        histogram_init(&tracker->servers[i].latency);
+    }
+    histogram_init(&tracker->latency);
+    for (uint32_t i = 0; i < DNS_RCODES; i++){
+        histogram_init(&tracker->rcode_latency[i]);
+    }
+    return tracker;
+}
+
+void
+dns_tracker_destroy(dns_tracker_t *tracker)
+{
+    free(tracker->pending);
+    free(tracker->index);
+    free(tracker->servers);
+    free(tracker);
+}
+
+// the slot of the key in the index, or the empty one ending its probe
+static uint32_t
+dns_index_find(const dns_tracker_t *tracker, const dns_query_key_t *key, uint32_t hash)
+{
+    uint32_t slot = hash & tracker->index_mask;
+    for (;;){
+        uint32_t index = tracker->index[slot];
+        if (index == DNS_NONE){
+            return slot;
+        }
+        const dns_pending_t *query = &tracker->pending[index];
+        if (query->hash == hash && memcmp(&query->key, key, sizeof(dns_query_key_t)) == 0){
+            return slot;
+        }
+        slot = (slot + 1) & tracker->index_mask;
+    }
+}
+
+// empty the slot, the queries probed past it move back into the hole
+static void
+dns_index_delete(dns_tracker_t *tracker, uint32_t slot)
+{
+    uint32_t mask = tracker->index_mask;
+    uint32_t hole = slot;
+    for (uint32_t i = (slot + 1) & mask; tracker->index[i] != DNS_NONE; i = (i + 1) & mask){
+        uint32_t home = tracker->pending[tracker->index[i]].hash & mask;
+        // it can move if the hole is between its home and it
+        if (((i - home) & mask) >= ((i - hole) & mask)){
+            tracker->index[hole] = tracker->index[i];
+            hole = i;
+        }
+    }
+    tracker->index[hole] = DNS_NONE;
+}
+
+/**
+ * @brief Take a query out of the index and the queue, back to the free list
+ *
+ * @param tracker
+ * @param index in the pool
+ * @param slot in the index, DNS_NONE to look for it
+ */
+static void
+dns_pending_remove(dns_tracker_t *tracker, uint32_t index, uint32_t slot)
+{
+    dns_pending_t *query = &tracker->pending[index];
+    if (slot == DNS_NONE){
+        slot = query->hash & tracker->index_mask;
+        while (tracker->index[slot] != index){
+            slot = (slot + 1) & tracker->index_mask;
+        }
+    }
+    dns_index_delete(tracker, slot);
+
+    if (query->prev != DNS_NONE){
+        tracker->pending[query->prev].next = query->next;
+    } else {
+        tracker->oldest = query->next;
+    }
+    if (query->next != DNS_NONE){
+        tracker->pending[query->next].prev = query->prev;
+    } else {
+        tracker->newest = query->prev;
+    }
+    query->next = tracker->free_head;
+    tracker->free_head = index;
+    tracker->count--;
+}
+
+// the server's entry, a new one while there is room, "other" after
+static uint32_t
+dns_tracker_server(dns_tracker_t *tracker, uint8_t version, const uint8_t *address)
+{
+    const uint32_t mask = DNS_TRACKER_SERVERS * 2 - 1;
+    uint32_t slot = dns_address_hash(address, version) & mask;
+    for (;;){
+        uint32_t server = tracker->server_index[slot];
+        if (server == DNS_NONE){
+            break;
+        }
+        if (tracker->servers[server].version == version && memcmp(tracker->servers[server].address, address, 16) == 0){
+            return server;
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (tracker->server_count == DNS_TRACKER_SERVERS){
+        return DNS_TRACKER_SERVERS;
+    }
+    uint32_t server = tracker->server_count++;
+    memcpy(tracker->servers[server].address, address, 16);
+    tracker->servers[server].version = version;
+    tracker->server_index[slot] = server;
+    return server;
+}
+
+/**
+ * @brief Give up the queries waiting for longer than the timeout
+ *
+ * @param tracker
+ * @param now capture time, microseconds
+ */
+void
+dns_tracker_expire(dns_tracker_t *tracker, uint64_t now)
+{
+    while (tracker->oldest != DNS_NONE){
+        uint32_t index = tracker->oldest;
+        dns_pending_t *query = &tracker->pending[index];
+        if (query->timestamp + tracker->timeout >= now){
+            break;
+        }
+        tracker->timeouts++;
+        tracker->servers[query->server].timeouts++;
+        dns_pending_remove(tracker, index, DNS_NONE);
+    }
+}
+
+/**
+ * @brief A query waits for its response, a response is matched to its
+ * query and its latency recorded
+ *
+ * @param tracker
+ * @param message
+ */
+void
+dns_tracker_add(dns_tracker_t *tracker, const dns_message_t *message)
+{
+    dns_tracker_expire(tracker, message->timestamp);
+
+    dns_query_key_t key;
+    memset(&key, 0, sizeof(key));
+    size_t address_length = (message->version == 4) ? 4 : 16;
+    memcpy(key.client, message->response ? message->destination : message->source, address_length);
+    memcpy(key.server, message->response ? message->source : message->destination, address_length);
+    key.client_port = message->response ? message->destination_port : message->source_port;
+    key.id = message->id;
+    key.qname_hash = message->qname_hash;
+    key.version = message->version;
+    uint32_t hash = dns_key_hash(&key);
+    uint32_t slot = dns_index_find(tracker, &key, hash);
+    uint32_t index = tracker->index[slot];
+
+    if (!message->response){
+        tracker->queries++;
+        if (index != DNS_NONE){
+            tracker->retransmitted++;
+            return;
+        }
+        uint32_t server = dns_tracker_server(tracker, message->version, key.server);
+        tracker->servers[server].queries++;
+        if (tracker->free_head == DNS_NONE){
+            uint32_t oldest = tracker->oldest;
+            tracker->evicted++;
+            tracker->servers[tracker->pending[oldest].server].timeouts++;
+            dns_pending_remove(tracker, oldest, DNS_NONE);
+            // the queries moved back, the empty slot with them
+            slot = dns_index_find(tracker, &key, hash);
+        }
+        index = tracker->free_head;
+        dns_pending_t *query = &tracker->pending[index];
+        tracker->free_head = query->next;
+        query->key = key;
+        query->hash = hash;
+        query->server = server;
+        query->timestamp = message->timestamp;
+        query->prev = tracker->newest;
+        query->next = DNS_NONE;
+        if (tracker->newest != DNS_NONE){
+            tracker->pending[tracker->newest].next = index;
+        } else {
+            tracker->oldest = index;
+        }
+        tracker->newest = index;
+        tracker->index[slot] = index;
+        tracker->count++;
+        return;
+    }
+
+    tracker->responses++;
+    if (index == DNS_NONE){
+        tracker->unmatched++;
+        return;
+    }
+    dns_pending_t *query = &tracker->pending[index];
+    // the capture can go back in time a little
+    uint64_t latency = (message->timestamp > query->timestamp) ? message->timestamp - query->timestamp : 0;
+    histogram_record(&tracker->latency, latency);
+    histogram_record(&tracker->rcode_latency[message->rcode & 0x0f], latency);
+    dns_server_t *server = &tracker->servers[query->server];
+    server->answered++;
+    histogram_record(&server->latency, latency);
+    tracker->answered++;
+    dns_pending_remove(tracker, index, slot);
+}
+
+/**
+ * @brief Read what the tracker needs of a DNS message: the header and the
+ * first question's name
+ *
+ * @param dns
+ * @param length bytes captured
+ * @param message the addresses, ports and timestamp are left as they are
+ * @return false if the header isn't whole
+ */
+bool
+dns_message_read(const uint8_t *dns, uint32_t length, dns_message_t *message)
+{
+    if (length < DNS_HEADER_SIZE){
+        return false;
+    }
+    message->id = packet_load_u16(dns);
+    message->response = (dns[2] >> 7) == QR_RESPONSE;
+    message->rcode = dns[3] & 0x0f;
+    message->qname_hash = (packet_load_u16(dns + 4) > 0) ? dns_qname_hash(dns, length) : 0;
+    return true;
+}
+
+/**
+ * @brief The DNS message of a dissection, over UDP to or from port 53
+ *
+ * @param dissection decoded with LAYER_KEYS and LAYER_DNS at least, its
+ * timestamp set
+ * @param message its addresses point into the packet
+ * @return false if the packet isn't DNS over UDP
+ */
+bool
+dns_message_from_dissection(const dissection_t *dissection, dns_message_t *message)
+{
+    // the dissector links UDP to DNS from port 53 and to it
+    if (!dissection_has(dissection, LAYER_DNS) || dissection->ip_protocol != IPPROTO_UDP){
+        return false;
+    }
+    message->version = dissection->ip_version;
+    message->source = dissection->source_address;
+    message->destination = dissection->destination_address;
+    message->source_port = dissection->source_port;
+    message->destination_port = dissection->destination_port;
+    message->timestamp = dissection->timestamp;
+    // the DNS message, up to the UDP length
+    return dns_message_read(dissection->payload.data, dissection->payload.remaining, message);
+}
+
+/**
+ * @brief Same as dns_tracker_add(), from a dissection
+ *
+ * @param tracker
+ * @param dissection as dns_message_from_dissection()
+ * @return false if the packet isn't DNS over UDP
+ */
+bool
+dns_tracker_update(dns_tracker_t *tracker, const dissection_t *dissection)
+{
+    dns_message_t message;
+    if (!dns_message_from_dissection(dissection, &message)){
+        tracker->untracked++;
+        return false;
+    }
+    dns_tracker_add(tracker, &message);
+    return true;
+}
+
+/**
+ * @brief Add the counts and the response times of another tracker, its
+ * servers to the same ones. The queries pending in it aren't carried
+ * over: each side only matched its own.
+ *
+ * @param tracker
+ * @param other
+ */
+void
+dns_tracker_merge(dns_tracker_t *tracker, const dns_tracker_t *other)
+{
+    for (uint32_t index = 0; index <= DNS_TRACKER_SERVERS; index++){
+        const dns_server_t *from = &other->servers[index];
+        if (index < DNS_TRACKER_SERVERS && index >= other->server_count){
+            continue;
+        }
+        // "other" stays "other"
+        uint32_t server = (index == DNS_TRACKER_SERVERS) ? DNS_TRACKER_SERVERS
+            : dns_tracker_server(tracker, from->version, from->address);
+        dns_server_t *to = &tracker->servers[server];
+        to->queries += from->queries;
+        to->answered += from->answered;
+        to->timeouts += from->timeouts;
+        histogram_merge(&to->latency, &from->latency);
+    }
+    histogram_merge(&tracker->latency, &other->latency);
+    for (uint32_t rcode = 0; rcode < DNS_RCODES; rcode++){
+        histogram_merge(&tracker->rcode_latency[rcode], &other->rcode_latency[rcode]);
+    }
+    tracker->queries += other->queries;
+    tracker->responses += other->responses;
+    tracker->answered += other->answered;
+    tracker->unmatched += other->unmatched;
+    tracker->retransmitted += other->retransmitted;
+    tracker->timeouts += other->timeouts;
+    tracker->evicted += other->evicted;
+    tracker->untracked += other->untracked;
+}
@@ -0,0 +1,145 @@
+#ifndef DNS_TRACKER_H
+#define DNS_TRACKER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "histogram.h"
+
+/*
+DNS queries paired with their responses, to measure how long the servers
+take to answer.
+
+A query waits in a pool until its response comes back with the same key:
+
+    (client, server, client port, transaction id, qname)
+
+the addresses and the port swapped. The qname is the first question's
+name as it is on the wire, folded to lowercase and hashed: servers echo
+the question back, its case randomized (0x20 bits) or not.
+
+A response matching a pending query records the time between them, in
+microseconds of capture time, to the latency histograms of all the
+responses, of its rcode and of its server. The pending queries are queued
+in arrival order:
+
+    oldest -> ... -> newest      (prev / next through the pool indexes)
+
+as the capture time goes on, the ones waiting for longer than the timeout
+are given up (timed out, counted against their server); when the pool is
+full the oldest is evicted. The memory is the pool, its index and the
+server table, allocated once. A query seen again while it is pending is a
+retransmission: the first one is kept, the latency counts from it.
+
+The index is an open addressing table of pool indexes, twice as many slots
+as the pool, probed linearly; a query leaving it shifts the following ones
+back (no tombstones, the probes stay short however long the capture).
+
+The servers are in a table of DNS_TRACKER_SERVERS, with their own smaller
+index; once it is full, the new ones share the last entry, "other".
+
+The messages are read from the dissection of their packet (LAYER_KEYS and
+LAYER_DNS, the payload up to the UDP length). A tracker per thread pairs
+what its thread decodes, both ways of a flow go to the same one; their
+counts and histograms merge at the end.
+*/
+
+#define DNS_TRACKER_CAPACITY (1 << 16)              // queries pending at once
+#define DNS_TRACKER_TIMEOUT (5ull * 1000000)        // 5 seconds, as most stub resolvers
+#define DNS_TRACKER_SERVERS 256
+#define DNS_RCODES 16
+#define DNS_NONE UINT32_MAX
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct dissection;
+
+// one DNS message of the capture, what the tracker needs of it
+typedef struct dns_message {
+    uint8_t version;                // 4 or 6
+    const uint8_t *source;          // 4 or 16 bytes
+    const uint8_t *destination;
+    uint16_t source_port;
+    uint16_t destination_port;
+    uint16_t id;
+    bool response;                  // qr
+    uint8_t rcode;
+    uint32_t qname_hash;            // 0 without a question
+    uint64_t timestamp;             // microseconds
+} dns_message_t;
+
+typedef struct dns_query_key {
+    uint8_t client[16];             // IPv4 in the first 4 bytes, the rest 0
+    uint8_t server[16];
+    uint16_t client_port;
+    uint16_t id;
+    uint32_t qname_hash;
+    uint8_t version;
+    uint8_t padding[7];             // zero, keys are compared with memcmp
+} dns_query_key_t;
+
+typedef struct dns_pending {
+    dns_query_key_t key;
+    uint32_t hash;
+    uint32_t server;                // in the server table
+    uint32_t prev;                  // towards the oldest
+    uint32_t next;                  // towards the newest, next free when unused
+    uint64_t timestamp;
+} dns_pending_t;
+
+typedef struct dns_server {
+    uint8_t address[16];
+    uint8_t version;                // 0 for "other"
+    uint64_t queries;
+    uint64_t answered;
+    uint64_t timeouts;              // evicted ones included
+    histogram_t latency;
+} dns_server_t;
+
+typedef struct dns_tracker {
+    dns_pending_t *pending;         // the pool
+    uint32_t capacity;
+    uint32_t *index;                // pool indexes, DNS_NONE when empty
+    uint32_t index_mask;
+    uint32_t free_head;
+    uint32_t oldest;
+    uint32_t newest;
+    uint32_t count;                 // pending
+    uint64_t timeout;
+
+    dns_server_t *servers;          // DNS_TRACKER_SERVERS + 1, "other" last
+    uint32_t server_count;
+    uint32_t server_index[DNS_TRACKER_SERVERS * 2];
+
+    histogram_t latency;            // every response matched
+    histogram_t rcode_latency[DNS_RCODES];
+
+    uint64_t queries;
+    uint64_t responses;
+    uint64_t answered;              // responses matched to their query
+    uint64_t unmatched;             // responses to no query pending
+    uint64_t retransmitted;         // queries pending already
+    uint64_t timeouts;
+    uint64_t evicted;               // given up for room
+    uint64_t untracked;             // packets not DNS over UDP
+} dns_tracker_t;
+
+dns_tracker_t* dns_tracker_create(uint32_t capacity, uint64_t timeout);
+void dns_tracker_destroy(dns_tracker_t *tracker);
+
+bool dns_message_read(const uint8_t *dns, uint32_t length, dns_message_t *message);
+bool dns_message_from_dissection(const struct dissection *dissection, dns_message_t *message);
+
+void dns_tracker_add(dns_tracker_t *tracker, const dns_message_t *message);
+bool dns_tracker_update(dns_tracker_t *tracker, const struct dissection *dissection);
+void dns_tracker_expire(dns_tracker_t *tracker, uint64_t now);
+void dns_tracker_merge(dns_tracker_t *tracker, const dns_tracker_t *other);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
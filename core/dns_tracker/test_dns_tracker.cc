@@ -0,0 +1,266 @@
+#include "dns_tracker.h"
+#include "dissector.h"
+#include <cassert>
+#include <cstring>
+#include <netinet/in.h>
+
+#define MILLISECOND 1000ull
+
+static const uint8_t client[4] = {10, 0, 0, 1};
+static const uint8_t server[4] = {10, 0, 0, 53};
+
+// a query from 10.0.0.1:40000 to 10.0.0.53:53, or its response
+dns_message_t
+make_message(bool response, uint16_t id, uint32_t qname_hash, uint64_t timestamp)
+{
+    dns_message_t message;
+    memset(&message, 0, sizeof(message));
+    message.version = 4;
+    message.source = response ? server : client;
+    message.destination = response ? client : server;
+    message.source_port = response ? 53 : 40000;
+    message.destination_port = response ? 40000 : 53;
+    message.id = id;
+    message.response = response;
+    message.qname_hash = qname_hash;
+    message.timestamp = timestamp;
+    return message;
+}
+
+void
+add(dns_tracker_t *tracker, bool response, uint16_t id, uint64_t timestamp)
+{
+    dns_message_t message = make_message(response, id, 1234, timestamp);
+    dns_tracker_add(tracker, &message);
+}
+
+void
+test_match()
+{
+    dns_tracker_t *tracker = dns_tracker_create(16, 0);
+    add(tracker, false, 1, 1000 * MILLISECOND);
+    add(tracker, false, 2, 1001 * MILLISECOND);
+    assert(tracker->count == 2);
+
+    // answered out of order, the second one with NXDOMAIN
+    dns_message_t response = make_message(true, 2, 1234, 1011 * MILLISECOND);
+    response.rcode = 3;
+    dns_tracker_add(tracker, &response);
+    add(tracker, true, 1, 1030 * MILLISECOND);
+    assert(tracker->answered == 2 && tracker->count == 0);
+    assert(tracker->latency.count == 2);
+    assert(tracker->latency.min == 10 * MILLISECOND && tracker->latency.max == 30 * MILLISECOND);
+    assert(tracker->rcode_latency[0].count == 1 && tracker->rcode_latency[3].count == 1);
+    assert(tracker->server_count == 1);
+    assert(tracker->servers[0].queries == 2 && tracker->servers[0].answered == 2);
+    assert(memcmp(tracker->servers[0].address, server, 4) == 0 && tracker->servers[0].version == 4);
+
+    // another question, another port: not theirs
+    add(tracker, false, 3, 1100 * MILLISECOND);
+    dns_message_t other = make_message(true, 3, 99, 1101 * MILLISECOND);
+    dns_tracker_add(tracker, &other);
+    other = make_message(true, 3, 1234, 1101 * MILLISECOND);
+    other.destination_port = 40001;
+    dns_tracker_add(tracker, &other);
+    assert(tracker->unmatched == 2 && tracker->count == 1);
+
+    // sent twice, the latency from the first one
+    add(tracker, false, 3, 1200 * MILLISECOND);
+    assert(tracker->retransmitted == 1);
+    add(tracker, true, 3, 1300 * MILLISECOND);
+    assert(tracker->latency.max == 200 * MILLISECOND);
+    dns_tracker_destroy(tracker);
+}
+
+void
+test_timeouts()
+{
+    dns_tracker_t *tracker = dns_tracker_create(4, 2000 * MILLISECOND);
+    add(tracker, false, 1, 1000 * MILLISECOND);
+    add(tracker, false, 2, 2000 * MILLISECOND);
+    // the first one waited for more than 2 seconds
+    add(tracker, false, 3, 3001 * MILLISECOND);
+    assert(tracker->timeouts == 1 && tracker->count == 2);
+    add(tracker, true, 1, 3002 * MILLISECOND);
+    assert(tracker->unmatched == 1);
+
+    // full, the oldest makes room
+    add(tracker, false, 4, 3003 * MILLISECOND);
+    add(tracker, false, 5, 3004 * MILLISECOND);
+    add(tracker, false, 6, 3005 * MILLISECOND);
+    assert(tracker->evicted == 1 && tracker->count == 4);
+    add(tracker, true, 2, 3006 * MILLISECOND);
+    assert(tracker->unmatched == 2);
+    add(tracker, true, 3, 3007 * MILLISECOND);
+    assert(tracker->answered == 1);
+    assert(tracker->servers[0].timeouts == 2);
+    dns_tracker_destroy(tracker);
+}
+
+void
+test_index()
+{
+    // a small index, the queries answered in a scrambled order
+    const uint32_t count = 1000;
+    dns_tracker_t *tracker = dns_tracker_create(count, 0);
+    for (uint32_t round = 0; round < 3; round++){
+        for (uint32_t id = 0; id < count; id++){
+            add(tracker, false, id, 1000 * MILLISECOND);
+        }
+        assert(tracker->count == count && tracker->evicted == 0);
+        for (uint32_t i = 0; i < count; i++){
+            add(tracker, true, (i * 617 + round) % count, 1001 * MILLISECOND);
+        }
+        assert(tracker->count == 0);
+        assert(tracker->answered == (round + 1) * count && tracker->unmatched == 0);
+    }
+    for (uint32_t slot = 0; slot <= tracker->index_mask; slot++){
+        assert(tracker->index[slot] == DNS_NONE);
+    }
+    dns_tracker_destroy(tracker);
+}
+
+void
+test_servers()
+{
+    dns_tracker_t *tracker = dns_tracker_create(16, 0);
+    for (uint32_t i = 0; i < DNS_TRACKER_SERVERS + 10; i++){
+        uint8_t address[4] = {192, 168, (uint8_t)(i >> 8), (uint8_t)i};
+        dns_message_t query = make_message(false, 7, 1, 1000 * MILLISECOND);
+        query.destination = address;
+        dns_tracker_add(tracker, &query);
+    }
+    // the ones past the table share the last entry
+    assert(tracker->server_count == DNS_TRACKER_SERVERS);
+    assert(tracker->servers[DNS_TRACKER_SERVERS].queries == 10);
+    assert(tracker->servers[DNS_TRACKER_SERVERS - 1].queries == 1);
+    dns_tracker_destroy(tracker);
+}
+
+// Ethernet, IPv4, UDP, DNS with one question
+uint32_t
+build_frame(uint8_t *frame, bool response, const char *qname)
+{
+    static const uint8_t headers[] = {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0x08, 0x00,
+        0x45, 0x00, 0x00, 0x00, 0x12, 0x34, 0x00, 0x00, 0x40, 0x11, 0x00, 0x00,
+        0x0a, 0x00, 0x00, 0x01, 0x0a, 0x00, 0x00, 0x35,
+        0x9c, 0x40, 0x00, 0x35, 0x00, 0x00, 0x00, 0x00,
+        0xbe, 0xef, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    };
+    memcpy(frame, headers, sizeof(headers));
+    uint32_t length = sizeof(headers);
+    memcpy(frame + length, qname, strlen(qname) + 1);
+    length += strlen(qname) + 1;
+    const uint8_t question[] = {0x00, 0x01, 0x00, 0x01};
+    memcpy(frame + length, question, sizeof(question));
+    length += sizeof(question);
+    if (response){
+        // addresses and ports swapped, qr set, NXDOMAIN
+        uint8_t swap[4];
+        memcpy(swap, frame + 26, 4);
+        memcpy(frame + 26, frame + 30, 4);
+        memcpy(frame + 30, swap, 4);
+        frame[34] = 0x00;
+        frame[35] = 0x35;
+        frame[36] = 0x9c;
+        frame[37] = 0x40;
+        frame[44] = 0x81;
+        frame[45] = 0x83;
+    }
+    // IPv4 total length, UDP length
+    frame[16] = (length - 14) >> 8;
+    frame[17] = (length - 14) & 0xff;
+    frame[38] = (length - 34) >> 8;
+    frame[39] = (length - 34) & 0xff;
+    return length;
+}
+
+// the packet dissected as the CLI does for --dns
+void
+dissect_frame(const uint8_t *frame, uint32_t length, uint64_t timestamp, arena_t *arena, dissection_t *dissection)
+{
+    arena_reset(arena);
+    dissection->timestamp = timestamp;
+    dissect(frame, length, LAYER_KEYS | LAYER_BIT(LAYER_DNS), arena, false, dissection);
+}
+
+void
+test_packets()
+{
+    dns_tracker_t *tracker = dns_tracker_create(16, 0);
+    arena_t arena;
+    arena_init(&arena, 0);
+    dissection_t dissection = {};
+    uint8_t frame[128];
+    dns_message_t message;
+
+    uint32_t length = build_frame(frame, false, "\x03www\x07" "example\x03" "com");
+    dissect_frame(frame, length, 1000 * MILLISECOND, &arena, &dissection);
+    assert(dns_message_from_dissection(&dissection, &message));
+    assert(!message.response && message.id == 0xbeef && message.source_port == 40000);
+    assert(message.version == 4 && message.destination[3] == 53 && message.timestamp == 1000 * MILLISECOND);
+    uint32_t query_hash = message.qname_hash;
+    assert(query_hash != 0);
+    assert(dns_tracker_update(tracker, &dissection));
+
+    // the case randomized by the resolver, the same question; from port
+    // 53, padded by the link
+    length = build_frame(frame, true, "\x03WwW\x07" "exAMPle\x03" "COM");
+    memset(frame + length, 0xff, 16);
+    dissect_frame(frame, length + 16, 1004 * MILLISECOND, &arena, &dissection);
+    assert(dissection.payload.remaining == length - 42);
+    assert(dns_message_from_dissection(&dissection, &message));
+    assert(message.response && message.rcode == 3 && message.qname_hash == query_hash);
+    assert(dns_tracker_update(tracker, &dissection));
+    assert(tracker->answered == 1 && tracker->rcode_latency[3].count == 1);
+
+    length = build_frame(frame, false, "\x03www\x07" "example\x03" "org");
+    dissect_frame(frame, length, 1005 * MILLISECOND, &arena, &dissection);
+    assert(dns_message_from_dissection(&dissection, &message) && message.qname_hash != query_hash);
+
+    // not DNS: another port, a header cut short
+    frame[37] = 0x50;
+    dissect_frame(frame, length, 1005 * MILLISECOND, &arena, &dissection);
+    assert(!dns_tracker_update(tracker, &dissection));
+    frame[37] = 0x35;
+    dissect_frame(frame, 14 + 20 + 8 + 6, 1005 * MILLISECOND, &arena, &dissection);
+    assert(!dns_tracker_update(tracker, &dissection));
+    assert(tracker->untracked == 2);
+    arena_destroy(&arena);
+    dns_tracker_destroy(tracker);
+}
+
+void
+test_merge()
+{
+    dns_tracker_t *first = dns_tracker_create(16, 0);
+    dns_tracker_t *second = dns_tracker_create(16, 0);
+    add(first, false, 1, 1000 * MILLISECOND);
+    add(first, true, 1, 1003 * MILLISECOND);
+    add(second, false, 2, 1000 * MILLISECOND);
+    add(second, true, 2, 1007 * MILLISECOND);
+    // pending in the second one, only counted
+    add(second, false, 3, 1008 * MILLISECOND);
+
+    dns_tracker_merge(first, second);
+    assert(first->queries == 3 && first->answered == 2 && first->count == 0);
+    assert(first->latency.count == 2 && first->latency.max == 7 * MILLISECOND);
+    // the same server in both
+    assert(first->server_count == 1);
+    assert(first->servers[0].queries == 3 && first->servers[0].answered == 2);
+    assert(first->servers[0].latency.count == 2);
+    dns_tracker_destroy(first);
+    dns_tracker_destroy(second);
+}
+
+int main()
+{
+    test_match();
+    test_timeouts();
+    test_index();
+    test_servers();
+    test_packets();
+    test_merge();
+    return 0;
+}
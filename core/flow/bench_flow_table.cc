@@ -0,0 +1,87 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <netinet/in.h>
+#include "flow_table.h"
+
+/*
+Packets per second through flow_table_update, for a growing number of
+distinct flows: ethernet + ipv4 + tcp frames picked at random among them,
+so the bigger tables miss the cache like a busy link would.
+
+usage: bench_flow_table [packets]
+*/
+
+#define FRAME_LENGTH 54
+
+double
+now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void
+build_frame(uint8_t *frame, uint32_t flow)
+{
+    memset(frame, 0, FRAME_LENGTH);
+    frame[12] = 0x08;
+    uint8_t *ip = frame + 14;
+    ip[0] = 0x45;
+    ip[3] = 40;
+    ip[9] = IPPROTO_TCP;
+    uint32_t src = htonl(0x0a000000 | (flow >> 8));
+    uint32_t dst = htonl(0xc0a80000 | (flow & 0xff));
+    memcpy(ip + 12, &src, 4);
+    memcpy(ip + 16, &dst, 4);
+    uint8_t *tcp = ip + 20;
+    uint16_t port = 1024 + (flow % 50000);
+    tcp[0] = port >> 8;
+    tcp[1] = port & 0xff;
+    tcp[3] = 80;
+    tcp[12] = 5 << 4;
+    tcp[13] = 0x10;
+}
+
+int
+main(int argc, char **argv)
+{
+    long packets = (argc > 1) ? atol(argv[1]) : 10000000;
+    const uint32_t flow_counts[] = {1000, 100000, 1000000, 4000000};
+
+    printf("%-10s %12s %12s %12s\n", "flows", "Mpps", "ns/packet", "memory MB");
+    for (uint32_t flows : flow_counts){
+        uint8_t *frames = (uint8_t*)malloc((size_t)flows * FRAME_LENGTH);
+        for (uint32_t i = 0; i < flows; i++){
+            build_frame(frames + (size_t)i * FRAME_LENGTH, i);
+        }
+        flow_table_t *table = flow_table_create(flows, 0);
+        // first pass creates every flow
+        for (uint32_t i = 0; i < flows; i++){
+            flow_table_update(table, frames + (size_t)i * FRAME_LENGTH, FRAME_LENGTH, FRAME_LENGTH, i);
+        }
+
+        uint64_t state = 88172645463325252ull;
+        double start = now_seconds();
+        for (long i = 0; i < packets; i++){
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            const uint8_t *frame = frames + (size_t)(state % flows) * FRAME_LENGTH;
+            flow_table_update(table, frame, FRAME_LENGTH, FRAME_LENGTH, flows + i);
+        }
+        double elapsed = now_seconds() - start;
+
+        double memory = ((double)table->capacity * sizeof(flow_t)
+            + (double)(table->bucket_mask + 1) * sizeof(flow_bucket_t)) / (1 << 20);
+        printf("%-10u %12.2f %12.1f %12.1f\n", flows, packets / elapsed / 1e6, elapsed / packets * 1e9, memory);
+        if (table->count != flows){
+            fprintf(stderr, "lost flows: %u of %u\n", table->count, flows);
+        }
+        flow_table_destroy(table);
+        free(frames);
+    }
+    return 0;
+}
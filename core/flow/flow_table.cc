@@ -0,0 +1,521 @@
+#include "flow_table.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/icmp6.h>
+#include <netinet/ip.h>
+
+#include "ethernet.h"
+#include "ipv4.h"
+#include "ipv6.h"
+#include "icmp.h"
+#include "icmpv6.h"
+#include "tcp.h"
+#include "udp.h"
+
+#define FLOW_TAG_EMPTY 0
+#define FLOW_TAG_REMOVED 1
+
+static uint32_t
+flow_tag(uint32_t hash)
+{
+    return hash > FLOW_TAG_REMOVED ? hash : hash + 2;
+}
+
+/**
+ * @brief Allocate the pool and the index for capacity flows
+ *
+ * @param capacity FLOW_TABLE_CAPACITY if 0
+ * @param idle_timeout in microseconds, 0 to keep idle flows
+ * @return flow_table_t*
+ */
+flow_table_t*
+flow_table_create(uint32_t capacity, uint64_t idle_timeout)
+{
+    flow_table_t *table = (flow_table_t*)calloc(1, sizeof(flow_table_t));
+    if (table == NULL){
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    table->capacity = capacity > 0 ? capacity : FLOW_TABLE_CAPACITY;
+    table->idle_timeout = idle_timeout;
+
+    // twice as many slots as flows, probes stay short
+    uint32_t bucket_count = 1;
+    while ((uint64_t)bucket_count * FLOW_BUCKET_SLOTS < (uint64_t)table->capacity * 2){
+        bucket_count *= 2;
+    }
+    table->bucket_mask = bucket_count - 1;
+    table->buckets = (flow_bucket_t*)aligned_alloc(sizeof(flow_bucket_t), bucket_count * sizeof(flow_bucket_t));
+    table->flows = (flow_t*)calloc(table->capacity, sizeof(flow_t));
+    if (table->buckets == NULL || table->flows == NULL){
+        perror("alloc");
+        exit(EXIT_FAILURE);
+    }
+    memset(table->buckets, 0, bucket_count * sizeof(flow_bucket_t));
+
+    // every flow is free, chained through lru_next
+    for (uint32_t i = 0; i < table->capacity; i++){
+        table->flows[i].lru_next = (i + 1 < table->capacity) ? i + 1 : FLOW_NONE;
+    }
+    table->free_head = 0;
+    table->lru_head = FLOW_NONE;
+    table->lru_tail = FLOW_NONE;
+    return table;
+}
+
+void
+flow_table_destroy(flow_table_t *table)
+{
+    free(table->buckets);
+    free(table->flows);
+    free(table);
+}
+
+/**
+ * @brief Put the endpoints of the packet in the canonical key
+ *
+ * @param key
+ * @param source
+ * @param destination
+ * @param address_length 4 or 16
+ * @param source_port
+ * @param destination_port
+ * @return true if the source is endpoint a
+ */
+static bool
+flow_key_order(flow_key_t *key, const uint8_t *source, const uint8_t *destination, size_t address_length,
+    uint16_t source_port, uint16_t destination_port)
+{
+    int order = memcmp(source, destination, address_length);
+    bool from_a = order < 0 || (order == 0 && source_port <= destination_port);
+    if (from_a){
+        memcpy(key->address_a, source, address_length);
+        memcpy(key->address_b, destination, address_length);
+        key->port_a = source_port;
+        key->port_b = destination_port;
+    } else {
+        memcpy(key->address_a, destination, address_length);
+        memcpy(key->address_b, source, address_length);
+        key->port_a = destination_port;
+        key->port_b = source_port;
+    }
+    return from_a;
+}
+
+/**
+ * @brief Build the flow key of an ethernet frame, straight from the headers
+ *
+ * @param packet
+ * @param caplen
+ * @param key
+ * @param from_a set if the packet goes from endpoint a to b
+ * @param tcp_flags the packet's TCP flags, 0 if it isn't TCP
+ * @return true, false if the packet isn't IPv4 or IPv6
+ */
+bool
+flow_key_from_packet(const uint8_t *packet, uint32_t caplen, flow_key_t *key, bool *from_a, uint8_t *tcp_flags)
+{
+    my_ethernet_view_t ethernet;
+    if (!parse_ethernet_view(packet, caplen, &ethernet)){
+        return false;
+    }
+    uint16_t type = ethernet.vlan_tagged ? ethernet.type_vlan : ethernet.type;
+    const uint8_t *network = packet + ethernet.header_length;
+    uint32_t left = caplen - ethernet.header_length;
+
+    memset(key, 0, sizeof(flow_key_t));
+    *tcp_flags = 0;
+
+    const uint8_t *source, *destination, *transport;
+    size_t address_length;
+    bool has_ports = true;
+
+    if (type == ETHERTYPE_IP){
+        my_ipv4_view_t ipv4;
+        if (!parse_ipv4_view(network, left, &ipv4)){
+            return false;
+        }
+        key->version = 4;
+        key->protocol = ipv4.protocol;
+        source = ipv4.source_address;
+        destination = ipv4.destination_address;
+        address_length = 4;
+        transport = network + ipv4.header_length;
+        left -= ipv4.header_length;
+        // only the first fragment has the ports
+        has_ports = (ipv4.fragment_offset == 0);
+    } else if (type == ETHERTYPE_IPV6){
+        my_ipv6_view_t ipv6;
+        if (!parse_ipv6_view(network, left, &ipv6)){
+            return false;
+        }
+        key->version = 6;
+        key->protocol = ipv6.next_header;
+        source = ipv6.source_address;
+        destination = ipv6.destination_address;
+        address_length = IPV6_INT8_ADDR_SIZE;
+        transport = network + IPV6_HEADER_SIZE;
+        left -= IPV6_HEADER_SIZE;
+    } else {
+        return false;
+    }
+
+    uint16_t source_port = 0;
+    uint16_t destination_port = 0;
+    if (has_ports){
+        switch (key->protocol){
+            case IPPROTO_TCP: {
+                my_tcp_view_t tcp;
+                if (parse_tcp_view(transport, left, &tcp)){
+                    source_port = tcp.source_port;
+                    destination_port = tcp.destination_port;
+                    *tcp_flags = tcp.flags;
+                }
+                break;
+            }
+            case IPPROTO_UDP: {
+                my_udp_view_t udp;
+                if (parse_udp_view(transport, left, &udp)){
+                    source_port = udp.source_port;
+                    destination_port = udp.destination_port;
+                }
+                break;
+            }
+            case IPPROTO_ICMP:
+                // read in place, the view would also verify the checksum
+                if (left >= ICMP_MINLEN && (transport[0] == ICMP_ECHO || transport[0] == ICMP_ECHOREPLY)){
+                    source_port = destination_port = (transport[4] << 8) | transport[5];
+                }
+                break;
+            case IPPROTO_ICMPV6: {
+                my_icmpv6_view_t icmpv6;
+                if (parse_icmpv6_view(transport, left, &icmpv6)
+                    && (icmpv6.type == ICMP6_ECHO_REQUEST || icmpv6.type == ICMP6_ECHO_REPLY)){
+                    source_port = destination_port = icmpv6.identifier;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    *from_a = flow_key_order(key, source, destination, address_length, source_port, destination_port);
+    return true;
+}
+
+/**
+ * @brief Build the flow key of endpoints already decoded
+ *
+ * @param key
+ * @param version 4 or 6
+ * @param protocol
+ * @param source 4 or 16 bytes, as the version
+ * @param destination
+ * @param source_port
+ * @param destination_port
+ * @return true if the source is endpoint a
+ */
+bool
+flow_key_from_endpoints(flow_key_t *key, uint8_t version, uint8_t protocol, const uint8_t *source, const uint8_t *destination,
+    uint16_t source_port, uint16_t destination_port)
+{
+    memset(key, 0, sizeof(flow_key_t));
+    key->version = version;
+    key->protocol = protocol;
+    size_t address_length = (version == 4) ? 4 : IPV6_INT8_ADDR_SIZE;
+    return flow_key_order(key, source, destination, address_length, source_port, destination_port);
+}
+
+// 64x64 -> 128 bits multiply, both halves folded
+static inline uint64_t
+flow_mix(uint64_t a, uint64_t b)
+{
+    unsigned __int128 product = (unsigned __int128)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+/**
+ * @brief Hash of the key, its five 8 bytes words in two independent
+ * multiplies then a third one
+ *
+ * @param key
+ * @return uint32_t
+ */
+uint32_t
+flow_key_hash(const flow_key_t *key)
+{
+    uint64_t words[sizeof(flow_key_t) / sizeof(uint64_t)];
+    memcpy(words, key, sizeof(words));
+    uint64_t low = flow_mix(words[0] ^ 0xa0761d6478bd642full, words[1] ^ 0xe7037ed1a0b428dbull);
+    uint64_t high = flow_mix(words[2] ^ 0x8ebc6af09c88c6e3ull, words[3] ^ 0x589965cc75374cc3ull);
+    uint64_t hash = flow_mix(low ^ words[4], high ^ 0x1d8e4e27c47d124full);
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/**
+ * @brief Find the slot of key. On a miss, insert is where it would go:
+ * the first removed slot on the way, or the empty one that ended the search
+ *
+ * @param table
+ * @param key
+ * @param hash
+ * @param insert
+ * @return flow_slot_t* NULL if the key isn't there
+ */
+static flow_slot_t*
+flow_table_probe(flow_table_t *table, const flow_key_t *key, uint32_t hash, flow_slot_t **insert)
+{
+    uint32_t tag = flow_tag(hash);
+    uint32_t bucket = hash & table->bucket_mask;
+    flow_slot_t *removed = NULL;
+
+    // the table is never more than 3/4 full, an empty slot ends the search
+    while (true){
+        flow_slot_t *slots = table->buckets[bucket].slots;
+        for (int i = 0; i < FLOW_BUCKET_SLOTS; i++){
+            if (slots[i].tag == tag
+                && memcmp(&table->flows[slots[i].index].key, key, sizeof(flow_key_t)) == 0){
+                return &slots[i];
+            }
+            if (slots[i].tag == FLOW_TAG_REMOVED && removed == NULL){
+                removed = &slots[i];
+            }
+            if (slots[i].tag == FLOW_TAG_EMPTY){
+                if (insert != NULL){
+                    *insert = removed != NULL ? removed : &slots[i];
+                }
+                return NULL;
+            }
+        }
+        bucket = (bucket + 1) & table->bucket_mask;
+    }
+}
+
+static void
+flow_lru_unlink(flow_table_t *table, uint32_t index)
+{
+    flow_t *flow = &table->flows[index];
+    if (flow->lru_prev != FLOW_NONE){
+        table->flows[flow->lru_prev].lru_next = flow->lru_next;
+    } else {
+        table->lru_head = flow->lru_next;
+    }
+    if (flow->lru_next != FLOW_NONE){
+        table->flows[flow->lru_next].lru_prev = flow->lru_prev;
+    } else {
+        table->lru_tail = flow->lru_prev;
+    }
+}
+
+static void
+flow_lru_push_front(flow_table_t *table, uint32_t index)
+{
+    flow_t *flow = &table->flows[index];
+    flow->lru_prev = FLOW_NONE;
+    flow->lru_next = table->lru_head;
+    if (table->lru_head != FLOW_NONE){
+        table->flows[table->lru_head].lru_prev = index;
+    } else {
+        table->lru_tail = index;
+    }
+    table->lru_head = index;
+}
+
+// seen again since it was queued: second chance, back to the front
+static void
+flow_lru_requeue(flow_table_t *table, uint32_t index)
+{
+    flow_lru_unlink(table, index);
+    flow_lru_push_front(table, index);
+    table->flows[index].queued_seen = table->flows[index].last_seen;
+}
+
+// index every live flow again, without the removed slots
+static void
+flow_table_rebuild(flow_table_t *table)
+{
+    memset(table->buckets, 0, (table->bucket_mask + 1) * sizeof(flow_bucket_t));
+    table->removed = 0;
+    for (uint32_t index = table->lru_head; index != FLOW_NONE; index = table->flows[index].lru_next){
+        flow_t *flow = &table->flows[index];
+        flow_slot_t *insert = NULL;
+        flow_table_probe(table, &flow->key, flow->hash, &insert);
+        insert->tag = flow_tag(flow->hash);
+        insert->index = index;
+    }
+}
+
+flow_t*
+flow_table_find(flow_table_t *table, const flow_key_t *key)
+{
+    flow_slot_t *slot = flow_table_probe(table, key, flow_key_hash(key), NULL);
+    return slot != NULL ? &table->flows[slot->index] : NULL;
+}
+
+/**
+ * @brief Forget a flow, its slot in the pool is reused
+ *
+ * @param table
+ * @param flow
+ */
+void
+flow_table_remove(flow_table_t *table, flow_t *flow)
+{
+    uint32_t index = flow - table->flows;
+    if (table->on_remove != NULL){
+        table->on_remove(table->on_remove_context, table, flow);
+    }
+    flow_slot_t *slot = flow_table_probe(table, &flow->key, flow->hash, NULL);
+    slot->tag = FLOW_TAG_REMOVED;
+    table->removed++;
+
+    flow_lru_unlink(table, index);
+    flow->lru_next = table->free_head;
+    table->free_head = index;
+    table->count--;
+
+    if (table->removed > (table->bucket_mask + 1) * FLOW_BUCKET_SLOTS / 4){
+        flow_table_rebuild(table);
+    }
+}
+
+/**
+ * @brief Remove the flows that have been idle for longer than the timeout
+ *
+ * @param table
+ * @param now
+ */
+void
+flow_table_expire(flow_table_t *table, uint64_t now)
+{
+    if (table->idle_timeout == 0){
+        return;
+    }
+    while (table->lru_tail != FLOW_NONE){
+        uint32_t index = table->lru_tail;
+        flow_t *flow = &table->flows[index];
+        if (flow->last_seen + table->idle_timeout < now){
+            flow_table_remove(table, flow);
+            table->expired++;
+        } else if (flow->last_seen != flow->queued_seen){
+            flow_lru_requeue(table, index);
+        } else {
+            // active, and the flows in front of it were seen later
+            break;
+        }
+    }
+}
+
+// make room for a new flow: the first one from the tail not seen since it was queued
+static void
+flow_table_evict(flow_table_t *table)
+{
+    while (true){
+        uint32_t index = table->lru_tail;
+        flow_t *flow = &table->flows[index];
+        if (flow->last_seen == flow->queued_seen){
+            flow_table_remove(table, flow);
+            table->evicted++;
+            return;
+        }
+        flow_lru_requeue(table, index);
+    }
+}
+
+/**
+ * @brief Account for a packet, creating its flow if needed
+ *
+ * @param table
+ * @param packet
+ * @param caplen
+ * @param length length on the wire
+ * @param timestamp
+ * @return flow_t* the packet's flow, NULL if it isn't IP
+ */
+flow_t*
+flow_table_update(flow_table_t *table, const uint8_t *packet, uint32_t caplen, uint32_t length, uint64_t timestamp)
+{
+    flow_key_t key;
+    bool from_a;
+    uint8_t tcp_flags;
+    if (!flow_key_from_packet(packet, caplen, &key, &from_a, &tcp_flags)){
+        table->untracked++;
+        return NULL;
+    }
+    return flow_table_update_key(table, &key, from_a, tcp_flags, length, timestamp);
+}
+
+/**
+ * @brief Same as flow_table_update(), for a packet whose key is already built
+ *
+ * @param table
+ * @param key
+ * @param from_a the packet goes from endpoint a to b
+ * @param tcp_flags
+ * @param length length on the wire
+ * @param timestamp
+ * @return flow_t* the packet's flow
+ */
+flow_t*
+flow_table_update_key(flow_table_t *table, const flow_key_t *key, bool from_a, uint8_t tcp_flags, uint32_t length, uint64_t timestamp)
+{
+    flow_table_expire(table, timestamp);
+
+    uint32_t hash = flow_key_hash(key);
+    flow_slot_t *insert = NULL;
+    flow_slot_t *slot = flow_table_probe(table, key, hash, &insert);
+    uint32_t index;
+    flow_t *flow;
+
+    if (slot != NULL){
+        index = slot->index;
+        flow = &table->flows[index];
+    } else {
+        if (table->free_head == FLOW_NONE){
+            flow_table_evict(table);
+            // the removal may have rebuilt the index
+            flow_table_probe(table, key, hash, &insert);
+        }
+        if (insert->tag == FLOW_TAG_REMOVED){
+            table->removed--;
+        }
+        index = table->free_head;
+        flow = &table->flows[index];
+        table->free_head = flow->lru_next;
+
+        memset(flow, 0, sizeof(flow_t));
+        flow->key = *key;
+        flow->hash = hash;
+        flow->initiator_is_a = from_a;
+        flow->first_seen = timestamp;
+        flow->queued_seen = timestamp;
+        insert->tag = flow_tag(hash);
+        insert->index = index;
+        flow_lru_push_front(table, index);
+        table->count++;
+        table->created++;
+    }
+
+    int direction = flow_direction(flow, from_a);
+    flow->packets[direction]++;
+    flow->bytes[direction] += length;
+    flow->tcp_flags |= tcp_flags;
+    flow->last_seen = timestamp;
+    return flow;
+}
+
+/**
+ * @brief Direction of a packet in its flow
+ *
+ * @param flow
+ * @param from_a the packet goes from endpoint a to b
+ * @return int 0 from the initiator, 1 from the responder
+ */
+int
+flow_direction(const flow_t *flow, bool from_a)
+{
+    return (from_a == flow->initiator_is_a) ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+#ifndef FLOW_TABLE_H
+#define FLOW_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Connections seen in the capture, keyed on the bidirectional 5-tuple.
+
+The key is canonical: the lower (address, port) endpoint is always a, so
+both directions of a conversation land on the same flow. The counters are
+kept per direction, relative to the endpoint that sent the first packet
+(the initiator).
+
+The flows live in a pool allocated once, capacity of them, so the memory is
+bounded. The index is an open addressing hash table made of 64 bytes buckets
+(one cache line, 8 slots): a slot holds a tag (bits of the hash) and the
+index of the flow, a lookup reads one bucket and usually compares a single
+key. Buckets are probed linearly when full.
+
+The flows are also queued in an approximate LRU order (CLOCK, second
+chance): a packet only updates last_seen, a flow reaching the tail that was
+seen since it was queued goes back to the front instead of leaving. This
+keeps the list out of the per packet path, where relinking would touch two
+more cache lines. When the pool is full the first flow from the tail not
+seen since it was queued is evicted; flows idle for longer than
+idle_timeout are expired as the capture time moves on.
+
+Timestamps are in microseconds of capture time. The live flows can be
+walked from lru_head through lru_next. A flow's index in the pool stays
+the same while it lives, state kept next to the table can be indexed on
+it: on_remove is called before a flow leaves, evicted, expired or removed.
+*/
+
+#define FLOW_TABLE_CAPACITY (1 << 20)
+#define FLOW_IDLE_TIMEOUT (300ull * 1000000) // 5 minutes
+#define FLOW_BUCKET_SLOTS 8
+#define FLOW_NONE UINT32_MAX
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct flow_key {
+    uint8_t address_a[16];  // IPv4 in the first 4 bytes, the rest 0
+    uint8_t address_b[16];
+    uint16_t port_a;        // ICMP echo: the identifier on both sides
+    uint16_t port_b;
+    uint8_t protocol;
+    uint8_t version;        // 4 or 6
+    uint8_t padding[2];     // zero, keys are compared with memcmp
+} flow_key_t;
+
+typedef struct flow {
+    flow_key_t key;
+    uint32_t hash;
+    uint32_t lru_prev;      // towards the front
+    uint32_t lru_next;      // towards the tail, next free when unused
+    uint8_t tcp_flags;      // union of the flags seen both ways
+    bool initiator_is_a;
+    uint64_t packets[2];    // [0] from the initiator, [1] from the responder
+    uint64_t bytes[2];      // on the wire
+    uint64_t first_seen;
+    uint64_t last_seen;
+    uint64_t queued_seen;   // last_seen when put at the front of the queue
+} flow_t;
+
+typedef struct flow_slot {
+    uint32_t tag;           // 0 empty, 1 removed, else bits of the hash
+    uint32_t index;         // in the pool
+} flow_slot_t;
+
+typedef struct flow_bucket {
+    flow_slot_t slots[FLOW_BUCKET_SLOTS];
+} __attribute__((aligned(64))) flow_bucket_t;
+
+struct flow_table;
+typedef void (*flow_remove_t)(void *context, struct flow_table *table, flow_t *flow);
+
+typedef struct flow_table {
+    flow_bucket_t *buckets;
+    uint32_t bucket_mask;
+    uint32_t removed;       // slots marked removed, cleaned up by a rebuild
+
+    flow_t *flows;          // the pool
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t free_head;
+    uint32_t lru_head;      // most recently queued
+    uint32_t lru_tail;      // next to expire or evict
+
+    uint64_t idle_timeout;  // 0: flows only leave when the pool is full
+    flow_remove_t on_remove;    // NULL, or called with each flow leaving
+    void *on_remove_context;
+
+    uint64_t created;
+    uint64_t evicted;       // pushed out by a new flow, the pool being full
+    uint64_t expired;       // idle for too long
+    uint64_t untracked;     // packets that aren't IP
+} flow_table_t;
+
+flow_table_t* flow_table_create(uint32_t capacity, uint64_t idle_timeout);
+void flow_table_destroy(flow_table_t *table);
+
+bool flow_key_from_packet(const uint8_t *packet, uint32_t caplen, flow_key_t *key, bool *from_a, uint8_t *tcp_flags);
+bool flow_key_from_endpoints(flow_key_t *key, uint8_t version, uint8_t protocol, const uint8_t *source, const uint8_t *destination,
+    uint16_t source_port, uint16_t destination_port);
+uint32_t flow_key_hash(const flow_key_t *key);
+
+flow_t* flow_table_find(flow_table_t *table, const flow_key_t *key);
+flow_t* flow_table_update(flow_table_t *table, const uint8_t *packet, uint32_t caplen, uint32_t length, uint64_t timestamp);
+flow_t* flow_table_update_key(flow_table_t *table, const flow_key_t *key, bool from_a, uint8_t tcp_flags, uint32_t length, uint64_t timestamp);
+int flow_direction(const flow_t *flow, bool from_a);
+void flow_table_remove(flow_table_t *table, flow_t *flow);
+void flow_table_expire(flow_table_t *table, uint64_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
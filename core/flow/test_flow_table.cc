@@ -0,0 +1,275 @@
+#include "flow_table.h"
+#include <cassert>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/ip_icmp.h>
+#include <netinet/tcp.h>
+
+#define SECOND 1000000ull
+
+// ethernet + ipv4 + tcp/udp/icmp header, no payload
+uint32_t
+build_ipv4(uint8_t *packet, uint32_t src, uint32_t dst, uint8_t protocol, uint16_t sport, uint16_t dport, uint8_t flags)
+{
+    memset(packet, 0, 64);
+    packet[12] = 0x08;
+    packet[13] = 0x00;
+    uint8_t *ip = packet + 14;
+    ip[0] = 0x45;
+    ip[3] = 40;
+    ip[8] = 64;
+    ip[9] = protocol;
+    uint32_t src_n = htonl(src), dst_n = htonl(dst);
+    memcpy(ip + 12, &src_n, 4);
+    memcpy(ip + 16, &dst_n, 4);
+    uint8_t *l4 = ip + 20;
+    if (protocol == IPPROTO_ICMP){
+        l4[0] = ICMP_ECHO;
+        l4[4] = sport >> 8;
+        l4[5] = sport & 0xff;
+    } else {
+        l4[0] = sport >> 8;
+        l4[1] = sport & 0xff;
+        l4[2] = dport >> 8;
+        l4[3] = dport & 0xff;
+        l4[12] = 5 << 4;
+        l4[13] = flags;
+    }
+    return 14 + 40;
+}
+
+void
+test_both_directions()
+{
+    flow_table_t *table = flow_table_create(16, 0);
+    uint8_t packet[64];
+
+    uint32_t length = build_ipv4(packet, 0x0a000002, 0x0a000001, IPPROTO_TCP, 40000, 80, TH_SYN);
+    flow_t *flow = flow_table_update(table, packet, length, 100, 1 * SECOND);
+    assert(flow != NULL);
+    length = build_ipv4(packet, 0x0a000001, 0x0a000002, IPPROTO_TCP, 80, 40000, TH_SYN | TH_ACK);
+    assert(flow_table_update(table, packet, length, 60, 2 * SECOND) == flow);
+    length = build_ipv4(packet, 0x0a000002, 0x0a000001, IPPROTO_TCP, 40000, 80, TH_ACK);
+    assert(flow_table_update(table, packet, length, 54, 3 * SECOND) == flow);
+
+    assert(table->count == 1);
+    assert(table->created == 1);
+    // the initiator is 10.0.0.2, the higher endpoint
+    assert(!flow->initiator_is_a);
+    assert(flow->packets[0] == 2 && flow->packets[1] == 1);
+    assert(flow->bytes[0] == 154 && flow->bytes[1] == 60);
+    assert(flow->tcp_flags == (TH_SYN | TH_ACK));
+    assert(flow->first_seen == 1 * SECOND && flow->last_seen == 3 * SECOND);
+    assert(flow->key.port_a == 80 && flow->key.port_b == 40000);
+    assert(flow->key.protocol == IPPROTO_TCP && flow->key.version == 4);
+
+    // another port is another flow
+    length = build_ipv4(packet, 0x0a000002, 0x0a000001, IPPROTO_TCP, 40001, 80, TH_SYN);
+    assert(flow_table_update(table, packet, length, 60, 4 * SECOND) != flow);
+    assert(table->count == 2);
+    flow_table_destroy(table);
+}
+
+void
+test_find()
+{
+    flow_table_t *table = flow_table_create(16, 0);
+    uint8_t packet[64];
+    uint32_t length = build_ipv4(packet, 0x0a000001, 0x0a000002, IPPROTO_UDP, 53, 5353, 0);
+    flow_t *flow = flow_table_update(table, packet, length, 80, 1);
+
+    flow_key_t key;
+    bool from_a;
+    uint8_t flags;
+    length = build_ipv4(packet, 0x0a000002, 0x0a000001, IPPROTO_UDP, 5353, 53, 0);
+    assert(flow_key_from_packet(packet, length, &key, &from_a, &flags));
+    assert(!from_a);
+    assert(flow_table_find(table, &key) == flow);
+
+    flow_table_remove(table, flow);
+    assert(flow_table_find(table, &key) == NULL);
+    assert(table->count == 0);
+    flow_table_destroy(table);
+}
+
+void
+test_eviction()
+{
+    flow_table_t *table = flow_table_create(4, 0);
+    uint8_t packet[64];
+    flow_t *flows[5];
+    for (int i = 0; i < 4; i++){
+        uint32_t length = build_ipv4(packet, 0x0a000001, 0x0a000002, IPPROTO_UDP, 1000 + i, 53, 0);
+        flows[i] = flow_table_update(table, packet, length, 60, i);
+    }
+    // touch the first one, it gets a second chance and the second one goes
+    uint32_t length = build_ipv4(packet, 0x0a000001, 0x0a000002, IPPROTO_UDP, 1000, 53, 0);
+    assert(flow_table_update(table, packet, length, 60, 10) == flows[0]);
+
+    length = build_ipv4(packet, 0x0a000001, 0x0a000002, IPPROTO_UDP, 2000, 53, 0);
+    flows[4] = flow_table_update(table, packet, length, 60, 11);
+    assert(table->count == 4);
+    assert(table->evicted == 1);
+    // the new flow took the evicted one's place in the pool
+    assert(flows[4] == flows[1]);
+    assert(flows[4]->key.port_a == 2000 && flows[4]->key.port_b == 53);
+    assert(flows[4]->packets[0] == 1);
+
+    flow_key_t key;
+    bool from_a;
+    uint8_t flags;
+    length = build_ipv4(packet, 0x0a000001, 0x0a000002, IPPROTO_UDP, 1001, 53, 0);
+    assert(flow_key_from_packet(packet, length, &key, &from_a, &flags));
+    assert(flow_table_find(table, &key) == NULL);
+    flow_table_destroy(table);
+}
+
+void
+test_expiry()
+{
+    flow_table_t *table = flow_table_create(16, 10 * SECOND);
+    uint8_t packet[64];
+    uint32_t length = build_ipv4(packet, 0x0a000001, 0x0a000002, IPPROTO_UDP, 1000, 53, 0);
+    flow_table_update(table, packet, length, 60, 1 * SECOND);
+    length = build_ipv4(packet, 0x0a000001, 0x0a000002, IPPROTO_UDP, 1001, 53, 0);
+    flow_table_update(table, packet, length, 60, 5 * SECOND);
+
+    flow_table_expire(table, 11 * SECOND);
+    assert(table->count == 2);
+    flow_table_expire(table, 12 * SECOND);
+    assert(table->count == 1);
+    assert(table->expired == 1);
+
+    // a packet late enough expires the rest before being counted
+    flow_table_update(table, packet, length, 60, 30 * SECOND);
+    assert(table->count == 1);
+    assert(table->expired == 2);
+    assert(table->created == 3);
+    flow_table_destroy(table);
+}
+
+void
+test_rebuild()
+{
+    // removing many flows cleans up the index, and the flows stay reachable
+    flow_table_t *table = flow_table_create(64, 0);
+    uint8_t packet[64];
+    for (int round = 0; round < 20; round++){
+        for (int i = 0; i < 64; i++){
+            uint32_t length = build_ipv4(packet, 0x0a000001, 0x0a000002, IPPROTO_UDP, round * 64 + i, 53, 0);
+            assert(flow_table_update(table, packet, length, 60, round * 64 + i) != NULL);
+        }
+    }
+    assert(table->count == 64);
+    assert(table->evicted == 19 * 64);
+    assert(table->removed <= (table->bucket_mask + 1) * FLOW_BUCKET_SLOTS / 4);
+    for (uint32_t index = table->lru_head; index != FLOW_NONE; index = table->flows[index].lru_next){
+        assert(flow_table_find(table, &table->flows[index].key) == &table->flows[index]);
+    }
+    flow_table_destroy(table);
+}
+
+void
+test_ipv6_and_icmp()
+{
+    flow_table_t *table = flow_table_create(16, 0);
+    uint8_t packet[128] = {0};
+
+    // ipv6 udp
+    packet[12] = 0x86;
+    packet[13] = 0xdd;
+    uint8_t *ip6 = packet + 14;
+    ip6[0] = 0x60;
+    ip6[5] = 8;
+    ip6[6] = IPPROTO_UDP;
+    ip6[8 + 15] = 1;
+    ip6[24 + 15] = 2;
+    uint8_t *udp = ip6 + 40;
+    udp[1] = 53;
+    udp[3] = 54;
+    flow_t *flow = flow_table_update(table, packet, 14 + 40 + 8, 62, 1);
+    assert(flow != NULL);
+    assert(flow->key.version == 6);
+    assert(flow->key.address_a[15] == 1 && flow->key.address_b[15] == 2);
+    assert(flow->key.port_a == 53 && flow->key.port_b == 54);
+
+    // icmp echo, the identifier on both sides
+    uint8_t echo[64];
+    uint32_t length = build_ipv4(echo, 0x0a000001, 0x0a000002, IPPROTO_ICMP, 0x1234, 0, 0);
+    flow = flow_table_update(table, echo, length, 98, 2);
+    assert(flow != NULL);
+    assert(flow->key.port_a == 0x1234 && flow->key.port_b == 0x1234);
+    echo[14 + 20] = ICMP_ECHOREPLY;
+    memcpy(echo + 14 + 12, "\x0a\x00\x00\x02\x0a\x00\x00\x01", 8);
+    assert(flow_table_update(table, echo, length, 98, 3) == flow);
+    assert(flow->packets[0] == 1 && flow->packets[1] == 1);
+
+    // arp isn't tracked
+    uint8_t arp[42] = {0};
+    arp[12] = 0x08;
+    arp[13] = 0x06;
+    assert(flow_table_update(table, arp, sizeof(arp), 42, 4) == NULL);
+    assert(table->untracked == 1);
+    // neither is a truncated frame
+    assert(flow_table_update(table, echo, 20, 98, 5) == NULL);
+    assert(table->untracked == 2);
+    assert(table->count == 2);
+    flow_table_destroy(table);
+}
+
+static uint32_t removed_flows = 0;
+
+void
+count_removed(void *context, flow_table_t *table, flow_t *flow)
+{
+    assert(context == &removed_flows);
+    assert(flow >= table->flows && flow < table->flows + table->capacity);
+    removed_flows++;
+}
+
+void
+test_update_key_and_on_remove()
+{
+    flow_table_t *table = flow_table_create(2, 10 * SECOND);
+    table->on_remove = count_removed;
+    table->on_remove_context = &removed_flows;
+    uint8_t packet[64];
+
+    // the same flow from its packet or from its endpoints
+    uint32_t length = build_ipv4(packet, 0x0a000002, 0x0a000001, IPPROTO_TCP, 40000, 80, TH_SYN);
+    flow_t *flow = flow_table_update(table, packet, length, 60, 1 * SECOND);
+    uint8_t source[4] = {10, 0, 0, 1};
+    uint8_t destination[4] = {10, 0, 0, 2};
+    flow_key_t key;
+    bool from_a = flow_key_from_endpoints(&key, 4, IPPROTO_TCP, source, destination, 80, 40000);
+    assert(from_a);
+    assert(flow_table_update_key(table, &key, from_a, TH_SYN | TH_ACK, 60, 2 * SECOND) == flow);
+    assert(flow_direction(flow, from_a) == 1);
+    assert(flow->packets[0] == 1 && flow->packets[1] == 1);
+
+    // evicted, expired then removed: told every time
+    length = build_ipv4(packet, 0x0a000003, 0x0a000001, IPPROTO_TCP, 40000, 80, TH_SYN);
+    flow_table_update(table, packet, length, 60, 3 * SECOND);
+    length = build_ipv4(packet, 0x0a000004, 0x0a000001, IPPROTO_TCP, 40000, 80, TH_SYN);
+    flow_table_update(table, packet, length, 60, 4 * SECOND);
+    assert(table->evicted == 1 && removed_flows == 1);
+    length = build_ipv4(packet, 0x0a000005, 0x0a000001, IPPROTO_TCP, 40000, 80, TH_SYN);
+    flow = flow_table_update(table, packet, length, 60, 20 * SECOND);
+    assert(table->expired == 2 && removed_flows == 3);
+    flow_table_remove(table, flow);
+    assert(removed_flows == 4 && table->count == 0);
+    flow_table_destroy(table);
+}
+
+int
+main()
+{
+    test_both_directions();
+    test_find();
+    test_eviction();
+    test_expiry();
+    test_rebuild();
+    test_ipv6_and_icmp();
+    test_update_key_and_on_remove();
+    return 0;
+}
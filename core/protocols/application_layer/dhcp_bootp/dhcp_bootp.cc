@@ -1,38 +1,51 @@
 #include "dhcp_bootp.h"
+#include "desc_table.h"
 
 /**
- * @brief Convert IPv4 address to string
+ * @brief Convert IPv4 address to string, in the arena
  * 
+ * @param arena 
  * @param addr Pointer to IPv4 address (in_addr or uint32_t)
- * @return std::string IP address as string
+ * @return const char* IP address as string
  */
-std::string ipv4_to_string(const void* addr) {
-    char addr_str[INET_ADDRSTRLEN];
-    if (inet_ntop(AF_INET, addr, addr_str, INET_ADDRSTRLEN) == nullptr) {
-        return "0.0.0.0";  // fallback for invalid address
-    }
-    return std::string(addr_str);
+static const char*
+arena_ipv4(arena_t *arena, const void* addr)
+{
+    char *addr_str = (char*)arena_alloc(arena, IPV4_ADDRESS_STRLEN);
+    format_ipv4_address((const uint8_t*)addr, addr_str);
+    return addr_str;
 }
 
 /**
- * @brief Parse the BOOTP header from the packet and return the parsed header
+ * @brief Parse the BOOTP header from the packet and return the parsed header.
+ * The packet is only read.
  * 
  * @param packet 
+ * @param length bytes available from packet
+ * @param arena the strings and the options are put there, they last until its reset
  * @param verbose 
- * @return my_bootp_header_t 
+ * @return my_bootp_header_t with empty strings and no options if the fixed part doesn't fit in length
  */
 my_dhcp_bootp_header_t 
-parse_bootp(uint8_t *packet, bool verbose)
+parse_bootp(const uint8_t *packet, uint32_t length, arena_t *arena, bool verbose)
 {
-    my_dhcp_bootp_header_t bootp_header;
+    my_dhcp_bootp_header_t bootp_header = {};
+    dhcp_options_init(&bootp_header.dhcp_options);
+    bootp_header.dhcp_message_type = -1;
+    if (length < BOOTP_OPTIONS_OFFSET){
+        bootp_header.client_ip_address = bootp_header.your_ip_address = "";
+        bootp_header.server_ip_address = bootp_header.gateway_ip_address = "";
+        bootp_header.client_hardware_address = bootp_header.server_host_name = bootp_header.boot_file_name = "";
+        return bootp_header;
+    }
 
-    struct bootp *bootp = (struct bootp *)packet;
+    const struct bootp *bootp = (const struct bootp *)packet;
 
     bootp_header.bp_op = bootp->bp_op;
-    get_bp_op_desc(bootp_header.bp_op, bootp_header.bp_op_desc, verbose);
+    bootp_header.bp_op_desc = get_bp_op_desc(bootp_header.bp_op, verbose);
 
     bootp_header.bp_htype = bootp->bp_htype;
-    get_hardware_type_desc(bootp_header.bp_htype, bootp_header.bp_htype_desc, verbose);
+    bootp_header.bp_htype_desc = get_hardware_type_desc(bootp_header.bp_htype, verbose);
 
     bootp_header.bp_hlen = bootp->bp_hlen;
 
@@ -44,266 +57,234 @@ parse_bootp(uint8_t *packet, bool verbose)
 
     // BOOTREQUEST, if known
     if (bootp_header.bp_op == BOOTREQUEST){
-        bootp_header.client_ip_address = ipv4_to_string(&bootp->bp_ciaddr);
+        bootp_header.client_ip_address = arena_ipv4(arena, &bootp->bp_ciaddr);
     } else {
-        bootp_header.client_ip_address[0] = '\0';
+        bootp_header.client_ip_address = "";
     }
 
-    bootp_header.your_ip_address = ipv4_to_string(&bootp->bp_yiaddr);
+    bootp_header.your_ip_address = arena_ipv4(arena, &bootp->bp_yiaddr);
 
     // returned in BOOTREPLY by server
     if (bootp_header.bp_op == BOOTREPLY){
-        bootp_header.server_ip_address = ipv4_to_string(&bootp->bp_siaddr);
+        bootp_header.server_ip_address = arena_ipv4(arena, &bootp->bp_siaddr);
     } else {
-        bootp_header.server_ip_address[0] = '\0';
+        bootp_header.server_ip_address = "";
     }
 
     // optional cross-gateway booting
     if (bootp->bp_giaddr.s_addr != 0){
-        bootp_header.gateway_ip_address = ipv4_to_string(&bootp->bp_giaddr);
+        bootp_header.gateway_ip_address = arena_ipv4(arena, &bootp->bp_giaddr);
     } else {
-        bootp_header.gateway_ip_address[0] = '\0';
+        bootp_header.gateway_ip_address = "";
     }
 
-    bootp_header.client_hardware_address = write_mac_address(bootp->bp_chaddr);
-    bootp_header.server_host_name = std::string((char*)bootp->bp_sname);
-    bootp_header.boot_file_name = std::string((char*)bootp->bp_file);
+    char *chaddr = (char*)arena_alloc(arena, MAC_ADDRESS_STRLEN);
+    format_mac_address(bootp->bp_chaddr, chaddr);
+    bootp_header.client_hardware_address = chaddr;
+    // not always terminated
+    bootp_header.server_host_name = arena_strndup(arena, (char*)bootp->bp_sname, strnlen((char*)bootp->bp_sname, sizeof(bootp->bp_sname)));
+    bootp_header.boot_file_name = arena_strndup(arena, (char*)bootp->bp_file, strnlen((char*)bootp->bp_file, sizeof(bootp->bp_file)));
 
-    bootp_header.magic_cookie = ntohl(*(uint32_t*)bootp->bp_vend);
+    bootp_header.magic_cookie = ntohl(*(const uint32_t*)bootp->bp_vend);
     
-    memcpy(bootp_header.vendor_specific_area, bootp->bp_vend, sizeof(bootp->bp_vend));
+    // as much of the vendor specific area as the packet holds, the rest stays 0
+    uint32_t vendor_length = length - (BOOTP_OPTIONS_OFFSET - 4);
+    memcpy(bootp_header.vendor_specific_area, bootp->bp_vend, (vendor_length < sizeof(bootp->bp_vend)) ? vendor_length : sizeof(bootp->bp_vend));
 
-    // get the DHCP options
-    uint8_t *options_start = packet + sizeof(struct bootp) - 60; // 60 = the size of the vendor specific area (64) - 4 bytes for the magic cookie
-    bootp_header.dhcp_options = NULL;
-
-    // get the DHCP options
-    get_dhcp_options_desc(options_start, &bootp_header, verbose);
+    // get the DHCP options, after the magic cookie
+    get_dhcp_options_desc(packet + BOOTP_OPTIONS_OFFSET, length - BOOTP_OPTIONS_OFFSET, &bootp_header, arena, verbose);
 
     return bootp_header;
 }
 
-/**
- * @brief Free the DHCP allocated linked list
- * 
- * @param bootp_header 
- */
-void 
-free_dhcp_bootp_header(my_dhcp_bootp_header_t *bootp_header)
-{
-    free_list(bootp_header->dhcp_options);
-}
+constexpr desc_entry_t dhcp_message_types[] = {
+    {DHCPDISCOVER, {"Discover", "Discover (1)"}},
+    {DHCPOFFER,    {"Offer",    "Offer (2)"}},
+    {DHCPREQUEST,  {"Request",  "Request (3)"}},
+    {DHCPDECLINE,  {"Decline",  "Decline (4)"}},
+    {DHCPACK,      {"ACK",      "ACK (5)"}},
+    {DHCPNAK,      {"NAK",      "NAK (6)"}},
+    {DHCPRELEASE,  {"Release",  "Release (7)"}},
+};
+
+constexpr auto dhcp_message_type_table = make_desc_table<256>(dhcp_message_types, {"", ""});
+
+// the option's description always has its code
+constexpr desc_entry_t dhcp_option_codes[] = {
+    {DHCP_SUBNET_MASK,            {"Subnet Mask",            "Subnet Mask (1)"}},
+    {DHCP_TIME_OFFSET,            {"Time Offset",            "Time Offset (2)"}},
+    {DHCP_ROUTER,                 {"Router",                 "Router (3)"}},
+    {DHCP_DNS,                    {"DNS",                    "DNS (6)"}},
+    {DHCP_HOST_NAME,              {"Host Name",              "Host Name (12)"}},
+    {DHCP_DOMAIN_NAME,            {"Domain Name",            "Domain Name (15)"}},
+    {DHCP_BROADCAST_ADDRESS,      {"Broadcast Address",      "Broadcast Address (28)"}},
+    {DHCP_NETBIOS_NAME_SERVER,    {"NetBIOS Name Server",    "NetBIOS Name Server (44)"}},
+    {DHCP_NETBIOS_SCOPE,          {"NetBIOS Scope",          "NetBIOS Scope (47)"}},
+    {DHCP_REQUESTED_IP_ADDRESS,   {"Requested IP Address",   "Requested IP Address (50)"}},
+    {DHCP_IP_ADDRESS_LEASE_TIME,  {"IP Address Lease Time",  "IP Address Lease Time (51)"}},
+    {DHCP_MESSAGE_TYPE,           {"DHCP Message Type",      "DHCP Message Type (53)"}},
+    {DHCP_SERVER_IDENTIFIER,      {"Server Identifier",      "Server Identifier (54)"}},
+    {DHCP_PARAMETER_REQUEST_LIST, {"Parameter Request List", "Parameter Request List (55)"}},
+    {DHCP_CLIENT_IDENTIFIER,      {"Client Identifier",      "Client Identifier (61)"}},
+};
+
+constexpr auto dhcp_unknown_options = make_desc_numbers<256>("Unknown (", ")");
+constexpr auto dhcp_option_code_table = make_desc_table<256>(dhcp_option_codes,
+    [](uint32_t code){ return desc_t{"Unknown", dhcp_unknown_options[code]}; });
+
+constexpr desc_entry_t bp_ops[] = {
+    {BOOTREQUEST, {"BOOTREQUEST", "Operation: BOOTREQUEST (1)"}},
+    {BOOTREPLY,   {"BOOTREPLY",   "Operation: BOOTREPLY (2)"}},
+};
+
+constexpr auto bp_unknown_ops = make_desc_numbers<256>("Unknown (", ")");
+constexpr auto bp_unknown_ops_verbose = make_desc_numbers<256>("Operation: Unknown (", ")");
+constexpr auto bp_op_table = make_desc_table<256>(bp_ops,
+    [](uint32_t bp_op){ return desc_t{bp_unknown_ops[bp_op], bp_unknown_ops_verbose[bp_op]}; });
 
 /**
- * @brief Get the dhcp message type description in a given string
+ * @brief Get the dhcp message type description
  * 
  * @param message_type 
- * @param desc 
  * @param verbose 
+ * @return std::string_view 
  */
-void 
-get_dhcp_message_type_desc(uint8_t message_type, std::string& desc, bool verbose)
+std::string_view
+get_dhcp_message_type_desc(uint8_t message_type, bool verbose)
 {
-    switch(message_type){
-        case DHCPDISCOVER:
-            if (verbose){
-                desc = "Discover (" + std::to_string(message_type) + ")";
-            } else {
-                desc = "Discover";
-            }
-            break;
-        case DHCPOFFER:
-            if (verbose){
-                desc = "Offer (" + std::to_string(message_type) + ")";
-            } else {
-                desc = "Offer";
-            }
-            break;
-        case DHCPREQUEST:
-            if (verbose){
-                desc = "Request (" + std::to_string(message_type) + ")";
-            } else {
-                desc = "Request";
-            }
-            break;
-        case DHCPDECLINE:
-            if (verbose){
-                desc = "Decline (" + std::to_string(message_type) + ")";
-            } else {
-                desc = "Decline";
-            }
-            break;
-        case DHCPACK:
-            if (verbose){
-                desc = "ACK (" + std::to_string(message_type) + ")";
-            } else {
-                desc = "ACK";
-            }
-            break;
-        case DHCPNAK:
-            if (verbose){
-                desc = "NAK (" + std::to_string(message_type) + ")";
-            } else {
-                desc = "NAK";
-            }
-            break;
-        case DHCPRELEASE:
-            if (verbose){
-                desc = "Release (" + std::to_string(message_type) + ")";
-            } else {
-                desc = "Release";
-            }
-            break;
-    }
+    return desc_lookup(dhcp_message_type_table, message_type, verbose);
+}
+
+// the 4 bytes values, an option too short for its value has none
+static const char*
+option_ipv4(arena_t *arena, const uint8_t *value, uint8_t option_length)
+{
+    return (option_length >= 4) ? arena_ipv4(arena, value) : "";
+}
+
+static uint32_t
+option_u32(const uint8_t *value, uint8_t option_length)
+{
+    return (option_length >= 4) ? packet_load_u32(value) : 0;
 }
 
 /**
  * @brief Get the dhcp options descriptions
  * 
  * @param options 
+ * @param length bytes available from options
  * @param bootp_header 
+ * @param arena 
  * @param verbose 
  */
 void 
-get_dhcp_options_desc(uint8_t *options, my_dhcp_bootp_header_t* bootp_header, bool verbose)
+get_dhcp_options_desc(const uint8_t *options, uint32_t length, my_dhcp_bootp_header_t* bootp_header, arena_t *arena, bool verbose)
 {
-    int write_ptr = 0;
-    // stop if we reach the end of the options 0xFF or 0 (for BOOTP!!)
-    while (options[write_ptr] != 0xFF && options[write_ptr] != 0){
-        // create a new option to be stored in the linked list
-        my_dhcp_option_t *dhcp_option = (my_dhcp_option_t *)malloc(sizeof(my_dhcp_option_t));
-        dhcp_option->option_code = options[write_ptr];
-        dhcp_option->option_length = options[write_ptr + 1];
-        switch(options[write_ptr]){
+    packet_cursor_t cursor = packet_cursor_init(options, length);
+    // stop if we reach the end of the options 0xFF or 0 (for BOOTP!!),
+    // or an option cut by the capture
+    while (packet_cursor_has(&cursor, 2) && cursor.data[0] != 0xFF && cursor.data[0] != 0){
+        const uint8_t *option = packet_cursor_bytes(&cursor, 2 + cursor.data[1]);
+        if (option == NULL){
+            break;
+        }
+        const uint8_t *value = option + 2;
+        // the next option, after the previous ones
+        my_dhcp_option_t *dhcp_option = dhcp_options_push(&bootp_header->dhcp_options, arena);
+        dhcp_option->option_value_desc = "";
+        dhcp_option->option_code = option[0];
+        dhcp_option->option_length = option[1];
+        dhcp_option->option_code_desc = desc_lookup(dhcp_option_code_table, dhcp_option->option_code, true).data();
+        switch(option[0]){
             case DHCP_MESSAGE_TYPE:
-                dhcp_option->option_code_desc = "DHCP Message Type (" + std::to_string(options[write_ptr]) + ")";
-                dhcp_option->option_value = options[write_ptr + 2];
-                get_dhcp_message_type_desc(dhcp_option->option_value, dhcp_option->option_value_desc, verbose);
+                                dhcp_option->option_value = (dhcp_option->option_length >= 1) ? value[0] : 0;
+                dhcp_option->option_value_desc = get_dhcp_message_type_desc(dhcp_option->option_value, verbose).data();
                 break;
             case DHCP_SUBNET_MASK:
-                dhcp_option->option_code_desc = "Subnet Mask (" + std::to_string(options[write_ptr]) + ")";
-                {   
-                    dhcp_option->option_value_desc = ipv4_to_string(options + write_ptr + 2);
+                                {   
+                    dhcp_option->option_value_desc = option_ipv4(arena, value, dhcp_option->option_length);
                 }
                 break;
             case DHCP_TIME_OFFSET:
-                dhcp_option->option_code_desc = "Time Offset (" + std::to_string(options[write_ptr]) + ")";
-                dhcp_option->option_value = ntohl(*(uint32_t*)(options + write_ptr + 2));
+                                dhcp_option->option_value = option_u32(value, dhcp_option->option_length);
                 break;
             case DHCP_ROUTER:
-                dhcp_option->option_code_desc = "Router (" + std::to_string(options[write_ptr]) + ")";
-                {   
-                    dhcp_option->option_value_desc = ipv4_to_string(options + write_ptr + 2);
+                                {   
+                    dhcp_option->option_value_desc = option_ipv4(arena, value, dhcp_option->option_length);
                 }
                 break;
             case DHCP_DNS:
-                dhcp_option->option_code_desc = "DNS (" + std::to_string(options[write_ptr]) + ")";
-                {
-                    dhcp_option->option_value_desc = ipv4_to_string(options + write_ptr + 2);
+                                {
+                    dhcp_option->option_value_desc = option_ipv4(arena, value, dhcp_option->option_length);
                 }
                 break;
             case DHCP_HOST_NAME:
-                dhcp_option->option_code_desc = "Host Name (" + std::to_string(options[write_ptr]) + ")";
-                dhcp_option->option_value_desc = std::string((char*)(options + write_ptr + 2), dhcp_option->option_length);
+                                dhcp_option->option_value_desc = arena_strndup(arena, (const char*)value, dhcp_option->option_length);
                 break;
             case DHCP_DOMAIN_NAME:
-                dhcp_option->option_code_desc = "Domain Name (" + std::to_string(options[write_ptr]) + ")";
-                dhcp_option->option_value_desc = std::string((char*)(options + write_ptr + 2), dhcp_option->option_length);
+                                dhcp_option->option_value_desc = arena_strndup(arena, (const char*)value, dhcp_option->option_length);
                 break;
             case DHCP_BROADCAST_ADDRESS:
-                dhcp_option->option_code_desc = "Broadcast Address (" + std::to_string(options[write_ptr]) + ")";
-                {
-                    dhcp_option->option_value_desc = ipv4_to_string(options + write_ptr + 2);
+                                {
+                    dhcp_option->option_value_desc = option_ipv4(arena, value, dhcp_option->option_length);
                 }
                 break;
             case DHCP_NETBIOS_NAME_SERVER:
-                dhcp_option->option_code_desc = "NetBIOS Name Server (" + std::to_string(options[write_ptr]) + ")";
-                {
-                    dhcp_option->option_value_desc = ipv4_to_string(options + write_ptr + 2); // only the first one
+                                {
+                    dhcp_option->option_value_desc = option_ipv4(arena, value, dhcp_option->option_length); // only the first one
                 }
                 break;
             case DHCP_NETBIOS_SCOPE:
-                dhcp_option->option_code_desc = "NetBIOS Scope (" + std::to_string(options[write_ptr]) + ")";
-                dhcp_option->option_value_desc = std::string((char*)(options + write_ptr + 2), dhcp_option->option_length);
+                                dhcp_option->option_value_desc = arena_strndup(arena, (const char*)value, dhcp_option->option_length);
                 break;
             case DHCP_REQUESTED_IP_ADDRESS:
-                dhcp_option->option_code_desc = "Requested IP Address (" + std::to_string(options[write_ptr]) + ")";
-                {
-                    dhcp_option->option_value_desc = ipv4_to_string(options + write_ptr + 2);
+                                {
+                    dhcp_option->option_value_desc = option_ipv4(arena, value, dhcp_option->option_length);
                 }
                 break;
             case DHCP_IP_ADDRESS_LEASE_TIME:
-                dhcp_option->option_code_desc = "IP Address Lease Time (" + std::to_string(options[write_ptr]) + ")";
-                dhcp_option->option_value = ntohl(*(uint32_t*)(options + write_ptr + 2));
+                                dhcp_option->option_value = option_u32(value, dhcp_option->option_length);
                 break;
             case DHCP_SERVER_IDENTIFIER:
-                dhcp_option->option_code_desc = "Server Identifier (" + std::to_string(options[write_ptr]) + ")";
-                {   
-                    dhcp_option->option_value_desc = ipv4_to_string(options + write_ptr + 2);
+                                {   
+                    dhcp_option->option_value_desc = option_ipv4(arena, value, dhcp_option->option_length);
                 }
                 break;
             case DHCP_PARAMETER_REQUEST_LIST:
-                dhcp_option->option_code_desc = "Parameter Request List (" + std::to_string(options[write_ptr]) + ")";
-                {
-                    std::ostringstream oss;
+                                {
+                    // at most "255," per code
+                    char *list = (char*)arena_alloc(arena, dhcp_option->option_length * 4 + 1);
+                    int length = 0;
+                    list[0] = '\0';
                     for (int i = 0; i < dhcp_option->option_length; i++){
-                        if (i > 0) oss << ",";
-                        oss << static_cast<int>(options[write_ptr + 2 + i]);
+                        length += sprintf(list + length, (i > 0) ? ",%d" : "%d", value[i]);
                     }
-                    dhcp_option->option_value_desc = oss.str();
+                    dhcp_option->option_value_desc = list;
                 }
                 break;
             case DHCP_CLIENT_IDENTIFIER:
-                dhcp_option->option_code_desc = "Client Identifier (" + std::to_string(options[write_ptr]) + ")";
-                dhcp_option->option_value_desc = std::string((char*)(options + write_ptr + 2), dhcp_option->option_length);
+                                dhcp_option->option_value_desc = arena_strndup(arena, (const char*)value, dhcp_option->option_length);
                 break;
             default:
-                dhcp_option->option_code_desc = "Unknown (" + std::to_string(options[write_ptr]) + ")";
-                dhcp_option->option_value = 0;
-                dhcp_option->option_value_desc[0] = '\0';
+                                dhcp_option->option_value = 0;
                 break;
         }
-        // add the option to the linked list
-        bootp_header->dhcp_options = add_node(bootp_header->dhcp_options, (void*)dhcp_option);
-        // save a pointer to the message type
+        // remember where the message type is
         if (dhcp_option->option_code == DHCP_MESSAGE_TYPE){
-            bootp_header->dhcp_message_type = bootp_header->dhcp_options;
+            bootp_header->dhcp_message_type = bootp_header->dhcp_options.count - 1;
         }
-        write_ptr += options[write_ptr + 1] + 2;
     }
 }
 
 /**
- * @brief Get the bootp operation description in a given string
+ * @brief Get the bootp operation description
  * 
  * @param bp_op 
- * @param desc 
  * @param verbose 
+ * @return std::string_view 
  */
-void
-get_bp_op_desc(uint8_t bp_op, std::string& desc, bool verbose)
+std::string_view
+get_bp_op_desc(uint8_t bp_op, bool verbose)
 {
-    switch(bp_op){
-        case BOOTREQUEST:
-            if (verbose){
-                desc = "Operation: BOOTREQUEST (" + std::to_string(bp_op) + ")";
-            } else {
-                desc = "BOOTREQUEST";
-            }
-            break;
-        case BOOTREPLY:
-            if (verbose){
-                desc = "Operation: BOOTREPLY (" + std::to_string(bp_op) + ")";
-            } else {
-                desc = "BOOTREPLY";
-            }
-            break;
-        default:
-            if (verbose){
-                desc = "Operation: Unknown (" + std::to_string(bp_op) + ")";
-            } else {
-                desc = "Unknown (" + std::to_string(bp_op) + ")";
-            }
-            break;
-    }
-}
\ No newline at end of file
+    return desc_lookup(bp_op_table, bp_op, verbose);
+}
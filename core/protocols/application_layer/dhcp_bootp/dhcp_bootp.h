@@ -10,17 +10,23 @@
 #endif
 
 #include <string>
+#include <string_view>
 #include <sstream>
 
 
 #include "arp.h"
 #include "ethernet.h"
 #include "mac_address.h"
-#include "linked_list.h"
+#include "arena.h"
+#include "small_vector.h"
+#include "packet_cursor.h"
 
 #define PORT_BOOTPS 67
 #define PORT_BOOTPC 68
 
+#define BOOTP_OPTIONS_OFFSET 240 // the fixed part and the magic cookie
+#define DHCP_INLINE_OPTIONS 8 // options stored in the header, the others in the arena
+
 // DHCP options DHCP
 #define DHCP_SUBNET_MASK 1
 #define DHCP_TIME_OFFSET 2
@@ -47,20 +53,23 @@
 #define DHCPNAK 6
 #define DHCPRELEASE 7
 
+// the strings and the options are in the arena given to parse_bootp()
 typedef struct my_dhcp_option {
     uint8_t option_code;
-    std::string option_code_desc;
+    const char *option_code_desc;
     uint8_t option_length;
     uint8_t option_value; // if I have an interesting value to store, like the dhcp message type
-    std::string option_value_desc;
+    const char *option_value_desc;
 } my_dhcp_option_t;
 
+SMALL_VECTOR(dhcp_options, my_dhcp_option_t, DHCP_INLINE_OPTIONS)
+
 typedef struct my_dhcp_bootp_header {
     uint8_t bp_op;
-    std::string bp_op_desc;
+    std::string_view bp_op_desc;
 
     uint8_t bp_htype; // hardware type same as ARP
-    std::string bp_htype_desc;
+    std::string_view bp_htype_desc;
     uint8_t bp_hlen;
 
     uint32_t bp_xid; // transaction ID
@@ -68,15 +77,15 @@ typedef struct my_dhcp_bootp_header {
     uint16_t bp_secs; // seconds since boot began
     uint16_t dhcp_flags_bp_unused;
 
-    std::string client_ip_address; // BOOTREQUEST, if known
-    std::string your_ip_address;   // filled by server if client doesn't know its own address (ciaddr was 0)
-    std::string server_ip_address; // returned in BOOTREPLY by server
-    std::string gateway_ip_address; // optional cross-gateway booting
+    const char *client_ip_address; // BOOTREQUEST, if known
+    const char *your_ip_address;   // filled by server if client doesn't know its own address (ciaddr was 0)
+    const char *server_ip_address; // returned in BOOTREPLY by server
+    const char *gateway_ip_address; // optional cross-gateway booting
 
-    std::string client_hardware_address; // client hardware address
-    std::string server_host_name; // server host name (optional)
+    const char *client_hardware_address; // client hardware address
+    const char *server_host_name; // server host name (optional)
 
-    std::string boot_file_name;  // 'generic' name or null in bootrequest,
+    const char *boot_file_name;  // 'generic' name or null in bootrequest,
                                    // fully qualified directory-path
                                    // name in bootreply.
     uint8_t vendor_specific_area[64]; // vendor-specific area (could be readable or not) if BOOTP
@@ -84,18 +93,17 @@ typedef struct my_dhcp_bootp_header {
     uint32_t magic_cookie; // always 0x63825363
     
     // DHCP specific
-    node_t *dhcp_message_type;
+    int dhcp_message_type; // index in dhcp_options, -1 if there is none
     
-    node_t *dhcp_options;
+    dhcp_options_t dhcp_options; // in the order of the packet
 
 } my_dhcp_bootp_header_t;
 
-my_dhcp_bootp_header_t parse_bootp(uint8_t *packet, bool verbose);
-void free_dhcp_bootp_header(my_dhcp_bootp_header_t *bootp_header);
+my_dhcp_bootp_header_t parse_bootp(const uint8_t *packet, uint32_t length, arena_t *arena, bool verbose);
 
 // helpers
-void get_dhcp_message_type_desc(uint8_t message_type, std::string& desc, bool verbose);
-void get_dhcp_options_desc(uint8_t *options, my_dhcp_bootp_header_t* bootp_header, bool verbose);
-void get_bp_op_desc(uint8_t bp_op, std::string& desc, bool verbose);
+std::string_view get_dhcp_message_type_desc(uint8_t message_type, bool verbose);
+void get_dhcp_options_desc(const uint8_t *options, uint32_t length, my_dhcp_bootp_header_t* bootp_header, arena_t *arena, bool verbose);
+std::string_view get_bp_op_desc(uint8_t bp_op, bool verbose);
 
 #endif
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "dhcp_bootp.h"
 #include <cassert>
+#include <cstring>
 
 void test_parse_bootp()
 {
@@ -43,7 +44,9 @@ void test_parse_bootp()
         0x35, 0x01, 0x01  // options / vendor specific
     };
 
-    my_dhcp_bootp_header_t bootp_header = parse_bootp(bootp_packet, false);
+    arena_t arena;
+    arena_init(&arena, 0);
+    my_dhcp_bootp_header_t bootp_header = parse_bootp(bootp_packet, sizeof(bootp_packet), &arena, false);
 
     assert(bootp_header.bp_op == BOOTREQUEST);
     assert(bootp_header.bp_op_desc == "BOOTREQUEST");
@@ -53,20 +56,20 @@ void test_parse_bootp()
     assert(bootp_header.bp_xid == 0x39678A1F);
     assert(bootp_header.bp_secs == 0);
     assert(bootp_header.dhcp_flags_bp_unused == 0);
-    assert(bootp_header.client_ip_address == "192.168.1.1");
-    assert(bootp_header.your_ip_address == "192.168.1.2");
-    assert(bootp_header.server_ip_address == "");
-    assert(bootp_header.gateway_ip_address == "");
-    assert(bootp_header.client_hardware_address == "00:00:00:00:00:00");
-    assert(bootp_header.server_host_name == "");
-    assert(bootp_header.boot_file_name == "");
+    assert(strcmp(bootp_header.client_ip_address, "192.168.1.1") == 0);
+    assert(strcmp(bootp_header.your_ip_address, "192.168.1.2") == 0);
+    assert(strcmp(bootp_header.server_ip_address, "") == 0);
+    assert(strcmp(bootp_header.gateway_ip_address, "") == 0);
+    assert(strcmp(bootp_header.client_hardware_address, "00:00:00:00:00:00") == 0);
+    assert(strcmp(bootp_header.server_host_name, "") == 0);
+    assert(strcmp(bootp_header.boot_file_name, "") == 0);
     assert(bootp_header.magic_cookie == 0x63825363);
 
     // for (int i = 0; i < strlen((char*)bootp_header.vendor_specific_area); i++)
     // {
     //     printf("%x ", bootp_header.vendor_specific_area[i]);
     // }
-    free_dhcp_bootp_header(&bootp_header);
+    arena_destroy(&arena);
 }
 
 void test_parse_dhcp()
@@ -107,7 +110,9 @@ void test_parse_dhcp()
     0x82, 0x4f, 0xc8, 0x01, 0xff, 0x00, 0x00, 0x00
     };
 
-    my_dhcp_bootp_header_t dhcp_header = parse_bootp(dhcp_packet, false);
+    arena_t arena;
+    arena_init(&arena, 0);
+    my_dhcp_bootp_header_t dhcp_header = parse_bootp(dhcp_packet, sizeof(dhcp_packet), &arena, false);
 
     assert(dhcp_header.bp_op == BOOTREPLY);
     assert(dhcp_header.bp_op_desc == "BOOTREPLY");
@@ -118,31 +123,30 @@ void test_parse_dhcp()
     assert(dhcp_header.bp_secs == 0);
     assert(dhcp_header.dhcp_flags_bp_unused == 0);
 
-    assert(dhcp_header.client_ip_address == "");
-    assert(dhcp_header.your_ip_address == "130.79.75.94");
-    assert(dhcp_header.server_ip_address == "130.79.75.86");
-    assert(dhcp_header.gateway_ip_address == "");
-    assert(dhcp_header.client_hardware_address == "80:c8:8c:c0:79:00");
-    assert(dhcp_header.server_host_name == "");
-    assert(dhcp_header.boot_file_name == "");
+    assert(strcmp(dhcp_header.client_ip_address, "") == 0);
+    assert(strcmp(dhcp_header.your_ip_address, "130.79.75.94") == 0);
+    assert(strcmp(dhcp_header.server_ip_address, "130.79.75.86") == 0);
+    assert(strcmp(dhcp_header.gateway_ip_address, "") == 0);
+    assert(strcmp(dhcp_header.client_hardware_address, "80:c8:8c:c0:79:00") == 0);
+    assert(strcmp(dhcp_header.server_host_name, "") == 0);
+    assert(strcmp(dhcp_header.boot_file_name, "") == 0);
     assert(dhcp_header.magic_cookie == 0x63825363);
 
-    // node_t *tmp = dhcp_header.dhcp_options;
-    // int i = 0;
-    // for (; tmp != NULL; tmp = tmp->next)
-    // {
-    //     my_dhcp_option_t *option = (my_dhcp_option_t *)tmp->data;
-    //     printf("\n--------------------\n");
-    //     printf("Option code: %d\n", option->option_code);
-    //     printf("Option code desc: %s\n", option->option_code_desc);
-    //     printf("Option length: %d\n", option->option_length);
-    //     printf("Option value: %d\n", option->option_value);
-    //     printf("Option value desc: %s\n", option->option_value_desc);
-    //     i++;
-    // }
-    // printf("Number of options: %d\n", i);
+    // in the order of the packet
+    assert(dhcp_header.dhcp_options.count == 7);
+    my_dhcp_option_t *options = dhcp_options_items(&dhcp_header.dhcp_options);
+    const uint8_t codes[] = {DHCP_MESSAGE_TYPE, DHCP_SERVER_IDENTIFIER, DHCP_IP_ADDRESS_LEASE_TIME,
+                             DHCP_SUBNET_MASK, DHCP_DOMAIN_NAME, DHCP_ROUTER, DHCP_DNS};
+    for (int i = 0; i < 7; i++){
+        assert(options[i].option_code == codes[i]);
+    }
+    assert(dhcp_header.dhcp_message_type == 0);
+    assert(options[0].option_value == DHCPOFFER);
+    assert(strcmp(options[1].option_value_desc, "130.79.75.86") == 0);
+    assert(strcmp(options[3].option_value_desc, "255.255.255.0") == 0);
+    assert(strcmp(options[4].option_value_desc, "u-strasbg.fr") == 0);
 
-    free_dhcp_bootp_header(&dhcp_header);
+    arena_destroy(&arena);
 }
 
 int main()
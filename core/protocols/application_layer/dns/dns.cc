@@ -1,140 +1,179 @@
 #include "dns.h"
+#include "desc_table.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
+#define DNS_DESC_CODES 256     // the types and classes in the tables, numbered when unknown
 
+/**
+ * @brief Parse a DNS message, the header and every section.
+ * The packet is only read.
+ * 
+ * @param packet 
+ * @param length bytes available from packet, the sections stop where the capture does
+ * @param arena the sections are built there, they last until its reset
+ * @param verbose 
+ * @return my_dns_header_t with no sections if the header doesn't fit in length
+ */
 my_dns_header_t 
-parse_dns(uint8_t *packet, bool verbose)
+parse_dns(const uint8_t *packet, uint32_t length, arena_t *arena, bool verbose)
 {
-    my_dns_header_t dns_header;
-    uint8_t *packet_init = (uint8_t*)packet;
-    dns_header.transaction_id = ntohs(*(uint16_t*)packet);
-    packet += 2;
-    dns_header.qr = (*packet & 0x80) >> 7;
-    get_qr_desc(dns_header.qr, dns_header.qr_desc, verbose);
-
-    dns_header.opcode = (*packet & 0x78) >> 3;
-    get_opcode_desc(dns_header.opcode, dns_header.opcode_desc, verbose);
-
-    dns_header.aa = (*packet & 0x04) >> 2;
-    get_aa_desc(dns_header.aa, dns_header.aa_desc, verbose);
-    dns_header.tc = (*packet & 0x02) >> 1;
-    get_tc_desc(dns_header.tc, dns_header.tc_desc, verbose);
-    dns_header.rd = (*packet & 0x01);
-    get_rd_desc(dns_header.rd, dns_header.rd_desc, verbose);
-    packet += 1;
-    dns_header.ra = (*packet & 0x80) >> 7;
-    get_ra_desc(dns_header.ra, dns_header.ra_desc, verbose);
-    dns_header.z = (*packet & 0x70) >> 4;
-
-    dns_header.rcode = (*packet & 0x0F);
-    get_rcode_desc(dns_header.rcode, dns_header.rcode_desc, verbose);
-
-    packet += 1;
-    dns_header.qdcount = ntohs(*(uint16_t*)packet);
-    packet += 2;
-    dns_header.ancount = ntohs(*(uint16_t*)packet);
-    packet += 2;
-    dns_header.nscount = ntohs(*(uint16_t*)packet);
-    packet += 2;
-    dns_header.arcount = ntohs(*(uint16_t*)packet);
-    packet += 2;
-
-    dns_header.question_section = NULL;
-    dns_header.answer_section = NULL;
-    dns_header.authority_section = NULL;
-    dns_header.additional_section = NULL;
-
-    int advance = 0;
-    if (dns_header.qdcount > 0){
-        int step = get_dns_question(packet, &dns_header, verbose);
-        advance += step;
+    my_dns_header_t dns_header = parse_dns_header(packet, length, verbose);
+    if (length < DNS_HEADER_SIZE){
+        return dns_header;
     }
 
-    if (dns_header.ancount > 0){
-        int step = get_dns_answer(packet, packet_init, &dns_header, advance, verbose);
-        advance += step;
-    }
+    // the compression pointers are offsets from the start of the message
+    const packet_cursor_t message = packet_cursor_init(packet, length);
+    packet_cursor_t cursor = packet_cursor_at(&message, DNS_HEADER_SIZE);
 
-    if (dns_header.nscount > 0){
-        int step = get_dns_authority(packet, packet_init, &dns_header, advance, verbose);
-        advance += step;
-    }
-
-    if (dns_header.arcount > 0){
-        int step = get_dns_additional(packet, packet_init, &dns_header, advance, verbose);
-        advance += step;
-    }
+    // a section cut short leaves the ones after it empty
+    bool complete = get_dns_question(&cursor, &message, &dns_header, arena, verbose)
+        && get_dns_answer(&cursor, &message, &dns_header, arena, verbose)
+        && get_dns_authority(&cursor, &message, &dns_header, arena, verbose)
+        && get_dns_additional(&cursor, &message, &dns_header, arena, verbose);
+    dns_header.truncated = !complete;
 
     return dns_header;
 }
 
-void
-free_dns_header(my_dns_header_t *dns_header)
+/**
+ * @brief Parse the header of a DNS message only, the flags and the
+ * section counts, for whoever doesn't look at the sections.
+ * The packet is only read.
+ * 
+ * @param packet 
+ * @param length bytes available from packet
+ * @param verbose 
+ * @return my_dns_header_t with empty sections, all 0 if the header doesn't fit in length
+ */
+my_dns_header_t 
+parse_dns_header(const uint8_t *packet, uint32_t length, bool verbose)
 {
-    free_list(dns_header->question_section);
-    free_list(dns_header->answer_section);
-    free_list(dns_header->authority_section);
-    free_list(dns_header->additional_section);
+    my_dns_header_t dns_header = {};
+    dns_questions_init(&dns_header.question_section);
+    dns_records_init(&dns_header.answer_section);
+    dns_records_init(&dns_header.authority_section);
+    dns_records_init(&dns_header.additional_section);
+
+    packet_cursor_t cursor = packet_cursor_init(packet, length);
+    const uint8_t *fixed = packet_cursor_bytes(&cursor, DNS_HEADER_SIZE);
+    if (fixed == NULL){
+        return dns_header;
+    }
+
+    dns_header.transaction_id = packet_load_u16(fixed);
+    dns_header.qr = (fixed[2] & 0x80) >> 7;
+    dns_header.qr_desc = get_qr_desc(dns_header.qr, verbose);
+
+    dns_header.opcode = (fixed[2] & 0x78) >> 3;
+    dns_header.opcode_desc = get_opcode_desc(dns_header.opcode, verbose);
+
+    dns_header.aa = (fixed[2] & 0x04) >> 2;
+    dns_header.aa_desc = get_aa_desc(dns_header.aa, verbose);
+    dns_header.tc = (fixed[2] & 0x02) >> 1;
+    dns_header.tc_desc = get_tc_desc(dns_header.tc, verbose);
+    dns_header.rd = (fixed[2] & 0x01);
+    dns_header.rd_desc = get_rd_desc(dns_header.rd, verbose);
+    dns_header.ra = (fixed[3] & 0x80) >> 7;
+    dns_header.ra_desc = get_ra_desc(dns_header.ra, verbose);
+    dns_header.z = (fixed[3] & 0x70) >> 4;
+
+    dns_header.rcode = (fixed[3] & 0x0F);
+    dns_header.rcode_desc = get_rcode_desc(dns_header.rcode, verbose);
+
+    dns_header.qdcount = packet_load_u16(fixed + 4);
+    dns_header.ancount = packet_load_u16(fixed + 6);
+    dns_header.nscount = packet_load_u16(fixed + 8);
+    dns_header.arcount = packet_load_u16(fixed + 10);
+
+    return dns_header;
 }
 
 /**
  * @brief Get the dns answer stuff
  * 
- * @param packet 
- * @param packet_init 
+ * @param cursor 
+ * @param message 
  * @param dns_header 
- * @param advance 
+ * @param arena 
  * @param verbose 
- * @return int 
+ * @return bool 
  */
-int get_dns_answer(uint8_t *packet, uint8_t *packet_init, my_dns_header_t *dns_header, int advance, bool verbose){
-    return get_dns_resource_record(packet, packet_init, dns_header, dns_header->ancount, IS_ANSWER, advance, verbose);
+bool
+get_dns_answer(packet_cursor_t *cursor, const packet_cursor_t *message, my_dns_header_t *dns_header, arena_t *arena, bool verbose){
+    return get_dns_resource_record(cursor, message, dns_header, dns_header->ancount, IS_ANSWER, arena, verbose);
 }
 
 /**
  * @brief Get the dns authority stuff
  * 
- * @param packet 
- * @param packet_init 
+ * @param cursor 
+ * @param message 
  * @param dns_header 
- * @param advance 
+ * @param arena 
  * @param verbose 
- * @return int 
+ * @return bool 
  */
-int get_dns_authority(uint8_t *packet, uint8_t *packet_init, my_dns_header_t *dns_header, int advance, bool verbose){
-    return get_dns_resource_record(packet, packet_init, dns_header, dns_header->nscount, IS_AUTHORITY, advance, verbose);
+bool
+get_dns_authority(packet_cursor_t *cursor, const packet_cursor_t *message, my_dns_header_t *dns_header, arena_t *arena, bool verbose){
+    return get_dns_resource_record(cursor, message, dns_header, dns_header->nscount, IS_AUTHORITY, arena, verbose);
 }
 
 /**
  * @brief Get the dns additional stuff
  * 
- * @param packet 
- * @param packet_init 
+ * @param cursor 
+ * @param message 
  * @param dns_header 
- * @param advance 
+ * @param arena 
  * @param verbose 
- * @return int 
+ * @return bool 
  */
-int get_dns_additional(uint8_t *packet, uint8_t *packet_init, my_dns_header_t *dns_header, int advance, bool verbose){
-    return get_dns_resource_record(packet, packet_init, dns_header, dns_header->arcount, IS_ADDITIONAL, advance, verbose);
+bool
+get_dns_additional(packet_cursor_t *cursor, const packet_cursor_t *message, my_dns_header_t *dns_header, arena_t *arena, bool verbose){
+    return get_dns_resource_record(cursor, message, dns_header, dns_header->arcount, IS_ADDITIONAL, arena, verbose);
+}
+
+// the verbose descriptions keep the value of the codes past the tables
+// (the EDNS payload size in the OPT record's class, CAA...): in the arena
+static const char*
+class_desc(uint16_t data_class, arena_t *arena, bool verbose)
+{
+    if (verbose && data_class >= DNS_DESC_CODES){
+        return arena_sprintf(arena, "class: Unknown (%u)", data_class);
+    }
+    return get_class_desc(data_class, verbose).data();
+}
+
+static const char*
+type_desc(uint16_t type, arena_t *arena, bool verbose)
+{
+    if (verbose && type >= DNS_DESC_CODES){
+        return arena_sprintf(arena, "qtype: Unknown (%u)", type);
+    }
+    return get_type_desc(type, verbose).data();
 }
 
 /**
- * @brief Get the dns resource record object
+ * @brief Get the resource records of a section, a record is only
+ * added once all of it was read
  * 
- * @param packet 
- * @param packet_init 
+ * @param cursor at the first record, moved past the last one read
+ * @param message the whole message, for the compression pointers
  * @param dns_header 
  * @param count 
  * @param what 
- * @param advance 
+ * @param arena 
  * @param verbose 
- * @return int 
+ * @return bool false if the section is cut by the capture or malformed
  */
-int
-get_dns_resource_record(uint8_t *packet, uint8_t* packet_init, my_dns_header_t *dns_header, int count, int what, int advance, bool verbose)
+bool
+get_dns_resource_record(packet_cursor_t *cursor, const packet_cursor_t *message, my_dns_header_t *dns_header, int count, int what, arena_t *arena, bool verbose)
 {   
-    node_t **dest;
+    dns_records_t *dest;
     switch(what){
         case IS_ANSWER:
             dest = &dns_header->answer_section;
@@ -149,57 +188,38 @@ get_dns_resource_record(uint8_t *packet, uint8_t* packet_init, my_dns_header_t *
             fprintf(stderr, "Invalid resource record type\n");
             exit(EXIT_FAILURE);
     }
-    int next = 0;
-    uint8_t *packet_current = packet + advance;
     while(count > 0){
-        resource_record_t *resource_record = (resource_record_t *)malloc(sizeof(resource_record_t));
-        if (resource_record == NULL){
-            fprintf(stderr, "Failed to allocate memory for resource record\n");
-            exit(EXIT_FAILURE);
+        const char *name = get_dns_name(cursor, message, arena);
+        // type, class, ttl and rdlength
+        const uint8_t *fixed = packet_cursor_bytes(cursor, 10);
+        if (name == NULL || fixed == NULL){
+            return false;
         }
-        if ((packet_current[0] & 0xC0) == 0xC0){
-            size_t offset = ((packet_current[0] & 0x3F) << 8) | packet_current[1];
-            int qname_size = get_dns_name(packet_init + offset, resource_record);
-            // skip pointer
-            packet_current += 2;
-            next += 2;
-        } else {
-            int qname_size = get_dns_name(packet_current, resource_record);
-            packet_current += qname_size;
-            next += qname_size;
-        }
-        resource_record->type = ntohs(*(uint16_t*)packet_current);
-        get_type_desc(resource_record->type, resource_record->type_desc, verbose);
-        packet_current += 2;
-        next += 2;
-
-        resource_record->data_class = ntohs(*(uint16_t*)packet_current);
-        get_class_desc(resource_record->data_class, resource_record->class_desc, verbose);
-        packet_current += 2;
-        next += 2;
-
-        resource_record->ttl = ntohl(*(uint32_t*)packet_current);
-        packet_current += 4;
-        next += 4;
-
-        resource_record->rdlength = ntohs(*(uint16_t*)packet_current);
-        packet_current += 2;
-        next += 2;
-
-        resource_record->rdata = (uint8_t*)malloc(resource_record->rdlength);
-        if (resource_record->rdata == NULL){
-            fprintf(stderr, "Failed to allocate memory for rdata\n");
-            exit(EXIT_FAILURE);
+        uint16_t rdlength = packet_load_u16(fixed + 8);
+        const uint8_t *rdata = packet_cursor_bytes(cursor, rdlength);
+        if (rdata == NULL){
+            return false;
         }
-        memcpy(resource_record->rdata, packet_current, resource_record->rdlength);
-        process_rdata((uint8_t*)resource_record->rdata, resource_record->rdata_desc, resource_record->rdlength);
-        packet_current += resource_record->rdlength;
-        next += resource_record->rdlength;
 
-        *dest = add_node_end(*dest, (void*)resource_record);
+        resource_record_t *resource_record = dns_records_push(dest, arena);
+        resource_record->name = name;
+        resource_record->type = packet_load_u16(fixed);
+        // the tables' texts are '\0' terminated and never freed
+        resource_record->type_desc = type_desc(resource_record->type, arena, verbose);
+        resource_record->data_class = packet_load_u16(fixed + 2);
+        resource_record->class_desc = class_desc(resource_record->data_class, arena, verbose);
+        resource_record->ttl = packet_load_u32(fixed + 4);
+        resource_record->rdlength = rdlength;
+
+        resource_record->rdata = (uint8_t*)arena_alloc(arena, rdlength);
+        memcpy(resource_record->rdata, rdata, rdlength);
+        char *rdata_desc = (char*)arena_alloc(arena, rdlength + 1);
+        process_rdata(resource_record->rdata, rdata_desc, rdlength);
+        resource_record->rdata_desc = rdata_desc;
+
         count--;
     }
-    return next;
+    return true;
 }
 
 /**
@@ -210,10 +230,10 @@ get_dns_resource_record(uint8_t *packet, uint8_t* packet_init, my_dns_header_t *
  * @param rdata_length 
  */
 void
-process_rdata(uint8_t *rdata, char* desc, size_t rdata_length)
+process_rdata(const uint8_t *rdata, char* desc, size_t rdata_length)
 {
     desc[rdata_length] = '\0';
-    for (int i = 0; i < rdata_length; i++){
+    for (size_t i = 0; i < rdata_length; i++){
         if (isprint(rdata[i])){
             desc[i] = rdata[i];
         } else {
@@ -222,446 +242,312 @@ process_rdata(uint8_t *rdata, char* desc, size_t rdata_length)
     }
 }
 
-int 
-get_dns_question(uint8_t *packet, my_dns_header_t *dns_header, bool verbose)
+/**
+ * @brief Get the dns questions, a question is only added once
+ * all of it was read
+ * 
+ * @param cursor at the first question, moved past the last one read
+ * @param message the whole message, for the compression pointers
+ * @param dns_header 
+ * @param arena 
+ * @param verbose 
+ * @return bool false if the section is cut by the capture or malformed
+ */
+bool
+get_dns_question(packet_cursor_t *cursor, const packet_cursor_t *message, my_dns_header_t *dns_header, arena_t *arena, bool verbose)
 {
     int count = dns_header->qdcount;
-    // keep the counter in the packet for the others
-    int next = 0;
     while(count > 0){
-        question_section_t *question_section = (question_section_t *)malloc(sizeof(question_section_t));
-        if (question_section == NULL){
-            fprintf(stderr, "Failed to allocate memory for question section\n");
-            exit(EXIT_FAILURE);
+        const char *qname = get_dns_name(cursor, message, arena);
+        // qtype and qclass
+        const uint8_t *fixed = packet_cursor_bytes(cursor, 4);
+        if (qname == NULL || fixed == NULL){
+            return false;
         }
-        int qname_size = get_dns_qname(packet, question_section);
-        next += qname_size;
-        packet += qname_size;
-        question_section->qtype = ntohs(*(uint16_t*)packet);
-        get_type_desc(question_section->qtype, question_section->qtype_desc, verbose);
-        packet += 2;
-        next += 2;
-        question_section->qclass = ntohs(*(uint16_t*)packet);
-        get_class_desc(question_section->qclass, question_section->qclass_desc, verbose);
-        packet += 2;
-        next += 2;
-        dns_header->question_section = add_node_end(dns_header->question_section, (void*)question_section);
+        question_section_t *question_section = dns_questions_push(&dns_header->question_section, arena);
+        question_section->qname = qname;
+        question_section->qtype = packet_load_u16(fixed);
+        question_section->qtype_desc = type_desc(question_section->qtype, arena, verbose);
+        question_section->qclass = packet_load_u16(fixed + 2);
+        question_section->qclass_desc = class_desc(question_section->qclass, arena, verbose);
         count--;
     }
-    return next;
+    return true;
 }
 
+// https://datatracker.ietf.org/doc/html/rfc1035#section-4.1.1
+constexpr desc_entry_t dns_qrs[] = {
+    {QR_QUERY,    {"QUERY",    "Query (0)"}},
+    {QR_RESPONSE, {"RESPONSE", "Response (1)"}},
+};
+
+constexpr auto dns_qr_table = make_desc_table<2>(dns_qrs, {"", ""});
+
+constexpr desc_entry_t dns_opcodes[] = {
+    {OP_QUERY,  {"op: QUERY",  "Message has: Standard query (0)"}},
+    {OP_IQUERY, {"op: IQUERY", "Message has: Inverse query (1)"}},
+    {OP_STATUS, {"op: STATUS", "Message has: Server status request (2)"}},
+};
+
+constexpr auto dns_unknown_opcodes = make_desc_numbers<16>("Message has: Unknown (", ")");
+constexpr auto dns_opcode_table = make_desc_table<16>(dns_opcodes,
+    [](uint32_t opcode){ return desc_t{"op: ?", dns_unknown_opcodes[opcode]}; });
+
+constexpr desc_entry_t dns_rcodes[] = {
+    {RCODE_NO_ERROR,        {"res: 0 !",      "No error (0)"}},
+    {RCODE_FORMAT_ERROR,    {"res: format !", "Format error (1)"}},
+    {RCODE_SERVER_FAILURE,  {"res: server !", "Server failure (2)"}},
+    {RCODE_NAME_ERROR,      {"res: name !",   "Name error (3)"}},
+    {RCODE_NOT_IMPLEMENTED, {"res: !impl",    "Not implemented (4)"}},
+    {RCODE_REFUSED,         {"res: X",        "Refused (5)"}},
+};
+
+constexpr auto dns_unknown_rcodes = make_desc_numbers<16>("Unknown (", ")");
+constexpr auto dns_rcode_table = make_desc_table<16>(dns_rcodes,
+    [](uint32_t rcode){ return desc_t{"res: ?", dns_unknown_rcodes[rcode]}; });
+
+// the one bit flags only show when set
+constexpr desc_entry_t dns_aas[] = {{1, {"Auth", "Authoritative (1)"}}};
+constexpr desc_entry_t dns_tcs[] = {{1, {"Trunc", "Truncated (1)"}}};
+constexpr desc_entry_t dns_rds[] = {{1, {"Recursion", "Recursion desired (1)"}}};
+constexpr desc_entry_t dns_ras[] = {{1, {"Rec", "Recursion available (1)"}}};
+
+constexpr auto dns_aa_table = make_desc_table<2>(dns_aas, {"", ""});
+constexpr auto dns_tc_table = make_desc_table<2>(dns_tcs, {"", ""});
+constexpr auto dns_rd_table = make_desc_table<2>(dns_rds, {"", ""});
+constexpr auto dns_ra_table = make_desc_table<2>(dns_ras, {"", ""});
+
+// https://datatracker.ietf.org/doc/html/rfc1035#section-3.2.4
+constexpr desc_entry_t dns_classes[] = {
+    {CLASS_IN, {"IN", "IN (1) the Internet"}},
+    {CLASS_CH, {"CH", "CH (3) the CHAOS class"}},
+    {CLASS_HS, {"HS", "HS (4) Hesiod"}},
+};
+
+// past the table the parsers number the unknowns in the arena
+constexpr auto dns_unknown_classes = make_desc_numbers<DNS_DESC_CODES>("class: Unknown (", ")");
+constexpr auto dns_class_table = make_desc_table<DNS_DESC_CODES>(dns_classes,
+    [](uint32_t data_class){ return desc_t{"class: ?", dns_unknown_classes[data_class]}; },
+    {"class: ?", "class: Unknown"});
+
+// https://datatracker.ietf.org/doc/html/rfc1035#section-3.2.2
+constexpr desc_entry_t dns_types[] = {
+    {TYPE_A,     {"A",     "A (1) host address"}},
+    {TYPE_NS,    {"NS",    "NS (2) authoritative name server"}},
+    {TYPE_CNAME, {"CNAME", "CNAME (5) canonical name"}},
+    {TYPE_SOA,   {"SOA",   "SOA (6) zone of authority"}},
+    {TYPE_PTR,   {"PTR",   "PTR (12) domain name pointer"}},
+    {TYPE_HINFO, {"HINFO", "HINFO (13) host information"}},
+    {TYPE_MINFO, {"MINFO", "MINFO (14) mailbox or mail list information"}},
+    {TYPE_MX,    {"MX",    "MX (15) mail exchange"}},
+    {TYPE_TXT,   {"TXT",   "TXT (16) text strings"}},
+    {TYPE_HTTPS, {"HTTPS", "HTTPS (65) Specific Service Endpoints"}},
+};
+
+constexpr auto dns_unknown_types = make_desc_numbers<DNS_DESC_CODES>("qtype: Unknown (", ")");
+constexpr auto dns_type_table = make_desc_table<DNS_DESC_CODES>(dns_types,
+    [](uint32_t type){ return desc_t{"qtype: ?", dns_unknown_types[type]}; },
+    {"qtype: ?", "qtype: Unknown"});
+
 /**
- * @brief Get the class/qclass description in a given string
+ * @brief Get the class/qclass description
  * 
- * @param desc 
+ * @param data_class 
  * @param verbose 
+ * @return std::string_view 
  */
-void
-get_class_desc(uint16_t data_class, std::string& desc, bool verbose){
-    // https://datatracker.ietf.org/doc/html/rfc1035#section-3.2.4
-    switch(data_class){
-        case CLASS_IN:
-            if (verbose){
-                desc = "IN (" + std::to_string(data_class) + ") the Internet";
-            } else {
-                desc = "IN";
-            }
-            break;
-        case CLASS_CH:
-            if (verbose){
-                desc = "CH (" + std::to_string(data_class) + ") the CHAOS class";
-            } else {
-                desc = "CH";
-            }
-            break;
-        case CLASS_HS:
-            if (verbose){
-                desc = "HS (" + std::to_string(data_class) + ") Hesiod";
-            } else {
-                desc = "HS";
-            }
-            break;
-        default:
-            if (verbose){
-                desc = "class: Unknown (" + std::to_string(data_class) + ")";
-            } else {
-                desc = "class: ?";
-            }
-            break;
-    }
+std::string_view
+get_class_desc(uint16_t data_class, bool verbose)
+{
+    return desc_lookup(dns_class_table, data_class, verbose);
 }
 
 /**
- * @brief Get the type/qtype description in a given string
+ * @brief Get the type/qtype description
  * 
  * @param type 
- * @param desc 
  * @param verbose 
+ * @return std::string_view 
  */
-void 
-get_type_desc(uint16_t type, std::string& desc, bool verbose)
+std::string_view
+get_type_desc(uint16_t type, bool verbose)
 {
-    // https://datatracker.ietf.org/doc/html/rfc1035#section-3.2.2
-    switch(type){
-        case TYPE_A:
-            if (verbose){
-                desc = "A (" + std::to_string(type) + ") host address";
-            } else {
-                desc = "A";
-            }
-            break;
-        case TYPE_NS:
-            if (verbose){
-                desc = "NS (" + std::to_string(type) + ") authoritative name server";
-            } else {
-                desc = "NS";
-            }
-            break;
-        case TYPE_CNAME:
-            if (verbose){
-                desc = "CNAME (" + std::to_string(type) + ") canonical name";
-            } else {
-                desc = "CNAME";
-            }
-            break;
-        case TYPE_SOA:
-            if (verbose){
-                desc = "SOA (" + std::to_string(type) + ") zone of authority";
-            } else {
-                desc = "SOA";
-            }
-            break;
-        case TYPE_PTR:
-            if (verbose){
-                desc = "PTR (" + std::to_string(type) + ") domain name pointer";
-            } else {
-                desc = "PTR";
-            }
-            break;
-        case TYPE_HINFO:
-            if (verbose){
-                desc = "HINFO (" + std::to_string(type) + ") host information";
-            } else {
-                desc = "HINFO";
-            }
-            break;
-        case TYPE_MINFO:
-            if (verbose){
-                desc = "MINFO (" + std::to_string(type) + ") mailbox or mail list information";
-            } else {
-                desc = "MINFO";
-            }
-            break;
-        case TYPE_MX:
-            if (verbose){
-                desc = "MX (" + std::to_string(type) + ") mail exchange";
-            } else {
-                desc = "MX";
-            }
-            break;
-        case TYPE_TXT:
-            if (verbose){
-                desc = "TXT (" + std::to_string(type) + ") text strings";
-            } else {
-                desc = "TXT";
-            }
-            break;
-        case TYPE_HTTPS:
-            if (verbose){
-                desc = "HTTPS (" + std::to_string(type) + ") Specific Service Endpoints";
-            } else {
-                desc = "HTTPS";
-            }
-            break;
-        default:
-            if (verbose){
-                desc = "qtype: Unknown (" + std::to_string(type) + ")";
-            } else {
-                desc = "qtype: ?";
-            }
-            break;
-    }
+    return desc_lookup(dns_type_table, type, verbose);
 }
 
 /**
- * @brief Get the dns qnames in a string and return the number of bytes read
+ * @brief Get a domain name in dotted form: labels, ended by a zero
+ * length or by a pointer to the rest of the name elsewhere in the
+ * message (https://datatracker.ietf.org/doc/html/rfc1035#section-4.1.4)
  * 
- * @param packet 
- * @param question_section 
- * @return int 
+ * The labels are any bytes, the name is written as in a zone file
+ * (https://datatracker.ietf.org/doc/html/rfc1035#section-5.1): a byte
+ * that isn't printable ASCII as \DDD, a dot or a backslash in a label
+ * as \. or \\. It is plain ASCII, whole up to its '\0', for every
+ * output.
+ * 
+ * @param cursor at the name, moved past it, past the first pointer if any
+ * @param message the whole message, the pointers are offsets from its start
+ * @param arena 
+ * @return const char* the name in the arena, NULL if it is cut by the
+ * capture, too long, or has a pointer that doesn't go backwards
  */
-int
-get_dns_qname(uint8_t *packet, question_section_t *question_section)
+const char*
+get_dns_name(packet_cursor_t *cursor, const packet_cursor_t *message, arena_t *arena)
 {
-    int i = 0;
-    std::string qname;
-    while (packet[i] != 0) {
-        int label_length = packet[i];
-        if (label_length == 0 || label_length > DNS_NAME_MAX_SIZE) {
-            throw std::runtime_error("Invalid label length in DNS qname");
+    // 4 characters a byte at most
+    char name[DNS_NAME_MAX_SIZE * 4 + 1];
+    size_t length = 0;
+    size_t wire_length = 0;
+    packet_cursor_t reader = *cursor;
+    bool jumped = false;
+    // a pointer must go before the name it is in, a loop can't go on forever
+    uint32_t name_start = packet_cursor_offset(message, &reader);
+    for (;;){
+        uint8_t label_length = packet_cursor_u8(&reader);
+        if (reader.truncated){
+            cursor->truncated = true;
+            return NULL;
         }
-        if (i + label_length + 1 > DNS_NAME_MAX_SIZE) {
-            throw std::runtime_error("QName exceeds maximum allowed size");
+        if (label_length == 0){
+            break;
         }
-        if (!qname.empty()) {
-            qname += '.';
+        if ((label_length & 0xC0) == 0xC0){
+            uint32_t offset = ((label_length & 0x3F) << 8) | packet_cursor_u8(&reader);
+            if (reader.truncated || offset >= name_start){
+                cursor->truncated = true;
+                return NULL;
+            }
+            if (!jumped){
+                // the name in the record ends with its first pointer
+                *cursor = reader;
+                jumped = true;
+            }
+            reader = packet_cursor_at(message, offset);
+            name_start = offset;
+            continue;
         }
-        qname.append(reinterpret_cast<char*>(packet + i + 1), label_length);
-        i += label_length + 1;
-    }
-    question_section->qname = qname;
-    return i + 1;
-}
-
-/**
- * @brief Get the dns qnames in a string and return the number of bytes read
- * 
- * @param packet 
- * @param question_section 
- * @return int 
- */
-int
-get_dns_name(uint8_t *packet, resource_record_t *resource_record)
-{
-    int i = 0;
-    std::string name;
-    while (packet[i] != 0) {
-        int label_length = packet[i];
-        if (label_length == 0 || label_length > DNS_LABEL_MAX_SIZE) {
-            throw std::runtime_error("Invalid label length in DNS name");
+        if (label_length > DNS_LABEL_MAX_SIZE || wire_length + 1 + label_length > DNS_NAME_MAX_SIZE){
+            cursor->truncated = true;
+            return NULL;
+        }
+        const uint8_t *label = packet_cursor_bytes(&reader, label_length);
+        if (label == NULL){
+            cursor->truncated = true;
+            return NULL;
         }
-        if (i + label_length + 1 > DNS_NAME_MAX_SIZE) {
-            throw std::runtime_error("Name exceeds maximum allowed size");
+        if (length > 0) {
+            name[length++] = '.';
         }
-        if (!name.empty()) {
-            name += '.';
+        for (uint8_t i = 0; i < label_length; i++){
+            uint8_t byte = label[i];
+            if (byte == '.' || byte == '\\'){
+                name[length++] = '\\';
+                name[length++] = byte;
+            } else if (byte > 0x20 && byte < 0x7f){
+                name[length++] = byte;
+            } else {
+                name[length++] = '\\';
+                name[length++] = '0' + byte / 100;
+                name[length++] = '0' + byte / 10 % 10;
+                name[length++] = '0' + byte % 10;
+            }
         }
-        name.append(reinterpret_cast<char*>(packet + i + 1), label_length);
-        i += label_length + 1;
+        wire_length += (wire_length > 0) + label_length;
     }
-    resource_record->name = name;
-    return i + 1;
+    if (!jumped){
+        *cursor = reader;
+    }
+    return arena_strndup(arena, name, length);
 }
 
 /**
- * @brief Get the ra description in a given string
+ * @brief Get the ra description
  * 
  * @param ra 
- * @param desc 
  * @param verbose 
+ * @return std::string_view 
  */
-void
-get_ra_desc(uint8_t ra, std::string& desc, bool verbose)
+std::string_view
+get_ra_desc(uint8_t ra, bool verbose)
 {
-    switch(ra){
-        case 1:
-            if (verbose){
-                desc = "Recursion available (" + std::to_string(ra) + ")";
-            } else {
-                desc = "Rec";
-            }
-            break;
-    }
+    return desc_lookup(dns_ra_table, ra, verbose);
 }
 
 /**
- * @brief Get the rd description in a given string
+ * @brief Get the rd description
  * 
  * @param rd 
- * @param desc 
  * @param verbose 
+ * @return std::string_view 
  */
-void
-get_rd_desc(uint8_t rd, std::string& desc, bool verbose)
+std::string_view
+get_rd_desc(uint8_t rd, bool verbose)
 {
-    switch(rd){
-        case 1:
-            if (verbose){
-                desc = "Recursion desired (" + std::to_string(rd) + ")";
-            } else {
-                desc = "Recursion";
-            }
-            break;
-    }
+    return desc_lookup(dns_rd_table, rd, verbose);
 }
 
-
 /**
- * @brief Get the tc description in a given string
+ * @brief Get the tc description
  * 
  * @param tc 
- * @param desc 
  * @param verbose 
+ * @return std::string_view 
  */
-void
-get_tc_desc(uint8_t tc, std::string& desc, bool verbose)
+std::string_view
+get_tc_desc(uint8_t tc, bool verbose)
 {
-    switch(tc){
-        case 1:
-            if (verbose){
-                desc = "Truncated (" + std::to_string(tc) + ")";
-            } else {
-                desc = "Trunc";
-            }
-            break;
-    }
+    return desc_lookup(dns_tc_table, tc, verbose);
 }
 
-
 /**
- * @brief Get the aa description in a given string
+ * @brief Get the aa description
  * 
  * @param aa 
- * @param desc 
  * @param verbose 
+ * @return std::string_view 
  */
-void
-get_aa_desc(uint8_t aa, std::string& desc, bool verbose)
+std::string_view
+get_aa_desc(uint8_t aa, bool verbose)
 {
-    switch(aa){
-        case 1:
-            if (verbose){
-                desc = "Authoritative (" + std::to_string(aa) + ")";
-            } else {
-                desc = "Auth";
-            }
-            break;
-    }
+    return desc_lookup(dns_aa_table, aa, verbose);
 }
 
 /**
- * @brief Get the rcode description in a given string
+ * @brief Get the rcode description
  * 
  * @param rcode 
- * @param desc 
  * @param verbose 
+ * @return std::string_view 
  */
-void
-get_rcode_desc(uint8_t rcode, std::string& desc, bool verbose)
-{   
-    // https://datatracker.ietf.org/doc/html/rfc1035#section-4.1.1
-    switch(rcode){
-        case RCODE_NO_ERROR:
-            if (verbose){
-                desc = "No error (" + std::to_string(rcode) + ")";
-            } else {
-                desc = "res: 0 !";
-            }
-            break;
-        case RCODE_FORMAT_ERROR:
-            if (verbose){
-                desc = "Format error (" + std::to_string(rcode) + ")";
-            } else {
-                desc = "res: format !";
-            }
-            break;
-        case RCODE_SERVER_FAILURE:
-            if (verbose){
-                desc = "Server failure (" + std::to_string(rcode) + ")";
-            } else {
-                desc = "res: server !";
-            }
-            break;
-        case RCODE_NAME_ERROR:
-            if (verbose){
-                desc = "Name error (" + std::to_string(rcode) + ")";
-            } else {
-                desc = "res: name !";
-            }
-            break;
-        case RCODE_NOT_IMPLEMENTED:
-            if (verbose){
-                desc = "Not implemented (" + std::to_string(rcode) + ")";
-            } else {
-                desc = "res: !impl";
-            }
-            break;
-        case RCODE_REFUSED:
-            if (verbose){
-                desc = "Refused (" + std::to_string(rcode) + ")";
-            } else {
-                desc = "res: X";
-            }
-            break;
-        default:
-            if (verbose){
-                desc = "Unknown (" + std::to_string(rcode) + ")";
-            } else {
-                desc = "res: ?";
-            }
-            break;
-    }
+std::string_view
+get_rcode_desc(uint8_t rcode, bool verbose)
+{
+    return desc_lookup(dns_rcode_table, rcode, verbose);
 }
 
 /**
- * @brief Get the qr description in a given string
+ * @brief Get the qr description
  * 
  * @param qr 
- * @param desc 
  * @param verbose 
+ * @return std::string_view 
  */
-void
-get_qr_desc(uint8_t qr, std::string& desc, bool verbose)
+std::string_view
+get_qr_desc(uint8_t qr, bool verbose)
 {
-    switch(qr){
-        case QR_QUERY:
-            if (verbose){
-                desc = "Query (" + std::to_string(qr) + ")";
-            } else {
-                desc = "QUERY";
-            }
-            break;
-        case QR_RESPONSE:
-            if (verbose){
-                desc = "Response (" + std::to_string(qr) + ")";
-            } else {
-                desc = "RESPONSE";
-            }
-            break;
-    }
+    return desc_lookup(dns_qr_table, qr, verbose);
 }
 
-
 /**
- * @brief Get the opcode description in a given string
+ * @brief Get the opcode description
  * 
- * @param opcode
- * @param desc 
+ * @param opcode 
  * @param verbose 
+ * @return std::string_view 
  */
-void
-get_opcode_desc(uint8_t opcode, std::string& desc, bool verbose)
+std::string_view
+get_opcode_desc(uint8_t opcode, bool verbose)
 {
-    switch(opcode){
-        case OP_QUERY:
-            if (verbose){
-                desc = "Message has: Standard query (" + std::to_string(opcode) + ")";
-            } else {
-                desc = "op: QUERY";
-            }
-            break;
-        case OP_IQUERY:
-            if (verbose){
-                desc = "Message has: Inverse query (" + std::to_string(opcode) + ")";
-            } else {
-                desc = "op: IQUERY";
-            }
-            break;
-        case OP_STATUS:
-            if (verbose){
-                desc = "Message has: Server status request (" + std::to_string(opcode) + ")";
-            } else {
-                desc = "op: STATUS";
-            }
-            break;
-        default:
-            if (verbose){
-                desc = "Message has: Unknown (" + std::to_string(opcode) + ")";
-            } else {
-                desc = "op: ?";
-            }
-            break;
-    }
+    return desc_lookup(dns_opcode_table, opcode, verbose);
 }
-
@@ -5,12 +5,16 @@
 #include <arpa/inet.h>
 #include <ctype.h>
 
-#include <string>
+#include <string_view>
 
-#include "linked_list.h"
+#include "arena.h"
+#include "small_vector.h"
+#include "packet_cursor.h"
 
 #define DNS_NAME_MAX_SIZE 255
 #define DNS_LABEL_MAX_SIZE 63
+#define DNS_HEADER_SIZE 12 // up to the section counts
+#define DNS_INLINE_RECORDS 4 // records of a section stored in the header, the others in the arena
 
 #define PORT_DNS 53
 
@@ -120,33 +124,37 @@ https://datatracker.ietf.org/doc/html/rfc1035#section-4.1.1
 #define IS_AUTHORITY 1
 #define IS_ADDITIONAL 2
 
+// the sections, their records and their strings are in the arena given to parse_dns()
 typedef struct question_section {
-    std::string qname;   // a domain name represented as a sequence of labels, where each label consists of a length octet followed by that number of octets.
+    const char *qname;   // a domain name represented as a sequence of labels, where each label consists of a length octet followed by that number of octets.
     uint16_t qtype;  // a two octet code which specifies the type of the query.
-    std::string qtype_desc;
+    const char *qtype_desc;
     uint16_t qclass; // a two octet code that specifies the class of the query.
-    std::string qclass_desc;
+    const char *qclass_desc;
 } question_section_t;
 
 typedef struct resource_record {
-    std::string name;    // a domain name to which this resource record pertains.
+    const char *name;    // a domain name to which this resource record pertains.
     uint16_t type;   // two octets containing one of the RR type codes.
-    std::string type_desc;
+    const char *type_desc;
     uint16_t data_class;  // two octets which specify the class of the data in the RDATA field.
-    std::string class_desc;
+    const char *class_desc;
     uint32_t ttl;    
     uint16_t rdlength; // the length in octets of the RDATA field.
     uint8_t* rdata; 
-    std::string rdata_desc;
+    const char *rdata_desc;
 } resource_record_t;
 
+SMALL_VECTOR(dns_questions, question_section_t, DNS_INLINE_RECORDS)
+SMALL_VECTOR(dns_records, resource_record_t, DNS_INLINE_RECORDS)
+
 typedef struct my_dns_header {
     uint16_t transaction_id;
 
     // A one bit field that specifies whether this message is a
     // query (0), or a response (1).
     uint8_t qr:1;
-    std::string qr_desc;
+    std::string_view qr_desc;
 
     // A four bit field that specifies kind of query in this
     // message.  This value is set by the originator of a query
@@ -156,57 +164,55 @@ typedef struct my_dns_header {
     // 2 a server status request (STATUS)
     // 3-15 reserved for future use
     uint8_t opcode;
-    std::string opcode_desc;
+    std::string_view opcode_desc;
 
     uint8_t aa:1; // Authoritative Answer, valid in responses
-    std::string aa_desc;
+    std::string_view aa_desc;
 
     uint8_t tc:1; // TrunCation, set if message was truncated
-    std::string tc_desc;
+    std::string_view tc_desc;
     uint8_t rd:1; // Recursion Desired (set in a query and copied into the response)
                   // In a response, it specifies that the server can do recursive queries
-    std::string rd_desc;
+    std::string_view rd_desc;
     uint8_t ra:1; // Recursion Available, (set or cleared in a response)
-    std::string ra_desc;
+    std::string_view ra_desc;
 
     uint8_t z:3;  // Reserved for future use
     
     uint8_t rcode:4; // Response code
-    std::string rcode_desc;
+    std::string_view rcode_desc;
 
     uint16_t qdcount; // the number of entries in the question section.
     uint16_t ancount; // the number of resource records in the answer section.
     uint16_t nscount; // the number of name server resource records in the authority records section.
     uint16_t arcount; // the number of resource records in the additional records section.
 
-    node_t* question_section;
-    node_t* answer_section;
-    node_t* authority_section;
-    node_t* additional_section;
+    dns_questions_t question_section;
+    dns_records_t answer_section;
+    dns_records_t authority_section;
+    dns_records_t additional_section;
 
+    bool truncated; // the sections stop early, cut by the capture or malformed
 } my_dns_header_t;
 
-my_dns_header_t parse_dns(uint8_t *packet, bool verbose);
-void free_dns_header(my_dns_header_t *dns_header);
+my_dns_header_t parse_dns(const uint8_t *packet, uint32_t length, arena_t *arena, bool verbose);
+my_dns_header_t parse_dns_header(const uint8_t *packet, uint32_t length, bool verbose);
 // helpers
-// void get_dns_name(const uint8_t *packet, my_dns_header_t *dns_header);
-
-void get_ra_desc(uint8_t ra, std::string& desc, bool verbose);
-void get_rd_desc(uint8_t rd, std::string& desc, bool verbose);
-void get_tc_desc(uint8_t tc, std::string& desc, bool verbose);
-void get_aa_desc(uint8_t aa, std::string& desc, bool verbose);
-void get_rcode_desc(uint8_t rcode, std::string& desc, bool verbose);
-void get_opcode_desc(uint8_t opcode, std::string& desc, bool verbose);
-void get_qr_desc(uint8_t qr, std::string& desc, bool verbose);
-void get_class_desc(uint16_t data_class, std::string& desc, bool verbose);
-void get_type_desc(uint16_t type, std::string& desc, bool verbose);
-void process_rdata(uint8_t *rdata, std::string& desc, size_t rdata_length);
-
-int get_dns_name(uint8_t *packet, resource_record_t *resource_record);
-int get_dns_qname(uint8_t *packet, question_section_t *question_section);
-int get_dns_question(uint8_t *packet, my_dns_header_t *dns_header, bool verbose);
-int get_dns_resource_record(uint8_t *packet, uint8_t *packet_init, my_dns_header_t *dns_header, int count, int dest, int advance, bool verbose);
-int get_dns_answer(uint8_t *packet, uint8_t *packet_init, my_dns_header_t *dns_header, int advance, bool verbose);
-int get_dns_authority(uint8_t *packet, uint8_t *packet_init, my_dns_header_t *dns_header, int advance, bool verbose);
-int get_dns_additional(uint8_t *packet, uint8_t *packet_init, my_dns_header_t *dns_header, int advance, bool verbose);
+std::string_view get_ra_desc(uint8_t ra, bool verbose);
+std::string_view get_rd_desc(uint8_t rd, bool verbose);
+std::string_view get_tc_desc(uint8_t tc, bool verbose);
+std::string_view get_aa_desc(uint8_t aa, bool verbose);
+std::string_view get_rcode_desc(uint8_t rcode, bool verbose);
+std::string_view get_opcode_desc(uint8_t opcode, bool verbose);
+std::string_view get_qr_desc(uint8_t qr, bool verbose);
+std::string_view get_class_desc(uint16_t data_class, bool verbose);
+std::string_view get_type_desc(uint16_t type, bool verbose);
+void process_rdata(const uint8_t *rdata, char *desc, size_t rdata_length);
+
+const char *get_dns_name(packet_cursor_t *cursor, const packet_cursor_t *message, arena_t *arena);
+bool get_dns_question(packet_cursor_t *cursor, const packet_cursor_t *message, my_dns_header_t *dns_header, arena_t *arena, bool verbose);
+bool get_dns_resource_record(packet_cursor_t *cursor, const packet_cursor_t *message, my_dns_header_t *dns_header, int count, int what, arena_t *arena, bool verbose);
+bool get_dns_answer(packet_cursor_t *cursor, const packet_cursor_t *message, my_dns_header_t *dns_header, arena_t *arena, bool verbose);
+bool get_dns_authority(packet_cursor_t *cursor, const packet_cursor_t *message, my_dns_header_t *dns_header, arena_t *arena, bool verbose);
+bool get_dns_additional(packet_cursor_t *cursor, const packet_cursor_t *message, my_dns_header_t *dns_header, arena_t *arena, bool verbose);
 #endif
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "dns.h"
 #include <cassert>
+#include <cstring>
 
 void test_parse_dns_simple()
 {
@@ -12,7 +13,9 @@ void test_parse_dns_simple()
     0x00, 0x01
     };
 
-    my_dns_header_t dns_header = parse_dns(dns_packet, false);
+    arena_t arena;
+    arena_init(&arena, 0);
+    my_dns_header_t dns_header = parse_dns(dns_packet, sizeof(dns_packet), &arena, false);
     assert(dns_header.transaction_id == 0x019f);
     assert(dns_header.qr == 0);
     assert(dns_header.qr_desc == "QUERY");
@@ -30,15 +33,15 @@ void test_parse_dns_simple()
     assert(dns_header.nscount == 0);
     assert(dns_header.arcount == 0);
 
-    node_t *tmp = dns_header.question_section;
-    for (; tmp != NULL; tmp = tmp->next){
-        question_section_t *question_section = (question_section_t*)tmp->data;
-        assert(question_section->qname == "95.6.192.10.in-addr.arpa");
+    for (uint32_t i = 0; i < dns_header.question_section.count; i++){
+        question_section_t *question_section = &dns_questions_items(&dns_header.question_section)[i];
+        assert(strcmp(question_section->qname, "95.6.192.10.in-addr.arpa") == 0);
         assert(question_section->qtype == 12);
-        assert(question_section->qtype_desc == "PTR");
+        assert(strcmp(question_section->qtype_desc, "PTR") == 0);
         assert(question_section->qclass == 1);
-        assert(question_section->qclass_desc == "IN");
+        assert(strcmp(question_section->qclass_desc, "IN") == 0);
     }
+    arena_destroy(&arena);
 }
 
 void test_parse_dns_complex()
@@ -71,7 +74,9 @@ void test_parse_dns_complex()
         0x7,  0x8,  0x0,  0x0,  0x1,  0x2c, 0x0,  0x0, 
         0xec, 0x40, 0x0,  0x0,  0x1,  0x2c};
 
-    my_dns_header_t dns_header = parse_dns(dns_packet, false);
+    arena_t arena;
+    arena_init(&arena, 0);
+    my_dns_header_t dns_header = parse_dns(dns_packet, sizeof(dns_packet), &arena, false);
     assert(dns_header.transaction_id == 0x4e0f);
     assert(dns_header.qr == 1);
     assert(dns_header.qr_desc == "RESPONSE");
@@ -88,55 +93,237 @@ void test_parse_dns_complex()
     assert(dns_header.ancount == 2);
     assert(dns_header.nscount == 1);
     assert(dns_header.arcount == 0);
+    assert(!dns_header.truncated);
 
     // test the question
-    node_t *tmp = dns_header.question_section;
-    question_section_t *question_section = (question_section_t*)tmp->data;
-    assert(question_section->qname == "valid.apple.com");
+    assert(dns_header.question_section.count == 1);
+    question_section_t *question_section = dns_questions_items(&dns_header.question_section);
+    assert(strcmp(question_section->qname, "valid.apple.com") == 0);
     assert(question_section->qtype == 65);
-    assert(question_section->qtype_desc == "HTTPS");
+    assert(strcmp(question_section->qtype_desc, "HTTPS") == 0);
     assert(question_section->qclass == 1);
-    assert(question_section->qclass_desc == "IN");
+    assert(strcmp(question_section->qclass_desc, "IN") == 0);
 
     // test the answers (2)
-    tmp = dns_header.answer_section;
-    resource_record_t *answer_section = (resource_record_t*)tmp->data;
+    assert(dns_header.answer_section.count == 2);
+    resource_record_t *answer_section = dns_records_items(&dns_header.answer_section);
+    assert(strcmp(answer_section->name, "valid.apple.com") == 0);
     assert(answer_section->type == 5);
-    assert(answer_section->type_desc == "CNAME");
+    assert(strcmp(answer_section->type_desc, "CNAME") == 0);
     assert(answer_section->data_class == 1);
-    assert(answer_section->class_desc == "IN");
+    assert(strcmp(answer_section->class_desc, "IN") == 0);
     assert(answer_section->ttl == 5972);
     assert(answer_section->rdlength == 35);
-    assert(answer_section->rdata_desc == ".valid.origin-apple.com.akadns.net.");
+    assert(strcmp(answer_section->rdata_desc, ".valid.origin-apple.com.akadns.net.") == 0);
 
-    tmp = dns_header.answer_section->next;
-    answer_section = (resource_record_t*)tmp->data;
+    answer_section = &dns_records_items(&dns_header.answer_section)[1];
     assert(answer_section->type == 5);
-    assert(answer_section->type_desc == "CNAME");
+    assert(strcmp(answer_section->type_desc, "CNAME") == 0);
     assert(answer_section->data_class == 1);
-    assert(answer_section->class_desc == "IN");
+    assert(strcmp(answer_section->class_desc, "IN") == 0);
     assert(answer_section->ttl == 0);
     assert(answer_section->rdlength == 27);
-    assert(answer_section->rdata_desc == ".valid-apple.g.aaplimg.com.");
+    assert(strcmp(answer_section->rdata_desc, ".valid-apple.g.aaplimg.com.") == 0);
 
 
     // test the authority (1)
-    tmp = dns_header.authority_section;
-    resource_record_t *authority_section = (resource_record_t*)tmp->data;
+    assert(dns_header.authority_section.count == 1);
+    assert(dns_header.additional_section.count == 0);
+    resource_record_t *authority_section = dns_records_items(&dns_header.authority_section);
+    assert(strcmp(authority_section->name, "g.aaplimg.com") == 0);
     assert(authority_section->type == 6);
-    assert(authority_section->type_desc == "SOA");
+    assert(strcmp(authority_section->type_desc, "SOA") == 0);
     assert(authority_section->data_class == 1);
-    assert(authority_section->class_desc == "IN");
+    assert(strcmp(authority_section->class_desc, "IN") == 0);
     assert(authority_section->ttl == 289);
     assert(authority_section->rdlength == 62);
-    assert(authority_section->rdata_desc == ".a.gslb.aaplimg.com..hostmaster.apple.com.f..........,...@...,");
+    assert(strcmp(authority_section->rdata_desc, ".a.gslb.aaplimg.com..hostmaster.apple.com.f..........,...@...,") == 0);
 
-    free_dns_header(&dns_header);
+    arena_destroy(&arena);
+}
+
+void test_parse_dns_many_records()
+{
+    // a response to "a.b" A with 300 answers, each pointing back at the question
+    const int answers = 300;
+    uint8_t dns_packet[12 + 9 + answers * 16];
+    uint8_t header[] = {
+        0x12, 0x34, 0x81, 0x80, 0x00, 0x01, (uint8_t)(answers >> 8), (uint8_t)answers,
+        0x00, 0x00, 0x00, 0x00,
+        0x01, 'a', 0x01, 'b', 0x00, 0x00, 0x01, 0x00, 0x01
+    };
+    memcpy(dns_packet, header, sizeof(header));
+    for (int i = 0; i < answers; i++){
+        uint8_t answer[] = {
+            0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x04,
+            10, 0, (uint8_t)(i >> 8), (uint8_t)i
+        };
+        memcpy(dns_packet + sizeof(header) + i * sizeof(answer), answer, sizeof(answer));
+    }
+
+    arena_t arena;
+    arena_init(&arena, 0);
+    my_dns_header_t dns_header = parse_dns(dns_packet, sizeof(dns_packet), &arena, false);
+    assert(dns_header.ancount == answers);
+    assert(dns_header.answer_section.count == answers);
+    assert(dns_header.answer_section.spilled != NULL);
+
+    // in order, one after the other
+    resource_record_t *records = dns_records_items(&dns_header.answer_section);
+    for (int i = 0; i < answers; i++){
+        assert(strcmp(records[i].name, "a.b") == 0);
+        assert(records[i].type == TYPE_A);
+        assert(records[i].ttl == 3600);
+        assert(records[i].rdlength == 4);
+        assert(records[i].rdata[2] == (uint8_t)(i >> 8) && records[i].rdata[3] == (uint8_t)i);
+    }
+    arena_destroy(&arena);
+}
+
+void test_parse_dns_truncated()
+{
+    // a response to "www.a.b" A, the answers' names are "www" then a pointer to "a.b"
+    const uint8_t dns_packet[] = {
+        0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+        0x03, 'w', 'w', 'w', 0x01, 'a', 0x01, 'b', 0x00, 0x00, 0x01, 0x00, 0x01,
+        0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x04, 10, 0, 0, 1,
+        0x03, 'f', 't', 'p', 0xc0, 0x10, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x04, 10, 0, 0, 2,
+    };
+    const uint32_t question_end = 25;
+    const uint32_t first_answer_end = question_end + 16;
+
+    arena_t arena;
+    arena_init(&arena, 0);
+    my_dns_header_t dns_header = parse_dns(dns_packet, sizeof(dns_packet), &arena, false);
+    assert(!dns_header.truncated);
+    assert(dns_header.answer_section.count == 2);
+    resource_record_t *records = dns_records_items(&dns_header.answer_section);
+    assert(strcmp(records[0].name, "www.a.b") == 0);
+    assert(strcmp(records[1].name, "ftp.a.b") == 0);
+    assert(records[1].rdata[3] == 2);
+
+    // cut anywhere, as a small snaplen would: only what was captured whole is there
+    for (uint32_t length = 0; length < sizeof(dns_packet); length++){
+        arena_reset(&arena);
+        dns_header = parse_dns(dns_packet, length, &arena, false);
+        if (length < DNS_HEADER_SIZE){
+            assert(dns_header.qdcount == 0);
+            continue;
+        }
+        assert(dns_header.truncated);
+        assert(dns_header.ancount == 2);
+        assert(dns_header.question_section.count == (length >= question_end ? 1 : 0));
+        assert(dns_header.answer_section.count == (length >= first_answer_end ? 1 : 0));
+    }
+    arena_destroy(&arena);
+}
+
+void test_parse_dns_bad_pointers()
+{
+    // the answer's name points at itself
+    uint8_t dns_packet[] = {
+        0x12, 0x34, 0x81, 0x80, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+        0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x04, 10, 0, 0, 1,
+    };
+    arena_t arena;
+    arena_init(&arena, 0);
+    my_dns_header_t dns_header = parse_dns(dns_packet, sizeof(dns_packet), &arena, false);
+    assert(dns_header.truncated);
+    assert(dns_header.answer_section.count == 0);
+
+    // forwards, past the end of the message
+    dns_packet[12] = 0xff;
+    dns_packet[13] = 0xff;
+    arena_reset(&arena);
+    dns_header = parse_dns(dns_packet, sizeof(dns_packet), &arena, false);
+    assert(dns_header.truncated);
+    assert(dns_header.answer_section.count == 0);
+
+    // a label longer than 63
+    dns_packet[12] = 0x40;
+    arena_reset(&arena);
+    dns_header = parse_dns(dns_packet, sizeof(dns_packet), &arena, false);
+    assert(dns_header.truncated);
+    assert(dns_header.answer_section.count == 0);
+    arena_destroy(&arena);
+}
+
+void test_parse_dns_header_only()
+{
+    // the truncated test's response, its header alone
+    const uint8_t dns_packet[] = {
+        0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+        0x03, 'w', 'w', 'w', 0x01, 'a', 0x01, 'b', 0x00, 0x00, 0x01, 0x00, 0x01,
+    };
+    my_dns_header_t dns_header = parse_dns_header(dns_packet, sizeof(dns_packet), false);
+    assert(dns_header.transaction_id == 0x1234);
+    assert(dns_header.qr == 1);
+    assert(dns_header.rd == 1 && dns_header.ra == 1);
+    assert(dns_header.qdcount == 1);
+    assert(dns_header.ancount == 2);
+    // the sections aren't read
+    assert(dns_header.question_section.count == 0);
+    assert(dns_header.answer_section.count == 0);
+
+    dns_header = parse_dns_header(dns_packet, DNS_HEADER_SIZE - 1, false);
+    assert(dns_header.qdcount == 0);
+}
+
+void test_parse_dns_large_codes()
+{
+    // a CAA (257) question, and the EDNS OPT record with a 1232 bytes payload in its class
+    const uint8_t dns_packet[] = {
+        0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+        0x01, 'a', 0x01, 'b', 0x00, 0x01, 0x01, 0x00, 0x01,
+        0x00, 0x00, 0x29, 0x04, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    };
+    arena_t arena;
+    arena_init(&arena, 0);
+    my_dns_header_t dns_header = parse_dns(dns_packet, sizeof(dns_packet), &arena, true);
+    question_section_t *question = dns_questions_items(&dns_header.question_section);
+    assert(question->qtype == 257);
+    assert(strcmp(question->qtype_desc, "qtype: Unknown (257)") == 0);
+    assert(strcmp(question->qclass_desc, "IN (1) the Internet") == 0);
+    assert(dns_header.additional_section.count == 1);
+    resource_record_t *opt = dns_records_items(&dns_header.additional_section);
+    assert(opt->data_class == 1232);
+    assert(strcmp(opt->class_desc, "class: Unknown (1232)") == 0);
+
+    // the short forms have no value, below the table or past it
+    dns_header = parse_dns(dns_packet, sizeof(dns_packet), &arena, false);
+    assert(strcmp(dns_questions_items(&dns_header.question_section)->qtype_desc, "qtype: ?") == 0);
+    assert(strcmp(dns_records_items(&dns_header.additional_section)->class_desc, "class: ?") == 0);
+    arena_destroy(&arena);
+}
+
+void test_parse_dns_binary_labels()
+{
+    // a query for "caf\xe9", "a.b" as one label, a NUL and a space, "\\"
+    const uint8_t dns_packet[] = {
+        0x12, 0x34, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x04, 'c', 'a', 'f', 0xe9, 0x03, 'a', '.', 'b', 0x02, 0x00, ' ', 0x01, '\\', 0x00,
+        0x00, 0x01, 0x00, 0x01,
+    };
+    arena_t arena;
+    arena_init(&arena, 0);
+    my_dns_header_t dns_header = parse_dns(dns_packet, sizeof(dns_packet), &arena, false);
+    assert(!dns_header.truncated);
+    assert(dns_header.question_section.count == 1);
+    // as in a zone file, plain ASCII whole up to its end
+    const char *qname = dns_questions_items(&dns_header.question_section)->qname;
+    assert(strcmp(qname, "caf\\233.a\\.b.\\000\\032.\\\\") == 0);
+    arena_destroy(&arena);
 }
 
 int main()
 {
     // test_parse_dns_simple();
     test_parse_dns_complex();
+    test_parse_dns_many_records();
+    test_parse_dns_truncated();
+    test_parse_dns_bad_pointers();
+    test_parse_dns_header_only();
+    test_parse_dns_large_codes();
+    test_parse_dns_binary_labels();
     return 0;
 }
\ No newline at end of file
@@ -1,41 +1,47 @@
 
 #include "ethernet.h"
+#include "desc_table.h"
 
 /**
  * @brief Parse the ethernet header off a packet and
- * return all the information in a my_ethernet_header_t struct
+ * return all the information in a my_ethernet_header_t struct.
+ * The packet is only read.
  * 
  * @param packet 
- * @return my_ethernet_header_t 
+ * @param length bytes available from packet
+ * @return my_ethernet_header_t empty if the header doesn't fit in length
  */
 my_ethernet_header_t 
-parse_ethernet(const u_char *packet, bool verbose)
+parse_ethernet(const uint8_t *packet, uint32_t length, bool verbose)
 {
     const struct ether_header *ethernet;
-    int size_ethernet = sizeof(struct ether_header);
-    ethernet = (struct ether_header*)(packet);
+    uint32_t size_ethernet = sizeof(struct ether_header);
+    ethernet = (const struct ether_header*)(packet);
     
-    my_ethernet_header_t ethernet_frame;
-    ethernet_frame.src_mac = write_mac_address(ethernet->ether_shost);
-    ethernet_frame.dst_mac = write_mac_address(ethernet->ether_dhost);
+    my_ethernet_header_t ethernet_frame = {};
+    if (length < size_ethernet){
+        return ethernet_frame;
+    }
+    format_mac_address(ethernet->ether_shost, ethernet_frame.src_mac);
+    format_mac_address(ethernet->ether_dhost, ethernet_frame.dst_mac);
     ethernet_frame.type = ntohs(ethernet->ether_type);
 
-    get_ethertype_desc(ethernet_frame.type, ethernet_frame.type_desc, verbose);
+    ethernet_frame.type_desc = get_ethertype_desc(ethernet_frame.type, verbose);
 
     // check if the frame is VLAN tagged
-    if (ethernet_frame.type == 0x8100){
+    if (ethernet_frame.type == 0x8100 && length >= size_ethernet + 4){
         ethernet_frame.vlan_tagged = true;
 
         // extract VLAN ID and Priority Code Point, Drop Eligible Indicator 
         // source: https://en.wikipedia.org/wiki/IEEE_802.1Q
-        uint8_t vlan_tci = ntohs(*(uint16_t *)(packet + size_ethernet));
+        uint8_t vlan_tci = ntohs(*(const uint16_t *)(packet + size_ethernet));
         ethernet_frame.vlan_id = vlan_tci & 0x0FFF;
         ethernet_frame.dei = vlan_tci & 0x1000;
         ethernet_frame.pcp = vlan_tci & 0xE000;
 
         // get the actual ethernet type + 2 bytes after the VLAN stuff
-        ethernet_frame.type_vlan = ntohs(*(uint16_t *)(packet + size_ethernet + 2));
-        get_ethertype_desc(ethernet_frame.type_vlan, ethernet_frame.type_desc_vlan, verbose);
+        ethernet_frame.type_vlan = ntohs(*(const uint16_t *)(packet + size_ethernet + 2));
+        ethernet_frame.type_desc_vlan = get_ethertype_desc(ethernet_frame.type_vlan, verbose);
     } else {
         ethernet_frame.vlan_tagged = false;
     }
@@ -44,65 +50,66 @@ parse_ethernet(const u_char *packet, bool verbose)
 }
 
 /**
- * @brief Get the description of the ethernet type
+ * @brief Parse the ethernet header into a view, without allocating
  * 
- * @param type 
- * @param type_desc 
+ * @param packet 
+ * @param length bytes available from packet
+ * @param view 
+ * @return true if the header fits in length
  */
-void
-get_ethertype_desc(uint16_t type, std::string &type_desc, bool verbose)
+bool
+parse_ethernet_view(const uint8_t *packet, uint32_t length, my_ethernet_view_t *view)
 {
-    switch(type){
-        case ETHERTYPE_PUP:
-            if (verbose){
-                type_desc = "Type: PUP (0x" + std::to_string(ETHERTYPE_PUP) + ")";
-            } else {
-                type_desc = "PUP";
-            }
-            break;
-        case ETHERTYPE_IP:
-            if (verbose){
-                type_desc = "Type: IP (0x" + std::to_string(ETHERTYPE_IP) + ")";
-            } else {
-                type_desc = "IP";
-            }
-            break;
-        case ETHERTYPE_ARP:
-            if (verbose){
-                type_desc = "Type: ARP (0x" + std::to_string(ETHERTYPE_ARP) + ")";
-            } else {
-                type_desc = "ARP";
-            }
-            break;
-        case ETHERTYPE_REVARP:
-            if (verbose){
-                type_desc = "Type: Reverse ARP (0x" + std::to_string(ETHERTYPE_REVARP) + ")";
-            } else {
-                type_desc = "Reverse ARP";
-            }
-            break;
-        case ETHERTYPE_IPV6:
-            if (verbose){
-                type_desc = "Type: IPv6 (0x" + std::to_string(ETHERTYPE_IPV6) + ")";
-            } else {
-                type_desc = "IPv6";
-            }
-            break;
-        case ETHERTYPE_VLAN:
-            if (verbose){
-                type_desc = "Type: VLAN (0x" + std::to_string(ETHERTYPE_VLAN) + ")";
-            } else {
-                type_desc = "VLAN";
-            }
-            break;
-        default:
-            if (verbose){
-                type_desc = "Type: Unknown (0x" + std::to_string(type) + ")";
-            } else {
-                type_desc = "Unknown";
-            }
-            break;
+    if (length < ETHER_HDR_LEN){
+        return false;
     }
+    view->dst_mac = packet;
+    view->src_mac = packet + ETHER_ADDR_LEN;
+    view->type = (packet[12] << 8) | packet[13];
+    view->header_length = ETHER_HDR_LEN;
+    view->vlan_tagged = (view->type == ETHERTYPE_VLAN);
+
+    if (view->vlan_tagged){
+        if (length < ETHER_HDR_LEN + 4){
+            return false;
+        }
+        // https://en.wikipedia.org/wiki/IEEE_802.1Q
+        uint16_t vlan_tci = (packet[14] << 8) | packet[15];
+        view->vlan_id = vlan_tci & 0x0FFF;
+        view->dei = (vlan_tci >> 12) & 0x1;
+        view->pcp = (vlan_tci >> 13) & 0x7;
+        view->type_vlan = (packet[16] << 8) | packet[17];
+        view->header_length += 4;
+    } else {
+        view->vlan_id = 0;
+        view->dei = 0;
+        view->pcp = 0;
+        view->type_vlan = 0;
+    }
+    return true;
 }
 
+// the ethertypes known, their value in hexadecimal
+constexpr desc_entry_t ethertypes[] = {
+    {ETHERTYPE_PUP,    {"PUP",         "Type: PUP (0x200)"}},
+    {ETHERTYPE_IP,     {"IP",          "Type: IP (0x800)"}},
+    {ETHERTYPE_ARP,    {"ARP",         "Type: ARP (0x806)"}},
+    {ETHERTYPE_REVARP, {"Reverse ARP", "Type: Reverse ARP (0x8035)"}},
+    {ETHERTYPE_IPV6,   {"IPv6",        "Type: IPv6 (0x86dd)"}},
+    {ETHERTYPE_VLAN,   {"VLAN",        "Type: VLAN (0x8100)"}},
+};
+
+constexpr auto ethertype_table = make_desc_sparse(ethertypes, {"Unknown", "Type: Unknown"});
 
+/**
+ * @brief Get the description of the ethernet type
+ * 
+ * @param type 
+ * @param verbose 
+ * @return std::string_view 
+ */
+std::string_view
+get_ethertype_desc(uint16_t type, bool verbose)
+{
+    return desc_lookup(ethertype_table, type, verbose);
+}
@@ -6,30 +6,52 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <string>
+#include <string_view>
 
 #include "mac_address.h"
+#include "addr_format.h"
 
 #define MY_ETHER_TYPE_DESC_SIZE 32
 #define MY_ETHER_ADDRESS_SIZE 18
 
 typedef struct my_ethernet_header {
-    std::string src_mac;
-    std::string dst_mac;
+    char src_mac[MY_ETHER_ADDRESS_SIZE];
+    char dst_mac[MY_ETHER_ADDRESS_SIZE];
 
     uint16_t type;
-    std::string type_desc;
+    std::string_view type_desc;
     // VLAN
     bool vlan_tagged;
     uint16_t vlan_id;
     uint16_t pcp;
     uint16_t dei;
     uint16_t type_vlan;
-    std::string type_desc_vlan;
+    std::string_view type_desc_vlan;
 } my_ethernet_header_t;
 
-my_ethernet_header_t parse_ethernet(const u_char *packet, bool verbose);
+/*
+View of the header: raw values and pointers into the packet, nothing is
+allocated or rendered. The descriptions are built only by whoever prints
+them (get_ethertype_desc, format_mac_address).
+*/
+typedef struct my_ethernet_view {
+    const uint8_t *dst_mac; // ETHER_ADDR_LEN bytes
+    const uint8_t *src_mac;
+
+    uint16_t type;          // as on the wire, 0x8100 if VLAN tagged
+    bool vlan_tagged;
+    uint16_t vlan_id;
+    uint8_t pcp;
+    uint8_t dei;
+    uint16_t type_vlan;     // type after the VLAN tag
+
+    uint16_t header_length; // offset of the payload
+} my_ethernet_view_t;
+
+my_ethernet_header_t parse_ethernet(const uint8_t *packet, uint32_t length, bool verbose);
+bool parse_ethernet_view(const uint8_t *packet, uint32_t length, my_ethernet_view_t *view);
 
 // helpers
-void get_ethertype_desc(uint16_t type, std::string& type_desc, bool verbose);
+std::string_view get_ethertype_desc(uint16_t type, bool verbose);
 
 #endif
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <cstring>
 #include "ethernet.h"
 
 void
@@ -9,9 +10,9 @@ test_parse_ethernet()
         0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, // src mac
         0x08, 0x00 // type
     };
-    my_ethernet_header_t ethernet_frame = parse_ethernet(packet, true);
-    assert(ethernet_frame.src_mac == "66:77:88:99:aa:bb");
-    assert(ethernet_frame.dst_mac == "00:11:22:33:44:55");
+    my_ethernet_header_t ethernet_frame = parse_ethernet(packet, sizeof(packet), true);
+    assert(strcmp(ethernet_frame.src_mac, "66:77:88:99:aa:bb") == 0);
+    assert(strcmp(ethernet_frame.dst_mac, "00:11:22:33:44:55") == 0);
     assert(ethernet_frame.type == 0x0800);
     assert(ethernet_frame.type_desc == "Type: IP (0x800)");
 }
@@ -27,10 +28,10 @@ test_parse_ethernet_vlan()
         0x08, 0x00                          // Payload EtherType (IPv4)
     };
 
-    my_ethernet_header_t ethernet_frame = parse_ethernet(packet, true);
+    my_ethernet_header_t ethernet_frame = parse_ethernet(packet, sizeof(packet), true);
 
-    assert(ethernet_frame.src_mac == "66:77:88:99:aa:bb");
-    assert(ethernet_frame.dst_mac == "00:11:22:33:44:55");
+    assert(strcmp(ethernet_frame.src_mac, "66:77:88:99:aa:bb") == 0);
+    assert(strcmp(ethernet_frame.dst_mac, "00:11:22:33:44:55") == 0);
 
     assert(ethernet_frame.vlan_tagged == true);
     assert(ethernet_frame.vlan_id == 100); // VLAN ID
@@ -1,183 +1,136 @@
 #include "arp.h"
+#include "desc_table.h"
+
+#ifdef __APPLE__
+// the linux names
+#define ARPHRD_DLCI ARPHRD_FRELAY
+#define ARPHRD_EUI64 ARPHRD_IEEE1394_EUI64
+#define ARPOP_RREQUEST ARPOP_REVREQUEST
+#define ARPOP_RREPLY ARPOP_REVREPLY
+#define ARPOP_InREQUEST ARPOP_INVREQUEST
+#define ARPOP_InREPLY ARPOP_INVREPLY
+#endif
 
 /**
  * @brief Parse the ARP header from the packet and
- * return the parsed header
+ * return the parsed header. The packet is only read.
  * 
  * @param packet 
+ * @param length bytes available from packet
  * @param verbose 
- * @return my_arp_header_t 
+ * @return my_arp_header_t empty if the header doesn't fit in length
  */
 my_arp_header_t 
-parse_arp(const uint8_t *packet, bool verbose)
+parse_arp(const uint8_t *packet, uint32_t length, bool verbose)
 {
-    my_arp_header_t arp_header;
+    my_arp_header_t arp_header = {};
+    if (length < sizeof(struct ether_arp)){
+        return arp_header;
+    }
 
-    struct ether_arp *arp = (struct ether_arp *)packet; 
+    const struct ether_arp *arp = (const struct ether_arp *)packet; 
 
     arp_header.hardware_type = ntohs(arp->arp_hrd);
-    get_hardware_type_desc(arp_header.hardware_type, arp_header.hardware_type_desc, verbose);
+    arp_header.hardware_type_desc = get_hardware_type_desc(arp_header.hardware_type, verbose);
 
     arp_header.protocol_type = ntohs(arp->arp_pro);
     // The permitted PTYPE values share a numbering space with those for EtherType.
     // So we can use the same function to get the description
-    get_ethertype_desc(arp_header.protocol_type, arp_header.protocol_type_desc, verbose);
+    arp_header.protocol_type_desc = get_ethertype_desc(arp_header.protocol_type, verbose);
 
     arp_header.hardware_address_length = arp->arp_hln;
     arp_header.protocol_length = arp->arp_pln;
     
     arp_header.operation = ntohs(arp->arp_op);
     // get the operation description
-    get_operation_desc(arp_header.operation, arp_header.operation_desc, verbose);
+    arp_header.operation_desc = get_operation_desc(arp_header.operation, verbose);
 
     // get the sender hardware address
-    arp_header.sender_hardware_address = write_mac_address(arp->arp_sha);
+    format_mac_address(arp->arp_sha, arp_header.sender_hardware_address);
 
     // get the sender protocol address
-    char buffer[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, arp->arp_spa, buffer, INET_ADDRSTRLEN);
-    arp_header.sender_protocol_address = buffer;
+    format_ipv4_address(arp->arp_spa, arp_header.sender_protocol_address);
 
     // get the target hardware address
-    arp_header.target_hardware_address = write_mac_address(arp->arp_tha);
+    format_mac_address(arp->arp_tha, arp_header.target_hardware_address);
 
     // get the target protocol address
-    inet_ntop(AF_INET, arp->arp_tpa, buffer, INET_ADDRSTRLEN);
-    arp_header.target_protocol_address = buffer;
+    format_ipv4_address(arp->arp_tpa, arp_header.target_protocol_address);
 
     return arp_header;
 }
 
 /**
- * @brief Get the ARP operation description in a given string
+ * @brief Parse the ARP header into a view, without allocating
  * 
- * @param operation 
- * @param operation_desc 
+ * @param packet 
+ * @param length bytes available from packet
+ * @param view 
+ * @return true if the header fits in length
  */
-void
-get_operation_desc(uint16_t operation, std::string& operation_desc, bool verbose)
+bool
+parse_arp_view(const uint8_t *packet, uint32_t length, my_arp_view_t *view)
 {
-    switch(operation){
-        case ARPOP_REQUEST:
-            if (verbose){
-                operation_desc = "Operation: Request to resolve address";
-            } else {
-                operation_desc = "Request";
-            }
-            break; 
-        case ARPOP_REPLY:
-            if (verbose){
-                operation_desc = "Operation: Response to previous request";
-            } else {
-                operation_desc = "Reply";
-            }
-            break;
-        #ifdef __APPLE__
-        case ARPOP_REVREQUEST:
-        #endif
-        #ifdef __linux__
-        case ARPOP_RREQUEST:
-        #endif
-            if (verbose){
-                operation_desc = "Operation: Request protocol address given hardware";
-            } else {
-                operation_desc = "Reverse Request";
-            }
-            break;
-        #ifdef __APPLE__
-        case ARPOP_REVREPLY:
-        #endif
-        #ifdef __linux__
-        case ARPOP_RREPLY:
-        #endif
-            if (verbose){
-                operation_desc = "Operation: Response giving protocol address";
-            } else {
-                operation_desc = "Reverse Reply";
-            }
-            break;
-        #ifdef __APPLE__
-        case ARPOP_INVREQUEST:
-        #endif
-        #ifdef __linux__
-        case ARPOP_InREQUEST:
-        #endif
-            if (verbose){
-                operation_desc = "Operation: Request to identify peer";
-            } else {
-                operation_desc = "Inverse Request";
-            }
-            break;
-        #ifdef __APPLE__
-        case ARPOP_INVREPLY:
-        #endif
-        #ifdef __linux__
-        case ARPOP_InREPLY:
-        #endif
-            if (verbose){
-                operation_desc = "Operation: Response identifying peer";
-            } else {
-                operation_desc = "Inverse Reply";
-            }
-            break;
+    if (length < sizeof(struct ether_arp)){
+        return false;
     }
+    const struct ether_arp *arp = (const struct ether_arp *)packet;
+    view->hardware_type = ntohs(arp->arp_hrd);
+    view->protocol_type = ntohs(arp->arp_pro);
+    view->hardware_address_length = arp->arp_hln;
+    view->protocol_length = arp->arp_pln;
+    view->operation = ntohs(arp->arp_op);
+    view->sender_hardware_address = arp->arp_sha;
+    view->sender_protocol_address = arp->arp_spa;
+    view->target_hardware_address = arp->arp_tha;
+    view->target_protocol_address = arp->arp_tpa;
+    return true;
+}
+
+constexpr desc_entry_t arp_operations[] = {
+    {ARPOP_REQUEST,   {"Request",         "Operation: Request to resolve address"}},
+    {ARPOP_REPLY,     {"Reply",           "Operation: Response to previous request"}},
+    {ARPOP_RREQUEST,  {"Reverse Request", "Operation: Request protocol address given hardware"}},
+    {ARPOP_RREPLY,    {"Reverse Reply",   "Operation: Response giving protocol address"}},
+    {ARPOP_InREQUEST, {"Inverse Request", "Operation: Request to identify peer"}},
+    {ARPOP_InREPLY,   {"Inverse Reply",   "Operation: Response identifying peer"}},
+};
+
+// the others have no description
+constexpr auto arp_operation_table = make_desc_table<16>(arp_operations, {"", ""});
+
+constexpr desc_entry_t arp_hardware_types[] = {
+    {ARPHRD_ETHER,    {"Ethernet",        "Hardware type: Ethernet (1)"}},
+    {ARPHRD_IEEE802,  {"IEEE802",         "Hardware type: IEEE802 (6)"}},
+    {ARPHRD_DLCI,     {"Frame Relay",     "Hardware type: Frame Relay (15)"}},
+    {ARPHRD_IEEE1394, {"IEEE1394",        "Hardware type: IEEE1394 (24)"}},
+    {ARPHRD_EUI64,    {"IEEE1394 EUI-64", "Hardware type: IEEE1394 EUI-64 (27)"}},
+};
+
+constexpr auto arp_hardware_type_table = make_desc_table<32>(arp_hardware_types, {"", ""});
+
+/**
+ * @brief Get the ARP operation description
+ * 
+ * @param operation 
+ * @param verbose 
+ * @return std::string_view 
+ */
+std::string_view
+get_operation_desc(uint16_t operation, bool verbose)
+{
+    return desc_lookup(arp_operation_table, operation, verbose);
 }
 
 /**
- * @brief Get the ARP hardware type description in a given string
+ * @brief Get the ARP hardware type description
  * 
  * @param hardware_type 
- * @param hardware_type_desc 
  * @param verbose 
+ * @return std::string_view 
  */
-void
-get_hardware_type_desc(uint16_t hardware_type, std::string& hardware_type_desc, bool verbose)
+std::string_view
+get_hardware_type_desc(uint16_t hardware_type, bool verbose)
 {
-    switch(hardware_type){
-        case ARPHRD_ETHER:
-            if (verbose){
-                hardware_type_desc = "Hardware type: Ethernet (" + std::to_string(hardware_type) + ")";
-            } else {
-                hardware_type_desc = "Ethernet";
-            }
-            break;
-        case ARPHRD_IEEE802:
-            if (verbose){
-                hardware_type_desc = "Hardware type: IEEE802 (" + std::to_string(hardware_type) + ")";
-            } else {
-                hardware_type_desc = "IEEE802";
-            }
-            break;
-        #ifdef __APPLE__
-        case ARPHRD_FRELAY:
-        #endif
-        #ifdef __linux__
-        case ARPHRD_DLCI:
-        #endif
-            if (verbose){
-                hardware_type_desc = "Hardware type: Frame Relay (" + std::to_string(hardware_type) + ")";
-            } else {
-                hardware_type_desc = "Frame Relay";
-            }
-            break;
-        case ARPHRD_IEEE1394:
-            if (verbose){
-                hardware_type_desc = "Hardware type: IEEE1394 (" + std::to_string(hardware_type) + ")";
-            } else {
-                hardware_type_desc = "IEEE1394";
-            }
-            break;
-        #ifdef __APPLE__
-        case ARPHRD_IEEE1394_EUI64:
-        #endif
-        #ifdef __linux__
-        case ARPHRD_EUI64:
-        #endif
-            if (verbose){
-                hardware_type_desc = "Hardware type: IEEE1394 EUI-64 (" + std::to_string(hardware_type) + ")";
-            } else {
-                hardware_type_desc = "IEEE1394 EUI-64";
-            }
-            break;
-    }
-}
\ No newline at end of file
+    return desc_lookup(arp_hardware_type_table, hardware_type, verbose);
+}
@@ -16,29 +16,44 @@
 typedef struct my_arp_header
 {
     uint16_t hardware_type;
-    std::string hardware_type_desc;
+    std::string_view hardware_type_desc;
 
     uint16_t protocol_type;
-    std::string protocol_type_desc;
+    std::string_view protocol_type_desc;
 
     uint8_t hardware_address_length;
     uint8_t protocol_length;
     uint16_t operation;
-    std::string operation_desc;
+    std::string_view operation_desc;
 
-    std::string sender_hardware_address;
-    std::string sender_protocol_address;
+    char sender_hardware_address[MAC_ADDRESS_STRLEN];
+    char sender_protocol_address[IPV4_ADDRESS_STRLEN];
 
-    std::string target_hardware_address;
-    std::string target_protocol_address;
+    char target_hardware_address[MAC_ADDRESS_STRLEN];
+    char target_protocol_address[IPV4_ADDRESS_STRLEN];
 
 } my_arp_header_t;
 
-my_arp_header_t parse_arp(const uint8_t *packet, bool verbose);
+// raw fields of the header, pointers into the packet, nothing allocated
+typedef struct my_arp_view
+{
+    uint16_t hardware_type;
+    uint16_t protocol_type;
+    uint8_t hardware_address_length;
+    uint8_t protocol_length;
+    uint16_t operation;
+    const uint8_t *sender_hardware_address; // ETHER_ADDR_LEN bytes
+    const uint8_t *sender_protocol_address; // 4 bytes
+    const uint8_t *target_hardware_address;
+    const uint8_t *target_protocol_address;
+} my_arp_view_t;
+
+my_arp_header_t parse_arp(const uint8_t *packet, uint32_t length, bool verbose);
+bool parse_arp_view(const uint8_t *packet, uint32_t length, my_arp_view_t *view);
 
 // helpers
-void get_hardware_type_desc(uint16_t hardware_type, std::string& hardware_type_desc, bool verbose);
-void get_operation_desc(uint16_t operation, std::string& operation_desc, bool verbose);
+std::string_view get_hardware_type_desc(uint16_t hardware_type, bool verbose);
+std::string_view get_operation_desc(uint16_t operation, bool verbose);
 
 
 #endif
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "arp.h"
 #include <cassert>
+#include <cstring>
 
 void test_parse_arp()
 {
@@ -15,7 +16,7 @@ void test_parse_arp()
         0x05, 0x06, 0x07, 0x08              // Target IP address
     };
 
-    my_arp_header_t arp_header = parse_arp(packet, true);
+    my_arp_header_t arp_header = parse_arp(packet, sizeof(packet), true);
     assert(arp_header.hardware_type == 1);
     assert(arp_header.hardware_type_desc == "Hardware type: Ethernet (1)");
     assert(arp_header.protocol_type == 0x0800);
@@ -24,10 +25,10 @@ void test_parse_arp()
     assert(arp_header.protocol_length == 4);
     assert(arp_header.operation == 1);
     assert(arp_header.operation_desc == "Operation: Request to resolve address");
-    assert(arp_header.sender_hardware_address == "00:11:22:33:44:55");
-    assert(arp_header.sender_protocol_address == "1.2.3.4");
-    assert(arp_header.target_hardware_address == "66:77:88:99:aa:bb");
-    assert(arp_header.target_protocol_address == "5.6.7.8");
+    assert(strcmp(arp_header.sender_hardware_address, "00:11:22:33:44:55") == 0);
+    assert(strcmp(arp_header.sender_protocol_address, "1.2.3.4") == 0);
+    assert(strcmp(arp_header.target_hardware_address, "66:77:88:99:aa:bb") == 0);
+    assert(strcmp(arp_header.target_protocol_address, "5.6.7.8") == 0);
 }
 
 int main()
@@ -1,50 +1,71 @@
 #include "dscp.h"
+#include "desc_table.h"
+
+#ifdef __APPLE__
+#define IPTOS_ECN_NOT_ECT IPTOS_ECN_NOTECT
+#endif
+
+constexpr desc_entry_t ecns[] = {
+    {IPTOS_ECN_NOT_ECT, {"Not-ECT", "Not-ECT: Not ECN-Capable Transport"}},
+    {IPTOS_ECN_ECT0,    {"ECT(0)",  "ECT(0): ECN-Capable Transport (0)"}},
+    {IPTOS_ECN_ECT1,    {"ECT(1)",  "ECT(1): ECN-Capable Transport (1)"}},
+    {IPTOS_ECN_CE,      {"CE",      "CE: Congestion Experienced"}},
+};
+
+constexpr auto ecn_table = make_desc_table<4>(ecns, {"Invalid ECN value", "Invalid ECN value"});
+
+constexpr desc_entry_t dscps[] = {
+    /*
+    DSCP Class Selector - informations based on:
+    https://datatracker.ietf.org/doc/html/rfc4594 [Page 19]
+    */
+    {CS0, {"CS0", "CS0: Best Effort / Standard"}},
+    {CS1, {"CS1", "CS1: Low-Priority Data"}},
+    {CS2, {"CS2", "CS2: Network OAM"}},
+    {CS3, {"CS3", "CS3: Broadcast Video"}},
+    {CS4, {"CS4", "CS4: Real-Time Interactive"}},
+    {CS5, {"CS5", "CS5: Signaling"}},
+    {CS6, {"CS6", "CS6: Network Control"}},
+    {CS7, {"CS7", "CS7: Reserved for future use"}},
+    /*
+    DSCP Assured Forwarding - informations based on:
+    https://datatracker.ietf.org/doc/html/rfc2597 [Page 6]
+    */
+    {AF11, {"AF11", "AF11: Class 1, Low Drop Probability"}},
+    {AF12, {"AF12", "AF12: Class 1, Medium Drop Probability"}},
+    {AF13, {"AF13", "AF13: Class 1, High Drop Probability"}},
+    {AF21, {"AF21", "AF21: Class 2, Low Drop Probability"}},
+    {AF22, {"AF22", "AF22: Class 2, Medium Drop Probability"}},
+    {AF23, {"AF23", "AF23: Class 2, High Drop Probability"}},
+    {AF31, {"AF31", "AF31: Class 3, Low Drop Probability"}},
+    {AF32, {"AF32", "AF32: Class 3, Medium Drop Probability"}},
+    {AF33, {"AF33", "AF33: Class 3, High Drop Probability"}},
+    {AF41, {"AF41", "AF41: Class 4, Low Drop Probability"}},
+    {AF42, {"AF42", "AF42: Class 4, Medium Drop Probability"}},
+    {AF43, {"AF43", "AF43: Class 4, High Drop Probability"}},
+    // DSCP Expedited Forwarding
+    {EF, {"EF", "EF: Expedited Forwarding"}},
+    // DSCP Voice Admit
+    {VOICE_ADMIT, {"Voice Admit", "Voice Admit"}},
+    // DSCP Low Effort
+    {LE, {"Low Effort", "Low Effort"}},
+};
+
+// the unassigned codepoints have no description
+constexpr auto dscp_table = make_desc_table<64>(dscps,
+    [](uint32_t){ return desc_t{"", ""}; }, {"Invalid DSCP value", "Invalid DSCP value"});
 
 /**
  * @brief Get the ECN description
  * 
  * @param ecn 
- * @param ecn_desc 
  * @param verbose // if true, full description, if false, short description
+ * @return std::string_view 
  */
-void 
-get_ecn_desc(uint8_t ecn, std::string& ecn_desc, bool verbose)
+std::string_view
+get_ecn_desc(uint8_t ecn, bool verbose)
 {
-    if (!IS_VALID_ECN(ecn)){
-        ecn_desc = "Invalid ECN value";
-        return;
-    }
-    switch(ecn){
-        #ifdef __APPLE__
-        case IPTOS_ECN_NOTECT:
-        #endif
-        #ifdef __linux__
-        case IPTOS_ECN_NOT_ECT:
-        #endif
-            if (verbose)
-                ecn_desc = "Not-ECT: Not ECN-Capable Transport";
-            else
-                ecn_desc = "Not-ECT";
-            break;
-        case IPTOS_ECN_ECT0:
-            if (verbose)
-                ecn_desc = "ECT(0): ECN-Capable Transport (0)";
-            else
-                ecn_desc = "ECT(0)";
-            break;
-        case IPTOS_ECN_ECT1:
-            if (verbose)
-                ecn_desc = "ECT(1): ECN-Capable Transport (1)";
-            else
-                ecn_desc = "ECT(1)";
-            break;
-        case IPTOS_ECN_CE:
-            if (verbose)
-                ecn_desc = "CE: Congestion Experienced";
-            else
-                ecn_desc = "CE";
-            break;
-    }
+    return desc_lookup(ecn_table, ecn, verbose);
 }
 
 
@@ -53,161 +74,10 @@ get_ecn_desc(uint8_t ecn, std::string& ecn_desc, bool verbose)
  * 
  * @param dscp 
  * @param verbose // if true, full description, if false, short description
- * @return char* 
+ * @return std::string_view 
  */
-void
-get_dscp_desc(uint8_t dscp, std::string& dscp_desc, bool verbose)
+std::string_view
+get_dscp_desc(uint8_t dscp, bool verbose)
 {
-    if (!IS_VALID_DSCP(dscp)){
-        dscp_desc = "Invalid DSCP value";
-        return;
-    }
-    switch(dscp){
-        /*
-        DSCP Class Selector - informations based on:
-        https://datatracker.ietf.org/doc/html/rfc4594 [Page 19]
-        */
-        case CS0:
-            if (verbose)
-                dscp_desc = "CS0: Best Effort / Standard";
-            else
-                dscp_desc = "CS0";
-            break;
-        case CS1:
-            if (verbose)
-                dscp_desc = "CS1: Low-Priority Data";
-            else
-                dscp_desc = "CS1";
-            break;
-        case CS2:
-            if (verbose)
-                dscp_desc = "CS2: Network OAM";
-            else
-                dscp_desc = "CS2";
-            break;
-        case CS3:
-            if (verbose)
-                dscp_desc = "CS3: Broadcast Video";
-            else
-                dscp_desc = "CS3";
-            break;
-        case CS4:
-            if (verbose)
-                dscp_desc = "CS4: Real-Time Interactive";
-            else
-                dscp_desc = "CS4";
-            break;
-        case CS5:
-            if (verbose)
-                dscp_desc = "CS5: Signaling";
-            else
-                dscp_desc = "CS5";
-            break;
-        case CS6:
-            if (verbose)
-                dscp_desc = "CS6: Network Control";
-            else
-                dscp_desc = "CS6";
-            break;
-        case CS7:
-            if (verbose)
-                dscp_desc = "CS7: Reserved for future use";
-            else
-                dscp_desc = "CS7";
-            break;
-        /*
-        DSCP Assured Forwarding - informations based on:
-        https://datatracker.ietf.org/doc/html/rfc2597 [Page 6]
-        */
-        case AF11:
-            if (verbose)
-                dscp_desc = "AF11: Class 1, Low Drop Probability";
-            else
-                dscp_desc = "AF11";
-            break;
-        case AF12:
-            if (verbose)
-                dscp_desc = "AF12: Class 1, Medium Drop Probability";
-            else
-                dscp_desc = "AF12";
-            break;
-        case AF13:
-            if (verbose)
-                dscp_desc = "AF13: Class 1, High Drop Probability";
-            else
-                dscp_desc = "AF13";
-            break;
-        case AF21:
-            if (verbose)
-                dscp_desc = "AF21: Class 2, Low Drop Probability";
-            else
-                dscp_desc = "AF21";
-        case AF22:
-            if (verbose)
-                dscp_desc = "AF22: Class 2, Medium Drop Probability";
-            else
-                dscp_desc = "AF22";
-            break;
-        case AF23:
-            if (verbose)
-                dscp_desc = "AF23: Class 2, High Drop Probability";
-            else
-                dscp_desc = "AF23";
-        case AF31:
-            if (verbose)
-                dscp_desc = "AF31: Class 3, Low Drop Probability";
-            else
-                dscp_desc = "AF31";
-            break;
-        case AF32:
-            if (verbose)
-                dscp_desc = "AF32: Class 3, Medium Drop Probability";
-            else
-                dscp_desc = "AF32";
-            break;
-        case AF33:
-            if (verbose)
-                dscp_desc = "AF33: Class 3, High Drop Probability";
-            else
-                dscp_desc = "AF33";
-            break;
-        case AF41:
-            if (verbose)
-                dscp_desc = "AF41: Class 4, Low Drop Probability";
-            else
-                dscp_desc = "AF41";
-        case AF42:
-            if (verbose)
-                dscp_desc = "AF42: Class 4, Medium Drop Probability";
-            else
-                dscp_desc = "AF42";
-            break;
-        case AF43:
-            if (verbose)
-                dscp_desc = "AF43: Class 4, High Drop Probability";
-            else
-                dscp_desc = "AF43";
-            break;
-        /*
-        DSCP Expedited Forwarding
-        */
-        case EF:
-            if (verbose)
-                dscp_desc = "EF: Expedited Forwarding";
-            else
-                dscp_desc = "EF";
-            break;
-        /*
-        DSCP Voice Admit
-        */
-        case VOICE_ADMIT:
-            dscp_desc = "Voice Admit";
-            break;
-        /*
-        DSCP Low Effort
-        */
-        case LE:
-            dscp_desc = "Low Effort";
-            break;
-    }
+    return desc_lookup(dscp_table, dscp, verbose);
 }
@@ -1,7 +1,7 @@
 #ifndef DSCP_H
 #define DSCP_H
 
-#include <string>
+#include <string_view>
 #include <sys/types.h>
 #include <stdio.h>
 #include <netinet/ip.h>
@@ -55,7 +55,7 @@ DSCP values: https://www.iana.org/assignments/dscp-registry/dscp-registry.xhtml
 #define IS_VALID_DSCP(x) ((x) <= 63 && (x) >= 0)    // DSCP is in [0-63]
 #define IS_VALID_ECN(x) ((x) <= 3 && (x) >= 0)      // ECN is in [0-3]
 
-void get_dscp_desc(uint8_t dscp, std::string& dscp_desc, bool verbose);
-void get_ecn_desc(uint8_t ecn, std::string& ecn_desc, bool verbose);
+std::string_view get_dscp_desc(uint8_t dscp, bool verbose);
+std::string_view get_ecn_desc(uint8_t ecn, bool verbose);
 
 #endif
\ No newline at end of file
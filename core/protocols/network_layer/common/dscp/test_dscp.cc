@@ -5,31 +5,31 @@
 void
 test_dcsp_desc()
 {
-    std::string dscp_desc;
-    get_dscp_desc(CS0, dscp_desc, true);
+    std::string_view dscp_desc;
+    dscp_desc = get_dscp_desc(CS0, true);
     assert(dscp_desc == "CS0: Best Effort / Standard");
 
-    get_dscp_desc(CS1, dscp_desc, false);
+    dscp_desc = get_dscp_desc(CS1, false);
     assert(dscp_desc == "CS1");
 
-    get_dscp_desc(-1, dscp_desc, true);
+    dscp_desc = get_dscp_desc(-1, true);
     assert(dscp_desc == "Invalid DSCP value");
 
-    get_dscp_desc(AF42, dscp_desc, true);
+    dscp_desc = get_dscp_desc(AF42, true);
     assert(dscp_desc == "AF42: Class 4, Medium Drop Probability");
 }
 
 void
 test_ecn_desc()
 {
-    std::string ecn_desc;
+    std::string_view ecn_desc;
     
     #ifdef __linux__
-    get_ecn_desc(IPTOS_ECN_NOT_ECT, ecn_desc, true);
+    ecn_desc = get_ecn_desc(IPTOS_ECN_NOT_ECT, true);
     #endif
 
     #ifdef __APPLE__
-    get_ecn_desc(IPTOS_ECN_NOTECT, ecn_desc, true);
+    ecn_desc = get_ecn_desc(IPTOS_ECN_NOTECT, true);
     #endif
 
     assert(ecn_desc == "Not-ECT: Not ECN-Capable Transport");
@@ -1,35 +1,38 @@
 #include "icmp.h"
+#include "desc_table.h"
 
 /**
  * @brief Parse an ICMP packet and return a my_icmp_t struct
- * containing the parsed data.
+ * containing the parsed data. The packet is only read.
  * ! needs packet_length to recalculate checksum
  * @param packet 
+ * @param packet_length bytes available from packet
+ * @param arena the payload is copied there
  * @param verbose 
  * @return my_icmp_t 
  */
 my_icmp_t 
-parse_icmp(const uint8_t *packet, size_t packet_length, const bool verbose)
+parse_icmp(const uint8_t *packet, size_t packet_length, arena_t *arena, const bool verbose)
 {   
     my_icmp_t icmp_p;
 
-    struct icmp *icmp = (struct icmp *)packet;
+    const struct icmp *icmp = (const struct icmp *)packet;
 
     // get the type along with the description
     icmp_p.type = icmp->icmp_type;
-    get_icmp_type_desc(icmp_p.type, icmp_p.icmp_type_desc, verbose);
+    icmp_p.icmp_type_desc = get_icmp_type_desc(icmp_p.type, verbose);
 
     // get the code along with the description
     icmp_p.code = icmp->icmp_code;
-    get_icmp_code_desc(icmp_p.type, icmp_p.code, icmp_p.icmp_code_desc, verbose);
+    icmp_p.icmp_code_desc = get_icmp_code_desc(icmp_p.type, icmp_p.code, verbose);
 
     // get the checksum
     icmp_p.checksum = ntohs(icmp->icmp_cksum);
-    // set checksum to 0 for recalculation
-    icmp->icmp_cksum = 0;
 
-    // recalculate the checksum
-    uint16_t calculated_checksum = ntohs(calculate_checksum((uint16_t *)icmp, packet_length));
+    // recalculate the checksum, the checksum field counts as 0
+    uint32_t sum = checksum_add(0, icmp, packet_length);
+    sum = checksum_remove(sum, icmp->icmp_cksum);
+    uint16_t calculated_checksum = ntohs(checksum_finish(sum));
     icmp_p.calculated_checksum = calculated_checksum;
     icmp_p.checksum_valid = (calculated_checksum == icmp_p.checksum || icmp_p.calculated_checksum == 0x0000 || icmp_p.calculated_checksum == 0xFFFF);
 
@@ -45,23 +48,19 @@ parse_icmp(const uint8_t *packet, size_t packet_length, const bool verbose)
 
     // if there's more than the header, then copy the data
     if (packet_length > ICMP_MINLEN && (icmp_p.type == ICMP_ECHO || icmp_p.type == ICMP_ECHOREPLY)){
-        icmp_p.payload = (uint8_t *)malloc(packet_length - ICMP_MINLEN + 1);
-        if (icmp_p.payload == NULL){
-            perror("malloc");
-            exit(EXIT_FAILURE);
-        }
-
+        icmp_p.payload = (uint8_t *)arena_alloc(arena, packet_length - ICMP_MINLEN + 1);
         memcpy(icmp_p.payload, icmp->icmp_data, packet_length - ICMP_MINLEN);
     } else if (icmp_p.type == ICMP_UNREACH){
-        // get the original ip header
-        icmp_p.og_ip_header = parse_ipv4(packet + ICMP_MINLEN, verbose);
-        // 64 bits
-        icmp_p.payload = (uint8_t *)malloc(8 * sizeof(uint8_t));
-        if (icmp_p.payload == NULL){
-            perror("malloc");
-            exit(EXIT_FAILURE);
-        }
-        memcpy(icmp_p.payload, packet + ICMP_MINLEN + icmp_p.og_ip_header.header_length * 4, 8);
+        // get the original ip header, empty if the message doesn't hold it
+        uint32_t invoking = (packet_length > ICMP_MINLEN) ? packet_length - ICMP_MINLEN : 0;
+        icmp_p.og_ip_header = parse_ipv4(packet + ICMP_MINLEN, invoking, verbose);
+        // 64 bits, as much of them as the message holds
+        size_t offset = ICMP_MINLEN + icmp_p.og_ip_header.header_length * 4;
+        size_t copied = (offset < packet_length) ? packet_length - offset : 0;
+        copied = (copied < 8) ? copied : 8;
+        icmp_p.payload = (uint8_t *)arena_alloc(arena, 8 * sizeof(uint8_t));
+        memset(icmp_p.payload, 0, 8);
+        memcpy(icmp_p.payload, packet + offset, copied);
         if (icmp_p.og_ip_header.protocol == IPPROTO_TCP){
             // my_tcp_header_t tcp_header = parse_tcp(packet + ICMP_MINLEN + icmp_p.original_ip_header.header_length * 4, verbose);
         } else if (icmp_p.og_ip_header.protocol == IPPROTO_UDP){
@@ -74,187 +73,106 @@ parse_icmp(const uint8_t *packet, size_t packet_length, const bool verbose)
     return icmp_p;
 }
 
+/**
+ * @brief Parse an ICMP message into a view, without allocating
+ * and without touching the packet. For destination unreachable the
+ * payload is the original datagram, parse_ipv4_view() reads it.
+ * 
+ * @param packet 
+ * @param length length of the ICMP message
+ * @param view 
+ * @return true if the header fits in length
+ */
+bool
+parse_icmp_view(const uint8_t *packet, uint32_t length, my_icmp_view_t *view)
+{
+    if (length < ICMP_MINLEN){
+        return false;
+    }
+    const struct icmp *icmp = (const struct icmp *)packet;
+    view->type = icmp->icmp_type;
+    view->code = icmp->icmp_code;
+    view->checksum = ntohs(icmp->icmp_cksum);
+    // summed with its checksum field, a correct message folds to 0
+    view->checksum_valid = ((uint16_t)calculate_checksum((uint16_t *)packet, length) == 0);
+    if (view->type == ICMP_ECHO || view->type == ICMP_ECHOREPLY){
+        view->identifier = ntohs(icmp->icmp_id);
+        view->sequence_number = ntohs(icmp->icmp_seq);
+    } else {
+        view->identifier = 0;
+        view->sequence_number = 0;
+    }
+    view->payload = packet + ICMP_MINLEN;
+    view->payload_length = length - ICMP_MINLEN;
+    return true;
+}
+
+constexpr desc_entry_t icmp_types[] = {
+    {ICMP_ECHOREPLY, {"Echo Reply",              "Type: Echo Reply (0)"}},
+    {ICMP_UNREACH,   {"Destination Unreachable", "Type: Destination Unreachable (3)"}},
+    {ICMP_ECHO,      {"Echo Request",            "Type: Echo Request (8)"}},
+};
+
+constexpr auto icmp_unknown_types = make_desc_numbers<256>("Type: Unknown (", ")");
+constexpr auto icmp_type_table = make_desc_table<256>(icmp_types,
+    [](uint32_t type){ return desc_t{"Unknown", icmp_unknown_types[type]}; });
+
+// https://www.iana.org/assignments/icmp-parameters/icmp-parameters.xhtml#icmp-parameters-codes-3
+constexpr desc_entry_t icmp_unreach_codes[] = {
+    {ICMP_UNREACH_NET,               {"bad net",           "Code: Network Unreachable (0)"}},
+    {ICMP_UNREACH_HOST,              {"bad host",          "Code: Host Unreachable (1)"}},
+    {ICMP_UNREACH_PROTOCOL,          {"bad protocol",      "Code: Protocol Unreachable (2)"}},
+    {ICMP_UNREACH_PORT,              {"bad port",          "Code: Port Unreachable (3)"}},
+    {ICMP_UNREACH_NEEDFRAG,          {"IP_DF caused drop", "Code: Fragmentation Needed and Don't Fragment was Set (4)"}},
+    {ICMP_UNREACH_SRCFAIL,           {"src route failed",  "Code: Source Route Failed (5)"}},
+    {ICMP_UNREACH_NET_UNKNOWN,       {"unknown net",       "Code: Destination Network Unknown (6)"}},
+    {ICMP_UNREACH_HOST_UNKNOWN,      {"unknown host",      "Code: Destination Host Unknown (7)"}},
+    {ICMP_UNREACH_ISOLATED,          {"src host isolated", "Code: Source Host Isolated (8)"}},
+    {ICMP_UNREACH_NET_PROHIB,        {"prohibited access", "Code: Communication with Destination Network is Administratively Prohibited (9)"}},
+    {ICMP_UNREACH_HOST_PROHIB,       {"ditto",             "Code: Communication with Destination Host is Administratively Prohibited (10)"}},
+    {ICMP_UNREACH_TOSNET,            {"bad ToS for net",   "Code: Network Unreachable for Type of Service (11)"}},
+    {ICMP_UNREACH_TOSHOST,           {"bad ToS for host",  "Code: Host Unreachable for Type of Service (12)"}},
+    {ICMP_UNREACH_FILTER_PROHIB,     {"admin prohib",      "Code: Communication Administratively Prohibited (13)"}},
+    {ICMP_UNREACH_HOST_PRECEDENCE,   {"host prec vio.",    "Code: Host Precedence Violation (14)"}},
+    {ICMP_UNREACH_PRECEDENCE_CUTOFF, {"prec cutoff",       "Code: Precedence cutoff in effect (15)"}},
+};
+
+constexpr auto icmp_unreach_code_table = make_desc_table<16>(icmp_unreach_codes, {"", ""});
+
+// no code for echo request and reply
+constexpr auto icmp_echo_codes = make_desc_numbers<256>("No Code (", ")");
+
 /**
  * @brief Get the icmp code description based on the type and code
- * and return it in a string
  * 
  * @param type 
  * @param code 
- * @param desc 
  * @param verbose 
+ * @return std::string_view 
  */
-void
-get_icmp_code_desc(uint8_t type, uint8_t code, std::string& desc, bool verbose)
+std::string_view
+get_icmp_code_desc(uint8_t type, uint8_t code, bool verbose)
 {
     switch(type){
         case ICMP_ECHO:
         case ICMP_ECHOREPLY:
-            // No code for echo request and reply
-            if (verbose){
-                desc = "No Code (" + std::to_string(code) + ")";
-            } else {
-                desc = "0";
-            }
-            break;
+            return verbose ? icmp_echo_codes[code] : "0";
         case ICMP_UNREACH:
-            switch(code) {
-                // https://www.iana.org/assignments/icmp-parameters/icmp-parameters.xhtml#icmp-parameters-codes-3
-                case ICMP_UNREACH_NET:
-                    if (verbose){
-                        desc = "Code: Network Unreachable (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "bad net";
-                    }
-                    break;
-                case ICMP_UNREACH_HOST:
-                    if (verbose){
-                        desc = "Code: Host Unreachable (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "bad host";
-                    }
-                    break;
-                case ICMP_UNREACH_PROTOCOL:
-                    if (verbose){
-                        desc = "Code: Protocol Unreachable (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "bad protocol";
-                    }
-                    break;
-                case ICMP_UNREACH_PORT:
-                    if (verbose){
-                        desc = "Code: Port Unreachable (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "bad port";
-                    }
-                    break;
-                case ICMP_UNREACH_NEEDFRAG:
-                    if (verbose){
-                        desc = "Code: Fragmentation Needed and Don't Fragment was Set (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "IP_DF caused drop";
-                    }
-                    break;
-                case ICMP_UNREACH_SRCFAIL:
-                    if (verbose){
-                        desc = "Code: Source Route Failed (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "src route failed";
-                    }
-                    break;
-                case ICMP_UNREACH_NET_UNKNOWN:
-                    if (verbose){
-                        desc = "Code: Destination Network Unknown (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "unknown net";
-                    }
-                    break;
-                case ICMP_UNREACH_HOST_UNKNOWN:
-                    if (verbose){
-                        desc = "Code: Destination Host Unknown (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "unknown host";
-                    }
-                    break;
-                case ICMP_UNREACH_ISOLATED:
-                    if (verbose){
-                        desc = "Code: Source Host Isolated (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "src host isolated";
-                    }
-                    break;
-                case ICMP_UNREACH_NET_PROHIB:
-                    if (verbose){
-                        desc = "Code: Communication with Destination Network is Administratively Prohibited (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "prohibited access";
-                    }
-                    break;
-                case ICMP_UNREACH_HOST_PROHIB:
-                    if (verbose){
-                        desc = "Code: Communication with Destination Host is Administratively Prohibited (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "ditto";
-                    }
-                    break;
-                case ICMP_UNREACH_TOSNET:
-                    if (verbose){
-                        desc = "Code: Network Unreachable for Type of Service (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "bad ToS for net";
-                    }
-                    break;
-                case ICMP_UNREACH_TOSHOST:
-                    if (verbose){
-                        desc = "Code: Host Unreachable for Type of Service (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "bad ToS for host";
-                    }
-                    break;
-                case ICMP_UNREACH_FILTER_PROHIB:
-                    if (verbose){
-                        desc = "Code: Communication Administratively Prohibited (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "admin prohib";
-                    }
-                    break;
-                case ICMP_UNREACH_HOST_PRECEDENCE:
-                    if (verbose){
-                        desc = "Code: Host Precedence Violation (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "host prec vio.";
-                    }
-                    break;
-                case ICMP_UNREACH_PRECEDENCE_CUTOFF:
-                    if (verbose){
-                        desc = "Code: Precedence cutoff in effect (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "prec cutoff";
-                    }
-                    break;
-            }
+            return desc_lookup(icmp_unreach_code_table, code, verbose);
+        default:
+            return "";
     }
 }
 
-
 /**
- * @brief Get the icmp type description in a given string
+ * @brief Get the icmp type description
  * 
  * @param type 
- * @param desc 
  * @param verbose 
+ * @return std::string_view 
  */
-void
-get_icmp_type_desc(uint8_t type, std::string& desc, bool verbose)
+std::string_view
+get_icmp_type_desc(uint8_t type, bool verbose)
 {
-    switch(type){
-        case ICMP_ECHOREPLY:
-            if (verbose){
-                desc = "Type: Echo Reply (" + std::to_string(type) + ")";
-            } else {
-                desc = "Echo Reply";
-            }
-            break;
-        case ICMP_UNREACH:
-            if (verbose){
-                desc = "Type: Destination Unreachable (" + std::to_string(type) + ")";
-            } else {
-                desc = "Destination Unreachable";
-            }
-            break;
-        case ICMP_ECHO:
-            if (verbose){
-                desc = "Type: Echo Request (" + std::to_string(type) + ")";
-            } else {    
-                desc = "Echo Request";
-            }
-            break;
-        default:
-            if (verbose){
-                desc = "Type: Unknown (" + std::to_string(type) + ")";
-            } else {
-                desc = "Unknown";
-            }
-            break;
-    }
+    return desc_lookup(icmp_type_table, type, verbose);
 }
-
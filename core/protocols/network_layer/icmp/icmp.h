@@ -3,9 +3,10 @@
 
 #include <netinet/in.h>
 #include <netinet/ip_icmp.h>
-#include <string>
+#include <string_view>
 #include "check_sum.h"
 #include "ipv4.h"
+#include "arena.h"
 
 /* https://datatracker.ietf.org/doc/html/rfc792 
 Echo or Echo Reply Message [Page 14]
@@ -38,10 +39,10 @@ Destination Unreachable Message
 
 typedef struct my_icmp {
     uint8_t type;
-    std::string icmp_type_desc;
+    std::string_view icmp_type_desc;
 
     uint8_t code;
-    std::string icmp_code_desc;
+    std::string_view icmp_code_desc;
 
     uint16_t checksum;
     uint16_t calculated_checksum;
@@ -49,15 +50,28 @@ typedef struct my_icmp {
 
     uint16_t identifier;
     uint16_t sequence_number;
-    uint8_t *payload; // this is reserved for the ICMP payload
+    uint8_t *payload; // this is reserved for the ICMP payload, in the arena
     my_ipv4_header_t og_ip_header;
     // Internet Header + 64 bits of Original Data Datagram
 } my_icmp_t;
 
-my_icmp_t parse_icmp(const uint8_t *packet, size_t packet_length, bool verbose);
+// raw fields of the message, pointers into the packet, nothing allocated
+typedef struct my_icmp_view {
+    uint8_t type;
+    uint8_t code;
+    uint16_t checksum;
+    bool checksum_valid;
+    uint16_t identifier;      // echo / echo reply only
+    uint16_t sequence_number;
+    const uint8_t *payload;   // after the 8 bytes header
+    uint32_t payload_length;
+} my_icmp_view_t;
+
+my_icmp_t parse_icmp(const uint8_t *packet, size_t packet_length, arena_t *arena, bool verbose);
+bool parse_icmp_view(const uint8_t *packet, uint32_t length, my_icmp_view_t *view);
 
 // helpers
-void get_icmp_type_desc(uint8_t type, std::string& desc, bool verbose);
-void get_icmp_code_desc(uint8_t type, uint8_t code, std::string& desc, bool verbose);
+std::string_view get_icmp_type_desc(uint8_t type, bool verbose);
+std::string_view get_icmp_code_desc(uint8_t type, uint8_t code, bool verbose);
 
 #endif
\ No newline at end of file
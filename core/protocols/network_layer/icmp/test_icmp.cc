@@ -1,10 +1,14 @@
 #include "icmp.h"
 #include <cassert>
 
+// the payloads are copied there
+arena_t arena;
+
 
 void test_parse_icmp_echo_request()
 {
-    uint8_t packet[] = {
+    // read only memory, like a mapped file: the parser must not write
+    static const uint8_t packet[] = {
     0x08, 0x00, 0xC5, 0x30, // Type 8, Code 0, Checksum (0xc530)
     0xBC, 0x24, 0x00, 0x00, 
     0x67, 0x62, 0xA4, 0x7A, // ping adds a timestamp not standard ignore it...
@@ -22,7 +26,7 @@ void test_parse_icmp_echo_request()
     0x30, 0x31, 0x32, 0x33, 
     0x34, 0x35, 0x36, 0x37
 };
-    my_icmp_t icmp = parse_icmp(packet, sizeof(packet), false);
+    my_icmp_t icmp = parse_icmp(packet, sizeof(packet), &arena, false);
     assert(icmp.type == ICMP_ECHO);
     assert(icmp.icmp_type_desc == "Echo Request");
     assert(icmp.code == 0);
@@ -32,6 +36,11 @@ void test_parse_icmp_echo_request()
     assert(icmp.identifier == 0xbc24);
     assert(icmp.sequence_number == 0x0000);
     assert(std::string((char *)&icmp.payload[33]) == std::string("!\"#$%&'()*+,-./01234567"));
+
+    // the checksum field is left as it was for the next reader
+    my_icmp_t again = parse_icmp(packet, sizeof(packet), &arena, false);
+    assert(again.checksum == 0xc530);
+    assert(again.checksum_valid == true);
 }
 
 void test_parse_icmp_echo_reply()
@@ -55,7 +64,7 @@ void test_parse_icmp_echo_reply()
     0x34, 0x35, 0x36, 0x37
     };
 
-    my_icmp_t icmp = parse_icmp(packet, sizeof(packet), false);
+    my_icmp_t icmp = parse_icmp(packet, sizeof(packet), &arena, false);
     assert(icmp.type == ICMP_ECHOREPLY);
     assert(icmp.icmp_type_desc == "Echo Reply");
     assert(icmp.code == 0);
@@ -84,7 +93,7 @@ void test_parse_icmp_destination_unreachable()
         0x00, 0x00, 0x00, 0x00   // TCP checksum and urgent pointer
     };
 
-    my_icmp_t icmp = parse_icmp(packet, sizeof(packet), false);
+    my_icmp_t icmp = parse_icmp(packet, sizeof(packet), &arena, false);
     assert(icmp.type == ICMP_UNREACH);
     assert(icmp.icmp_type_desc == "Destination Unreachable");
     assert(icmp.code == ICMP_UNREACH_HOST);
@@ -119,6 +128,7 @@ void test_parse_icmp_destination_unreachable()
 
 int main()
 {   
+    arena_init(&arena, 0);
     test_parse_icmp_echo_request();
     test_parse_icmp_echo_reply();
     test_parse_icmp_destination_unreachable();
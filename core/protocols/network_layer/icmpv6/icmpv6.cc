@@ -1,27 +1,29 @@
 #include "icmpv6.h"
+#include "desc_table.h"
 
-my_icmpv6_t parse_icmpv6(const uint8_t *packet, size_t packet_length, uint8_t *src_ipv6, uint8_t *dst_ipv6, bool verbose) {
+my_icmpv6_t parse_icmpv6(const uint8_t *packet, size_t packet_length, const uint8_t *src_ipv6, const uint8_t *dst_ipv6, arena_t *arena, bool verbose) {
     my_icmpv6_t my_icmpv6;
 
-    struct icmp6_hdr *icmp6_hdr = (struct icmp6_hdr *)packet;
+    const struct icmp6_hdr *icmp6_hdr = (const struct icmp6_hdr *)packet;
 
     my_icmpv6.type = icmp6_hdr->icmp6_type;
-    get_icmpv6_type_desc(my_icmpv6.type, my_icmpv6.icmpv6_type_desc, verbose);
+    my_icmpv6.icmpv6_type_desc = get_icmpv6_type_desc(my_icmpv6.type, verbose);
 
     my_icmpv6.code = icmp6_hdr->icmp6_code;
-    get_icmpv6_code_desc(my_icmpv6.type, my_icmpv6.code, my_icmpv6.icmpv6_code_desc, verbose);
+    my_icmpv6.icmpv6_code_desc = get_icmpv6_code_desc(my_icmpv6.type, my_icmpv6.code, verbose);
 
     my_icmpv6.checksum = ntohs(icmp6_hdr->icmp6_cksum);
-    icmp6_hdr->icmp6_cksum = 0;
     // "The Next Header field in the pseudo-header for ICMP contains the
     // value 58, which identifies the IPv6 version of ICMP."
     // https://datatracker.ietf.org/doc/html/rfc2460#section-8.1
     uint8_t next_header = 58;
 
-    // Build the pseudo-header and packet
-    int combined_len;
-    uint16_t *combined = build_ipv6_pseudo_header_and_packet((uint8_t*)icmp6_hdr, packet_length, src_ipv6, dst_ipv6, next_header, &combined_len);
-    uint16_t calculated_checksum = ntohs(calculate_checksum(combined, combined_len));
+    // Sum the pseudo-header and the message where they are,
+    // the checksum field counts as 0
+    uint32_t sum = checksum_add_pseudo_ipv6(0, src_ipv6, dst_ipv6, next_header, packet_length);
+    sum = checksum_add(sum, icmp6_hdr, packet_length);
+    sum = checksum_remove(sum, icmp6_hdr->icmp6_cksum);
+    uint16_t calculated_checksum = ntohs(checksum_finish(sum));
     my_icmpv6.calculated_checksum = calculated_checksum;
     my_icmpv6.checksum_valid = (calculated_checksum == my_icmpv6.checksum || my_icmpv6.calculated_checksum == 0x0000 || my_icmpv6.calculated_checksum == 0xFFFF);
 
@@ -34,28 +36,22 @@ my_icmpv6_t parse_icmpv6(const uint8_t *packet, size_t packet_length, uint8_t *s
     }
 
     if (packet_length > MY_ICMPV6_MIN_LEN  && (my_icmpv6.type == ICMP6_ECHO_REQUEST || my_icmpv6.type == ICMP6_ECHO_REPLY)){
-        my_icmpv6.payload = (uint8_t *)malloc(packet_length - MY_ICMPV6_MIN_LEN + 1);
-        if (my_icmpv6.payload == NULL){
-            perror("malloc");
-            exit(EXIT_FAILURE);
-        }
-
-        snprintf((char *)my_icmpv6.payload, packet_length - MY_ICMPV6_MIN_LEN + 1, "%s", icmp6_hdr->icmp6_data8);
+        my_icmpv6.payload = (uint8_t *)arena_alloc(arena, packet_length - MY_ICMPV6_MIN_LEN + 1);
+        snprintf((char *)my_icmpv6.payload, packet_length - MY_ICMPV6_MIN_LEN + 1, "%.*s", (int)(packet_length - MY_ICMPV6_MIN_LEN), (const char *)icmp6_hdr->icmp6_data8);
     } else {
         my_icmpv6.payload = NULL;
     }
 
     if (my_icmpv6.type == ICMP6_DST_UNREACH){
-        // get the original ip header
-        my_icmpv6.og_ipv6_header = parse_ipv6((uint8_t*)&icmp6_hdr->icmp6_data32[1], verbose);
-
-        // as much as fits in the minimum IPv6 MTU
-        my_icmpv6.payload = (uint8_t *)malloc(ICMPV6_PLD_MAXLEN * sizeof(uint8_t));
-        if (my_icmpv6.payload == NULL){
-            perror("malloc");
-            exit(EXIT_FAILURE);
-        }
-        memcpy(my_icmpv6.payload, &icmp6_hdr->icmp6_data32[1], ICMPV6_PLD_MAXLEN);
+        // get the original ip header, empty if the message doesn't hold it
+        size_t invoking = (packet_length > MY_ICMPV6_MIN_LEN) ? packet_length - MY_ICMPV6_MIN_LEN : 0;
+        my_icmpv6.og_ipv6_header = parse_ipv6((const uint8_t*)&icmp6_hdr->icmp6_data32[1], invoking, verbose);
+
+        // as much as fits in the minimum IPv6 MTU, and in the message
+        invoking = (invoking < ICMPV6_PLD_MAXLEN) ? invoking : ICMPV6_PLD_MAXLEN;
+        my_icmpv6.payload = (uint8_t *)arena_alloc(arena, ICMPV6_PLD_MAXLEN * sizeof(uint8_t));
+        memset(my_icmpv6.payload, 0, ICMPV6_PLD_MAXLEN);
+        memcpy(my_icmpv6.payload, &icmp6_hdr->icmp6_data32[1], invoking);
         if (my_icmpv6.og_ipv6_header.next_header == IPPROTO_TCP){
             // my_tcp_header_t tcp_header = parse_tcp(icmp6_hdr->icmp6_data8 + my_icmpv6.og_ipv6_header.header_length * 4, verbose);
         } else if (my_icmpv6.og_ipv6_header.next_header == IPPROTO_UDP){
@@ -65,15 +61,11 @@ my_icmpv6_t parse_icmpv6(const uint8_t *packet, size_t packet_length, uint8_t *s
 
     if (my_icmpv6.type == ND_NEIGHBOR_SOLICIT){
         // get the target address
-        my_icmpv6.payload = (uint8_t *)malloc(INET6_ADDRSTRLEN * sizeof(uint8_t));
-        if (my_icmpv6.payload == NULL){
-            perror("malloc");
-            exit(EXIT_FAILURE);
-        }
-        if (inet_ntop(AF_INET6, &icmp6_hdr->icmp6_data32[1], (char*)my_icmpv6.payload, INET6_ADDRSTRLEN) == NULL){
-            free(my_icmpv6.payload);
-            perror("inet_ntop");
-            exit(EXIT_FAILURE);
+        my_icmpv6.payload = (uint8_t *)arena_alloc(arena, IPV6_ADDRESS_STRLEN * sizeof(uint8_t));
+        if (packet_length >= MY_ICMPV6_MIN_LEN + 16){
+            format_ipv6_address((const uint8_t *)&icmp6_hdr->icmp6_data32[1], (char*)my_icmpv6.payload);
+        } else {
+            my_icmpv6.payload[0] = '\0';
         }
         // TODO: get the options
     }
@@ -81,139 +73,96 @@ my_icmpv6_t parse_icmpv6(const uint8_t *packet, size_t packet_length, uint8_t *s
     return my_icmpv6;
 }
 
-/**
- * @brief Free the payload of the ICMPv6 packet
- * 
- * @param my_icmpv6 
- */
-void
-free_parse_icmpv6(my_icmpv6_t *my_icmpv6)
-{
-    if (my_icmpv6->payload != NULL){
-        free(my_icmpv6->payload);
-    }
-}
+constexpr desc_entry_t icmpv6_types[] = {
+    {ICMP6_DST_UNREACH,   {"dest unreachable",      "Type: Destination Unreachable (1)"}},
+    {ICMP6_ECHO_REQUEST,  {"Echo Request",          "Type: Echo Request (128)"}},
+    {ICMP6_ECHO_REPLY,    {"Echo Reply",            "Type: Echo Reply (129)"}},
+    {ND_NEIGHBOR_SOLICIT, {"Neighbor Solicitation", "Type: Neighbor Solicitation (135)"}},
+};
+
+constexpr auto icmpv6_unknown_types = make_desc_numbers<256>("Type: Unknown (", ")");
+constexpr auto icmpv6_type_table = make_desc_table<256>(icmpv6_types,
+    [](uint32_t type){ return desc_t{"Unknown", icmpv6_unknown_types[type]}; });
+
+// https://www.iana.org/assignments/icmpv6-parameters/icmpv6-parameters.xhtml#icmpv6-parameters-codes-2
+constexpr desc_entry_t icmpv6_unreach_codes[] = {
+    {ICMP6_DST_UNREACH_NOROUTE,     {"no route to dest",         "Code: No Route to Destination (0)"}},
+    {ICMP6_DST_UNREACH_ADMIN,       {"admin prohibited",         "Code: Communication with Destination Administratively Prohibited (1)"}},
+    {ICMP6_DST_UNREACH_BEYONDSCOPE, {"beyond scope of src addr", "Code: Beyond Scope of Source Address (2)"}},
+    {ICMP6_DST_UNREACH_ADDR,        {"addr unreachable",         "Code: Address Unreachable (3)"}},
+    {ICMP6_DST_UNREACH_NOPORT,      {"port unreachable",         "Code: Port Unreachable (4)"}},
+};
+
+// the other types only show the code
+constexpr auto icmpv6_codes = make_desc_numbers<256>("", "");
+constexpr auto icmpv6_known_codes = make_desc_numbers<256>("Code: (", ")");
+constexpr auto icmpv6_unknown_codes = make_desc_numbers<256>("Code: Unknown (", ")");
+
+constexpr auto icmpv6_unreach_code_table = make_desc_table<256>(icmpv6_unreach_codes,
+    [](uint32_t code){ return desc_t{"Unknown", icmpv6_unknown_codes[code]}; });
 
 /**
- * @brief Get the icmpv6 code description in a given string
+ * @brief Get the icmpv6 code description
  * 
  * @param type 
  * @param code 
- * @param desc 
  * @param verbose 
+ * @return std::string_view 
  */
-void
-get_icmpv6_code_desc(uint8_t type, uint8_t code, std::string& desc, bool verbose) {
+std::string_view
+get_icmpv6_code_desc(uint8_t type, uint8_t code, bool verbose) {
     switch(type){
         case ICMP6_DST_UNREACH:
-        // https://www.iana.org/assignments/icmpv6-parameters/icmpv6-parameters.xhtml#icmpv6-parameters-codes-2
-            switch(code){
-                case ICMP6_DST_UNREACH_NOROUTE:
-                    if (verbose){
-                        desc = "Code: No Route to Destination (" + std::to_string(code) + ")";
-                    } else {    
-                        desc = "no route to dest";
-                    }
-                    break;
-                case ICMP6_DST_UNREACH_ADMIN:
-                    if (verbose){
-                        desc = "Code: Communication with Destination Administratively Prohibited (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "admin prohibited";
-                    }
-                    break;
-                case ICMP6_DST_UNREACH_BEYONDSCOPE:
-                    if (verbose){
-                        desc = "Code: Beyond Scope of Source Address (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "beyond scope of src addr";
-                    }
-                    break;
-                case ICMP6_DST_UNREACH_ADDR:
-                    if (verbose){
-                        desc = "Code: Address Unreachable (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "addr unreachable";
-                    }
-                    break;
-                case ICMP6_DST_UNREACH_NOPORT:
-                    if (verbose){
-                        desc = "Code: Port Unreachable (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "port unreachable";
-                    }
-                    break;
-                default:
-                    if (verbose){
-                        desc = "Code: Unknown (" + std::to_string(code) + ")";
-                    } else {
-                        desc = "Unknown";
-                    }
-            }
-            break;
+            return desc_lookup(icmpv6_unreach_code_table, code, verbose);
         case ICMP6_ECHO_REQUEST:
         case ICMP6_ECHO_REPLY:
         case ND_NEIGHBOR_SOLICIT:
-            if (verbose){
-                desc = "Code: (" + std::to_string(code) + ")";
-            } else {
-                desc = std::to_string(code);
-            }
-            break;
+            return verbose ? icmpv6_known_codes[code] : icmpv6_codes[code];
         default:
-            if (verbose){
-                desc = "Code: Unknown (" + std::to_string(code) + ")";
-            } else {
-                desc = std::to_string(code);
-            }
+            return verbose ? icmpv6_unknown_codes[code] : icmpv6_codes[code];
     }
 }
 
 /**
- * @brief Get the icmpv6 type description in a given string
+ * @brief Get the icmpv6 type description
  * 
  * @param type 
- * @param desc 
  * @param verbose 
+ * @return std::string_view 
  */
-void 
-get_icmpv6_type_desc(uint8_t type, std::string& desc, bool verbose)
+std::string_view
+get_icmpv6_type_desc(uint8_t type, bool verbose)
 {
-    switch(type){
-        case ICMP6_DST_UNREACH:
-            if (verbose){
-                desc = "Type: Destination Unreachable (" + std::to_string(type) + ")";
-            } else {
-                desc = "dest unreachable";
-            }
-            break;
-        case ICMP6_ECHO_REQUEST:
-            if (verbose){
-                desc = "Type: Echo Request (" + std::to_string(type) + ")";
-            } else {
-                desc = "Echo Request";
-            }
-            break;
-        case ICMP6_ECHO_REPLY:
-            if (verbose){
-                desc = "Type: Echo Reply (" + std::to_string(type) + ")";
-            } else {
-                desc = "Echo Reply";
-            }
-            break;
-        case ND_NEIGHBOR_SOLICIT:
-            if (verbose){
-                desc = "Type: Neighbor Solicitation (" + std::to_string(type) + ")";
-            } else {
-                desc = "Neighbor Solicitation";
-            }
-            break;
-        default:
-            if (verbose){
-                desc = "Type: Unknown (" + std::to_string(type) + ")";
-            } else {
-                desc = "Unknown";
-            }
-            break;
+    return desc_lookup(icmpv6_type_table, type, verbose);
+}
+
+/**
+ * @brief Parse an ICMPv6 message into a view, without allocating
+ * and without touching the packet
+ * 
+ * @param packet 
+ * @param length length of the ICMPv6 message
+ * @param view 
+ * @return true if the header fits in length
+ */
+bool
+parse_icmpv6_view(const uint8_t *packet, uint32_t length, my_icmpv6_view_t *view)
+{
+    if (length < MY_ICMPV6_MIN_LEN){
+        return false;
+    }
+    const struct icmp6_hdr *icmp6_hdr = (const struct icmp6_hdr *)packet;
+    view->type = icmp6_hdr->icmp6_type;
+    view->code = icmp6_hdr->icmp6_code;
+    view->checksum = ntohs(icmp6_hdr->icmp6_cksum);
+    if (view->type == ICMP6_ECHO_REQUEST || view->type == ICMP6_ECHO_REPLY){
+        view->identifier = ntohs(icmp6_hdr->icmp6_id);
+        view->sequence_number = ntohs(icmp6_hdr->icmp6_seq);
+    } else {
+        view->identifier = 0;
+        view->sequence_number = 0;
     }
+    view->payload = packet + MY_ICMPV6_MIN_LEN;
+    view->payload_length = length - MY_ICMPV6_MIN_LEN;
+    return true;
 }
\ No newline at end of file
@@ -3,9 +3,10 @@
 
 #include <netinet/in.h>
 #include <netinet/icmp6.h>
-#include <string>
+#include <string_view>
 #include "check_sum.h"
 #include "ipv6.h"
+#include "arena.h"
 
 #define MY_DEST_UNREACH_MINLEN 32 // 8 bytes 
 
@@ -67,10 +68,10 @@ Neighbor Solicitation Message Format
 
 typedef struct my_icmpv6 {
     uint8_t type;
-    std::string icmpv6_type_desc;
+    std::string_view icmpv6_type_desc;
 
     uint8_t code;
-    std::string icmpv6_code_desc;
+    std::string_view icmpv6_code_desc;
 
     uint16_t checksum;
     uint16_t calculated_checksum;
@@ -78,17 +79,28 @@ typedef struct my_icmpv6 {
 
     uint16_t identifier;
     uint16_t sequence_number;
-    uint8_t *payload; // this is reserved for the ICMPv6 payload
+    uint8_t *payload; // this is reserved for the ICMPv6 payload, in the arena
 
     my_ipv6_header_t og_ipv6_header;
 
 } my_icmpv6_t;
 
+// raw fields of the message, pointers into the packet, nothing allocated
+typedef struct my_icmpv6_view {
+    uint8_t type;
+    uint8_t code;
+    uint16_t checksum;        // not verified, needs the IPv6 pseudo-header
+    uint16_t identifier;      // echo request / reply only
+    uint16_t sequence_number;
+    const uint8_t *payload;   // after the 8 bytes header
+    uint32_t payload_length;
+} my_icmpv6_view_t;
+
 
-my_icmpv6_t parse_icmpv6(const uint8_t *packet, size_t packet_length, uint8_t *src_ipv6, uint8_t *dst_ipv6, bool verbose);
-void free_parse_icmpv6(my_icmpv6_t *my_icmpv6);
+my_icmpv6_t parse_icmpv6(const uint8_t *packet, size_t packet_length, const uint8_t *src_ipv6, const uint8_t *dst_ipv6, arena_t *arena, bool verbose);
+bool parse_icmpv6_view(const uint8_t *packet, uint32_t length, my_icmpv6_view_t *view);
 // helpers
-void get_icmpv6_type_desc(uint8_t type, std::string& desc, bool verbose);
-void get_icmpv6_code_desc(uint8_t type, uint8_t code, std::string& desc, bool verbose);
+std::string_view get_icmpv6_type_desc(uint8_t type, bool verbose);
+std::string_view get_icmpv6_code_desc(uint8_t type, uint8_t code, bool verbose);
 
 #endif
\ No newline at end of file
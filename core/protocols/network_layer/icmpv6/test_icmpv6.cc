@@ -1,7 +1,11 @@
 #include "icmpv6.h"
 #include <cassert>
+#include <cstring>
 #include <string>
 
+// the payloads are copied there
+arena_t arena;
+
 void test_parse_icmpv6_neighbor_solicit()
 {
     uint8_t icmp6_packet[] = {
@@ -27,9 +31,9 @@ void test_parse_icmpv6_neighbor_solicit()
     0x00, 0x00, 0x00, 0x01, 
     0xFF, 0x74, 0x61, 0x51
     };
-    my_ipv6_header_t ipv6_header = parse_ipv6(ipv6_packet, false);
+    my_ipv6_header_t ipv6_header = parse_ipv6(ipv6_packet, sizeof(ipv6_packet), false);
 
-    my_icmpv6_t icmpv6 = parse_icmpv6(icmp6_packet, sizeof(icmp6_packet), ipv6_header.raw_source_address, ipv6_header.raw_destination_address, false);
+    my_icmpv6_t icmpv6 = parse_icmpv6(icmp6_packet, sizeof(icmp6_packet), ipv6_header.raw_source_address, ipv6_header.raw_destination_address, &arena, false);
     assert(icmpv6.type == ND_NEIGHBOR_SOLICIT);
     assert(icmpv6.icmpv6_type_desc == "Neighbor Solicitation");
     assert(icmpv6.code == 0);
@@ -71,8 +75,8 @@ void test_parse_icmpv6_destination_unreachable(){
     0x07, 0x63, 0x03, 0xB7
     };
 
-    my_ipv6_header_t ipv6_header = parse_ipv6(ipv6_packet, false);
-    my_icmpv6_t icmpv6 = parse_icmpv6(icmp6_packet, sizeof(icmp6_packet), ipv6_header.raw_source_address, ipv6_header.raw_destination_address, false);
+    my_ipv6_header_t ipv6_header = parse_ipv6(ipv6_packet, sizeof(ipv6_packet), false);
+    my_icmpv6_t icmpv6 = parse_icmpv6(icmp6_packet, sizeof(icmp6_packet), ipv6_header.raw_source_address, ipv6_header.raw_destination_address, &arena, false);
     assert(icmpv6.type == ICMP6_DST_UNREACH);
     assert(icmpv6.icmpv6_type_desc == "dest unreachable");
     assert(icmpv6.code == 3);
@@ -87,12 +91,13 @@ void test_parse_icmpv6_destination_unreachable(){
     assert(icmpv6.og_ipv6_header.next_header == 17);
     assert(icmpv6.og_ipv6_header.next_header_name == "UDP");
     assert(icmpv6.og_ipv6_header.hop_limit == 64);
-    assert(icmpv6.og_ipv6_header.source_address == "fe80::10d6:8e22:763:3b7");
-    assert(icmpv6.og_ipv6_header.destination_address == "fe80::1470:453e:c74:6151");
+    assert(strcmp(icmpv6.og_ipv6_header.source_address, "fe80::10d6:8e22:763:3b7") == 0);
+    assert(strcmp(icmpv6.og_ipv6_header.destination_address, "fe80::1470:453e:c74:6151") == 0);
 }
 
 int main()
 {   
+    arena_init(&arena, 0);
     test_parse_icmpv6_destination_unreachable();
     test_parse_icmpv6_neighbor_solicit();
     return 0;
@@ -8,6 +8,7 @@
 #include <netinet/in.h>
 
 #include "mac_address.h"
+#include "addr_format.h"
 #include "dscp.h"
 #include "check_sum.h"
 
@@ -20,14 +21,14 @@ typedef struct my_ipv4_header {
     DSCP: https://datatracker.ietf.org/doc/html/rfc2474#section-3
     DSCP: first 6 bits of ToS 
     */
-    std::string dscp_desc;    // DSCP [0-63]
+    std::string_view dscp_desc;    // DSCP [0-63]
     uint8_t dscp_value;    // Description of the DSCP value
 
     /*
     ECN: https://datatracker.ietf.org/doc/html/rfc3168#section-5 [Page 8]
     ECN: last 2 bits of ToS
     */
-    std::string ecn_desc;     // ECN [0-3]
+    std::string_view ecn_desc;     // ECN [0-3]
     uint8_t ecn_value;     // Description of the ECN value
 
     uint16_t total_length;  
@@ -39,7 +40,7 @@ typedef struct my_ipv4_header {
     flags DF: 0 = May Fragment, 1 = Don't Fragment
     flags MF: 0 = Last Fragment, 1 = More Fragments
     */
-    std::string flags_desc; // Description of the flags
+    std::string_view flags_desc; // Description of the flags
     struct {
         uint8_t reserved: 1;
         uint8_t dont_fragment: 1;
@@ -50,7 +51,7 @@ typedef struct my_ipv4_header {
     uint8_t time_to_live;
 
     uint8_t protocol;
-    std::string protocol_name;
+    std::string_view protocol_name;
 
     uint16_t checksum;
     bool checksum_correct;
@@ -58,17 +59,35 @@ typedef struct my_ipv4_header {
     uint8_t raw_source_address[4];
     uint8_t raw_destination_address[4];
 
-    std::string source_ipv4;
-    std::string destination_ipv4;
+    char source_ipv4[IPV4_ADDRESS_STRLEN];
+    char destination_ipv4[IPV4_ADDRESS_STRLEN];
 
 } my_ipv4_header_t;
 
-my_ipv4_header_t parse_ipv4(const uint8_t *packet, bool verbose);
+// raw fields of the header, pointers into the packet, nothing allocated
+typedef struct my_ipv4_view {
+    uint8_t version;
+    uint8_t header_length;   // in bytes
+    uint8_t dscp_value;
+    uint8_t ecn_value;
+    uint16_t total_length;
+    uint16_t identification;
+    uint16_t ip_off;         // flags + fragment offset, as in get_flags_desc()
+    uint16_t fragment_offset;
+    uint8_t time_to_live;
+    uint8_t protocol;
+    uint16_t checksum;       // as found, see ipv4_view_checksum_correct()
+    const uint8_t *source_address;      // 4 bytes
+    const uint8_t *destination_address; // 4 bytes
+} my_ipv4_view_t;
+
+my_ipv4_header_t parse_ipv4(const uint8_t *packet, uint32_t length, bool verbose);
+bool parse_ipv4_view(const uint8_t *packet, uint32_t length, my_ipv4_view_t *view);
+bool ipv4_view_checksum_correct(const uint8_t *packet, const my_ipv4_view_t *view);
 
 // helpers
-void get_flags_desc(std::string& flags_desc, uint16_t ip_off, bool verbose);
-void ipv4_get_protocol_name(uint8_t protocol, std::string& protocol_name, bool verbose);
-uint16_t* build_ipv4_pseudo_header_and_packet(uint8_t *packet, int packet_len, uint8_t *src_ip, uint8_t *dst_ip, uint8_t net_protocol, int *combined_len);
+std::string_view get_flags_desc(uint16_t ip_off, bool verbose);
+std::string_view ipv4_get_protocol_name(uint8_t protocol, bool verbose);
 
 
 #endif
\ No newline at end of file
@@ -1,56 +1,58 @@
 #include "ipv4.h"
 #include <cassert>
+#include <cstring>
 #include <arpa/inet.h>
 
 void test_get_flags_desc(){
     uint16_t ip_off = 0x4000;
-    std::string flags_desc;
-    get_flags_desc(flags_desc, ip_off, true);
+    std::string_view flags_desc;
+    flags_desc = get_flags_desc(ip_off, true);
     assert(flags_desc == "DF (Don't Fragment)");
 
     ip_off = 0x2000;
-    get_flags_desc(flags_desc, ip_off, true);
+    flags_desc = get_flags_desc(ip_off, true);
     assert(flags_desc == "MF (More Fragments)");
 
     ip_off = 0x8000;
-    get_flags_desc(flags_desc, ip_off, false);
+    flags_desc = get_flags_desc(ip_off, false);
     assert(flags_desc == "RF");
 
     ip_off = 0x4000;
-    get_flags_desc(flags_desc, ip_off, false);
+    flags_desc = get_flags_desc(ip_off, false);
     assert(flags_desc == "DF");
 
     ip_off = 0x2000;
-    get_flags_desc(flags_desc, ip_off, false);
+    flags_desc = get_flags_desc(ip_off, false);
     assert(flags_desc == "MF");
 }
 
 void test_get_protocol_name(){
     uint8_t protocol = 0x06;
-    std::string protocol_name;
-    ipv4_get_protocol_name(protocol, protocol_name, true);
+    std::string_view protocol_name;
+    protocol_name = ipv4_get_protocol_name(protocol, true);
     assert(protocol_name == "TCP (Transmission Control Protocol)");
 
     protocol = 0x11;
-    ipv4_get_protocol_name(protocol, protocol_name, true);
+    protocol_name = ipv4_get_protocol_name(protocol, true);
     assert(protocol_name == "UDP (User Datagram Protocol)");
 
     protocol = 0x01;
-    ipv4_get_protocol_name(protocol, protocol_name, false);
+    protocol_name = ipv4_get_protocol_name(protocol, false);
     assert(protocol_name == "ICMP");
 
     protocol = 0x02;
-    ipv4_get_protocol_name(protocol, protocol_name, false);
+    protocol_name = ipv4_get_protocol_name(protocol, false);
     assert(protocol_name == "IGMP");
 }
 
 void test_parse_ipv4(){
-    uint8_t packet[] = {
+    // read only memory, like a mapped file: the parser must not write
+    static const uint8_t packet[] = {
         0x45, 0x00, 0x00, 0x73, 0x00, 0x00, 0x40, 0x00, 0x40, 0x11, 0xb8, 0x61,
         0xc0, 0xa8, 0x00, 0x01, 0xc0, 0xa8, 0x00, 0xc7
     };
     
-    my_ipv4_header_t ipv4_header = parse_ipv4(packet, true);
+    my_ipv4_header_t ipv4_header = parse_ipv4(packet, sizeof(packet), true);
     
     // test version & header_length
     assert(ipv4_header.version == 4);
@@ -79,13 +81,26 @@ void test_parse_ipv4(){
     assert(ipv4_header.checksum_correct == true);
 
     // test source_ipv4, destination_ipv4
-    assert(ipv4_header.source_ipv4 == "192.168.0.1");
-    assert(ipv4_header.destination_ipv4 == "192.168.0.199");
+    assert(strcmp(ipv4_header.source_ipv4, "192.168.0.1") == 0);
+    assert(strcmp(ipv4_header.destination_ipv4, "192.168.0.199") == 0);
+
+    // the header is as it was, a second reader sees the same checksum
+    my_ipv4_header_t again = parse_ipv4(packet, sizeof(packet), true);
+    assert(again.checksum == 0xb861);
+    assert(again.checksum_correct == true);
+}
+
+void test_parse_ipv4_truncated(){
+    static const uint8_t packet[] = {0x45, 0x00, 0x00, 0x73, 0x00, 0x00, 0x40, 0x00};
+    my_ipv4_header_t ipv4_header = parse_ipv4(packet, sizeof(packet), true);
+    assert(ipv4_header.version == 0);
+    assert(ipv4_header.header_length == 0);
 }
 
 int main(){
     test_get_flags_desc();
     test_get_protocol_name();
     test_parse_ipv4();
+    test_parse_ipv4_truncated();
     return 0;
 }
\ No newline at end of file
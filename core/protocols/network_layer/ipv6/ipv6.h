@@ -62,11 +62,11 @@ typedef struct my_ipv6_header {
 
     // DSCP
     uint8_t dscp_value;
-    std::string dscp_desc;
+    std::string_view dscp_desc;
 
     // ECN
     uint8_t ecn_value;
-    std::string ecn_desc;
+    std::string_view ecn_desc;
 
     // Payload length
     uint16_t payload_length;
@@ -75,7 +75,7 @@ typedef struct my_ipv6_header {
     immediately following the IPv6 header.  
     Uses the same values as the IPv4 Protocol field. */
     uint8_t next_header;
-    std::string next_header_name;
+    std::string_view next_header_name;
 
     // Hop Limit
     uint8_t hop_limit;
@@ -84,11 +84,25 @@ typedef struct my_ipv6_header {
     uint8_t raw_source_address[IPV6_INT8_ADDR_SIZE];
     uint8_t raw_destination_address[IPV6_INT8_ADDR_SIZE];
 
-    std::string source_address;
-    std::string destination_address;
+    char source_address[IPV6_ADDRESS_STRLEN];
+    char destination_address[IPV6_ADDRESS_STRLEN];
 } my_ipv6_header_t;
 
-my_ipv6_header_t parse_ipv6(const u_int8_t *packet, bool verbose);
-uint16_t* build_ipv6_pseudo_header_and_packet(uint8_t *packet, int packet_length, uint8_t *src_ip, uint8_t *dst_ip, uint8_t next_header, int *combined_len);
+// raw fields of the header, pointers into the packet, nothing allocated
+typedef struct my_ipv6_view {
+    uint8_t version;
+    uint8_t traffic_class;
+    uint32_t flow_label;
+    uint8_t dscp_value;
+    uint8_t ecn_value;
+    uint16_t payload_length;
+    uint8_t next_header;
+    uint8_t hop_limit;
+    const uint8_t *source_address;      // IPV6_INT8_ADDR_SIZE bytes
+    const uint8_t *destination_address; // IPV6_INT8_ADDR_SIZE bytes
+} my_ipv6_view_t;
+
+my_ipv6_header_t parse_ipv6(const uint8_t *packet, uint32_t length, bool verbose);
+bool parse_ipv6_view(const uint8_t *packet, uint32_t length, my_ipv6_view_t *view);
 
 #endif
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "ipv6.h"
 #include <cassert>
+#include <cstring>
 
 void test_parse_ipv6()
 {
@@ -16,7 +17,7 @@ void test_parse_ipv6()
         0x03, 0x70, 0x73, 0x35  
     };
 
-    my_ipv6_header_t ipv6_header = parse_ipv6(packet, false);
+    my_ipv6_header_t ipv6_header = parse_ipv6(packet, sizeof(packet), false);
     assert(ipv6_header.version == 6);
     assert(ipv6_header.traffic_class == 2);
     assert(ipv6_header.flow_label == 256);
@@ -28,8 +29,8 @@ void test_parse_ipv6()
     assert(ipv6_header.next_header == 6);
     assert(ipv6_header.next_header_name == "TCP");
     assert(ipv6_header.hop_limit == 64);
-    assert(ipv6_header.source_address == "2001:db8:85a3::8a2e:370:7334");
-    assert(ipv6_header.destination_address == "2001:db8:85a3::8a2e:370:7335");
+    assert(strcmp(ipv6_header.source_address, "2001:db8:85a3::8a2e:370:7334") == 0);
+    assert(strcmp(ipv6_header.destination_address, "2001:db8:85a3::8a2e:370:7335") == 0);
 }
 
 int main()
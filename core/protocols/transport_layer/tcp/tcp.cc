@@ -1,18 +1,29 @@
 #include "tcp.h"
+#include "desc_table.h"
+#include "stage_timer.h"
 
 /**
- * @brief Parse TCP header, check if the checksum is correct
+ * @brief Parse TCP header, check if the checksum is correct.
+ * The packet is only read.
  * 
  * @param packet 
+ * @param length length of the segment, header and payload
+ * @param src_add NULL to leave the checksum unverified
+ * @param dst_add 
+ * @param net_protocol 
+ * @param arena the options are copied there
  * @param verbose 
- * @return my_tcp_header_t 
+ * @return my_tcp_header_t empty if the header doesn't fit in length
  */
 my_tcp_header_t 
-parse_tcp_header(const uint8_t *packet, uint8_t *src_add, uint8_t *dst_add, uint8_t net_protocol, bool verbose)
+parse_tcp_header(const uint8_t *packet, uint32_t length, const uint8_t *src_add, const uint8_t *dst_add, uint8_t net_protocol, arena_t *arena, bool verbose)
 {
-    my_tcp_header_t tcp_header;
+    my_tcp_header_t tcp_header = {};
+    if (length < sizeof(struct tcphdr)){
+        return tcp_header;
+    }
 
-    struct tcphdr *tcp = (struct tcphdr *)packet;
+    const struct tcphdr *tcp = (const struct tcphdr *)packet;
     tcp_header.source_port = ntohs(tcp->th_sport);
     tcp_header.destination_port = ntohs(tcp->th_dport);
     tcp_header.sequence_number = ntohl(tcp->th_seq);
@@ -21,29 +32,33 @@ parse_tcp_header(const uint8_t *packet, uint8_t *src_add, uint8_t *dst_add, uint
     tcp_header.data_offset = tcp->th_off;
     tcp_header.reserved = tcp->th_x2;
     tcp_header.flags = tcp->th_flags;
-    get_tcp_flags_desc(tcp_header.flags, tcp_header.tcp_flags_desc, verbose);
+    tcp_header.tcp_flags_desc = get_tcp_flags_desc(tcp_header.flags, verbose);
 
     tcp_header.window = ntohs(tcp->th_win);
 
     tcp_header.checksum = ntohs(tcp->th_sum);
-    tcp->th_sum = 0;
-
-    // Build the pseudo-header and packet
-    int combined_len;
-    uint16_t *combined = NULL;
-    if (net_protocol == IPPROTO_IPV4){
-        combined = build_ipv4_pseudo_header_and_packet((uint8_t*)tcp, tcp_header.data_offset * 4, src_add, dst_add, IPPROTO_TCP, &combined_len);
-    } else if (net_protocol == IPPROTO_IPV6) {
-        combined = build_ipv6_pseudo_header_and_packet((uint8_t*)tcp, tcp_header.data_offset * 4, src_add, dst_add, IPPROTO_TCP, &combined_len);
-    }
 
-    // Calculate the checksum
-    uint16_t calculated_checksum = ntohs(calculate_checksum(combined, combined_len));
-    tcp_header.calculated_checksum = calculated_checksum;
-    free(combined);
+    // without the addresses of the pseudo-header the checksum isn't verified
+    if (src_add != NULL){
+        STAGE_SCOPE(STAGE_CHECKSUMS);
+        // Sum the pseudo-header and the segment where they are
+        uint32_t sum = 0;
+        if (net_protocol == IPPROTO_IPV4){
+            sum = checksum_add_pseudo_ipv4(sum, src_add, dst_add, IPPROTO_TCP, length);
+        } else if (net_protocol == IPPROTO_IPV6) {
+            sum = checksum_add_pseudo_ipv6(sum, src_add, dst_add, IPPROTO_TCP, length);
+        }
+        sum = checksum_add(sum, tcp, length);
+        // the checksum field counts as 0
+        sum = checksum_remove(sum, tcp->th_sum);
+
+        // Calculate the checksum
+        uint16_t calculated_checksum = ntohs(checksum_finish(sum));
+        tcp_header.calculated_checksum = calculated_checksum;
 
-    // Check if checksum match
-    tcp_header.checksum_correct = (calculated_checksum == tcp_header.checksum || tcp_header.calculated_checksum == 0x0000 || tcp_header.calculated_checksum == 0xFFFF);
+        // Check if checksum match
+        tcp_header.checksum_correct = (calculated_checksum == tcp_header.checksum || tcp_header.calculated_checksum == 0x0000 || tcp_header.calculated_checksum == 0xFFFF);
+    }
 
     tcp_header.urgent_pointer = ntohs(tcp->th_urp);
 
@@ -55,12 +70,8 @@ parse_tcp_header(const uint8_t *packet, uint8_t *src_add, uint8_t *dst_add, uint
     //    0         -       End of option list.
     //    1         -       No-Operation.
     //    2         4       Maximum Segment Size.
-    if (tcp_header.data_offset > 5){
-        tcp_header.options = (uint8_t *)malloc((tcp_header.data_offset - 5) * 4);
-        if (tcp_header.options == NULL){
-            perror("malloc");
-            exit(EXIT_FAILURE);
-        }
+    if (tcp_header.data_offset > 5 && tcp_header.data_offset * 4u <= length){
+        tcp_header.options = (uint8_t *)arena_alloc(arena, (tcp_header.data_offset - 5) * 4);
         memcpy(tcp_header.options, packet + 20, (tcp_header.data_offset - 5) * 4);
         get_tcp_options_desc(tcp_header.options, (tcp_header.data_offset - 5) * 4, tcp_header.tcp_options_desc, verbose);
     } else {
@@ -71,6 +82,39 @@ parse_tcp_header(const uint8_t *packet, uint8_t *src_add, uint8_t *dst_add, uint
     return tcp_header;
 }
 
+/**
+ * @brief Parse the TCP header into a view, without allocating
+ * and without touching the packet
+ * 
+ * @param packet 
+ * @param length bytes available from packet
+ * @param view 
+ * @return true if the header (options included) fits in length
+ */
+bool
+parse_tcp_view(const uint8_t *packet, uint32_t length, my_tcp_view_t *view)
+{
+    if (length < sizeof(struct tcphdr)){
+        return false;
+    }
+    const struct tcphdr *tcp = (const struct tcphdr *)packet;
+    view->header_length = tcp->th_off * 4;
+    if (view->header_length < sizeof(struct tcphdr) || view->header_length > length){
+        return false;
+    }
+    view->source_port = ntohs(tcp->th_sport);
+    view->destination_port = ntohs(tcp->th_dport);
+    view->sequence_number = ntohl(tcp->th_seq);
+    view->acknowledgment_number = ntohl(tcp->th_ack);
+    view->flags = tcp->th_flags;
+    view->window = ntohs(tcp->th_win);
+    view->checksum = ntohs(tcp->th_sum);
+    view->urgent_pointer = ntohs(tcp->th_urp);
+    view->options_length = view->header_length - sizeof(struct tcphdr);
+    view->options = view->options_length > 0 ? packet + sizeof(struct tcphdr) : NULL;
+    return true;
+}
+
 /**
  * @brief Get the tcp options description in a string
  * supports only the 3 start options described in https://datatracker.ietf.org/doc/html/rfc793#section-3.1
@@ -128,63 +172,61 @@ get_tcp_options_desc(uint8_t *options, uint8_t options_length, std::string& desc
 }
 
 /**
- * @brief Get the tcp flags description in a string
+ * @brief Build the description of every flags byte at compile time,
+ * prefix then the names set ("FIN ACK ") or none, then "(0x11)"
  * 
- * @param flags 
- * @param desc 
- * @param verbose 
+ * @param prefix 
+ * @param none 
+ * @return desc_texts_t<256> 
  */
-void 
-get_tcp_flags_desc(uint8_t flags, std::string& desc, bool verbose)
+constexpr desc_texts_t<256>
+make_tcp_flags_texts(std::string_view prefix, std::string_view none)
 {
-    if (verbose)
-    {   
-        desc += "Flags: ";
-        if (flags & TH_FIN){
-            desc += "FIN ";
-        }
-        if (flags & TH_SYN){
-            desc += "SYN ";
-        }
-        if (flags & TH_RST){
-            desc += "RST ";
-        }
-        if (flags & TH_PUSH){
-            desc += "PSH ";
-        }
-        if (flags & TH_ACK){
-            desc += "ACK ";
-        }
-        if (flags & TH_URG){
-            desc += "URG ";
-        }
-        if (desc == "Flags: "){
-            desc += "None / Unknown ";
-        }
-        desc += "(0x" + std::to_string(flags) + ")";
-    } else {
-        if (flags & TH_FIN){
-            desc += "FIN ";
-        }
-        if (flags & TH_SYN){
-            desc += "SYN ";
-        }
-        if (flags & TH_RST){
-            desc += "RST ";
-        }
-        if (flags & TH_PUSH){
-            desc += "PSH ";
-        }
-        if (flags & TH_ACK){
-            desc += "ACK ";
+    constexpr uint8_t bits[] = {TH_FIN, TH_SYN, TH_RST, TH_PUSH, TH_ACK, TH_URG};
+    constexpr std::string_view names[] = {"FIN ", "SYN ", "RST ", "PSH ", "ACK ", "URG "};
+    constexpr auto numbers = make_desc_numbers<256>("(0x", ")", true);
+
+    desc_texts_t<256> texts{};
+    for (size_t flags = 0; flags < 256; flags++){
+        char *text = texts.texts[flags];
+        size_t length = 0;
+        for (char c : prefix){
+            text[length++] = c;
+        }
+        size_t named = length;
+        for (size_t i = 0; i < 6; i++){
+            if (flags & bits[i]){
+                for (char c : names[i]){
+                    text[length++] = c;
+                }
+            }
         }
-        if (flags & TH_URG){
-            desc += "URG ";
+        if (length == named){
+            for (char c : none){
+                text[length++] = c;
+            }
         }
-        if (desc.empty()){
-            desc += "none/? ";
+        for (char c : numbers[flags]){
+            text[length++] = c;
         }
-        desc += "(0x" + std::to_string(flags) + ")";
+        text[length] = '\0';
+        texts.lengths[flags] = length;
     }
+    return texts;
 }
 
+constexpr auto tcp_flags_brief = make_tcp_flags_texts("", "none/? ");
+constexpr auto tcp_flags_verbose = make_tcp_flags_texts("Flags: ", "None / Unknown ");
+
+/**
+ * @brief Get the tcp flags description, "FIN ACK (0x11)"
+ * 
+ * @param flags 
+ * @param verbose 
+ * @return std::string_view 
+ */
+std::string_view
+get_tcp_flags_desc(uint8_t flags, bool verbose)
+{
+    return verbose ? tcp_flags_verbose[flags] : tcp_flags_brief[flags];
+}
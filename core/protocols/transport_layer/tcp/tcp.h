@@ -3,9 +3,11 @@
 
 #include <netinet/tcp.h>
 #include <string>
+#include <string_view>
 
 #include "ipv4.h"
 #include "ipv6.h"
+#include "arena.h"
 
 #ifdef __linux
 #define IPPROTO_IPV4 IPPROTO_IPIP
@@ -46,7 +48,7 @@ typedef struct my_tcp_header {
     uint8_t data_offset : 4;
     uint8_t reserved : 6;
     uint8_t flags: 6;
-    std::string tcp_flags_desc;
+    std::string_view tcp_flags_desc;
 
     uint16_t window;
     uint16_t checksum;
@@ -55,16 +57,32 @@ typedef struct my_tcp_header {
 
     uint16_t urgent_pointer;
 
-    uint8_t *options;
+    uint8_t *options; // in the arena
     std::string tcp_options_desc;
 
 } my_tcp_header_t;
 
-my_tcp_header_t parse_tcp_header(const uint8_t *packet, uint8_t *src_add, uint8_t *dst_add, uint8_t net_protocol, bool verbose);
+// raw fields of the header, pointers into the packet, nothing allocated
+typedef struct my_tcp_view {
+    uint16_t source_port;
+    uint16_t destination_port;
+    uint32_t sequence_number;
+    uint32_t acknowledgment_number;
+    uint8_t header_length;    // data offset in bytes
+    uint8_t flags;
+    uint16_t window;
+    uint16_t checksum;        // not verified, needs the pseudo-header
+    uint16_t urgent_pointer;
+    const uint8_t *options;   // NULL if there are none
+    uint8_t options_length;
+} my_tcp_view_t;
+
+my_tcp_header_t parse_tcp_header(const uint8_t *packet, uint32_t length, const uint8_t *src_add, const uint8_t *dst_add, uint8_t net_protocol, arena_t *arena, bool verbose);
+bool parse_tcp_view(const uint8_t *packet, uint32_t length, my_tcp_view_t *view);
 
 
 // helpers
 void get_tcp_options_desc(uint8_t *options, uint8_t options_length, std::string& desc, bool verbose);
-void get_tcp_flags_desc(uint8_t flags, std::string& desc, bool verbose);
+std::string_view get_tcp_flags_desc(uint8_t flags, bool verbose);
 
 #endif
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include "tcp.h"
 #include <cassert>
 
+// the options are copied there
+arena_t arena;
+
 void test_parse_tcp_ipv4()
 {
     uint8_t tcp_packet[] = {
@@ -20,8 +23,8 @@ void test_parse_tcp_ipv4()
     0x0a, 0xc0, 0x06, 0x5f
     };
 
-    my_ipv4_header_t ipv4 = parse_ipv4(ipv4_header, false);
-    my_tcp_header_t tcp = parse_tcp_header(tcp_packet, ipv4.raw_source_address, ipv4.raw_destination_address, IPPROTO_IPV4, false);
+    my_ipv4_header_t ipv4 = parse_ipv4(ipv4_header, sizeof(ipv4_header), false);
+    my_tcp_header_t tcp = parse_tcp_header(tcp_packet, sizeof(tcp_packet), ipv4.raw_source_address, ipv4.raw_destination_address, IPPROTO_IPV4, &arena, false);
 
     assert(tcp.source_port == 443);
     assert(tcp.destination_port == 59691);
@@ -64,8 +67,8 @@ void test_parse_tcp_ipv6()
     0x00, 0x00, 0x00, 0x00, 0x01
     };
 
-    my_ipv6_header_t ipv6 = parse_ipv6(ipv6_header, false);
-    my_tcp_header_t tcp = parse_tcp_header(tcp_packet, ipv6.raw_source_address, ipv6.raw_destination_address, IPPROTO_IPV6, false);
+    my_ipv6_header_t ipv6 = parse_ipv6(ipv6_header, sizeof(ipv6_header), false);
+    my_tcp_header_t tcp = parse_tcp_header(tcp_packet, sizeof(tcp_packet), ipv6.raw_source_address, ipv6.raw_destination_address, IPPROTO_IPV6, &arena, false);
     assert(tcp.source_port == 60198);
     assert(tcp.destination_port == 10000);
     assert(tcp.sequence_number == 2686583382);
@@ -83,6 +86,7 @@ void test_parse_tcp_ipv6()
 
 int main()
 {
+    arena_init(&arena, 0);
     test_parse_tcp_ipv4();
     test_parse_tcp_ipv6();
     return 0;
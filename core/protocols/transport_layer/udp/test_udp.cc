@@ -25,8 +25,8 @@ void test_parse_udp_ipv4()
         0x0A, 0xC0, 0x06, 0x5F
     };
 
-    my_ipv4_header_t ipv4 = parse_ipv4(ipv4_header, false);
-    my_udp_header_t udp = parse_udp(udp_header, ipv4.raw_source_address, ipv4.raw_destination_address, IPPROTO_IPV4, false);
+    my_ipv4_header_t ipv4 = parse_ipv4(ipv4_header, sizeof(ipv4_header), false);
+    my_udp_header_t udp = parse_udp(udp_header, sizeof(udp_header), ipv4.raw_source_address, ipv4.raw_destination_address, IPPROTO_IPV4, false);
 
     assert(udp.source_port == 443);
     assert(udp.destination_port == 58632);
@@ -56,8 +56,8 @@ void test_parse_udp_ipv6()
         0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01
     };
 
-    my_ipv6_header_t ipv6 = parse_ipv6(ipv6_header, false);
-    my_udp_header_t udp = parse_udp(udpv6_header, ipv6.raw_source_address, ipv6.raw_destination_address, IPPROTO_IPV6, false);
+    my_ipv6_header_t ipv6 = parse_ipv6(ipv6_header, sizeof(ipv6_header), false);
+    my_udp_header_t udp = parse_udp(udpv6_header, sizeof(udpv6_header), ipv6.raw_source_address, ipv6.raw_destination_address, IPPROTO_IPV6, false);
 
     assert(udp.source_port == 51422);
     assert(udp.destination_port == 10000);
@@ -1,45 +1,80 @@
 #include "udp.h"
+#include "stage_timer.h"
 
 /**
- * @brief Parse the udp header and check if the checksum is correct
+ * @brief Parse the udp header and check if the checksum is correct.
+ * The packet is only read.
  * 
  * @param packet 
- * @param src_add 
+ * @param length bytes available from packet
+ * @param src_add NULL to leave the checksum unverified
  * @param dst_add 
  * @param net_protocol 
  * @param verbose 
- * @return my_udp_header_t 
+ * @return my_udp_header_t empty if the header doesn't fit in length
  */
 my_udp_header_t 
-parse_udp(const uint8_t *packet, uint8_t *src_add, uint8_t *dst_add, uint8_t net_protocol, bool verbose)
+parse_udp(const uint8_t *packet, uint32_t length, const uint8_t *src_add, const uint8_t *dst_add, uint8_t net_protocol, bool verbose)
 {   
-    my_udp_header_t udp_header;
+    my_udp_header_t udp_header = {};
+    if (length < sizeof(struct udphdr)){
+        return udp_header;
+    }
 
-    struct udphdr *udp = (struct udphdr *)packet;
+    const struct udphdr *udp = (const struct udphdr *)packet;
     udp_header.source_port = ntohs(udp->uh_sport);
     udp_header.destination_port = ntohs(udp->uh_dport);
     udp_header.length = ntohs(udp->uh_ulen);
 
     // Checksum
     udp_header.checksum = ntohs(udp->uh_sum);
-    udp->uh_sum = 0;
 
-    // Build the pseudo-header and packet
-    int combined_len;
-    uint16_t *combined = NULL;
-    if (net_protocol == IPPROTO_IPV4){
-        combined = build_ipv4_pseudo_header_and_packet((uint8_t*)udp, udp_header.length, src_add, dst_add, IPPROTO_UDP, &combined_len);
-    } else if (net_protocol == IPPROTO_IPV6) {
-        combined = build_ipv6_pseudo_header_and_packet((uint8_t*)udp, udp_header.length, src_add, dst_add, IPPROTO_UDP, &combined_len);
-    }
+    // without the addresses of the pseudo-header the checksum isn't verified
+    if (src_add != NULL){
+        STAGE_SCOPE(STAGE_CHECKSUMS);
+        // Sum the pseudo-header and the datagram where they are
+        uint32_t sum = 0;
+        if (net_protocol == IPPROTO_IPV4){
+            sum = checksum_add_pseudo_ipv4(sum, src_add, dst_add, IPPROTO_UDP, udp_header.length);
+        } else if (net_protocol == IPPROTO_IPV6) {
+            sum = checksum_add_pseudo_ipv6(sum, src_add, dst_add, IPPROTO_UDP, udp_header.length);
+        }
+        // a datagram cut short by the capture is summed as far as it goes
+        sum = checksum_add(sum, udp, (udp_header.length < length) ? udp_header.length : length);
+        // the checksum field counts as 0
+        sum = checksum_remove(sum, udp->uh_sum);
 
-    // Calculate the checksum
-    uint16_t calculated_checksum = ntohs(calculate_checksum(combined, combined_len));
-    udp_header.calculated_checksum = calculated_checksum;
-    free(combined);
-    
-    // Check if checksum match
-    udp_header.checksum_correct = (calculated_checksum == udp_header.checksum || udp_header.calculated_checksum == 0x0000 || udp_header.calculated_checksum == 0xFFFF);
+        // Calculate the checksum
+        uint16_t calculated_checksum = ntohs(checksum_finish(sum));
+        udp_header.calculated_checksum = calculated_checksum;
+        
+        // Check if checksum match
+        udp_header.checksum_correct = (calculated_checksum == udp_header.checksum || udp_header.calculated_checksum == 0x0000 || udp_header.calculated_checksum == 0xFFFF);
+    }
 
     return udp_header;
+}
+
+/**
+ * @brief Parse the UDP header into a view, without allocating
+ * and without touching the packet
+ * 
+ * @param packet 
+ * @param length bytes available from packet
+ * @param view 
+ * @return true if the header fits in length
+ */
+bool
+parse_udp_view(const uint8_t *packet, uint32_t length, my_udp_view_t *view)
+{
+    if (length < sizeof(struct udphdr)){
+        return false;
+    }
+    const struct udphdr *udp = (const struct udphdr *)packet;
+    view->source_port = ntohs(udp->uh_sport);
+    view->destination_port = ntohs(udp->uh_dport);
+    view->length = ntohs(udp->uh_ulen);
+    view->checksum = ntohs(udp->uh_sum);
+    view->payload = packet + sizeof(struct udphdr);
+    return true;
 }
\ No newline at end of file
@@ -43,6 +43,16 @@ typedef struct my_udp_header{
 
 } my_udp_header_t;
 
-my_udp_header_t parse_udp(const uint8_t *packet, uint8_t *src_add, uint8_t *dst_add, uint8_t net_protocol, bool verbose);
+// raw fields of the header, nothing allocated
+typedef struct my_udp_view {
+    uint16_t source_port;
+    uint16_t destination_port;
+    uint16_t length;
+    uint16_t checksum;        // not verified, needs the pseudo-header
+    const uint8_t *payload;
+} my_udp_view_t;
+
+my_udp_header_t parse_udp(const uint8_t *packet, uint32_t length, const uint8_t *src_add, const uint8_t *dst_add, uint8_t net_protocol, bool verbose);
+bool parse_udp_view(const uint8_t *packet, uint32_t length, my_udp_view_t *view);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <netinet/in.h>
+#include "ipv4_reassembly.h"
+
+/*
+Fragments per second through ipv4_reassembly_add, on synthetic traces of
+4000 byte datagrams cut in three fragments (1480 + 1480 + 1040):
+
+    in order     the fragments of 64 datagrams interleaved, in order
+    reversed     the same, the last fragment of each first
+    flood        first fragments never completed, random sources and ids,
+                 one datagram in 16 real, in order
+
+The flood must not grow the memory past the cap: the peak is printed with
+the real datagrams put back together.
+
+usage: bench_ipv4_reassembly [datagrams]
+*/
+
+#define SLOT_LENGTH (20 + 1480)
+#define DATAGRAM_LENGTH 4000
+#define MEMORY_CAP (1u << 20)
+
+double
+now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void
+build_fragment(uint8_t *packet, uint32_t source, uint16_t identification, uint32_t offset, uint32_t size, bool more_fragments)
+{
+    memset(packet, 0, 20);
+    packet[0] = 0x45;
+    uint16_t total_length = 20 + size;
+    packet[2] = total_length >> 8;
+    packet[3] = total_length & 0xff;
+    packet[4] = identification >> 8;
+    packet[5] = identification & 0xff;
+    uint16_t ip_off = (more_fragments ? 0x2000 : 0) | (offset / 8);
+    packet[6] = ip_off >> 8;
+    packet[7] = ip_off & 0xff;
+    packet[8] = 64;
+    packet[9] = IPPROTO_UDP;
+    uint32_t src = htonl(source);
+    uint32_t dst = htonl(0xc0a80001);
+    memcpy(packet + 12, &src, 4);
+    memcpy(packet + 16, &dst, 4);
+    for (uint32_t i = 0; i < size; i++){
+        packet[20 + i] = (uint8_t)(offset + i);
+    }
+}
+
+// the three fragments of a datagram, in order or the last one first
+uint32_t
+build_datagram(uint8_t *slots, uint32_t datagram, bool reversed)
+{
+    const uint32_t offsets[] = {0, 1480, 2960};
+    for (uint32_t i = 0; i < 3; i++){
+        uint32_t fragment = reversed ? 2 - i : i;
+        uint32_t size = fragment < 2 ? 1480 : DATAGRAM_LENGTH - 2960;
+        build_fragment(slots + (size_t)i * SLOT_LENGTH, 0x0a000000 | (datagram >> 16), datagram & 0xffff,
+            offsets[fragment], size, fragment < 2);
+    }
+    return 3;
+}
+
+int
+main(int argc, char **argv)
+{
+    uint32_t datagrams = (argc > 1) ? atol(argv[1]) : 100000;
+    const char *traces[] = {"in order", "reversed", "flood"};
+
+    printf("%-10s %10s %12s %12s %12s %12s %10s\n", "trace", "fragments", "Mfragments/s", "ns/fragment",
+        "reassembled", "evicted", "peak KB");
+    for (uint32_t trace = 0; trace < 3; trace++){
+        bool flood = trace == 2;
+        // a flood has 16 fake fragments for each real datagram
+        uint32_t fragments = flood ? datagrams * (3 + 16) : datagrams * 3;
+        uint8_t *slots = (uint8_t*)malloc((size_t)fragments * SLOT_LENGTH);
+        uint32_t count = 0;
+        uint64_t state = 88172645463325252ull;
+        // groups of 64 datagrams, their fragments interleaved
+        for (uint32_t group = 0; group < datagrams; group += 64){
+            uint32_t size = datagrams - group < 64 ? datagrams - group : 64;
+            uint8_t fragment[3 * SLOT_LENGTH];
+            for (uint32_t i = 0; i < 3; i++){
+                for (uint32_t datagram = group; datagram < group + size; datagram++){
+                    build_datagram(fragment, datagram, trace == 1);
+                    memcpy(slots + (size_t)count++ * SLOT_LENGTH, fragment + i * SLOT_LENGTH, SLOT_LENGTH);
+                    for (uint32_t fake = 0; flood && i == 0 && fake < 16; fake++){
+                        state ^= state << 13;
+                        state ^= state >> 7;
+                        state ^= state << 17;
+                        build_fragment(slots + (size_t)count++ * SLOT_LENGTH, 0xac100000 | (state >> 48),
+                            (uint16_t)state, 0, 1480, true);
+                    }
+                }
+            }
+        }
+
+        ipv4_reassembly_t *reassembly = ipv4_reassembly_create(0, MEMORY_CAP, 0, IPV4_OVERLAP_FIRST);
+        uint64_t peak = 0;
+        const uint8_t *payload;
+        uint32_t payload_length;
+        double start = now_seconds();
+        for (uint32_t i = 0; i < count; i++){
+            const uint8_t *packet = slots + (size_t)i * SLOT_LENGTH;
+            uint32_t length = packet[2] << 8 | packet[3];
+            ipv4_reassembly_add(reassembly, packet, length, i, &payload, &payload_length);
+            if (reassembly->memory > peak){
+                peak = reassembly->memory;
+            }
+        }
+        double elapsed = now_seconds() - start;
+
+        printf("%-10s %10u %12.2f %12.1f %12llu %12llu %10llu\n", traces[trace], count, count / elapsed / 1e6,
+            elapsed / count * 1e9, (unsigned long long)reassembly->reassembled,
+            (unsigned long long)reassembly->evicted, (unsigned long long)(peak >> 10));
+        if (peak > MEMORY_CAP){
+            fprintf(stderr, "memory past the cap: %llu bytes\n", (unsigned long long)peak);
+        }
+        ipv4_reassembly_destroy(reassembly);
+        free(slots);
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <netinet/tcp.h>
+#include "tcp_reassembly.h"
+
+/*
+Payload bytes per second through tcp_reassembly_segment, segments of 1460
+bytes from a growing number of connections interleaved:
+
+    in order      every segment in order, delivered from the packet
+    reordered     every other pair of segments swapped, one in two
+                  segments kept in the ring then delivered from it
+    retransmits   in order, one segment in 8 sent twice
+
+The parser consumes whole deliveries, its own cost isn't counted.
+
+usage: bench_tcp_reassembly [segments]
+*/
+
+#define SEGMENT_LENGTH 1460
+
+double
+now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct bench_segment {
+    uint32_t connection;
+    uint32_t number;        // in its connection
+} bench_segment_t;
+
+int
+main(int argc, char **argv)
+{
+    uint32_t segments = (argc > 1) ? atol(argv[1]) : 4000000;
+    const uint32_t connection_counts[] = {16, 1000, 50000};
+    const char *orders[] = {"in order", "reordered", "retransmits"};
+    static uint8_t payload[SEGMENT_LENGTH];
+    memset(payload, 'p', sizeof(payload));
+
+    bench_segment_t *trace = (bench_segment_t*)malloc((size_t)segments * 2 * sizeof(bench_segment_t));
+    printf("%-12s %-12s %10s %12s %12s %10s\n", "order", "connections", "Gbit/s", "ns/segment", "delivered MB", "memory KB");
+    for (uint32_t order = 0; order < 3; order++){
+        for (uint32_t connections : connection_counts){
+            // round robin over the connections, segment numbers in each
+            uint32_t count = 0;
+            for (uint32_t i = 0; i < segments; i++){
+                bench_segment_t segment = {i % connections, i / connections};
+                if (order == 1 && segment.number % 4 == 0){
+                    segment.number++;
+                } else if (order == 1 && segment.number % 4 == 1){
+                    segment.number--;
+                }
+                trace[count++] = segment;
+                if (order == 2 && segment.number % 8 == 7){
+                    trace[count++] = segment;
+                }
+            }
+
+            tcp_reassembly_t *reassembly = tcp_reassembly_create(connections * 2, 0, 0);
+            tcp_segment_t segment;
+            memset(&segment, 0, sizeof(segment));
+            uint8_t source[4] = {10, 0, 0, 0};
+            uint8_t destination[4] = {192, 168, 0, 1};
+            segment.version = 4;
+            segment.source_address = source;
+            segment.destination_address = destination;
+            segment.destination_port = 443;
+            segment.flags = TH_ACK;
+            segment.payload = payload;
+            segment.length = SEGMENT_LENGTH;
+            tcp_delivery_t delivery;
+
+            double start = now_seconds();
+            for (uint32_t i = 0; i < count; i++){
+                uint32_t connection = trace[i].connection;
+                memcpy(source + 1, &connection, 3);
+                segment.source_port = 1024 + connection % 60000;
+                segment.sequence_number = 1 + trace[i].number * SEGMENT_LENGTH;
+                segment.timestamp = i;
+                tcp_reassembly_segment(reassembly, &segment, &delivery);
+                tcp_reassembly_consume(reassembly, &delivery, delivery.length);
+            }
+            double elapsed = now_seconds() - start;
+
+            printf("%-12s %-12u %10.2f %12.1f %12.1f %10llu\n", orders[order], connections,
+                reassembly->bytes * 8 / elapsed / 1e9, elapsed / count * 1e9, reassembly->bytes / 1e6,
+                (unsigned long long)(reassembly->memory >> 10));
+            if (reassembly->gaps != 0 || reassembly->dropped != 0){
+                fprintf(stderr, "lost: %llu gaps, %llu segments dropped\n", (unsigned long long)reassembly->gaps,
+                    (unsigned long long)reassembly->dropped);
+            }
+            tcp_reassembly_destroy(reassembly);
+        }
+    }
+    free(trace);
+    return 0;
+}
@@ -0,0 +1,539 @@
+#include "ipv4_reassembly.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "packet_cursor.h"
+
+#define IPV4_HOLE_INFINITY UINT32_MAX
+#define IPV4_MORE_FRAGMENTS 0x2000
+#define IPV4_OFFSET_MASK 0x1fff
+
+/**
+ * @brief Allocate the pool and the index for capacity datagrams
+ *
+ * @param capacity IPV4_REASSEMBLY_CAPACITY if 0
+ * @param memory_cap bytes of payload buffers at most, IPV4_REASSEMBLY_MEMORY if 0
+ * @param timeout in microseconds from the first fragment, IPV4_REASSEMBLY_TIMEOUT if 0
+ * @param policy for the fragments overlapping bytes already received
+ * @return ipv4_reassembly_t*
+ */
+ipv4_reassembly_t*
+ipv4_reassembly_create(uint32_t capacity, uint64_t memory_cap, uint64_t timeout, ipv4_overlap_policy_t policy)
+{
+    ipv4_reassembly_t *reassembly = (ipv4_reassembly_t*)calloc(1, sizeof(ipv4_reassembly_t));
+    if (reassembly == NULL){
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    reassembly->capacity = capacity > 0 ? capacity : IPV4_REASSEMBLY_CAPACITY;
+    reassembly->memory_cap = memory_cap > 0 ? memory_cap : IPV4_REASSEMBLY_MEMORY;
+    reassembly->timeout = timeout > 0 ? timeout : IPV4_REASSEMBLY_TIMEOUT;
+    reassembly->policy = policy;
+    // a datagram waits less than a turn of the wheel
+    reassembly->tick = reassembly->timeout / (IPV4_REASSEMBLY_WHEEL_SLOTS - 2);
+    if (reassembly->tick == 0){
+        reassembly->tick = 1;
+    }
+
+    // as many chains as datagrams, they stay short
+    uint32_t index_size = 1;
+    while (index_size < reassembly->capacity){
+        index_size *= 2;
+    }
+    reassembly->index_mask = index_size - 1;
+    reassembly->index = (uint32_t*)malloc(index_size * sizeof(uint32_t));
+    reassembly->datagrams = (ipv4_datagram_t*)calloc(reassembly->capacity, sizeof(ipv4_datagram_t));
+    if (reassembly->index == NULL || reassembly->datagrams == NULL){
+        perror("alloc");
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t i = 0; i < index_size; i++){
+        reassembly->index[i] = IPV4_REASSEMBLY_NONE;
+    }
+    for (uint32_t i = 0; i < IPV4_REASSEMBLY_WHEEL_SLOTS; i++){
+        reassembly->wheel[i] = IPV4_REASSEMBLY_NONE;
+        reassembly->wheel_tail[i] = IPV4_REASSEMBLY_NONE;
+    }
+
+    // every datagram is free, chained through hash_next
+    for (uint32_t i = 0; i < reassembly->capacity; i++){
+        reassembly->datagrams[i].hash_next = (i + 1 < reassembly->capacity) ? i + 1 : IPV4_REASSEMBLY_NONE;
+    }
+    reassembly->free_head = 0;
+    return reassembly;
+}
+
+void
+ipv4_reassembly_destroy(ipv4_reassembly_t *reassembly)
+{
+    for (uint32_t i = 0; i < reassembly->capacity; i++){
+        free(reassembly->datagrams[i].data);
+    }
+    for (uint32_t i = 0; i < IPV4_REASSEMBLY_CLASSES; i++){
+        while (reassembly->spare[i] != NULL){
+            uint8_t *buffer = reassembly->spare[i];
+            memcpy(&reassembly->spare[i], buffer, sizeof(uint8_t*));
+            free(buffer);
+        }
+    }
+    free(reassembly->complete);
+    free(reassembly->index);
+    free(reassembly->datagrams);
+    free(reassembly);
+}
+
+// the 12 bytes of the key in two multiplies
+static uint32_t
+ipv4_reassembly_hash(const ipv4_reassembly_key_t *key)
+{
+    uint64_t low;
+    uint32_t high;
+    memcpy(&low, key, sizeof(low));
+    memcpy(&high, (const uint8_t*)key + sizeof(low), sizeof(high));
+    uint64_t hash = (low ^ 0x9e3779b97f4a7c15ull) * 0xbf58476d1ce4e5b9ull;
+    hash = (hash ^ (hash >> 31) ^ high) * 0x94d049bb133111ebull;
+    return (uint32_t)(hash >> 32);
+}
+
+static uint32_t
+ipv4_reassembly_find(const ipv4_reassembly_t *reassembly, const ipv4_reassembly_key_t *key, uint32_t hash)
+{
+    uint32_t index = reassembly->index[hash & reassembly->index_mask];
+    while (index != IPV4_REASSEMBLY_NONE
+        && memcmp(&reassembly->datagrams[index].key, key, sizeof(ipv4_reassembly_key_t)) != 0){
+        index = reassembly->datagrams[index].hash_next;
+    }
+    return index;
+}
+
+static uint32_t
+ipv4_reassembly_slot(const ipv4_reassembly_t *reassembly, uint64_t expiry)
+{
+    uint64_t tick = (expiry + reassembly->tick - 1) / reassembly->tick;
+    // a timestamp going back in time, the slot must still be ahead
+    if (tick <= reassembly->wheel_tick){
+        tick = reassembly->wheel_tick + 1;
+    }
+    return tick & (IPV4_REASSEMBLY_WHEEL_SLOTS - 1);
+}
+
+static void
+ipv4_timer_link(ipv4_reassembly_t *reassembly, uint32_t index)
+{
+    ipv4_datagram_t *datagram = &reassembly->datagrams[index];
+    uint32_t slot = ipv4_reassembly_slot(reassembly, datagram->expiry);
+    datagram->timer_slot = slot;
+    datagram->timer_prev = reassembly->wheel_tail[slot];
+    datagram->timer_next = IPV4_REASSEMBLY_NONE;
+    if (datagram->timer_prev != IPV4_REASSEMBLY_NONE){
+        reassembly->datagrams[datagram->timer_prev].timer_next = index;
+    } else {
+        reassembly->wheel[slot] = index;
+    }
+    reassembly->wheel_tail[slot] = index;
+}
+
+static void
+ipv4_timer_unlink(ipv4_reassembly_t *reassembly, uint32_t index)
+{
+    ipv4_datagram_t *datagram = &reassembly->datagrams[index];
+    if (datagram->timer_prev != IPV4_REASSEMBLY_NONE){
+        reassembly->datagrams[datagram->timer_prev].timer_next = datagram->timer_next;
+    } else {
+        reassembly->wheel[datagram->timer_slot] = datagram->timer_next;
+    }
+    if (datagram->timer_next != IPV4_REASSEMBLY_NONE){
+        reassembly->datagrams[datagram->timer_next].timer_prev = datagram->timer_prev;
+    } else {
+        reassembly->wheel_tail[datagram->timer_slot] = datagram->timer_prev;
+    }
+}
+
+static uint32_t
+ipv4_buffer_class(uint32_t capacity)
+{
+    uint32_t buffer_class = 0;
+    while ((IPV4_REASSEMBLY_BUFFER << buffer_class) < capacity){
+        buffer_class++;
+    }
+    return buffer_class;
+}
+
+// a buffer no longer used waits for the next one of its size
+static void
+ipv4_buffer_spare(ipv4_reassembly_t *reassembly, uint8_t *buffer, uint32_t capacity)
+{
+    if (buffer == NULL){
+        return;
+    }
+    uint32_t buffer_class = ipv4_buffer_class(capacity);
+    memcpy(buffer, &reassembly->spare[buffer_class], sizeof(uint8_t*));
+    reassembly->spare[buffer_class] = buffer;
+}
+
+static uint8_t*
+ipv4_buffer_take(ipv4_reassembly_t *reassembly, uint32_t buffer_class)
+{
+    uint8_t *buffer = reassembly->spare[buffer_class];
+    if (buffer != NULL){
+        memcpy(&reassembly->spare[buffer_class], buffer, sizeof(uint8_t*));
+    }
+    return buffer;
+}
+
+// give back a spare buffer to malloc, the largest first
+static bool
+ipv4_buffer_trim(ipv4_reassembly_t *reassembly)
+{
+    for (uint32_t i = IPV4_REASSEMBLY_CLASSES; i-- > 0;){
+        uint8_t *buffer = ipv4_buffer_take(reassembly, i);
+        if (buffer != NULL){
+            free(buffer);
+            reassembly->memory -= IPV4_REASSEMBLY_BUFFER << i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// forget a datagram, its buffer is spared and its slot in the pool reused
+static void
+ipv4_reassembly_release(ipv4_reassembly_t *reassembly, uint32_t index)
+{
+    ipv4_datagram_t *datagram = &reassembly->datagrams[index];
+    uint32_t *link = &reassembly->index[ipv4_reassembly_hash(&datagram->key) & reassembly->index_mask];
+    while (*link != index){
+        link = &reassembly->datagrams[*link].hash_next;
+    }
+    *link = datagram->hash_next;
+    ipv4_timer_unlink(reassembly, index);
+
+    ipv4_buffer_spare(reassembly, datagram->data, datagram->capacity);
+    datagram->data = NULL;
+    datagram->capacity = 0;
+    datagram->hash_next = reassembly->free_head;
+    reassembly->free_head = index;
+    reassembly->count--;
+}
+
+/**
+ * @brief Drop the datagrams whose time is up, visiting the slots of the
+ * wheel the time went past
+ *
+ * @param reassembly
+ * @param now
+ */
+void
+ipv4_reassembly_expire(ipv4_reassembly_t *reassembly, uint64_t now)
+{
+    uint64_t now_tick = now / reassembly->tick;
+    if (now_tick <= reassembly->wheel_tick){
+        return;
+    }
+    // past a whole turn, every slot once
+    uint64_t steps = now_tick - reassembly->wheel_tick;
+    if (steps > IPV4_REASSEMBLY_WHEEL_SLOTS){
+        steps = IPV4_REASSEMBLY_WHEEL_SLOTS;
+    }
+    for (uint64_t step = 1; step <= steps; step++){
+        uint32_t slot = (reassembly->wheel_tick + step) & (IPV4_REASSEMBLY_WHEEL_SLOTS - 1);
+        uint32_t index = reassembly->wheel[slot];
+        while (index != IPV4_REASSEMBLY_NONE){
+            uint32_t next = reassembly->datagrams[index].timer_next;
+            // a later turn's, put there by a timestamp going back
+            if (reassembly->datagrams[index].expiry <= now){
+                ipv4_reassembly_release(reassembly, index);
+                reassembly->expired++;
+            }
+            index = next;
+        }
+    }
+    reassembly->wheel_tick = now_tick;
+}
+
+/**
+ * @brief Evict the datagram expiring first, but keep
+ *
+ * @param reassembly
+ * @param keep the datagram being added to, IPV4_REASSEMBLY_NONE
+ * @return true if one was evicted
+ */
+static bool
+ipv4_reassembly_evict(ipv4_reassembly_t *reassembly, uint32_t keep)
+{
+    for (uint32_t step = 1; step <= IPV4_REASSEMBLY_WHEEL_SLOTS; step++){
+        uint32_t slot = (reassembly->wheel_tick + step) & (IPV4_REASSEMBLY_WHEEL_SLOTS - 1);
+        uint32_t index = reassembly->wheel[slot];
+        if (index == keep){
+            index = reassembly->datagrams[index].timer_next;
+        }
+        if (index != IPV4_REASSEMBLY_NONE){
+            ipv4_reassembly_release(reassembly, index);
+            reassembly->evicted++;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t
+ipv4_reassembly_insert(ipv4_reassembly_t *reassembly, const ipv4_reassembly_key_t *key, uint32_t hash, uint64_t timestamp)
+{
+    if (reassembly->free_head == IPV4_REASSEMBLY_NONE && !ipv4_reassembly_evict(reassembly, IPV4_REASSEMBLY_NONE)){
+        return IPV4_REASSEMBLY_NONE;
+    }
+    uint32_t index = reassembly->free_head;
+    ipv4_datagram_t *datagram = &reassembly->datagrams[index];
+    reassembly->free_head = datagram->hash_next;
+
+    memset(datagram, 0, sizeof(ipv4_datagram_t));
+    datagram->key = *key;
+    datagram->expiry = timestamp + reassembly->timeout;
+    datagram->holes[0].first = 0;
+    datagram->holes[0].last = IPV4_HOLE_INFINITY;
+    datagram->hole_count = 1;
+
+    uint32_t *head = &reassembly->index[hash & reassembly->index_mask];
+    datagram->hash_next = *head;
+    *head = index;
+    ipv4_timer_link(reassembly, index);
+    reassembly->count++;
+    return index;
+}
+
+// room for the payload up to end, in the budget of the whole reassembly
+static bool
+ipv4_reassembly_reserve(ipv4_reassembly_t *reassembly, uint32_t index, uint32_t end)
+{
+    ipv4_datagram_t *datagram = &reassembly->datagrams[index];
+    if (end <= datagram->capacity){
+        return true;
+    }
+    uint32_t buffer_class = ipv4_buffer_class(end);
+    uint32_t capacity = IPV4_REASSEMBLY_BUFFER << buffer_class;
+    uint8_t *data = ipv4_buffer_take(reassembly, buffer_class);
+    // spare buffers of other sizes go first, then the oldest datagrams
+    while (data == NULL && reassembly->memory + capacity > reassembly->memory_cap){
+        if (!ipv4_buffer_trim(reassembly) && !ipv4_reassembly_evict(reassembly, index)){
+            return false;
+        }
+        data = ipv4_buffer_take(reassembly, buffer_class);
+    }
+    if (data == NULL){
+        data = (uint8_t*)malloc(capacity);
+        if (data == NULL){
+            return false;
+        }
+        reassembly->memory += capacity;
+    }
+    if (datagram->data != NULL){
+        memcpy(data, datagram->data, datagram->received_end);
+        ipv4_buffer_spare(reassembly, datagram->data, datagram->capacity);
+    }
+    datagram->data = data;
+    datagram->capacity = capacity;
+    return true;
+}
+
+// bytes of [first, last] the holes of the datagram cover
+static uint32_t
+ipv4_holes_cover(const ipv4_datagram_t *datagram, uint32_t first, uint32_t last)
+{
+    uint32_t covered = 0;
+    for (uint8_t i = 0; i < datagram->hole_count; i++){
+        const ipv4_hole_t *hole = &datagram->holes[i];
+        uint32_t start = hole->first > first ? hole->first : first;
+        uint32_t end = hole->last < last ? hole->last : last;
+        if (start <= end){
+            covered += end - start + 1;
+        }
+    }
+    return covered;
+}
+
+// copy the bytes of the fragment that fall in holes, the others stay
+static void
+ipv4_holes_fill(ipv4_datagram_t *datagram, const uint8_t *fragment, uint32_t first, uint32_t last)
+{
+    for (uint8_t i = 0; i < datagram->hole_count; i++){
+        const ipv4_hole_t *hole = &datagram->holes[i];
+        uint32_t start = hole->first > first ? hole->first : first;
+        uint32_t end = hole->last < last ? hole->last : last;
+        if (start <= end){
+            memcpy(datagram->data + start, fragment + (start - first), end - start + 1);
+        }
+    }
+}
+
+/**
+ * @brief The holes left once [first, last] is received, RFC 815 steps 1 to 6.
+ * The holes past the end of the datagram go.
+ *
+ * @param datagram
+ * @param first
+ * @param last
+ * @param more_fragments
+ * @return false if that would be more than IPV4_REASSEMBLY_HOLES
+ */
+static bool
+ipv4_holes_update(ipv4_datagram_t *datagram, uint32_t first, uint32_t last, bool more_fragments)
+{
+    ipv4_hole_t holes[IPV4_REASSEMBLY_HOLES * 2];
+    uint32_t count = 0;
+    for (uint8_t i = 0; i < datagram->hole_count; i++){
+        ipv4_hole_t hole = datagram->holes[i];
+        if (first > hole.last || last < hole.first){
+            holes[count++] = hole;
+            continue;
+        }
+        if (first > hole.first){
+            holes[count++] = (ipv4_hole_t){hole.first, first - 1};
+        }
+        if (last < hole.last && more_fragments){
+            holes[count++] = (ipv4_hole_t){last + 1, hole.last};
+        }
+    }
+
+    uint8_t kept = 0;
+    for (uint32_t i = 0; i < count; i++){
+        if (datagram->length != 0){
+            if (holes[i].first >= datagram->length){
+                continue;
+            }
+            if (holes[i].last >= datagram->length){
+                holes[i].last = datagram->length - 1;
+            }
+        }
+        if (kept == IPV4_REASSEMBLY_HOLES){
+            return false;
+        }
+        datagram->holes[kept++] = holes[i];
+    }
+    datagram->hole_count = kept;
+    return true;
+}
+
+static ipv4_reassembly_result_t
+ipv4_reassembly_drop(ipv4_reassembly_t *reassembly, uint32_t index)
+{
+    if (index != IPV4_REASSEMBLY_NONE){
+        ipv4_reassembly_release(reassembly, index);
+    }
+    reassembly->dropped++;
+    return IPV4_REASSEMBLY_DROPPED;
+}
+
+/**
+ * @brief Add a fragment to its datagram. The packet is only read.
+ *
+ * @param reassembly
+ * @param packet the IPv4 header of the fragment
+ * @param length bytes captured from packet, past the total length they are ignored
+ * @param timestamp
+ * @param payload the whole payload when the datagram is complete, valid until the next call
+ * @param payload_length
+ * @return ipv4_reassembly_result_t
+ */
+ipv4_reassembly_result_t
+ipv4_reassembly_add(ipv4_reassembly_t *reassembly, const uint8_t *packet, uint32_t length, uint64_t timestamp,
+    const uint8_t **payload, uint32_t *payload_length)
+{
+    *payload = NULL;
+    *payload_length = 0;
+    ipv4_buffer_spare(reassembly, reassembly->complete, reassembly->complete_capacity);
+    reassembly->complete = NULL;
+    reassembly->fragments++;
+    ipv4_reassembly_expire(reassembly, timestamp);
+
+    if (length < 20){
+        return ipv4_reassembly_drop(reassembly, IPV4_REASSEMBLY_NONE);
+    }
+    uint32_t header_length = (packet[0] & 0x0f) * 4;
+    uint32_t total_length = packet_load_u16(packet + 2);
+    uint16_t ip_off = packet_load_u16(packet + 6);
+    if (header_length < 20 || header_length > total_length){
+        return ipv4_reassembly_drop(reassembly, IPV4_REASSEMBLY_NONE);
+    }
+
+    ipv4_reassembly_key_t key;
+    memcpy(key.source, packet + 12, 4);
+    memcpy(key.destination, packet + 16, 4);
+    key.identification = packet_load_u16(packet + 4);
+    key.protocol = packet[9];
+    key.padding = 0;
+    uint32_t hash = ipv4_reassembly_hash(&key);
+    uint32_t index = ipv4_reassembly_find(reassembly, &key, hash);
+
+    const uint8_t *fragment = packet + header_length;
+    uint32_t size = total_length - header_length;
+    uint32_t first = (ip_off & IPV4_OFFSET_MASK) * 8;
+    bool more_fragments = (ip_off & IPV4_MORE_FRAGMENTS) != 0;
+    // cut by the capture the datagram can't be whole, a fragment but the
+    // last one is a multiple of 8 bytes, nothing goes past 65535
+    if (length < total_length || size == 0 || (more_fragments && size % 8 != 0)
+        || first + size > IPV4_MAX_PAYLOAD){
+        return ipv4_reassembly_drop(reassembly, index);
+    }
+    uint32_t last = first + size - 1;
+
+    if (index == IPV4_REASSEMBLY_NONE){
+        index = ipv4_reassembly_insert(reassembly, &key, hash, timestamp);
+        if (index == IPV4_REASSEMBLY_NONE){
+            return ipv4_reassembly_drop(reassembly, IPV4_REASSEMBLY_NONE);
+        }
+    }
+    ipv4_datagram_t *datagram = &reassembly->datagrams[index];
+
+    // the fragments must agree on where the datagram ends
+    if (more_fragments ? (datagram->length != 0 && last >= datagram->length)
+        : ((datagram->length != 0 && datagram->length != last + 1) || datagram->received_end > last + 1)){
+        return ipv4_reassembly_drop(reassembly, index);
+    }
+
+    uint32_t covered = ipv4_holes_cover(datagram, first, last);
+    if (covered < size){
+        // received already, the same again
+        if (covered == 0 && memcmp(datagram->data + first, fragment, size) == 0){
+            return IPV4_REASSEMBLY_HELD;
+        }
+        if (reassembly->policy == IPV4_OVERLAP_DROP){
+            return ipv4_reassembly_drop(reassembly, index);
+        }
+    }
+
+    if (!ipv4_reassembly_reserve(reassembly, index, last + 1)){
+        return ipv4_reassembly_drop(reassembly, index);
+    }
+    if (reassembly->policy == IPV4_OVERLAP_LAST || covered == size){
+        memcpy(datagram->data + first, fragment, size);
+    } else {
+        ipv4_holes_fill(datagram, fragment, first, last);
+    }
+
+    if (!more_fragments){
+        datagram->length = last + 1;
+    }
+    if (!ipv4_holes_update(datagram, first, last, more_fragments)){
+        return ipv4_reassembly_drop(reassembly, index);
+    }
+    if (datagram->received_end < last + 1){
+        datagram->received_end = last + 1;
+    }
+    datagram->fragments++;
+    if (datagram->hole_count > 0){
+        return IPV4_REASSEMBLY_HELD;
+    }
+
+    // whole: the buffer is handed out, spared on the next call
+    reassembly->complete = datagram->data;
+    reassembly->complete_capacity = datagram->capacity;
+    *payload = datagram->data;
+    *payload_length = datagram->length;
+    datagram->data = NULL;
+    datagram->capacity = 0;
+    ipv4_reassembly_release(reassembly, index);
+    reassembly->reassembled++;
+    return IPV4_REASSEMBLY_COMPLETE;
+}
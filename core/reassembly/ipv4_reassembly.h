@@ -0,0 +1,160 @@
+#ifndef IPV4_REASSEMBLY_H
+#define IPV4_REASSEMBLY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+IPv4 datagrams put back together from their fragments (RFC 791), the
+missing parts tracked as a list of holes (RFC 815).
+
+A datagram is keyed on (source, destination, identification, protocol).
+Its payload goes to a buffer as large as the furthest byte received, the
+holes say what is still missing:
+
+    0              1480             2960        4000
+    | received     | hole           | received  | hole ... infinity
+                                                  (no last fragment yet)
+
+A fragment fills the holes it covers, the datagram is whole when no hole
+is left: its payload then goes up to the transport layer, as if it had
+come in one packet. Fragments covering bytes already received follow the
+overlap policy: the first copy is kept, the last one overwrites, or the
+whole datagram is dropped (what RFC 5722 asks for IPv6). An exact
+duplicate is ignored under every policy.
+
+The memory is bounded whatever arrives:
+
+    datagrams     a pool of capacity, allocated once
+    payloads      memory_cap bytes of buffers in all, the oldest datagrams
+                  are evicted to make room
+    holes         IPV4_REASSEMBLY_HOLES per datagram, a datagram cut in
+                  more pieces is dropped
+
+A datagram expires timeout after its first fragment. The datagrams wait in
+a timer wheel of IPV4_REASSEMBLY_WHEEL_SLOTS slots, each a tick long: the
+time moving on only visits the slots it goes past, expiring is O(1) per
+datagram whatever the number waiting, and the first datagram of the next
+slot is the oldest one, the one evicted.
+
+The buffers come in IPV4_REASSEMBLY_CLASSES sizes, from 2 KB to 64 KB: a
+datagram growing moves to the next size, and a buffer no longer used waits
+for the next datagram of its size instead of going back to malloc. Once
+the traffic is steady nothing is allocated, the spare buffers count in
+memory_cap and go first when room is needed.
+
+Timestamps are in microseconds of capture time.
+*/
+
+#define IPV4_REASSEMBLY_CAPACITY 4096
+#define IPV4_REASSEMBLY_MEMORY (8u << 20)              // 8 MB of payloads
+#define IPV4_REASSEMBLY_TIMEOUT (30ull * 1000000)      // 30 seconds, as Linux
+#define IPV4_REASSEMBLY_HOLES 16
+#define IPV4_REASSEMBLY_WHEEL_SLOTS 64                 // power of two
+#define IPV4_REASSEMBLY_BUFFER 2048u                   // the smallest buffer
+#define IPV4_REASSEMBLY_CLASSES 6                      // 2 KB to 64 KB
+#define IPV4_REASSEMBLY_NONE UINT32_MAX
+#define IPV4_MAX_PAYLOAD (65535 - 20)                  // total length, minus the smallest header
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum ipv4_overlap_policy {
+    IPV4_OVERLAP_FIRST,     // the bytes received first stay (BSD, Windows)
+    IPV4_OVERLAP_LAST,      // a later fragment overwrites them
+    IPV4_OVERLAP_DROP,      // the datagram is dropped
+} ipv4_overlap_policy_t;
+
+typedef enum ipv4_reassembly_result {
+    IPV4_REASSEMBLY_HELD,       // kept until the datagram is whole
+    IPV4_REASSEMBLY_COMPLETE,   // the datagram is whole
+    IPV4_REASSEMBLY_DROPPED,    // malformed, cut by the capture, overlapping or no room: the datagram is gone
+} ipv4_reassembly_result_t;
+
+typedef struct ipv4_reassembly_key {
+    uint8_t source[4];
+    uint8_t destination[4];
+    uint16_t identification;
+    uint8_t protocol;
+    uint8_t padding;        // zero, keys are compared with memcmp
+} ipv4_reassembly_key_t;
+
+typedef struct ipv4_hole {
+    uint32_t first;         // offsets of the first and last missing bytes
+    uint32_t last;          // UINT32_MAX until the last fragment is in
+} ipv4_hole_t;
+
+typedef struct ipv4_datagram {
+    ipv4_reassembly_key_t key;
+    uint32_t hash_next;     // in the index chain, next free when unused
+    uint32_t timer_prev;    // in the wheel slot
+    uint32_t timer_next;
+    uint32_t timer_slot;
+    uint64_t expiry;
+
+    uint8_t *data;          // the payload received so far
+    uint32_t capacity;      // size of data, 0 or a buffer size
+    uint32_t length;        // of the payload, 0 until the last fragment is in
+    uint32_t received_end;  // past the furthest byte received
+    uint16_t fragments;
+    uint8_t hole_count;
+    ipv4_hole_t holes[IPV4_REASSEMBLY_HOLES];
+} ipv4_datagram_t;
+
+typedef struct ipv4_reassembly {
+    uint32_t *index;        // chain heads, by hash
+    uint32_t index_mask;
+
+    ipv4_datagram_t *datagrams; // the pool
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t free_head;
+
+    uint32_t wheel[IPV4_REASSEMBLY_WHEEL_SLOTS];        // first datagram of each slot
+    uint32_t wheel_tail[IPV4_REASSEMBLY_WHEEL_SLOTS];   // and the last one, the datagrams go in order
+    uint64_t tick;          // microseconds per slot
+    uint64_t wheel_tick;    // the last tick visited
+
+    uint64_t memory;        // size of the buffers allocated, spare ones included
+    uint64_t memory_cap;
+    uint8_t *spare[IPV4_REASSEMBLY_CLASSES];    // buffers waiting to be reused, chained through their first bytes
+    uint64_t timeout;
+    ipv4_overlap_policy_t policy;
+
+    uint8_t *complete;      // the last whole payload, until the next fragment
+    uint32_t complete_capacity;
+
+    uint64_t fragments;
+    uint64_t reassembled;
+    uint64_t expired;
+    uint64_t evicted;       // to make room for another one
+    uint64_t dropped;
+} ipv4_reassembly_t;
+
+ipv4_reassembly_t* ipv4_reassembly_create(uint32_t capacity, uint64_t memory_cap, uint64_t timeout, ipv4_overlap_policy_t policy);
+void ipv4_reassembly_destroy(ipv4_reassembly_t *reassembly);
+
+ipv4_reassembly_result_t ipv4_reassembly_add(ipv4_reassembly_t *reassembly, const uint8_t *packet, uint32_t length, uint64_t timestamp,
+    const uint8_t **payload, uint32_t *payload_length);
+void ipv4_reassembly_expire(ipv4_reassembly_t *reassembly, uint64_t now);
+
+/**
+ * @brief Whether an IPv4 header belongs to a fragment: more fragments
+ * follow or it isn't the first one
+ *
+ * @param ip_off flags and fragment offset, in host order
+ * @return true
+ */
+static inline bool
+ipv4_is_fragment(uint16_t ip_off)
+{
+    return (ip_off & 0x3fff) != 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,466 @@
+#include "tcp_reassembly.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+// a - b, sequence numbers wrap around
+static inline int32_t
+seq_diff(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b);
+}
+
+static uint32_t
+tcp_ring_class(uint32_t size)
+{
+    uint32_t ring_class = 0;
+    while ((TCP_RING_SIZE << ring_class) < size){
+        ring_class++;
+    }
+    return ring_class;
+}
+
+static void
+tcp_ring_spare(tcp_reassembly_t *reassembly, tcp_stream_t *stream)
+{
+    if (stream->ring == NULL){
+        return;
+    }
+    uint8_t **spare = &reassembly->spare[tcp_ring_class(stream->ring_size)];
+    memcpy(stream->ring, spare, sizeof(uint8_t*));
+    *spare = stream->ring;
+    stream->ring = NULL;
+    stream->ring_size = 0;
+}
+
+static uint8_t*
+tcp_ring_take(tcp_reassembly_t *reassembly, uint32_t ring_class)
+{
+    uint8_t *ring = reassembly->spare[ring_class];
+    if (ring != NULL){
+        memcpy(&reassembly->spare[ring_class], ring, sizeof(uint8_t*));
+    }
+    return ring;
+}
+
+// give back a spare ring to malloc, the largest first
+static bool
+tcp_ring_trim(tcp_reassembly_t *reassembly)
+{
+    for (uint32_t i = TCP_RING_CLASSES; i-- > 0;){
+        uint8_t *ring = tcp_ring_take(reassembly, i);
+        if (ring != NULL){
+            free(ring);
+            reassembly->memory -= (uint64_t)TCP_RING_SIZE << i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// length bytes at seq, in a ring of size bytes
+static void
+tcp_ring_write(uint8_t *ring, uint32_t size, uint32_t seq, const uint8_t *data, uint32_t length)
+{
+    uint32_t position = seq & (size - 1);
+    uint32_t first = size - position;
+    if (first > length){
+        first = length;
+    }
+    memcpy(ring + position, data, first);
+    memcpy(ring, data + first, length - first);
+}
+
+/**
+ * @brief Room in the stream's ring from read_seq up to end, a larger ring
+ * if needed: a spare one or a new one within the memory cap
+ *
+ * @param reassembly
+ * @param stream
+ * @param end no further than the window from read_seq
+ * @return false if there is no room
+ */
+static bool
+tcp_ring_reserve(tcp_reassembly_t *reassembly, tcp_stream_t *stream, uint32_t end)
+{
+    uint32_t need = end - stream->read_seq;
+    if (stream->ring != NULL && need <= stream->ring_size){
+        return true;
+    }
+    uint32_t ring_class = tcp_ring_class(need);
+    uint32_t size = TCP_RING_SIZE << ring_class;
+    uint8_t *ring = tcp_ring_take(reassembly, ring_class);
+    // the spare rings of other sizes go first
+    while (ring == NULL && reassembly->memory + size > reassembly->memory_cap){
+        if (!tcp_ring_trim(reassembly)){
+            return false;
+        }
+    }
+    if (ring == NULL){
+        ring = (uint8_t*)malloc(size);
+        if (ring == NULL){
+            return false;
+        }
+        reassembly->memory += size;
+    }
+    if (stream->ring != NULL){
+        // the bytes kept at the same sequence numbers in the larger ring
+        uint32_t position = stream->read_seq & (stream->ring_size - 1);
+        uint32_t first = stream->ring_size - position;
+        tcp_ring_write(ring, size, stream->read_seq, stream->ring + position, first);
+        tcp_ring_write(ring, size, stream->read_seq + first, stream->ring, position);
+        tcp_ring_spare(reassembly, stream);
+    }
+    stream->ring = ring;
+    stream->ring_size = size;
+    return true;
+}
+
+static void
+tcp_stream_reset(tcp_reassembly_t *reassembly, tcp_stream_t *stream)
+{
+    tcp_ring_spare(reassembly, stream);
+    memset(stream, 0, sizeof(tcp_stream_t));
+}
+
+// give up what is kept and the hole before it, the stream goes on from seq
+static void
+tcp_stream_skip(tcp_reassembly_t *reassembly, tcp_stream_t *stream, uint32_t seq)
+{
+    tcp_ring_spare(reassembly, stream);
+    stream->range_count = 0;
+    stream->read_seq = seq;
+    stream->next_seq = seq;
+    stream->gap = true;
+    reassembly->gaps++;
+}
+
+// the flow leaves the table, its streams go with it
+static void
+tcp_reassembly_flow_removed(void *context, flow_table_t *table, flow_t *flow)
+{
+    tcp_reassembly_t *reassembly = (tcp_reassembly_t*)context;
+    uint32_t index = flow - table->flows;
+    tcp_stream_reset(reassembly, &reassembly->streams[index * 2]);
+    tcp_stream_reset(reassembly, &reassembly->streams[index * 2 + 1]);
+}
+
+/**
+ * @brief Allocate the flow table and the streams of its flows
+ *
+ * @param flows TCP_REASSEMBLY_FLOWS if 0
+ * @param window bytes kept per stream, rounded up to a power of two, TCP_STREAM_WINDOW if 0
+ * @param memory_cap bytes of rings at most, TCP_REASSEMBLY_MEMORY if 0
+ * @return tcp_reassembly_t*
+ */
+tcp_reassembly_t*
+tcp_reassembly_create(uint32_t flows, uint32_t window, uint64_t memory_cap)
+{
+    tcp_reassembly_t *reassembly = (tcp_reassembly_t*)calloc(1, sizeof(tcp_reassembly_t));
+    if (reassembly == NULL){
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    reassembly->flows = flow_table_create(flows > 0 ? flows : TCP_REASSEMBLY_FLOWS, TCP_REASSEMBLY_IDLE_TIMEOUT);
+    reassembly->flows->on_remove = tcp_reassembly_flow_removed;
+    reassembly->flows->on_remove_context = reassembly;
+    reassembly->streams = (tcp_stream_t*)calloc((size_t)reassembly->flows->capacity * 2, sizeof(tcp_stream_t));
+    if (reassembly->streams == NULL){
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    reassembly->window = TCP_RING_SIZE;
+    while (reassembly->window < (window > 0 ? window : TCP_STREAM_WINDOW)){
+        reassembly->window *= 2;
+    }
+    reassembly->memory_cap = memory_cap > 0 ? memory_cap : TCP_REASSEMBLY_MEMORY;
+    return reassembly;
+}
+
+void
+tcp_reassembly_destroy(tcp_reassembly_t *reassembly)
+{
+    for (uint32_t i = 0; i < reassembly->flows->capacity * 2; i++){
+        free(reassembly->streams[i].ring);
+    }
+    while (tcp_ring_trim(reassembly)){
+    }
+    flow_table_destroy(reassembly->flows);
+    free(reassembly->streams);
+    free(reassembly);
+}
+
+static void
+tcp_delivery_span(tcp_delivery_t *delivery, const uint8_t *data, uint32_t length)
+{
+    if (length == 0){
+        return;
+    }
+    delivery->spans[delivery->span_count].data = data;
+    delivery->spans[delivery->span_count].length = length;
+    delivery->span_count++;
+    delivery->length += length;
+}
+
+// the ring's bytes from first to end, two spans if they wrap around
+static void
+tcp_delivery_ring(tcp_delivery_t *delivery, const tcp_stream_t *stream, uint32_t first, uint32_t end)
+{
+    uint32_t length = end - first;
+    uint32_t position = first & (stream->ring_size - 1);
+    uint32_t part = stream->ring_size - position;
+    if (part > length){
+        part = length;
+    }
+    tcp_delivery_span(delivery, stream->ring + position, part);
+    tcp_delivery_span(delivery, stream->ring, length - part);
+}
+
+/**
+ * @brief Keep an out of order segment, [seq, seq + length) joins the ranges
+ *
+ * @return false if there is no room for it
+ */
+static bool
+tcp_stream_keep(tcp_reassembly_t *reassembly, tcp_stream_t *stream, uint32_t seq, const uint8_t *payload, uint32_t length)
+{
+    tcp_range_t ranges[TCP_STREAM_RANGES + 1];
+    uint32_t count = 0;
+    tcp_range_t added = {seq, seq + length};
+    bool placed = false;
+    for (uint8_t i = 0; i < stream->range_count; i++){
+        tcp_range_t range = stream->ranges[i];
+        if (seq_diff(range.end, added.first) < 0){
+            ranges[count++] = range;
+        } else if (seq_diff(added.end, range.first) < 0){
+            if (!placed){
+                ranges[count++] = added;
+                placed = true;
+            }
+            ranges[count++] = range;
+        } else {
+            // overlapping or touching: one range
+            if (seq_diff(range.first, added.first) < 0){
+                added.first = range.first;
+            }
+            if (seq_diff(range.end, added.end) > 0){
+                added.end = range.end;
+            }
+        }
+        if (count > TCP_STREAM_RANGES){
+            return false;
+        }
+    }
+    if (!placed){
+        ranges[count++] = added;
+    }
+    if (count > TCP_STREAM_RANGES || !tcp_ring_reserve(reassembly, stream, ranges[count - 1].end)){
+        return false;
+    }
+    tcp_ring_write(stream->ring, stream->ring_size, seq, payload, length);
+    memcpy(stream->ranges, ranges, count * sizeof(tcp_range_t));
+    stream->range_count = count;
+    return true;
+}
+
+/**
+ * @brief Follow a segment in its stream, and deliver the bytes it makes
+ * contiguous. The segment is only read.
+ *
+ * @param reassembly
+ * @param segment
+ * @param delivery the unread bytes of the stream, none if the segment brings
+ * nothing in order; tcp_reassembly_consume() says what was read of them
+ * before the next segment
+ */
+void
+tcp_reassembly_segment(tcp_reassembly_t *reassembly, const tcp_segment_t *segment, tcp_delivery_t *delivery)
+{
+    memset(delivery, 0, sizeof(tcp_delivery_t));
+    reassembly->segments++;
+
+    flow_key_t key;
+    bool from_a = flow_key_from_endpoints(&key, segment->version, IPPROTO_TCP, segment->source_address,
+        segment->destination_address, segment->source_port, segment->destination_port);
+    flow_t *flow = flow_table_update_key(reassembly->flows, &key, from_a, segment->flags, segment->length, segment->timestamp);
+    uint32_t index = flow - reassembly->flows->flows;
+    delivery->flow = flow;
+    delivery->direction = flow_direction(flow, from_a);
+    tcp_stream_t *stream = &reassembly->streams[index * 2 + delivery->direction];
+    delivery->stream = stream;
+
+    if (segment->flags & TH_RST){
+        tcp_stream_reset(reassembly, stream);
+        return;
+    }
+    uint32_t seq = segment->sequence_number;
+    const uint8_t *payload = segment->payload;
+    uint32_t length = segment->length;
+    // the SYN takes a sequence number, the data comes after it
+    if (segment->flags & TH_SYN){
+        seq++;
+        if (!stream->synchronized){
+            stream->read_seq = stream->next_seq = seq;
+            stream->synchronized = true;
+        }
+    }
+    if (length == 0){
+        return;
+    }
+    if (!stream->synchronized){
+        // the capture started in the middle of the stream
+        stream->read_seq = stream->next_seq = seq;
+        stream->synchronized = true;
+    }
+
+    // delivered already, a retransmission
+    if (seq_diff(seq, stream->next_seq) < 0){
+        uint32_t old = stream->next_seq - seq;
+        if (old >= length){
+            reassembly->retransmitted += length;
+            return;
+        }
+        reassembly->retransmitted += old;
+        payload += old;
+        length -= old;
+        seq = stream->next_seq;
+    }
+
+    if (seq != stream->next_seq){
+        // past the window the hole won't be filled, the stream skips to the segment
+        if ((uint64_t)(seq - stream->read_seq) + length > reassembly->window){
+            tcp_stream_skip(reassembly, stream, seq);
+        } else {
+            if (tcp_stream_keep(reassembly, stream, seq, payload, length)){
+                reassembly->out_of_order++;
+            } else {
+                reassembly->dropped++;
+            }
+            return;
+        }
+    }
+
+    // in order: what was left unread, the segment, what it makes contiguous
+    uint32_t next_seq = stream->next_seq;
+    if (stream->read_seq != next_seq){
+        tcp_delivery_ring(delivery, stream, stream->read_seq, next_seq);
+    }
+    tcp_delivery_span(delivery, payload, length);
+    delivery->packet = payload;
+    delivery->packet_seq = seq;
+    delivery->packet_length = length;
+    next_seq += length;
+    while (stream->range_count > 0 && seq_diff(stream->ranges[0].first, next_seq) <= 0){
+        if (seq_diff(stream->ranges[0].end, next_seq) > 0){
+            tcp_delivery_ring(delivery, stream, next_seq, stream->ranges[0].end);
+            next_seq = stream->ranges[0].end;
+        }
+        stream->range_count--;
+        memmove(stream->ranges, stream->ranges + 1, stream->range_count * sizeof(tcp_range_t));
+    }
+    reassembly->bytes += next_seq - stream->next_seq;
+    stream->delivered += next_seq - stream->next_seq;
+    stream->next_seq = next_seq;
+    delivery->gap = stream->gap;
+    stream->gap = false;
+}
+
+/**
+ * @brief Say how much of a delivery was read, the rest is kept for the next
+ * one. To call before the next segment, the packet may be gone then.
+ *
+ * @param reassembly
+ * @param delivery
+ * @param length bytes read from the start of the spans
+ */
+void
+tcp_reassembly_consume(tcp_reassembly_t *reassembly, tcp_delivery_t *delivery, uint32_t length)
+{
+    tcp_stream_t *stream = delivery->stream;
+    if (stream == NULL || delivery->span_count == 0){
+        return;
+    }
+    if (length > delivery->length){
+        length = delivery->length;
+    }
+    stream->read_seq += length;
+    if (stream->read_seq == stream->next_seq){
+        if (stream->range_count == 0){
+            tcp_ring_spare(reassembly, stream);
+        }
+        return;
+    }
+
+    // what is left of the packet goes to the ring
+    uint32_t packet_end = delivery->packet_seq + delivery->packet_length;
+    if (delivery->packet != NULL && seq_diff(packet_end, stream->read_seq) > 0){
+        uint32_t first = seq_diff(stream->read_seq, delivery->packet_seq) > 0 ? stream->read_seq : delivery->packet_seq;
+        uint32_t end = stream->range_count > 0 ? stream->ranges[stream->range_count - 1].end : stream->next_seq;
+        if (end - stream->read_seq > reassembly->window || !tcp_ring_reserve(reassembly, stream, end)){
+            // no room, the unread bytes are lost
+            stream->read_seq = stream->next_seq;
+            stream->gap = true;
+            reassembly->gaps++;
+            if (stream->range_count == 0){
+                tcp_ring_spare(reassembly, stream);
+            }
+            return;
+        }
+        tcp_ring_write(stream->ring, stream->ring_size, first, delivery->packet + (first - delivery->packet_seq), packet_end - first);
+    }
+}
+
+/**
+ * @brief Copy bytes of a delivery, across its spans
+ *
+ * @param delivery
+ * @param offset from the start of the spans
+ * @param length
+ * @param destination
+ * @return uint32_t bytes copied, less than length past the end
+ */
+uint32_t
+tcp_delivery_copy(const tcp_delivery_t *delivery, uint32_t offset, uint32_t length, uint8_t *destination)
+{
+    uint32_t copied = 0;
+    for (uint8_t i = 0; i < delivery->span_count && copied < length; i++){
+        const tcp_span_t *span = &delivery->spans[i];
+        if (offset >= span->length){
+            offset -= span->length;
+            continue;
+        }
+        uint32_t part = span->length - offset;
+        if (part > length - copied){
+            part = length - copied;
+        }
+        memcpy(destination + copied, span->data + offset, part);
+        copied += part;
+        offset = 0;
+    }
+    return copied;
+}
+
+/**
+ * @brief The bytes from offset in place, when they are all in one span:
+ * they last until the consume of the delivery
+ *
+ * @param delivery
+ * @param offset
+ * @param length
+ * @return const uint8_t* NULL if they are in several spans or not delivered
+ */
+const uint8_t*
+tcp_delivery_bytes(const tcp_delivery_t *delivery, uint32_t offset, uint32_t length)
+{
+    for (uint8_t i = 0; i < delivery->span_count; i++){
+        const tcp_span_t *span = &delivery->spans[i];
+        if (offset < span->length){
+            return (length <= span->length - offset) ? span->data + offset : NULL;
+        }
+        offset -= span->length;
+    }
+    return NULL;
+}
@@ -0,0 +1,142 @@
+#ifndef TCP_REASSEMBLY_H
+#define TCP_REASSEMBLY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flow_table.h"
+
+/*
+The byte streams of TCP connections put back in order, for the parsers of
+the application layer.
+
+The connections are the flows of a flow table, each one has two streams,
+one per direction, kept in an array next to the pool: a flow's streams
+are at its index. A stream follows the sequence numbers from the SYN, or
+from its first segment when the capture starts in the middle:
+
+                read_seq          next_seq
+    ... consumed |     unread      | hole | out of order |  ...
+                 |<----------------- window ------------------->|
+
+A segment in order is delivered straight from the packet, no copy: the
+bytes unread since the last delivery come first, then the segment, then
+the out of order bytes it makes contiguous, TCP_REASSEMBLY_SPANS spans at
+most, in stream order. The parser consumes what it can (whole messages),
+what it leaves is kept for the next delivery: only then is it copied, to
+the stream's ring buffer.
+
+Bytes delivered already (retransmissions) are trimmed from the segments.
+Out of order bytes go to the ring, at their sequence number modulo the
+window; a retransmission overlapping them overwrites them. The memory is
+bounded:
+
+    per stream    window bytes buffered, a segment past the window gives
+                  up the hole: the stream skips to it and the delivery
+                  says there is a gap
+    out of order  TCP_STREAM_RANGES ranges per stream, a segment making
+                  more is dropped
+    in all        the rings take memory_cap bytes at most, a stream finding
+                  none drops its out of order segments
+
+A ring is only taken while a stream has bytes to keep, the smallest size
+that holds them, from TCP_RING_SIZE up to the window: a stream holding one
+segment out of order takes 4 KB, not the whole window. A ring no longer
+used goes to the spare list of its size for the next stream. A flow
+leaving the flow table (evicted, expired) resets its streams.
+*/
+
+#define TCP_REASSEMBLY_FLOWS (1 << 16)
+#define TCP_STREAM_WINDOW (1u << 17)                    // 128 KB per stream, power of two
+#define TCP_REASSEMBLY_MEMORY (64u << 20)               // 64 MB of rings
+#define TCP_REASSEMBLY_IDLE_TIMEOUT (300ull * 1000000)  // 5 minutes, as the flows
+#define TCP_STREAM_RANGES 8
+#define TCP_RING_SIZE 4096u                             // the smallest ring
+#define TCP_RING_CLASSES 16                             // 4 KB to 128 MB
+#define TCP_REASSEMBLY_SPANS 5                          // the ring's bytes wrap around, twice
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct tcp_range {
+    uint32_t first;         // sequence numbers, end excluded
+    uint32_t end;
+} tcp_range_t;
+
+typedef struct tcp_stream {
+    uint32_t read_seq;      // the first byte not consumed
+    uint32_t next_seq;      // the first byte missing
+    bool synchronized;      // the sequence numbers are known
+    bool gap;               // bytes were lost since the last delivery
+    uint8_t range_count;
+    tcp_range_t ranges[TCP_STREAM_RANGES];  // past next_seq, sorted, in the ring
+    uint8_t *ring;          // NULL while nothing is kept
+    uint32_t ring_size;     // power of two, the bytes at their sequence number modulo it
+    uint64_t delivered;     // bytes
+} tcp_stream_t;
+
+typedef struct tcp_segment {
+    uint8_t version;                    // 4 or 6
+    const uint8_t *source_address;      // 4 or 16 bytes
+    const uint8_t *destination_address;
+    uint16_t source_port;
+    uint16_t destination_port;
+    uint32_t sequence_number;
+    uint8_t flags;                      // TH_SYN, TH_RST...
+    const uint8_t *payload;
+    uint32_t length;                    // of the payload
+    uint64_t timestamp;                 // microseconds
+} tcp_segment_t;
+
+typedef struct tcp_span {
+    const uint8_t *data;
+    uint32_t length;
+} tcp_span_t;
+
+typedef struct tcp_delivery {
+    flow_t *flow;
+    tcp_stream_t *stream;
+    uint8_t direction;      // 0 from the initiator, 1 from the responder
+
+    tcp_span_t spans[TCP_REASSEMBLY_SPANS]; // the unread bytes, in order
+    uint8_t span_count;
+    uint32_t length;        // of all the spans
+    bool gap;               // bytes are missing before the first span
+
+    // the span that is the packet's payload, copied if it isn't consumed
+    const uint8_t *packet;
+    uint32_t packet_seq;
+    uint32_t packet_length;
+} tcp_delivery_t;
+
+typedef struct tcp_reassembly {
+    flow_table_t *flows;
+    tcp_stream_t *streams;  // [index * 2 + direction], index of the flow in the pool
+    uint32_t window;        // power of two, TCP_RING_SIZE at least
+    uint8_t *spare[TCP_RING_CLASSES];   // rings no stream uses, by size, chained through their first bytes
+    uint64_t memory;        // of the rings allocated, spare ones included
+    uint64_t memory_cap;
+
+    uint64_t segments;
+    uint64_t bytes;         // delivered
+    uint64_t retransmitted; // bytes trimmed, delivered already
+    uint64_t out_of_order;  // segments kept for later
+    uint64_t gaps;          // holes given up
+    uint64_t dropped;       // segments with no room to be kept
+} tcp_reassembly_t;
+
+tcp_reassembly_t* tcp_reassembly_create(uint32_t flows, uint32_t window, uint64_t memory_cap);
+void tcp_reassembly_destroy(tcp_reassembly_t *reassembly);
+
+void tcp_reassembly_segment(tcp_reassembly_t *reassembly, const tcp_segment_t *segment, tcp_delivery_t *delivery);
+void tcp_reassembly_consume(tcp_reassembly_t *reassembly, tcp_delivery_t *delivery, uint32_t length);
+uint32_t tcp_delivery_copy(const tcp_delivery_t *delivery, uint32_t offset, uint32_t length, uint8_t *destination);
+const uint8_t* tcp_delivery_bytes(const tcp_delivery_t *delivery, uint32_t offset, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,227 @@
+#include "ipv4_reassembly.h"
+#include <cassert>
+#include <cstring>
+#include <netinet/in.h>
+
+#define SECOND 1000000ull
+
+// an ipv4 header, 10.0.0.1 > 10.0.0.2, and size bytes of payload from offset on
+uint32_t
+build_fragment(uint8_t *packet, uint16_t identification, uint32_t offset, bool more_fragments, const uint8_t *payload, uint32_t size)
+{
+    memset(packet, 0, 20);
+    packet[0] = 0x45;
+    uint16_t total_length = 20 + size;
+    packet[2] = total_length >> 8;
+    packet[3] = total_length & 0xff;
+    packet[4] = identification >> 8;
+    packet[5] = identification & 0xff;
+    uint16_t ip_off = (more_fragments ? 0x2000 : 0) | (offset / 8);
+    packet[6] = ip_off >> 8;
+    packet[7] = ip_off & 0xff;
+    packet[8] = 64;
+    packet[9] = IPPROTO_UDP;
+    packet[12] = 10;
+    packet[15] = 1;
+    packet[16] = 10;
+    packet[19] = 2;
+    memcpy(packet + 20, payload + offset, size);
+    return 20 + size;
+}
+
+ipv4_reassembly_result_t
+add_fragment(ipv4_reassembly_t *reassembly, uint16_t identification, uint32_t offset, bool more_fragments,
+    const uint8_t *payload, uint32_t size, uint64_t timestamp, const uint8_t **whole, uint32_t *whole_length)
+{
+    static uint8_t packet[20 + 65535];
+    uint32_t length = build_fragment(packet, identification, offset, more_fragments, payload, size);
+    return ipv4_reassembly_add(reassembly, packet, length, timestamp, whole, whole_length);
+}
+
+void
+fill_payload(uint8_t *payload, uint32_t size, uint8_t seed)
+{
+    for (uint32_t i = 0; i < size; i++){
+        payload[i] = (uint8_t)(i * 7 + seed);
+    }
+}
+
+void
+test_in_order()
+{
+    ipv4_reassembly_t *reassembly = ipv4_reassembly_create(16, 0, 0, IPV4_OVERLAP_FIRST);
+    uint8_t payload[3000];
+    fill_payload(payload, sizeof(payload), 1);
+    const uint8_t *whole;
+    uint32_t whole_length;
+
+    assert(add_fragment(reassembly, 1, 0, true, payload, 1480, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_HELD);
+    assert(whole == NULL);
+    assert(add_fragment(reassembly, 1, 1480, true, payload, 1480, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_HELD);
+    assert(reassembly->count == 1);
+    assert(add_fragment(reassembly, 1, 2960, false, payload, 40, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_COMPLETE);
+    assert(whole_length == sizeof(payload));
+    assert(memcmp(whole, payload, sizeof(payload)) == 0);
+    assert(reassembly->count == 0);
+    assert(reassembly->reassembled == 1);
+
+    // the next one goes in the same buffers
+    uint64_t memory = reassembly->memory;
+    assert(add_fragment(reassembly, 2, 0, true, payload, 1480, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_HELD);
+    assert(add_fragment(reassembly, 2, 1480, true, payload, 1480, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_HELD);
+    assert(add_fragment(reassembly, 2, 2960, false, payload, 40, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_COMPLETE);
+    assert(memcmp(whole, payload, sizeof(payload)) == 0);
+    assert(reassembly->memory == memory);
+    ipv4_reassembly_destroy(reassembly);
+}
+
+void
+test_out_of_order()
+{
+    ipv4_reassembly_t *reassembly = ipv4_reassembly_create(16, 0, 0, IPV4_OVERLAP_FIRST);
+    uint8_t payload[3000];
+    fill_payload(payload, sizeof(payload), 2);
+    const uint8_t *whole;
+    uint32_t whole_length;
+
+    // the last one first, two datagrams interleaved
+    assert(add_fragment(reassembly, 7, 2960, false, payload, 40, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_HELD);
+    assert(add_fragment(reassembly, 8, 0, true, payload, 1480, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_HELD);
+    assert(add_fragment(reassembly, 7, 0, true, payload, 1480, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_HELD);
+    assert(reassembly->count == 2);
+    assert(add_fragment(reassembly, 7, 1480, true, payload, 1480, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_COMPLETE);
+    assert(whole_length == sizeof(payload));
+    assert(memcmp(whole, payload, sizeof(payload)) == 0);
+    assert(reassembly->count == 1);
+    ipv4_reassembly_destroy(reassembly);
+}
+
+void
+test_overlap()
+{
+    uint8_t payload[2000];
+    uint8_t other[2000];
+    fill_payload(payload, sizeof(payload), 3);
+    fill_payload(other, sizeof(other), 4);
+    const uint8_t *whole;
+    uint32_t whole_length;
+
+    // 800 to 1599 comes twice, from payload then from other
+    ipv4_overlap_policy_t policies[] = {IPV4_OVERLAP_FIRST, IPV4_OVERLAP_LAST, IPV4_OVERLAP_DROP};
+    for (ipv4_overlap_policy_t policy : policies){
+        ipv4_reassembly_t *reassembly = ipv4_reassembly_create(16, 0, 0, policy);
+        assert(add_fragment(reassembly, 1, 0, true, payload, 1600, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_HELD);
+        // an exact duplicate changes nothing
+        assert(add_fragment(reassembly, 1, 0, true, payload, 1600, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_HELD);
+        ipv4_reassembly_result_t result = add_fragment(reassembly, 1, 800, false, other, 1200, SECOND, &whole, &whole_length);
+        if (policy == IPV4_OVERLAP_DROP){
+            assert(result == IPV4_REASSEMBLY_DROPPED);
+            assert(reassembly->count == 0 && reassembly->dropped == 1);
+        } else {
+            assert(result == IPV4_REASSEMBLY_COMPLETE);
+            assert(whole_length == 2000);
+            const uint8_t *overlapped = policy == IPV4_OVERLAP_FIRST ? payload : other;
+            assert(memcmp(whole, payload, 800) == 0);
+            assert(memcmp(whole + 800, overlapped + 800, 800) == 0);
+            assert(memcmp(whole + 1600, other + 1600, 400) == 0);
+        }
+        ipv4_reassembly_destroy(reassembly);
+    }
+}
+
+void
+test_expiry()
+{
+    ipv4_reassembly_t *reassembly = ipv4_reassembly_create(16, 0, 10 * SECOND, IPV4_OVERLAP_FIRST);
+    uint8_t payload[2000];
+    fill_payload(payload, sizeof(payload), 5);
+    const uint8_t *whole;
+    uint32_t whole_length;
+
+    assert(add_fragment(reassembly, 1, 0, true, payload, 1480, 100 * SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_HELD);
+    assert(add_fragment(reassembly, 2, 0, true, payload, 1480, 105 * SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_HELD);
+    // the first one is too old, the second one isn't yet
+    ipv4_reassembly_expire(reassembly, 111 * SECOND);
+    assert(reassembly->expired == 1);
+    assert(reassembly->count == 1);
+    assert(add_fragment(reassembly, 1, 1480, false, payload, 520, 111 * SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_HELD);
+    assert(add_fragment(reassembly, 2, 1480, false, payload, 520, 111 * SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_COMPLETE);
+    // long after, everything goes at once
+    ipv4_reassembly_expire(reassembly, 10000 * SECOND);
+    assert(reassembly->count == 0);
+    assert(reassembly->expired == 2);
+    ipv4_reassembly_destroy(reassembly);
+}
+
+void
+test_bounded_memory()
+{
+    // room for 4 first fragments, the pool for 8 datagrams
+    ipv4_reassembly_t *reassembly = ipv4_reassembly_create(8, 4 * IPV4_REASSEMBLY_BUFFER, 0, IPV4_OVERLAP_FIRST);
+    uint8_t payload[3000];
+    fill_payload(payload, sizeof(payload), 6);
+    const uint8_t *whole;
+    uint32_t whole_length;
+
+    // a flood of first fragments never completed
+    for (uint16_t identification = 0; identification < 1000; identification++){
+        assert(add_fragment(reassembly, identification, 0, true, payload, 1480, SECOND + identification, &whole, &whole_length) == IPV4_REASSEMBLY_HELD);
+        assert(reassembly->memory <= 4 * IPV4_REASSEMBLY_BUFFER);
+        assert(reassembly->count <= 8);
+    }
+    assert(reassembly->evicted == 1000 - 4);
+    // the oldest went first
+    assert(add_fragment(reassembly, 995, 1480, false, payload, 100, 2 * SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_HELD);
+    assert(reassembly->evicted == 1000 - 4 + 1);
+    // the last ones are still there
+    assert(add_fragment(reassembly, 999, 1480, false, payload, 100, 2 * SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_COMPLETE);
+    assert(whole_length == 1580);
+
+    // a datagram in too many pieces
+    uint32_t offset;
+    for (offset = 0; offset < 40 * 16; offset += 16){
+        if (add_fragment(reassembly, 5000, offset, true, payload, 8, 3 * SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_DROPPED){
+            break;
+        }
+    }
+    assert(offset == IPV4_REASSEMBLY_HOLES * 16);
+    ipv4_reassembly_destroy(reassembly);
+}
+
+void
+test_malformed()
+{
+    ipv4_reassembly_t *reassembly = ipv4_reassembly_create(16, 0, 0, IPV4_OVERLAP_FIRST);
+    static uint8_t payload[66000];
+    const uint8_t *whole;
+    uint32_t whole_length;
+
+    // not a multiple of 8 with more to come
+    assert(add_fragment(reassembly, 1, 0, true, payload, 100, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_DROPPED);
+    // past 65535 bytes
+    assert(add_fragment(reassembly, 2, 65000, false, payload, 600, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_DROPPED);
+    // two different ends
+    assert(add_fragment(reassembly, 3, 1480, false, payload, 100, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_HELD);
+    assert(add_fragment(reassembly, 3, 1480, false, payload, 200, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_DROPPED);
+    assert(reassembly->count == 0);
+
+    // cut by the capture
+    uint8_t packet[20 + 1480];
+    uint32_t length = build_fragment(packet, 4, 0, true, payload, 1480);
+    assert(ipv4_reassembly_add(reassembly, packet, length - 1, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_DROPPED);
+    assert(ipv4_reassembly_add(reassembly, packet, 10, SECOND, &whole, &whole_length) == IPV4_REASSEMBLY_DROPPED);
+    assert(reassembly->count == 0);
+    assert(reassembly->dropped == 5);
+    ipv4_reassembly_destroy(reassembly);
+}
+
+int main()
+{
+    test_in_order();
+    test_out_of_order();
+    test_overlap();
+    test_expiry();
+    test_bounded_memory();
+    test_malformed();
+    return 0;
+}
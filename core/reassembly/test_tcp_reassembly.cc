@@ -0,0 +1,267 @@
+#include "tcp_reassembly.h"
+#include <cassert>
+#include <cstring>
+#include <netinet/tcp.h>
+
+#define SECOND 1000000ull
+
+static const uint8_t client[4] = {10, 0, 0, 1};
+static const uint8_t server[4] = {10, 0, 0, 2};
+
+// a segment of the connection 10.0.0.1:40000 > 10.0.0.2:53, or back
+tcp_segment_t
+make_segment(bool from_client, uint32_t seq, uint8_t flags, const char *payload)
+{
+    tcp_segment_t segment;
+    memset(&segment, 0, sizeof(segment));
+    segment.version = 4;
+    segment.source_address = from_client ? client : server;
+    segment.destination_address = from_client ? server : client;
+    segment.source_port = from_client ? 40000 : 53;
+    segment.destination_port = from_client ? 53 : 40000;
+    segment.sequence_number = seq;
+    segment.flags = flags;
+    segment.payload = (const uint8_t*)payload;
+    segment.length = payload != NULL ? strlen(payload) : 0;
+    segment.timestamp = SECOND;
+    return segment;
+}
+
+// the delivery as a string, then all of it consumed
+bool
+delivered(tcp_reassembly_t *reassembly, tcp_delivery_t *delivery, const char *expected)
+{
+    char bytes[256] = {0};
+    uint32_t length = tcp_delivery_copy(delivery, 0, sizeof(bytes) - 1, (uint8_t*)bytes);
+    tcp_reassembly_consume(reassembly, delivery, length);
+    return length == delivery->length && strcmp(bytes, expected) == 0;
+}
+
+void
+add(tcp_reassembly_t *reassembly, bool from_client, uint32_t seq, uint8_t flags, const char *payload, tcp_delivery_t *delivery)
+{
+    tcp_segment_t segment = make_segment(from_client, seq, flags, payload);
+    tcp_reassembly_segment(reassembly, &segment, delivery);
+}
+
+void
+test_in_order()
+{
+    tcp_reassembly_t *reassembly = tcp_reassembly_create(16, 0, 0);
+    tcp_delivery_t delivery;
+
+    add(reassembly, true, 1000, TH_SYN, NULL, &delivery);
+    assert(delivery.span_count == 0);
+    add(reassembly, false, 5000, TH_SYN | TH_ACK, NULL, &delivery);
+    assert(delivery.direction == 1);
+
+    // straight from the packet
+    const char *hello = "hello";
+    tcp_segment_t segment = make_segment(true, 1001, TH_ACK, hello);
+    tcp_reassembly_segment(reassembly, &segment, &delivery);
+    assert(delivery.span_count == 1);
+    assert(delivery.spans[0].data == (const uint8_t*)hello);
+    assert(delivery.direction == 0 && !delivery.gap);
+    assert(delivered(reassembly, &delivery, "hello"));
+    add(reassembly, true, 1006, TH_ACK, " world", &delivery);
+    assert(delivered(reassembly, &delivery, " world"));
+
+    // the other direction is another stream
+    add(reassembly, false, 5001, TH_ACK, "hi", &delivery);
+    assert(delivered(reassembly, &delivery, "hi"));
+    assert(reassembly->bytes == 13);
+    assert(reassembly->memory == 0);
+    assert(reassembly->flows->count == 1);
+    tcp_reassembly_destroy(reassembly);
+}
+
+void
+test_out_of_order()
+{
+    tcp_reassembly_t *reassembly = tcp_reassembly_create(16, 0, 0);
+    tcp_delivery_t delivery;
+
+    add(reassembly, true, 1000, TH_SYN, NULL, &delivery);
+    add(reassembly, true, 1012, TH_ACK, "!", &delivery);
+    assert(delivery.span_count == 0);
+    add(reassembly, true, 1006, TH_ACK, " world", &delivery);
+    assert(delivery.span_count == 0);
+    assert(reassembly->out_of_order == 2);
+    assert(delivery.stream->range_count == 1);
+
+    // the hole filled, everything at once
+    add(reassembly, true, 1001, TH_ACK, "hello", &delivery);
+    assert(delivery.span_count == 2);
+    assert(delivered(reassembly, &delivery, "hello world!"));
+    assert(delivery.stream->range_count == 0);
+    // the ring went back to the spares
+    assert(delivery.stream->ring == NULL && reassembly->spare[0] != NULL);
+    tcp_reassembly_destroy(reassembly);
+}
+
+void
+test_retransmissions()
+{
+    tcp_reassembly_t *reassembly = tcp_reassembly_create(16, 0, 0);
+    tcp_delivery_t delivery;
+
+    // no SYN seen, the stream starts at the first segment
+    add(reassembly, true, 1001, TH_ACK, "hello", &delivery);
+    assert(delivered(reassembly, &delivery, "hello"));
+    add(reassembly, true, 1001, TH_ACK, "hello", &delivery);
+    assert(delivery.span_count == 0);
+    // only what is new
+    add(reassembly, true, 1003, TH_ACK, "llo wo", &delivery);
+    assert(delivered(reassembly, &delivery, " wo"));
+    assert(reassembly->retransmitted == 5 + 3);
+
+    // out of order ones overlapping each other
+    add(reassembly, true, 1011, TH_ACK, "d!", &delivery);
+    add(reassembly, true, 1010, TH_ACK, "ld!", &delivery);
+    assert(delivery.stream->range_count == 1);
+    add(reassembly, true, 1009, TH_ACK, "r", &delivery);
+    assert(delivered(reassembly, &delivery, "rld!"));
+
+    // sequence numbers wrapping around
+    add(reassembly, false, 0xfffffffe, TH_SYN, NULL, &delivery);
+    add(reassembly, false, 0x00000001, TH_ACK, "cd", &delivery);
+    add(reassembly, false, 0xffffffff, TH_ACK, "ab", &delivery);
+    assert(delivered(reassembly, &delivery, "abcd"));
+    tcp_reassembly_destroy(reassembly);
+}
+
+void
+test_partial_consume()
+{
+    tcp_reassembly_t *reassembly = tcp_reassembly_create(16, 0, 0);
+    tcp_delivery_t delivery;
+    char packet[16];
+
+    add(reassembly, true, 1000, TH_SYN, NULL, &delivery);
+    strcpy(packet, "abcdef");
+    add(reassembly, true, 1001, TH_ACK, packet, &delivery);
+    // a message of 2 bytes, the next one isn't whole
+    tcp_reassembly_consume(reassembly, &delivery, 2);
+    assert(delivery.stream->ring != NULL);
+    // the packet is gone, its bytes were kept
+    memset(packet, 'x', 6);
+    add(reassembly, true, 1007, TH_ACK, "gh", &delivery);
+    assert(delivery.span_count == 2);
+    assert(delivered(reassembly, &delivery, "cdefgh"));
+    assert(delivery.stream->ring == NULL);
+    tcp_reassembly_destroy(reassembly);
+}
+
+void
+test_bounded()
+{
+    // 4 KB per stream, room for one ring
+    tcp_reassembly_t *reassembly = tcp_reassembly_create(16, 4096, 4096);
+    tcp_delivery_t delivery;
+    static char big[5000];
+    memset(big, 'b', sizeof(big) - 1);
+
+    add(reassembly, true, 1000, TH_SYN, NULL, &delivery);
+    add(reassembly, true, 1001, TH_ACK, "a", &delivery);
+    tcp_reassembly_consume(reassembly, &delivery, 1);
+
+    // past the window: the hole is given up
+    add(reassembly, true, 1010, TH_ACK, "kept", &delivery);
+    add(reassembly, true, 1002 + 5000, TH_ACK, "far", &delivery);
+    assert(delivery.gap);
+    assert(reassembly->gaps == 1);
+    assert(delivered(reassembly, &delivery, "far"));
+    assert(delivery.stream->range_count == 0);
+
+    // the one ring is taken by the client, the server has none
+    add(reassembly, true, 7010, TH_ACK, "later", &delivery);
+    assert(reassembly->out_of_order == 2);
+    add(reassembly, false, 1, TH_ACK, "a", &delivery);
+    tcp_reassembly_consume(reassembly, &delivery, 1);
+    add(reassembly, false, 10, TH_ACK, "later", &delivery);
+    assert(reassembly->dropped == 1);
+    assert(reassembly->memory == 4096);
+
+    // a stream in too many pieces
+    for (uint32_t i = 0; i < TCP_STREAM_RANGES; i++){
+        add(reassembly, true, 7100 + i * 10, TH_ACK, "x", &delivery);
+    }
+    assert(delivery.stream->range_count == TCP_STREAM_RANGES);
+    assert(reassembly->dropped == 2);
+
+    // larger than the window, in order: delivered as it is
+    add(reassembly, false, 2, TH_RST, NULL, &delivery);
+    add(reassembly, false, 100, TH_ACK, big, &delivery);
+    assert(delivery.length == sizeof(big) - 1 && delivery.span_count == 1);
+    tcp_reassembly_consume(reassembly, &delivery, delivery.length);
+    tcp_reassembly_destroy(reassembly);
+}
+
+void
+test_ring_grows()
+{
+    tcp_reassembly_t *reassembly = tcp_reassembly_create(16, 0, 0);
+    tcp_delivery_t delivery;
+
+    add(reassembly, true, 1000, TH_SYN, NULL, &delivery);
+    add(reassembly, true, 1010, TH_ACK, "near", &delivery);
+    assert(delivery.stream->ring_size == TCP_RING_SIZE);
+    // further than the smallest ring, the bytes kept move to a larger one
+    add(reassembly, true, 1001 + 6000, TH_ACK, "far", &delivery);
+    assert(delivery.stream->ring_size == 2 * TCP_RING_SIZE);
+    assert(reassembly->spare[0] != NULL);
+    assert(reassembly->memory == 3 * TCP_RING_SIZE);
+
+    static char hole[6000];
+    memset(hole, 'h', sizeof(hole));
+    memcpy(hole + 9, "near", 4);
+    tcp_segment_t segment = make_segment(true, 1001, TH_ACK, NULL);
+    segment.payload = (const uint8_t*)hole;
+    segment.length = sizeof(hole);
+    tcp_reassembly_segment(reassembly, &segment, &delivery);
+    assert(delivery.length == 6003);
+    char last[8] = {0};
+    tcp_delivery_copy(&delivery, 9, 4, (uint8_t*)last);
+    assert(strcmp(last, "near") == 0);
+    assert(tcp_delivery_copy(&delivery, 6000, 8, (uint8_t*)last) == 3);
+    assert(memcmp(last, "far", 3) == 0);
+    tcp_reassembly_consume(reassembly, &delivery, delivery.length);
+    assert(delivery.stream->ring == NULL && reassembly->spare[1] != NULL);
+    tcp_reassembly_destroy(reassembly);
+}
+
+void
+test_flow_removed()
+{
+    // one flow at a time
+    tcp_reassembly_t *reassembly = tcp_reassembly_create(1, 0, 0);
+    tcp_delivery_t delivery;
+
+    add(reassembly, true, 1000, TH_SYN, NULL, &delivery);
+    add(reassembly, true, 1010, TH_ACK, "later", &delivery);
+    tcp_stream_t *stream = delivery.stream;
+    assert(stream->ring != NULL);
+
+    // another connection pushes it out, its ring is spared
+    tcp_segment_t segment = make_segment(true, 1, TH_SYN, NULL);
+    segment.source_port = 40001;
+    tcp_reassembly_segment(reassembly, &segment, &delivery);
+    assert(reassembly->flows->evicted == 1);
+    assert(delivery.stream == stream);
+    assert(stream->ring == NULL && stream->range_count == 0);
+    assert(stream->next_seq == 2);
+    assert(reassembly->spare[0] != NULL);
+    tcp_reassembly_destroy(reassembly);
+}
+
+int main()
+{
+    test_in_order();
+    test_out_of_order();
+    test_retransmissions();
+    test_partial_consume();
+    test_bounded();
+    test_ring_grows();
+    test_flow_removed();
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unordered_map>
+#include <vector>
+#include "top_talkers.h"
+#include "dissector.h"
+
+/*
+Packets per second through top_talkers_add, against an exact
+unordered_map of the sources, for a few numbers of distinct sources; the
+sources follow a Zipf law (s = 1.1), the ports are random. Recall is how
+many of the 10 heaviest sources (exact) are in the summary's 10 heaviest.
+
+usage: bench_top_talkers [packets]
+*/
+
+double
+now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t state = 88172645463325252ull;
+
+uint64_t
+next_random()
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+int
+main(int argc, char **argv)
+{
+    uint32_t packets = (argc > 1) ? atol(argv[1]) : 4000000;
+    const uint32_t distinct_counts[] = {1000, 100000, 10000000};
+
+    uint32_t *sources = (uint32_t*)malloc((size_t)packets * sizeof(uint32_t));
+    uint16_t *lengths = (uint16_t*)malloc((size_t)packets * sizeof(uint16_t));
+    printf("%-10s %12s %12s %12s %12s %8s\n", "sources", "Mpackets/s", "ns/packet", "exact ns", "exact MB", "recall");
+    for (uint32_t distinct : distinct_counts){
+        // Zipf through the inverse of its cumulative distribution, approximated
+        double exponent = 1.1;
+        double harmonic = (pow(distinct, 1 - exponent) - 1) / (1 - exponent) + 0.5772;
+        for (uint32_t i = 0; i < packets; i++){
+            double u = (next_random() >> 11) * (1.0 / 9007199254740992.0) * harmonic;
+            double rank = pow(1 + u * (1 - exponent), 1 / (1 - exponent));
+            uint32_t source = (uint32_t)rank;
+            sources[i] = (source < distinct) ? source * 2654435761u : next_random() % distinct * 2654435761u;
+            lengths[i] = 64 + next_random() % 1400;
+        }
+
+        top_talkers_t *top = top_talkers_create(0);
+        dissection_t dissection = {};
+        dissection.layers = LAYER_BIT(LAYER_IPV4) | LAYER_BIT(LAYER_UDP);
+        double start = now_seconds();
+        for (uint32_t i = 0; i < packets; i++){
+            memcpy(dissection.ipv4.raw_source_address, &sources[i], 4);
+            memcpy(dissection.ipv4.raw_destination_address, &sources[(i * 7) % packets], 4);
+            dissection.udp.source_port = 1024 + (sources[i] & 0x7fff);
+            dissection.udp.destination_port = (i % 3 == 0) ? 53 : 443;
+            top_talkers_add(top, &dissection, lengths[i]);
+        }
+        double elapsed = now_seconds() - start;
+
+        std::unordered_map<uint32_t, uint64_t> exact;
+        start = now_seconds();
+        for (uint32_t i = 0; i < packets; i++){
+            exact[sources[i]] += lengths[i];
+        }
+        double exact_elapsed = now_seconds() - start;
+        // a node and a bucket per source, about
+        double exact_memory = exact.size() * (sizeof(void*) * 2 + 16) / 1e6;
+
+        std::vector<std::pair<uint64_t, uint32_t>> heaviest;
+        for (const auto &it : exact){
+            heaviest.emplace_back(it.second, it.first);
+        }
+        std::partial_sort(heaviest.begin(), heaviest.begin() + 10, heaviest.end(), std::greater<>());
+        const space_saving_t *summary = top->summaries[TOP_SOURCES];
+        uint32_t entries[10];
+        uint32_t found = space_saving_top(summary, 10, entries);
+        uint32_t recall = 0;
+        for (uint32_t i = 0; i < 10; i++){
+            for (uint32_t j = 0; j < found; j++){
+                top_address_key_t key;
+                memcpy(&key, space_saving_key(summary, entries[j]), sizeof(key));
+                recall += memcmp(key.address, &heaviest[i].second, 4) == 0;
+            }
+        }
+
+        printf("%-10u %12.2f %12.1f %12.1f %12.1f %5u/10\n", distinct, packets / elapsed / 1e6, elapsed / packets * 1e9,
+            exact_elapsed / packets * 1e9, exact_memory, recall);
+        top_talkers_destroy(top);
+    }
+    free(lengths);
+    free(sources);
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include "top_talkers.h"
+#include "dissector.h"
+#include "test_frames.h"
+#include <cassert>
+#include <cstring>
+#include <netinet/in.h>
+
+static top_address_key_t
+address_key(uint8_t version, uint8_t last)
+{
+    top_address_key_t key;
+    memset(&key, 0, sizeof(key));
+    key.version = version;
+    key.address[0] = 10;
+    key.address[3] = last;
+    return key;
+}
+
+static top_port_key_t
+port_key(uint8_t protocol, uint16_t port)
+{
+    top_port_key_t key;
+    memset(&key, 0, sizeof(key));
+    key.protocol = protocol;
+    key.port = port;
+    return key;
+}
+
+static void
+qname_key(char *key, const char *qname)
+{
+    memset(key, 0, TOP_QNAME_SIZE);
+    strncpy(key, qname, TOP_QNAME_SIZE - 1);
+}
+
+void
+test_create()
+{
+    top_talkers_t *top = top_talkers_create(0);
+    size_t memory = 0;
+    for (uint32_t kind = 0; kind < TOP_KINDS; kind++){
+        const space_saving_t *summary = top->summaries[kind];
+        assert(summary->key_size == top_talkers_key_size((top_kind_t)kind));
+        memory += summary->capacity * space_saving_entry_memory(summary->key_size);
+        memory += (size_t)top->sketches[kind]->width * COUNT_MIN_DEPTH * sizeof(uint64_t);
+    }
+    // within the budget, the qnames counted by fewer, bigger entries
+    assert(memory <= TOP_TALKERS_MEMORY);
+    assert(top->summaries[TOP_QNAMES]->capacity < top->summaries[TOP_SOURCES]->capacity);
+    top_talkers_destroy(top);
+}
+
+void
+test_packets()
+{
+    top_talkers_t *top = top_talkers_create(256 * 1024);
+    arena_t arena;
+    arena_init(&arena, 0);
+    uint8_t packet[sizeof(dns_query)];
+
+    for (uint32_t i = 0; i < 3; i++){
+        memcpy(packet, dns_query, sizeof(packet));
+        if (i == 1){
+            // the same name, another case
+            packet[55] = 'A';
+            packet[57] = 'B';
+        }
+        if (i == 2){
+            // the response, its question not counted again
+            packet[44] = 0x81;
+        }
+        dissection_t dissection = {};
+        dissect(packet, sizeof(packet), LAYERS_ALL, &arena, false, &dissection);
+        top_talkers_add(top, &dissection, 100);
+        arena_reset(&arena);
+    }
+    assert(top->packets == 3 && top->bytes == 300);
+
+    top_address_key_t client = address_key(4, 1);
+    top_address_key_t server = address_key(4, 2);
+    assert(top_talkers_estimate(top, TOP_SOURCES, &client) == 300);
+    assert(top_talkers_estimate(top, TOP_DESTINATIONS, &server) == 300);
+    assert(top_talkers_estimate(top, TOP_SOURCES, &server) == 0);
+    top_port_key_t dns = port_key(IPPROTO_UDP, 53);
+    top_port_key_t tcp_dns = port_key(IPPROTO_TCP, 53);
+    assert(top_talkers_estimate(top, TOP_DESTINATION_PORTS, &dns) == 300);
+    assert(top_talkers_estimate(top, TOP_DESTINATION_PORTS, &tcp_dns) == 0);
+    char name[TOP_QNAME_SIZE];
+    qname_key(name, "a.b");
+    assert(top_talkers_estimate(top, TOP_QNAMES, name) == 2);
+
+    // without the DNS sections, no names
+    dissection_t dissection = {};
+    dissect(dns_query, sizeof(dns_query), LAYERS_ALL & ~LAYER_DNS_SECTIONS, &arena, false, &dissection);
+    top_talkers_add(top, &dissection, 100);
+    assert(top_talkers_estimate(top, TOP_QNAMES, name) == 2);
+    assert(top_talkers_estimate(top, TOP_SOURCES, &client) == 400);
+
+    arena_destroy(&arena);
+    top_talkers_destroy(top);
+}
+
+void
+test_heavy_hitters()
+{
+    // 5 heavy sources among 200000, 64 KB: far fewer counters than sources
+    top_talkers_t *top = top_talkers_create(64 * 1024);
+    assert(top->summaries[TOP_SOURCES]->capacity < 1000);
+    uint64_t state = 88172645463325252ull;
+    for (uint32_t i = 0; i < 400000; i++){
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        top_address_key_t key = address_key(6, 0);
+        uint32_t source = (i % 4 == 0) ? i / 4 % 5 : 100 + state % 200000;
+        memcpy(key.address + 8, &source, sizeof(source));
+        top_talkers_add_key(top, TOP_SOURCES, &key, 1500);
+    }
+
+    const space_saving_t *summary = top->summaries[TOP_SOURCES];
+    uint32_t entries[5];
+    assert(space_saving_top(summary, 5, entries) == 5);
+    for (uint32_t i = 0; i < 5; i++){
+        top_address_key_t key;
+        memcpy(&key, space_saving_key(summary, entries[i]), sizeof(key));
+        uint32_t source;
+        memcpy(&source, key.address + 8, sizeof(source));
+        assert(key.version == 6 && source < 5);
+        // 20000 packets each, neither estimate under it
+        uint64_t weight = 20000ull * 1500;
+        assert(top_talkers_estimate(top, TOP_SOURCES, &key) >= weight);
+        assert(summary->entries[entries[i]].count - summary->entries[entries[i]].error <= weight);
+    }
+    top_talkers_destroy(top);
+}
+
+void
+test_merge()
+{
+    top_talkers_t *first = top_talkers_create(64 * 1024);
+    top_talkers_t *second = top_talkers_create(64 * 1024);
+    char name[TOP_QNAME_SIZE];
+    qname_key(name, "example.com");
+    for (uint32_t i = 0; i < 10; i++){
+        top_talkers_add_key(first, TOP_QNAMES, name, 1);
+        top_talkers_add_key(second, TOP_QNAMES, name, 1);
+    }
+    assert(top_talkers_merge(first, second) == 0);
+    assert(top_talkers_estimate(first, TOP_QNAMES, name) == 20);
+
+    top_talkers_t *smaller = top_talkers_create(16 * 1024);
+    assert(top_talkers_merge(first, smaller) == -1);
+    top_talkers_destroy(smaller);
+    top_talkers_destroy(second);
+    top_talkers_destroy(first);
+}
+
+int main()
+{
+    test_create();
+    test_packets();
+    test_heavy_hitters();
+    test_merge();
+    return 0;
+}
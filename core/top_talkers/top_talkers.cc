@@ -0,0 +1,198 @@
+#include "top_talkers.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+
+#include "dissector.h"
+#include "key_hash.h"
+
+static const uint32_t top_key_sizes[TOP_KINDS] = {
+    sizeof(top_address_key_t),
+    sizeof(top_address_key_t),
+    sizeof(top_port_key_t),
+    sizeof(top_port_key_t),
+    TOP_QNAME_SIZE,
+};
+
+/**
+ * @brief Allocate a summary and a sketch per kind of key
+ *
+ * @param memory bytes for all of them, TOP_TALKERS_MEMORY when 0
+ * @return top_talkers_t*
+ */
+top_talkers_t*
+top_talkers_create(size_t memory)
+{
+    top_talkers_t *top = (top_talkers_t*)calloc(1, sizeof(top_talkers_t));
+    if (top == NULL){
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    if (memory == 0){
+        memory = TOP_TALKERS_MEMORY;
+    }
+    size_t share = memory / TOP_KINDS / 2;
+    for (uint32_t kind = 0; kind < TOP_KINDS; kind++){
+        size_t capacity = share / space_saving_entry_memory(top_key_sizes[kind]);
+        if (capacity > (1u << 30)){
+            capacity = 1u << 30;
+        }
+        top->summaries[kind] = space_saving_create((uint32_t)capacity, top_key_sizes[kind]);
+        top->sketches[kind] = count_min_create_memory(share);
+    }
+    return top;
+}
+
+void
+top_talkers_destroy(top_talkers_t *top)
+{
+    for (uint32_t kind = 0; kind < TOP_KINDS; kind++){
+        space_saving_destroy(top->summaries[kind]);
+        count_min_destroy(top->sketches[kind]);
+    }
+    free(top);
+}
+
+uint32_t
+top_talkers_key_size(top_kind_t kind)
+{
+    return top_key_sizes[kind];
+}
+
+/**
+ * @brief Count the weight of a key of a kind
+ *
+ * @param top
+ * @param kind
+ * @param key top_talkers_key_size(kind) bytes
+ * @param weight
+ */
+void
+top_talkers_add_key(top_talkers_t *top, top_kind_t kind, const void *key, uint64_t weight)
+{
+    uint64_t hash = key_hash(key, top_key_sizes[kind]);
+    space_saving_add(top->summaries[kind], key, hash, weight);
+    count_min_add(top->sketches[kind], hash, weight);
+}
+
+static void
+top_add_ports(top_talkers_t *top, uint8_t protocol, uint16_t source, uint16_t destination, uint64_t weight)
+{
+    top_port_key_t key;
+    memset(&key, 0, sizeof(key));
+    key.protocol = protocol;
+    key.port = source;
+    top_talkers_add_key(top, TOP_SOURCE_PORTS, &key, weight);
+    key.port = destination;
+    top_talkers_add_key(top, TOP_DESTINATION_PORTS, &key, weight);
+}
+
+// the names asked by a query, lowercase
+static void
+top_add_qnames(top_talkers_t *top, const my_dns_header_t *dns)
+{
+    if (dns->qr){
+        return;
+    }
+    const question_section_t *questions = dns_questions_items(&dns->question_section);
+    for (uint32_t i = 0; i < dns->question_section.count; i++){
+        char key[TOP_QNAME_SIZE];
+        memset(key, 0, sizeof(key));
+        const char *qname = questions[i].qname;
+        for (uint32_t j = 0; j < TOP_QNAME_SIZE - 1 && qname[j] != '\0'; j++){
+            char c = qname[j];
+            key[j] = (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+        }
+        top_talkers_add_key(top, TOP_QNAMES, key, 1);
+    }
+}
+
+/**
+ * @brief Count a packet's addresses, ports and the names it asks for
+ *
+ * @param top
+ * @param dissection of the packet
+ * @param length of the packet on the wire
+ */
+void
+top_talkers_add(top_talkers_t *top, const struct dissection *dissection, uint32_t length)
+{
+    top->packets++;
+    top->bytes += length;
+
+    top_address_key_t source;
+    top_address_key_t destination;
+    memset(&source, 0, sizeof(source));
+    memset(&destination, 0, sizeof(destination));
+    if (dissection_has(dissection, LAYER_IPV4)){
+        source.version = destination.version = 4;
+        memcpy(source.address, dissection->ipv4.raw_source_address, 4);
+        memcpy(destination.address, dissection->ipv4.raw_destination_address, 4);
+    } else if (dissection_has(dissection, LAYER_IPV6)){
+        source.version = destination.version = 6;
+        memcpy(source.address, dissection->ipv6.raw_source_address, 16);
+        memcpy(destination.address, dissection->ipv6.raw_destination_address, 16);
+    } else {
+        return;
+    }
+    top_talkers_add_key(top, TOP_SOURCES, &source, length);
+    top_talkers_add_key(top, TOP_DESTINATIONS, &destination, length);
+
+    if (dissection_has(dissection, LAYER_TCP)){
+        top_add_ports(top, IPPROTO_TCP, dissection->tcp.source_port, dissection->tcp.destination_port, length);
+    } else if (dissection_has(dissection, LAYER_UDP)){
+        top_add_ports(top, IPPROTO_UDP, dissection->udp.source_port, dissection->udp.destination_port, length);
+    }
+
+    if (!dissection_has(dissection, LAYER_DNS)){
+        return;
+    }
+    top_add_qnames(top, &dissection->dns);
+    for (uint32_t i = 0; i < dissection->dns_more_count; i++){
+        top_add_qnames(top, &dissection->dns_more[i]);
+    }
+}
+
+/**
+ * @brief Add the counts of another instance, created with the same memory
+ *
+ * @param top
+ * @param other
+ * @return int 0, -1 if their sketches differ
+ */
+int
+top_talkers_merge(top_talkers_t *top, const top_talkers_t *other)
+{
+    for (uint32_t kind = 0; kind < TOP_KINDS; kind++){
+        if (top->sketches[kind]->width != other->sketches[kind]->width){
+            return -1;
+        }
+    }
+    for (uint32_t kind = 0; kind < TOP_KINDS; kind++){
+        space_saving_merge(top->summaries[kind], other->summaries[kind]);
+        count_min_merge(top->sketches[kind], other->sketches[kind]);
+    }
+    top->packets += other->packets;
+    top->bytes += other->bytes;
+    return 0;
+}
+
+/**
+ * @brief The weight of any key, never less than what it had: the smaller
+ * of the summary's and the sketch's estimates
+ *
+ * @param top
+ * @param kind
+ * @param key top_talkers_key_size(kind) bytes
+ * @return uint64_t
+ */
+uint64_t
+top_talkers_estimate(const top_talkers_t *top, top_kind_t kind, const void *key)
+{
+    uint64_t hash = key_hash(key, top_key_sizes[kind]);
+    uint64_t counted = space_saving_estimate(top->summaries[kind], key, hash);
+    uint64_t sketched = count_min_estimate(top->sketches[kind], hash);
+    return (counted < sketched) ? counted : sketched;
+}
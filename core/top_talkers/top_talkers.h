@@ -0,0 +1,88 @@
+#ifndef TOP_TALKERS_H
+#define TOP_TALKERS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "space_saving.h"
+#include "count_min.h"
+
+/*
+The heaviest source and destination addresses, ports and DNS names of a
+capture, in fixed memory whatever the number of distinct ones: no exact
+table of everything seen, one sketch pair per kind of key.
+
+    kind                  key                           weight
+    TOP_SOURCES           version, address (16 bytes)   bytes on the wire
+    TOP_DESTINATIONS      version, address
+    TOP_SOURCE_PORTS      protocol, port                bytes on the wire
+    TOP_DESTINATION_PORTS protocol, port
+    TOP_QNAMES            qname, lowercase (64 bytes)   queries
+
+each key goes to a Space-Saving summary, which keeps the heaviest ones with
+their counts, and to a Count-Min sketch, which answers how heavy any key
+is, counted or not. A key is hashed once for both, with key_hash(). The
+memory given at creation is shared evenly between the kinds, half to the
+summary and half to the sketch; a qname key being bigger, fewer of them
+are counted.
+
+Keys are zero-padded, compared with memcmp. A name longer than the key is
+cut, the names sharing its first TOP_QNAME_SIZE - 1 bytes count together.
+Only the questions of queries count, the responses echo them back.
+
+The addresses and ports come from a dissection with the IPv4 or IPv6, TCP
+or UDP layers; the qnames need LAYER_DNS_SECTIONS. Two instances created
+with the same memory merge, one per thread added to one for the report.
+*/
+
+#define TOP_QNAME_SIZE 64
+#define TOP_TALKERS_MEMORY (4u << 20)   // bytes, for all the kinds
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct dissection;
+
+typedef enum top_kind {
+    TOP_SOURCES,
+    TOP_DESTINATIONS,
+    TOP_SOURCE_PORTS,
+    TOP_DESTINATION_PORTS,
+    TOP_QNAMES,
+    TOP_KINDS
+} top_kind_t;
+
+typedef struct top_address_key {
+    uint8_t version;                // 4 or 6
+    uint8_t address[16];            // IPv4 in the first 4 bytes, the rest 0
+} top_address_key_t;
+
+typedef struct top_port_key {
+    uint8_t protocol;               // IPPROTO_TCP or IPPROTO_UDP
+    uint8_t padding;                // zero, keys are compared with memcmp
+    uint16_t port;
+} top_port_key_t;
+
+typedef struct top_talkers {
+    space_saving_t *summaries[TOP_KINDS];
+    count_min_t *sketches[TOP_KINDS];
+    uint64_t packets;
+    uint64_t bytes;
+} top_talkers_t;
+
+top_talkers_t* top_talkers_create(size_t memory);
+void top_talkers_destroy(top_talkers_t *top);
+
+uint32_t top_talkers_key_size(top_kind_t kind);
+void top_talkers_add_key(top_talkers_t *top, top_kind_t kind, const void *key, uint64_t weight);
+void top_talkers_add(top_talkers_t *top, const struct dissection *dissection, uint32_t length);
+int top_talkers_merge(top_talkers_t *top, const top_talkers_t *other);
+uint64_t top_talkers_estimate(const top_talkers_t *top, top_kind_t kind, const void *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,88 @@
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include "traffic_stats.h"
+#include "dissector.h"
+
+/*
+Nanoseconds per packet through traffic_stats_add, for a mix of ethertypes,
+protocols and ports from prepared dissections, a packet every few
+microseconds: the cost the statistics add to a packet decoded anyway.
+The bucket lengths go from a millisecond (a new bucket every few hundred
+packets) to a second.
+
+usage: bench_traffic_stats [packets]
+*/
+
+double
+now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t state = 88172645463325252ull;
+
+uint64_t
+next_random()
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+static uint64_t emitted = 0;
+
+static void
+count_emitted(void *context, const traffic_bucket_t *bucket)
+{
+    (void)context;
+    emitted += bucket->packets[TRAFFIC_ALL];
+}
+
+int
+main(int argc, char **argv)
+{
+    uint32_t packets = (argc > 1) ? atol(argv[1]) : 4000000;
+    const uint64_t lengths[] = {1000, 100000, 1000000};
+
+    // 1024 packet kinds, looked up in turn
+    const uint16_t ports[] = {53, 80, 443, 22, 123, 8080, 40000, 51234};
+    std::vector<dissection_t> kinds(1024);
+    for (dissection_t &dissection : kinds){
+        uint64_t random = next_random();
+        dissection.ethertype = (random % 10 == 0) ? ETHERTYPE_ARP : (random % 3 == 0) ? ETHERTYPE_IPV6 : ETHERTYPE_IP;
+        dissection.ip_protocol = (random >> 8) % 4 == 0 ? IPPROTO_UDP : IPPROTO_TCP;
+        dissection.source_port = ports[(random >> 16) % 8];
+        dissection.destination_port = ports[(random >> 24) % 8];
+    }
+    std::vector<uint64_t> timestamps(packets);
+    uint64_t time = 1700000000ull * 1000000;
+    for (uint32_t i = 0; i < packets; i++){
+        time += next_random() % 8;
+        timestamps[i] = time;
+    }
+
+    printf("%-12s %12s %12s %10s\n", "bucket us", "Mpackets/s", "ns/packet", "buckets");
+    for (uint64_t length : lengths){
+        traffic_stats_t *stats = traffic_stats_create(length, 0, count_emitted, NULL);
+        emitted = 0;
+        double start = now_seconds();
+        for (uint32_t i = 0; i < packets; i++){
+            traffic_stats_add(stats, timestamps[i], 64 + i % 1400, &kinds[i & 1023]);
+        }
+        traffic_stats_finish(stats);
+        double elapsed = now_seconds() - start;
+        if (emitted != packets){
+            fprintf(stderr, "%llu packets emitted of %u\n", (unsigned long long)emitted, packets);
+            return 1;
+        }
+        printf("%-12llu %12.2f %12.2f %10llu\n", (unsigned long long)length, packets / elapsed / 1e6,
+            elapsed / packets * 1e9, (unsigned long long)((timestamps[packets - 1] - timestamps[0]) / length + 1));
+        traffic_stats_destroy(stats);
+    }
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include "traffic_stats.h"
+#include "dissector.h"
+#include "test_frames.h"
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+// the buckets emitted, in order
+static void
+collect(void *context, const traffic_bucket_t *bucket)
+{
+    ((std::vector<traffic_bucket_t>*)context)->push_back(*bucket);
+}
+
+// a bucket of a ring emitted into another
+static void
+merge_into(void *context, const traffic_bucket_t *bucket)
+{
+    traffic_stats_merge((traffic_stats_t*)context, bucket);
+}
+
+static dissection_t
+keys(uint16_t ethertype, uint8_t protocol, uint16_t source_port, uint16_t destination_port)
+{
+    dissection_t dissection = {};
+    dissection.ethertype = ethertype;
+    dissection.ip_protocol = protocol;
+    dissection.source_port = source_port;
+    dissection.destination_port = destination_port;
+    return dissection;
+}
+
+void
+test_counters()
+{
+    std::vector<traffic_bucket_t> rows;
+    traffic_stats_t *stats = traffic_stats_create(0, 0, collect, &rows);
+    arena_t arena;
+    arena_init(&arena, 0);
+
+    // only walked through for the keys
+    dissection_t dissection = {};
+    dissect(dns_query, sizeof(dns_query), LAYER_KEYS, &arena, false, &dissection);
+    traffic_stats_add(stats, 1000, sizeof(dns_query), &dissection);
+    // the response, its class from the source port
+    dissection = keys(ETHERTYPE_IP, IPPROTO_UDP, 53, 49152);
+    traffic_stats_add(stats, 2000, 100, &dissection);
+    dissection = keys(ETHERTYPE_IPV6, IPPROTO_TCP, 50000, 443);
+    traffic_stats_add(stats, 3000, 1500, &dissection);
+    dissection = keys(ETHERTYPE_IPV6, IPPROTO_ICMPV6, 0, 0);
+    traffic_stats_add(stats, 4000, 80, &dissection);
+    // a fragment without its ports
+    dissection = keys(ETHERTYPE_IP, IPPROTO_UDP, 0, 0);
+    traffic_stats_add(stats, 5000, 1000, &dissection);
+    dissection = keys(ETHERTYPE_ARP, 0, 0, 0);
+    traffic_stats_add(stats, 6000, 60, &dissection);
+    dissection = keys(0x88cc, 0, 0, 0);
+    traffic_stats_add(stats, 7000, 70, &dissection);
+    dissection = keys(ETHERTYPE_IP, IPPROTO_TCP, 40000, 40001);
+    traffic_stats_add(stats, 8000, 90, &dissection);
+
+    traffic_stats_finish(stats);
+    assert(rows.size() == 1 && rows[0].start == 0);
+    const traffic_bucket_t *row = &rows[0];
+    assert(row->packets[TRAFFIC_ALL] == 8);
+    assert(row->bytes[TRAFFIC_ALL] == sizeof(dns_query) + 100 + 1500 + 80 + 1000 + 60 + 70 + 90);
+    assert(row->packets[TRAFFIC_IPV4] == 4 && row->packets[TRAFFIC_IPV6] == 2);
+    assert(row->packets[TRAFFIC_ARP] == 1 && row->packets[TRAFFIC_OTHER_ETHERTYPE] == 1);
+    assert(row->packets[TRAFFIC_UDP] == 3 && row->packets[TRAFFIC_TCP] == 2 && row->packets[TRAFFIC_ICMPV6] == 1);
+    assert(row->packets[TRAFFIC_DNS] == 2 && row->bytes[TRAFFIC_DNS] == sizeof(dns_query) + 100);
+    assert(row->packets[TRAFFIC_HTTPS] == 1 && row->bytes[TRAFFIC_HTTPS] == 1500);
+    assert(row->packets[TRAFFIC_OTHER_PORT] == 1);
+    // each group adds up to its packets
+    uint64_t ports = 0;
+    for (uint32_t i = TRAFFIC_DNS; i <= TRAFFIC_OTHER_PORT; i++){
+        ports += row->packets[i];
+    }
+    assert(ports == 4);
+
+    arena_destroy(&arena);
+    traffic_stats_destroy(stats);
+}
+
+void
+test_ring()
+{
+    std::vector<traffic_bucket_t> rows;
+    traffic_stats_t *stats = traffic_stats_create(10, 4, collect, &rows);
+    assert(stats->capacity == 4);
+    dissection_t dissection = keys(ETHERTYPE_IP, IPPROTO_TCP, 1000, 80);
+
+    // 0, 10, 20, 30 held
+    for (uint64_t time = 5; time < 40; time += 10){
+        traffic_stats_add(stats, time, 1, &dissection);
+    }
+    assert(rows.empty());
+    // 50: 0 and 10 leave, 40 is empty
+    traffic_stats_add(stats, 55, 1, &dissection);
+    assert(rows.size() == 2 && rows[0].start == 0 && rows[1].start == 10);
+    assert(stats->oldest == 20);
+    // within the ring, out of order
+    traffic_stats_add(stats, 21, 1, &dissection);
+    // its row is gone
+    traffic_stats_add(stats, 9, 1, &dissection);
+    assert(stats->late == 1);
+
+    // asked for, before 40
+    traffic_stats_emit(stats, 45);
+    assert(rows.size() == 4 && rows[2].start == 20 && rows[2].packets[TRAFFIC_ALL] == 2);
+    assert(rows[3].start == 30);
+    // far ahead: everything held leaves, in order
+    traffic_stats_add(stats, 100000, 1, &dissection);
+    assert(rows.size() == 5 && rows[4].start == 50);
+    traffic_stats_add(stats, 100001, 1, &dissection);
+    traffic_stats_finish(stats);
+    assert(rows.size() == 6 && rows[5].start == 100000 && rows[5].packets[TRAFFIC_HTTP] == 2);
+    traffic_stats_destroy(stats);
+}
+
+void
+test_merge()
+{
+    // two threads' rings into a shared one, the packets in any order
+    std::vector<traffic_bucket_t> rows;
+    traffic_stats_t *shared = traffic_stats_create(100, 16, collect, &rows);
+    traffic_stats_t *first = traffic_stats_create(100, 2, merge_into, shared);
+    traffic_stats_t *second = traffic_stats_create(100, 2, merge_into, shared);
+    dissection_t dissection = keys(ETHERTYPE_IP, IPPROTO_UDP, 123, 123);
+    for (uint64_t time = 0; time < 1000; time += 2){
+        traffic_stats_add(first, time, 10, &dissection);
+        traffic_stats_add(second, time + 1, 20, &dissection);
+    }
+    traffic_stats_finish(first);
+    traffic_stats_finish(second);
+    traffic_stats_finish(shared);
+    assert(rows.size() == 10);
+    for (uint32_t i = 0; i < rows.size(); i++){
+        assert(rows[i].start == i * 100);
+        assert(rows[i].packets[TRAFFIC_ALL] == 100 && rows[i].bytes[TRAFFIC_ALL] == 50 * 10 + 50 * 20);
+        assert(rows[i].packets[TRAFFIC_NTP] == 100);
+    }
+    assert(shared->late == 0);
+    traffic_stats_destroy(second);
+    traffic_stats_destroy(first);
+    traffic_stats_destroy(shared);
+}
+
+int main()
+{
+    test_counters();
+    test_ring();
+    test_merge();
+    return 0;
+}
@@ -0,0 +1,261 @@
+#include "traffic_stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dissector.h"
+
+#define TRAFFIC_EMPTY UINT64_MAX    // the start of a bucket not in use
+
+const char *traffic_counter_names[TRAFFIC_COUNTERS] = {
+    NULL, "ipv4", "ipv6", "arp", "other_ethertype",
+    "tcp", "udp", "icmp", "icmpv6", "other_ip",
+    "dns", "http", "https", "ssh", "dhcp", "ntp", "other_port",
+};
+
+static void
+traffic_bucket_clear(traffic_bucket_t *bucket)
+{
+    memset(bucket, 0, sizeof(traffic_bucket_t));
+    bucket->start = TRAFFIC_EMPTY;
+}
+
+/**
+ * @brief Allocate the ring, every bucket empty
+ *
+ * @param length of a bucket in microseconds, TRAFFIC_BUCKET_LENGTH if 0
+ * @param capacity buckets, rounded up to a power of 2, TRAFFIC_CAPACITY if 0
+ * @param emit called with each bucket leaving the ring
+ * @param context given to emit
+ * @return traffic_stats_t*
+ */
+traffic_stats_t*
+traffic_stats_create(uint64_t length, uint32_t capacity, traffic_emit_t emit, void *context)
+{
+    traffic_stats_t *stats = (traffic_stats_t*)calloc(1, sizeof(traffic_stats_t));
+    if (stats == NULL){
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    stats->length = length > 0 ? length : TRAFFIC_BUCKET_LENGTH;
+    stats->capacity = 2;
+    while (stats->capacity < (capacity > 0 ? capacity : TRAFFIC_CAPACITY)){
+        stats->capacity *= 2;
+    }
+    stats->buckets = (traffic_bucket_t*)malloc(stats->capacity * sizeof(traffic_bucket_t));
+    if (stats->buckets == NULL){
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t i = 0; i < stats->capacity; i++){
+        traffic_bucket_clear(&stats->buckets[i]);
+    }
+    stats->emit = emit;
+    stats->context = context;
+    return stats;
+}
+
+void
+traffic_stats_destroy(traffic_stats_t *stats)
+{
+    free(stats->buckets);
+    free(stats);
+}
+
+/**
+ * @brief Emit the buckets starting before a time, the oldest first, and
+ * empty them: the ring holds the ones after it from now on
+ *
+ * @param stats
+ * @param before microseconds
+ */
+void
+traffic_stats_emit(traffic_stats_t *stats, uint64_t before)
+{
+    before -= before % stats->length;
+    if (!stats->started || before <= stats->oldest){
+        return;
+    }
+    // every bucket held is in the capacity steps after the oldest
+    uint64_t steps = (before - stats->oldest) / stats->length;
+    if (steps > stats->capacity){
+        steps = stats->capacity;
+    }
+    for (uint64_t i = 0; i < steps; i++){
+        uint64_t start = stats->oldest + i * stats->length;
+        traffic_bucket_t *bucket = &stats->buckets[(start / stats->length) & (stats->capacity - 1)];
+        if (bucket->start != start){
+            continue;
+        }
+        if (bucket->packets[TRAFFIC_ALL] != 0 && stats->emit != NULL){
+            stats->emit(stats->context, bucket);
+        }
+        traffic_bucket_clear(bucket);
+        if (bucket == stats->current){
+            stats->current = NULL;
+        }
+    }
+    stats->oldest = before;
+    if (stats->newest < before){
+        stats->newest = before;
+    }
+}
+
+// the bucket of a time, the oldest ones emitted to make room; NULL if it was emitted
+static traffic_bucket_t*
+traffic_stats_bucket(traffic_stats_t *stats, uint64_t timestamp)
+{
+    uint64_t start = timestamp - timestamp % stats->length;
+    if (!stats->started){
+        stats->oldest = start;
+        stats->newest = start;
+        stats->started = true;
+    }
+    if (start < stats->oldest){
+        return NULL;
+    }
+    uint64_t span = stats->capacity * stats->length;
+    if (start - stats->oldest >= span){
+        traffic_stats_emit(stats, start - span + stats->length);
+    }
+    if (start > stats->newest){
+        stats->newest = start;
+    }
+    traffic_bucket_t *bucket = &stats->buckets[(start / stats->length) & (stats->capacity - 1)];
+    bucket->start = start;
+    return bucket;
+}
+
+static inline traffic_counter_t
+traffic_port_class(uint16_t port)
+{
+    switch (port){
+        case 53: case 5353:
+            return TRAFFIC_DNS;
+        case 80: case 8080:
+            return TRAFFIC_HTTP;
+        case 443: case 8443:
+            return TRAFFIC_HTTPS;
+        case 22:
+            return TRAFFIC_SSH;
+        case 67: case 68: case 546: case 547:
+            return TRAFFIC_DHCP;
+        case 123:
+            return TRAFFIC_NTP;
+        default:
+            return TRAFFIC_OTHER_PORT;
+    }
+}
+
+static inline void
+traffic_count(traffic_bucket_t *bucket, traffic_counter_t counter, uint32_t length)
+{
+    bucket->packets[counter]++;
+    bucket->bytes[counter] += length;
+}
+
+/**
+ * @brief Count a packet in the bucket of its time, from the keys of its
+ * dissection (LAYER_KEYS)
+ *
+ * @param stats
+ * @param timestamp of the packet, microseconds
+ * @param length of the packet on the wire
+ * @param dissection of the packet
+ */
+void
+traffic_stats_add(traffic_stats_t *stats, uint64_t timestamp, uint32_t length, const struct dissection *dissection)
+{
+    // the same bucket as the last packet, most of the time; earlier wraps around
+    traffic_bucket_t *bucket = stats->current;
+    if (bucket == NULL || timestamp - bucket->start >= stats->length){
+        bucket = traffic_stats_bucket(stats, timestamp);
+        if (bucket == NULL){
+            stats->late++;
+            return;
+        }
+        stats->current = bucket;
+    }
+    traffic_count(bucket, TRAFFIC_ALL, length);
+
+    bool ip = true;
+    switch (dissection->ethertype){
+        case ETHERTYPE_IP:
+            traffic_count(bucket, TRAFFIC_IPV4, length);
+            break;
+        case ETHERTYPE_IPV6:
+            traffic_count(bucket, TRAFFIC_IPV6, length);
+            break;
+        case ETHERTYPE_ARP:
+            traffic_count(bucket, TRAFFIC_ARP, length);
+            ip = false;
+            break;
+        default:
+            traffic_count(bucket, TRAFFIC_OTHER_ETHERTYPE, length);
+            ip = false;
+    }
+    if (!ip){
+        return;
+    }
+    bool ports = false;
+    switch (dissection->ip_protocol){
+        case IPPROTO_TCP:
+            traffic_count(bucket, TRAFFIC_TCP, length);
+            ports = true;
+            break;
+        case IPPROTO_UDP:
+            traffic_count(bucket, TRAFFIC_UDP, length);
+            ports = true;
+            break;
+        case IPPROTO_ICMP:
+            traffic_count(bucket, TRAFFIC_ICMP, length);
+            break;
+        case IPPROTO_ICMPV6:
+            traffic_count(bucket, TRAFFIC_ICMPV6, length);
+            break;
+        default:
+            traffic_count(bucket, TRAFFIC_OTHER_IP, length);
+    }
+    // fragments after the first have no ports
+    if (!ports || (dissection->source_port | dissection->destination_port) == 0){
+        return;
+    }
+    traffic_counter_t port = traffic_port_class(dissection->destination_port);
+    if (port == TRAFFIC_OTHER_PORT){
+        port = traffic_port_class(dissection->source_port);
+    }
+    traffic_count(bucket, port, length);
+}
+
+/**
+ * @brief Add the counts of a bucket emitted by another ring to the bucket
+ * of the same start, late if it was emitted
+ *
+ * @param stats of the same bucket length
+ * @param bucket
+ */
+void
+traffic_stats_merge(traffic_stats_t *stats, const traffic_bucket_t *bucket)
+{
+    traffic_bucket_t *into = traffic_stats_bucket(stats, bucket->start);
+    if (into == NULL){
+        stats->late += bucket->packets[TRAFFIC_ALL];
+        return;
+    }
+    for (uint32_t i = 0; i < TRAFFIC_COUNTERS; i++){
+        into->packets[i] += bucket->packets[i];
+        into->bytes[i] += bucket->bytes[i];
+    }
+}
+
+/**
+ * @brief Emit every bucket left, once no packet comes anymore
+ *
+ * @param stats
+ */
+void
+traffic_stats_finish(traffic_stats_t *stats)
+{
+    traffic_stats_emit(stats, UINT64_MAX);
+}
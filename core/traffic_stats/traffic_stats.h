@@ -0,0 +1,104 @@
+#ifndef TRAFFIC_STATS_H
+#define TRAFFIC_STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Packets and bytes per protocol, in buckets of capture time: a handful of
+counters per packet, picked from the keys the dissector already read, no
+hashing and no allocation.
+
+    counters         from
+    all              every packet
+    ethertype        IPv4, IPv6, ARP, other (through the VLAN tag)
+    IP protocol      TCP, UDP, ICMP, ICMPv6, other
+    port class       DNS, HTTP, HTTPS, SSH, DHCP, NTP, other: the
+                     destination port's class, the source port's if it has
+                     none (responses)
+
+The buckets are a ring allocated once, by start / length modulo the
+capacity. The ring holds the buckets from the oldest one not emitted
+yet, a packet past the ring emits the oldest ones to make room:
+
+         oldest                          newest
+           |                               |
+    ... [ 12:00:00 | 12:00:01 | ... | 12:00:07 ]  capacity 8, 1 s each
+           |
+           +--> emit(bucket): a row written, or the bucket merged elsewhere
+
+a packet older than the oldest bucket (its row is gone) is counted as
+late only. A thread counts into its own ring; its emitted buckets merge
+into a shared one, the same structure, that writes the rows.
+*/
+
+#define TRAFFIC_BUCKET_LENGTH 1000000ull    // a second, in microseconds
+#define TRAFFIC_CAPACITY 64
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct dissection;
+
+typedef enum traffic_counter {
+    TRAFFIC_ALL,
+    TRAFFIC_IPV4,
+    TRAFFIC_IPV6,
+    TRAFFIC_ARP,
+    TRAFFIC_OTHER_ETHERTYPE,
+    TRAFFIC_TCP,
+    TRAFFIC_UDP,
+    TRAFFIC_ICMP,
+    TRAFFIC_ICMPV6,
+    TRAFFIC_OTHER_IP,
+    TRAFFIC_DNS,
+    TRAFFIC_HTTP,
+    TRAFFIC_HTTPS,
+    TRAFFIC_SSH,
+    TRAFFIC_DHCP,
+    TRAFFIC_NTP,
+    TRAFFIC_OTHER_PORT,
+    TRAFFIC_COUNTERS
+} traffic_counter_t;
+
+// unique, TRAFFIC_ALL's NULL
+extern const char *traffic_counter_names[TRAFFIC_COUNTERS];
+
+typedef struct traffic_bucket {
+    uint64_t start;                 // microseconds, a multiple of the length
+    uint64_t packets[TRAFFIC_COUNTERS];
+    uint64_t bytes[TRAFFIC_COUNTERS];
+} traffic_bucket_t;
+
+typedef struct traffic_stats traffic_stats_t;
+
+// a bucket leaving the ring, in the order of their starts
+typedef void (*traffic_emit_t)(void *context, const traffic_bucket_t *bucket);
+
+struct traffic_stats {
+    uint64_t length;                // of a bucket, microseconds
+    uint32_t capacity;              // buckets, a power of 2
+    traffic_bucket_t *buckets;
+    traffic_bucket_t *current;      // of the last packet, NULL before the first
+    uint64_t oldest;                // start of the oldest bucket held
+    uint64_t newest;                // start of the newest bucket held
+    uint64_t late;                  // packets older than the ring, not in a bucket
+    bool started;                   // oldest and newest set
+    traffic_emit_t emit;
+    void *context;
+};
+
+traffic_stats_t* traffic_stats_create(uint64_t length, uint32_t capacity, traffic_emit_t emit, void *context);
+void traffic_stats_destroy(traffic_stats_t *stats);
+void traffic_stats_add(traffic_stats_t *stats, uint64_t timestamp, uint32_t length, const struct dissection *dissection);
+void traffic_stats_merge(traffic_stats_t *stats, const traffic_bucket_t *bucket);
+void traffic_stats_emit(traffic_stats_t *stats, uint64_t before);
+void traffic_stats_finish(traffic_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
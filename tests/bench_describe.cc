@@ -0,0 +1,135 @@
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include "ethernet.h"
+#include "arp.h"
+#include "ipv4.h"
+#include "dscp.h"
+#include "icmp.h"
+#include "icmpv6.h"
+#include "tcp.h"
+#include "dns.h"
+#include "dhcp_bootp.h"
+
+/*
+Cost of describing a protocol code, every code of every describer in turn,
+brief then verbose: the text the one line summaries and the verbose dump
+ask for on every packet.
+
+malloc & co. are interposed for the whole binary (glibc), operator new ends
+up there too.
+
+usage: bench_describe [passes]
+*/
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static bool counting = false;
+static size_t allocations = 0;
+
+extern "C" void*
+malloc(size_t size)
+{
+    if (counting) allocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void*
+calloc(size_t count, size_t size)
+{
+    if (counting) allocations++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void*
+realloc(void *ptr, size_t size)
+{
+    if (counting) allocations++;
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void
+free(void *ptr)
+{
+    __libc_free(ptr);
+}
+
+double
+now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// the length of the text, so that nothing is optimised away
+typedef size_t (*describe_t)(uint32_t code, bool verbose);
+
+typedef struct describer {
+    const char *name;
+    uint32_t codes;     // 0 .. codes - 1
+    describe_t describe;
+} describer_t;
+
+const uint16_t ethertypes[] = {ETHERTYPE_IP, ETHERTYPE_ARP, ETHERTYPE_IPV6, ETHERTYPE_VLAN, ETHERTYPE_REVARP, ETHERTYPE_PUP, 0x88cc, 0x1234};
+
+const describer_t describers[] = {
+    {"ethertype", 8, [](uint32_t code, bool verbose){ return get_ethertype_desc(ethertypes[code], verbose).size(); }},
+    {"arp_htype", 32, [](uint32_t code, bool verbose){ return get_hardware_type_desc(code, verbose).size(); }},
+    {"arp_op", 16, [](uint32_t code, bool verbose){ return get_operation_desc(code, verbose).size(); }},
+    {"ipv4_proto", 256, [](uint32_t code, bool verbose){ return ipv4_get_protocol_name(code, verbose).size(); }},
+    {"ipv4_flags", 8, [](uint32_t code, bool verbose){ return get_flags_desc(code << 13, verbose).size(); }},
+    {"dscp", 64, [](uint32_t code, bool verbose){ return get_dscp_desc(code, verbose).size(); }},
+    {"ecn", 4, [](uint32_t code, bool verbose){ return get_ecn_desc(code, verbose).size(); }},
+    {"icmp_type", 256, [](uint32_t code, bool verbose){ return get_icmp_type_desc(code, verbose).size(); }},
+    {"icmp_code", 16, [](uint32_t code, bool verbose){ return get_icmp_code_desc(ICMP_UNREACH, code, verbose).size(); }},
+    {"icmpv6_type", 256, [](uint32_t code, bool verbose){ return get_icmpv6_type_desc(code, verbose).size(); }},
+    {"icmpv6_code", 8, [](uint32_t code, bool verbose){ return get_icmpv6_code_desc(ICMP6_DST_UNREACH, code, verbose).size(); }},
+    {"tcp_flags", 256, [](uint32_t code, bool verbose){ return get_tcp_flags_desc(code, verbose).size(); }},
+    {"dns_qr", 2, [](uint32_t code, bool verbose){ return get_qr_desc(code, verbose).size(); }},
+    {"dns_opcode", 16, [](uint32_t code, bool verbose){ return get_opcode_desc(code, verbose).size(); }},
+    {"dns_rcode", 16, [](uint32_t code, bool verbose){ return get_rcode_desc(code, verbose).size(); }},
+    {"dns_rd", 2, [](uint32_t code, bool verbose){ return get_rd_desc(code, verbose).size(); }},
+    {"dns_type", 256, [](uint32_t code, bool verbose){ return get_type_desc(code, verbose).size(); }},
+    {"dns_class", 8, [](uint32_t code, bool verbose){ return get_class_desc(code, verbose).size(); }},
+    {"dhcp_msg", 8, [](uint32_t code, bool verbose){ return get_dhcp_message_type_desc(code, verbose).size(); }},
+    {"bootp_op", 4, [](uint32_t code, bool verbose){ return get_bp_op_desc(code, verbose).size(); }},
+};
+
+int
+main(int argc, char **argv)
+{
+    long passes = (argc > 1) ? atol(argv[1]) : 100000;
+
+    printf("%-12s %-8s %6s %10s %10s\n", "describer", "mode", "codes", "malloc/op", "ns/op");
+    size_t total_calls = 0;
+    size_t total_allocations = 0;
+    double total_elapsed = 0;
+    volatile size_t sink = 0;
+    for (const describer_t &describer : describers){
+        for (bool verbose : {false, true}){
+            allocations = 0;
+            counting = true;
+            double start = now_seconds();
+            for (long pass = 0; pass < passes; pass++){
+                for (uint32_t code = 0; code < describer.codes; code++){
+                    sink = sink + describer.describe(code, verbose);
+                }
+            }
+            double elapsed = now_seconds() - start;
+            counting = false;
+
+            double calls = (double)describer.codes * passes;
+            printf("%-12s %-8s %6u %10.2f %10.2f\n", describer.name, verbose ? "verbose" : "quiet",
+                   describer.codes, allocations / calls, elapsed / calls * 1e9);
+            total_calls += describer.codes * passes;
+            total_allocations += allocations;
+            total_elapsed += elapsed;
+        }
+    }
+    printf("%-12s %-8s %6s %10.2f %10.2f\n", "all", "", "", (double)total_allocations / total_calls, total_elapsed / total_calls * 1e9);
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include "pcap_file.h"
+#include "arena.h"
+#include "dissector.h"
+
+/*
+Decoding time per packet of a capture: the chain every text renderer used
+to run (all the layers, the DNS sections), against the dissector with the
+layers each consumer reads. Only the decoding is measured, not the
+rendering.
+
+usage: bench_dissector [capture] [passes]
+*/
+
+// LAYERS_TEXT_MINIMAL of cli_parser.h, what -v 1 prints: no checksum,
+// the DNS header but not its sections
+#define LAYERS_TEXT_MINIMAL (LAYERS_ALL & ~(LAYER_DNS_SECTIONS | LAYER_CHECKSUMS))
+
+typedef struct captured {
+    std::vector<uint8_t> bytes;
+} captured_t;
+
+double
+now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+std::vector<captured_t>
+load_packets(const char *path)
+{
+    std::vector<captured_t> packets;
+    char errbuf[PCAP_ERRBUF_SIZE];
+    pcap_file_t *file = pcap_file_open(path, errbuf);
+    if (file == NULL){
+        fprintf(stderr, "%s\n", errbuf);
+        exit(EXIT_FAILURE);
+    }
+    struct pcap_pkthdr *header;
+    const u_char *packet;
+    while (pcap_file_next(file, &header, &packet) == 1){
+        packets.push_back({std::vector<uint8_t>(packet, packet + header->caplen)});
+    }
+    pcap_file_close(file);
+    return packets;
+}
+
+// the decoding of the former parse_min(): every layer, in full
+void
+decode_chain(const uint8_t *packet, uint32_t length, arena_t *arena)
+{
+    packet_cursor_t cursor = packet_cursor_init(packet, length);
+    my_ethernet_header_t ethernet_header = parse_ethernet(cursor.data, cursor.remaining, false);
+    packet_cursor_skip(&cursor, sizeof(struct ether_header));
+    const uint8_t *source = NULL;
+    const uint8_t *destination = NULL;
+    uint8_t protocol = 0;
+    my_ipv4_header_t ipv4_header = {};
+    my_ipv6_header_t ipv6_header = {};
+    if (ethernet_header.type == ETHERTYPE_IP){
+        ipv4_header = parse_ipv4(cursor.data, cursor.remaining, false);
+        source = ipv4_header.raw_source_address;
+        destination = ipv4_header.raw_destination_address;
+        protocol = ipv4_header.protocol;
+        packet_cursor_limit(&cursor, ipv4_header.total_length);
+        packet_cursor_skip(&cursor, ipv4_header.header_length * 4);
+    } else if (ethernet_header.type == ETHERTYPE_IPV6){
+        ipv6_header = parse_ipv6(cursor.data, cursor.remaining, false);
+        source = ipv6_header.raw_source_address;
+        destination = ipv6_header.raw_destination_address;
+        protocol = ipv6_header.next_header;
+        packet_cursor_skip(&cursor, IPV6_HEADER_SIZE);
+        packet_cursor_limit(&cursor, ipv6_header.payload_length);
+    }
+    uint16_t port = 0;
+    if (protocol == IPPROTO_TCP){
+        my_tcp_header_t tcp_header = parse_tcp_header(cursor.data, cursor.remaining, source, destination, protocol, arena, false);
+        port = tcp_header.destination_port;
+        packet_cursor_skip(&cursor, tcp_header.data_offset * 4);
+    } else if (protocol == IPPROTO_UDP){
+        my_udp_header_t udp_header = parse_udp(cursor.data, cursor.remaining, source, destination, protocol, false);
+        port = udp_header.destination_port;
+        packet_cursor_skip(&cursor, sizeof(struct udphdr));
+    }
+    if (port == PORT_DNS){
+        my_dns_header_t dns_header = parse_dns(cursor.data, cursor.remaining, arena, false);
+        (void)dns_header;
+    }
+}
+
+void
+bench(const char *name, const std::vector<captured_t> &packets, uint32_t wanted, long passes)
+{
+    arena_t arena;
+    arena_init(&arena, 0);
+    dissection_t *dissection = new dissection_t();
+    uint64_t layers = 0;
+    double start = now_seconds();
+    for (long i = 0; i < passes; i++){
+        for (const captured_t &packet : packets){
+            arena_reset(&arena);
+            if (wanted == 0){
+                decode_chain(packet.bytes.data(), packet.bytes.size(), &arena);
+            } else {
+                dissect(packet.bytes.data(), packet.bytes.size(), wanted, &arena, false, dissection);
+                layers += dissection->depth;
+            }
+        }
+    }
+    double elapsed = now_seconds() - start;
+    double count = (double)packets.size() * passes;
+    printf("%-22s %10.1f ns/pkt %6.2f layers/pkt\n", name, elapsed / count * 1e9, layers / count);
+    delete dissection;
+    arena_destroy(&arena);
+}
+
+int
+main(int argc, char **argv)
+{
+    const char *path = (argc > 1) ? argv[1] : "dns.pcap";
+    long passes = (argc > 2) ? atol(argv[2]) : 100000;
+    std::vector<captured_t> packets = load_packets(path);
+
+    bench("chain, every layer", packets, 0, passes);
+    bench("dissect, all", packets, LAYERS_ALL, passes);
+    bench("dissect, -v 1", packets, LAYERS_TEXT_MINIMAL, passes);
+    bench("dissect, ports", packets, LAYER_BIT(LAYER_TCP) | LAYER_BIT(LAYER_UDP), passes);
+    return 0;
+}
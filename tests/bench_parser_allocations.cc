@@ -0,0 +1,191 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include "pcap_file.h"
+#include "arena.h"
+#include "ethernet.h"
+#include "ipv4.h"
+#include "ipv6.h"
+#include "udp.h"
+#include "dns.h"
+#include "dhcp_bootp.h"
+
+/*
+Heap calls made by parse_dns() and parse_bootp() for every packet of
+dns.pcap and dhcp.pcap, with the arena reset between packets the way
+parse_cli_nth() does it. The first pass grows the arena, the counted ones
+come after.
+
+malloc & co. are interposed for the whole binary (glibc), operator new ends
+up there too.
+
+usage: bench_parser_allocations [repository] [passes]
+*/
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static bool counting = false;
+static size_t allocations = 0;
+static size_t frees = 0;
+
+extern "C" void*
+malloc(size_t size)
+{
+    if (counting) allocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void*
+calloc(size_t count, size_t size)
+{
+    if (counting) allocations++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void*
+realloc(void *ptr, size_t size)
+{
+    if (counting) allocations++;
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void
+free(void *ptr)
+{
+    if (counting && ptr != NULL) frees++;
+    __libc_free(ptr);
+}
+
+double
+now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief The UDP payloads of a capture going to or from port, copied out
+ *
+ * @param path
+ * @param port
+ * @return std::vector<std::vector<uint8_t>>
+ */
+std::vector<std::vector<uint8_t>>
+load_payloads(const char *path, uint16_t port)
+{
+    std::vector<std::vector<uint8_t>> payloads;
+    char errbuf[PCAP_ERRBUF_SIZE];
+    pcap_file_t *file = pcap_file_open(path, errbuf);
+    if (file == NULL){
+        fprintf(stderr, "%s\n", errbuf);
+        exit(EXIT_FAILURE);
+    }
+
+    struct pcap_pkthdr *header;
+    const u_char *packet;
+    while (pcap_file_next(file, &header, &packet) == 1){
+        my_ethernet_view_t ethernet;
+        if (!parse_ethernet_view(packet, header->caplen, &ethernet)){
+            continue;
+        }
+        uint16_t type = ethernet.vlan_tagged ? ethernet.type_vlan : ethernet.type;
+        const uint8_t *network = packet + ethernet.header_length;
+        uint32_t length = header->caplen - ethernet.header_length;
+
+        const uint8_t *transport = NULL;
+        if (type == ETHERTYPE_IP){
+            my_ipv4_view_t ipv4;
+            if (parse_ipv4_view(network, length, &ipv4) && ipv4.protocol == IPPROTO_UDP){
+                transport = network + ipv4.header_length;
+                length -= ipv4.header_length;
+            }
+        } else if (type == ETHERTYPE_IPV6){
+            my_ipv6_view_t ipv6;
+            if (parse_ipv6_view(network, length, &ipv6) && ipv6.next_header == IPPROTO_UDP){
+                transport = network + IPV6_HEADER_SIZE;
+                length -= IPV6_HEADER_SIZE;
+            }
+        }
+
+        my_udp_view_t udp;
+        if (transport == NULL || !parse_udp_view(transport, length, &udp)){
+            continue;
+        }
+        if (udp.source_port == port || udp.destination_port == port){
+            const uint8_t *end = transport + length;
+            payloads.emplace_back(udp.payload, end);
+        }
+    }
+    pcap_file_close(file);
+    return payloads;
+}
+
+void
+decode(const std::vector<uint8_t> &payload, bool dhcp, arena_t *arena, bool verbose)
+{
+    if (dhcp){
+        my_dhcp_bootp_header_t header = parse_bootp(payload.data(), payload.size(), arena, verbose);
+        (void)header;
+    } else {
+        my_dns_header_t header = parse_dns(payload.data(), payload.size(), arena, verbose);
+        (void)header;
+    }
+}
+
+void
+bench(const char *name, const std::vector<std::vector<uint8_t>> &payloads, bool dhcp, bool verbose, long passes)
+{
+    arena_t arena;
+    arena_init(&arena, 0);
+    for (const std::vector<uint8_t> &payload : payloads){
+        arena_reset(&arena);
+        decode(payload, dhcp, &arena, verbose);
+    }
+
+    size_t arena_bytes = 0;
+    allocations = 0;
+    frees = 0;
+    double start = now_seconds();
+    counting = true;
+    for (long i = 0; i < passes; i++){
+        for (const std::vector<uint8_t> &payload : payloads){
+            arena_reset(&arena);
+            decode(payload, dhcp, &arena, verbose);
+            // a single slab once grown, used is all of the packet
+            arena_bytes += arena.used;
+        }
+    }
+    counting = false;
+    double elapsed = now_seconds() - start;
+
+    double packets = (double)payloads.size() * passes;
+    printf("%-10s %-8s %8zu %10.2f %10.2f %12.1f %10.1f\n", name, verbose ? "verbose" : "quiet",
+           payloads.size(), allocations / packets, frees / packets, arena_bytes / packets, elapsed / packets * 1e9);
+    arena_destroy(&arena);
+}
+
+int
+main(int argc, char **argv)
+{
+    const char *repository = (argc > 1) ? argv[1] : ".";
+    long passes = (argc > 2) ? atol(argv[2]) : 1000;
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/dns.pcap", repository);
+    std::vector<std::vector<uint8_t>> dns = load_payloads(path, 53);
+    snprintf(path, sizeof(path), "%s/dhcp.pcap", repository);
+    std::vector<std::vector<uint8_t>> dhcp = load_payloads(path, 67);
+
+    printf("%-10s %-8s %8s %10s %10s %12s %10s\n", "capture", "mode", "packets", "malloc/pkt", "free/pkt", "arena B/pkt", "ns/pkt");
+    for (bool verbose : {false, true}){
+        bench("dns.pcap", dns, false, verbose, passes);
+        bench("dhcp.pcap", dhcp, true, verbose, passes);
+    }
+    return 0;
+}
@@ -0,0 +1,235 @@
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "pcap_file.h"
+#include "ethernet.h"
+#include "arp.h"
+#include "ipv4.h"
+#include "ipv6.h"
+#include "icmp.h"
+#include "icmpv6.h"
+#include "tcp.h"
+#include "udp.h"
+
+/*
+Decodes every packet of dns.pcap with the view parsers and counts the heap
+allocations made while doing so, there must be none.
+
+malloc & co. are interposed for the whole binary (glibc), operator new ends
+up there too.
+*/
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static bool counting = false;
+static size_t allocations = 0;
+
+extern "C" void*
+malloc(size_t size)
+{
+    if (counting) allocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void*
+calloc(size_t count, size_t size)
+{
+    if (counting) allocations++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void*
+realloc(void *ptr, size_t size)
+{
+    if (counting) allocations++;
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void
+free(void *ptr)
+{
+    __libc_free(ptr);
+}
+
+typedef struct decode_counters {
+    size_t packets;
+    size_t ipv4;
+    size_t ipv6;
+    size_t arp;
+    size_t tcp;
+    size_t udp;
+    size_t icmp;
+    size_t dns;
+} decode_counters_t;
+
+void
+decode_transport(const uint8_t *packet, uint32_t length, uint8_t protocol, decode_counters_t *counters)
+{
+    switch (protocol){
+        case IPPROTO_TCP: {
+            my_tcp_view_t tcp;
+            if (parse_tcp_view(packet, length, &tcp)){
+                counters->tcp++;
+            }
+            break;
+        }
+        case IPPROTO_UDP: {
+            my_udp_view_t udp;
+            if (parse_udp_view(packet, length, &udp)){
+                counters->udp++;
+                if (udp.source_port == 53 || udp.destination_port == 53){
+                    counters->dns++;
+                }
+            }
+            break;
+        }
+        case IPPROTO_ICMP: {
+            my_icmp_view_t icmp;
+            if (parse_icmp_view(packet, length, &icmp)){
+                counters->icmp++;
+            }
+            break;
+        }
+        case IPPROTO_ICMPV6: {
+            my_icmpv6_view_t icmpv6;
+            if (parse_icmpv6_view(packet, length, &icmpv6)){
+                counters->icmp++;
+            }
+            break;
+        }
+    }
+}
+
+void
+decode(const uint8_t *packet, uint32_t length, decode_counters_t *counters)
+{
+    my_ethernet_view_t ethernet;
+    assert(parse_ethernet_view(packet, length, &ethernet));
+    counters->packets++;
+
+    uint16_t type = ethernet.vlan_tagged ? ethernet.type_vlan : ethernet.type;
+    const uint8_t *payload = packet + ethernet.header_length;
+    uint32_t payload_length = length - ethernet.header_length;
+
+    if (type == ETHERTYPE_IP){
+        my_ipv4_view_t ipv4;
+        if (parse_ipv4_view(payload, payload_length, &ipv4)){
+            counters->ipv4++;
+            decode_transport(payload + ipv4.header_length, payload_length - ipv4.header_length, ipv4.protocol, counters);
+        }
+    } else if (type == ETHERTYPE_IPV6){
+        my_ipv6_view_t ipv6;
+        if (parse_ipv6_view(payload, payload_length, &ipv6)){
+            counters->ipv6++;
+            decode_transport(payload + IPV6_HEADER_SIZE, payload_length - IPV6_HEADER_SIZE, ipv6.next_header, counters);
+        }
+    } else if (type == ETHERTYPE_ARP){
+        my_arp_view_t arp;
+        if (parse_arp_view(payload, payload_length, &arp)){
+            counters->arp++;
+        }
+    }
+}
+
+void
+test_counting_works()
+{
+    counting = true;
+    void * volatile ptr = malloc(16);
+    counting = false;
+    assert(allocations == 1);
+    free(ptr);
+    allocations = 0;
+}
+
+void
+test_view_allocations(const char *path)
+{
+    char errbuf[PCAP_ERRBUF_SIZE];
+    pcap_file_t *file = pcap_file_open(path, errbuf);
+    assert(file != NULL);
+
+    decode_counters_t counters = {};
+    struct pcap_pkthdr *header;
+    const u_char *packet;
+
+    counting = true;
+    while (pcap_file_next(file, &header, &packet) == 1){
+        decode(packet, header->caplen, &counters);
+    }
+    counting = false;
+    pcap_file_close(file);
+
+    assert(allocations == 0 && "The view parsers must not allocate");
+    assert(counters.packets == 183);
+    assert(counters.ipv4 + counters.ipv6 > 0);
+    assert(counters.dns > 0);
+}
+
+void
+test_view_fields()
+{
+    // ethernet + ipv4 + udp, 192.168.1.1:1024 -> 8.8.8.8:53
+    uint8_t packet[] = {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0x08, 0x00,
+        0x45, 0x00, 0x00, 0x1c, 0x12, 0x34, 0x40, 0x00, 0x40, 0x11, 0x00, 0x00,
+        0xc0, 0xa8, 0x01, 0x01, 0x08, 0x08, 0x08, 0x08,
+        0x04, 0x00, 0x00, 0x35, 0x00, 0x08, 0x00, 0x00
+    };
+    // fill in the ipv4 checksum
+    uint16_t sum = calculate_checksum((uint16_t*)(packet + 14), 20);
+    memcpy(packet + 24, &sum, 2);
+
+    my_ethernet_view_t ethernet;
+    assert(parse_ethernet_view(packet, sizeof(packet), &ethernet));
+    assert(ethernet.type == ETHERTYPE_IP);
+    assert(ethernet.header_length == 14);
+    assert(ethernet.src_mac[0] == 0x66);
+
+    my_ipv4_view_t ipv4;
+    assert(parse_ipv4_view(packet + 14, sizeof(packet) - 14, &ipv4));
+    assert(ipv4.version == 4);
+    assert(ipv4.header_length == 20);
+    assert(ipv4.identification == 0x1234);
+    assert(ipv4.ip_off & IP_DF);
+    assert(ipv4.protocol == IPPROTO_UDP);
+    assert(ipv4_view_checksum_correct(packet + 14, &ipv4));
+    assert(ipv4.source_address[0] == 192 && ipv4.destination_address[3] == 8);
+
+    my_udp_view_t udp;
+    assert(parse_udp_view(packet + 34, sizeof(packet) - 34, &udp));
+    assert(udp.source_port == 1024);
+    assert(udp.destination_port == 53);
+    assert(udp.length == 8);
+
+    // truncated headers are refused
+    assert(!parse_ethernet_view(packet, 10, &ethernet));
+    assert(!parse_ipv4_view(packet + 14, 19, &ipv4));
+    assert(!parse_udp_view(packet + 34, 7, &udp));
+    my_tcp_view_t tcp;
+    assert(!parse_tcp_view(packet + 34, 8, &tcp));
+
+    // a broken checksum is reported, the packet is left alone
+    packet[22] = 0x01;
+    assert(parse_ipv4_view(packet + 14, sizeof(packet) - 14, &ipv4));
+    assert(!ipv4_view_checksum_correct(packet + 14, &ipv4));
+    assert(packet[22] == 0x01);
+}
+
+int
+main(int argc, char **argv)
+{
+    // directory of the bundled captures, given by ctest
+    const char *captures_dir = argc > 1 ? argv[1] : ".";
+    char path[512];
+    snprintf(path, sizeof(path), "%s/dns.pcap", captures_dir);
+
+    test_counting_works();
+    test_view_fields();
+    test_view_allocations(path);
+    return 0;
+}
@@ -0,0 +1,259 @@
+#include "addr_format.h"
+#include <string.h>
+
+// "00" .. "ff"
+typedef struct hex_pairs {
+    char pairs[256][2];
+} hex_pairs_t;
+
+// "0" .. "255", the length in the last byte
+typedef struct decimal_octets {
+    char octets[256][4];
+} decimal_octets_t;
+
+constexpr char hex_digits[] = "0123456789abcdef";
+
+constexpr hex_pairs_t
+make_hex_pairs()
+{
+    hex_pairs_t table{};
+    for (int i = 0; i < 256; i++){
+        table.pairs[i][0] = hex_digits[i >> 4];
+        table.pairs[i][1] = hex_digits[i & 0xf];
+    }
+    return table;
+}
+
+constexpr decimal_octets_t
+make_decimal_octets()
+{
+    decimal_octets_t table{};
+    for (int i = 0; i < 256; i++){
+        char *octet = table.octets[i];
+        int length = 0;
+        if (i >= 100){
+            octet[length++] = '0' + i / 100;
+        }
+        if (i >= 10){
+            octet[length++] = '0' + (i / 10) % 10;
+        }
+        octet[length++] = '0' + i % 10;
+        octet[3] = length;
+    }
+    return table;
+}
+
+constexpr hex_pairs_t hex_table = make_hex_pairs();
+constexpr decimal_octets_t decimal_table = make_decimal_octets();
+
+/**
+ * @brief Format a MAC address, "00:11:22:33:44:55"
+ *
+ * @param mac 6 bytes
+ * @param buffer at least MAC_ADDRESS_STRLEN bytes
+ * @return size_t the length
+ */
+size_t
+format_mac_address(const uint8_t *mac, char *buffer)
+{
+    char *text = buffer;
+    for (int i = 0; i < 6; i++){
+        memcpy(text, hex_table.pairs[mac[i]], 2);
+        text[2] = ':';
+        text += 3;
+    }
+    // the last ':' becomes the end
+    text[-1] = '\0';
+    return MAC_ADDRESS_STRLEN - 1;
+}
+
+/**
+ * @brief Format an IPv4 address in dotted decimal, "192.168.0.1"
+ *
+ * @param address 4 bytes, network order
+ * @param buffer at least IPV4_ADDRESS_STRLEN bytes
+ * @return size_t the length
+ */
+size_t
+format_ipv4_address(const uint8_t *address, char *buffer)
+{
+    char *text = buffer;
+    for (int i = 0; i < 4; i++){
+        const char *octet = decimal_table.octets[address[i]];
+        // the 4 bytes at once, the length in the last one is overwritten by the '.'
+        memcpy(text, octet, 4);
+        text += octet[3];
+        *text++ = '.';
+    }
+    text[-1] = '\0';
+    return text - 1 - buffer;
+}
+
+/**
+ * @brief Format a group of an IPv6 address, without its leading zeros
+ *
+ * @param word
+ * @param text
+ * @return char* after the digits
+ */
+static inline char*
+format_ipv6_word(uint16_t word, char *text)
+{
+    char digits[4];
+    memcpy(digits, hex_table.pairs[word >> 8], 2);
+    memcpy(digits + 2, hex_table.pairs[word & 0xff], 2);
+    int length = (word >= 0x1000) ? 4 : (word >= 0x100) ? 3 : (word >= 0x10) ? 2 : 1;
+    memcpy(text, digits + 4 - length, length);
+    return text + length;
+}
+
+/**
+ * @brief Format an IPv6 address the way inet_ntop() does (RFC 5952),
+ * "2001:db8::1", "::ffff:192.168.0.1"
+ *
+ * @param address 16 bytes, network order
+ * @param buffer at least IPV6_ADDRESS_STRLEN bytes
+ * @return size_t the length
+ */
+size_t
+format_ipv6_address(const uint8_t *address, char *buffer)
+{
+    uint16_t words[8];
+    for (int i = 0; i < 8; i++){
+        words[i] = (address[2 * i] << 8) | address[2 * i + 1];
+    }
+
+    // the longest run of zero groups, the first one on a tie
+    int best_base = -1;
+    int best_length = 0;
+    int base = -1;
+    for (int i = 0; i <= 8; i++){
+        if (i < 8 && words[i] == 0){
+            if (base == -1){
+                base = i;
+            }
+        } else if (base != -1){
+            if (i - base > best_length){
+                best_base = base;
+                best_length = i - base;
+            }
+            base = -1;
+        }
+    }
+    // a single zero group stays "0"
+    if (best_length < 2){
+        best_base = -1;
+    }
+
+    char *text = buffer;
+    for (int i = 0; i < 8; i++){
+        if (best_base != -1 && i >= best_base && i < best_base + best_length){
+            if (i == best_base){
+                *text++ = ':';
+            }
+            continue;
+        }
+        if (i != 0){
+            *text++ = ':';
+        }
+        // IPv4 compatible (::a.b.c.d) or mapped (::ffff:a.b.c.d)
+        if (i == 6 && best_base == 0 && (best_length == 6 || (best_length == 5 && words[5] == 0xffff))){
+            text += format_ipv4_address(address + 12, text);
+            return text - buffer;
+        }
+        text = format_ipv6_word(words[i], text);
+    }
+    if (best_base != -1 && best_base + best_length == 8){
+        *text++ = ':';
+    }
+    *text = '\0';
+    return text - buffer;
+}
+
+typedef struct addr_format_slot {
+    uint8_t address[16];
+    char text[IPV6_ADDRESS_STRLEN];
+    uint8_t length;   // 0 for an empty slot
+    uint8_t unused;
+} addr_format_slot_t;
+
+typedef size_t (*format_t)(const uint8_t *address, char *buffer);
+
+/**
+ * @brief Format through the thread's cache of addresses of one kind.
+ * The sizes are constants: the compiler turns the copies and the
+ * comparison into a few moves
+ *
+ * @tparam Size bytes of the address, 16 at most
+ * @tparam TextSize the size of the caller's buffer
+ * @tparam Format to fill a slot
+ * @param cache ADDR_FORMAT_CACHE_SLOTS slots
+ * @param address
+ * @param buffer
+ * @return size_t the length
+ */
+template <size_t Size, size_t TextSize, format_t Format>
+static inline size_t
+format_cached(addr_format_slot_t *cache, const uint8_t *address, char *buffer)
+{
+    // the bytes folded and mixed, the top bits pick the slot
+    uint64_t low = 0;
+    uint64_t high = 0;
+    memcpy(&low, address, (Size < 8) ? Size : 8);
+    if (Size > 8){
+        memcpy(&high, address + 8, Size - 8);
+    }
+    uint64_t hash = (low ^ (high * 0x9e3779b97f4a7c15ULL)) * 0x9e3779b97f4a7c15ULL;
+    addr_format_slot_t *slot = &cache[hash >> (64 - __builtin_ctz(ADDR_FORMAT_CACHE_SLOTS))];
+
+    if (slot->length == 0 || memcmp(slot->address, address, Size) != 0){
+        memcpy(slot->address, address, Size);
+        slot->length = Format(address, slot->text);
+    }
+    // the whole buffer, cheaper than a copy of a variable length
+    memcpy(buffer, slot->text, TextSize);
+    return slot->length;
+}
+
+static thread_local addr_format_slot_t mac_cache[ADDR_FORMAT_CACHE_SLOTS];
+static thread_local addr_format_slot_t ipv4_cache[ADDR_FORMAT_CACHE_SLOTS];
+static thread_local addr_format_slot_t ipv6_cache[ADDR_FORMAT_CACHE_SLOTS];
+
+/**
+ * @brief format_mac_address() through the thread's cache
+ *
+ * @param mac
+ * @param buffer
+ * @return size_t
+ */
+size_t
+format_mac_address_cached(const uint8_t *mac, char *buffer)
+{
+    return format_cached<6, MAC_ADDRESS_STRLEN, format_mac_address>(mac_cache, mac, buffer);
+}
+
+/**
+ * @brief format_ipv4_address() through the thread's cache
+ *
+ * @param address
+ * @param buffer
+ * @return size_t
+ */
+size_t
+format_ipv4_address_cached(const uint8_t *address, char *buffer)
+{
+    return format_cached<4, IPV4_ADDRESS_STRLEN, format_ipv4_address>(ipv4_cache, address, buffer);
+}
+
+/**
+ * @brief format_ipv6_address() through the thread's cache
+ *
+ * @param address
+ * @param buffer
+ * @return size_t
+ */
+size_t
+format_ipv6_address_cached(const uint8_t *address, char *buffer)
+{
+    return format_cached<16, IPV6_ADDRESS_STRLEN, format_ipv6_address>(ipv6_cache, address, buffer);
+}
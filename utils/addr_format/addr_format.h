@@ -0,0 +1,54 @@
+#ifndef ADDR_FORMAT_H
+#define ADDR_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+MAC, IPv4 and IPv6 addresses to text, written into a buffer of the caller.
+
+    char text[MAC_ADDRESS_STRLEN];
+    format_mac_address(ethernet->ether_shost, text);    // "00:11:22:33:44:55"
+
+The digits come from tables built at compile time: a MAC is six two
+character copies, an IPv4 four lookups of "0" .. "255", nothing goes through
+printf(), a stream or the locale. The IPv6 text is the one of inet_ntop():
+lowercase, the longest run of zero groups (at least two) as "::", the IPv4
+mapped and compatible addresses ending in dotted decimal.
+
+The _cached versions first look the address up among the ones the thread
+formatted recently, a direct mapped cache per thread and per address kind:
+
+    +------------------+--------------------------------+--------+
+    | address (16 B)   | text                           | length |  x 64
+    +------------------+--------------------------------+--------+
+
+A capture goes back to the same hosts all the time, a hit copies the text
+instead of rebuilding it, which pays off for IPv6.
+
+All the functions write the terminating '\0' and return the length without it.
+*/
+
+#define MAC_ADDRESS_STRLEN 18   // "00:11:22:33:44:55" and '\0'
+#define IPV4_ADDRESS_STRLEN 16  // as INET_ADDRSTRLEN
+#define IPV6_ADDRESS_STRLEN 46  // as INET6_ADDRSTRLEN
+
+#define ADDR_FORMAT_CACHE_SLOTS 64 // per thread and per address kind, a power of 2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+size_t format_mac_address(const uint8_t *mac, char *buffer);
+size_t format_ipv4_address(const uint8_t *address, char *buffer);
+size_t format_ipv6_address(const uint8_t *address, char *buffer);
+
+size_t format_mac_address_cached(const uint8_t *mac, char *buffer);
+size_t format_ipv4_address_cached(const uint8_t *address, char *buffer);
+size_t format_ipv6_address_cached(const uint8_t *address, char *buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
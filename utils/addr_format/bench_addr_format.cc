@@ -0,0 +1,105 @@
+#include <arpa/inet.h>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "addr_format.h"
+
+/*
+Cost of an address to text, the way the parsers did it (ostringstream for
+a MAC, inet_ntop() then a std::string for an IP) against the tables, direct
+and through the per-thread cache.
+
+The addresses come from a pool cycled through, 16 hosts like a small
+capture, or 4096 where the cache mostly misses.
+
+usage: bench_addr_format [iterations]
+*/
+
+double
+now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// the baseline, what write_mac_address() did
+std::string
+stream_mac_address(const uint8_t *mac)
+{
+    std::ostringstream oss;
+    for (int i = 0; i < 6; i++){
+        if (i != 0)
+            oss << ":";
+        oss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(mac[i]);
+    }
+    return oss.str();
+}
+
+typedef struct kind {
+    const char *name;
+    size_t size;
+    int family;     // for inet_ntop(), AF_UNSPEC for a MAC
+    size_t (*format)(const uint8_t *address, char *buffer);
+    size_t (*format_cached)(const uint8_t *address, char *buffer);
+} kind_t;
+
+const kind_t kinds[] = {
+    {"mac", 6, AF_UNSPEC, format_mac_address, format_mac_address_cached},
+    {"ipv4", 4, AF_INET, format_ipv4_address, format_ipv4_address_cached},
+    {"ipv6", 16, AF_INET6, format_ipv6_address, format_ipv6_address_cached},
+};
+
+int
+main(int argc, char **argv)
+{
+    long iterations = (argc > 1) ? atol(argv[1]) : 1000000;
+
+    printf("%-6s %6s %12s %12s %12s %8s\n", "kind", "hosts", "baseline", "tables", "cached", "speedup");
+    volatile size_t sink = 0;
+    for (const kind_t &kind : kinds){
+        for (size_t hosts : {16, 4096}){
+            // mostly small values with zero groups, like real addresses
+            std::vector<uint8_t> pool(hosts * kind.size);
+            for (size_t i = 0; i < pool.size(); i++){
+                pool[i] = (rand() % 3 == 0) ? 0 : rand() & 0xff;
+            }
+
+            double start = now_seconds();
+            for (long i = 0; i < iterations; i++){
+                const uint8_t *address = &pool[(i % hosts) * kind.size];
+                std::string text;
+                if (kind.family == AF_UNSPEC){
+                    text = stream_mac_address(address);
+                } else {
+                    char buffer[INET6_ADDRSTRLEN];
+                    inet_ntop(kind.family, address, buffer, sizeof(buffer));
+                    text = buffer;
+                }
+                sink = sink + text.size();
+            }
+            double baseline = (now_seconds() - start) / iterations * 1e9;
+
+            char buffer[IPV6_ADDRESS_STRLEN];
+            start = now_seconds();
+            for (long i = 0; i < iterations; i++){
+                sink = sink + kind.format(&pool[(i % hosts) * kind.size], buffer);
+            }
+            double tables = (now_seconds() - start) / iterations * 1e9;
+
+            start = now_seconds();
+            for (long i = 0; i < iterations; i++){
+                sink = sink + kind.format_cached(&pool[(i % hosts) * kind.size], buffer);
+            }
+            double cached = (now_seconds() - start) / iterations * 1e9;
+
+            double best = (tables < cached) ? tables : cached;
+            printf("%-6s %6zu %9.1f ns %9.1f ns %9.1f ns %7.1fx\n", kind.name, hosts, baseline, tables, cached, baseline / best);
+        }
+    }
+    return 0;
+}
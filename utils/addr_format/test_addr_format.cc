@@ -0,0 +1,122 @@
+#include "addr_format.h"
+#include <arpa/inet.h>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+void
+test_format_mac_address()
+{
+    uint8_t mac[6] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55};
+    char text[MAC_ADDRESS_STRLEN];
+    assert(format_mac_address(mac, text) == 17);
+    assert(strcmp(text, "00:11:22:33:44:55") == 0);
+
+    uint8_t broadcast[6] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+    format_mac_address(broadcast, text);
+    assert(strcmp(text, "ff:ff:ff:ff:ff:ff") == 0);
+}
+
+void
+test_format_ipv4_address()
+{
+    uint8_t address[4] = {192, 168, 0, 1};
+    char text[IPV4_ADDRESS_STRLEN];
+    assert(format_ipv4_address(address, text) == 11);
+    assert(strcmp(text, "192.168.0.1") == 0);
+
+    // every octet, against inet_ntop()
+    char expected[INET_ADDRSTRLEN];
+    for (int i = 0; i < 256; i++){
+        uint8_t octets[4] = {(uint8_t)i, (uint8_t)(255 - i), 0, (uint8_t)(i * 7)};
+        inet_ntop(AF_INET, octets, expected, sizeof(expected));
+        assert(format_ipv4_address(octets, text) == strlen(expected));
+        assert(strcmp(text, expected) == 0);
+    }
+}
+
+void
+check_ipv6(const uint8_t *address)
+{
+    char text[IPV6_ADDRESS_STRLEN];
+    char expected[INET6_ADDRSTRLEN];
+    inet_ntop(AF_INET6, address, expected, sizeof(expected));
+    size_t length = format_ipv6_address(address, text);
+    if (strcmp(text, expected) != 0){
+        fprintf(stderr, "%s instead of %s\n", text, expected);
+    }
+    assert(strcmp(text, expected) == 0);
+    assert(length == strlen(expected));
+}
+
+void
+test_format_ipv6_address()
+{
+    uint8_t address[16] = {0x20, 0x01, 0x0d, 0xb8, 0x85, 0xa3, 0, 0, 0, 0, 0x8a, 0x2e, 0x03, 0x70, 0x73, 0x34};
+    char text[IPV6_ADDRESS_STRLEN];
+    format_ipv6_address(address, text);
+    assert(strcmp(text, "2001:db8:85a3::8a2e:370:7334") == 0);
+
+    // ::, ::1, a single zero group, the mapped and compatible IPv4
+    uint8_t special[][16] = {
+        {0},
+        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+        {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1},
+        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 192, 168, 0, 1},
+        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 10, 0, 0, 1},
+        {0xfe, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    };
+    for (const uint8_t *address : special){
+        check_ipv6(address);
+    }
+
+    // groups zero half of the time, for runs of every length and position
+    srand(42);
+    for (int i = 0; i < 100000; i++){
+        uint8_t random[16];
+        for (int group = 0; group < 8; group++){
+            bool zero = rand() & 1;
+            random[2 * group] = zero ? 0 : rand() & ((rand() & 1) ? 0xff : 0x0f);
+            random[2 * group + 1] = zero ? 0 : rand() & 0xff;
+        }
+        check_ipv6(random);
+    }
+}
+
+void
+test_cached()
+{
+    char text[IPV6_ADDRESS_STRLEN];
+    char expected[IPV6_ADDRESS_STRLEN];
+
+    // far more addresses than slots: the evicted ones come back right
+    for (int pass = 0; pass < 3; pass++){
+        for (int i = 0; i < 1000; i++){
+            uint8_t address[16] = {0x20, 0x01, 0x0d, 0xb8};
+            address[14] = i >> 8;
+            address[15] = i & 0xff;
+            format_ipv6_address(address, expected);
+            assert(format_ipv6_address_cached(address, text) == strlen(expected));
+            assert(strcmp(text, expected) == 0);
+
+            // the same bytes as a MAC or IPv4 don't share the slots
+            format_ipv4_address(address + 12, expected);
+            format_ipv4_address_cached(address + 12, text);
+            assert(strcmp(text, expected) == 0);
+            format_mac_address(address + 10, expected);
+            format_mac_address_cached(address + 10, text);
+            assert(strcmp(text, expected) == 0);
+        }
+    }
+}
+
+int
+main()
+{
+    test_format_mac_address();
+    test_format_ipv4_address();
+    test_format_ipv6_address();
+    test_cached();
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include "arena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the data of a chunk starts aligned, right after its header
+#define ARENA_CHUNK_HEADER ((sizeof(arena_chunk_t) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+static inline uint8_t*
+chunk_data(arena_chunk_t *chunk)
+{
+    return (uint8_t*)chunk + ARENA_CHUNK_HEADER;
+}
+
+static arena_chunk_t*
+arena_new_chunk(arena_t *arena, size_t capacity)
+{
+    arena_chunk_t *chunk = malloc(ARENA_CHUNK_HEADER + capacity);
+    if (chunk == NULL){
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    chunk->next = NULL;
+    chunk->capacity = capacity;
+    arena->malloc_count++;
+    return chunk;
+}
+
+/**
+ * @brief Set up an arena with one slab
+ *
+ * @param arena
+ * @param capacity size of the slab, ARENA_CAPACITY if 0
+ */
+void
+arena_init(arena_t *arena, size_t capacity)
+{
+    arena->malloc_count = 0;
+    arena->chunks = arena_new_chunk(arena, capacity > 0 ? capacity : ARENA_CAPACITY);
+    arena->current = arena->chunks;
+    arena->used = 0;
+}
+
+/**
+ * @brief Free the slab and the chunks, everything taken from the arena
+ * is gone
+ *
+ * @param arena
+ */
+void
+arena_destroy(arena_t *arena)
+{
+    arena_chunk_t *chunk = arena->chunks;
+    while (chunk != NULL){
+        arena_chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->chunks = NULL;
+    arena->current = NULL;
+    arena->used = 0;
+}
+
+/**
+ * @brief Give back everything taken since the last reset. Chunks added
+ * on the way are merged into a single slab, the next packet this large
+ * fits without them
+ *
+ * @param arena
+ */
+void
+arena_reset(arena_t *arena)
+{
+    if (arena->chunks->next != NULL){
+        size_t capacity = 0;
+        arena_chunk_t *chunk = arena->chunks;
+        while (chunk != NULL){
+            arena_chunk_t *next = chunk->next;
+            capacity += chunk->capacity;
+            free(chunk);
+            chunk = next;
+        }
+        arena->chunks = arena_new_chunk(arena, capacity);
+    }
+    arena->current = arena->chunks;
+    arena->used = 0;
+}
+
+/**
+ * @brief Take size bytes starting at a multiple of alignment, from
+ * a new chunk if the current one is full
+ *
+ * @param arena
+ * @param size
+ * @param alignment a power of 2, at most ARENA_ALIGNMENT
+ * @return void*
+ */
+static void*
+arena_take(arena_t *arena, size_t size, size_t alignment)
+{
+    size_t start = (arena->used + alignment - 1) & ~(alignment - 1);
+    if (start + size > arena->current->capacity){
+        size_t capacity = arena->current->capacity * 2;
+        while (capacity < size){
+            capacity *= 2;
+        }
+        arena_chunk_t *chunk = arena_new_chunk(arena, capacity);
+        arena->current->next = chunk;
+        arena->current = chunk;
+        start = 0;
+    }
+    arena->used = start + size;
+    return chunk_data(arena->current) + start;
+}
+
+/**
+ * @brief Take size bytes, aligned for any type. Not zeroed
+ *
+ * @param arena
+ * @param size
+ * @return void* valid until the next arena_reset()
+ */
+void*
+arena_alloc(arena_t *arena, size_t size)
+{
+    return arena_take(arena, size, ARENA_ALIGNMENT);
+}
+
+/**
+ * @brief Copy length bytes of string, and a '\0'
+ *
+ * @param arena
+ * @param string doesn't need to be terminated
+ * @param length
+ * @return char*
+ */
+char*
+arena_strndup(arena_t *arena, const char *string, size_t length)
+{
+    char *copy = arena_take(arena, length + 1, 1);
+    memcpy(copy, string, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+/**
+ * @brief printf() into the arena
+ *
+ * @param arena
+ * @param format
+ * @param ...
+ * @return char*
+ */
+char*
+arena_sprintf(arena_t *arena, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    char *string = arena_vsprintf(arena, format, args);
+    va_end(args);
+    return string;
+}
+
+char*
+arena_vsprintf(arena_t *arena, const char *format, va_list args)
+{
+    // straight into the free space, formatted twice only if it doesn't fit
+    va_list again;
+    va_copy(again, args);
+    char *start = (char*)chunk_data(arena->current) + arena->used;
+    size_t left = arena->current->capacity - arena->used;
+    int length = vsnprintf(start, left, format, args);
+    if (length < 0){
+        va_end(again);
+        return arena_strndup(arena, "", 0);
+    }
+    if ((size_t)length < left){
+        arena->used += length + 1;
+        va_end(again);
+        return start;
+    }
+    char *string = arena_take(arena, length + 1, 1);
+    vsnprintf(string, length + 1, format, again);
+    va_end(again);
+    return string;
+}
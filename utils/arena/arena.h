@@ -0,0 +1,60 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Bump allocator for the memory of one packet's decoding.
+
+The parsers take their records, strings and copies out of the arena instead
+of malloc(): an allocation moves a pointer forward and nothing is freed one
+by one. The owner resets the arena before the next packet, which gives
+everything back at once.
+
+    +------+--------+-----+-----------+---------------------------+
+    | slab | record | str | rdata ... |            free           |
+    +------+--------+-----+-----------+---------------------------+
+                                      ^ used
+
+A packet needing more than the slab gets extra chunks from malloc(), on the
+next reset they are merged into one slab large enough for that packet: after
+the first few packets of a capture the decoding doesn't allocate at all.
+
+Only for plain data, there is no destructor to run: a std::string in the
+arena would leak its heap buffer.
+*/
+
+#define ARENA_CAPACITY (1 << 16) // 64 KiB, many packets' worth
+#define ARENA_ALIGNMENT 16
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct arena_chunk {
+    struct arena_chunk *next;
+    size_t capacity;           // bytes after the header
+} arena_chunk_t;
+
+typedef struct arena {
+    arena_chunk_t *chunks;     // the slab, then the chunks added since the last reset
+    arena_chunk_t *current;    // the last one, allocations come from there
+    size_t used;               // bytes taken in current
+    uint64_t malloc_count;     // chunks taken from malloc(), the slab included
+} arena_t;
+
+void arena_init(arena_t *arena, size_t capacity);
+void arena_destroy(arena_t *arena);
+void arena_reset(arena_t *arena);
+void* arena_alloc(arena_t *arena, size_t size);
+char* arena_strndup(arena_t *arena, const char *string, size_t length);
+char* arena_sprintf(arena_t *arena, const char *format, ...) __attribute__((format(printf, 2, 3)));
+char* arena_vsprintf(arena_t *arena, const char *format, va_list args);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
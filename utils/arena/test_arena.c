@@ -0,0 +1,97 @@
+#include "arena.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+void
+test_alloc()
+{
+    arena_t arena;
+    arena_init(&arena, 1024);
+    assert(arena.malloc_count == 1);
+
+    uint8_t *a = arena_alloc(&arena, 3);
+    uint8_t *b = arena_alloc(&arena, 40);
+    uint64_t *c = arena_alloc(&arena, sizeof(uint64_t));
+    assert((uintptr_t)a % ARENA_ALIGNMENT == 0);
+    assert((uintptr_t)b % ARENA_ALIGNMENT == 0);
+    assert((uintptr_t)c % ARENA_ALIGNMENT == 0);
+    assert(b >= a + 3 && (uint8_t*)c >= b + 40);
+    memset(a, 0xaa, 3);
+    memset(b, 0xbb, 40);
+    *c = 42;
+    assert(a[2] == 0xaa && b[0] == 0xbb && b[39] == 0xbb && *c == 42);
+
+    // the same memory again after a reset
+    arena_reset(&arena);
+    assert(arena_alloc(&arena, 3) == a);
+    assert(arena.malloc_count == 1);
+    arena_destroy(&arena);
+}
+
+void
+test_grow_and_merge()
+{
+    arena_t arena;
+    arena_init(&arena, 256);
+
+    // a packet larger than the slab
+    for (int i = 0; i < 10; i++){
+        uint8_t *block = arena_alloc(&arena, 100);
+        memset(block, i, 100);
+    }
+    uint8_t *large = arena_alloc(&arena, 5000);
+    memset(large, 0xff, 5000);
+    assert(arena.malloc_count > 1);
+    assert(arena.chunks->next != NULL);
+
+    // merged into one slab, the same packet doesn't allocate anymore
+    arena_reset(&arena);
+    assert(arena.chunks->next == NULL);
+    uint64_t mallocs = arena.malloc_count;
+    for (int round = 0; round < 3; round++){
+        for (int i = 0; i < 10; i++){
+            arena_alloc(&arena, 100);
+        }
+        arena_alloc(&arena, 5000);
+        arena_reset(&arena);
+    }
+    assert(arena.malloc_count == mallocs);
+    arena_destroy(&arena);
+}
+
+void
+test_strings()
+{
+    arena_t arena;
+    arena_init(&arena, 64);
+
+    const char label[] = {'w', 'w', 'w', '.'};
+    char *copy = arena_strndup(&arena, label, 3);
+    assert(strcmp(copy, "www") == 0);
+
+    char *formatted = arena_sprintf(&arena, "%s (%d)", "Router", 3);
+    assert(strcmp(formatted, "Router (3)") == 0);
+    // no alignment for the strings, they follow each other
+    assert(formatted == copy + 4);
+
+    // doesn't fit in what is left of the slab
+    char *long_one = arena_sprintf(&arena, "%0100d", 7);
+    assert(strlen(long_one) == 100 && long_one[99] == '7');
+    assert(strcmp(copy, "www") == 0);
+    assert(strcmp(formatted, "Router (3)") == 0);
+
+    char *empty = arena_strndup(&arena, "", 0);
+    assert(empty[0] == '\0');
+    arena_destroy(&arena);
+}
+
+int
+main()
+{
+    test_alloc();
+    test_grow_and_merge();
+    test_strings();
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include "check_sum.h"
+
+/*
+Throughput of every checksum implementation usable on this CPU,
+against the one word per iteration reference.
+
+usage: bench_check_sum [iterations]
+*/
+
+double
+now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+uint32_t
+scalar_words(const uint8_t *data, size_t length)
+{
+    return calculate_checksum_scalar((uint16_t*)data, length);
+}
+
+int
+main(int argc, char **argv)
+{
+    long iterations = (argc > 1) ? atol(argv[1]) : 1000000;
+    const size_t sizes[] = {64, 128, 256, 512, 1024, 1500, 4096, 9000};
+
+    uint8_t *buffer = (uint8_t*)malloc(9000);
+    for (int i = 0; i < 9000; i++){
+        buffer[i] = rand() & 0xff;
+    }
+
+    size_t count;
+    const checksum_implementation_t *implementations = checksum_implementations(&count);
+    printf("picked: %s\n", checksum_implementation()->name);
+    printf("%-8s", "bytes");
+    printf(" %14s", "scalar");
+    for (size_t i = 0; i < count; i++){
+        printf(" %14s", implementations[i].name);
+    }
+    printf("   (ns per packet)\n");
+
+    volatile uint32_t sink = 0;
+    for (size_t size : sizes){
+        printf("%-8zu", size);
+        for (size_t i = 0; i <= count; i++){
+            uint32_t (*sum)(const uint8_t*, size_t) = (i == 0) ? scalar_words : implementations[i - 1].sum;
+            double start = now_seconds();
+            for (long j = 0; j < iterations; j++){
+                sink = sink + sum(buffer, size);
+            }
+            double elapsed = now_seconds() - start;
+            printf(" %8.1f %5.1fG", elapsed / iterations * 1e9, size * iterations / elapsed / 1e9);
+        }
+        printf("\n");
+    }
+    free(buffer);
+    return 0;
+}
\ No newline at end of file
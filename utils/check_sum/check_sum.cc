@@ -1,4 +1,13 @@
 #include "check_sum.h"
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define CHECKSUM_X86
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define CHECKSUM_NEON
+#endif
 
 /**
  * @brief Calculate the checksum of an IPv4 packet
@@ -10,6 +19,35 @@
  */
 uint32_t 
 calculate_checksum(uint16_t *packet, int count)
+{
+    uint32_t sum = 0;
+    if (count > 1) {
+        sum = checksum_words((const uint8_t*)packet, count & ~1);
+    }
+
+    // Add left-over byte, if any
+    if (count & 1) {
+        sum += ((const uint8_t *)packet)[count - 1];
+    }
+
+    // Fold 32-bit sum to 16 bits
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+
+    return ~sum;
+}
+
+/**
+ * @brief The one word per iteration version, kept as the reference
+ * the others are checked against
+ * 
+ * @param packet 
+ * @param count 
+ * @return uint32_t 
+ */
+uint32_t 
+calculate_checksum_scalar(uint16_t *packet, int count)
 {
     // https://www.rfc-editor.org/rfc/rfc1071
     // Algorithm found on [Page 6] 4.1 "C"
@@ -31,3 +69,371 @@ calculate_checksum(uint16_t *packet, int count)
 
     return ~sum;
 }
+
+/*
+The wide versions below all return the sum of the 16-bit words of data (in
+memory order) folded to 16 bits. Since 2^16 = 1 (mod 0xffff), words can be
+added in any grouping as long as no carry is lost, the folded result is the
+same as one word at a time (RFC 1071 section 2).
+*/
+
+/**
+ * @brief Fold a 64-bit one's complement sum to 16 bits
+ * 
+ * @param sum 
+ * @return uint32_t 
+ */
+static inline uint32_t
+checksum_fold64(uint64_t sum)
+{
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    return (uint32_t)sum;
+}
+
+/**
+ * @brief Portable version, 64 bits at a time with end-around carry
+ * 
+ * @param data 
+ * @param length even
+ * @return uint32_t 
+ */
+uint32_t
+checksum_words_u64(const uint8_t *data, size_t length)
+{
+    uint64_t sum = 0;
+    uint64_t word;
+    while (length >= 8) {
+        memcpy(&word, data, 8);
+        sum += word;
+        sum += (sum < word); // carry back in
+        data += 8;
+        length -= 8;
+    }
+    uint16_t half;
+    while (length >= 2) {
+        memcpy(&half, data, 2);
+        sum += half;
+        sum += (sum < half);
+        data += 2;
+        length -= 2;
+    }
+    return checksum_fold64(sum);
+}
+
+#ifdef CHECKSUM_X86
+// 32-bit lanes take 0x10000 words of at most 0xffff before they can overflow
+#define CHECKSUM_LANE_BLOCK 0x8000
+
+/**
+ * @brief SSE2 version, words widened to 32-bit lanes, 16 bytes at a time
+ * 
+ * @param data 
+ * @param length even
+ * @return uint32_t 
+ */
+__attribute__((target("sse2")))
+uint32_t
+checksum_words_sse2(const uint8_t *data, size_t length)
+{
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t sum = 0;
+    while (length >= 16) {
+        __m128i acc = _mm_setzero_si128();
+        size_t blocks = length / 16 < CHECKSUM_LANE_BLOCK ? length / 16 : CHECKSUM_LANE_BLOCK;
+        for (size_t i = 0; i < blocks; i++) {
+            __m128i v = _mm_loadu_si128((const __m128i*)data);
+            acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(v, zero));
+            acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(v, zero));
+            data += 16;
+        }
+        length -= blocks * 16;
+        __m128i wide = _mm_add_epi64(_mm_unpacklo_epi32(acc, zero), _mm_unpackhi_epi32(acc, zero));
+        sum += (uint64_t)_mm_cvtsi128_si64(wide) + (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(wide, wide));
+    }
+    return checksum_fold64((uint64_t)checksum_words_u64(data, length) + sum);
+}
+
+/**
+ * @brief AVX2 version, words widened to 32-bit lanes, 64 bytes at a time
+ * 
+ * @param data 
+ * @param length even
+ * @return uint32_t 
+ */
+__attribute__((target("avx2")))
+uint32_t
+checksum_words_avx2(const uint8_t *data, size_t length)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t sum = 0;
+    while (length >= 64) {
+        // two accumulators, the adds don't wait on each other
+        __m256i acc0 = _mm256_setzero_si256();
+        __m256i acc1 = _mm256_setzero_si256();
+        size_t blocks = length / 64 < CHECKSUM_LANE_BLOCK ? length / 64 : CHECKSUM_LANE_BLOCK;
+        for (size_t i = 0; i < blocks; i++) {
+            __m256i v0 = _mm256_loadu_si256((const __m256i*)data);
+            __m256i v1 = _mm256_loadu_si256((const __m256i*)(data + 32));
+            acc0 = _mm256_add_epi32(acc0, _mm256_unpacklo_epi16(v0, zero));
+            acc1 = _mm256_add_epi32(acc1, _mm256_unpackhi_epi16(v0, zero));
+            acc0 = _mm256_add_epi32(acc0, _mm256_unpacklo_epi16(v1, zero));
+            acc1 = _mm256_add_epi32(acc1, _mm256_unpackhi_epi16(v1, zero));
+            data += 64;
+        }
+        length -= blocks * 64;
+        // widen to 64-bit lanes before adding the accumulators together
+        __m256i wide = _mm256_add_epi64(_mm256_unpacklo_epi32(acc0, zero), _mm256_unpackhi_epi32(acc0, zero));
+        wide = _mm256_add_epi64(wide, _mm256_unpacklo_epi32(acc1, zero));
+        wide = _mm256_add_epi64(wide, _mm256_unpackhi_epi32(acc1, zero));
+        __m128i half = _mm_add_epi64(_mm256_castsi256_si128(wide), _mm256_extracti128_si256(wide, 1));
+        sum += (uint64_t)_mm_cvtsi128_si64(half) + (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(half, half));
+    }
+    return checksum_fold64((uint64_t)checksum_words_sse2(data, length) + sum);
+}
+#endif
+
+#ifdef CHECKSUM_NEON
+/**
+ * @brief NEON version, pairwise widening adds, 32 bytes at a time
+ * 
+ * @param data 
+ * @param length even
+ * @return uint32_t 
+ */
+uint32_t
+checksum_words_neon(const uint8_t *data, size_t length)
+{
+    uint64_t sum = 0;
+    while (length >= 32) {
+        uint32x4_t acc0 = vdupq_n_u32(0);
+        uint32x4_t acc1 = vdupq_n_u32(0);
+        // each lane takes 2 words per block
+        size_t blocks = length / 32 < 0x8000 ? length / 32 : 0x8000;
+        for (size_t i = 0; i < blocks; i++) {
+            acc0 = vpadalq_u16(acc0, vld1q_u16((const uint16_t*)data));
+            acc1 = vpadalq_u16(acc1, vld1q_u16((const uint16_t*)(data + 16)));
+            data += 32;
+        }
+        length -= blocks * 32;
+        sum += vaddlvq_u32(acc0) + vaddlvq_u32(acc1);
+    }
+    return checksum_fold64((uint64_t)checksum_words_u64(data, length) + sum);
+}
+#endif
+
+static const checksum_implementation_t checksum_all_implementations[] = {
+#ifdef CHECKSUM_X86
+    {"avx2", checksum_words_avx2},
+    {"sse2", checksum_words_sse2},
+#endif
+#ifdef CHECKSUM_NEON
+    {"neon", checksum_words_neon},
+#endif
+    {"u64", checksum_words_u64},
+};
+
+/**
+ * @brief Whether the CPU we run on can use an implementation
+ * 
+ * @param implementation 
+ * @return bool 
+ */
+static bool
+checksum_supported(const checksum_implementation_t *implementation)
+{
+#ifdef CHECKSUM_X86
+    if (implementation->sum == checksum_words_avx2) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (implementation->sum == checksum_words_sse2) {
+        return __builtin_cpu_supports("sse2");
+    }
+#endif
+    (void)implementation;
+    return true;
+}
+
+/**
+ * @brief The implementations usable on this CPU, fastest first
+ * 
+ * @param count 
+ * @return const checksum_implementation_t* 
+ */
+const checksum_implementation_t*
+checksum_implementations(size_t *count)
+{
+    static checksum_implementation_t supported[sizeof(checksum_all_implementations) / sizeof(checksum_all_implementations[0])];
+    static size_t supported_count = [](){
+        size_t n = 0;
+        for (const checksum_implementation_t &implementation : checksum_all_implementations) {
+            if (checksum_supported(&implementation)) {
+                supported[n++] = implementation;
+            }
+        }
+        return n;
+    }();
+    *count = supported_count;
+    return supported;
+}
+
+/**
+ * @brief The implementation picked for this CPU, chosen on first use
+ * 
+ * @return const checksum_implementation_t* 
+ */
+const checksum_implementation_t*
+checksum_implementation()
+{
+    static const checksum_implementation_t *best = [](){
+        size_t count;
+        return &checksum_implementations(&count)[0];
+    }();
+    return best;
+}
+
+/**
+ * @brief Sum of the 16-bit words of data, folded to 16 bits,
+ * with the best implementation for this CPU
+ * 
+ * @param data 
+ * @param length even
+ * @return uint32_t 
+ */
+uint32_t
+checksum_words(const uint8_t *data, size_t length)
+{
+    return checksum_implementation()->sum(data, length);
+}
+
+/**
+ * @brief Add length bytes to a running one's complement sum,
+ * the sum is kept folded to 17 bits so it never overflows
+ * 
+ * @param sum 0 to start a new checksum
+ * @param data 
+ * @param length 
+ * @return uint32_t 
+ */
+uint32_t
+checksum_add(uint32_t sum, const void *data, size_t length)
+{
+    const uint8_t *bytes = (const uint8_t*)data;
+    uint64_t total = sum;
+    if (length > 1) {
+        total += checksum_words(bytes, length & ~(size_t)1);
+    }
+
+    // left-over byte, padded with zero
+    if (length & 1) {
+        uint16_t word = 0;
+        memcpy(&word, bytes + length - 1, 1);
+        total += word;
+    }
+
+    while (total >> 16) {
+        total = (total & 0xffff) + (total >> 16);
+    }
+    return (uint32_t)total;
+}
+
+/**
+ * @brief Take a word back out of the sum, as if it had been 0.
+ * Lets a checksum field be skipped without zeroing it in the packet.
+ * 
+ * @param sum 
+ * @param word as read from the packet
+ * @return uint32_t 
+ */
+uint32_t
+checksum_remove(uint32_t sum, uint16_t word)
+{
+    // one's complement: x - y = x + ~y
+    sum += (uint16_t)~word;
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return sum;
+}
+
+/**
+ * @brief Add the IPv4 pseudo-header : https://datatracker.ietf.org/doc/html/rfc768
+ * 
+ *       0      7 8     15 16    23 24    31
+ *       +--------+--------+--------+--------+
+ *       |          source address           |
+ *       +--------+--------+--------+--------+
+ *       |        destination address        |
+ *       +--------+--------+--------+--------+
+ *       |  zero  |protocol| UDP/TCP length  |
+ *       +--------+--------+--------+--------+
+ * 
+ * @param sum 
+ * @param src_add 4 bytes
+ * @param dst_add 4 bytes
+ * @param protocol 
+ * @param length UDP/TCP length
+ * @return uint32_t 
+ */
+uint32_t
+checksum_add_pseudo_ipv4(uint32_t sum, const uint8_t *src_add, const uint8_t *dst_add, uint8_t protocol, uint16_t length)
+{
+    uint8_t last_row[4] = {0, protocol, (uint8_t)(length >> 8), (uint8_t)(length & 0xFF)};
+    sum = checksum_add(sum, src_add, 4);
+    sum = checksum_add(sum, dst_add, 4);
+    return checksum_add(sum, last_row, 4);
+}
+
+/**
+ * @brief Add the IPv6 pseudo-header : https://datatracker.ietf.org/doc/html/rfc2460#section-8.1
+ * 
+ *   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *   |                                                               |
+ *   +                         Source Address                        +
+ *   |                                                               |
+ *   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *   |                                                               |
+ *   +                      Destination Address                      +
+ *   |                                                               |
+ *   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *   |                   Upper-Layer Packet Length                   |
+ *   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *   |                      zero                     |  Next Header  |
+ *   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * 
+ * @param sum 
+ * @param src_add 16 bytes
+ * @param dst_add 16 bytes
+ * @param next_header 
+ * @param length upper-layer packet length
+ * @return uint32_t 
+ */
+uint32_t
+checksum_add_pseudo_ipv6(uint32_t sum, const uint8_t *src_add, const uint8_t *dst_add, uint8_t next_header, uint32_t length)
+{
+    uint8_t last_rows[8] = {
+        (uint8_t)(length >> 24), (uint8_t)(length >> 16), (uint8_t)(length >> 8), (uint8_t)(length & 0xFF),
+        0, 0, 0, next_header
+    };
+    sum = checksum_add(sum, src_add, 16);
+    sum = checksum_add(sum, dst_add, 16);
+    return checksum_add(sum, last_rows, 8);
+}
+
+/**
+ * @brief Fold and complement the running sum into the checksum
+ * 
+ * @param sum 
+ * @return uint16_t, in network byte order
+ */
+uint16_t
+checksum_finish(uint32_t sum)
+{
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return (uint16_t)~sum;
+}
\ No newline at end of file
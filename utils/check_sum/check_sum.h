@@ -3,7 +3,40 @@
 
 
 #include <netinet/ip.h>
+#include <stddef.h>
 
 uint32_t calculate_checksum(uint16_t *packet, int count);
+uint32_t calculate_checksum_scalar(uint16_t *packet, int count);
+
+/*
+The words are summed with the widest implementation the CPU supports
+(AVX2, SSE2, NEON, or 64 bits at a time), picked on first use. They all
+give the same result as calculate_checksum_scalar().
+*/
+typedef struct checksum_implementation {
+    const char *name;
+    uint32_t (*sum)(const uint8_t *data, size_t length); // length must be even
+} checksum_implementation_t;
+
+uint32_t checksum_words(const uint8_t *data, size_t length);
+const checksum_implementation_t* checksum_implementation();
+const checksum_implementation_t* checksum_implementations(size_t *count);
+
+/*
+Streaming version: the pieces (pseudo-header, segment) are summed where they
+are, nothing is copied. Like calculate_checksum() the words are read in memory
+order, so the result is in network byte order.
+
+    uint32_t sum = checksum_add_pseudo_ipv4(0, src, dst, IPPROTO_UDP, length);
+    sum = checksum_add(sum, udp, length);
+    uint16_t checksum = ntohs(checksum_finish(sum));
+
+Every piece but the last one must have an even length.
+*/
+uint32_t checksum_add(uint32_t sum, const void *data, size_t length);
+uint32_t checksum_remove(uint32_t sum, uint16_t word);
+uint32_t checksum_add_pseudo_ipv4(uint32_t sum, const uint8_t *src_add, const uint8_t *dst_add, uint8_t protocol, uint16_t length);
+uint32_t checksum_add_pseudo_ipv6(uint32_t sum, const uint8_t *src_add, const uint8_t *dst_add, uint8_t next_header, uint32_t length);
+uint16_t checksum_finish(uint32_t sum);
 
 #endif
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "check_sum.h"
 #include <cassert>
+#include <cstring>
+#include <cstdlib>
 
 void test_calculate_checksum(){
     u_int8_t packet[] = {
@@ -17,9 +19,106 @@ void test_calculate_checksum(){
     assert(checksum == original_checksum);
 }
 
+void test_streaming_checksum(){
+    // udp over ipv4, odd length: 192.168.0.1:1024 -> 192.168.0.199:53, 3 bytes of data
+    uint8_t src[4] = {0xc0, 0xa8, 0x00, 0x01};
+    uint8_t dst[4] = {0xc0, 0xa8, 0x00, 0xc7};
+    uint8_t udp[11] = {
+        0x04, 0x00, 0x00, 0x35, 0x00, 0x0b, 0x00, 0x00,
+        0x61, 0x62, 0x63
+    };
+
+    // the same bytes laid out one after the other, padded
+    uint8_t combined[24] = {0};
+    memcpy(combined, src, 4);
+    memcpy(combined + 4, dst, 4);
+    combined[9] = IPPROTO_UDP;
+    combined[11] = sizeof(udp);
+    memcpy(combined + 12, udp, sizeof(udp));
+    uint16_t expected = calculate_checksum((uint16_t*)combined, sizeof(combined));
+
+    uint32_t sum = checksum_add_pseudo_ipv4(0, src, dst, IPPROTO_UDP, sizeof(udp));
+    sum = checksum_add(sum, udp, sizeof(udp));
+    assert(checksum_finish(sum) == expected);
+
+    // once the checksum is in the packet, removing it gives the same result
+    memcpy(udp + 6, &expected, 2);
+    sum = checksum_add_pseudo_ipv4(0, src, dst, IPPROTO_UDP, sizeof(udp));
+    sum = checksum_add(sum, udp, sizeof(udp));
+    assert(checksum_finish(sum) == 0);
+    assert(checksum_finish(checksum_remove(sum, expected)) == expected);
+}
+
+void test_streaming_checksum_ipv6(){
+    uint8_t src[16] = {0xfe, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01};
+    uint8_t dst[16] = {0xff, 0x02, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x02};
+    uint8_t icmpv6[8] = {0x85, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+    uint8_t combined[48] = {0};
+    memcpy(combined, src, 16);
+    memcpy(combined + 16, dst, 16);
+    combined[35] = sizeof(icmpv6);
+    combined[39] = IPPROTO_ICMPV6;
+    memcpy(combined + 40, icmpv6, sizeof(icmpv6));
+    uint16_t expected = calculate_checksum((uint16_t*)combined, sizeof(combined));
+
+    uint32_t sum = checksum_add_pseudo_ipv6(0, src, dst, IPPROTO_ICMPV6, sizeof(icmpv6));
+    sum = checksum_add(sum, icmpv6, sizeof(icmpv6));
+    assert(checksum_finish(sum) == expected);
+}
+
+void test_implementations_match_scalar(){
+    // every length up to a jumbo frame, every alignment, a few fillings
+    const int max_length = 9000;
+    uint8_t *buffer = (uint8_t*)malloc(max_length + 64);
+    assert(buffer != NULL);
+
+    size_t count;
+    const checksum_implementation_t *implementations = checksum_implementations(&count);
+    assert(count >= 1);
+
+    for (int pattern = 0; pattern < 3; pattern++){
+        srand(pattern);
+        for (int i = 0; i < max_length + 64; i++){
+            buffer[i] = pattern == 0 ? 0xff : pattern == 1 ? 0x00 : rand() & 0xff;
+        }
+        for (int offset = 0; offset < 32; offset++){
+            // long lengths on a few alignments only, to keep it quick
+            int limit = offset < 4 ? max_length : 1600;
+            for (int length = 0; length <= limit; length++){
+                uint8_t *data = buffer + offset;
+                uint32_t expected = calculate_checksum_scalar((uint16_t*)data, length);
+                assert(calculate_checksum((uint16_t*)data, length) == expected);
+                for (size_t i = 0; i < count; i++){
+                    uint32_t sum = implementations[i].sum(data, length & ~1);
+                    if (length & 1){
+                        sum += data[length - 1];
+                    }
+                    while (sum >> 16){
+                        sum = (sum & 0xffff) + (sum >> 16);
+                    }
+                    assert((uint32_t)~sum == expected);
+                }
+            }
+        }
+    }
+
+    // every value of a single word
+    for (uint32_t word = 0; word <= 0xffff; word++){
+        uint16_t data[64];
+        for (int i = 0; i < 64; i++){
+            data[i] = (uint16_t)word;
+        }
+        assert(calculate_checksum(data, sizeof(data)) == calculate_checksum_scalar(data, sizeof(data)));
+    }
+    free(buffer);
+}
 
 int main()
 {
     test_calculate_checksum();
+    test_streaming_checksum();
+    test_streaming_checksum_ipv6();
+    test_implementations_match_scalar();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "count_min.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * @brief Allocate the counters
+ *
+ * @param width counters per row, rounded up to a power of two
+ * @return count_min_t*
+ */
+count_min_t*
+count_min_create(uint32_t width)
+{
+    count_min_t *sketch = (count_min_t*)calloc(1, sizeof(count_min_t));
+    if (sketch == NULL){
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    sketch->width = 1;
+    while (sketch->width < width && sketch->width < (1u << 31)){
+        sketch->width *= 2;
+    }
+    sketch->mask = sketch->width - 1;
+    sketch->counters = (uint64_t*)calloc((size_t)COUNT_MIN_DEPTH * sketch->width, sizeof(uint64_t));
+    if (sketch->counters == NULL){
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    return sketch;
+}
+
+/**
+ * @brief The widest sketch fitting in memory bytes, 1 counter wide at least
+ *
+ * @param memory bytes
+ * @return count_min_t*
+ */
+count_min_t*
+count_min_create_memory(size_t memory)
+{
+    size_t width = 1;
+    while (width * 2 * COUNT_MIN_DEPTH * sizeof(uint64_t) <= memory && width < (1u << 31)){
+        width *= 2;
+    }
+    return count_min_create((uint32_t)width);
+}
+
+void
+count_min_destroy(count_min_t *sketch)
+{
+    free(sketch->counters);
+    free(sketch);
+}
+
+static inline uint32_t
+count_min_column(const count_min_t *sketch, uint64_t hash, uint32_t row)
+{
+    uint32_t h1 = (uint32_t)hash;
+    // odd, so the rows never share a column
+    uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+    return (h1 + row * h2) & sketch->mask;
+}
+
+/**
+ * @brief Add the weight of a key
+ *
+ * @param sketch
+ * @param hash of the key
+ * @param weight
+ * @return uint64_t the key's estimate after it
+ */
+uint64_t
+count_min_add(count_min_t *sketch, uint64_t hash, uint64_t weight)
+{
+    sketch->total += weight;
+    uint64_t *counters[COUNT_MIN_DEPTH];
+    uint64_t estimate = UINT64_MAX;
+    for (uint32_t row = 0; row < COUNT_MIN_DEPTH; row++){
+        counters[row] = &sketch->counters[(size_t)row * sketch->width + count_min_column(sketch, hash, row)];
+        if (*counters[row] < estimate){
+            estimate = *counters[row];
+        }
+    }
+    // conservative update, none of them needs to go past the new estimate
+    estimate += weight;
+    for (uint32_t row = 0; row < COUNT_MIN_DEPTH; row++){
+        if (*counters[row] < estimate){
+            *counters[row] = estimate;
+        }
+    }
+    return estimate;
+}
+
+/**
+ * @brief The weight of a key, never less than what was added for it
+ *
+ * @param sketch
+ * @param hash of the key
+ * @return uint64_t
+ */
+uint64_t
+count_min_estimate(const count_min_t *sketch, uint64_t hash)
+{
+    uint64_t estimate = UINT64_MAX;
+    for (uint32_t row = 0; row < COUNT_MIN_DEPTH; row++){
+        uint64_t counter = sketch->counters[(size_t)row * sketch->width + count_min_column(sketch, hash, row)];
+        if (counter < estimate){
+            estimate = counter;
+        }
+    }
+    return estimate;
+}
+
+/**
+ * @brief Add the counters of another sketch
+ *
+ * @param sketch
+ * @param other
+ * @return int 0, -1 if the widths differ
+ */
+int
+count_min_merge(count_min_t *sketch, const count_min_t *other)
+{
+    if (sketch->width != other->width){
+        return -1;
+    }
+    size_t counters = (size_t)COUNT_MIN_DEPTH * sketch->width;
+    for (size_t i = 0; i < counters; i++){
+        sketch->counters[i] += other->counters[i];
+    }
+    sketch->total += other->total;
+    return 0;
+}
@@ -0,0 +1,53 @@
+#ifndef COUNT_MIN_H
+#define COUNT_MIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Point queries on the weight of any key in fixed memory, with a Count-Min
+sketch (Cormode, Muthukrishnan 2005): depth rows of width counters, a key
+adds its weight to one counter per row, its estimate is the smallest of
+them.
+
+    row 0   | | |w| | | | | |      counter (h1 + 0 * h2) & mask
+    row 1   | | | | | |w| | |      counter (h1 + 1 * h2) & mask
+    row 2   |w| | | | | | | |      ...
+    row 3   | | | | |w| | | |
+
+estimates never undercount; with width w they overcount by at most
+e / w of the total with probability 1 - e^-depth. The row counters come
+from the two halves of the key's 64-bit hash (Kirsch, Mitzenmacher), the
+caller hashes the key once. Updates are conservative: only the counters
+below the new estimate grow, which keeps the error smaller and the
+estimates the same, but two sketches then merge to an upper bound only.
+
+Two sketches of the same width merge by adding their counters.
+*/
+
+#define COUNT_MIN_DEPTH 4
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct count_min {
+    uint32_t width;         // a power of two
+    uint32_t mask;
+    uint64_t total;
+    uint64_t *counters;     // COUNT_MIN_DEPTH rows of width
+} count_min_t;
+
+count_min_t* count_min_create(uint32_t width);
+count_min_t* count_min_create_memory(size_t memory);
+void count_min_destroy(count_min_t *sketch);
+
+uint64_t count_min_add(count_min_t *sketch, uint64_t hash, uint64_t weight);
+uint64_t count_min_estimate(const count_min_t *sketch, uint64_t hash);
+int count_min_merge(count_min_t *sketch, const count_min_t *other);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
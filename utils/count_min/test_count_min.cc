@@ -0,0 +1,82 @@
+#include "count_min.h"
+#include <cassert>
+
+static uint64_t
+key_hash(uint64_t key)
+{
+    uint64_t hash = (key + 1) * 0x9e3779b97f4a7c15ull;
+    hash ^= hash >> 31;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    return hash ^ (hash >> 27);
+}
+
+void
+test_create()
+{
+    count_min_t *sketch = count_min_create(1000);
+    assert(sketch->width == 1024 && sketch->mask == 1023);
+    count_min_destroy(sketch);
+
+    // 4 rows of 8 byte counters
+    sketch = count_min_create_memory(64 * 1024);
+    assert(sketch->width == 2048);
+    count_min_destroy(sketch);
+    sketch = count_min_create_memory(0);
+    assert(sketch->width == 1);
+    count_min_destroy(sketch);
+}
+
+void
+test_estimates()
+{
+    count_min_t *sketch = count_min_create(1024);
+    assert(count_min_estimate(sketch, key_hash(1)) == 0);
+    assert(count_min_add(sketch, key_hash(1), 5) == 5);
+    assert(count_min_add(sketch, key_hash(1), 2) == 7);
+    assert(count_min_estimate(sketch, key_hash(1)) == 7);
+
+    // 100000 keys in 1024 columns: never less, over by e / width of the total most of the time
+    const uint64_t keys = 100000;
+    for (uint64_t key = 2; key < keys; key++){
+        count_min_add(sketch, key_hash(key), key % 7 + 1);
+    }
+    uint64_t bound = sketch->total * 3 / 1024;
+    uint64_t over = 0;
+    for (uint64_t key = 2; key < keys; key++){
+        uint64_t estimate = count_min_estimate(sketch, key_hash(key));
+        assert(estimate >= key % 7 + 1);
+        over += estimate - (key % 7 + 1) > bound;
+    }
+    assert(over < keys / 50);
+    count_min_destroy(sketch);
+}
+
+void
+test_merge()
+{
+    count_min_t *first = count_min_create(256);
+    count_min_t *second = count_min_create(256);
+    for (uint64_t key = 0; key < 100; key++){
+        count_min_add(first, key_hash(key), 1);
+        count_min_add(second, key_hash(key), 2);
+    }
+    assert(count_min_merge(first, second) == 0);
+    assert(first->total == 300);
+    for (uint64_t key = 0; key < 100; key++){
+        assert(count_min_estimate(first, key_hash(key)) >= 3);
+    }
+
+    count_min_t *narrow = count_min_create(128);
+    assert(count_min_merge(first, narrow) == -1);
+    count_min_destroy(narrow);
+    count_min_destroy(second);
+    count_min_destroy(first);
+}
+
+int main()
+{
+    test_create();
+    test_estimates();
+    test_merge();
+    return 0;
+}
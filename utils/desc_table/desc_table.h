@@ -0,0 +1,185 @@
+#ifndef DESC_TABLE_H
+#define DESC_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+
+/*
+Code to text lookups built at compile time.
+
+Every protocol describes its codes (ethertype, IP protocol, ICMP type, DNS
+type...) twice: a short form for the one line summaries and a verbose one
+with the value and its meaning. The protocol lists the codes it knows once,
+
+    constexpr desc_entry_t icmp_types[] = {
+        {ICMP_ECHOREPLY, {"Echo Reply", "Type: Echo Reply (0)"}},
+        ...
+    };
+
+and make_desc_table() spreads them in an array indexed by the code, the
+holes getting the fallback:
+
+    constexpr auto icmp_type_table = make_desc_table<256>(icmp_types, {"Unknown", "Type: Unknown"});
+    desc_lookup(icmp_type_table, type, verbose)   // one load, nothing allocated
+
+The holes can also be filled code by code, from texts with the value in
+them generated at compile time:
+
+    constexpr auto icmp_unknown = make_desc_numbers<256>("Type: Unknown (", ")");
+    constexpr auto icmp_type_table = make_desc_table<256>(icmp_types,
+        [](uint32_t code){ return desc_t{"Unknown", icmp_unknown[code]}; });
+
+Codes too sparse for an array (ethertypes) go in a desc_sparse_t, sorted at
+compile time and binary searched.
+
+The views point into string literals: they live as long as the program and
+their data() is '\0' terminated.
+*/
+
+typedef struct desc {
+    std::string_view brief;   // "Echo Reply"
+    std::string_view verbose; // "Type: Echo Reply (0)"
+} desc_t;
+
+typedef struct desc_entry {
+    uint32_t code;
+    desc_t desc;
+} desc_entry_t;
+
+// indexed by the code, the codes past Size and the holes get the fallback
+template <size_t Size>
+struct desc_table_t {
+    desc_t descs[Size];
+    desc_t fallback;
+};
+
+// sorted on the code
+template <size_t Count>
+struct desc_sparse_t {
+    desc_entry_t entries[Count];
+    desc_t fallback;
+};
+
+#define DESC_TEXT_SIZE 48 // the longest generated text, and the '\0'
+
+// one text per code below Size, generated at compile time
+template <size_t Size>
+struct desc_texts_t {
+    char texts[Size][DESC_TEXT_SIZE];
+    uint8_t lengths[Size];
+
+    constexpr std::string_view
+    operator[](size_t code) const
+    {
+        return std::string_view(texts[code], lengths[code]);
+    }
+};
+
+// prefix + code + suffix for every code below Size
+template <size_t Size>
+constexpr desc_texts_t<Size>
+make_desc_numbers(std::string_view prefix, std::string_view suffix, bool hexadecimal = false)
+{
+    desc_texts_t<Size> numbers{};
+    for (size_t code = 0; code < Size; code++){
+        char digits[16] = {};
+        size_t digit_count = 0;
+        size_t value = code;
+        do {
+            size_t digit = value % (hexadecimal ? 16 : 10);
+            digits[digit_count++] = (digit < 10) ? '0' + digit : 'a' + digit - 10;
+            value /= (hexadecimal ? 16 : 10);
+        } while (value > 0);
+
+        // a text too long doesn't compile
+        char *text = numbers.texts[code];
+        size_t length = 0;
+        for (char c : prefix){
+            text[length++] = c;
+        }
+        while (digit_count > 0){
+            text[length++] = digits[--digit_count];
+        }
+        for (char c : suffix){
+            text[length++] = c;
+        }
+        text[length] = '\0';
+        numbers.lengths[code] = length;
+    }
+    return numbers;
+}
+
+// holes(code) for the codes without an entry, past for the codes past Size
+template <size_t Size, size_t Count, typename Holes>
+constexpr desc_table_t<Size>
+make_desc_table(const desc_entry_t (&entries)[Count], Holes holes, desc_t past = {})
+{
+    desc_table_t<Size> table{};
+    for (size_t i = 0; i < Size; i++){
+        table.descs[i] = holes(i);
+    }
+    table.fallback = past;
+    // a code past Size doesn't compile
+    for (const desc_entry_t &entry : entries){
+        table.descs[entry.code] = entry.desc;
+    }
+    return table;
+}
+
+template <size_t Size, size_t Count>
+constexpr desc_table_t<Size>
+make_desc_table(const desc_entry_t (&entries)[Count], desc_t fallback)
+{
+    return make_desc_table<Size>(entries, [fallback](uint32_t){ return fallback; }, fallback);
+}
+
+template <size_t Count>
+constexpr desc_sparse_t<Count>
+make_desc_sparse(const desc_entry_t (&entries)[Count], desc_t fallback)
+{
+    desc_sparse_t<Count> sparse{};
+    for (size_t i = 0; i < Count; i++){
+        sparse.entries[i] = entries[i];
+    }
+    // insertion sort, a handful of entries
+    for (size_t i = 1; i < Count; i++){
+        desc_entry_t entry = sparse.entries[i];
+        size_t j = i;
+        while (j > 0 && sparse.entries[j - 1].code > entry.code){
+            sparse.entries[j] = sparse.entries[j - 1];
+            j--;
+        }
+        sparse.entries[j] = entry;
+    }
+    sparse.fallback = fallback;
+    return sparse;
+}
+
+template <size_t Size>
+constexpr std::string_view
+desc_lookup(const desc_table_t<Size> &table, uint32_t code, bool verbose)
+{
+    const desc_t &desc = (code < Size) ? table.descs[code] : table.fallback;
+    return verbose ? desc.verbose : desc.brief;
+}
+
+template <size_t Count>
+constexpr std::string_view
+desc_lookup(const desc_sparse_t<Count> &sparse, uint32_t code, bool verbose)
+{
+    size_t low = 0;
+    size_t high = Count;
+    while (low < high){
+        size_t middle = (low + high) / 2;
+        if (sparse.entries[middle].code < code){
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    const desc_t &desc = (low < Count && sparse.entries[low].code == code) ? sparse.entries[low].desc : sparse.fallback;
+    return verbose ? desc.verbose : desc.brief;
+}
+
+#endif
@@ -0,0 +1,77 @@
+#include <assert.h>
+#include <string.h>
+#include "desc_table.h"
+
+constexpr desc_entry_t colors[] = {
+    {1, {"red", "Color: red (1)"}},
+    {3, {"blue", "Color: blue (3)"}},
+};
+
+constexpr auto color_unknown = make_desc_numbers<8>("Color: Unknown (", ")");
+constexpr auto color_table = make_desc_table<8>(colors, {"?", "Color: ?"});
+constexpr auto color_numbered = make_desc_table<8>(colors,
+    [](uint32_t code){ return desc_t{"?", color_unknown[code]}; }, {"?", "Color: out of range"});
+
+constexpr desc_entry_t ports[] = {
+    {8080, {"http-alt", "Port: http-alt"}},
+    {22, {"ssh", "Port: ssh"}},
+    {443, {"https", "Port: https"}},
+};
+
+constexpr auto port_table = make_desc_sparse(ports, {"?", "Port: ?"});
+
+// all of it resolved by the compiler
+static_assert(desc_lookup(color_table, 3, false) == "blue");
+static_assert(desc_lookup(port_table, 443, true) == "Port: https");
+
+void
+test_table()
+{
+    assert(desc_lookup(color_table, 1, false) == "red");
+    assert(desc_lookup(color_table, 1, true) == "Color: red (1)");
+    assert(desc_lookup(color_table, 2, false) == "?");
+    assert(desc_lookup(color_table, 2, true) == "Color: ?");
+    // past the table
+    assert(desc_lookup(color_table, 1000, true) == "Color: ?");
+    // terminated, for printf()
+    assert(strcmp(desc_lookup(color_table, 3, true).data(), "Color: blue (3)") == 0);
+}
+
+void
+test_numbers()
+{
+    assert(color_unknown[0] == "Color: Unknown (0)");
+    assert(color_unknown[7] == "Color: Unknown (7)");
+    assert(strcmp(color_unknown[5].data(), "Color: Unknown (5)") == 0);
+    assert(desc_lookup(color_numbered, 3, true) == "Color: blue (3)");
+    assert(desc_lookup(color_numbered, 6, true) == "Color: Unknown (6)");
+    assert(desc_lookup(color_numbered, 6, false) == "?");
+    assert(desc_lookup(color_numbered, 8, true) == "Color: out of range");
+
+    constexpr auto hexadecimal = make_desc_numbers<256>("(0x", ")", true);
+    assert(hexadecimal[0] == "(0x0)");
+    assert(hexadecimal[0x11] == "(0x11)");
+    assert(hexadecimal[0xff] == "(0xff)");
+}
+
+void
+test_sparse()
+{
+    // sorted whatever the order of the entries
+    assert(port_table.entries[0].code == 22);
+    assert(port_table.entries[2].code == 8080);
+    assert(desc_lookup(port_table, 22, false) == "ssh");
+    assert(desc_lookup(port_table, 8080, true) == "Port: http-alt");
+    assert(desc_lookup(port_table, 23, false) == "?");
+    assert(desc_lookup(port_table, 0, true) == "Port: ?");
+    assert(desc_lookup(port_table, 65535, true) == "Port: ?");
+}
+
+int
+main()
+{
+    test_table();
+    test_numbers();
+    test_sparse();
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "histogram.h"
+
+#include <string.h>
+
+void
+histogram_init(histogram_t *histogram)
+{
+    memset(histogram, 0, sizeof(histogram_t));
+    histogram->min = UINT64_MAX;
+}
+
+/**
+ * @brief Add the values of another histogram, from another thread or key
+ *
+ * @param histogram
+ * @param other
+ */
+void
+histogram_merge(histogram_t *histogram, const histogram_t *other)
+{
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++){
+        histogram->counts[i] += other->counts[i];
+    }
+    histogram->count += other->count;
+    histogram->sum += other->sum;
+    if (other->min < histogram->min){
+        histogram->min = other->min;
+    }
+    if (other->max > histogram->max){
+        histogram->max = other->max;
+    }
+}
+
+// the smallest value counted in the bucket
+uint64_t
+histogram_bucket_low(uint32_t bucket)
+{
+    if (bucket < HISTOGRAM_SUB_BUCKETS){
+        return bucket;
+    }
+    uint32_t shift = bucket / (HISTOGRAM_SUB_BUCKETS / 2) - 1;
+    return (uint64_t)(bucket - shift * (HISTOGRAM_SUB_BUCKETS / 2)) << shift;
+}
+
+// the largest value counted in the bucket
+uint64_t
+histogram_bucket_high(uint32_t bucket)
+{
+    if (bucket < HISTOGRAM_SUB_BUCKETS){
+        return bucket;
+    }
+    uint32_t shift = bucket / (HISTOGRAM_SUB_BUCKETS / 2) - 1;
+    return histogram_bucket_low(bucket) + (1ull << shift) - 1;
+}
+
+/**
+ * @brief The value under which percentile % of the values are, as
+ * HdrHistogram gives it: the largest one of its bucket, no more than the
+ * largest value recorded
+ *
+ * @param histogram
+ * @param percentile 0 to 100
+ * @return uint64_t 0 if the histogram is empty
+ */
+uint64_t
+histogram_percentile(const histogram_t *histogram, double percentile)
+{
+    if (histogram->count == 0){
+        return 0;
+    }
+    // the rank of the value, 1 for the smallest
+    uint64_t rank = (uint64_t)(percentile / 100.0 * histogram->count + 0.5);
+    if (rank < 1){
+        rank = 1;
+    }
+    if (rank > histogram->count){
+        rank = histogram->count;
+    }
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++){
+        seen += histogram->counts[i];
+        if (seen >= rank){
+            uint64_t high = histogram_bucket_high(i);
+            return high < histogram->max ? high : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+double
+histogram_mean(const histogram_t *histogram)
+{
+    return histogram->count > 0 ? (double)histogram->sum / histogram->count : 0.0;
+}
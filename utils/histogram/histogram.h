@@ -0,0 +1,80 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Counts of values (latencies, sizes) in log-linear buckets, the way
+HdrHistogram does: every power of two is cut in HISTOGRAM_SUB_BUCKETS / 2
+linear buckets, so a value is known within 1/16 of itself, whatever its
+magnitude, in a fixed array.
+
+    value     0..31   32..63    64..127   128..255  ...  2^40..2^41-1
+    bucket    1 each  2 each    4 each    8 each         2^36 each
+    index     0..31   32..47    48..63    64..79         ..607
+
+Recording is a count leading zeros and an increment, no allocation: a
+histogram is a plain struct, two of them merge by adding their counts
+(per thread, per server). Values past HISTOGRAM_MAX go to the last bucket.
+*/
+
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)    // linear buckets under 32
+#define HISTOGRAM_MAGNITUDES 36                             // powers of two past them, up to 2^41
+#define HISTOGRAM_BUCKETS (HISTOGRAM_SUB_BUCKETS + HISTOGRAM_MAGNITUDES * HISTOGRAM_SUB_BUCKETS / 2)
+#define HISTOGRAM_MAX ((1ull << (HISTOGRAM_SUB_BITS + HISTOGRAM_MAGNITUDES)) - 1)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct histogram {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;           // UINT64_MAX while empty
+    uint64_t max;
+    uint64_t counts[HISTOGRAM_BUCKETS];
+} histogram_t;
+
+static inline uint32_t
+histogram_bucket(uint64_t value)
+{
+    if (value < HISTOGRAM_SUB_BUCKETS){
+        return (uint32_t)value;
+    }
+    if (value > HISTOGRAM_MAX){
+        return HISTOGRAM_BUCKETS - 1;
+    }
+    // the top HISTOGRAM_SUB_BITS bits of the value, the first one set
+    uint32_t shift = 63 - __builtin_clzll(value) - (HISTOGRAM_SUB_BITS - 1);
+    return shift * (HISTOGRAM_SUB_BUCKETS / 2) + (uint32_t)(value >> shift);
+}
+
+static inline void
+histogram_record(histogram_t *histogram, uint64_t value)
+{
+    histogram->counts[histogram_bucket(value)]++;
+    histogram->count++;
+    histogram->sum += value;
+    if (value < histogram->min){
+        histogram->min = value;
+    }
+    if (value > histogram->max){
+        histogram->max = value;
+    }
+}
+
+void histogram_init(histogram_t *histogram);
+void histogram_merge(histogram_t *histogram, const histogram_t *other);
+uint64_t histogram_bucket_low(uint32_t bucket);
+uint64_t histogram_bucket_high(uint32_t bucket);
+uint64_t histogram_percentile(const histogram_t *histogram, double percentile);
+double histogram_mean(const histogram_t *histogram);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
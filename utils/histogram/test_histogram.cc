@@ -0,0 +1,63 @@
+#include "histogram.h"
+#include <cassert>
+
+void
+test_buckets()
+{
+    // exact under 32, then 16 buckets per power of two
+    for (uint64_t value = 0; value < 32; value++){
+        assert(histogram_bucket(value) == value);
+    }
+    assert(histogram_bucket(32) == 32 && histogram_bucket(33) == 32);
+    assert(histogram_bucket(63) == 47 && histogram_bucket(64) == 48);
+    assert(histogram_bucket(HISTOGRAM_MAX) == HISTOGRAM_BUCKETS - 1);
+    assert(histogram_bucket(UINT64_MAX) == HISTOGRAM_BUCKETS - 1);
+
+    // every value falls between the bounds of its bucket, the buckets follow each other
+    for (uint32_t bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++){
+        uint64_t low = histogram_bucket_low(bucket);
+        uint64_t high = histogram_bucket_high(bucket);
+        assert(histogram_bucket(low) == bucket && histogram_bucket(high) == bucket);
+        if (bucket > 0){
+            assert(histogram_bucket_high(bucket - 1) + 1 == low);
+        }
+        // within 1/16
+        assert((high - low) * 16 <= low || bucket < HISTOGRAM_SUB_BUCKETS);
+    }
+    assert(histogram_bucket_high(HISTOGRAM_BUCKETS - 1) == HISTOGRAM_MAX);
+}
+
+void
+test_percentiles()
+{
+    histogram_t histogram;
+    histogram_init(&histogram);
+    assert(histogram_percentile(&histogram, 50) == 0);
+
+    for (uint64_t value = 1; value <= 1000; value++){
+        histogram_record(&histogram, value);
+    }
+    assert(histogram.count == 1000 && histogram.min == 1 && histogram.max == 1000);
+    assert(histogram_mean(&histogram) == 500.5);
+    // 500 is in the bucket 496..511
+    assert(histogram_percentile(&histogram, 50) == 511);
+    assert(histogram_percentile(&histogram, 99) >= 990 && histogram_percentile(&histogram, 99) <= 1000);
+    assert(histogram_percentile(&histogram, 100) == 1000);
+    assert(histogram_percentile(&histogram, 0) == 1);
+
+    // one slow value in a thousand
+    histogram_t other;
+    histogram_init(&other);
+    histogram_record(&other, 5000000);
+    histogram_merge(&histogram, &other);
+    assert(histogram.count == 1001 && histogram.max == 5000000);
+    assert(histogram_percentile(&histogram, 99.9) < 1100);
+    assert(histogram_percentile(&histogram, 100) == 5000000);
+}
+
+int main()
+{
+    test_buckets();
+    test_percentiles();
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include "hyperloglog.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#define HYPERLOGLOG_SSE2
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define HYPERLOGLOG_NEON
+#endif
+
+/**
+ * @brief Allocate the registers, all 0
+ *
+ * @param sketch
+ * @param precision bits of the index, clamped to 4..18, HYPERLOGLOG_PRECISION if 0
+ */
+void
+hyperloglog_init(hyperloglog_t *sketch, uint8_t precision)
+{
+    if (precision == 0){
+        precision = HYPERLOGLOG_PRECISION;
+    }
+    if (precision < HYPERLOGLOG_MIN_PRECISION){
+        precision = HYPERLOGLOG_MIN_PRECISION;
+    }
+    if (precision > HYPERLOGLOG_MAX_PRECISION){
+        precision = HYPERLOGLOG_MAX_PRECISION;
+    }
+    sketch->precision = precision;
+    sketch->size = 1u << precision;
+    sketch->registers = (uint8_t*)calloc(sketch->size, 1);
+    if (sketch->registers == NULL){
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void
+hyperloglog_destroy(hyperloglog_t *sketch)
+{
+    free(sketch->registers);
+    sketch->registers = NULL;
+}
+
+void
+hyperloglog_reset(hyperloglog_t *sketch)
+{
+    memset(sketch->registers, 0, sketch->size);
+}
+
+/**
+ * @brief Merge one register at a time, what the vector versions give
+ *
+ * @param sketch
+ * @param other of the same precision
+ */
+void
+hyperloglog_merge_scalar(hyperloglog_t *sketch, const hyperloglog_t *other)
+{
+    for (uint32_t i = 0; i < sketch->size; i++){
+        if (other->registers[i] > sketch->registers[i]){
+            sketch->registers[i] = other->registers[i];
+        }
+    }
+}
+
+/**
+ * @brief Add the keys of another sketch: the largest of each register,
+ * 16 at a time
+ *
+ * @param sketch
+ * @param other
+ * @return int 0, -1 if their precisions differ
+ */
+int
+hyperloglog_merge(hyperloglog_t *sketch, const hyperloglog_t *other)
+{
+    if (sketch->precision != other->precision){
+        return -1;
+    }
+    uint8_t *registers = sketch->registers;
+    const uint8_t *others = other->registers;
+    // 16 registers at least, a multiple of 16
+#if defined(HYPERLOGLOG_SSE2)
+    for (uint32_t i = 0; i < sketch->size; i += 16){
+        __m128i a = _mm_loadu_si128((const __m128i*)(registers + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(others + i));
+        _mm_storeu_si128((__m128i*)(registers + i), _mm_max_epu8(a, b));
+    }
+#elif defined(HYPERLOGLOG_NEON)
+    for (uint32_t i = 0; i < sketch->size; i += 16){
+        vst1q_u8(registers + i, vmaxq_u8(vld1q_u8(registers + i), vld1q_u8(others + i)));
+    }
+#else
+    hyperloglog_merge_scalar(sketch, other);
+#endif
+    return 0;
+}
+
+// Ertl's sigma(x), for the registers still 0
+static double
+hyperloglog_sigma(double x)
+{
+    if (x == 1.0){
+        return INFINITY;
+    }
+    double y = 1.0;
+    double z = x;
+    double previous;
+    do {
+        x *= x;
+        previous = z;
+        z += x * y;
+        y += y;
+    } while (z != previous);
+    return z;
+}
+
+// Ertl's tau(x), for the registers at their largest rank
+static double
+hyperloglog_tau(double x)
+{
+    if (x == 0.0 || x == 1.0){
+        return 0.0;
+    }
+    double y = 1.0;
+    double z = 1.0 - x;
+    double previous;
+    do {
+        x = sqrt(x);
+        previous = z;
+        y *= 0.5;
+        z -= (1.0 - x) * (1.0 - x) * y;
+    } while (z != previous);
+    return z / 3.0;
+}
+
+/**
+ * @brief How many distinct keys were added, within 1.04 / sqrt(2^precision)
+ * most of the time
+ *
+ * @param sketch
+ * @return double
+ */
+double
+hyperloglog_estimate(const hyperloglog_t *sketch)
+{
+    // how many registers have each rank, 0 to 64 - precision + 1
+    uint32_t ranks[66] = {0};
+    for (uint32_t i = 0; i < sketch->size; i++){
+        ranks[sketch->registers[i]]++;
+    }
+    uint32_t largest = 64 - sketch->precision;
+    double m = sketch->size;
+    double z = m * hyperloglog_tau((m - ranks[largest + 1]) / m);
+    for (uint32_t rank = largest; rank >= 1; rank--){
+        z += ranks[rank];
+        z *= 0.5;
+    }
+    z += m * hyperloglog_sigma(ranks[0] / m);
+    // m^2 / (2 ln 2) / z
+    return m * m * 0.7213475204444817 / z;
+}
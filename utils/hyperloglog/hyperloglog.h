@@ -0,0 +1,74 @@
+#ifndef HYPERLOGLOG_H
+#define HYPERLOGLOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+How many distinct keys a stream has, in 2^precision bytes whatever their
+number, with HyperLogLog (Flajolet et al. 2007) as HyperLogLog++ (Heule
+et al. 2013) takes it: a 64-bit hash per key, no correction for large
+counts needed. The first precision bits of the hash choose a register,
+the register keeps the largest rank seen, the position of the first 1 in
+the other bits:
+
+    hash    | index (precision bits) | 0 0 0 1 ...........|
+                        |                     rank 4
+    registers [ 0 3 1 0 4 2 ... ]  max(register, rank)
+
+The estimate is Ertl's (2017), from the histogram of the registers: as
+good for a few keys as for billions, without the bias tables nor the
+switch to linear counting of HyperLogLog++. The relative standard error
+is 1.04 / sqrt(2^precision): 0.81% with 14 bits (16 KB).
+
+Two sketches of the same precision merge into the sketch of the union of
+their streams, the largest of each register: 16 registers at a time
+(SSE2, NEON). The registers are always dense, no sparse representation:
+the sketches are few and reused.
+*/
+
+#define HYPERLOGLOG_MIN_PRECISION 4
+#define HYPERLOGLOG_MAX_PRECISION 18
+#define HYPERLOGLOG_PRECISION 14
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct hyperloglog {
+    uint8_t precision;
+    uint32_t size;                  // 2^precision registers
+    uint8_t *registers;
+} hyperloglog_t;
+
+void hyperloglog_init(hyperloglog_t *sketch, uint8_t precision);
+void hyperloglog_destroy(hyperloglog_t *sketch);
+void hyperloglog_reset(hyperloglog_t *sketch);
+int hyperloglog_merge(hyperloglog_t *sketch, const hyperloglog_t *other);
+void hyperloglog_merge_scalar(hyperloglog_t *sketch, const hyperloglog_t *other);
+double hyperloglog_estimate(const hyperloglog_t *sketch);
+
+/**
+ * @brief Add a key by its hash
+ *
+ * @param sketch
+ * @param hash 64 bits, all of them good
+ */
+static inline void
+hyperloglog_add(hyperloglog_t *sketch, uint64_t hash)
+{
+    uint32_t index = (uint32_t)(hash >> (64 - sketch->precision));
+    // a 1 past the last bit, the rank is 64 - precision + 1 at most
+    uint64_t rest = (hash << sketch->precision) | ((uint64_t)1 << (sketch->precision - 1));
+    uint8_t rank = (uint8_t)(__builtin_clzll(rest) + 1);
+    if (rank > sketch->registers[index]){
+        sketch->registers[index] = rank;
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,118 @@
+#include "hyperloglog.h"
+#include "key_hash.h"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+static void
+add_range(hyperloglog_t *sketch, uint64_t first, uint64_t last)
+{
+    for (uint64_t key = first; key < last; key++){
+        hyperloglog_add(sketch, key_hash(&key, sizeof(key)));
+    }
+}
+
+static bool
+close_to(double estimate, double count, double error)
+{
+    return fabs(estimate - count) <= count * error + 1;
+}
+
+void
+test_init()
+{
+    hyperloglog_t sketch;
+    hyperloglog_init(&sketch, 0);
+    assert(sketch.precision == HYPERLOGLOG_PRECISION && sketch.size == 1u << HYPERLOGLOG_PRECISION);
+    assert(hyperloglog_estimate(&sketch) == 0);
+    hyperloglog_destroy(&sketch);
+    hyperloglog_init(&sketch, 2);
+    assert(sketch.precision == HYPERLOGLOG_MIN_PRECISION && sketch.size == 16);
+    hyperloglog_destroy(&sketch);
+    hyperloglog_init(&sketch, 30);
+    assert(sketch.precision == HYPERLOGLOG_MAX_PRECISION);
+    hyperloglog_destroy(&sketch);
+}
+
+void
+test_ranks()
+{
+    hyperloglog_t sketch;
+    hyperloglog_init(&sketch, 4);
+    // register 1, three 0s before the first 1
+    hyperloglog_add(&sketch, 0x1000000000000000ull | 0x0100000000000000ull);
+    assert(sketch.registers[1] == 4);
+    // a smaller rank doesn't lower it
+    hyperloglog_add(&sketch, 0x1000000000000000ull | 0x0800000000000000ull);
+    assert(sketch.registers[1] == 4);
+    // only 0s after the index: the largest rank
+    hyperloglog_add(&sketch, 0xf000000000000000ull);
+    assert(sketch.registers[15] == 64 - 4 + 1);
+    hyperloglog_destroy(&sketch);
+}
+
+void
+test_estimates()
+{
+    // a few keys to millions, within 3 standard errors (0.81% each)
+    const uint64_t counts[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 3000000};
+    hyperloglog_t sketch;
+    hyperloglog_init(&sketch, 14);
+    uint64_t added = 0;
+    for (uint64_t count : counts){
+        add_range(&sketch, added, count);
+        added = count;
+        assert(close_to(hyperloglog_estimate(&sketch), count, 0.025));
+    }
+    // the same keys again, nothing more
+    add_range(&sketch, 0, 1000);
+    assert(close_to(hyperloglog_estimate(&sketch), 3000000, 0.025));
+
+    hyperloglog_reset(&sketch);
+    assert(hyperloglog_estimate(&sketch) == 0);
+    hyperloglog_destroy(&sketch);
+}
+
+void
+test_merge()
+{
+    // [0, 60000) and [40000, 100000): 100000 together
+    hyperloglog_t first;
+    hyperloglog_t second;
+    hyperloglog_t scalar;
+    hyperloglog_init(&first, 12);
+    hyperloglog_init(&second, 12);
+    hyperloglog_init(&scalar, 12);
+    add_range(&first, 0, 60000);
+    add_range(&second, 40000, 100000);
+    memcpy(scalar.registers, first.registers, first.size);
+
+    assert(hyperloglog_merge(&first, &second) == 0);
+    hyperloglog_merge_scalar(&scalar, &second);
+    assert(memcmp(first.registers, scalar.registers, first.size) == 0);
+    assert(close_to(hyperloglog_estimate(&first), 100000, 0.05));
+
+    // the sketch of the union, as if added to one
+    hyperloglog_t whole;
+    hyperloglog_init(&whole, 12);
+    add_range(&whole, 0, 100000);
+    assert(memcmp(first.registers, whole.registers, first.size) == 0);
+
+    hyperloglog_t other;
+    hyperloglog_init(&other, 10);
+    assert(hyperloglog_merge(&first, &other) == -1);
+    hyperloglog_destroy(&other);
+    hyperloglog_destroy(&whole);
+    hyperloglog_destroy(&scalar);
+    hyperloglog_destroy(&second);
+    hyperloglog_destroy(&first);
+}
+
+int main()
+{
+    test_init();
+    test_ranks();
+    test_estimates();
+    test_merge();
+    return 0;
+}
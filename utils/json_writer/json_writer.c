@@ -0,0 +1,330 @@
+#include "json_writer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char hex_digits[] = "0123456789abcdef";
+
+/**
+ * @brief Set up a writer on sink, nothing is written yet
+ *
+ * @param json
+ * @param sink
+ */
+void
+json_init(json_writer_t *json, output_sink_t *sink)
+{
+    json->sink = sink;
+    json->depth = 0;
+    json->after_key = false;
+    json->has_items[0] = false;
+}
+
+/**
+ * @brief The comma before an item, unless it is the first one
+ * of its container or the value of a key. Top level values are
+ * never separated, one document per line is the caller's business.
+ *
+ * @param json
+ */
+static void
+json_separator(json_writer_t *json)
+{
+    if (json->after_key){
+        json->after_key = false;
+        return;
+    }
+    if (json->depth > 0 && json->has_items[json->depth]){
+        output_sink_putc(json->sink, ',');
+    }
+    json->has_items[json->depth] = true;
+}
+
+static void
+json_open(json_writer_t *json, char c)
+{
+    json_separator(json);
+    if (json->depth + 1 >= JSON_MAX_DEPTH){
+        fprintf(stderr, "json: more than %d levels of nesting\n", JSON_MAX_DEPTH - 1);
+        exit(EXIT_FAILURE);
+    }
+    output_sink_putc(json->sink, c);
+    json->depth++;
+    json->has_items[json->depth] = false;
+}
+
+static void
+json_close(json_writer_t *json, char c)
+{
+    output_sink_putc(json->sink, c);
+    json->depth--;
+}
+
+void
+json_begin_object(json_writer_t *json)
+{
+    json_open(json, '{');
+}
+
+void
+json_end_object(json_writer_t *json)
+{
+    json_close(json, '}');
+}
+
+void
+json_begin_array(json_writer_t *json)
+{
+    json_open(json, '[');
+}
+
+void
+json_end_array(json_writer_t *json)
+{
+    json_close(json, ']');
+}
+
+/**
+ * @brief Length of the UTF-8 sequence starting at a byte of 0x80 or more,
+ * 0 if it isn't one (stray continuation, overlong, surrogate, past
+ * U+10FFFF, cut short)
+ *
+ * @param s
+ * @param remaining bytes from s
+ * @return size_t 2 to 4, or 0
+ */
+static size_t
+json_utf8_length(const unsigned char *s, size_t remaining)
+{
+    size_t length;
+    // the second byte's range, narrower after E0, ED, F0 and F4
+    unsigned char low = 0x80, high = 0xbf;
+    if (s[0] >= 0xc2 && s[0] <= 0xdf){
+        length = 2;
+    } else if (s[0] >= 0xe0 && s[0] <= 0xef){
+        length = 3;
+        if (s[0] == 0xe0){
+            low = 0xa0;
+        } else if (s[0] == 0xed){
+            high = 0x9f;
+        }
+    } else if (s[0] >= 0xf0 && s[0] <= 0xf4){
+        length = 4;
+        if (s[0] == 0xf0){
+            low = 0x90;
+        } else if (s[0] == 0xf4){
+            high = 0x8f;
+        }
+    } else {
+        return 0;
+    }
+    if (remaining < length || s[1] < low || s[1] > high){
+        return 0;
+    }
+    for (size_t i = 2; i < length; i++){
+        if ((s[i] & 0xc0) != 0x80){
+            return 0;
+        }
+    }
+    return length;
+}
+
+/**
+ * @brief Write the escaped text between the quotes, runs of plain
+ * characters and valid UTF-8 are copied in one go. The names and texts
+ * of packets are any bytes: one that isn't part of valid UTF-8 is
+ * written as the code point of its value, \u0080 to \u00ff
+ *
+ * @param sink
+ * @param string
+ * @param length
+ */
+static void
+json_escape(output_sink_t *sink, const char *string, size_t length)
+{
+    const unsigned char *s = (const unsigned char*)string;
+    size_t start = 0;
+    size_t i = 0;
+    while (i < length){
+        unsigned char c = s[i];
+        if (c >= 0x20 && c < 0x80 && c != '"' && c != '\\'){
+            i++;
+            continue;
+        }
+        if (c >= 0x80){
+            size_t sequence = json_utf8_length(s + i, length - i);
+            if (sequence > 0){
+                i += sequence;
+                continue;
+            }
+        }
+        output_sink_write(sink, string + start, i - start);
+        i++;
+        start = i;
+
+        char *out = output_sink_reserve(sink, 6);
+        out[0] = '\\';
+        switch (c){
+            case '"':  out[1] = '"';  sink->length += 2; break;
+            case '\\': out[1] = '\\'; sink->length += 2; break;
+            case '\n': out[1] = 'n';  sink->length += 2; break;
+            case '\r': out[1] = 'r';  sink->length += 2; break;
+            case '\t': out[1] = 't';  sink->length += 2; break;
+            case '\b': out[1] = 'b';  sink->length += 2; break;
+            case '\f': out[1] = 'f';  sink->length += 2; break;
+            default:
+                out[1] = 'u';
+                out[2] = '0';
+                out[3] = '0';
+                out[4] = hex_digits[c >> 4];
+                out[5] = hex_digits[c & 0x0f];
+                sink->length += 6;
+                break;
+        }
+    }
+    output_sink_write(sink, string + start, length - start);
+}
+
+/**
+ * @brief Start a member of the current object, its value comes next
+ *
+ * @param json
+ * @param key
+ */
+void
+json_key(json_writer_t *json, const char *key)
+{
+    json_separator(json);
+    output_sink_putc(json->sink, '"');
+    json_escape(json->sink, key, strlen(key));
+    output_sink_write(json->sink, "\":", 2);
+    json->after_key = true;
+}
+
+/**
+ * @brief A string value, NULL is written as null
+ *
+ * @param json
+ * @param string
+ */
+void
+json_string(json_writer_t *json, const char *string)
+{
+    if (string == NULL){
+        json_null(json);
+        return;
+    }
+    json_string_n(json, string, strlen(string));
+}
+
+void
+json_string_n(json_writer_t *json, const char *string, size_t length)
+{
+    json_separator(json);
+    output_sink_putc(json->sink, '"');
+    json_escape(json->sink, string, length);
+    output_sink_putc(json->sink, '"');
+}
+
+void
+json_uint(json_writer_t *json, uint64_t value)
+{
+    json_separator(json);
+    output_sink_uint(json->sink, value);
+}
+
+void
+json_int(json_writer_t *json, int64_t value)
+{
+    json_separator(json);
+    output_sink_int(json->sink, value);
+}
+
+void
+json_bool(json_writer_t *json, bool value)
+{
+    json_separator(json);
+    if (value){
+        output_sink_write(json->sink, "true", 4);
+    } else {
+        output_sink_write(json->sink, "false", 5);
+    }
+}
+
+void
+json_null(json_writer_t *json)
+{
+    json_separator(json);
+    output_sink_write(json->sink, "null", 4);
+}
+
+/**
+ * @brief A timestamp as a number of seconds, with the microseconds
+ * as six decimals (1347402958.977971)
+ *
+ * @param json
+ * @param seconds
+ * @param microseconds
+ */
+void
+json_time(json_writer_t *json, uint64_t seconds, uint32_t microseconds)
+{
+    json_separator(json);
+    output_sink_uint(json->sink, seconds);
+    char *out = output_sink_reserve(json->sink, 7);
+    out[0] = '.';
+    for (int i = 6; i >= 1; i--){
+        out[i] = '0' + microseconds % 10;
+        microseconds /= 10;
+    }
+    json->sink->length += 7;
+}
+
+// dotted quad, between quotes
+void
+json_ipv4(json_writer_t *json, const uint8_t *address)
+{
+    json_separator(json);
+    output_sink_putc(json->sink, '"');
+    output_sink_ipv4(json->sink, address);
+    output_sink_putc(json->sink, '"');
+}
+
+// xx:xx:xx:xx:xx:xx, between quotes
+void
+json_mac(json_writer_t *json, const uint8_t *address)
+{
+    json_separator(json);
+    output_sink_putc(json->sink, '"');
+    output_sink_mac(json->sink, address);
+    output_sink_putc(json->sink, '"');
+}
+
+void
+json_field_string(json_writer_t *json, const char *key, const char *string)
+{
+    json_key(json, key);
+    json_string(json, string);
+}
+
+void
+json_field_uint(json_writer_t *json, const char *key, uint64_t value)
+{
+    json_key(json, key);
+    json_uint(json, value);
+}
+
+void
+json_field_int(json_writer_t *json, const char *key, int64_t value)
+{
+    json_key(json, key);
+    json_int(json, value);
+}
+
+void
+json_field_bool(json_writer_t *json, const char *key, bool value)
+{
+    json_key(json, key);
+    json_bool(json, value);
+}
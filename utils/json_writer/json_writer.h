@@ -0,0 +1,69 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "output_sink.h"
+
+/*
+JSON encoder writing straight into an output sink.
+
+Nothing is built in memory first: keys, strings and numbers are escaped and
+formatted in place, the writer only remembers, for each open object or array,
+whether a comma is needed before the next item. It never allocates, the sink
+grows or flushes on its own.
+
+    json_begin_object(&json);
+    json_field_uint(&json, "ttl", 64);
+    json_key(&json, "src");
+    json_ipv4(&json, address);
+    json_end_object(&json);      // {"ttl":64,"src":"10.0.0.1"}
+
+Strings are written as UTF-8: '"', '\' and the control characters are
+escaped, and so is every byte that isn't part of valid UTF-8 (packets carry
+any bytes), as \u00XX of its value.
+*/
+
+#define JSON_MAX_DEPTH 32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct json_writer {
+    output_sink_t *sink;
+    int depth;                        // open objects and arrays
+    bool after_key;                   // the next value belongs to a key
+    bool has_items[JSON_MAX_DEPTH];   // a comma goes before the next item
+} json_writer_t;
+
+void json_init(json_writer_t *json, output_sink_t *sink);
+
+void json_begin_object(json_writer_t *json);
+void json_end_object(json_writer_t *json);
+void json_begin_array(json_writer_t *json);
+void json_end_array(json_writer_t *json);
+void json_key(json_writer_t *json, const char *key);
+
+void json_string(json_writer_t *json, const char *string);
+void json_string_n(json_writer_t *json, const char *string, size_t length);
+void json_uint(json_writer_t *json, uint64_t value);
+void json_int(json_writer_t *json, int64_t value);
+void json_bool(json_writer_t *json, bool value);
+void json_null(json_writer_t *json);
+void json_time(json_writer_t *json, uint64_t seconds, uint32_t microseconds);
+void json_ipv4(json_writer_t *json, const uint8_t *address);
+void json_mac(json_writer_t *json, const uint8_t *address);
+
+// key and value in one call
+void json_field_string(json_writer_t *json, const char *key, const char *string);
+void json_field_uint(json_writer_t *json, const char *key, uint64_t value);
+void json_field_int(json_writer_t *json, const char *key, int64_t value);
+void json_field_bool(json_writer_t *json, const char *key, bool value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,142 @@
+#include "json_writer.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the text in a memory sink, as a string
+const char*
+sink_text(output_sink_t *sink)
+{
+    output_sink_putc(sink, '\0');
+    sink->length--;
+    return sink->data;
+}
+
+void
+test_nesting()
+{
+    output_sink_t sink;
+    output_sink_init(&sink, OUTPUT_SINK_NO_FD, 8);
+    json_writer_t json;
+    json_init(&json, &sink);
+
+    json_begin_object(&json);
+    json_field_uint(&json, "n", 0);
+    json_key(&json, "empty");
+    json_begin_object(&json);
+    json_end_object(&json);
+    json_key(&json, "list");
+    json_begin_array(&json);
+    json_int(&json, -1);
+    json_bool(&json, true);
+    json_null(&json);
+    json_begin_array(&json);
+    json_end_array(&json);
+    json_begin_object(&json);
+    json_field_bool(&json, "ok", false);
+    json_end_object(&json);
+    json_end_array(&json);
+    json_field_string(&json, "last", "x");
+    json_end_object(&json);
+    assert(strcmp(sink_text(&sink),
+        "{\"n\":0,\"empty\":{},\"list\":[-1,true,null,[],{\"ok\":false}],\"last\":\"x\"}") == 0);
+    assert(json.depth == 0);
+
+    // one document per line, no comma between them
+    output_sink_reset(&sink);
+    json_begin_object(&json);
+    json_end_object(&json);
+    output_sink_putc(&sink, '\n');
+    json_begin_object(&json);
+    json_field_int(&json, "a", 1);
+    json_end_object(&json);
+    assert(strcmp(sink_text(&sink), "{}\n{\"a\":1}") == 0);
+
+    output_sink_destroy(&sink);
+}
+
+void
+test_escaping()
+{
+    output_sink_t sink;
+    output_sink_init(&sink, OUTPUT_SINK_NO_FD, 8);
+    json_writer_t json;
+    json_init(&json, &sink);
+
+    json_string(&json, "plain text");
+    assert(strcmp(sink_text(&sink), "\"plain text\"") == 0);
+
+    output_sink_reset(&sink);
+    json_string(&json, "a\"b\\c\nd\re\tf\bg\fh\x01i\x1f");
+    assert(strcmp(sink_text(&sink), "\"a\\\"b\\\\c\\nd\\re\\tf\\bg\\fh\\u0001i\\u001f\"") == 0);
+
+    // utf-8 goes through untouched
+    output_sink_reset(&sink);
+    json_string(&json, "caf\xc3\xa9");
+    assert(strcmp(sink_text(&sink), "\"caf\xc3\xa9\"") == 0);
+
+    // a DNS label in Latin-1, not UTF-8: the byte by its value
+    output_sink_reset(&sink);
+    json_string(&json, "caf\xe9.example");
+    assert(strcmp(sink_text(&sink), "\"caf\\u00e9.example\"") == 0);
+
+    // four bytes go through, stray, overlong, surrogate, past U+10FFFF and cut
+    // short sequences are escaped byte by byte
+    output_sink_reset(&sink);
+    json_string(&json, "\xf0\x9f\x98\x80|\x80|\xc0\xaf|\xed\xa0\x80|\xf4\x90\x80\x80|\xe2\x82");
+    assert(strcmp(sink_text(&sink), "\"\xf0\x9f\x98\x80|\\u0080|\\u00c0\\u00af|\\u00ed\\u00a0\\u0080"
+        "|\\u00f4\\u0090\\u0080\\u0080|\\u00e2\\u0082\"") == 0);
+
+    // embedded NUL with an explicit length
+    output_sink_reset(&sink);
+    json_string_n(&json, "a\0b", 3);
+    assert(strcmp(sink_text(&sink), "\"a\\u0000b\"") == 0);
+
+    output_sink_reset(&sink);
+    json_string(&json, NULL);
+    assert(strcmp(sink_text(&sink), "null") == 0);
+
+    // keys are escaped too
+    output_sink_reset(&sink);
+    json_begin_object(&json);
+    json_field_uint(&json, "q\"", 1);
+    json_end_object(&json);
+    assert(strcmp(sink_text(&sink), "{\"q\\\"\":1}") == 0);
+
+    output_sink_destroy(&sink);
+}
+
+void
+test_values()
+{
+    output_sink_t sink;
+    output_sink_init(&sink, OUTPUT_SINK_NO_FD, 8);
+    json_writer_t json;
+    json_init(&json, &sink);
+
+    uint8_t ipv4[4] = {10, 0, 0, 254};
+    uint8_t mac[6] = {0x00, 0x1b, 0x21, 0xaa, 0xbb, 0xcc};
+    json_begin_array(&json);
+    json_uint(&json, 18446744073709551615ull);
+    json_int(&json, INT64_MIN);
+    json_time(&json, 1347402958, 977971);
+    json_time(&json, 0, 5);
+    json_ipv4(&json, ipv4);
+    json_mac(&json, mac);
+    json_end_array(&json);
+    assert(strcmp(sink_text(&sink),
+        "[18446744073709551615,-9223372036854775808,1347402958.977971,0.000005,"
+        "\"10.0.0.254\",\"00:1b:21:aa:bb:cc\"]") == 0);
+
+    output_sink_destroy(&sink);
+}
+
+int
+main()
+{
+    test_nesting();
+    test_escaping();
+    test_values();
+    return 0;
+}
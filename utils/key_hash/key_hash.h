@@ -0,0 +1,52 @@
+#ifndef KEY_HASH_H
+#define KEY_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+A 64-bit hash of a small key (addresses, ports, names), 8 bytes at a time,
+for the sketches: all the bits of the result depend on all the bits of
+the key, the high bits are as good as the low ones.
+
+    uint64_t hash = key_hash(&key, sizeof(key));
+
+The same key always hashes the same, keys of different sizes differ even
+when one is the other zero-padded. Not meant to resist chosen keys.
+*/
+
+#define KEY_HASH_MULTIPLIER 0x9e3779b97f4a7c15ull
+
+// the finalizer of splitmix64
+static inline uint64_t
+key_hash_mix(uint64_t hash)
+{
+    hash ^= hash >> 31;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebull;
+    return hash ^ (hash >> 31);
+}
+
+static inline uint64_t
+key_hash(const void *key, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t*)key;
+    uint64_t hash = size * KEY_HASH_MULTIPLIER;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8){
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * KEY_HASH_MULTIPLIER;
+        hash ^= hash >> 32;
+    }
+    if (i < size){
+        uint64_t word = 0;
+        memcpy(&word, bytes + i, size - i);
+        hash = (hash ^ word) * KEY_HASH_MULTIPLIER;
+    }
+    return key_hash_mix(hash);
+}
+
+#endif
@@ -0,0 +1,50 @@
+#include "key_hash.h"
+#include <assert.h>
+#include <stdbool.h>
+
+void
+test_keys()
+{
+    uint8_t key[24] = {0};
+    uint64_t empty = key_hash(key, 0);
+    // the size counts, the zeros too
+    assert(key_hash(key, 4) != key_hash(key, 8));
+    assert(key_hash(key, 4) != empty);
+    assert(key_hash(key, 17) == key_hash(key, 17));
+
+    // a bit anywhere, the words and the tail
+    uint64_t zero = key_hash(key, sizeof(key) - 1);
+    for (size_t byte = 0; byte < sizeof(key) - 1; byte++){
+        key[byte] = 0x80;
+        assert(key_hash(key, sizeof(key) - 1) != zero);
+        key[byte] = 0;
+    }
+    // past the size, not read
+    key[sizeof(key) - 1] = 1;
+    assert(key_hash(key, sizeof(key) - 1) == zero);
+}
+
+void
+test_avalanche()
+{
+    // a bit of the key flips about half the bits of the hash, high and low
+    uint32_t flipped_high = 0;
+    uint32_t flipped_low = 0;
+    for (uint32_t value = 0; value < 1000; value++){
+        uint32_t key = value;
+        uint64_t hash = key_hash(&key, sizeof(key));
+        key ^= 1u << (value % 32);
+        uint64_t other = key_hash(&key, sizeof(key));
+        flipped_high += __builtin_popcountll((hash ^ other) >> 32);
+        flipped_low += __builtin_popcountll((hash ^ other) & 0xffffffff);
+    }
+    assert(flipped_high > 14000 && flipped_high < 18000);
+    assert(flipped_low > 14000 && flipped_low < 18000);
+}
+
+int main()
+{
+    test_keys();
+    test_avalanche();
+    return 0;
+}
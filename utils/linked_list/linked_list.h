@@ -1,6 +1,9 @@
 #ifndef LINKED_LIST_H
 #define LINKED_LIST_H
 
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 typedef struct node {
     void *data;
@@ -14,4 +17,8 @@ node_t *remove_node(node_t *head);
 void free_list(node_t *head);
 void free_list_nodes_only(node_t *head);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
\ No newline at end of file
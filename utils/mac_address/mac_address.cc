@@ -1,13 +1,10 @@
 #include "mac_address.h"
+#include "addr_format.h"
 
 std::string
 write_mac_address(const u_char *mac_address)
 {
-    std::ostringstream oss;
-    for (int i = 0; i < 6; i++){
-        if (i != 0)
-            oss << ":";
-        oss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(mac_address[i]);
-    }
-    return oss.str();
+    char text[MAC_ADDRESS_STRLEN];
+    size_t length = format_mac_address(mac_address, text);
+    return std::string(text, length);
 }
\ No newline at end of file
@@ -3,8 +3,6 @@
 
 #include <sys/types.h>
 #include <string>
-#include <sstream>
-#include <iomanip>
 
 std::string write_mac_address(const u_char *mac_address);
 
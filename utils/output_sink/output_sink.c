@@ -0,0 +1,286 @@
+#include "output_sink.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "stage_timer.h"
+
+static const char hex_digits[] = "0123456789abcdef";
+
+/**
+ * @brief Set up a sink writing to fd (or OUTPUT_SINK_NO_FD)
+ * 
+ * @param sink 
+ * @param fd 
+ * @param capacity initial size of the buffer
+ */
+void
+output_sink_init(output_sink_t *sink, int fd, size_t capacity)
+{
+    sink->fd = fd;
+    sink->length = 0;
+    sink->capacity = capacity > 0 ? capacity : OUTPUT_SINK_CAPACITY;
+    sink->data = malloc(sink->capacity);
+    if (sink->data == NULL){
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief Flush what is left and free the buffer
+ * 
+ * @param sink 
+ */
+void
+output_sink_destroy(output_sink_t *sink)
+{
+    output_sink_flush(sink);
+    free(sink->data);
+    sink->data = NULL;
+    sink->length = 0;
+    sink->capacity = 0;
+}
+
+/**
+ * @brief Write the whole buffer to the file descriptor
+ * 
+ * @param sink 
+ * @return int 0, -1 if write(2) failed (the text is dropped)
+ */
+int
+output_sink_flush(output_sink_t *sink)
+{
+    if (sink->fd == OUTPUT_SINK_NO_FD){
+        return 0;
+    }
+    STAGE_BEGIN(start);
+    size_t written = 0;
+    while (written < sink->length){
+        ssize_t n = write(sink->fd, sink->data + written, sink->length - written);
+        if (n < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            perror("write");
+            sink->length = 0;
+            STAGE_END(start, STAGE_OUTPUT);
+            return -1;
+        }
+        written += n;
+    }
+    sink->length = 0;
+    STAGE_END(start, STAGE_OUTPUT);
+    return 0;
+}
+
+/**
+ * @brief Forget the text in the buffer, without writing it
+ * 
+ * @param sink 
+ */
+void
+output_sink_reset(output_sink_t *sink)
+{
+    sink->length = 0;
+}
+
+/**
+ * @brief Make room for length more bytes, flushing or growing the buffer
+ * 
+ * @param sink 
+ * @param length 
+ * @return char* where to write them, the caller then adds length to sink->length
+ */
+char*
+output_sink_reserve(output_sink_t *sink, size_t length)
+{
+    if (sink->length + length > sink->capacity){
+        output_sink_flush(sink);
+    }
+    if (sink->length + length > sink->capacity){
+        size_t capacity = sink->capacity * 2;
+        while (capacity < sink->length + length){
+            capacity *= 2;
+        }
+        char *data = realloc(sink->data, capacity);
+        if (data == NULL){
+            perror("realloc");
+            exit(EXIT_FAILURE);
+        }
+        sink->data = data;
+        sink->capacity = capacity;
+    }
+    return sink->data + sink->length;
+}
+
+void
+output_sink_write(output_sink_t *sink, const void *data, size_t length)
+{
+    char *out = output_sink_reserve(sink, length);
+    memcpy(out, data, length);
+    sink->length += length;
+}
+
+void
+output_sink_puts(output_sink_t *sink, const char *string)
+{
+    output_sink_write(sink, string, strlen(string));
+}
+
+void
+output_sink_putc(output_sink_t *sink, char c)
+{
+    char *out = output_sink_reserve(sink, 1);
+    *out = c;
+    sink->length++;
+}
+
+/**
+ * @brief Append the decimal digits of value
+ * 
+ * @param sink 
+ * @param value 
+ */
+void
+output_sink_uint(output_sink_t *sink, uint64_t value)
+{
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+
+    char *out = output_sink_reserve(sink, count);
+    for (int i = 0; i < count; i++){
+        out[i] = digits[count - 1 - i];
+    }
+    sink->length += count;
+}
+
+void
+output_sink_int(output_sink_t *sink, int64_t value)
+{
+    if (value < 0){
+        output_sink_putc(sink, '-');
+        // negate as unsigned, INT64_MIN has no positive counterpart
+        output_sink_uint(sink, -(uint64_t)value);
+    } else {
+        output_sink_uint(sink, value);
+    }
+}
+
+/**
+ * @brief Append value in lowercase hex, without prefix,
+ * zero-padded to at least width digits (printf "%0*x")
+ * 
+ * @param sink 
+ * @param value 
+ * @param width 
+ */
+void
+output_sink_hex(output_sink_t *sink, uint64_t value, int width)
+{
+    char digits[16];
+    int count = 0;
+    do {
+        digits[count++] = hex_digits[value & 0xf];
+        value >>= 4;
+    } while (value != 0);
+    while (count < width && count < 16){
+        digits[count++] = '0';
+    }
+
+    char *out = output_sink_reserve(sink, count);
+    for (int i = 0; i < count; i++){
+        out[i] = digits[count - 1 - i];
+    }
+    sink->length += count;
+}
+
+/**
+ * @brief Append a dotted-quad IPv4 address (4 bytes, network order)
+ * 
+ * @param sink 
+ * @param address 
+ */
+void
+output_sink_ipv4(output_sink_t *sink, const uint8_t *address)
+{
+    char *out = output_sink_reserve(sink, 15);
+    char *start = out;
+    for (int i = 0; i < 4; i++){
+        uint8_t byte = address[i];
+        if (byte >= 100){
+            *out++ = '0' + byte / 100;
+            *out++ = '0' + (byte / 10) % 10;
+        } else if (byte >= 10){
+            *out++ = '0' + byte / 10;
+        }
+        *out++ = '0' + byte % 10;
+        if (i < 3){
+            *out++ = '.';
+        }
+    }
+    sink->length += out - start;
+}
+
+/**
+ * @brief Append a MAC address as aa:bb:cc:dd:ee:ff
+ * 
+ * @param sink 
+ * @param address 6 bytes
+ */
+void
+output_sink_mac(output_sink_t *sink, const uint8_t *address)
+{
+    char *out = output_sink_reserve(sink, 17);
+    for (int i = 0; i < 6; i++){
+        out[i * 3] = hex_digits[address[i] >> 4];
+        out[i * 3 + 1] = hex_digits[address[i] & 0xf];
+        if (i < 5){
+            out[i * 3 + 2] = ':';
+        }
+    }
+    sink->length += 17;
+}
+
+void
+output_sink_printf(output_sink_t *sink, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    output_sink_vprintf(sink, format, args);
+    va_end(args);
+}
+
+/**
+ * @brief printf straight into the buffer, for what the formatters don't cover
+ * 
+ * @param sink 
+ * @param format 
+ * @param args 
+ */
+void
+output_sink_vprintf(output_sink_t *sink, const char *format, va_list args)
+{
+    va_list retry;
+    va_copy(retry, args);
+    size_t available = sink->capacity - sink->length;
+    int length = vsnprintf(sink->data + sink->length, available, format, args);
+    if (length < 0){
+        va_end(retry);
+        return;
+    }
+    if ((size_t)length >= available){
+        // didn't fit, vsnprintf needs room for the terminating '\0'
+        char *out = output_sink_reserve(sink, length + 1);
+        vsnprintf(out, length + 1, format, retry);
+    }
+    sink->length += length;
+    va_end(retry);
+}
\ No newline at end of file
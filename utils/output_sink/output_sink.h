@@ -0,0 +1,56 @@
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Append buffer for the renderers.
+
+Every thread owns its sink, nothing is locked. Text is appended to the buffer
+and handed to write(2) in large blocks, when the buffer is full or when asked.
+A sink without a file descriptor (fd = -1) grows instead and keeps everything,
+the owner takes the text out and resets it.
+
+The integer, hex, IPv4 and MAC formatters write the digits straight into the
+buffer, without going through the printf machinery.
+*/
+
+#define OUTPUT_SINK_CAPACITY (1 << 20) // 1 MiB
+#define OUTPUT_SINK_NO_FD -1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct output_sink {
+    int fd;          // flushed to, or OUTPUT_SINK_NO_FD
+    char *data;
+    size_t length;
+    size_t capacity;
+} output_sink_t;
+
+void output_sink_init(output_sink_t *sink, int fd, size_t capacity);
+void output_sink_destroy(output_sink_t *sink);
+int output_sink_flush(output_sink_t *sink);
+void output_sink_reset(output_sink_t *sink);
+char* output_sink_reserve(output_sink_t *sink, size_t length);
+
+void output_sink_write(output_sink_t *sink, const void *data, size_t length);
+void output_sink_puts(output_sink_t *sink, const char *string);
+void output_sink_putc(output_sink_t *sink, char c);
+void output_sink_uint(output_sink_t *sink, uint64_t value);
+void output_sink_int(output_sink_t *sink, int64_t value);
+void output_sink_hex(output_sink_t *sink, uint64_t value, int width);
+void output_sink_ipv4(output_sink_t *sink, const uint8_t *address);
+void output_sink_mac(output_sink_t *sink, const uint8_t *address);
+void output_sink_printf(output_sink_t *sink, const char *format, ...) __attribute__((format(printf, 2, 3)));
+void output_sink_vprintf(output_sink_t *sink, const char *format, va_list args);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "output_sink.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// the text in a memory sink, as a string
+const char*
+sink_text(output_sink_t *sink)
+{
+    output_sink_putc(sink, '\0');
+    sink->length--;
+    return sink->data;
+}
+
+void
+test_formatters()
+{
+    output_sink_t sink;
+    output_sink_init(&sink, OUTPUT_SINK_NO_FD, 16);
+    char expected[64];
+
+    uint64_t values[] = {0, 1, 9, 10, 99, 100, 65535, 4294967295u, 18446744073709551615ull};
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++){
+        output_sink_reset(&sink);
+        output_sink_uint(&sink, values[i]);
+        snprintf(expected, sizeof(expected), "%llu", (unsigned long long)values[i]);
+        assert(strcmp(sink_text(&sink), expected) == 0);
+
+        output_sink_reset(&sink);
+        output_sink_hex(&sink, values[i], 4);
+        snprintf(expected, sizeof(expected), "%04llx", (unsigned long long)values[i]);
+        assert(strcmp(sink_text(&sink), expected) == 0);
+    }
+
+    output_sink_reset(&sink);
+    output_sink_int(&sink, -42);
+    output_sink_putc(&sink, ' ');
+    output_sink_int(&sink, INT64_MIN);
+    assert(strcmp(sink_text(&sink), "-42 -9223372036854775808") == 0);
+
+    uint8_t ipv4[4] = {192, 168, 0, 10};
+    output_sink_reset(&sink);
+    output_sink_ipv4(&sink, ipv4);
+    assert(strcmp(sink_text(&sink), "192.168.0.10") == 0);
+
+    uint8_t ipv4_zero[4] = {0, 0, 0, 0};
+    output_sink_reset(&sink);
+    output_sink_ipv4(&sink, ipv4_zero);
+    assert(strcmp(sink_text(&sink), "0.0.0.0") == 0);
+
+    uint8_t mac[6] = {0x00, 0x11, 0x22, 0xaa, 0xbb, 0xff};
+    output_sink_reset(&sink);
+    output_sink_mac(&sink, mac);
+    assert(strcmp(sink_text(&sink), "00:11:22:aa:bb:ff") == 0);
+
+    output_sink_destroy(&sink);
+}
+
+void
+test_memory_sink_grows()
+{
+    output_sink_t sink;
+    output_sink_init(&sink, OUTPUT_SINK_NO_FD, 8);
+
+    for (int i = 0; i < 1000; i++){
+        output_sink_puts(&sink, "abc");
+    }
+    assert(sink.length == 3000);
+    assert(sink.capacity >= 3000);
+    assert(memcmp(sink.data + 2997, "abc", 3) == 0);
+
+    // longer than what is left, printf has to retry
+    output_sink_reset(&sink);
+    output_sink_printf(&sink, "%s %d %s", "a long enough string", 12345, "to overflow");
+    assert(strcmp(sink_text(&sink), "a long enough string 12345 to overflow") == 0);
+
+    output_sink_destroy(&sink);
+}
+
+void
+test_flush_to_fd()
+{
+    int fds[2];
+    assert(pipe(fds) == 0);
+
+    output_sink_t sink;
+    output_sink_init(&sink, fds[1], 16);
+    output_sink_puts(&sink, "0123456789");
+    // nothing written until the buffer is full
+    output_sink_puts(&sink, "0123456789");
+    assert(sink.length == 10);
+    assert(sink.capacity == 16);
+    output_sink_printf(&sink, "|%d|", 7);
+    output_sink_destroy(&sink);
+    close(fds[1]);
+
+    char buffer[64] = {0};
+    ssize_t n = read(fds[0], buffer, sizeof(buffer) - 1);
+    close(fds[0]);
+    assert(n == 23);
+    assert(strcmp(buffer, "01234567890123456789|7|") == 0);
+}
+
+int
+main()
+{
+    test_formatters();
+    test_memory_sink_grows();
+    test_flush_to_fd();
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,186 @@
+#ifndef PACKET_CURSOR_H
+#define PACKET_CURSOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Where the decoding is in a packet, and how many captured bytes are left.
+With a small snaplen the capture keeps the first bytes of every packet
+only: a header can announce more than what follows it, every read past
+the first bytes has to be checked against caplen.
+
+    packet_cursor_t cursor = packet_cursor_init(packet, header->caplen);
+    packet_cursor_skip(&cursor, ETHER_HDR_LEN);
+    packet_cursor_limit(&cursor, ip_total_length);  // the Ethernet padding goes
+    const uint8_t *fixed = packet_cursor_bytes(&cursor, 10);
+    if (fixed == NULL){
+        // cut by the capture, cursor.truncated is set
+    }
+    uint16_t type = packet_load_u16(fixed);
+
+    +-----------------------+------------------------+ - - - - - - +
+    | decoded               | remaining              | not captured |
+    +-----------------------+------------------------+ - - - - - - +
+                            ^ data
+
+A fixed size header is checked once, packet_cursor_bytes() for all of it,
+then its fields are loaded without any other check. The checks expect to
+pass: the compiler lays the common path out straight.
+
+A read that doesn't fit gives nothing (NULL, 0), sets truncated and leaves
+the cursor at the end, the reads after it fail too: a parser can test
+truncated once, after reading a whole structure.
+
+All the functions are inline, the cursor is two words and a flag, it is
+passed and copied by value.
+*/
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PACKET_CURSOR_LIKELY(condition) __builtin_expect(!!(condition), 1)
+#else
+#define PACKET_CURSOR_LIKELY(condition) (condition)
+#endif
+
+typedef struct packet_cursor {
+    const uint8_t *data;    // next byte to decode
+    uint32_t remaining;     // captured bytes from data on
+    bool truncated;         // a read went past the captured bytes
+} packet_cursor_t;
+
+static inline packet_cursor_t
+packet_cursor_init(const uint8_t *data, uint32_t length)
+{
+    packet_cursor_t cursor = {data, length, false};
+    return cursor;
+}
+
+/**
+ * @brief A cursor at offset bytes from the start of another one,
+ * for the DNS compression pointers
+ *
+ * @param start
+ * @param offset
+ * @return packet_cursor_t truncated and empty if offset is past the end
+ */
+static inline packet_cursor_t
+packet_cursor_at(const packet_cursor_t *start, uint32_t offset)
+{
+    packet_cursor_t cursor = *start;
+    if (PACKET_CURSOR_LIKELY(offset <= start->remaining)){
+        cursor.data += offset;
+        cursor.remaining -= offset;
+    } else {
+        cursor.data += start->remaining;
+        cursor.remaining = 0;
+        cursor.truncated = true;
+    }
+    return cursor;
+}
+
+/**
+ * @brief Bytes decoded since start, a cursor copied earlier
+ *
+ * @param start
+ * @param cursor
+ * @return uint32_t
+ */
+static inline uint32_t
+packet_cursor_offset(const packet_cursor_t *start, const packet_cursor_t *cursor)
+{
+    return (uint32_t)(cursor->data - start->data);
+}
+
+static inline bool
+packet_cursor_has(const packet_cursor_t *cursor, uint32_t length)
+{
+    return length <= cursor->remaining;
+}
+
+/**
+ * @brief Take length bytes
+ *
+ * @param cursor
+ * @param length
+ * @return const uint8_t* the first one, NULL if they were not all captured
+ */
+static inline const uint8_t*
+packet_cursor_bytes(packet_cursor_t *cursor, uint32_t length)
+{
+    if (PACKET_CURSOR_LIKELY(length <= cursor->remaining)){
+        const uint8_t *bytes = cursor->data;
+        cursor->data += length;
+        cursor->remaining -= length;
+        return bytes;
+    }
+    cursor->data += cursor->remaining;
+    cursor->remaining = 0;
+    cursor->truncated = true;
+    return NULL;
+}
+
+/**
+ * @brief Go over length bytes
+ *
+ * @param cursor
+ * @param length
+ * @return true if they were all captured
+ */
+static inline bool
+packet_cursor_skip(packet_cursor_t *cursor, uint32_t length)
+{
+    return packet_cursor_bytes(cursor, length) != NULL;
+}
+
+/**
+ * @brief Stop the cursor length bytes from here, at the end of the
+ * layer when its header gives its length. Past what was captured,
+ * nothing changes.
+ *
+ * @param cursor
+ * @param length
+ */
+static inline void
+packet_cursor_limit(packet_cursor_t *cursor, uint32_t length)
+{
+    if (length < cursor->remaining){
+        cursor->remaining = length;
+    }
+}
+
+// big endian loads, from bytes packet_cursor_bytes() gave, at any alignment
+static inline uint16_t
+packet_load_u16(const uint8_t *bytes)
+{
+    return (uint16_t)((bytes[0] << 8) | bytes[1]);
+}
+
+static inline uint32_t
+packet_load_u32(const uint8_t *bytes)
+{
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+}
+
+static inline uint8_t
+packet_cursor_u8(packet_cursor_t *cursor)
+{
+    const uint8_t *bytes = packet_cursor_bytes(cursor, 1);
+    return (bytes != NULL) ? bytes[0] : 0;
+}
+
+static inline uint16_t
+packet_cursor_u16(packet_cursor_t *cursor)
+{
+    const uint8_t *bytes = packet_cursor_bytes(cursor, 2);
+    return (bytes != NULL) ? packet_load_u16(bytes) : 0;
+}
+
+static inline uint32_t
+packet_cursor_u32(packet_cursor_t *cursor)
+{
+    const uint8_t *bytes = packet_cursor_bytes(cursor, 4);
+    return (bytes != NULL) ? packet_load_u32(bytes) : 0;
+}
+
+#endif
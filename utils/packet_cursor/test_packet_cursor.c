@@ -0,0 +1,91 @@
+#include "packet_cursor.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+static const uint8_t bytes[] = {0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde};
+
+void
+test_reads()
+{
+    packet_cursor_t cursor = packet_cursor_init(bytes, sizeof(bytes));
+    assert(packet_cursor_u8(&cursor) == 0x12);
+    assert(packet_cursor_u16(&cursor) == 0x3456);
+    assert(packet_cursor_u32(&cursor) == 0x789abcde);
+    assert(cursor.remaining == 0);
+    assert(!cursor.truncated);
+    assert(packet_cursor_has(&cursor, 0));
+    assert(!packet_cursor_has(&cursor, 1));
+}
+
+void
+test_fixed_header()
+{
+    packet_cursor_t cursor = packet_cursor_init(bytes, sizeof(bytes));
+    const uint8_t *fixed = packet_cursor_bytes(&cursor, 4);
+    assert(fixed == bytes);
+    assert(packet_load_u16(fixed + 2) == 0x5678);
+    assert(packet_load_u32(fixed) == 0x12345678);
+    assert(cursor.data == bytes + 4);
+    assert(cursor.remaining == 3);
+}
+
+void
+test_truncated()
+{
+    packet_cursor_t cursor = packet_cursor_init(bytes, sizeof(bytes));
+    assert(packet_cursor_skip(&cursor, 5));
+    // two bytes left, a u32 doesn't fit
+    assert(packet_cursor_u32(&cursor) == 0);
+    assert(cursor.truncated);
+    assert(cursor.remaining == 0);
+    assert(cursor.data == bytes + sizeof(bytes));
+    // and every read after it fails too
+    assert(packet_cursor_u8(&cursor) == 0);
+    assert(packet_cursor_bytes(&cursor, 1) == NULL);
+    assert(packet_cursor_bytes(&cursor, 0) != NULL);
+}
+
+void
+test_limit()
+{
+    packet_cursor_t cursor = packet_cursor_init(bytes, sizeof(bytes));
+    // a header that gives less than what was captured, the rest is padding
+    packet_cursor_limit(&cursor, 3);
+    assert(cursor.remaining == 3);
+    // more than what was captured, snaplen wins
+    packet_cursor_limit(&cursor, 1000);
+    assert(cursor.remaining == 3);
+    assert(!packet_cursor_skip(&cursor, 4));
+    assert(cursor.truncated);
+}
+
+void
+test_at()
+{
+    const packet_cursor_t message = packet_cursor_init(bytes, sizeof(bytes));
+    packet_cursor_t cursor = packet_cursor_at(&message, 6);
+    assert(packet_cursor_u8(&cursor) == 0xde);
+    assert(packet_cursor_offset(&message, &cursor) == 7);
+    assert(!cursor.truncated);
+
+    cursor = packet_cursor_at(&message, 7);
+    assert(cursor.remaining == 0);
+    assert(!cursor.truncated);
+
+    cursor = packet_cursor_at(&message, 0x3fff);
+    assert(cursor.truncated);
+    assert(cursor.remaining == 0);
+    assert(packet_cursor_u8(&cursor) == 0);
+}
+
+int
+main()
+{
+    test_reads();
+    test_fixed_header();
+    test_truncated();
+    test_limit();
+    test_at();
+    return 0;
+}
@@ -0,0 +1,72 @@
+#ifndef SMALL_VECTOR_H
+#define SMALL_VECTOR_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+
+/*
+Typed array with its first elements stored inline, for the sections of a
+decoded message: a DNS answer or a DHCP option list usually holds a few
+elements, sometimes hundreds.
+
+    SMALL_VECTOR(dns_records, resource_record_t, 4)
+
+declares dns_records_t and its functions:
+
+    dns_records_init(&vector)              empty, the inline storage in use
+    dns_records_push(&vector, arena)       a new, uninitialised, last element
+    dns_records_items(&vector)[i]          i < vector.count
+
+    +-------------------------+---------+-------+----------+
+    | inline_items[0..4)      | spilled | count | capacity |
+    +-------------------------+---------+-------+----------+
+                                   |
+                                   +--> [0 .. capacity) in the arena
+
+The elements stay contiguous: past the inline capacity they all move to
+the arena, in a block twice as large every time it fills up, so appending
+is amortised O(1). Nothing is freed, the blocks go with the arena's reset.
+
+The vector can be copied (a parser returns it by value), items() picks the
+storage on every call: never keep a pointer to an inline element across
+a copy.
+*/
+
+#define SMALL_VECTOR(name, type, inline_capacity)                                   \
+typedef struct name {                                                               \
+    type inline_items[inline_capacity];                                             \
+    type *spilled;          /* all the elements once past inline_capacity */        \
+    uint32_t count;                                                                 \
+    uint32_t capacity;                                                              \
+} name##_t;                                                                         \
+                                                                                    \
+static inline void                                                                  \
+name##_init(name##_t *vector)                                                       \
+{                                                                                   \
+    vector->spilled = NULL;                                                         \
+    vector->count = 0;                                                              \
+    vector->capacity = (inline_capacity);                                           \
+}                                                                                   \
+                                                                                    \
+static inline type*                                                                 \
+name##_items(const name##_t *vector)                                                \
+{                                                                                   \
+    return vector->spilled != NULL ? vector->spilled : (type*)vector->inline_items; \
+}                                                                                   \
+                                                                                    \
+static inline type*                                                                 \
+name##_push(name##_t *vector, arena_t *arena)                                       \
+{                                                                                   \
+    if (vector->count == vector->capacity){                                         \
+        uint32_t capacity = vector->capacity * 2;                                   \
+        type *items = (type*)arena_alloc(arena, capacity * sizeof(type));           \
+        memcpy(items, name##_items(vector), vector->count * sizeof(type));          \
+        vector->spilled = items;                                                    \
+        vector->capacity = capacity;                                                \
+    }                                                                               \
+    return name##_items(vector) + vector->count++;                                  \
+}
+
+#endif
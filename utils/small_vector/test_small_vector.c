@@ -0,0 +1,73 @@
+#include "small_vector.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+typedef struct pair {
+    int key;
+    const char *value;
+} pair_t;
+
+SMALL_VECTOR(pairs, pair_t, 4)
+
+void
+test_inline()
+{
+    arena_t arena;
+    arena_init(&arena, 1024);
+
+    pairs_t pairs;
+    pairs_init(&pairs);
+    assert(pairs.count == 0);
+    for (int i = 0; i < 4; i++){
+        pair_t *pair = pairs_push(&pairs, &arena);
+        pair->key = i;
+        pair->value = "inline";
+    }
+    // nothing taken from the arena yet
+    assert(pairs.spilled == NULL);
+    assert(arena.used == 0);
+    assert(pairs_items(&pairs) == pairs.inline_items);
+    assert(pairs_items(&pairs)[3].key == 3);
+
+    // a copy reads its own inline storage
+    pairs_t copy = pairs;
+    assert(pairs_items(&copy) == copy.inline_items);
+    assert(pairs_items(&copy)[2].key == 2);
+    arena_destroy(&arena);
+}
+
+void
+test_spill()
+{
+    arena_t arena;
+    arena_init(&arena, 64);
+
+    pairs_t pairs;
+    pairs_init(&pairs);
+    for (int i = 0; i < 1000; i++){
+        pair_t *pair = pairs_push(&pairs, &arena);
+        pair->key = i;
+        pair->value = "spilled";
+    }
+    assert(pairs.count == 1000);
+    assert(pairs.capacity == 1024);
+    assert(pairs.spilled != NULL);
+
+    // still in order and contiguous, in the copy as well
+    pairs_t copy = pairs;
+    pair_t *items = pairs_items(&copy);
+    for (int i = 0; i < 1000; i++){
+        assert(items[i].key == i);
+        assert(&items[i] == &pairs_items(&pairs)[i]);
+    }
+    arena_destroy(&arena);
+}
+
+int
+main()
+{
+    test_inline();
+    test_spill();
+    return 0;
+}
@@ -0,0 +1,263 @@
+#include "space_saving.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Allocate the counters, their heap and their index
+ *
+ * @param capacity keys counted at once
+ * @param key_size bytes
+ * @return space_saving_t*
+ */
+space_saving_t*
+space_saving_create(uint32_t capacity, uint32_t key_size)
+{
+    space_saving_t *summary = (space_saving_t*)calloc(1, sizeof(space_saving_t));
+    if (summary == NULL){
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    summary->capacity = capacity > 0 ? capacity : 1;
+    summary->key_size = key_size;
+    uint32_t slots = 2;
+    while (slots < summary->capacity * 2){
+        slots *= 2;
+    }
+    summary->index_mask = slots - 1;
+    summary->entries = (space_saving_entry_t*)calloc(summary->capacity, sizeof(space_saving_entry_t));
+    summary->keys = (uint8_t*)calloc(summary->capacity, key_size);
+    summary->heap = (space_saving_node_t*)calloc(summary->capacity, sizeof(space_saving_node_t));
+    summary->index = (space_saving_slot_t*)malloc((size_t)slots * sizeof(space_saving_slot_t));
+    if (summary->entries == NULL || summary->keys == NULL || summary->heap == NULL || summary->index == NULL){
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    memset(summary->index, 0xff, (size_t)slots * sizeof(space_saving_slot_t));
+    return summary;
+}
+
+void
+space_saving_destroy(space_saving_t *summary)
+{
+    free(summary->entries);
+    free(summary->keys);
+    free(summary->heap);
+    free(summary->index);
+    free(summary);
+}
+
+// bytes per key counted, for a capacity from a memory budget
+size_t
+space_saving_entry_memory(uint32_t key_size)
+{
+    // two index slots per entry
+    return sizeof(space_saving_entry_t) + key_size + sizeof(space_saving_node_t) + 2 * sizeof(space_saving_slot_t);
+}
+
+// the slot of the key in the index, or the empty one ending its probe
+static uint32_t
+space_saving_slot(const space_saving_t *summary, const void *key, uint64_t hash)
+{
+    uint32_t slot = (uint32_t)hash & summary->index_mask;
+    for (;;){
+        uint32_t entry = summary->index[slot].entry;
+        if (entry == SPACE_SAVING_NONE){
+            return slot;
+        }
+        if (summary->index[slot].hash == (uint32_t)hash && summary->entries[entry].hash == hash
+            && memcmp(space_saving_key(summary, entry), key, summary->key_size) == 0){
+            return slot;
+        }
+        slot = (slot + 1) & summary->index_mask;
+    }
+}
+
+// empty the slot, the entries probed past it move back into the hole
+static void
+space_saving_unindex(space_saving_t *summary, uint32_t slot)
+{
+    uint32_t mask = summary->index_mask;
+    uint32_t hole = slot;
+    for (uint32_t i = (slot + 1) & mask; summary->index[i].entry != SPACE_SAVING_NONE; i = (i + 1) & mask){
+        uint32_t home = summary->index[i].hash & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask)){
+            summary->index[hole] = summary->index[i];
+            hole = i;
+        }
+    }
+    summary->index[hole].entry = SPACE_SAVING_NONE;
+}
+
+static inline void
+space_saving_place(space_saving_t *summary, uint32_t position, space_saving_node_t node)
+{
+    summary->heap[position] = node;
+    summary->entries[node.entry].heap = position;
+}
+
+static void
+space_saving_sift_up(space_saving_t *summary, uint32_t position)
+{
+    space_saving_node_t node = summary->heap[position];
+    while (position > 0){
+        uint32_t parent = (position - 1) / 2;
+        if (summary->heap[parent].count <= node.count){
+            break;
+        }
+        space_saving_place(summary, position, summary->heap[parent]);
+        position = parent;
+    }
+    space_saving_place(summary, position, node);
+}
+
+static void
+space_saving_sift_down(space_saving_t *summary, uint32_t position)
+{
+    space_saving_node_t node = summary->heap[position];
+    space_saving_node_t *heap = summary->heap;
+    for (;;){
+        uint32_t child = position * 2 + 1;
+        if (child >= summary->count){
+            break;
+        }
+        if (child + 1 < summary->count && heap[child + 1].count < heap[child].count){
+            child++;
+        }
+        if (heap[child].count >= node.count){
+            break;
+        }
+        space_saving_place(summary, position, heap[child]);
+        position = child;
+    }
+    space_saving_place(summary, position, node);
+}
+
+// count weight more for the key, error more on its counter
+static void
+space_saving_count(space_saving_t *summary, const void *key, uint64_t hash, uint64_t weight, uint64_t error)
+{
+    summary->total += weight;
+    uint32_t slot = space_saving_slot(summary, key, hash);
+    uint32_t entry = summary->index[slot].entry;
+    if (entry != SPACE_SAVING_NONE){
+        space_saving_entry_t *counter = &summary->entries[entry];
+        counter->count += weight;
+        counter->error += error;
+        summary->heap[counter->heap].count = counter->count;
+        space_saving_sift_down(summary, counter->heap);
+        return;
+    }
+
+    bool replaced = summary->count == summary->capacity;
+    if (!replaced){
+        entry = summary->count++;
+        summary->entries[entry].count = weight;
+        summary->entries[entry].error = error;
+        summary->heap[entry].count = weight;
+        summary->heap[entry].entry = entry;
+        summary->entries[entry].heap = entry;
+    } else {
+        // the smallest counter goes to the new key, its count as the error
+        entry = summary->heap[0].entry;
+        space_saving_entry_t *smallest = &summary->entries[entry];
+        space_saving_unindex(summary, space_saving_slot(summary, space_saving_key(summary, entry), smallest->hash));
+        smallest->error = smallest->count + error;
+        smallest->count += weight;
+        summary->heap[0].count = smallest->count;
+        // the new key's slot moved with the others
+        slot = space_saving_slot(summary, key, hash);
+    }
+    summary->entries[entry].hash = hash;
+    memcpy(summary->keys + (size_t)entry * summary->key_size, key, summary->key_size);
+    summary->index[slot].entry = entry;
+    summary->index[slot].hash = (uint32_t)hash;
+    if (replaced){
+        space_saving_sift_down(summary, 0);
+    } else {
+        space_saving_sift_up(summary, entry);
+    }
+}
+
+/**
+ * @brief Count the weight of a key
+ *
+ * @param summary
+ * @param key key_size bytes
+ * @param hash of the key
+ * @param weight
+ */
+void
+space_saving_add(space_saving_t *summary, const void *key, uint64_t hash, uint64_t weight)
+{
+    space_saving_count(summary, key, hash, weight, 0);
+}
+
+/**
+ * @brief Add the counters of another summary, of the same key size
+ *
+ * @param summary
+ * @param other
+ */
+void
+space_saving_merge(space_saving_t *summary, const space_saving_t *other)
+{
+    // the counts add up to the total, it follows them
+    for (uint32_t entry = 0; entry < other->count; entry++){
+        const space_saving_entry_t *counter = &other->entries[entry];
+        space_saving_count(summary, space_saving_key(other, entry), counter->hash, counter->count, counter->error);
+    }
+}
+
+/**
+ * @brief The entry counting a key
+ *
+ * @return uint32_t SPACE_SAVING_NONE if the key isn't counted
+ */
+uint32_t
+space_saving_find(const space_saving_t *summary, const void *key, uint64_t hash)
+{
+    return summary->index[space_saving_slot(summary, key, hash)].entry;
+}
+
+/**
+ * @brief An overestimate of a key's weight: its count, the smallest
+ * count if it isn't counted (0 while the summary isn't full)
+ */
+uint64_t
+space_saving_estimate(const space_saving_t *summary, const void *key, uint64_t hash)
+{
+    uint32_t entry = space_saving_find(summary, key, hash);
+    if (entry != SPACE_SAVING_NONE){
+        return summary->entries[entry].count;
+    }
+    return (summary->count == summary->capacity) ? summary->heap[0].count : 0;
+}
+
+/**
+ * @brief The n entries with the largest counts
+ *
+ * @param summary
+ * @param n
+ * @param entries n of them, the largest count first
+ * @return uint32_t how many there are, n at most
+ */
+uint32_t
+space_saving_top(const space_saving_t *summary, uint32_t n, uint32_t *entries)
+{
+    uint32_t found = 0;
+    for (uint32_t entry = 0; entry < summary->count; entry++){
+        uint64_t count = summary->entries[entry].count;
+        if (found == n && (n == 0 || count <= summary->entries[entries[found - 1]].count)){
+            continue;
+        }
+        uint32_t i = (found < n) ? found++ : found - 1;
+        while (i > 0 && summary->entries[entries[i - 1]].count < count){
+            entries[i] = entries[i - 1];
+            i--;
+        }
+        entries[i] = entry;
+    }
+    return found;
+}
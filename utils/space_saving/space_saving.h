@@ -0,0 +1,89 @@
+#ifndef SPACE_SAVING_H
+#define SPACE_SAVING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+The heaviest keys of a stream in fixed memory, with the Space-Saving
+algorithm (Metwally, Agrawal, El Abbadi 2005): capacity counters, a key
+not counted yet takes the smallest one over, and inherits its count as
+its error.
+
+    count            an overestimate of the key's weight
+    count - error    an underestimate
+    min count        bounds the weight of any key not counted
+
+every key heavier than total / capacity is counted. The counters are in a
+binary min-heap, so the smallest is at the root; the heap holds a copy of
+their counts, a sift compares within one array. An index, open addressing
+on the key's hash, finds a key's counter. Keys have a fixed size, the
+caller pads them with zeros, and come with their hash (64 bits, the same
+for every instance: the caller's hash is also the Count-Min's).
+Weights are packets, bytes, anything additive.
+
+Two summaries of the same key size merge by adding the counters of one to
+the other, the errors with them (the mergeable summaries of Agarwal et al.
+2012, without the final pruning).
+*/
+
+#define SPACE_SAVING_NONE UINT32_MAX
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct space_saving_entry {
+    uint64_t hash;
+    uint64_t count;
+    uint64_t error;
+    uint32_t heap;          // position in the heap
+} space_saving_entry_t;
+
+// an index slot, the low half of the hash beside the entry: the probes
+// and the shifts stay in the index
+typedef struct space_saving_slot {
+    uint32_t entry;         // SPACE_SAVING_NONE when empty
+    uint32_t hash;
+} space_saving_slot_t;
+
+// the counts again in the heap, compared without going to the entries
+typedef struct space_saving_node {
+    uint64_t count;
+    uint32_t entry;
+} space_saving_node_t;
+
+typedef struct space_saving {
+    uint32_t capacity;
+    uint32_t count;         // entries used
+    uint32_t key_size;
+    space_saving_entry_t *entries;
+    uint8_t *keys;          // key_size bytes per entry
+    space_saving_node_t *heap;  // the smallest count at 0
+    space_saving_slot_t *index;
+    uint32_t index_mask;
+    uint64_t total;         // weight of everything added
+} space_saving_t;
+
+space_saving_t* space_saving_create(uint32_t capacity, uint32_t key_size);
+void space_saving_destroy(space_saving_t *summary);
+size_t space_saving_entry_memory(uint32_t key_size);
+
+void space_saving_add(space_saving_t *summary, const void *key, uint64_t hash, uint64_t weight);
+void space_saving_merge(space_saving_t *summary, const space_saving_t *other);
+uint32_t space_saving_find(const space_saving_t *summary, const void *key, uint64_t hash);
+uint64_t space_saving_estimate(const space_saving_t *summary, const void *key, uint64_t hash);
+uint32_t space_saving_top(const space_saving_t *summary, uint32_t n, uint32_t *entries);
+
+static inline const void*
+space_saving_key(const space_saving_t *summary, uint32_t entry)
+{
+    return summary->keys + (size_t)entry * summary->key_size;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,155 @@
+#include "space_saving.h"
+#include <cassert>
+#include <cstring>
+
+// a 4 byte key and a hash mixing it
+static uint64_t
+key_hash(uint32_t key)
+{
+    uint64_t hash = (key + 1) * 0x9e3779b97f4a7c15ull;
+    return hash ^ (hash >> 29);
+}
+
+static void
+add(space_saving_t *summary, uint32_t key, uint64_t weight)
+{
+    space_saving_add(summary, &key, key_hash(key), weight);
+}
+
+static uint32_t
+entry_key(const space_saving_t *summary, uint32_t entry)
+{
+    uint32_t key;
+    memcpy(&key, space_saving_key(summary, entry), sizeof(key));
+    return key;
+}
+
+// the heap and the index agree with the entries
+static void
+check(const space_saving_t *summary)
+{
+    for (uint32_t position = 0; position < summary->count; position++){
+        uint32_t entry = summary->heap[position].entry;
+        assert(summary->entries[entry].heap == position);
+        assert(summary->heap[position].count == summary->entries[entry].count);
+        if (position > 0){
+            assert(summary->heap[(position - 1) / 2].count <= summary->heap[position].count);
+        }
+        assert(space_saving_find(summary, space_saving_key(summary, entry), summary->entries[entry].hash) == entry);
+    }
+    uint32_t indexed = 0;
+    for (uint32_t slot = 0; slot <= summary->index_mask; slot++){
+        indexed += summary->index[slot].entry != SPACE_SAVING_NONE;
+    }
+    assert(indexed == summary->count);
+}
+
+void
+test_exact()
+{
+    // room for every key: the counts are exact
+    space_saving_t *summary = space_saving_create(8, sizeof(uint32_t));
+    for (uint32_t key = 0; key < 8; key++){
+        add(summary, key, key + 1);
+        add(summary, key, 10);
+    }
+    check(summary);
+    assert(summary->count == 8 && summary->total == 8 * 10 + 36);
+    uint32_t key = 5;
+    assert(space_saving_estimate(summary, &key, key_hash(key)) == 16);
+
+    uint32_t top[3];
+    assert(space_saving_top(summary, 3, top) == 3);
+    assert(entry_key(summary, top[0]) == 7 && entry_key(summary, top[1]) == 6 && entry_key(summary, top[2]) == 5);
+    assert(summary->entries[top[0]].error == 0);
+    uint32_t all[16];
+    assert(space_saving_top(summary, 16, all) == 8);
+    space_saving_destroy(summary);
+}
+
+void
+test_replace()
+{
+    space_saving_t *summary = space_saving_create(2, sizeof(uint32_t));
+    add(summary, 1, 5);
+    add(summary, 2, 3);
+    // the smallest one, 2, makes room for 3
+    add(summary, 3, 1);
+    check(summary);
+    uint32_t key = 2;
+    assert(space_saving_find(summary, &key, key_hash(key)) == SPACE_SAVING_NONE);
+    key = 3;
+    uint32_t entry = space_saving_find(summary, &key, key_hash(key));
+    assert(entry != SPACE_SAVING_NONE);
+    assert(summary->entries[entry].count == 4 && summary->entries[entry].error == 3);
+    // a key not counted weighs at most the smallest count
+    key = 99;
+    assert(space_saving_estimate(summary, &key, key_hash(key)) == 4);
+    space_saving_destroy(summary);
+}
+
+void
+test_heavy_hitters()
+{
+    // 10 heavy keys among 100000 light ones, 64 counters
+    space_saving_t *summary = space_saving_create(64, sizeof(uint32_t));
+    uint64_t state = 88172645463325252ull;
+    for (uint32_t i = 0; i < 200000; i++){
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        if (i % 2 == 0){
+            add(summary, 1000000 + i / 2 % 10, 1);
+        } else {
+            add(summary, state % 100000, 1);
+        }
+    }
+    check(summary);
+    assert(summary->total == 200000);
+
+    uint32_t top[10];
+    assert(space_saving_top(summary, 10, top) == 10);
+    for (uint32_t i = 0; i < 10; i++){
+        const space_saving_entry_t *counter = &summary->entries[top[i]];
+        assert(entry_key(summary, top[i]) >= 1000000);
+        // 10000 each, counted within total / capacity
+        assert(counter->count >= 10000 && counter->count - counter->error <= 10000);
+        assert(counter->count - 10000 <= summary->total / summary->capacity);
+        if (i > 0){
+            assert(summary->entries[top[i - 1]].count >= counter->count);
+        }
+    }
+    space_saving_destroy(summary);
+}
+
+void
+test_merge()
+{
+    space_saving_t *first = space_saving_create(16, sizeof(uint32_t));
+    space_saving_t *second = space_saving_create(16, sizeof(uint32_t));
+    for (uint32_t key = 0; key < 40; key++){
+        add(first, key, (key == 7) ? 1000 : 1);
+        add(second, key + 20, (key == 7) ? 500 : 1);
+    }
+    // 7 heaviest on the first, 27 on the second
+    space_saving_merge(first, second);
+    check(first);
+    assert(first->total == 1039 + 539);
+
+    uint32_t top[2];
+    assert(space_saving_top(first, 2, top) == 2);
+    assert(entry_key(first, top[0]) == 7 && entry_key(first, top[1]) == 27);
+    const space_saving_entry_t *counter = &first->entries[top[1]];
+    assert(counter->count >= 500 && counter->count - counter->error <= 500);
+    space_saving_destroy(second);
+    space_saving_destroy(first);
+}
+
+int main()
+{
+    test_exact();
+    test_replace();
+    test_heavy_hitters();
+    test_merge();
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include "stage_timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define STAGE_OVERHEAD_ROUNDS 1000
+
+const char *stage_names[STAGE_KINDS] = {
+    "capture", "handler", "flows", "dns tracker", "parse", "dissect",
+    "ethernet", "arp", "ipv4", "ipv6", "icmp", "icmpv6", "tcp", "udp", "dns", "dhcp",
+    "checksums", "top", "distinct", "stats", "render", "output",
+};
+
+const uint8_t stage_depths[STAGE_KINDS] = {
+    0, 0, 1, 1, 1, 2,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    4, 2, 2, 2, 2, 3,
+};
+
+bool stage_timer_enabled = false;
+__thread stage_profile_t *stage_timer_local = NULL;
+__thread uint64_t stage_timer_mark = 0;
+
+// the clocks when the timers were enabled, to convert the ticks
+static uint64_t stage_origin_ticks = 0;
+static uint64_t stage_origin_ns = 0;
+static double stage_overhead_ticks = 0;
+
+static uint64_t
+stage_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Start timing, in every thread, and measure what an empty timer costs
+ *
+ */
+void
+stage_timer_enable()
+{
+    uint64_t start = stage_clock();
+    for (int i = 0; i < STAGE_OVERHEAD_ROUNDS; i++){
+        uint64_t begin = stage_clock();
+        __asm__ volatile("" : : "r"(begin) : "memory");
+    }
+    stage_overhead_ticks = (double)(stage_clock() - start) / STAGE_OVERHEAD_ROUNDS;
+    stage_origin_ticks = stage_clock();
+    stage_origin_ns = stage_now_ns();
+    stage_timer_enabled = true;
+}
+
+/**
+ * @brief Nanoseconds per tick, from the ticks and the nanoseconds since
+ * stage_timer_enable(); waits a little right after it
+ *
+ * @return double
+ */
+double
+stage_timer_tick_ns()
+{
+    uint64_t ns;
+    do {
+        ns = stage_now_ns();
+    } while (ns - stage_origin_ns < 10000000);
+    uint64_t ticks = stage_clock() - stage_origin_ticks;
+    return ticks > 0 ? (double)(ns - stage_origin_ns) / ticks : 1.0;
+}
+
+/**
+ * @brief The ticks of reading the clock twice, counted in every stage
+ *
+ * @return double
+ */
+double
+stage_timer_overhead()
+{
+    return stage_overhead_ticks;
+}
+
+/**
+ * @brief Allocate an empty profile
+ *
+ * @return stage_profile_t*
+ */
+stage_profile_t*
+stage_profile_create()
+{
+    stage_profile_t *profile = (stage_profile_t*)malloc(sizeof(stage_profile_t));
+    if (profile == NULL){
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t i = 0; i < STAGE_KINDS; i++){
+        histogram_init(&profile->stages[i]);
+    }
+    return profile;
+}
+
+void
+stage_profile_destroy(stage_profile_t *profile)
+{
+    free(profile);
+}
+
+void
+stage_profile_merge(stage_profile_t *profile, const stage_profile_t *other)
+{
+    for (uint32_t i = 0; i < STAGE_KINDS; i++){
+        histogram_merge(&profile->stages[i], &other->stages[i]);
+    }
+}
+
+// the calling thread's profile, on its first timer
+stage_profile_t*
+stage_timer_local_create()
+{
+    stage_timer_local = stage_profile_create();
+    return stage_timer_local;
+}
+
+/**
+ * @brief The calling thread's profile, NULL if it timed nothing; the
+ * caller frees it, the next timer starts another one
+ *
+ * @return stage_profile_t*
+ */
+stage_profile_t*
+stage_timer_take()
+{
+    stage_profile_t *profile = stage_timer_local;
+    stage_timer_local = NULL;
+    stage_timer_mark = 0;
+    return profile;
+}
@@ -0,0 +1,175 @@
+#ifndef STAGE_TIMER_H
+#define STAGE_TIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "histogram.h"
+
+/*
+Where the time of a packet goes, stage by stage: a timer reads the cycle
+counter (rdtsc, cntvct_el0, clock_gettime elsewhere) when a stage starts
+and records the ticks it took when it ends, in the calling thread's
+histogram of that stage. Nothing is shared or locked per packet; a thread
+hands its histograms over when it ends (stage_timer_take).
+
+    STAGE_BEGIN(start);                 // C: a variable, 0 when not timing
+    parse_cli_nth(...);
+    STAGE_END(start, STAGE_PARSE);
+
+    {
+        STAGE_SCOPE(STAGE_CHECKSUMS);   // C++: until the end of the block
+        ...
+    }
+
+The stages nest as they are called, each one counts its inner ones:
+
+    capture         between two packets: libpcap, the ring, the file
+    handler         packet_handler()
+      flows, dns tracker
+      parse         parse_cli_nth()
+        dissect       dissect(), and a stage per layer decoded or walked
+          checksums     the TCP and UDP ones, with LAYER_CHECKSUMS
+        top, distinct, stats
+        render        text, ndjson or columns
+          output        write(2) of a full sink, wherever it happens
+
+Built with STAGE_TIMER_ENABLED (cmake -DPCAPNA_PROFILE=ON, the default) a
+timer costs a test of stage_timer_enabled until --profile sets it; built
+without, the macros are empty.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum stage {
+    STAGE_CAPTURE,
+    STAGE_HANDLER,
+    STAGE_FLOWS,
+    STAGE_DNS_TRACKER,
+    STAGE_PARSE,
+    STAGE_DISSECT,
+    // in the order of layer_kind_t
+    STAGE_ETHERNET,
+    STAGE_ARP,
+    STAGE_IPV4,
+    STAGE_IPV6,
+    STAGE_ICMP,
+    STAGE_ICMPV6,
+    STAGE_TCP,
+    STAGE_UDP,
+    STAGE_DNS,
+    STAGE_DHCP,
+    STAGE_CHECKSUMS,
+    STAGE_TOP,
+    STAGE_DISTINCT,
+    STAGE_STATS,
+    STAGE_RENDER,
+    STAGE_OUTPUT,
+    STAGE_KINDS
+} stage_t;
+
+typedef struct stage_profile {
+    histogram_t stages[STAGE_KINDS];    // ticks
+} stage_profile_t;
+
+extern const char *stage_names[STAGE_KINDS];
+extern const uint8_t stage_depths[STAGE_KINDS];    // under the handler, for the report
+
+extern bool stage_timer_enabled;
+extern __thread stage_profile_t *stage_timer_local;
+extern __thread uint64_t stage_timer_mark;     // the end of the last packet, for STAGE_CAPTURE
+
+void stage_timer_enable();
+double stage_timer_tick_ns();
+double stage_timer_overhead();
+stage_profile_t* stage_timer_local_create();
+stage_profile_t* stage_timer_take();
+stage_profile_t* stage_profile_create();
+void stage_profile_destroy(stage_profile_t *profile);
+void stage_profile_merge(stage_profile_t *profile, const stage_profile_t *other);
+
+// ticks, as cheap as the CPU has them
+static inline uint64_t
+stage_clock()
+{
+#if defined(__x86_64__)
+    uint32_t low, high;
+    __asm__ volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static inline void
+stage_record_ticks(stage_t stage, uint64_t ticks)
+{
+    stage_profile_t *profile = stage_timer_local != NULL ? stage_timer_local : stage_timer_local_create();
+    histogram_record(&profile->stages[stage], ticks);
+}
+
+// from start to now, nothing if the thread moved to a CPU whose counter is behind
+static inline void
+stage_record(stage_t stage, uint64_t start)
+{
+    uint64_t end = stage_clock();
+    if (end >= start){
+        stage_record_ticks(stage, end - start);
+    }
+}
+
+// from the last mark to start, the time spent out of the handler
+static inline void
+stage_record_gap(stage_t stage, uint64_t start)
+{
+    if (stage_timer_mark != 0 && start >= stage_timer_mark){
+        stage_record_ticks(stage, start - stage_timer_mark);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef STAGE_TIMER_ENABLED
+
+#define STAGE_BEGIN(start) uint64_t start = stage_timer_enabled ? stage_clock() : 0
+#define STAGE_END(start, stage) ((start) != 0 ? stage_record((stage), (start)) : (void)0)
+#define STAGE_GAP(start, stage) ((start) != 0 ? stage_record_gap((stage), (start)) : (void)0)
+#define STAGE_MARK() (stage_timer_enabled ? (void)(stage_timer_mark = stage_clock()) : (void)0)
+
+#ifdef __cplusplus
+// a stage from here to the end of the block
+struct stage_scope {
+    stage_t stage;
+    uint64_t start;
+
+    explicit stage_scope(stage_t timed) : stage(timed), start(stage_timer_enabled ? stage_clock() : 0) {}
+    ~stage_scope() { STAGE_END(start, stage); }
+    stage_scope(const stage_scope&) = delete;
+    stage_scope& operator=(const stage_scope&) = delete;
+};
+
+#define STAGE_SCOPE(stage) stage_scope stage_scope_timer(stage)
+#endif
+
+#else
+
+#define STAGE_BEGIN(start) ((void)0)
+#define STAGE_END(start, stage) ((void)0)
+#define STAGE_GAP(start, stage) ((void)0)
+#define STAGE_MARK() ((void)0)
+#define STAGE_SCOPE(stage) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+#include "stage_timer.h"
+#include <cassert>
+#include <pthread.h>
+
+// a few microseconds of work the compiler keeps
+static uint64_t
+spin(uint32_t rounds)
+{
+    volatile uint64_t value = 0;
+    for (uint32_t i = 0; i < rounds; i++){
+        value = value + i;
+    }
+    return value;
+}
+
+static void
+timed_work()
+{
+    STAGE_SCOPE(STAGE_PARSE);
+    STAGE_BEGIN(start);
+    spin(1000);
+    STAGE_END(start, STAGE_DISSECT);
+    spin(1000);
+}
+
+static void*
+thread_work(void *args)
+{
+    (void)args;
+    for (int i = 0; i < 10; i++){
+        timed_work();
+    }
+    return stage_timer_take();
+}
+
+void
+test_disabled()
+{
+    // compiled in, off until enabled
+    assert(!stage_timer_enabled);
+    timed_work();
+    assert(stage_timer_local == NULL);
+    STAGE_MARK();
+    assert(stage_timer_mark == 0);
+}
+
+void
+test_stages()
+{
+    stage_timer_enable();
+    assert(stage_timer_overhead() > 0);
+    for (int i = 0; i < 100; i++){
+        STAGE_BEGIN(start);
+        STAGE_GAP(start, STAGE_CAPTURE);
+        timed_work();
+        STAGE_END(start, STAGE_HANDLER);
+        STAGE_MARK();
+        spin(100);
+    }
+    stage_profile_t *profile = stage_timer_take();
+    assert(profile != NULL && stage_timer_local == NULL && stage_timer_mark == 0);
+    // the first packet has no gap before it
+    assert(profile->stages[STAGE_HANDLER].count == 100 && profile->stages[STAGE_CAPTURE].count == 99);
+    assert(profile->stages[STAGE_PARSE].count == 100 && profile->stages[STAGE_DISSECT].count == 100);
+    assert(profile->stages[STAGE_TCP].count == 0);
+    // the outer stages count the inner ones
+    assert(profile->stages[STAGE_DISSECT].sum < profile->stages[STAGE_PARSE].sum);
+    assert(profile->stages[STAGE_PARSE].sum < profile->stages[STAGE_HANDLER].sum);
+    assert(stage_timer_tick_ns() > 0);
+
+    // another thread's, merged
+    pthread_t thread;
+    void *other;
+    pthread_create(&thread, NULL, thread_work, NULL);
+    pthread_join(thread, &other);
+    assert(other != NULL);
+    stage_profile_merge(profile, (stage_profile_t*)other);
+    assert(profile->stages[STAGE_PARSE].count == 110 && profile->stages[STAGE_HANDLER].count == 100);
+    stage_profile_destroy((stage_profile_t*)other);
+    stage_profile_destroy(profile);
+}
+
+int main()
+{
+    for (uint32_t i = 0; i < STAGE_KINDS; i++){
+        assert(stage_names[i] != NULL);
+    }
+    test_disabled();
+    test_stages();
+    return 0;
+}